@@ -29,12 +29,17 @@
 // THE SOFTWARE.
 
 #import <Foundation/Foundation.h>
+#import "RichTextEditorFoundationText.h"
+#if !RTE_FOUNDATION_ONLY
 #import "NSFont+RichTextEditor.h"
+#endif
 
 @interface NSAttributedString (RichTextEditor)
 
 - (NSRange)firstParagraphRangeFromTextRange:(NSRange)range;
 - (NSArray *)rangeOfParagraphsFromTextRange:(NSRange)textRange;
 - (NSString *)htmlString;
+/// Streams the same HTML as htmlString to the given stream as UTF-8 (see RichTextEditorHTMLWriter)
+- (BOOL)writeHTMLToStream:(NSOutputStream *)stream error:(NSError **)error;
 
 @end
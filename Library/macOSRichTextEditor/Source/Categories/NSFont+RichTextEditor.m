@@ -29,73 +29,21 @@
 // THE SOFTWARE.
 
 #import "NSFont+RichTextEditor.h"
+#import "RichTextEditorFontCache.h"
 
 @implementation NSFont (RichTextEditor)
 
+// The actual font resolution lives in RichTextEditorFontCache, which remembers the results
 + (NSString *)postscriptNameFromFullName:(NSString *)fullName {
-    // avoid error with "All system UI font access should be through proper APIs..."
-    // by bailing early if the user gets here with a system font
-    if ([fullName containsString:@"SFNS"]) {
-        return fullName;
-    }
-    NSFont *font = [NSFont fontWithName:fullName size:1];
-	return (__bridge NSString *)(CTFontCopyPostScriptName((__bridge CTFontRef)(font)));
+	return [[RichTextEditorFontCache sharedCache] postscriptNameFromFullName:fullName];
 }
 
 + (NSFont *)fontWithName:(NSString *)name size:(CGFloat)size boldTrait:(BOOL)isBold italicTrait:(BOOL)isItalic {
-    // avoid error with "All system UI font access should be through proper APIs..."
-    // by bailing early if the user gets here with a system font
-    if ([name containsString:@"SFNS"]) {
-        NSFontManager *fontManager = [NSFontManager sharedFontManager];
-        NSFont *sysFont = [NSFont systemFontOfSize:size];
-        if (isItalic) {
-            sysFont = [fontManager convertFont:sysFont toHaveTrait:NSFontItalicTrait];
-        }
-        if (isBold) {
-            sysFont = [fontManager convertFont:sysFont toHaveTrait:NSFontBoldTrait];
-        }
-        return sysFont;
-    }
-    NSString *postScriptName = [NSFont postscriptNameFromFullName:name];
-    
-	CTFontRef fontWithoutTrait = CTFontCreateWithName((__bridge CFStringRef)(postScriptName), size, NULL);
-    CTFontSymbolicTraits traits = 0;
-    CTFontRef newFontRef;
-    
-    if (isItalic) {
-        traits |= kCTFontItalicTrait;
-    }
-	
-    if (isBold) {
-		traits |= kCTFontBoldTrait;
-    }
-	
-	if (traits == 0) {
-		newFontRef = CTFontCreateCopyWithAttributes(fontWithoutTrait, 0.0, NULL, NULL);
-	}
-	else {
-		newFontRef = CTFontCreateCopyWithSymbolicTraits(fontWithoutTrait, 0.0, NULL, traits, traits);
-	}
-	
-    if (fontWithoutTrait) {
-		CFRelease(fontWithoutTrait);
-    }
-	
-	if (newFontRef) {
-		NSString *fontNameKey = (__bridge NSString *)(CTFontCopyName(newFontRef, kCTFontPostScriptNameKey));
-        CGFloat size = CTFontGetSize(newFontRef);
-		CFRelease(newFontRef);
-		return [NSFont fontWithName:fontNameKey size:size];
-	}
-	
-	return nil;
+	return [[RichTextEditorFontCache sharedCache] fontWithName:name size:size boldTrait:isBold italicTrait:isItalic];
 }
 
 - (NSFont *)fontWithBoldTrait:(BOOL)bold italicTrait:(BOOL)italic andSize:(CGFloat)size {
-	CTFontRef fontRef = (__bridge CTFontRef)self;
-	NSString *familyName = (__bridge NSString *)(CTFontCopyName(fontRef, kCTFontFamilyNameKey));
-	NSString *postScriptName = [NSFont postscriptNameFromFullName:familyName];
-	return [[self class] fontWithName:postScriptName size:size boldTrait:bold italicTrait:italic];
+	return [[RichTextEditorFontCache sharedCache] fontFromFont:self withBoldTrait:bold italicTrait:italic size:size];
 }
 
 - (NSFont *)fontWithBoldTrait:(BOOL)bold andItalicTrait:(BOOL)italic {
@@ -34,6 +34,15 @@
 #import <Cocoa/Cocoa.h>
 
 @class RichTextEditor;
+@class RichTextEditorFormattingState;
+@class RichTextEditorUndoJournal;
+@class RichTextEditorCommandMetrics;
+@class RichTextEditorFindReplace;
+@class RichTextEditorEditStream;
+@class RichTextEditorAttributeInterner;
+@class RichTextEditorStatistics;
+@class RichTextEditorKeyBindings;
+@class RichTextEditorAutosave;
 
 // These values will always start from 0 and go up. If you want to add your own
 // preview changes via a subclass, start from 9999 and go down (or similar) and
@@ -82,6 +91,7 @@ typedef NS_OPTIONS(NSUInteger, RichTextEditorShortcut) {
 
 /// If you do not want to enable all keyboard shortcuts (e.g. if you don't want users to resize font ever),
 /// then you can use this data source callback to selectively enable keyboard shortcuts.
+/// Asked when the data source is set and on -[RichTextEditor reloadKeyBindings], not on every key.
 - (RichTextEditorShortcut)enabledKeyboardShortcuts;
 
 @end
@@ -102,11 +112,17 @@ typedef NS_OPTIONS(NSUInteger, RichTextEditorShortcut) {
 
 - (void)richTextEditor:(RichTextEditor*)editor changeAboutToOccurOfType:(RichTextEditorPreviewChange)type;
 
+/// Called with a snapshot of the formatting at the selection whenever selectionForEditor:changedTo:...
+/// would be. state.changedFields says which values differ from the previous snapshot.
+/// Set coalescesFormattingStateUpdates to get at most one of these per run loop turn.
+- (void)richTextEditor:(RichTextEditor*)editor formattingStateChanged:(RichTextEditorFormattingState*)state;
+
 @end
 
 @interface RichTextEditor : NSTextView
 
 @property (assign) IBOutlet id <RichTextEditorDataSource> rteDataSource;
+/// Which optional delegate methods are implemented is checked when the delegate is set.
 @property (assign) IBOutlet id <RichTextEditorDelegate> rteDelegate;
 @property (nonatomic, assign) CGFloat defaultIndentationSize;
 @property (nonatomic, readonly) unichar lastSingleKeyPressed;
@@ -133,6 +149,85 @@ typedef NS_OPTIONS(NSUInteger, RichTextEditorShortcut) {
 /// false to let the tab key be used as normal
 @property BOOL tabKeyAlwaysIndentsOutdents;
 
+/// Keyboard shortcuts, checked in keyDown: before a key is handled as typing. Starts as a copy
+/// of defaultKeyBindings; add, remove or replace bindings here to remap the editor's shortcuts
+/// or add commands without subclassing. Setting it stores a copy.
+@property (nonatomic, copy) RichTextEditorKeyBindings *keyBindings;
+
+/// The editor's built-in shortcuts (bold, italic, underline, font size, lists and indentation).
++ (RichTextEditorKeyBindings *)defaultKeyBindings;
+
+/// Asks the data source for enabledKeyboardShortcuts again. Call it when the answer changes.
+- (void)reloadKeyBindings;
+
+/// If YES, selection and typing attribute updates for the delegate are collected and delivered
+/// at most once per run loop turn (and not at all while a mouse selection is still in progress),
+/// and updates that don't change anything are dropped. Both selectionForEditor:changedTo:... and
+/// richTextEditor:formattingStateChanged: are affected.
+/// Defaults to NO (one update per selection change, as before).
+@property (nonatomic) BOOL coalescesFormattingStateUpdates;
+
+/// The formatting state most recently delivered to the delegate.
+@property (nonatomic, readonly) RichTextEditorFormattingState *formattingState;
+
+/// Number of formatting state updates delivered to the delegate.
+@property (nonatomic, readonly) NSUInteger formattingStateUpdateCount;
+
+/// Number of formatting state updates that were coalesced or dropped because nothing changed.
+@property (nonatomic, readonly) NSUInteger suppressedFormattingStateUpdateCount;
+
+/// Sets formattingStateUpdateCount and suppressedFormattingStateUpdateCount back to 0.
+- (void)resetFormattingStateUpdateStatistics;
+
+/// If YES, undo and redo use undoJournal instead of the text view's NSUndoManager. Every editor
+/// command (bold, bullets, indentation, ...) and every bit of typing is recorded as one compact
+/// delta, consecutive typing is merged into one step, and history is limited by
+/// undoJournal.byteBudget instead of levelsOfUndo.
+/// Turning this on turns off allowsUndo. Defaults to NO.
+@property (nonatomic) BOOL usesUndoJournal;
+
+/// The journal used when usesUndoJournal is YES; nil otherwise.
+@property (nonatomic, readonly) RichTextEditorUndoJournal *undoJournal;
+
+/// If set, every command is timed from its changeAboutToOccurOfType: notification to the end of
+/// the run loop turn it ran in (text storage edit, layout and display) and recorded here, along
+/// with the number of characters and attribute runs it touched. nil (the default) turns this off.
+@property (nonatomic) RichTextEditorCommandMetrics *commandMetrics;
+
+/// If YES, the editor is tuned for very long documents: the layout manager lays out text
+/// non-contiguously (only what is shown or asked for), a selection change only scrolls when the
+/// insertion point has actually left the visible rect, and paragraph commands (bullets,
+/// indentation, alignment) only redisplay the paragraphs they changed.
+/// Defaults to NO, which keeps contiguous layout to avoid selection highlight jumping.
+@property (nonatomic) BOOL largeDocumentMode;
+
+/// Structured records of every change to the text, for keeping something in step with the
+/// document without re-reading all of it on each textDidChange:. Created the first time it is
+/// asked for; set its handler to start receiving records. Typing (together with the bullet
+/// changes that follow it) and each editor command are delivered as one batch, before the
+/// delegate's textDidChange:.
+@property (nonatomic, readonly) RichTextEditorEditStream *editStream;
+
+/// Word, character, paragraph and list item counts and the fonts and colors in use, kept up to
+/// date by recounting only the paragraphs each edit touched, so a status bar can show them on
+/// every keystroke. Created the first time it is asked for; list items are counted by bulletString.
+@property (nonatomic, readonly) RichTextEditorStatistics *statistics;
+
+/// Every paragraph style, font and color the editor applies (including typing attributes) goes
+/// through this, so equal values are one shared object and neighbouring runs can merge.
+@property (nonatomic, readonly) RichTextEditorAttributeInterner *attributeInterner;
+
+/// Interns the attributes of the whole text and merges neighbouring runs that are then equal,
+/// e.g. after loading or pasting text from elsewhere. The text looks the same afterwards, so
+/// this isn't an undo step. Returns the number of runs removed.
+- (NSUInteger)compactAttributeRuns;
+
+/// Number of attribute runs the text storage holds.
+@property (nonatomic, readonly) NSUInteger attributeRunCount;
+
+/// Number of separate paragraph style, font and color objects in the text.
+@property (nonatomic, readonly) NSUInteger attributeObjectCount;
+
 /// Pasteboard type string used when copying text from this NSTextView.
 +(NSString*)pasteboardDataType;
 
@@ -202,22 +297,114 @@ typedef NS_OPTIONS(NSUInteger, RichTextEditorShortcut) {
 /// Convenience method to set the editor's border width.
 - (void)setBorderWidth:(CGFloat)borderWidth;
 
-/// Converts the current NSAttributedString to an HTML string.
+/// Converts the current NSAttributedString to an HTML string. See htmlStringFromAttributedText:.
 - (NSString *)htmlString;
 
 /// Converts the provided htmlString into an NSAttributedString and then
 /// sets the editor's text to the attributed string.
 - (void)setHtmlString:(NSString *)htmlString;
 
+/// The editor's text in the binary document format (see RichTextEditorBinaryDocument).
+- (NSData *)binaryDocumentData;
+
+/// Replaces the editor's text with a document in the binary format. If data can't be read,
+/// returns NO and leaves the text alone.
+- (BOOL)setBinaryDocumentData:(NSData *)data error:(NSError **)error;
+
+/// Writes the editor's text to url in the binary document format.
+- (BOOL)saveBinaryDocumentToURL:(NSURL *)url error:(NSError **)error;
+
+/// Replaces the editor's text with the binary document at url. The file is memory mapped
+/// while it is read.
+- (BOOL)loadBinaryDocumentFromURL:(NSURL *)url error:(NSError **)error;
+
+/// The editor's text as Markdown; see RichTextEditorMarkdownWriter for what is kept. Much
+/// faster than htmlString.
+- (NSString *)markdownString;
+
+/// Replaces the editor's text with Markdown, read with RichTextEditorMarkdownReader in the
+/// editor's font, bullet string and indentation.
+- (void)setMarkdownString:(NSString *)markdownString;
+
+/// Streams the editor's text as Markdown to fileHandle without building the whole string first.
+- (BOOL)writeMarkdownToFileHandle:(NSFileHandle *)fileHandle error:(NSError **)error;
+
+/// The autosave started by startAutosavingToDirectoryURL:error:, or nil.
+@property (nonatomic, readonly) RichTextEditorAutosave *autosave;
+
+/// Starts keeping a copy of the text in directoryURL that survives the app crashing, by
+/// journaling each edit in the background (see RichTextEditorAutosave). If the directory holds
+/// an autosave from an earlier run, the text is first replaced with what can be recovered from
+/// it. Stops any autosave already running.
+- (BOOL)startAutosavingToDirectoryURL:(NSURL *)directoryURL error:(NSError **)error;
+
+/// Stops autosaving and waits for queued edits to be written. The files are kept until
+/// +[RichTextEditorAutosave removeAutosaveAtDirectoryURL:error:] is called. prepareForReuse
+/// also stops autosaving.
+- (void)stopAutosaving;
+
+/// Replaces the editor's text with htmlString without blocking the main thread: the HTML is
+/// read on a background queue and the result is added in paragraph-aligned chunks, a little
+/// per run loop turn, so the start of the document shows up right away. The editor is not
+/// editable while loading. progress gets the fraction loaded so far; completion gets NO if the
+/// load was cancelled (see cancelProgressiveLoad) or the HTML couldn't be read. Both are
+/// called on the main thread and may be nil.
+- (void)loadHtmlStringProgressively:(NSString *)htmlString progress:(void (^)(double fractionLoaded))progress completion:(void (^)(BOOL finished))completion;
+
+/// Like loadHtmlStringProgressively:progress:completion:, for an attributed string.
+- (void)loadAttributedStringProgressively:(NSAttributedString *)string progress:(void (^)(double fractionLoaded))progress completion:(void (^)(BOOL finished))completion;
+
+/// Stops a progressive load, leaving the text loaded so far. Setting the editor's text in any
+/// other way (or starting another progressive load) also cancels the current one.
+- (void)cancelProgressiveLoad;
+
+/// YES while a progressive load is in progress.
+@property (nonatomic, readonly) BOOL isLoadingProgressively;
+
+/// Selects and scrolls to the first match after the selection, wrapping around to the start of
+/// the text. Returns the match, or {NSNotFound, 0} if there is none. Like the other find
+/// methods, the editor's bullets are never matched unless findReplace has its own listMarkers.
+- (NSRange)selectNextMatch:(RichTextEditorFindReplace *)findReplace;
+
+/// Finds every match on a background queue from a snapshot of the text; see
+/// -[RichTextEditorFindReplace findMatchesInBackgroundInString:batchHandler:completion:].
+/// Starting another search cancels the previous one.
+- (void)findMatchesInBackground:(RichTextEditorFindReplace *)findReplace
+                   batchHandler:(void (^)(NSArray<NSValue *> *matchRanges))batchHandler
+                     completion:(void (^)(NSUInteger matchCount, BOOL finished))completion;
+
+/// Replaces every match in one text storage edit that is undone as a single step. Replacements
+/// keep the attributes of the text they replace. Returns the number of matches replaced.
+- (NSUInteger)replaceAllMatches:(RichTextEditorFindReplace *)findReplace withTemplate:(NSString *)replacementTemplate;
+
+/// Puts the editor back in the state of a new one (empty text, no undo history, no bullet or
+/// typing state, selection and scroll position at the start) without rebuilding its text
+/// system, for reusing editors in table and collection view cells. Settings (delegates, font
+/// size limits, largeDocumentMode, ...) are kept. See RichTextEditorPool.
+- (void)prepareForReuse;
+
+/// Width of a tab with the font, tab stops and spacing of attributes, used for
+/// defaultIndentationSize. Cached per combination of those and shared by every editor.
++ (CGFloat)indentationSizeForAttributes:(NSDictionary *)attributes;
+
 /// Grabs the NSString used as the bulleted list prefix.
 - (NSString*)bulletString;
 
-/// Converts the provided NSAttributedString into an HTML string.
+/// Converts the provided NSAttributedString into an HTML string, with RichTextEditorHTMLWriter
+/// (the same HTML as -[NSAttributedString htmlString]). Safe to call from any thread.
 + (NSString *)htmlStringFromAttributedText:(NSAttributedString*)text;
 
 /// Converts the given HTML string into an NSAttributedString.
+/// The HTML the editor itself produces is read with RichTextEditorHTMLReader, which doesn't need
+/// the main thread. Anything else falls back to Cocoa's HTML importer, which only runs on the
+/// main thread: called from another thread, this method returns nil for such HTML instead of
+/// waiting for the main thread. Use attributedStringFromHTMLString:completion: there.
 + (NSAttributedString*)attributedStringFromHTMLString:(NSString *)htmlString;
 
+/// Converts the given HTML string into an NSAttributedString on a background queue.
+/// The completion block is called on the main queue; the string is nil if the HTML couldn't be read.
++ (void)attributedStringFromHTMLString:(NSString *)htmlString completion:(void (^)(NSAttributedString *attributedString))completion;
+
 /// Converts a given RichTextEditorPreviewChange to a human-readable string
 + (NSString *)convertPreviewChangeTypeToString:(RichTextEditorPreviewChange)changeType withNonSpecialChangeText:(BOOL)shouldReturnStringForNonSpecialType;
 
@@ -35,14 +35,34 @@
 #import "NSFont+RichTextEditor.h"
 #import "NSAttributedString+RichTextEditor.h"
 #import "WZProtocolInterceptor.h"
+#import "RichTextEditorParagraphIndex.h"
+#import "RichTextEditorParagraphBatch.h"
+#import "RichTextEditorHTMLReader.h"
+#import "RichTextEditorHTMLWriter.h"
+#import "RichTextEditorMarkdownReader.h"
+#import "RichTextEditorMarkdownWriter.h"
+#import "RichTextEditorBinaryDocument.h"
+#import "RichTextEditorProgressiveLoader.h"
+#import "RichTextEditorFindReplace.h"
+#import "RichTextEditorEditStream.h"
+#import "RichTextEditorStatistics.h"
+#import "RichTextEditorAttributeInterner.h"
+#import "RichTextEditorFormattingState.h"
+#import "RichTextEditorUndoJournal.h"
+#import "RichTextEditorCommandMetrics.h"
+#import "RichTextEditorStyleTransform.h"
+#import "RichTextEditorDocument.h"
+#import "RichTextEditorKeyBindings.h"
+#import "RichTextEditorAutosave.h"
 #import  <objc/runtime.h>
 
-typedef NS_ENUM(NSInteger, ParagraphIndentation) {
-    ParagraphIndentationIncrease,
-    ParagraphIndentationDecrease
-};
-
 @interface RichTextEditor () <NSTextViewDelegate> {
+    CFRunLoopObserverRef _commandMetricsObserver;
+    // Text storage whose edits are counted for command metrics
+    NSTextStorage *_commandMetricsTextStorage;
+    // Optional delegate methods, checked once in setRteDelegate: instead of on every key
+    BOOL _rteDelegateHandlesKeyDown;
+    BOOL _rteDelegateHandlesChangeAboutToOccur;
 }
 
 // Gets set to YES when the user starts changing attributes when there is no text selection (selecting bold, italic, etc)
@@ -54,7 +74,7 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 @property NSInteger MAX_INDENT;
 @property BOOL isInTextDidChange;
 
-@property NSString *BULLET_STRING;
+@property (nonatomic) NSString *BULLET_STRING;
 
 @property NSUInteger levelsOfUndo;
 @property NSUInteger previousCursorPosition;
@@ -62,17 +82,62 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 @property BOOL inBulletedList;
 @property BOOL justDeletedBackward;
 @property NSString *latestReplacementString;
-@property NSString *latestStringReplaced;
+@property BOOL latestReplacedTextEndsWithNewline;
 
 @property (nonatomic) NSRange lastAnchorPoint;
 @property BOOL shouldEndColorChangeOnLeft;
 
 @property WZProtocolInterceptor *delegate_interceptor;
 
+// The editing rules for self.textStorage. Bullets, indentation and font changes are planned
+// here; the editor adds selection, typing attribute, undo and delegate handling around them.
+@property (nonatomic) RichTextEditorDocument *document;
+
+// Newline table for self.textStorage; use this instead of the NSAttributedString category
+// paragraph methods, which rescan the text on every call.
+@property (nonatomic, readonly) RichTextEditorParagraphIndex *paragraphIndex;
+
+// Formatting state updates (see coalescesFormattingStateUpdates)
+@property (nonatomic) BOOL isStillSelecting;
+@property (nonatomic) BOOL hasPendingFormattingStateUpdate;
+@property (nonatomic, readwrite) RichTextEditorFormattingState *formattingState;
+@property (nonatomic, readwrite) NSUInteger formattingStateUpdateCount;
+@property (nonatomic, readwrite) NSUInteger suppressedFormattingStateUpdateCount;
+
+// Undo journal (see usesUndoJournal)
+@property (nonatomic, readwrite) RichTextEditorUndoJournal *undoJournal;
+@property BOOL isRecordingTyping;
+
+// Command metrics (see commandMetrics)
+@property BOOL isMeasuringCommand;
+@property RichTextEditorPreviewChange measuredCommandType;
+@property NSTimeInterval measuredCommandStartTime;
+@property NSUInteger measuredCharactersTouched;
+@property NSUInteger measuredAttributeRunsTouched;
+
+@property RichTextEditorProgressiveLoader *progressiveLoader;
+@property BOOL wasEditableBeforeProgressiveLoad;
+
+@property (nonatomic, readwrite) RichTextEditorEditStream *editStream;
+@property RichTextEditorEditStream *typingEditStream;
+
+@property (nonatomic, readwrite) RichTextEditorStatistics *statistics;
+
+@property (nonatomic, readwrite) RichTextEditorAttributeInterner *attributeInterner;
+
+@property NSDictionary *initialTypingAttributes;
+
+@property RichTextEditorFindReplace *backgroundFindReplace;
+
+@property (nonatomic, readwrite) RichTextEditorAutosave *autosave;
+
 @end
 
 @implementation RichTextEditor
 
+@synthesize rteDataSource = _rteDataSource;
+@synthesize rteDelegate = _rteDelegate;
+
 +(NSString*)pasteboardDataType {
 	return @"macOSRichTextEditor57";
 }
@@ -133,18 +198,18 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
     self.minFontSize = 10.0f;
     
     self.levelsOfUndo = 10;
+    self.keyBindings = [RichTextEditor defaultKeyBindings];
     
     self.BULLET_STRING = @"•\u00A0"; // bullet is \u2022
     self.latestReplacementString = @"";
-    self.latestStringReplaced = @"";
+    self.latestReplacedTextEndsWithNewline = NO;
     
     // Instead of hard-coding the default indentation size, which can make bulleted lists look a little
     // odd when increasing/decreasing their indent, use a \t character width instead
     // The old defaultIndentationSize was 15
     // TODO: readjust this defaultIndentationSize when font size changes? Might make things weird.
 	NSDictionary *dictionary = [self dictionaryAtIndex:self.selectedRange.location];
-    CGSize expectedStringSize = [@"\t" sizeWithAttributes:dictionary];
-	self.defaultIndentationSize = expectedStringSize.width;
+	self.defaultIndentationSize = [RichTextEditor indentationSizeForAttributes:dictionary];
     self.MAX_INDENT = self.defaultIndentationSize * 10;
 
     if (self.rteDataSource && [self.rteDataSource respondsToSelector:@selector(levelsOfUndo)]) {
@@ -155,11 +220,116 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
     }
     
     // http://stackoverflow.com/questions/26454037/uitextview-text-selection-and-highlight-jumping-in-ios-8
-    self.layoutManager.allowsNonContiguousLayout = NO;
+    self.layoutManager.allowsNonContiguousLayout = self.largeDocumentMode;
     self.selectedRange = NSMakeRange(0, 0);
     if ([[self.string stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] isEqualToString:@""]) {
         [self.textStorage setAttributedString:[[NSAttributedString alloc] initWithString:@""]];
     }
+    self.initialTypingAttributes = self.typingAttributes;
+}
+
++ (CGFloat)indentationSizeForAttributes:(NSDictionary *)attributes {
+    return [RichTextEditorDocument indentationSizeForAttributes:attributes];
+}
+
+- (void)prepareForReuse {
+    // Before the text is cleared, so the cleared text doesn't replace the autosave
+    [self stopAutosaving];
+    [self cancelProgressiveLoad];
+    [self.backgroundFindReplace cancelBackgroundSearch];
+    self.backgroundFindReplace = nil;
+    [self endRecordingTyping];
+    [self endTypingEditBatch];
+    // Only this editor's actions: the undo manager usually belongs to the window and is shared
+    [self.undoManager removeAllActionsWithTarget:self];
+    [self.undoManager removeAllActionsWithTarget:self.textStorage];
+    [self.textStorage setAttributedString:[[NSAttributedString alloc] initWithString:@""]];
+    [self.undoJournal removeAllEntries];
+    self.lastAnchorPoint = NSMakeRange(NSNotFound, 0);
+    self.shouldEndColorChangeOnLeft = NO;
+    self.typingAttributes = self.initialTypingAttributes;
+    [self resetEditingStateForNewDocument];
+    [self scrollPoint:NSZeroPoint];
+    [self sendDelegateTypingAttrsUpdate];
+}
+
+- (RichTextEditorDocument *)document {
+    // NSTextView can be handed a different text storage (replaceTextStorage:), so make sure
+    // we are editing the one that is actually displayed.
+    if (!_document || _document.textStorage != self.textStorage) {
+        RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithTextStorage:self.textStorage];
+        if (_document) {
+            document.bulletString = _document.bulletString;
+            document.defaultIndentationSize = _document.defaultIndentationSize;
+            document.maximumIndentation = _document.maximumIndentation;
+            document.fontSizeChangeAmount = _document.fontSizeChangeAmount;
+            document.minFontSize = _document.minFontSize;
+            document.maxFontSize = _document.maxFontSize;
+        }
+        document.attributeInterner = self.attributeInterner;
+        _document = document;
+    }
+    return _document;
+}
+
+// The document with the editor's current typing attributes, which it uses for the end of the text
+- (RichTextEditorDocument *)documentForCommand {
+    RichTextEditorDocument *document = self.document;
+    document.typingAttributes = self.typingAttributes;
+    return document;
+}
+
+- (RichTextEditorParagraphIndex *)paragraphIndex {
+    return self.document.paragraphIndex;
+}
+
+// The settings the rules need live in the document
+- (NSString *)BULLET_STRING {
+    return self.document.bulletString;
+}
+
+- (void)setBULLET_STRING:(NSString *)BULLET_STRING {
+    self.document.bulletString = BULLET_STRING;
+}
+
+- (CGFloat)defaultIndentationSize {
+    return self.document.defaultIndentationSize;
+}
+
+- (void)setDefaultIndentationSize:(CGFloat)defaultIndentationSize {
+    self.document.defaultIndentationSize = defaultIndentationSize;
+}
+
+- (NSInteger)MAX_INDENT {
+    return (NSInteger)self.document.maximumIndentation;
+}
+
+- (void)setMAX_INDENT:(NSInteger)MAX_INDENT {
+    self.document.maximumIndentation = MAX_INDENT;
+}
+
+- (CGFloat)fontSizeChangeAmount {
+    return self.document.fontSizeChangeAmount;
+}
+
+- (void)setFontSizeChangeAmount:(CGFloat)fontSizeChangeAmount {
+    self.document.fontSizeChangeAmount = fontSizeChangeAmount;
+}
+
+- (CGFloat)minFontSize {
+    return self.document.minFontSize;
+}
+
+- (void)setMinFontSize:(CGFloat)minFontSize {
+    self.document.minFontSize = minFontSize;
+}
+
+- (CGFloat)maxFontSize {
+    return self.document.maxFontSize;
+}
+
+- (void)setMaxFontSize:(CGFloat)maxFontSize {
+    self.document.maxFontSize = maxFontSize;
 }
 
 - (BOOL)rangeExists:(NSRange)range {
@@ -168,12 +338,10 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 
 - (BOOL)textView:(NSTextView *)textView shouldChangeTextInRange:(NSRange)affectedCharRange replacementString:(NSString *)replacementString {
     self.latestReplacementString = replacementString;
-    if (affectedCharRange.length > 0 && [self rangeExists:affectedCharRange]) {
-        self.latestStringReplaced = [self.string substringWithRange:affectedCharRange];
-    }
-    else {
-        self.latestStringReplaced = @"";
-    }
+    // Only the last character matters, so don't copy what is being replaced (all of the text
+    // for select all + delete)
+    self.latestReplacedTextEndsWithNewline = affectedCharRange.length > 0 && [self rangeExists:affectedCharRange] &&
+        [self.string characterAtIndex:NSMaxRange(affectedCharRange) - 1] == '\n';
     if ([replacementString isEqualToString:@"\n"]) {
         [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeEnter];
         self.inBulletedList = [self isInBulletedList];
@@ -181,14 +349,19 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
     if ([replacementString isEqualToString:@" "]) {
         [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeSpace];
     }
+    BOOL shouldChangeText = YES;
     if (self.delegate_interceptor.receiver && [self.delegate_interceptor.receiver respondsToSelector:@selector(textView:shouldChangeTextInRange:replacementString:)]) {
-        return [self.delegate_interceptor.receiver textView:textView shouldChangeTextInRange:affectedCharRange replacementString:replacementString];
+        shouldChangeText = [self.delegate_interceptor.receiver textView:textView shouldChangeTextInRange:affectedCharRange replacementString:replacementString];
     }
-    if (self.tabKeyAlwaysIndentsOutdents && [replacementString isEqualToString:@"\t"] && affectedCharRange.length == 0) {
+    else if (self.tabKeyAlwaysIndentsOutdents && [replacementString isEqualToString:@"\t"] && affectedCharRange.length == 0) {
         //[self userSelectedIncreaseIndent];
         //return NO;
     }
-    return YES;
+    if (shouldChangeText) {
+        [self beginRecordingTypingInRange:affectedCharRange replacementString:replacementString];
+        [self beginTypingEditBatch];
+    }
+    return shouldChangeText;
 }
 
 // http://stackoverflow.com/questions/2484072/how-can-i-make-the-tab-key-move-focus-out-of-a-nstextview
@@ -229,8 +402,9 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
     if (charRange.length == 0) {
         self.lastAnchorPoint = charRange;
     }
-    NSRange rangeOfCurrentParagraph = [self.attributedString firstParagraphRangeFromTextRange:charRange];
+    NSRange rangeOfCurrentParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:charRange];
     charRange = [self adjustSelectedRangeForBulletsWithStart:rangeOfCurrentParagraph Previous:NSMakeRange(NSNotFound, 0) andCurrent:charRange isMouseClick:YES];
+    self.isStillSelecting = stillSelectingFlag;
     [super setSelectedRange:charRange affinity:affinity stillSelecting:stillSelectingFlag];
 }
 
@@ -281,7 +455,7 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
                 //NSLog(@"Will select right in overall left selection");
             }
         }
-        NSRange rangeOfCurrentParagraph = [self.attributedString firstParagraphRangeFromTextRange:oldSelectedCharRange];
+        NSRange rangeOfCurrentParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:oldSelectedCharRange];
         newSelectedCharRange = [self adjustSelectedRangeForBulletsWithStart:rangeOfCurrentParagraph Previous:oldSelectedCharRange andCurrent:newSelectedCharRange isMouseClick:NO];
     }
     
@@ -292,8 +466,17 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 }
 
 - (void)textViewDidChangeSelection:(NSNotification *)notification {
-    [self setNeedsLayout:YES];
-    [self scrollRangeToVisible:self.selectedRange]; // fixes issue with cursor moving to top via keyboard and RTE not scrolling
+    // While the mouse is still dragging out a selection, NSTextView scrolls for us and the
+    // toolbar only needs the final selection, so don't do anything in coalescing mode
+    if (!(self.coalescesFormattingStateUpdates && self.isStillSelecting)) {
+        if (self.largeDocumentMode) {
+            [self scrollInsertionPointToVisibleIfNeeded];
+        }
+        else {
+            [self setNeedsLayout:YES];
+            [self scrollRangeToVisible:self.selectedRange]; // fixes issue with cursor moving to top via keyboard and RTE not scrolling
+        }
+    }
     [self sendDelegateTypingAttrsUpdate];
     if (self.delegate_interceptor.receiver && [self.delegate_interceptor.receiver respondsToSelector:@selector(textViewDidChangeSelection:)]) {
         [self.delegate_interceptor.receiver textViewDidChangeSelection:notification];
@@ -306,40 +489,47 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 		[self applyBulletListIfApplicable];
         [self deleteBulletListWhenApplicable];
         
-        if ([self.latestStringReplaced hasSuffix:@"\n"]) {
+        if (self.latestReplacedTextEndsWithNewline) {
             // get rest of paragraph as they just deleted a newline
-            NSRange rangeOfCurrentParagraph = [self.attributedString firstParagraphRangeFromTextRange:self.selectedRange];
+            NSRange rangeOfCurrentParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:self.selectedRange];
             NSInteger rangeDiff = self.selectedRange.location - rangeOfCurrentParagraph.location;
             if (rangeDiff >= 0) {
                 NSRange restOfLineRange = NSMakeRange(rangeOfCurrentParagraph.location + rangeDiff, rangeOfCurrentParagraph.length - rangeDiff);
-                NSString *restOfLine = [self.string substringWithRange:restOfLineRange];
-                if ([restOfLine hasPrefix:self.BULLET_STRING]) {
+                if ([self hasBulletAtLocation:restOfLineRange.location]) {
                     // we must have deleted a newline under a previous list! Get rid of the bullet!
                     [self.textStorage replaceCharactersInRange:NSMakeRange(restOfLineRange.location, self.BULLET_STRING.length) withString:@""];
                 }
             }
         }
+        // The automatic bullet changes above belong to the same undo step as the typing
+        [self endRecordingTyping];
         
         self.isInTextDidChange = NO;
     }
     self.justDeletedBackward = NO;
+    [self endTypingEditBatch];
     if (self.delegate_interceptor.receiver && [self.delegate_interceptor.receiver respondsToSelector:@selector(textDidChange:)]) {
         [self.delegate_interceptor.receiver textDidChange:notification];
     }
 }
 
 - (BOOL)isInBulletedList {
-    NSRange rangeOfCurrentParagraph = [self.attributedString firstParagraphRangeFromTextRange:self.selectedRange];
-    return [[[self.attributedString string] substringFromIndex:rangeOfCurrentParagraph.location] hasPrefix:self.BULLET_STRING];
+    NSRange rangeOfCurrentParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:self.selectedRange];
+    return [self hasBulletAtLocation:rangeOfCurrentParagraph.location];
 }
 
 -(BOOL)isInEmptyBulletedListItem {
-    NSRange rangeOfCurrentParagraph = [self.attributedString firstParagraphRangeFromTextRange:self.selectedRange];
-    return [[[self.attributedString string] substringFromIndex:rangeOfCurrentParagraph.location] isEqualToString:self.BULLET_STRING];
+    // The rest of the document is nothing but a bullet
+    NSRange rangeOfCurrentParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:self.selectedRange];
+    return rangeOfCurrentParagraph.location + self.BULLET_STRING.length == self.string.length &&
+        [self hasBulletAtLocation:rangeOfCurrentParagraph.location];
 }
 
 - (void)paste:(id)sender {
 	[self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangePaste];
+	if ([self pasteBinaryDocumentFromPasteboard:[NSPasteboard generalPasteboard]]) {
+		return;
+	}
 	if (self.allowsRichTextPasteOnlyFromThisClass) {
 		if ([[NSPasteboard generalPasteboard] dataForType:[RichTextEditor pasteboardDataType]]) {
 			[super paste:sender]; // just call paste so we don't have to bother doing the check again
@@ -354,6 +544,9 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 }
 
 - (void)pasteAsRichText:(id)sender {
+	if ([self pasteBinaryDocumentFromPasteboard:[NSPasteboard generalPasteboard]]) {
+		return;
+	}
 	BOOL hasCopyDataFromThisClass = [[NSPasteboard generalPasteboard] dataForType:[RichTextEditor pasteboardDataType]] != nil;
 	if (self.allowsRichTextPasteOnlyFromThisClass) {
 		if (hasCopyDataFromThisClass) {
@@ -380,28 +573,124 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 
 - (void)cut:(id)sender {
     [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeCut];
+    NSData *selectionData = [self binaryDocumentDataForSelection];
     [super cut:sender];
+    [self writeBinaryDocumentData:selectionData toPasteboard:[NSPasteboard generalPasteboard]];
 }
 
 -(void)copy:(id)sender {
 	[super copy:sender];
-	NSPasteboard *currentPasteboard = [NSPasteboard generalPasteboard];
-	[currentPasteboard setData:[@"" dataUsingEncoding:NSUTF8StringEncoding] forType:[RichTextEditor pasteboardDataType]];
+	[self writeBinaryDocumentData:[self binaryDocumentDataForSelection] toPasteboard:[NSPasteboard generalPasteboard]];
+}
+
+// The selected text in the binary document format, or empty data for a multiple selection
+// (pasting then falls back to the RTF that NSTextView put on the pasteboard)
+- (NSData *)binaryDocumentDataForSelection {
+    if (self.selectedRanges.count != 1 || ![self rangeExists:self.selectedRange]) {
+        return [NSData data];
+    }
+    return [RichTextEditorBinaryDocument dataWithAttributedString:[self.textStorage attributedSubstringFromRange:self.selectedRange]];
+}
+
+- (void)writeBinaryDocumentData:(NSData *)data toPasteboard:(NSPasteboard *)pasteboard {
+    [pasteboard addTypes:@[[RichTextEditor pasteboardDataType]] owner:nil];
+    [pasteboard setData:data forType:[RichTextEditor pasteboardDataType]];
+}
+
+// Inserts the text copied from a RichTextEditor as is, without the RTF round trip.
+// Returns NO if the pasteboard doesn't hold a binary document (e.g. an empty marker written
+// by an older version), so the caller can paste the usual way.
+- (BOOL)pasteBinaryDocumentFromPasteboard:(NSPasteboard *)pasteboard {
+    NSData *data = [pasteboard dataForType:[RichTextEditor pasteboardDataType]];
+    if (data.length == 0) {
+        return NO;
+    }
+    RichTextEditorBinaryDocument *document = [[RichTextEditorBinaryDocument alloc] initWithData:data error:nil];
+    NSAttributedString *string = [document attributedStringWithError:nil];
+    if (!string) {
+        return NO;
+    }
+    NSRange range = self.rangeForUserTextChange;
+    if (range.location == NSNotFound) {
+        return YES; // not editable
+    }
+    if ([self shouldChangeTextInRange:range replacementString:string.string]) {
+        [self.textStorage replaceCharactersInRange:range withAttributedString:string];
+        self.selectedRange = NSMakeRange(range.location + string.length, 0);
+        [self didChangeText];
+    }
+    return YES;
 }
 
 #pragma mark -
 
 - (void)sendDelegateTypingAttrsUpdate {
+    if (!self.rteDelegate) {
+        return;
+    }
+    if (!self.coalescesFormattingStateUpdates) {
+        [self deliverFormattingStateUpdate];
+        return;
+    }
+    if (self.hasPendingFormattingStateUpdate || self.isStillSelecting) {
+        // Already scheduled for this run loop turn, or the user is still dragging; the
+        // pending update (or the one at the end of the drag) will pick up the latest state
+        self.suppressedFormattingStateUpdateCount++;
+        return;
+    }
+    self.hasPendingFormattingStateUpdate = YES;
+    [self performSelector:@selector(flushFormattingStateUpdate) withObject:nil afterDelay:0
+                  inModes:@[NSRunLoopCommonModes]];
+}
+
+- (void)flushFormattingStateUpdate {
+    if (!self.hasPendingFormattingStateUpdate) {
+        return;
+    }
+    self.hasPendingFormattingStateUpdate = NO;
     if (self.rteDelegate) {
-        NSDictionary *attributes = [self typingAttributes];
-        NSFont *font = [attributes objectForKey:NSFontAttributeName];
-        NSColor *fontColor = [attributes objectForKey:NSForegroundColorAttributeName];
-        NSColor *backgroundColor = [attributes objectForKey:NSBackgroundColorAttributeName]; // may want NSBackgroundColorAttributeName
-        BOOL isInBulletedList = [self isInBulletedList];
-        [self.rteDelegate selectionForEditor:self changedTo:[self selectedRange] isBold:[font isBold] isItalic:[font isItalic] isUnderline:[self isCurrentFontUnderlined] isInBulletedList:isInBulletedList textBackgroundColor:backgroundColor textColor:fontColor];
+        [self deliverFormattingStateUpdate];
+    }
+}
+
+- (void)deliverFormattingStateUpdate {
+    NSDictionary *attributes = [self typingAttributes];
+    NSFont *font = [attributes objectForKey:NSFontAttributeName];
+    NSColor *fontColor = [attributes objectForKey:NSForegroundColorAttributeName];
+    NSColor *backgroundColor = [attributes objectForKey:NSBackgroundColorAttributeName]; // may want NSBackgroundColorAttributeName
+    RichTextEditorFormattingState *state = [[RichTextEditorFormattingState alloc] initWithSelectedRange:[self selectedRange]
+                                                                                                 isBold:[font isBold]
+                                                                                               isItalic:[font isItalic]
+                                                                                            isUnderline:[self isCurrentFontUnderlined]
+                                                                                       isInBulletedList:[self isInBulletedList]
+                                                                                    textBackgroundColor:backgroundColor
+                                                                                              textColor:fontColor
+                                                                                          previousState:self.formattingState];
+    if (self.coalescesFormattingStateUpdates && state.changedFields == RichTextEditorFormattingFieldNone) {
+        self.suppressedFormattingStateUpdateCount++;
+        return;
+    }
+    self.formattingState = state;
+    self.formattingStateUpdateCount++;
+    if ([self.rteDelegate respondsToSelector:@selector(richTextEditor:formattingStateChanged:)]) {
+        [self.rteDelegate richTextEditor:self formattingStateChanged:state];
+    }
+    [self.rteDelegate selectionForEditor:self changedTo:state.selectedRange isBold:state.isBold isItalic:state.isItalic isUnderline:state.isUnderline isInBulletedList:state.isInBulletedList textBackgroundColor:state.textBackgroundColor textColor:state.textColor];
+}
+
+- (void)setCoalescesFormattingStateUpdates:(BOOL)coalescesFormattingStateUpdates {
+    _coalescesFormattingStateUpdates = coalescesFormattingStateUpdates;
+    if (!coalescesFormattingStateUpdates && self.hasPendingFormattingStateUpdate) {
+        [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(flushFormattingStateUpdate) object:nil];
+        [self flushFormattingStateUpdate];
     }
 }
 
+- (void)resetFormattingStateUpdateStatistics {
+    self.formattingStateUpdateCount = 0;
+    self.suppressedFormattingStateUpdateCount = 0;
+}
+
 -(void)sendDelegateTVChanged {
     if (self.delegate_interceptor.receiver && [self.delegate_interceptor.receiver respondsToSelector:@selector(textDidChange:)]) {
         [self.delegate_interceptor.receiver textDidChange:[NSNotification notificationWithName:@"textDidChange:" object:self]];
@@ -409,18 +698,123 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 }
 
 -(void)sendDelegatePreviewChangeOfType:(RichTextEditorPreviewChange)type {
-    if (self.rteDelegate && [self.rteDelegate respondsToSelector:@selector(richTextEditor:changeAboutToOccurOfType:)]) {
+    if (_commandMetrics) {
+        [self beginMeasuringCommandOfType:type];
+    }
+    if (_rteDelegateHandlesChangeAboutToOccur) {
         [self.rteDelegate richTextEditor:self changeAboutToOccurOfType:type];
     }
 }
 
+#pragma mark - Command Metrics -
+
+- (void)setCommandMetrics:(RichTextEditorCommandMetrics *)commandMetrics {
+    [self finishMeasuringCommand];
+    _commandMetrics = commandMetrics;
+    if (commandMetrics && !_commandMetricsObserver) {
+        // Ordered after Core Animation's commit (2000000) so that layout and display done for
+        // the command in this run loop turn are part of its time
+        __weak RichTextEditor *weakSelf = self;
+        _commandMetricsObserver = CFRunLoopObserverCreateWithHandler(kCFAllocatorDefault, kCFRunLoopBeforeWaiting | kCFRunLoopExit, true, 2100000,
+                                                                     ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+            [weakSelf finishMeasuringCommand];
+        });
+        CFRunLoopAddObserver(CFRunLoopGetMain(), _commandMetricsObserver, kCFRunLoopCommonModes);
+        [self observeTextStorageForCommandMetrics];
+    }
+    else if (!commandMetrics && _commandMetricsObserver) {
+        [self removeCommandMetricsObserver];
+    }
+}
+
+- (void)removeCommandMetricsObserver {
+    CFRunLoopObserverInvalidate(_commandMetricsObserver);
+    CFRelease(_commandMetricsObserver);
+    _commandMetricsObserver = NULL;
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:NSTextStorageDidProcessEditingNotification object:_commandMetricsTextStorage];
+    _commandMetricsTextStorage = nil;
+}
+
+// NSTextView can be handed a different text storage (replaceTextStorage:), so this is checked
+// again whenever a command starts
+- (void)observeTextStorageForCommandMetrics {
+    NSTextStorage *textStorage = self.textStorage;
+    if (textStorage == _commandMetricsTextStorage) {
+        return;
+    }
+    NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+    if (_commandMetricsTextStorage) {
+        [center removeObserver:self name:NSTextStorageDidProcessEditingNotification object:_commandMetricsTextStorage];
+    }
+    _commandMetricsTextStorage = textStorage;
+    if (textStorage) {
+        [center addObserver:self
+                   selector:@selector(textStorageDidProcessEditingForCommandMetrics:)
+                       name:NSTextStorageDidProcessEditingNotification
+                     object:textStorage];
+    }
+}
+
+- (void)dealloc {
+    if (_commandMetricsObserver) {
+        [self removeCommandMetricsObserver];
+    }
+    [_autosave stop];
+}
+
+- (void)beginMeasuringCommandOfType:(RichTextEditorPreviewChange)type {
+    // A command that starts while another is still open (e.g. the bullet that textDidChange:
+    // adds after an enter key press) ends the first one
+    [self finishMeasuringCommand];
+    [self observeTextStorageForCommandMetrics];
+    self.isMeasuringCommand = YES;
+    self.measuredCommandType = type;
+    self.measuredCharactersTouched = 0;
+    self.measuredAttributeRunsTouched = 0;
+    self.measuredCommandStartTime = [NSProcessInfo processInfo].systemUptime;
+}
+
+- (void)finishMeasuringCommand {
+    if (!self.isMeasuringCommand) {
+        return;
+    }
+    self.isMeasuringCommand = NO;
+    [_commandMetrics recordCommandOfType:self.measuredCommandType
+                                duration:[NSProcessInfo processInfo].systemUptime - self.measuredCommandStartTime
+                       charactersTouched:self.measuredCharactersTouched
+                    attributeRunsTouched:self.measuredAttributeRunsTouched];
+}
+
+- (void)textStorageDidProcessEditingForCommandMetrics:(NSNotification *)notification {
+    if (!self.isMeasuringCommand || notification.object != self.textStorage) {
+        return;
+    }
+    NSTextStorage *textStorage = notification.object;
+    NSRange editedRange = textStorage.editedRange;
+    if (editedRange.location == NSNotFound) {
+        return;
+    }
+    // Deleted characters count as touched too
+    NSInteger removedLength = -MIN(textStorage.changeInLength, (NSInteger)0);
+    self.measuredCharactersTouched += editedRange.length + (NSUInteger)removedLength;
+    __block NSUInteger runCount = 0;
+    [textStorage enumerateAttributesInRange:editedRange
+                                    options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                                 usingBlock:^(NSDictionary *attributes, NSRange range, BOOL *stop) {
+        runCount++;
+    }];
+    self.measuredAttributeRunsTouched += runCount;
+}
+
 -(void)userSelectedBold {
     NSFont *font = [[self typingAttributes] objectForKey:NSFontAttributeName];
     if (!font) {
         font = [NSFont systemFontOfSize:12.0f];
     }
     [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeBold];
-    [self applyFontAttributesToSelectedRangeWithBoldTrait:[NSNumber numberWithBool:![font isBold]] italicTrait:nil fontName:nil fontSize:nil];
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self applyFontAttributesToSelectedRangeWithBoldTrait:[NSNumber numberWithBool:![font isBold]] italicTrait:nil fontName:nil fontSize:nil];
+    }];
     [self sendDelegateTypingAttrsUpdate];
     [self sendDelegateTVChanged];
 }
@@ -428,7 +822,9 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 -(void)userSelectedItalic {
     NSFont *font = [[self typingAttributes] objectForKey:NSFontAttributeName];
     [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeItalic];
-    [self applyFontAttributesToSelectedRangeWithBoldTrait:nil italicTrait:[NSNumber numberWithBool:![font isItalic]] fontName:nil fontSize:nil];
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self applyFontAttributesToSelectedRangeWithBoldTrait:nil italicTrait:[NSNumber numberWithBool:![font isItalic]] fontName:nil fontSize:nil];
+    }];
     [self sendDelegateTypingAttrsUpdate];
     [self sendDelegateTVChanged];
 }
@@ -442,32 +838,40 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
         existingUnderlineStyle = [NSNumber numberWithInteger:NSUnderlineStyleNone];
 	}
     [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeUnderline];
-    [self applyAttributesToSelectedRange:existingUnderlineStyle forKey:NSUnderlineStyleAttributeName];
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self applyAttributesToSelectedRange:existingUnderlineStyle forKey:NSUnderlineStyleAttributeName];
+    }];
     [self sendDelegateTypingAttrsUpdate];
     [self sendDelegateTVChanged];
 }
 
 -(void)userSelectedIncreaseIndent {
     [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeIndentIncrease];
-    [self userSelectedParagraphIndentation:ParagraphIndentationIncrease];
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self userSelectedParagraphIndentation:ParagraphIndentationIncrease];
+    }];
     [self sendDelegateTVChanged];
 }
 
 -(void)userSelectedDecreaseIndent {
     [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeIndentDecrease];
-    [self userSelectedParagraphIndentation:ParagraphIndentationDecrease];
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self userSelectedParagraphIndentation:ParagraphIndentationDecrease];
+    }];
     [self sendDelegateTVChanged];
 }
 
 -(void)userSelectedTextBackgroundColor:(NSColor*)color {
     [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeHighlight];
     NSRange selectedRange = [self selectedRange];
-	if (color) {
-        [self applyAttributesToSelectedRange:color forKey:NSBackgroundColorAttributeName];
-	}
-	else {
-        [self removeAttributeForKeyFromSelectedRange:NSBackgroundColorAttributeName];
-	}
+    [self performUndoableEditInRange:[self undoRangeAroundRange:selectedRange] usingBlock:^{
+        if (color) {
+            [self applyAttributesToSelectedRange:color forKey:NSBackgroundColorAttributeName];
+        }
+        else {
+            [self removeAttributeForKeyFromSelectedRange:NSBackgroundColorAttributeName];
+        }
+    }];
     if (self.shouldEndColorChangeOnLeft) {
         [self setSelectedRange:NSMakeRange(selectedRange.location, 0)];
     }
@@ -479,12 +883,14 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 
 -(void)userSelectedTextColor:(NSColor*)color {
     [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeFontColor];
-    if (color) {
-        [self applyAttributesToSelectedRange:color forKey:NSForegroundColorAttributeName];
-    }
-    else {
-        [self removeAttributeForKeyFromSelectedRange:NSForegroundColorAttributeName];
-    }
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        if (color) {
+            [self applyAttributesToSelectedRange:color forKey:NSForegroundColorAttributeName];
+        }
+        else {
+            [self removeAttributeForKeyFromSelectedRange:NSForegroundColorAttributeName];
+        }
+    }];
     [self sendDelegateTVChanged];
 }
 
@@ -496,6 +902,268 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 	[super setFont:font];
 }
 
+#pragma mark - Large Document Mode -
+
+- (void)setLargeDocumentMode:(BOOL)largeDocumentMode {
+    _largeDocumentMode = largeDocumentMode;
+    self.layoutManager.allowsNonContiguousLayout = largeDocumentMode;
+}
+
+// Rect (in view coordinates) of the line the insertion point is on. Only lays out as far as
+// that line, which with non-contiguous layout is usually just the visible text.
+- (NSRect)insertionPointLineRect {
+    NSLayoutManager *layoutManager = self.layoutManager;
+    NSUInteger location = MIN(NSMaxRange(self.selectedRange), self.textStorage.length);
+    NSRect rect = NSZeroRect;
+    if (location == self.textStorage.length && !NSIsEmptyRect(layoutManager.extraLineFragmentRect)) {
+        rect = layoutManager.extraLineFragmentRect;
+    }
+    else if (self.textStorage.length > 0) {
+        NSUInteger glyphIndex = [layoutManager glyphIndexForCharacterAtIndex:MIN(location, self.textStorage.length - 1)];
+        rect = [layoutManager lineFragmentRectForGlyphAtIndex:glyphIndex effectiveRange:NULL];
+    }
+    NSPoint origin = self.textContainerOrigin;
+    return NSOffsetRect(rect, origin.x, origin.y);
+}
+
+- (void)scrollInsertionPointToVisibleIfNeeded {
+    NSRect lineRect = [self insertionPointLineRect];
+    NSRect visibleRect = self.visibleRect;
+    if (NSIsEmptyRect(visibleRect) ||
+        (NSMinY(lineRect) >= NSMinY(visibleRect) && NSMaxY(lineRect) <= NSMaxY(visibleRect))) {
+        return;
+    }
+    [self scrollRangeToVisible:self.selectedRange];
+}
+
+#pragma mark - Progressive Loading -
+
+- (void)loadHtmlStringProgressively:(NSString *)htmlString progress:(void (^)(double fractionLoaded))progress completion:(void (^)(BOOL finished))completion {
+    NSString *html = [htmlString copy];
+    NSAttributedString *(^removingTrailingNewline)(NSAttributedString *) = ^NSAttributedString *(NSAttributedString *string) {
+        NSMutableAttributedString *attr = [string mutableCopy];
+        if ([attr.string hasSuffix:@"\n"]) { // same as setHtmlString:
+            [attr replaceCharactersInRange:NSMakeRange(attr.length - 1, 1) withString:@""];
+        }
+        return attr;
+    };
+    [self loadProgressivelyFromSource:^NSAttributedString *{
+        return removingTrailingNewline([RichTextEditorHTMLReader attributedStringFromHTMLString:html]);
+    } mainThreadFallback:^NSAttributedString *{
+        return removingTrailingNewline([RichTextEditor cocoaAttributedStringFromHTMLString:html]);
+    } progress:progress completion:completion];
+}
+
+- (void)loadAttributedStringProgressively:(NSAttributedString *)string progress:(void (^)(double fractionLoaded))progress completion:(void (^)(BOOL finished))completion {
+    NSAttributedString *source = [string copy];
+    [self loadProgressivelyFromSource:^NSAttributedString *{
+        return source;
+    } mainThreadFallback:nil progress:progress completion:completion];
+}
+
+- (void)loadProgressivelyFromSource:(NSAttributedString *(^)(void))source mainThreadFallback:(NSAttributedString *(^)(void))mainThreadFallback progress:(void (^)(double fractionLoaded))progress completion:(void (^)(BOOL finished))completion {
+    [self cancelProgressiveLoad];
+    [self.undoJournal removeAllEntries];
+    RichTextEditorProgressiveLoader *loader = [[RichTextEditorProgressiveLoader alloc] initWithTextStorage:self.textStorage];
+    self.progressiveLoader = loader;
+    // Typing into a document that is still being appended to would mix the two
+    self.wasEditableBeforeProgressiveLoad = self.isEditable;
+    self.editable = NO;
+    if (progress) {
+        loader.progressHandler = ^(NSUInteger loadedLength, NSUInteger totalLength) {
+            progress(totalLength > 0 ? (double)loadedLength / totalLength : 1.0);
+        };
+    }
+    __weak RichTextEditor *weakSelf = self;
+    loader.completionHandler = ^(BOOL finished) {
+        [weakSelf finishProgressiveLoad:loader];
+        if (completion) {
+            completion(finished);
+        }
+    };
+    [loader loadFromSource:source mainThreadFallback:mainThreadFallback];
+}
+
+- (void)finishProgressiveLoad:(RichTextEditorProgressiveLoader *)loader {
+    if (self.progressiveLoader != loader) {
+        return;
+    }
+    self.progressiveLoader = nil;
+    self.editable = self.wasEditableBeforeProgressiveLoad;
+    [self resetEditingStateForNewDocument];
+}
+
+- (void)cancelProgressiveLoad {
+    [self.progressiveLoader cancel];
+}
+
+- (BOOL)isLoadingProgressively {
+    return self.progressiveLoader != nil;
+}
+
+// The loader edits the text storage directly, so nothing that tracks typing (bullets, typing
+// attributes, the last replacement) has seen the new text; start it over as commonInitialization does
+- (void)resetEditingStateForNewDocument {
+    self.typingAttributesInProgress = NO;
+    self.isInTextDidChange = NO;
+    self.inBulletedList = NO;
+    self.justDeletedBackward = NO;
+    self.latestReplacementString = @"";
+    self.latestReplacedTextEndsWithNewline = NO;
+    self.previousCursorPosition = 0;
+    self.selectedRange = NSMakeRange(0, 0);
+    [self updateTypingAttributes];
+}
+
+#pragma mark - Attribute Interning -
+
+- (RichTextEditorAttributeInterner *)attributeInterner {
+    // Created on demand because NSTextView sets typing attributes during its own initialization
+    if (!_attributeInterner) {
+        _attributeInterner = [[RichTextEditorAttributeInterner alloc] init];
+    }
+    return _attributeInterner;
+}
+
+// Typed text takes its attributes from here, so they go through the interner like every other
+// attribute the editor applies
+- (void)setTypingAttributes:(NSDictionary<NSString *, id> *)typingAttributes {
+    [super setTypingAttributes:[self.attributeInterner internedAttributes:typingAttributes]];
+}
+
+- (NSUInteger)compactAttributeRuns {
+    return [self.attributeInterner compactRunsInTextStorage:self.textStorage range:NSMakeRange(0, self.textStorage.length)];
+}
+
+- (NSUInteger)attributeRunCount {
+    return [RichTextEditorAttributeInterner runCountOfAttributedString:self.textStorage range:NSMakeRange(0, self.textStorage.length)];
+}
+
+- (NSUInteger)attributeObjectCount {
+    return [RichTextEditorAttributeInterner attributeObjectCountOfAttributedString:self.textStorage range:NSMakeRange(0, self.textStorage.length)];
+}
+
+#pragma mark - Edit Stream -
+
+- (RichTextEditorEditStream *)editStream {
+    // Same as undoJournal: follow the text storage if it gets replaced
+    if (!_editStream || _editStream.textStorage != self.textStorage) {
+        RichTextEditorEditStream *editStream = [[RichTextEditorEditStream alloc] initWithTextStorage:self.textStorage];
+        editStream.handler = _editStream.handler;
+        editStream.includesReplacementText = _editStream ? _editStream.includesReplacementText : YES;
+        _editStream = editStream;
+    }
+    return _editStream;
+}
+
+// Typing and the bullet changes textDidChange: makes because of it go out as one batch
+- (void)beginTypingEditBatch {
+    // NSTextView may have asked about a change but never reported it
+    [self endTypingEditBatch];
+    self.typingEditStream = _editStream;
+    [self.typingEditStream beginBatch];
+}
+
+- (void)endTypingEditBatch {
+    RichTextEditorEditStream *editStream = self.typingEditStream;
+    self.typingEditStream = nil;
+    [editStream endBatch];
+}
+
+#pragma mark - Statistics -
+
+- (RichTextEditorStatistics *)statistics {
+    if (!_statistics || _statistics.textStorage != self.textStorage) {
+        _statistics = [[RichTextEditorStatistics alloc] initWithTextStorage:self.textStorage paragraphIndex:self.paragraphIndex];
+    }
+    NSArray *listMarkers = @[self.BULLET_STRING];
+    if (![_statistics.listMarkers isEqualToArray:listMarkers]) {
+        _statistics.listMarkers = listMarkers;
+    }
+    return _statistics;
+}
+
+#pragma mark - Find & Replace -
+
+- (RichTextEditorFindReplace *)findReplaceMatchingEditorText:(RichTextEditorFindReplace *)findReplace {
+    if (!findReplace.listMarkers) {
+        findReplace.listMarkers = @[self.BULLET_STRING];
+    }
+    return findReplace;
+}
+
+- (NSRange)selectNextMatch:(RichTextEditorFindReplace *)findReplace {
+    [self findReplaceMatchingEditorText:findReplace];
+    NSUInteger length = self.textStorage.length;
+    NSUInteger start = MIN(NSMaxRange(self.selectedRange), length);
+    __block NSRange match = NSMakeRange(NSNotFound, 0);
+    void (^takeFirstMatch)(NSRange, BOOL *) = ^(NSRange matchRange, BOOL *stop) {
+        match = matchRange;
+        *stop = YES;
+    };
+    [findReplace enumerateMatchesInString:self.textStorage range:NSMakeRange(start, length - start) usingBlock:takeFirstMatch];
+    if (match.location == NSNotFound) {
+        [findReplace enumerateMatchesInString:self.textStorage range:NSMakeRange(0, length) usingBlock:takeFirstMatch];
+    }
+    if (match.location != NSNotFound) {
+        self.selectedRange = match;
+        [self scrollRangeToVisible:match];
+    }
+    return match;
+}
+
+- (void)findMatchesInBackground:(RichTextEditorFindReplace *)findReplace
+                   batchHandler:(void (^)(NSArray<NSValue *> *matchRanges))batchHandler
+                     completion:(void (^)(NSUInteger matchCount, BOOL finished))completion {
+    [self.backgroundFindReplace cancelBackgroundSearch];
+    self.backgroundFindReplace = [self findReplaceMatchingEditorText:findReplace];
+    [findReplace findMatchesInBackgroundInString:self.textStorage batchHandler:batchHandler completion:completion];
+}
+
+- (NSUInteger)replaceAllMatches:(RichTextEditorFindReplace *)findReplace withTemplate:(NSString *)replacementTemplate {
+    if (!self.isEditable) {
+        return 0;
+    }
+    [self findReplaceMatchingEditorText:findReplace];
+    [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeFindReplace];
+    NSRange spanRange;
+    NSUInteger replacementCount = 0;
+    NSAttributedString *replacement = [findReplace replacementForMatchesInString:self.textStorage range:NSMakeRange(0, self.textStorage.length)
+                                                                    withTemplate:replacementTemplate spanRange:&spanRange matchCount:&replacementCount];
+    if (!replacement) {
+        return 0;
+    }
+    // Only needed when the undo manager does the undoing; the journal keeps its own copy
+    NSAttributedString *replacedText = (!self.usesUndoJournal && self.allowsUndo && self.undoManager) ? [self.textStorage attributedSubstringFromRange:spanRange] : nil;
+    // The edit goes straight to the text storage: going through shouldChangeTextInRange: once
+    // per match would run the bullet and typing handling for every one of them. Undo only
+    // records the text from the first match to the end of the last one
+    [self performUndoableEditInRange:spanRange usingBlock:^{
+        [self.textStorage beginEditing];
+        [self.textStorage replaceCharactersInRange:spanRange withAttributedString:replacement];
+        [self.textStorage endEditing];
+    }];
+    if (replacedText) {
+        [[self.undoManager prepareWithInvocationTarget:self] replaceCharactersInRange:NSMakeRange(spanRange.location, replacement.length) registeringUndoWithAttributedString:replacedText];
+        [self.undoManager setActionName:[RichTextEditor convertPreviewChangeTypeToString:RichTextEditorPreviewChangeFindReplace withNonSpecialChangeText:YES]];
+    }
+    self.selectedRange = NSMakeRange(MIN(self.selectedRange.location, self.textStorage.length), 0);
+    [self updateTypingAttributes];
+    [self sendDelegateTypingAttrsUpdate];
+    [self sendDelegateTVChanged];
+    return replacementCount;
+}
+
+// Undo and redo of replaceAllMatches:withTemplate: through the undo manager
+- (void)replaceCharactersInRange:(NSRange)range registeringUndoWithAttributedString:(NSAttributedString *)string {
+    NSAttributedString *replacedText = [self.textStorage attributedSubstringFromRange:range];
+    [self.textStorage replaceCharactersInRange:range withAttributedString:string];
+    [[self.undoManager prepareWithInvocationTarget:self] replaceCharactersInRange:NSMakeRange(range.location, string.length) registeringUndoWithAttributedString:replacedText];
+    self.selectedRange = NSMakeRange(range.location, string.length);
+    [self updateTypingAttributes];
+    [self sendDelegateTVChanged];
+}
+
 #pragma mark - Public Methods -
 
 - (void)setHtmlString:(NSString *)htmlString {
@@ -512,21 +1180,95 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
     return [RichTextEditor htmlStringFromAttributedText:self.attributedString];
 }
 
+- (NSData *)binaryDocumentData {
+    return [RichTextEditorBinaryDocument dataWithAttributedString:self.textStorage];
+}
+
+- (BOOL)setBinaryDocumentData:(NSData *)data error:(NSError **)error {
+    RichTextEditorBinaryDocument *document = [[RichTextEditorBinaryDocument alloc] initWithData:data error:error];
+    NSAttributedString *string = [document attributedStringWithError:error];
+    if (!string) {
+        return NO;
+    }
+    [self setAttributedString:string];
+    return YES;
+}
+
+- (BOOL)saveBinaryDocumentToURL:(NSURL *)url error:(NSError **)error {
+    return [RichTextEditorBinaryDocument writeAttributedString:self.textStorage toURL:url error:error];
+}
+
+- (BOOL)loadBinaryDocumentFromURL:(NSURL *)url error:(NSError **)error {
+    RichTextEditorBinaryDocument *document = [[RichTextEditorBinaryDocument alloc] initWithContentsOfURL:url error:error];
+    NSAttributedString *string = [document attributedStringWithError:error];
+    if (!string) {
+        return NO;
+    }
+    [self setAttributedString:string];
+    return YES;
+}
+
+- (RichTextEditorMarkdownWriter *)markdownWriter {
+    RichTextEditorMarkdownWriter *writer = [[RichTextEditorMarkdownWriter alloc] initWithAttributedString:self.textStorage];
+    writer.bulletString = self.BULLET_STRING;
+    writer.bulletIndentation = self.defaultIndentationSize;
+    return writer;
+}
+
+- (NSString *)markdownString {
+    return [[self markdownWriter] markdownString];
+}
+
+- (BOOL)writeMarkdownToFileHandle:(NSFileHandle *)fileHandle error:(NSError **)error {
+    return [[self markdownWriter] writeToFileHandle:fileHandle error:error];
+}
+
+- (void)setMarkdownString:(NSString *)markdownString {
+    RichTextEditorMarkdownReader *reader = [[RichTextEditorMarkdownReader alloc] init];
+    NSFont *font = self.initialTypingAttributes[NSFontAttributeName] ?: self.font;
+    if (font) {
+        reader.font = font;
+    }
+    reader.bulletString = self.BULLET_STRING;
+    reader.bulletIndentation = self.defaultIndentationSize;
+    [reader appendData:[markdownString dataUsingEncoding:NSUTF8StringEncoding]];
+    NSAttributedString *string = [reader finish];
+    if (string) {
+        [self setAttributedString:string];
+    }
+}
+
 - (void)changeToAttributedString:(NSAttributedString*)string {
     [self setAttributedString:string];
 }
 
 +(NSString *)htmlStringFromAttributedText:(NSAttributedString*)text {
-	NSData *data = [text dataFromRange:NSMakeRange(0, text.length)
-                    documentAttributes:
-                        @{NSDocumentTypeDocumentAttribute: NSHTMLTextDocumentType,
-                        NSCharacterEncodingDocumentAttribute: [NSNumber numberWithInt:NSUTF8StringEncoding]}
-                    error:nil];
-	
-	return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+    return [[[RichTextEditorHTMLWriter alloc] initWithAttributedString:text] htmlString];
 }
 
 +(NSAttributedString*)attributedStringFromHTMLString:(NSString *)htmlString {
+    NSAttributedString *str = [RichTextEditorHTMLReader attributedStringFromHTMLString:htmlString];
+    if (str) {
+        return str;
+    }
+    // NSHTMLTextDocumentType uses WebKit, which has to run on the main thread. Waiting for it here
+    // would deadlock any caller the main thread is itself waiting for
+    if (![NSThread isMainThread]) {
+        return nil;
+    }
+    return [self cocoaAttributedStringFromHTMLString:htmlString];
+}
+
++ (void)attributedStringFromHTMLString:(NSString *)htmlString completion:(void (^)(NSAttributedString *attributedString))completion {
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSAttributedString *str = [RichTextEditorHTMLReader attributedStringFromHTMLString:htmlString];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completion(str ? str : [self cocoaAttributedStringFromHTMLString:htmlString]);
+        });
+    });
+}
+
++(NSAttributedString*)cocoaAttributedStringFromHTMLString:(NSString *)htmlString {
     @try {
         NSError *error;
         NSData *data = [htmlString dataUsingEncoding:NSUTF8StringEncoding];
@@ -553,11 +1295,15 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 }
 
 - (void)userChangedToFontSize:(NSNumber*)fontSize {
-	[self applyFontAttributesToSelectedRangeWithBoldTrait:nil italicTrait:nil fontName:nil fontSize:fontSize];
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self applyFontAttributesToSelectedRangeWithBoldTrait:nil italicTrait:nil fontName:nil fontSize:fontSize];
+    }];
 }
 
 - (void)userChangedToFontName:(NSString*)fontName {
-	[self applyFontAttributesToSelectedRangeWithBoldTrait:nil italicTrait:nil fontName:fontName fontSize:nil];
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self applyFontAttributesToSelectedRangeWithBoldTrait:nil italicTrait:nil fontName:fontName fontSize:nil];
+    }];
 }
 
 - (BOOL)isCurrentFontUnderlined {
@@ -581,7 +1327,14 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
                 shouldUseUndoManager = NO;
             }
         }
-        if (shouldUseUndoManager && [[self undoManager] canUndo]) {
+        if (shouldUseUndoManager && self.usesUndoJournal) {
+            RichTextEditorEditStream *editStream = _editStream;
+            [editStream beginBatch];
+            NSRange selectedRange = [self.undoJournal undo];
+            [editStream endBatch];
+            [self restoreSelectionAfterJournalChange:selectedRange];
+        }
+        else if (shouldUseUndoManager && [[self undoManager] canUndo]) {
             [[self undoManager] undo];
         }
     }
@@ -600,7 +1353,14 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
                 shouldUseUndoManager = NO;
             }
         }
-        if (shouldUseUndoManager && [[self undoManager] canRedo])
+        if (shouldUseUndoManager && self.usesUndoJournal) {
+            RichTextEditorEditStream *editStream = _editStream;
+            [editStream beginBatch];
+            NSRange selectedRange = [self.undoJournal redo];
+            [editStream endBatch];
+            [self restoreSelectionAfterJournalChange:selectedRange];
+        }
+        else if (shouldUseUndoManager && [[self undoManager] canRedo])
             [[self undoManager] redo];
     }
     @catch (NSException *e) {
@@ -608,37 +1368,151 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
     }
 }
 
+#pragma mark - Autosave -
+
+- (BOOL)startAutosavingToDirectoryURL:(NSURL *)directoryURL error:(NSError **)error {
+    [self stopAutosaving];
+    // Journals without an intact snapshot can't be replayed; the new autosave replaces them
+    NSAttributedString *recovered = [RichTextEditorAutosave recoveredAttributedStringAtDirectoryURL:directoryURL editCount:NULL error:NULL];
+    if (recovered) {
+        [self setAttributedString:recovered];
+    }
+    RichTextEditorAutosave *autosave = [[RichTextEditorAutosave alloc] initWithTextStorage:self.textStorage directoryURL:directoryURL];
+    if (![autosave startWithError:error]) {
+        return NO;
+    }
+    self.autosave = autosave;
+    return YES;
+}
+
+- (void)stopAutosaving {
+    [self.autosave stop];
+    self.autosave = nil;
+}
+
+#pragma mark - Undo Journal -
+
+- (void)setUsesUndoJournal:(BOOL)usesUndoJournal {
+    _usesUndoJournal = usesUndoJournal;
+    // NSTextView's own undo registration would fight with the journal
+    self.allowsUndo = !usesUndoJournal;
+    self.undoJournal = usesUndoJournal ? [[RichTextEditorUndoJournal alloc] initWithTextStorage:self.textStorage] : nil;
+}
+
+- (RichTextEditorUndoJournal *)undoJournal {
+    // Same as paragraphIndex: follow the text storage if it gets replaced
+    if (_undoJournal && _undoJournal.textStorage != self.textStorage) {
+        RichTextEditorUndoJournal *journal = [[RichTextEditorUndoJournal alloc] initWithTextStorage:self.textStorage];
+        journal.byteBudget = _undoJournal.byteBudget;
+        _undoJournal = journal;
+    }
+    return _undoJournal;
+}
+
+// The part of the text an edit of range may touch: the paragraphs it covers plus the ones on
+// either side, since bullet handling reaches into the neighbouring paragraphs.
+- (NSRange)undoRangeAroundRange:(NSRange)range {
+    RichTextEditorParagraphIndex *paragraphIndex = self.paragraphIndex;
+    NSUInteger length = self.textStorage.length;
+    if (![paragraphIndex isInSync]) {
+        return NSMakeRange(0, length);
+    }
+    NSUInteger firstParagraph = [paragraphIndex paragraphIndexAtLocation:MIN(range.location, length)];
+    NSUInteger lastParagraph = [paragraphIndex paragraphIndexAtLocation:MIN(NSMaxRange(range), length)];
+    if (firstParagraph > 0) {
+        firstParagraph--;
+    }
+    if (lastParagraph + 1 < paragraphIndex.paragraphCount) {
+        lastParagraph++;
+    }
+    NSUInteger start = [paragraphIndex rangeOfParagraphAtIndex:firstParagraph].location;
+    NSUInteger end = MIN(NSMaxRange([paragraphIndex rangeOfParagraphAtIndex:lastParagraph]) + 1, length);
+    return NSMakeRange(start, end - start);
+}
+
+// Records everything block does to the text inside range as a single undo step.
+- (void)performUndoableEditInRange:(NSRange)range usingBlock:(void (^)(void))block {
+    RichTextEditorUndoJournal *journal = self.usesUndoJournal ? self.undoJournal : nil;
+    [journal beginGroupInRange:range selectedRange:self.selectedRange coalescing:NO];
+    RichTextEditorEditStream *editStream = _editStream;
+    [editStream beginBatch];
+    block();
+    [editStream endBatch];
+    [journal endGroupWithSelectedRange:self.selectedRange];
+}
+
+- (void)beginRecordingTypingInRange:(NSRange)range replacementString:(NSString *)replacementString {
+    if (!self.usesUndoJournal) {
+        return;
+    }
+    if (self.isRecordingTyping) {
+        // NSTextView asked about a change but never reported it; close that step first
+        [self endRecordingTyping];
+    }
+    if (self.undoJournal.isGrouping) {
+        return; // part of an editor command that is already being recorded
+    }
+    // Single characters typed or deleted are merged into one undo step; newlines, pastes
+    // and attribute changes (nil replacement string) get a step of their own.
+    BOOL isTyping = replacementString && replacementString.length <= 1 && range.length <= 1 &&
+        ![replacementString isEqualToString:@"\n"];
+    self.isRecordingTyping = YES;
+    [self.undoJournal beginGroupInRange:[self undoRangeAroundRange:range] selectedRange:self.selectedRange coalescing:isTyping];
+}
+
+- (void)endRecordingTyping {
+    if (self.isRecordingTyping) {
+        self.isRecordingTyping = NO;
+        [self.undoJournal endGroupWithSelectedRange:self.selectedRange];
+    }
+}
+
+- (void)restoreSelectionAfterJournalChange:(NSRange)selectedRange {
+    if (selectedRange.location == NSNotFound) {
+        return;
+    }
+    NSUInteger length = self.textStorage.length;
+    selectedRange.location = MIN(selectedRange.location, length);
+    selectedRange.length = MIN(selectedRange.length, length - selectedRange.location);
+    [super setSelectedRange:selectedRange affinity:NSSelectionAffinityDownstream stillSelecting:NO];
+    [self updateTypingAttributes];
+    [self sendDelegateTypingAttrsUpdate];
+    [self sendDelegateTVChanged];
+}
+
+// Edit > Undo/Redo (cmd-Z) come through the responder chain. Only take them when the journal
+// is in use; otherwise they keep going to the window's undo manager as before.
+- (BOOL)respondsToSelector:(SEL)aSelector {
+    if (aSelector == @selector(undo:) || aSelector == @selector(redo:)) {
+        return self.usesUndoJournal;
+    }
+    return [super respondsToSelector:aSelector];
+}
+
+- (IBAction)undo:(id)sender {
+    [self undo];
+}
+
+- (IBAction)redo:(id)sender {
+    [self redo];
+}
+
+- (BOOL)validateMenuItem:(NSMenuItem *)menuItem {
+    if (menuItem.action == @selector(undo:)) {
+        return self.undoJournal.canUndo;
+    }
+    if (menuItem.action == @selector(redo:)) {
+        return self.undoJournal.canRedo;
+    }
+    return [super validateMenuItem:menuItem];
+}
+
 - (void)userSelectedParagraphIndentation:(ParagraphIndentation)paragraphIndentation {
     self.isInTextDidChange = YES;
-    __block NSDictionary *dictionary;
-    __block NSMutableParagraphStyle *paragraphStyle;
     NSRange currSelectedRange = self.selectedRange;
-	[self enumarateThroughParagraphsInRange:self.selectedRange withBlock:^(NSRange paragraphRange){
-        dictionary = [self dictionaryAtIndex:paragraphRange.location];
-        paragraphStyle = [[dictionary objectForKey:NSParagraphStyleAttributeName] mutableCopy];
-        if (!paragraphStyle) {
-			paragraphStyle = [[NSMutableParagraphStyle alloc] init];
-        }
-
-		if (paragraphIndentation == ParagraphIndentationIncrease &&
-            paragraphStyle.headIndent < self.MAX_INDENT && paragraphStyle.firstLineHeadIndent < self.MAX_INDENT) {
-			paragraphStyle.headIndent += self.defaultIndentationSize;
-			paragraphStyle.firstLineHeadIndent += self.defaultIndentationSize;
-		}
-		else if (paragraphIndentation == ParagraphIndentationDecrease) {
-			paragraphStyle.headIndent -= self.defaultIndentationSize;
-			paragraphStyle.firstLineHeadIndent -= self.defaultIndentationSize;
-			
-            if (paragraphStyle.headIndent < 0) {
-				paragraphStyle.headIndent = 0; // this is the right cursor placement
-            }
-
-            if (paragraphStyle.firstLineHeadIndent < 0) {
-				paragraphStyle.firstLineHeadIndent = 0; // this affects left cursor placement
-            }
-		}
-		[self applyAttributes:paragraphStyle forKey:NSParagraphStyleAttributeName atRange:paragraphRange];
-    }];
+    NSArray *paragraphRanges = [self.paragraphIndex rangeOfParagraphsFromTextRange:currSelectedRange];
+    RichTextEditorParagraphBatch *batch = [[self documentForCommand] paragraphBatchChangingIndentation:paragraphIndentation ofParagraphs:paragraphRanges];
+    [self applyParagraphBatch:batch updatingTypingAttributes:YES];
     [self setSelectedRange:currSelectedRange];
     self.isInTextDidChange = NO;
     // Old iOS code
@@ -649,7 +1523,7 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
     
     // After NSTextStorage changes, these don't seem necessary
    /* NSRange rangeOfCurrentParagraph = [self.attributedString firstParagraphRangeFromTextRange:self.selectedRange];
-	BOOL currParagraphIsBlank = [[self.string substringWithRange:rangeOfCurrentParagraph] isEqualToString:@""] ? YES: NO;
+	BOOL currParagraphIsBlank = rangeOfCurrentParagraph.length == 0;
     if (currParagraphIsBlank)
     {
        // [self setIndentationWithAttributes:dictionary paragraphStyle:paragraphStyle atRange:rangeOfCurrentParagraph];
@@ -672,42 +1546,48 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 }
 
 - (void)userSelectedParagraphFirstLineHeadIndent {
-	[self enumarateThroughParagraphsInRange:self.selectedRange withBlock:^(NSRange paragraphRange){
-		NSDictionary *dictionary = [self dictionaryAtIndex:paragraphRange.location];
-		NSMutableParagraphStyle *paragraphStyle = [[dictionary objectForKey:NSParagraphStyleAttributeName] mutableCopy];
-		
-        if (!paragraphStyle) {
-			paragraphStyle = [[NSMutableParagraphStyle alloc] init];
-        }
-		
-		if (paragraphStyle.headIndent == paragraphStyle.firstLineHeadIndent) {
-			paragraphStyle.firstLineHeadIndent += self.defaultIndentationSize;
-		}
-		else {
-			paragraphStyle.firstLineHeadIndent = paragraphStyle.headIndent;
-		}
-		
-		[self applyAttributes:paragraphStyle forKey:NSParagraphStyleAttributeName atRange:paragraphRange];
-	}];
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self toggleFirstLineHeadIndentOfSelectedParagraphs];
+    }];
+}
+
+- (void)toggleFirstLineHeadIndentOfSelectedParagraphs {
+    NSArray *paragraphRanges = [self.paragraphIndex rangeOfParagraphsFromTextRange:self.selectedRange];
+    RichTextEditorParagraphBatch *batch = [[self documentForCommand] paragraphBatchTogglingFirstLineHeadIndentOfParagraphs:paragraphRanges];
+    [self applyParagraphBatch:batch updatingTypingAttributes:YES];
+    [self selectFullRangeOfParagraphRanges:paragraphRanges];
 }
 
 - (void)userSelectedTextAlignment:(NSTextAlignment)textAlignment {
-	[self enumarateThroughParagraphsInRange:self.selectedRange withBlock:^(NSRange paragraphRange){
-		NSDictionary *dictionary = [self dictionaryAtIndex:paragraphRange.location];
-		NSMutableParagraphStyle *paragraphStyle = [[dictionary objectForKey:NSParagraphStyleAttributeName] mutableCopy];
-		
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self applyTextAlignmentToSelectedParagraphs:textAlignment];
+    }];
+}
+
+- (void)applyTextAlignmentToSelectedParagraphs:(NSTextAlignment)textAlignment {
+    NSArray *paragraphRanges = [self.paragraphIndex rangeOfParagraphsFromTextRange:self.selectedRange];
+    NSMutableArray<NSDictionary *> *dictionaries = [NSMutableArray arrayWithCapacity:paragraphRanges.count];
+    for (NSValue *paragraphRangeValue in paragraphRanges) {
+        [dictionaries addObject:[self dictionaryAtIndex:[paragraphRangeValue rangeValue].location]];
+    }
+    RichTextEditorParagraphBatch *batch = [[self documentForCommand] paragraphBatchSettingTextAlignment:textAlignment ofParagraphs:paragraphRanges];
+    [self applyParagraphBatch:batch updatingTypingAttributes:YES];
+    // The cursor placement hack runs for every paragraph, as it did before the batch. It inserts
+    // and removes a character, so the paragraph ranges stay valid
+    for (NSUInteger i = 0; i < paragraphRanges.count; i++) {
+        NSMutableParagraphStyle *paragraphStyle = [dictionaries[i][NSParagraphStyleAttributeName] mutableCopy];
         if (!paragraphStyle) {
-			paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+            paragraphStyle = [[NSMutableParagraphStyle alloc] init];
         }
-		
-		paragraphStyle.alignment = textAlignment;
-		
-		[self applyAttributes:paragraphStyle forKey:NSParagraphStyleAttributeName atRange:paragraphRange];
-        [self setIndentationWithAttributes:dictionary paragraphStyle:paragraphStyle atRange:paragraphRange];
-	}];
+        paragraphStyle.alignment = textAlignment;
+        [self setIndentationWithAttributes:dictionaries[i] paragraphStyle:paragraphStyle atRange:[paragraphRanges[i] rangeValue]];
+    }
+    [self selectFullRangeOfParagraphRanges:paragraphRanges];
 }
 
 -(void)setAttributedString:(NSAttributedString*)attributedString {
+    [self cancelProgressiveLoad];
+    [self.undoJournal removeAllEntries]; // a new document starts a new history
     [self.textStorage setAttributedString:attributedString];
 }
 
@@ -717,91 +1597,23 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
     if (!self.isEditable) {
         return;
     }
+    [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+        [self toggleBulletsOfSelectedParagraphs];
+    }];
+}
+
+- (void)toggleBulletsOfSelectedParagraphs {
     [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeBullet];
+    BOOL shouldNotifyDelegate = !self.isInTextDidChange;
 	NSRange initialSelectedRange = self.selectedRange;
-	NSArray *rangeOfParagraphsInSelectedText = [self.attributedString rangeOfParagraphsFromTextRange:self.selectedRange];
-	NSRange rangeOfCurrentParagraph = [self.attributedString firstParagraphRangeFromTextRange:self.selectedRange];
-	BOOL firstParagraphHasBullet = [[self.string substringFromIndex:rangeOfCurrentParagraph.location] hasPrefix:self.BULLET_STRING];
-    
-    NSRange rangeOfPreviousParagraph = [self.attributedString firstParagraphRangeFromTextRange:NSMakeRange(rangeOfCurrentParagraph.location-1, 0)];
-    NSDictionary *prevParaDict = [self dictionaryAtIndex:rangeOfPreviousParagraph.location];
-    NSMutableParagraphStyle *prevParaStyle = [prevParaDict objectForKey:NSParagraphStyleAttributeName];
-	
-	__block NSInteger rangeOffset = 0;
-    __block BOOL mustDecreaseIndentAfterRemovingBullet = NO;
-    __block BOOL isInBulletedList = self.inBulletedList;
-	[self enumarateThroughParagraphsInRange:self.selectedRange withBlock:^(NSRange paragraphRange){
-		NSRange range = NSMakeRange(paragraphRange.location + rangeOffset, paragraphRange.length);
-		NSDictionary *dictionary = [self dictionaryAtIndex:MAX((int)range.location-1, 0)];
-		NSMutableParagraphStyle *paragraphStyle = [[dictionary objectForKey:NSParagraphStyleAttributeName] mutableCopy];
-		
-        if (!paragraphStyle) {
-			paragraphStyle = [[NSMutableParagraphStyle alloc] init];
-        }
-		
-		BOOL currentParagraphHasBullet = [[self.string substringFromIndex:range.location] hasPrefix:self.BULLET_STRING];
-		
-        if (firstParagraphHasBullet != currentParagraphHasBullet) {
-			return;
-        }
-		if (currentParagraphHasBullet) {
-            // User hit the bullet button and is in a bulleted list so we should get rid of the bullet
-			range = NSMakeRange(range.location, range.length - self.BULLET_STRING.length);
-            
-            [self.textStorage deleteCharactersInRange:NSMakeRange(range.location, self.BULLET_STRING.length)];
-			
-			paragraphStyle.firstLineHeadIndent = 0;
-			paragraphStyle.headIndent = 0;
-			
-			rangeOffset = rangeOffset - self.BULLET_STRING.length;
-            mustDecreaseIndentAfterRemovingBullet = YES;
-            isInBulletedList = NO;
-		}
-		else {
-            // We are adding a bullet
-			range = NSMakeRange(range.location, range.length + self.BULLET_STRING.length);
-			
-			NSMutableAttributedString *bulletAttributedString = [[NSMutableAttributedString alloc] initWithString:self.BULLET_STRING attributes:nil];
-            // The following code attempts to remove any underline from the bullet string, but it doesn't work right. I don't know why.
-          /*  NSFont *prevFont = [dictionary objectForKey:NSFontAttributeName];
-            NSFont *bulletFont = [NSFont fontWithName:[prevFont familyName] size:[prevFont pointSize]];
-            
-            NSMutableDictionary *bulletDict = [dictionary mutableCopy];
-            [bulletDict setObject:bulletFont forKey:NSFontAttributeName];
-            [bulletDict removeObjectForKey:NSStrikethroughStyleAttributeName];
-            [bulletDict setValue:NSUnderlineStyleNone forKey:NSUnderlineStyleAttributeName];
-            [bulletDict removeObjectForKey:NSStrokeColorAttributeName];
-            [bulletDict removeObjectForKey:NSStrokeWidthAttributeName];
-            dictionary = bulletDict;*/
-            
-            [bulletAttributedString setAttributes:dictionary range:NSMakeRange(0, self.BULLET_STRING.length)];
-			
-            [self.textStorage insertAttributedString:bulletAttributedString atIndex:range.location];
-			
-			CGSize expectedStringSize = [self.BULLET_STRING sizeWithAttributes:dictionary];
-            
-            // See if the previous paragraph has a bullet
-            NSString *previousParagraph = [self.string substringWithRange:rangeOfPreviousParagraph];
-            BOOL doesPrefixWithBullet = [previousParagraph hasPrefix:self.BULLET_STRING];
-            
-            // Look at the previous paragraph to see what the firstLineHeadIndent should be for the
-            // current bullet
-            // if the previous paragraph has a bullet, use that paragraph's indent
-            // if not, then use defaultIndentation size
-            if (!doesPrefixWithBullet) {
-                paragraphStyle.firstLineHeadIndent = self.defaultIndentationSize;
-            }
-            else {
-                paragraphStyle.firstLineHeadIndent = prevParaStyle.firstLineHeadIndent;
-            }
-            
-			paragraphStyle.headIndent = expectedStringSize.width + paragraphStyle.firstLineHeadIndent;
-			
-			rangeOffset = rangeOffset + self.BULLET_STRING.length;
-            isInBulletedList = YES;
-		}
-        [self.textStorage addAttribute:NSParagraphStyleAttributeName value:paragraphStyle range:range];
-	}];
+	NSArray *rangeOfParagraphsInSelectedText = [self.paragraphIndex rangeOfParagraphsFromTextRange:self.selectedRange];
+	NSRange rangeOfCurrentParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:self.selectedRange];
+    // Plan every paragraph first, then apply them all in one text storage transaction
+    BOOL isRemovingBullets = [self hasBulletAtLocation:rangeOfCurrentParagraph.location];
+    BOOL isInBulletedList = !isRemovingBullets;
+    RichTextEditorParagraphBatch *batch = [[self documentForCommand] paragraphBatchTogglingBulletsOfParagraphs:rangeOfParagraphsInSelectedText];
+    [self applyParagraphBatch:batch updatingTypingAttributes:isRemovingBullets];
+    NSInteger rangeOffset = batch.changeInLength;
 	
 	// If paragraph is empty move cursor to front of bullet, so the user can start typing right away
     NSRange rangeForSelection;
@@ -816,51 +1628,68 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 			NSRange fullRange = [self fullRangeFromArrayOfParagraphRanges:rangeOfParagraphsInSelectedText];
             rangeForSelection = NSMakeRange(fullRange.location, fullRange.length+rangeOffset);
 		}
-    }
-    if (mustDecreaseIndentAfterRemovingBullet) {
-        // remove the extra indentation added by the bullet
-        [self userSelectedParagraphIndentation:ParagraphIndentationDecrease];
     }
 	self.selectedRange = rangeForSelection;
     
-    if (!self.isInTextDidChange) {
+    if (shouldNotifyDelegate) {
         [self sendDelegateTVChanged];
     }
 }
 
 // modified from https://stackoverflow.com/a/4833778/3938401
 - (void)changeToFont:(NSFont*)font {
-    NSTextStorage *textStorage = self.textStorage;
-    [textStorage beginEditing];
-    [textStorage enumerateAttributesInRange: NSMakeRange(0, textStorage.length)
-                                    options: 0
-                                 usingBlock: ^(NSDictionary *attributesDictionary,
-                                               NSRange range,
-                                               BOOL *stop) {
-         NSFont *currFont = [attributesDictionary objectForKey:NSFontAttributeName];
-         if (currFont) {
-             NSFont *fontToChangeTo = [font fontWithBoldTrait:currFont.isBold andItalicTrait:currFont.isItalic];
-             if (fontToChangeTo) {
-                 [textStorage removeAttribute:NSFontAttributeName range:range];
-                 [textStorage addAttribute:NSFontAttributeName value:fontToChangeTo range:range];
-             }
-         }
-     }];
-    [textStorage endEditing];
+    [self performUndoableEditInRange:NSMakeRange(0, self.textStorage.length) usingBlock:^{
+        [self applyFontToAllText:font];
+    }];
+}
+
+- (void)applyFontToAllText:(NSFont*)font {
+    RichTextEditorStyleTransform *transform = [self.document styleTransformChangingFontFamilyTo:font inRange:NSMakeRange(0, self.textStorage.length)];
+    [transform applyToTextStorage:self.textStorage];
 }
 
 #pragma mark - Private Methods -
 
-- (void)enumarateThroughParagraphsInRange:(NSRange)range withBlock:(void (^)(NSRange paragraphRange))block{
-	NSArray *rangeOfParagraphsInSelectedText = [self.attributedString rangeOfParagraphsFromTextRange:self.selectedRange];
-	
-	for (int i = 0; i < rangeOfParagraphsInSelectedText.count; i++) {
-		NSValue *value = rangeOfParagraphsInSelectedText[i];
-		NSRange paragraphRange = [value rangeValue];
-		block(paragraphRange);
-	}
-    rangeOfParagraphsInSelectedText = [self.attributedString rangeOfParagraphsFromTextRange:self.selectedRange];
-	NSRange fullRange = [self fullRangeFromArrayOfParagraphRanges:rangeOfParagraphsInSelectedText];
+- (BOOL)hasBulletAtLocation:(NSUInteger)location {
+    return [self.document hasBulletAtLocation:location];
+}
+
+- (BOOL)isEmptyBulletParagraph:(NSRange)paragraphRange {
+    return paragraphRange.length == self.BULLET_STRING.length && [self hasBulletAtLocation:paragraphRange.location];
+}
+
+- (BOOL)paragraph:(NSRange)paragraphRange hasSuffix:(NSString *)suffix {
+    if (paragraphRange.length < suffix.length) {
+        return NO;
+    }
+    NSRange suffixRange = NSMakeRange(NSMaxRange(paragraphRange) - suffix.length, suffix.length);
+    return [self.string rangeOfString:suffix options:NSLiteralSearch | NSAnchoredSearch range:suffixRange].location != NSNotFound;
+}
+
+// Applies the batch (one text storage transaction) and then brings the typing attributes
+// up to date once, rather than once per paragraph.
+- (void)applyParagraphBatch:(RichTextEditorParagraphBatch *)batch updatingTypingAttributes:(BOOL)updateTypingAttributes {
+    NSRange affectedRange = batch.affectedRange;
+    [batch apply];
+    if (self.largeDocumentMode && affectedRange.location != NSNotFound) {
+        // The edit already invalidated the layout of just these paragraphs; redraw only them
+        // rather than waiting for the selection change to relayout the view
+        [self.layoutManager invalidateDisplayForCharacterRange:NSMakeRange(affectedRange.location, MIN(NSMaxRange(affectedRange) + 1, self.textStorage.length) - affectedRange.location)];
+    }
+    if (updateTypingAttributes) {
+        if (batch.styledNonEmptyParagraph) {
+            [self updateTypingAttributes];
+        }
+        if (batch.lastEmptyParagraphStyle) {
+            // Empty paragraphs can't hold a paragraph style, so use it for whatever gets typed next
+            self.typingAttributesInProgress = YES;
+            [self applyAttributeToTypingAttribute:batch.lastEmptyParagraphStyle forKey:NSParagraphStyleAttributeName];
+        }
+    }
+}
+
+- (void)selectFullRangeOfParagraphRanges:(NSArray *)paragraphRanges {
+	NSRange fullRange = [self fullRangeFromArrayOfParagraphRanges:paragraphRanges];
     if (fullRange.location + fullRange.length > [self.attributedString length]) {
         fullRange.length = 0;
         fullRange.location = [self.attributedString length]-1;
@@ -927,7 +1756,7 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
             ++range.length;
         }
         
-        [self.textStorage addAttributes:[NSDictionary dictionaryWithObject:attribute forKey:key] range:range];
+        [self.textStorage addAttributes:[NSDictionary dictionaryWithObject:[self.attributeInterner internedValue:attribute] forKey:key] range:range];
         
         // Have to update typing attributes because the selection won't change after these attributes have changed.
         [self updateTypingAttributes];
@@ -960,22 +1789,8 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 - (void)applyFontAttributesWithBoldTrait:(NSNumber *)isBold italicTrait:(NSNumber *)isItalic fontName:(NSString *)fontName fontSize:(NSNumber *)fontSize toTextAtRange:(NSRange)range {
 	// If any text selected apply attributes to text
 	if (range.length > 0) {
-        [self.textStorage beginEditing];
-		[self.textStorage enumerateAttributesInRange:range
-											 options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
-										  usingBlock:^(NSDictionary *dictionary, NSRange range, BOOL *stop){
-											  
-											  NSFont *newFont = [self fontwithBoldTrait:isBold
-																			italicTrait:isItalic
-																			   fontName:fontName
-																			   fontSize:fontSize
-																		 fromDictionary:dictionary];
-											  
-                                              if (newFont) {
-                                                  [self.textStorage addAttributes:[NSDictionary dictionaryWithObject:newFont forKey:NSFontAttributeName] range:range];
-                                              }
-										  }];
-        [self.textStorage endEditing];
+        RichTextEditorStyleTransform *transform = [self.document styleTransformWithBoldTrait:isBold italicTrait:isItalic fontName:fontName fontSize:fontSize inRange:range];
+        [transform applyToTextStorage:self.textStorage];
         [self setSelectedRange:range];
         [self updateTypingAttributes];
 	}
@@ -999,36 +1814,12 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 
 // By default, if this function is called with nothing selected, it will resize all text.
 -(void)changeFontSizeWithOperation:(CGFloat(^)(CGFloat currFontSize))operation {
-    [self.textStorage beginEditing];
     NSRange range = self.selectedRange;
     if (range.length == 0) {
         range = NSMakeRange(0, self.textStorage.length);
     }
-    [self.textStorage enumerateAttributesInRange:range
-                                         options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
-                                      usingBlock:^(NSDictionary *dictionary, NSRange range, BOOL *stop){
-                                          // Get current font size
-                                          NSFont *currFont = [dictionary objectForKey:NSFontAttributeName];
-                                          if (currFont) {
-                                              CGFloat currFontSize = currFont.pointSize;
-                                              
-                                              CGFloat nextFontSize = operation(currFontSize);
-                                              if ((currFontSize < nextFontSize && nextFontSize <= self.maxFontSize) || // sizing up
-                                                  (currFontSize > nextFontSize && self.minFontSize <= nextFontSize)) { // sizing down
-                                              
-                                                  NSFont *newFont = [self fontwithBoldTrait:[NSNumber numberWithBool:[currFont isBold]]
-                                                                                italicTrait:[NSNumber numberWithBool:[currFont isItalic]]
-                                                                                   fontName:currFont.fontName
-                                                                                   fontSize:[NSNumber numberWithFloat:nextFontSize]
-                                                                             fromDictionary:dictionary];
-                                                  
-                                                  if (newFont) {
-                                                      [self.textStorage addAttributes:[NSDictionary dictionaryWithObject:newFont forKey:NSFontAttributeName] range:range];
-                                                  }
-                                              }
-                                          }
-                                      }];
-    [self.textStorage endEditing];
+    RichTextEditorStyleTransform *transform = [self.document styleTransformChangingFontSizeInRange:range operation:operation];
+    [transform applyToTextStorage:self.textStorage];
     [self updateTypingAttributes];
 }
 
@@ -1045,8 +1836,10 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
         self.typingAttributes = typingAttributes;
     }
     else {
-        [self changeFontSizeWithOperation:^CGFloat (CGFloat currFontSize) {
-            return currFontSize - self.fontSizeChangeAmount;
+        [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+            [self changeFontSizeWithOperation:^CGFloat (CGFloat currFontSize) {
+                return currFontSize - self.fontSizeChangeAmount;
+            }];
         }];
         [self sendDelegateTVChanged]; // only send if the actual text changes -- if no text selected, no text has actually changed
     }
@@ -1066,8 +1859,10 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
         self.typingAttributes = typingAttributes;
     }
     else {
-        [self changeFontSizeWithOperation:^CGFloat (CGFloat currFontSize) {
-            return currFontSize + self.fontSizeChangeAmount;
+        [self performUndoableEditInRange:[self undoRangeAroundRange:self.selectedRange] usingBlock:^{
+            [self changeFontSizeWithOperation:^CGFloat (CGFloat currFontSize) {
+                return currFontSize + self.fontSizeChangeAmount;
+            }];
         }];
         [self sendDelegateTVChanged]; // only send if the actual text changes -- if no text selected, no text has actually changed
     }
@@ -1077,20 +1872,11 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 // In other words, this function has logical errors
 // Returns a font with given attributes. For any missing parameter takes the attribute from a given dictionary
 - (NSFont *)fontwithBoldTrait:(NSNumber *)isBold italicTrait:(NSNumber *)isItalic fontName:(NSString *)fontName fontSize:(NSNumber *)fontSize fromDictionary:(NSDictionary *)dictionary {
-	NSFont *newFont = nil;
-	NSFont *font = [dictionary objectForKey:NSFontAttributeName];
-	BOOL newBold = (isBold) ? isBold.intValue : [font isBold];
-	BOOL newItalic = (isItalic) ? isItalic.intValue : [font isItalic];
-	CGFloat newFontSize = (fontSize) ? fontSize.floatValue : font.pointSize;
-	
-	if (fontName) {
-		newFont = [NSFont fontWithName:fontName size:newFontSize boldTrait:newBold italicTrait:newItalic];
-	}
-	else {
-		newFont = [font fontWithBoldTrait:newBold italicTrait:newItalic andSize:newFontSize];
-	}
-	
-	return newFont;
+	return [self fontwithBoldTrait:isBold italicTrait:isItalic fontName:fontName fontSize:fontSize fromFont:[dictionary objectForKey:NSFontAttributeName]];
+}
+
+- (NSFont *)fontwithBoldTrait:(NSNumber *)isBold italicTrait:(NSNumber *)isItalic fontName:(NSString *)fontName fontSize:(NSNumber *)fontSize fromFont:(NSFont *)font {
+    return [self.document fontWithBoldTrait:isBold italicTrait:isItalic fontName:fontName fontSize:fontSize fromFont:font];
 }
 
 /**
@@ -1111,7 +1897,7 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
         return finalRange;
     }
     
-    BOOL currentParagraphHasBulletInFront = [[self.string substringFromIndex:begin] hasPrefix:self.BULLET_STRING];
+    BOOL currentParagraphHasBulletInFront = [self hasBulletAtLocation:begin];
     if (currentParagraphHasBulletInFront) {
         if (!isMouseClick && (current == begin + 1)) { // select bullet point when using keyboard arrow keys
             if (previousRange.location > current) {
@@ -1141,10 +1927,12 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
         // to avoid future crashes.
         return NSMakeRange(self.string.length, 0);
     }
-    NSRange endingStringRange = [[self.string substringWithRange:currentRange] rangeOfString:@"\n\u2022" options:NSBackwardsSearch];
     NSUInteger currentRangeAddedProperties = currentRange.location + currentRange.length;
     NSUInteger previousRangeAddedProperties = previousRange.location + previousRange.length;
-    BOOL currentParagraphHasBulletAtTheEnd = (endingStringRange.length + endingStringRange.location + currentRange.location) == currentRangeAddedProperties;
+    // Does the selection end with a newline followed by a bullet?
+    BOOL currentParagraphHasBulletAtTheEnd = currentRange.length >= 2 &&
+        [self.string characterAtIndex:currentRangeAddedProperties - 2] == '\n' &&
+        [self.string characterAtIndex:currentRangeAddedProperties - 1] == 0x2022;
     if (currentParagraphHasBulletAtTheEnd) {
         if (isMouseClick) {
             if (previousRange.length > current) {
@@ -1169,19 +1957,17 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 }
 
 - (void)applyBulletListIfApplicable {
-	NSRange rangeOfCurrentParagraph = [self.attributedString firstParagraphRangeFromTextRange:self.selectedRange];
+	NSRange rangeOfCurrentParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:self.selectedRange];
     if (rangeOfCurrentParagraph.location == 0) {
         return; // there isn't a previous paragraph, so forget it. The user isn't in a bulleted list.
     }
-	NSRange rangeOfPreviousParagraph = [self.attributedString firstParagraphRangeFromTextRange:NSMakeRange(rangeOfCurrentParagraph.location - 1, 0)];
+	NSRange rangeOfPreviousParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:NSMakeRange(rangeOfCurrentParagraph.location - 1, 0)];
     //self.replacementString
-    BOOL previousParagraphHasBullet = [[self.string
-                                        substringFromIndex:rangeOfPreviousParagraph.location] hasPrefix:self.BULLET_STRING];
+    BOOL previousParagraphHasBullet = [self hasBulletAtLocation:rangeOfPreviousParagraph.location];
     if (!self.inBulletedList) { // fixes issue with backspacing into bullet list adding a bullet
         //NSLog(@"[RTE] NOT in a bulleted list.");
-		BOOL currentParagraphHasBullet = [[self.string substringFromIndex:rangeOfCurrentParagraph.location]
-                                           hasPrefix:self.BULLET_STRING];
-        BOOL isCurrParaBlank = [[self.string substringWithRange:rangeOfCurrentParagraph] isEqualToString:@""];
+		BOOL currentParagraphHasBullet = [self hasBulletAtLocation:rangeOfCurrentParagraph.location];
+        BOOL isCurrParaBlank = rangeOfCurrentParagraph.length == 0;
         // if we don't check to see if the current paragraph is blank, bad bugs happen with
         // the current paragraph where the selected range doesn't let the user type O_o
         if (previousParagraphHasBullet && !currentParagraphHasBullet && isCurrParaBlank) {
@@ -1207,13 +1993,13 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
     if (rangeOfCurrentParagraph.length != 0 && !(previousParagraphHasBullet && [self.latestReplacementString isEqualToString:@"\n"])) {
 		return;
     }
-    if (!self.justDeletedBackward && [[self.string substringFromIndex:rangeOfPreviousParagraph.location] hasPrefix:self.BULLET_STRING]) {
+    if (!self.justDeletedBackward && previousParagraphHasBullet) {
         [self userSelectedBullet];
     }
 }
 
 - (void)removeBulletIndentation:(NSRange)firstParagraphRange {
-    NSRange rangeOfParagraph = [self.attributedString firstParagraphRangeFromTextRange:firstParagraphRange];
+    NSRange rangeOfParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:firstParagraphRange];
     NSDictionary *dictionary = [self dictionaryAtIndex:rangeOfParagraph.location];
     NSMutableParagraphStyle *paragraphStyle = [[dictionary objectForKey:NSParagraphStyleAttributeName] mutableCopy];
     paragraphStyle.firstLineHeadIndent = 0;
@@ -1233,9 +2019,10 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
         }
         //else return;
         NSUInteger checkStringLength = [checkString length];
-        if (![self.string isEqualToString:self.BULLET_STRING]) {
+        if (![self isEmptyBulletParagraph:NSMakeRange(0, self.string.length)]) {
             if (((int)(range.location-checkStringLength) >= 0 &&
-                 [[self.string substringFromIndex:range.location-checkStringLength] hasPrefix:checkString])) {
+                 [self.string rangeOfString:checkString options:NSLiteralSearch | NSAnchoredSearch
+                                      range:NSMakeRange(range.location-checkStringLength, checkStringLength)].location != NSNotFound)) {
                 [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeBullet];
                 //NSLog(@"[RTE] Getting rid of a bullet due to backspace while in empty bullet paragraph.");
                 // Get rid of bullet string
@@ -1248,16 +2035,15 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
             }
             else {
                 // User may be needing to get out of a bulleted list due to hitting enter (return)
-                NSRange rangeOfCurrentParagraph = [self.attributedString firstParagraphRangeFromTextRange:self.selectedRange];
-                NSString *currentParagraphString = [self.string substringWithRange:rangeOfCurrentParagraph];
+                NSRange rangeOfCurrentParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:self.selectedRange];
                 NSInteger prevParaLocation = rangeOfCurrentParagraph.location-1;
-                // [currentParagraphString isEqualToString:self.BULLET_STRING] ==> "is the current paragraph an empty bulleted list item?"
-                if (prevParaLocation >= 0 && [currentParagraphString isEqualToString:self.BULLET_STRING]) {
-                    NSRange rangeOfPreviousParagraph = [self.attributedString firstParagraphRangeFromTextRange:NSMakeRange(rangeOfCurrentParagraph.location-1, 0)];
+                // isEmptyBulletParagraph: ==> "is the current paragraph an empty bulleted list item?"
+                if (prevParaLocation >= 0 && [self isEmptyBulletParagraph:rangeOfCurrentParagraph]) {
+                    NSRange rangeOfPreviousParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:NSMakeRange(rangeOfCurrentParagraph.location-1, 0)];
                     // If the following if statement is true, the user hit enter on a blank bullet list
                     // Basically, there is now a bullet ' ' \n bullet ' ' that we need to delete (' ' == space)
                     // Since it gets here AFTER it adds a new bullet
-                    if ([[self.string substringWithRange:rangeOfPreviousParagraph] hasSuffix:self.BULLET_STRING]) {
+                    if ([self paragraph:rangeOfPreviousParagraph hasSuffix:self.BULLET_STRING]) {
                         [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeBullet];
                         //NSLog(@"[RTE] Getting rid of bullets due to user hitting enter.");
                         NSRange rangeToDelete = NSMakeRange(rangeOfPreviousParagraph.location, rangeOfPreviousParagraph.length+rangeOfCurrentParagraph.length+1);
@@ -1341,70 +2127,115 @@ typedef NS_ENUM(NSInteger, ParagraphIndentation) {
 
 #pragma mark - Keyboard Shortcuts
 
+- (id<RichTextEditorDataSource>)rteDataSource {
+    return _rteDataSource;
+}
+
+- (void)setRteDataSource:(id<RichTextEditorDataSource>)rteDataSource {
+    _rteDataSource = rteDataSource;
+    [self reloadKeyBindings];
+}
+
+- (id<RichTextEditorDelegate>)rteDelegate {
+    return _rteDelegate;
+}
+
+- (void)setRteDelegate:(id<RichTextEditorDelegate>)rteDelegate {
+    _rteDelegate = rteDelegate;
+    _rteDelegateHandlesKeyDown = [rteDelegate respondsToSelector:@selector(richTextEditor:keyDownEvent:)];
+    _rteDelegateHandlesChangeAboutToOccur = [rteDelegate respondsToSelector:@selector(richTextEditor:changeAboutToOccurOfType:)];
+}
+
+- (void)setKeyBindings:(RichTextEditorKeyBindings *)keyBindings {
+    _keyBindings = [keyBindings copy];
+    [self reloadKeyBindings];
+}
+
+- (void)reloadKeyBindings {
+    RichTextEditorShortcut enabledShortcuts = RichTextEditorShortcutAll;
+    if (self.rteDataSource && [self.rteDataSource respondsToSelector:@selector(enabledKeyboardShortcuts)]) {
+        enabledShortcuts = [self.rteDataSource enabledKeyboardShortcuts];
+    }
+    self.keyBindings.enabledShortcuts = enabledShortcuts;
+}
+
++ (RichTextEditorKeyBindings *)defaultKeyBindings {
+    RichTextEditorKeyBindings *keyBindings = [[RichTextEditorKeyBindings alloc] init];
+    // Control and option are ignored, as they always have been for the editor's shortcuts
+    NSEventModifierFlags ignored = NSControlKeyMask | NSAlternateKeyMask;
+    [keyBindings bindKey:@"b" modifierFlags:NSCommandKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutBold command:^BOOL(RichTextEditor *editor) {
+        [editor userSelectedBold];
+        return YES;
+    }];
+    [keyBindings bindKey:@"i" modifierFlags:NSCommandKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutItalic command:^BOOL(RichTextEditor *editor) {
+        [editor userSelectedItalic];
+        return YES;
+    }];
+    [keyBindings bindKey:@"u" modifierFlags:NSCommandKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutUnderline command:^BOOL(RichTextEditor *editor) {
+        [editor userSelectedUnderline];
+        return YES;
+    }];
+    [keyBindings bindKey:@">" modifierFlags:NSCommandKeyMask | NSShiftKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutIncreaseFontSize command:^BOOL(RichTextEditor *editor) {
+        [editor increaseFontSize];
+        return YES;
+    }];
+    [keyBindings bindKey:@"<" modifierFlags:NSCommandKeyMask | NSShiftKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutDecreaseFontSize command:^BOOL(RichTextEditor *editor) {
+        [editor decreaseFontSize];
+        return YES;
+    }];
+    [keyBindings bindKey:@"L" modifierFlags:NSCommandKeyMask | NSShiftKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutBulletedList command:^BOOL(RichTextEditor *editor) {
+        [editor userSelectedBullet];
+        return YES;
+    }];
+    [keyBindings bindKey:@"N" modifierFlags:NSCommandKeyMask | NSShiftKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutLeaveBulletedList command:^BOOL(RichTextEditor *editor) {
+        if (![editor isInBulletedList]) {
+            return NO;
+        }
+        [editor userSelectedBullet];
+        return YES;
+    }];
+    [keyBindings bindKey:@"T" modifierFlags:NSCommandKeyMask | NSShiftKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutDecreaseIndent command:^BOOL(RichTextEditor *editor) {
+        [editor userSelectedDecreaseIndent];
+        return YES;
+    }];
+    [keyBindings bindKey:@"t" modifierFlags:NSCommandKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutIncreaseIndent command:^BOOL(RichTextEditor *editor) {
+        [editor userSelectedIncreaseIndent];
+        return YES;
+    }];
+    // Tab and shift-tab only indent when tabKeyAlwaysIndentsOutdents is on; otherwise they are typed
+    [keyBindings bindKey:@"\t" modifierFlags:0 ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutIncreaseIndent command:^BOOL(RichTextEditor *editor) {
+        if (!editor.tabKeyAlwaysIndentsOutdents) {
+            return NO;
+        }
+        [editor userSelectedIncreaseIndent];
+        return YES;
+    }];
+    [keyBindings bindKey:@"\t" modifierFlags:NSShiftKeyMask ignoringModifierFlags:ignored shortcut:RichTextEditorShortcutIncreaseIndent command:^BOOL(RichTextEditor *editor) {
+        if (!editor.tabKeyAlwaysIndentsOutdents) {
+            return NO;
+        }
+        [editor userSelectedDecreaseIndent];
+        return YES;
+    }];
+    return keyBindings;
+}
+
 // http://stackoverflow.com/questions/970707/cocoa-keyboard-shortcuts-in-dialog-without-an-edit-menu
 - (void)keyDown:(NSEvent*)event {
     NSString *key = event.charactersIgnoringModifiers;
     if (key.length > 0) {
-        NSUInteger enabledShortcuts = RichTextEditorShortcutAll;
-        if (self.rteDataSource && [self.rteDataSource respondsToSelector:@selector(enabledKeyboardShortcuts)]) {
-            enabledShortcuts = [self.rteDataSource enabledKeyboardShortcuts];
-        }
-        
-        unichar keyChar = 0;
-        bool shiftKeyDown = event.modifierFlags & NSShiftKeyMask;
-        bool commandKeyDown = event.modifierFlags & NSCommandKeyMask;
-        keyChar = [key characterAtIndex:0];
+        unichar keyChar = [key characterAtIndex:0];
 		_lastSingleKeyPressed = keyChar;
+        RichTextEditorKeyCommand command = nil;
         if (keyChar == NSLeftArrowFunctionKey || keyChar == NSRightArrowFunctionKey ||
             keyChar == NSUpArrowFunctionKey || keyChar == NSDownArrowFunctionKey) {
 			[self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeArrowKey];
 			[super keyDown:event];
         }
-        else if ((keyChar == 'b' || keyChar == 'B') && commandKeyDown && !shiftKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutBold)) {
-            [self userSelectedBold];
-        }
-        else if ((keyChar == 'i' || keyChar == 'I') && commandKeyDown && !shiftKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutItalic)) {
-            [self userSelectedItalic];
-        }
-        else if ((keyChar == 'u' || keyChar == 'U') && commandKeyDown && !shiftKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutUnderline)) {
-            [self userSelectedUnderline];
-        }
-        else if (keyChar == '>' && shiftKeyDown && commandKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutIncreaseFontSize)) {
-            [self increaseFontSize];
-        }
-        else if (keyChar == '<' && shiftKeyDown && commandKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutDecreaseFontSize)) {
-            [self decreaseFontSize];
-        }
-        else if (keyChar == 'L' && shiftKeyDown && commandKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutBulletedList)) {
-            [self userSelectedBullet];
-        }
-        else if (keyChar == 'N' && shiftKeyDown && commandKeyDown && [self isInBulletedList] &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutLeaveBulletedList)) {
-            [self userSelectedBullet];
-        }
-        else if (keyChar == 'T' && shiftKeyDown && commandKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutDecreaseIndent)) {
-            [self userSelectedDecreaseIndent];
-        }
-        else if (keyChar == 't' && commandKeyDown && !shiftKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutIncreaseIndent)) {
-            [self userSelectedIncreaseIndent];
-        }
-        else if (self.tabKeyAlwaysIndentsOutdents && keyChar == '\t' && !commandKeyDown && !shiftKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutIncreaseIndent)) {
-            [self userSelectedIncreaseIndent];
-        }
-        else if (self.tabKeyAlwaysIndentsOutdents && (keyChar == '\t' || keyChar == 25) && !commandKeyDown && shiftKeyDown &&
-                 (enabledShortcuts == RichTextEditorShortcutAll || enabledShortcuts & RichTextEditorShortcutIncreaseIndent)) {
-            [self userSelectedDecreaseIndent];
+        else if ((command = [_keyBindings commandForKeyCharacter:keyChar modifierFlags:event.modifierFlags]) && command(self)) {
+            // Handled by a key binding
         }
-        else if (!([self.rteDelegate respondsToSelector:@selector(richTextEditor:keyDownEvent:)] && [self.rteDelegate richTextEditor:self keyDownEvent:event])) {
+        else if (!(_rteDelegateHandlesKeyDown && [self.rteDelegate richTextEditor:self keyDownEvent:event])) {
             [self sendDelegatePreviewChangeOfType:RichTextEditorPreviewChangeKeyDown];
             [super keyDown:event];
         }
@@ -0,0 +1,58 @@
+//
+//  RichTextEditorAttributeInterner.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFoundationText.h"
+
+/// Hands out one shared instance for each distinct paragraph style, font and color, so that text
+/// edited over a long session doesn't end up holding thousands of equal but separate attribute
+/// objects, and so that neighbouring runs with the same attributes can be merged.
+///
+/// Interned paragraph styles are immutable copies; other values are kept as they are. Interned
+/// values live as long as the interner. Not thread safe; use it where the text storage is edited.
+@interface RichTextEditorAttributeInterner : NSObject
+
+/// Number of distinct values held.
+@property (nonatomic, readonly) NSUInteger internedValueCount;
+
+/// Number of values that were replaced by an equal one already held.
+@property (nonatomic, readonly) NSUInteger hitCount;
+
+/// Number of values that were new.
+@property (nonatomic, readonly) NSUInteger missCount;
+
+- (NSParagraphStyle *)internedParagraphStyle:(NSParagraphStyle *)paragraphStyle;
+- (NSFont *)internedFont:(NSFont *)font;
+- (NSColor *)internedColor:(NSColor *)color;
+
+/// The shared instance of value if it is a paragraph style, font or color; otherwise value itself.
+- (id)internedValue:(id)value;
+
+/// attributes with every value interned. Returns attributes itself if nothing had to change.
+- (NSDictionary<NSString *, id> *)internedAttributes:(NSDictionary<NSString *, id> *)attributes;
+
+/// string with every attribute value interned.
+- (NSAttributedString *)internedAttributedString:(NSAttributedString *)string;
+
+/// Interns the attributes of every run in range and merges neighbouring runs that end up with the
+/// same attributes, in one beginEditing/endEditing transaction. Only runs that change are touched.
+/// Returns the number of runs removed.
+- (NSUInteger)compactRunsInTextStorage:(NSMutableAttributedString *)textStorage range:(NSRange)range;
+
+/// Forgets every interned value. Counters are left alone.
+- (void)removeAllValues;
+
+/// Sets hitCount and missCount back to 0.
+- (void)resetStatistics;
+
+/// Number of attribute runs string stores in range (not merged the way longest effective ranges are).
++ (NSUInteger)runCountOfAttributedString:(NSAttributedString *)string range:(NSRange)range;
+
+/// Number of separate paragraph style, font and color objects used in range; equal values that
+/// are separate objects are counted separately.
++ (NSUInteger)attributeObjectCountOfAttributedString:(NSAttributedString *)string range:(NSRange)range;
+
+@end
@@ -0,0 +1,159 @@
+//
+//  RichTextEditorAttributeInterner.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorAttributeInterner.h"
+
+static BOOL RTEIsInternableValue(id value) {
+    return [value isKindOfClass:[NSParagraphStyle class]] || [value isKindOfClass:[NSFont class]] || [value isKindOfClass:[NSColor class]];
+}
+
+@interface RichTextEditorAttributeInterner ()
+
+@property NSMutableSet *values;
+@property (nonatomic, readwrite) NSUInteger hitCount;
+@property (nonatomic, readwrite) NSUInteger missCount;
+
+@end
+
+@implementation RichTextEditorAttributeInterner
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _values = [NSMutableSet set];
+    }
+    return self;
+}
+
+- (NSUInteger)internedValueCount {
+    return self.values.count;
+}
+
+- (id)internedValue:(id)value {
+    if (!value || !RTEIsInternableValue(value)) {
+        return value;
+    }
+    id interned = [self.values member:value];
+    if (interned) {
+        self.hitCount++;
+        return interned;
+    }
+    self.missCount++;
+    // Paragraph styles are usually NSMutableParagraphStyles that the caller may change later
+    interned = [value isKindOfClass:[NSParagraphStyle class]] ? [value copy] : value;
+    [self.values addObject:interned];
+    return interned;
+}
+
+- (NSParagraphStyle *)internedParagraphStyle:(NSParagraphStyle *)paragraphStyle {
+    return [self internedValue:paragraphStyle];
+}
+
+- (NSFont *)internedFont:(NSFont *)font {
+    return [self internedValue:font];
+}
+
+- (NSColor *)internedColor:(NSColor *)color {
+    return [self internedValue:color];
+}
+
+- (NSDictionary<NSString *, id> *)internedAttributes:(NSDictionary<NSString *, id> *)attributes {
+    __block NSMutableDictionary *interned = nil;
+    [attributes enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+        id internedValue = [self internedValue:value];
+        if (internedValue != value) {
+            if (!interned) {
+                interned = [attributes mutableCopy];
+            }
+            interned[key] = internedValue;
+        }
+    }];
+    return interned ?: attributes;
+}
+
+- (NSAttributedString *)internedAttributedString:(NSAttributedString *)string {
+    if (string.length == 0) {
+        return string;
+    }
+    NSMutableAttributedString *interned = [string mutableCopy];
+    [self compactRunsInTextStorage:interned range:NSMakeRange(0, interned.length)];
+    return interned;
+}
+
+- (NSUInteger)compactRunsInTextStorage:(NSMutableAttributedString *)textStorage range:(NSRange)range {
+    // Work out the merged runs first; the text storage can't change while it is enumerated
+    NSMutableArray<NSDictionary *> *attributes = [NSMutableArray array];
+    NSMutableData *ranges = [NSMutableData data];
+    NSMutableData *needsSetting = [NSMutableData data];
+    __block NSUInteger originalRunCount = 0;
+    [textStorage enumerateAttributesInRange:range options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                                 usingBlock:^(NSDictionary *runAttributes, NSRange runRange, BOOL *stop) {
+        originalRunCount++;
+        NSDictionary *internedAttributes = [self internedAttributes:runAttributes];
+        BOOL changed = internedAttributes != runAttributes;
+        NSRange *lastRange = attributes.count > 0 ? (NSRange *)ranges.mutableBytes + attributes.count - 1 : NULL;
+        if (lastRange && NSMaxRange(*lastRange) == runRange.location && [attributes.lastObject isEqualToDictionary:internedAttributes]) {
+            lastRange->length += runRange.length;
+            ((BOOL *)needsSetting.mutableBytes)[attributes.count - 1] = YES;
+            return;
+        }
+        [attributes addObject:internedAttributes];
+        [ranges appendBytes:&runRange length:sizeof(NSRange)];
+        [needsSetting appendBytes:&changed length:sizeof(BOOL)];
+    }];
+    const NSRange *mergedRanges = ranges.bytes;
+    const BOOL *mergedNeedsSetting = needsSetting.bytes;
+    BOOL beganEditing = NO;
+    for (NSUInteger i = 0; i < attributes.count; i++) {
+        if (!mergedNeedsSetting[i]) {
+            continue;
+        }
+        if (!beganEditing) {
+            [textStorage beginEditing];
+            beganEditing = YES;
+        }
+        [textStorage setAttributes:attributes[i] range:mergedRanges[i]];
+    }
+    if (beganEditing) {
+        [textStorage endEditing];
+    }
+    return originalRunCount - attributes.count;
+}
+
+- (void)removeAllValues {
+    [self.values removeAllObjects];
+}
+
+- (void)resetStatistics {
+    self.hitCount = 0;
+    self.missCount = 0;
+}
+
+#pragma mark - Metrics
+
++ (NSUInteger)runCountOfAttributedString:(NSAttributedString *)string range:(NSRange)range {
+    __block NSUInteger runCount = 0;
+    [string enumerateAttributesInRange:range options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                            usingBlock:^(NSDictionary *attributes, NSRange runRange, BOOL *stop) {
+        runCount++;
+    }];
+    return runCount;
+}
+
++ (NSUInteger)attributeObjectCountOfAttributedString:(NSAttributedString *)string range:(NSRange)range {
+    NSHashTable *objects = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality | NSPointerFunctionsStrongMemory];
+    [string enumerateAttributesInRange:range options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                            usingBlock:^(NSDictionary *attributes, NSRange runRange, BOOL *stop) {
+        for (id value in attributes.objectEnumerator) {
+            if (RTEIsInternableValue(value)) {
+                [objects addObject:value];
+            }
+        }
+    }];
+    return objects.count;
+}
+
+@end
@@ -0,0 +1,112 @@
+//
+//  RichTextEditorAutosave.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+#import "RichTextEditorEditStream.h"
+
+/// Keeps a copy of a text storage in a directory that survives the app crashing or being killed,
+/// at the cost of one small append per edit instead of a save of the whole document.
+///
+/// The directory holds numbered generations. snapshot-N is the whole text in the binary document
+/// format (see RichTextEditorBinaryDocument); journal-N is every edit made after snapshot-N was
+/// taken, appended as it happens. Every so often (compactionInterval, or sooner once the journal
+/// passes compactionThreshold) the text storage is copied and written out as the next snapshot,
+/// and the older generation is deleted once the new snapshot is safely on disk.
+///
+/// The only work done on the main thread per edit is handing the edit's record (from a
+/// RichTextEditorEditStream of its own) to a serial background queue, which encodes it and
+/// appends it to the journal. Snapshots are encoded and written on a second background queue
+/// from an immutable copy of the text taken between edits. Journal entries carry a length and a
+/// checksum, so an entry cut short by a crash is recognised and dropped on recovery.
+///
+/// Memory is bounded by maximumPendingBytes: if the journal queue falls that far behind (a very
+/// slow disk, or huge pastes), edits stop being queued, the journal is marked as incomplete, and
+/// a compaction is started; the snapshot it writes includes the edits that were skipped, and
+/// journaling picks up again from there. An edit dropped that way can be lost if the app dies
+/// before that snapshot is written, but recovery always gives a text the document really had.
+///
+/// startWithError: writes the first snapshot before it returns, so there is always one to
+/// recover from. Journal entries are written with write(), which is enough to survive the app
+/// crashing; the journal is only flushed to the disk itself by synchronize and when a
+/// generation ends.
+@interface RichTextEditorAutosave : NSObject
+
+@property (nonatomic, readonly) NSTextStorage *textStorage;
+@property (nonatomic, readonly) NSURL *directoryURL;
+
+/// Seconds between compactions while there are journal entries to compact. Defaults to 30.
+@property (nonatomic) NSTimeInterval compactionInterval;
+
+/// Approximate size in bytes the journal may reach before a compaction is started without
+/// waiting for compactionInterval. Defaults to 4 MB.
+@property (nonatomic) NSUInteger compactionThreshold;
+
+/// Approximate size in bytes of the edits that may be waiting for the journal queue before new
+/// edits are dropped in favour of a compaction. Defaults to 16 MB.
+@property (nonatomic) NSUInteger maximumPendingBytes;
+
+@property (nonatomic, readonly) BOOL isRunning;
+
+/// Generation of the newest snapshot that has been started.
+@property (nonatomic, readonly) NSUInteger generation;
+
+/// Snapshots written since start, including the first one.
+@property (nonatomic, readonly) NSUInteger compactionCount;
+
+/// Journal entries written since start.
+@property (nonatomic, readonly) NSUInteger journalEntryCount;
+
+/// Edits that weren't journaled because maximumPendingBytes was reached.
+@property (nonatomic, readonly) NSUInteger droppedEditCount;
+
+/// The last error from writing the journal or a snapshot, or nil. Autosave keeps going after an
+/// error; a snapshot that fails to write leaves the previous generation in place.
+@property (readonly) NSError *error;
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage directoryURL:(NSURL *)directoryURL;
+
+/// Creates the directory if needed, writes a snapshot of the text as it is now, removes any
+/// older autosave in the directory and starts journaling edits. Recover an older autosave first
+/// (see recoveredAttributedStringAtDirectoryURL:editCount:error:) if it should be kept.
+- (BOOL)startWithError:(NSError **)error;
+
+/// Stops journaling, waits for everything queued to be written and closes the journal. The
+/// files are kept; remove them with removeAutosaveAtDirectoryURL:error: once the document has
+/// been saved properly.
+- (void)stop;
+
+/// Starts a compaction now, or as soon as the text storage is between edits, unless one is
+/// already being written (one more is then run after it).
+- (void)compact;
+
+/// Blocks until every edit so far is in the journal, any compaction in flight is on disk, and
+/// the journal has been flushed to the disk.
+- (void)synchronize;
+
+/// The newest text autosaved in directoryURL: its newest intact snapshot with every intact
+/// journal entry written after it applied, in order, up to the first one that is cut short,
+/// corrupt or missing. Returns nil with an error if there is no intact snapshot. editCount, if
+/// not NULL, gets the number of journal entries applied.
++ (NSAttributedString *)recoveredAttributedStringAtDirectoryURL:(NSURL *)directoryURL editCount:(NSUInteger *)editCount error:(NSError **)error;
+
+/// YES if directoryURL holds any autosave files.
++ (BOOL)hasAutosaveAtDirectoryURL:(NSURL *)directoryURL;
+
+/// Deletes the autosave files in directoryURL (and nothing else).
++ (BOOL)removeAutosaveAtDirectoryURL:(NSURL *)directoryURL error:(NSError **)error;
+
+/// A journal file header for generation, as written at the start of journal-<generation>.
++ (NSData *)journalHeaderForGeneration:(NSUInteger)generation;
+
+/// The bytes appended to the journal for record, which must carry its replacementText. For
+/// tools and tests that write or inspect journals themselves.
++ (NSData *)journalEntryForEditRecord:(RichTextEditorEditRecord *)record;
+
+/// File name of the journal for generation in an autosave directory.
++ (NSString *)journalFileNameForGeneration:(NSUInteger)generation;
+
+@end
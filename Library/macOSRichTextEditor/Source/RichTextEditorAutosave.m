@@ -0,0 +1,675 @@
+//
+//  RichTextEditorAutosave.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorAutosave.h"
+#import "RichTextEditorBinaryDocument.h"
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// snapshot-N (all little endian):
+//   0  char[8]  "RTESNAP1"
+//   8  uint64   generation
+//   16 uint64   length of the document that follows
+//   24 uint32   CRC-32 of the document
+//   28 uint32   reserved (0)
+//   32          binary document
+//
+// journal-N:
+//   0  char[8]  "RTEJRNL1"
+//   8  uint64   generation
+//   16          entries, each:
+//               uint32 payload length (RTEAutosaveGapMarker: edits were dropped here)
+//               uint32 CRC-32 of the payload
+//               uint64 location and uint64 length of the range replaced, in the text before the edit
+//               binary document of the replacement text
+static const char RTEAutosaveSnapshotMagic[8] = {'R', 'T', 'E', 'S', 'N', 'A', 'P', '1'};
+static const char RTEAutosaveJournalMagic[8] = {'R', 'T', 'E', 'J', 'R', 'N', 'L', '1'};
+static const NSUInteger RTEAutosaveSnapshotHeaderSize = 32;
+static const NSUInteger RTEAutosaveJournalHeaderSize = 16;
+static const NSUInteger RTEAutosaveEntryHeaderSize = 8;
+static const NSUInteger RTEAutosaveEntryRangeSize = 16;
+static const uint32_t RTEAutosaveGapMarker = 0xFFFFFFFF;
+// Rough cost of an entry besides its text, for compactionThreshold and maximumPendingBytes
+static const NSUInteger RTEAutosaveEntryOverhead = 64;
+
+static NSString * const RTEAutosaveSnapshotPrefix = @"snapshot-";
+static NSString * const RTEAutosaveJournalPrefix = @"journal-";
+
+static uint32_t RTEAutosaveCRCTable[256];
+
+static uint32_t RTEAutosaveCRC32(const uint8_t *bytes, NSUInteger length) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            RTEAutosaveCRCTable[i] = c;
+        }
+    });
+    uint32_t crc = 0xFFFFFFFF;
+    for (NSUInteger i = 0; i < length; i++) {
+        crc = RTEAutosaveCRCTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+static void RTEAutosaveAppendUInt32(NSMutableData *data, uint32_t value) {
+    value = CFSwapInt32HostToLittle(value);
+    [data appendBytes:&value length:sizeof(value)];
+}
+
+static void RTEAutosaveAppendUInt64(NSMutableData *data, uint64_t value) {
+    value = CFSwapInt64HostToLittle(value);
+    [data appendBytes:&value length:sizeof(value)];
+}
+
+static void RTEAutosaveStoreUInt32(uint8_t *bytes, uint32_t value) {
+    value = CFSwapInt32HostToLittle(value);
+    memcpy(bytes, &value, sizeof(value));
+}
+
+static uint32_t RTEAutosaveReadUInt32(const uint8_t *bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return CFSwapInt32LittleToHost(value);
+}
+
+static uint64_t RTEAutosaveReadUInt64(const uint8_t *bytes) {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return CFSwapInt64LittleToHost(value);
+}
+
+static BOOL RTEAutosaveWriteAll(int fd, const void *bytes, size_t length) {
+    const uint8_t *cursor = bytes;
+    while (length > 0) {
+        ssize_t written = write(fd, cursor, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return NO;
+        }
+        cursor += written;
+        length -= (size_t)written;
+    }
+    return YES;
+}
+
+// fsync only gets the data as far as the drive's cache on macOS
+static void RTEAutosaveFullSync(int fd) {
+#ifdef F_FULLFSYNC
+    if (fcntl(fd, F_FULLFSYNC) == 0) {
+        return;
+    }
+#endif
+    fsync(fd);
+}
+
+static NSError *RTEAutosavePOSIXError(NSString *path) {
+    return [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey: path}];
+}
+
+// Generation in an autosave file name such as snapshot-12 (or snapshot-12.tmp), or NSNotFound
+static NSUInteger RTEAutosaveGenerationOfFileName(NSString *fileName, NSString *prefix) {
+    fileName = [fileName stringByDeletingPathExtension];
+    if (![fileName hasPrefix:prefix] || fileName.length == prefix.length) {
+        return NSNotFound;
+    }
+    NSString *number = [fileName substringFromIndex:prefix.length];
+    NSCharacterSet *nonDigits = [[NSCharacterSet characterSetWithCharactersInString:@"0123456789"] invertedSet];
+    if ([number rangeOfCharacterFromSet:nonDigits].location != NSNotFound) {
+        return NSNotFound;
+    }
+    return (NSUInteger)number.longLongValue;
+}
+
+@interface RichTextEditorAutosave () {
+    // Main thread
+    dispatch_source_t _compactionTimer;
+    NSUInteger _journalBytes; // since the last compaction started
+    BOOL _isDroppingEdits;
+    BOOL _needsCompaction;
+    // Journal queue
+    int _journalFD;
+    // Any thread
+    atomic_bool _isCompacting;
+    _Atomic(NSUInteger) _pendingBytes;
+    _Atomic(NSUInteger) _compactionCount;
+    _Atomic(NSUInteger) _journalEntryCount;
+}
+
+@property (nonatomic, readwrite) BOOL isRunning;
+@property (nonatomic, readwrite) NSUInteger generation;
+@property (nonatomic, readwrite) NSUInteger droppedEditCount;
+@property (readwrite) NSError *error;
+
+@property (nonatomic) RichTextEditorEditStream *editStream;
+@property (nonatomic) dispatch_queue_t journalQueue;
+@property (nonatomic) dispatch_queue_t compactionQueue;
+
+@end
+
+@implementation RichTextEditorAutosave
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage directoryURL:(NSURL *)directoryURL {
+    if (self = [super init]) {
+        _textStorage = textStorage;
+        _directoryURL = directoryURL;
+        _compactionInterval = 30;
+        _compactionThreshold = 4 * 1024 * 1024;
+        _maximumPendingBytes = 16 * 1024 * 1024;
+        _journalFD = -1;
+        atomic_init(&_isCompacting, false);
+        atomic_init(&_pendingBytes, 0);
+        atomic_init(&_compactionCount, 0);
+        atomic_init(&_journalEntryCount, 0);
+        _journalQueue = dispatch_queue_create("com.pikleproductions.macOSRichTextEditor.autosave.journal", DISPATCH_QUEUE_SERIAL);
+        _compactionQueue = dispatch_queue_create("com.pikleproductions.macOSRichTextEditor.autosave.compaction", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // Queued blocks hold on to self, so nothing can be left on the queues by now
+    if (_compactionTimer) {
+        dispatch_source_cancel(_compactionTimer);
+    }
+    if (_journalFD >= 0) {
+        close(_journalFD);
+    }
+}
+
+- (NSUInteger)compactionCount {
+    return atomic_load_explicit(&_compactionCount, memory_order_relaxed);
+}
+
+- (NSUInteger)journalEntryCount {
+    return atomic_load_explicit(&_journalEntryCount, memory_order_relaxed);
+}
+
+- (void)setCompactionInterval:(NSTimeInterval)compactionInterval {
+    _compactionInterval = compactionInterval;
+    if (self.isRunning) {
+        [self startCompactionTimer];
+    }
+}
+
+#pragma mark - Starting and Stopping -
+
+- (BOOL)startWithError:(NSError **)error {
+    if (self.isRunning) {
+        return YES;
+    }
+    if (![[NSFileManager defaultManager] createDirectoryAtURL:self.directoryURL withIntermediateDirectories:YES attributes:nil error:error]) {
+        return NO;
+    }
+    // Past every file already there, so an older autosave is only replaced once this snapshot is safe
+    NSUInteger generation = 1;
+    for (NSString *fileName in [[self class] autosaveFileNamesAtDirectoryURL:self.directoryURL]) {
+        NSUInteger existing = RTEAutosaveGenerationOfFileName(fileName, RTEAutosaveSnapshotPrefix);
+        if (existing == NSNotFound) {
+            existing = RTEAutosaveGenerationOfFileName(fileName, RTEAutosaveJournalPrefix);
+        }
+        if (existing != NSNotFound && existing >= generation) {
+            generation = existing + 1;
+        }
+    }
+    NSAttributedString *text = [[NSAttributedString alloc] initWithAttributedString:self.textStorage];
+    if (![[self class] writeSnapshotOfAttributedString:text generation:generation directoryURL:self.directoryURL error:error]) {
+        return NO;
+    }
+    [[self class] removeGenerationsBefore:generation directoryURL:self.directoryURL];
+    if (![self openJournalForGeneration:generation error:error]) {
+        return NO;
+    }
+    self.generation = generation;
+    atomic_store_explicit(&_compactionCount, 1, memory_order_relaxed);
+    _journalBytes = 0;
+    _isDroppingEdits = NO;
+    _needsCompaction = NO;
+
+    self.editStream = [[RichTextEditorEditStream alloc] initWithTextStorage:self.textStorage];
+    __weak RichTextEditorAutosave *weakSelf = self;
+    self.editStream.handler = ^(NSArray<RichTextEditorEditRecord *> *records) {
+        [weakSelf journalRecords:records];
+    };
+    self.isRunning = YES;
+    [self startCompactionTimer];
+    return YES;
+}
+
+- (void)stop {
+    if (!self.isRunning) {
+        return;
+    }
+    self.isRunning = NO;
+    self.editStream.handler = nil;
+    self.editStream = nil;
+    [self stopCompactionTimer];
+    dispatch_sync(self.compactionQueue, ^{});
+    dispatch_sync(self.journalQueue, ^{
+        [self closeJournal];
+    });
+}
+
+- (void)synchronize {
+    dispatch_sync(self.compactionQueue, ^{});
+    dispatch_sync(self.journalQueue, ^{
+        if (self->_journalFD >= 0) {
+            RTEAutosaveFullSync(self->_journalFD);
+        }
+    });
+}
+
+#pragma mark - Journal -
+
+- (void)journalRecords:(NSArray<RichTextEditorEditRecord *> *)records {
+    for (RichTextEditorEditRecord *record in records) {
+        if (_isDroppingEdits) {
+            // The compaction on its way will pick this edit up with the rest of the text
+            self.droppedEditCount++;
+            continue;
+        }
+        NSUInteger cost = record.replacementLength * sizeof(unichar) + RTEAutosaveEntryOverhead;
+        if (atomic_load_explicit(&_pendingBytes, memory_order_relaxed) + cost > self.maximumPendingBytes) {
+            // The journal queue can't keep up. Mark the journal as incomplete so recovery stops
+            // there, and let the next snapshot catch up with the text.
+            _isDroppingEdits = YES;
+            self.droppedEditCount++;
+            dispatch_async(self.journalQueue, ^{
+                [self appendGapMarker];
+            });
+            continue;
+        }
+        atomic_fetch_add_explicit(&_pendingBytes, cost, memory_order_relaxed);
+        _journalBytes += cost;
+        dispatch_async(self.journalQueue, ^{
+            [self appendEntry:[RichTextEditorAutosave journalEntryForEditRecord:record]];
+            atomic_fetch_sub_explicit(&self->_pendingBytes, cost, memory_order_relaxed);
+        });
+    }
+    if (_isDroppingEdits || _journalBytes >= self.compactionThreshold) {
+        [self compact];
+    }
+}
+
+// Journal queue
+- (BOOL)openJournalForGeneration:(NSUInteger)generation error:(NSError **)error {
+    NSString *path = [self.directoryURL URLByAppendingPathComponent:[[self class] journalFileNameForGeneration:generation]].path;
+    int fd = open(path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        if (error) {
+            *error = RTEAutosavePOSIXError(path);
+        }
+        return NO;
+    }
+    NSData *header = [[self class] journalHeaderForGeneration:generation];
+    if (!RTEAutosaveWriteAll(fd, header.bytes, header.length)) {
+        if (error) {
+            *error = RTEAutosavePOSIXError(path);
+        }
+        close(fd);
+        return NO;
+    }
+    _journalFD = fd;
+    return YES;
+}
+
+// Journal queue
+- (void)closeJournal {
+    if (_journalFD >= 0) {
+        RTEAutosaveFullSync(_journalFD);
+        close(_journalFD);
+        _journalFD = -1;
+    }
+}
+
+// Journal queue
+- (void)switchJournalToGeneration:(NSUInteger)generation {
+    // The finished journal must be on disk before a newer one can be replayed after it
+    [self closeJournal];
+    NSError *error = nil;
+    if (![self openJournalForGeneration:generation error:&error]) {
+        self.error = error;
+    }
+}
+
+// Journal queue
+- (void)appendEntry:(NSData *)entry {
+    if (_journalFD < 0) {
+        return;
+    }
+    if (RTEAutosaveWriteAll(_journalFD, entry.bytes, entry.length)) {
+        atomic_fetch_add_explicit(&_journalEntryCount, 1, memory_order_relaxed);
+        return;
+    }
+    // Whatever part of the entry made it out ends the journal; the next snapshot starts a new one
+    self.error = RTEAutosavePOSIXError(self.directoryURL.path);
+    close(_journalFD);
+    _journalFD = -1;
+    __weak RichTextEditorAutosave *weakSelf = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [weakSelf compact];
+    });
+}
+
+// Journal queue
+- (void)appendGapMarker {
+    if (_journalFD < 0) {
+        return;
+    }
+    uint8_t marker[RTEAutosaveEntryHeaderSize];
+    RTEAutosaveStoreUInt32(marker, RTEAutosaveGapMarker);
+    RTEAutosaveStoreUInt32(marker + 4, 0);
+    RTEAutosaveWriteAll(_journalFD, marker, sizeof(marker));
+}
+
++ (NSData *)journalHeaderForGeneration:(NSUInteger)generation {
+    NSMutableData *header = [NSMutableData dataWithBytes:RTEAutosaveJournalMagic length:sizeof(RTEAutosaveJournalMagic)];
+    RTEAutosaveAppendUInt64(header, generation);
+    return header;
+}
+
++ (NSData *)journalEntryForEditRecord:(RichTextEditorEditRecord *)record {
+    NSParameterAssert(record.replacementText);
+    NSData *text = [RichTextEditorBinaryDocument dataWithAttributedString:record.replacementText];
+    NSMutableData *entry = [NSMutableData dataWithLength:RTEAutosaveEntryHeaderSize];
+    RTEAutosaveAppendUInt64(entry, record.range.location);
+    RTEAutosaveAppendUInt64(entry, record.range.length);
+    [entry appendData:text];
+    uint8_t *bytes = entry.mutableBytes;
+    NSUInteger payloadLength = entry.length - RTEAutosaveEntryHeaderSize;
+    RTEAutosaveStoreUInt32(bytes, (uint32_t)payloadLength);
+    RTEAutosaveStoreUInt32(bytes + 4, RTEAutosaveCRC32(bytes + RTEAutosaveEntryHeaderSize, payloadLength));
+    return entry;
+}
+
++ (NSString *)journalFileNameForGeneration:(NSUInteger)generation {
+    return [NSString stringWithFormat:@"%@%lu", RTEAutosaveJournalPrefix, (unsigned long)generation];
+}
+
++ (NSString *)snapshotFileNameForGeneration:(NSUInteger)generation {
+    return [NSString stringWithFormat:@"%@%lu", RTEAutosaveSnapshotPrefix, (unsigned long)generation];
+}
+
+#pragma mark - Compaction -
+
+- (void)startCompactionTimer {
+    [self stopCompactionTimer];
+    if (self.compactionInterval <= 0) {
+        return;
+    }
+    uint64_t interval = (uint64_t)(self.compactionInterval * NSEC_PER_SEC);
+    dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+    dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval), interval, interval / 10);
+    __weak RichTextEditorAutosave *weakSelf = self;
+    dispatch_source_set_event_handler(timer, ^{
+        [weakSelf compactionTimerFired];
+    });
+    dispatch_resume(timer);
+    _compactionTimer = timer;
+}
+
+- (void)stopCompactionTimer {
+    if (_compactionTimer) {
+        dispatch_source_cancel(_compactionTimer);
+        _compactionTimer = nil;
+    }
+}
+
+- (void)compactionTimerFired {
+    if (_journalBytes > 0 || _isDroppingEdits) {
+        [self compact];
+    }
+}
+
+- (void)compactIfNeeded {
+    if (_needsCompaction) {
+        _needsCompaction = NO;
+        [self compact];
+    }
+}
+
+- (void)compact {
+    if (!self.isRunning) {
+        return;
+    }
+    if (atomic_load_explicit(&_isCompacting, memory_order_acquire)) {
+        // Run again when the one being written finishes
+        _needsCompaction = YES;
+        return;
+    }
+    if (self.textStorage.editedMask != 0) {
+        // In the middle of an edit (e.g. called from an edit record), so the text storage
+        // doesn't match the journal yet
+        if (!_needsCompaction) {
+            _needsCompaction = YES;
+            __weak RichTextEditorAutosave *weakSelf = self;
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [weakSelf compactIfNeeded];
+            });
+        }
+        return;
+    }
+    _needsCompaction = NO;
+
+    // Everything journaled so far is in this copy; everything after it goes to the next journal
+    NSAttributedString *text = [[NSAttributedString alloc] initWithAttributedString:self.textStorage];
+    NSUInteger generation = self.generation + 1;
+    self.generation = generation;
+    _journalBytes = 0;
+    _isDroppingEdits = NO;
+    atomic_store_explicit(&_isCompacting, true, memory_order_release);
+    dispatch_async(self.journalQueue, ^{
+        [self switchJournalToGeneration:generation];
+    });
+    NSURL *directoryURL = self.directoryURL;
+    __weak RichTextEditorAutosave *weakSelf = self;
+    dispatch_async(self.compactionQueue, ^{
+        NSError *error = nil;
+        if ([RichTextEditorAutosave writeSnapshotOfAttributedString:text generation:generation directoryURL:directoryURL error:&error]) {
+            // Older generations are only needed until this snapshot is safe
+            [RichTextEditorAutosave removeGenerationsBefore:generation directoryURL:directoryURL];
+            atomic_fetch_add_explicit(&self->_compactionCount, 1, memory_order_relaxed);
+        }
+        else {
+            self.error = error;
+        }
+        atomic_store_explicit(&self->_isCompacting, false, memory_order_release);
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf compactIfNeeded];
+        });
+    });
+}
+
++ (BOOL)writeSnapshotOfAttributedString:(NSAttributedString *)string generation:(NSUInteger)generation directoryURL:(NSURL *)directoryURL error:(NSError **)error {
+    NSData *document = [RichTextEditorBinaryDocument dataWithAttributedString:string];
+    NSMutableData *data = [NSMutableData dataWithCapacity:RTEAutosaveSnapshotHeaderSize + document.length];
+    [data appendBytes:RTEAutosaveSnapshotMagic length:sizeof(RTEAutosaveSnapshotMagic)];
+    RTEAutosaveAppendUInt64(data, generation);
+    RTEAutosaveAppendUInt64(data, document.length);
+    RTEAutosaveAppendUInt32(data, RTEAutosaveCRC32(document.bytes, document.length));
+    RTEAutosaveAppendUInt32(data, 0);
+    [data appendData:document];
+
+    // Written next to the final name and renamed into place once it is on disk, so a crash
+    // leaves either the whole snapshot or none of it
+    NSString *path = [directoryURL URLByAppendingPathComponent:[self snapshotFileNameForGeneration:generation]].path;
+    NSString *temporaryPath = [path stringByAppendingPathExtension:@"tmp"];
+    int fd = open(temporaryPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        if (error) {
+            *error = RTEAutosavePOSIXError(temporaryPath);
+        }
+        return NO;
+    }
+    BOOL written = RTEAutosaveWriteAll(fd, data.bytes, data.length);
+    if (written) {
+        RTEAutosaveFullSync(fd);
+    }
+    close(fd);
+    if (!written || rename(temporaryPath.fileSystemRepresentation, path.fileSystemRepresentation) != 0) {
+        if (error) {
+            *error = RTEAutosavePOSIXError(path);
+        }
+        unlink(temporaryPath.fileSystemRepresentation);
+        return NO;
+    }
+    int directory = open(directoryURL.path.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (directory >= 0) {
+        fsync(directory);
+        close(directory);
+    }
+    return YES;
+}
+
++ (void)removeGenerationsBefore:(NSUInteger)generation directoryURL:(NSURL *)directoryURL {
+    for (NSString *fileName in [self autosaveFileNamesAtDirectoryURL:directoryURL]) {
+        NSUInteger fileGeneration = RTEAutosaveGenerationOfFileName(fileName, RTEAutosaveSnapshotPrefix);
+        if (fileGeneration == NSNotFound) {
+            fileGeneration = RTEAutosaveGenerationOfFileName(fileName, RTEAutosaveJournalPrefix);
+        }
+        if (fileGeneration < generation) {
+            unlink([directoryURL URLByAppendingPathComponent:fileName].path.fileSystemRepresentation);
+        }
+    }
+}
+
+#pragma mark - Recovery -
+
++ (NSArray<NSString *> *)autosaveFileNamesAtDirectoryURL:(NSURL *)directoryURL {
+    NSArray<NSString *> *fileNames = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directoryURL.path error:NULL];
+    NSMutableArray<NSString *> *autosaveFileNames = [NSMutableArray array];
+    for (NSString *fileName in fileNames) {
+        if ([fileName hasPrefix:RTEAutosaveSnapshotPrefix] || [fileName hasPrefix:RTEAutosaveJournalPrefix]) {
+            [autosaveFileNames addObject:fileName];
+        }
+    }
+    return autosaveFileNames;
+}
+
++ (BOOL)hasAutosaveAtDirectoryURL:(NSURL *)directoryURL {
+    return [self autosaveFileNamesAtDirectoryURL:directoryURL].count > 0;
+}
+
++ (BOOL)removeAutosaveAtDirectoryURL:(NSURL *)directoryURL error:(NSError **)error {
+    for (NSString *fileName in [self autosaveFileNamesAtDirectoryURL:directoryURL]) {
+        if (![[NSFileManager defaultManager] removeItemAtURL:[directoryURL URLByAppendingPathComponent:fileName] error:error]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+// The snapshot's text, or nil if the file is missing, cut short or corrupt
++ (NSAttributedString *)snapshotAtURL:(NSURL *)url generation:(NSUInteger)generation {
+    NSData *data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:NULL];
+    const uint8_t *bytes = data.bytes;
+    if (data.length < RTEAutosaveSnapshotHeaderSize || memcmp(bytes, RTEAutosaveSnapshotMagic, sizeof(RTEAutosaveSnapshotMagic)) != 0 ||
+        RTEAutosaveReadUInt64(bytes + 8) != generation ||
+        RTEAutosaveReadUInt64(bytes + 16) != data.length - RTEAutosaveSnapshotHeaderSize) {
+        return nil;
+    }
+    NSUInteger length = data.length - RTEAutosaveSnapshotHeaderSize;
+    if (RTEAutosaveReadUInt32(bytes + 24) != RTEAutosaveCRC32(bytes + RTEAutosaveSnapshotHeaderSize, length)) {
+        return nil;
+    }
+    NSData *documentData = [data subdataWithRange:NSMakeRange(RTEAutosaveSnapshotHeaderSize, length)];
+    RichTextEditorBinaryDocument *document = [[RichTextEditorBinaryDocument alloc] initWithData:documentData error:NULL];
+    return [document attributedStringWithError:NULL];
+}
+
+// Applies the journal's intact entries to text. Returns YES if the journal ended cleanly, so the
+// next generation's journal follows on from it.
++ (BOOL)replayJournal:(NSData *)journal generation:(NSUInteger)generation text:(NSMutableAttributedString *)text editCount:(NSUInteger *)editCount {
+    const uint8_t *bytes = journal.bytes;
+    NSUInteger length = journal.length;
+    if (length < RTEAutosaveJournalHeaderSize || memcmp(bytes, RTEAutosaveJournalMagic, sizeof(RTEAutosaveJournalMagic)) != 0 ||
+        RTEAutosaveReadUInt64(bytes + 8) != generation) {
+        return NO;
+    }
+    NSUInteger offset = RTEAutosaveJournalHeaderSize;
+    while (offset < length) {
+        if (length - offset < RTEAutosaveEntryHeaderSize) {
+            return NO;
+        }
+        uint32_t payloadLength = RTEAutosaveReadUInt32(bytes + offset);
+        NSUInteger payloadOffset = offset + RTEAutosaveEntryHeaderSize;
+        if (payloadLength == RTEAutosaveGapMarker || payloadLength < RTEAutosaveEntryRangeSize || payloadLength > length - payloadOffset ||
+            RTEAutosaveReadUInt32(bytes + offset + 4) != RTEAutosaveCRC32(bytes + payloadOffset, payloadLength)) {
+            return NO;
+        }
+        uint64_t location = RTEAutosaveReadUInt64(bytes + payloadOffset);
+        uint64_t replacedLength = RTEAutosaveReadUInt64(bytes + payloadOffset + 8);
+        if (location > text.length || replacedLength > text.length - location) {
+            return NO;
+        }
+        NSData *documentData = [journal subdataWithRange:NSMakeRange(payloadOffset + RTEAutosaveEntryRangeSize, payloadLength - RTEAutosaveEntryRangeSize)];
+        RichTextEditorBinaryDocument *document = [[RichTextEditorBinaryDocument alloc] initWithData:documentData error:NULL];
+        NSAttributedString *replacement = [document attributedStringWithError:NULL];
+        if (!replacement) {
+            return NO;
+        }
+        [text replaceCharactersInRange:NSMakeRange((NSUInteger)location, (NSUInteger)replacedLength) withAttributedString:replacement];
+        (*editCount)++;
+        offset = payloadOffset + payloadLength;
+    }
+    return YES;
+}
+
++ (NSAttributedString *)recoveredAttributedStringAtDirectoryURL:(NSURL *)directoryURL editCount:(NSUInteger *)editCount error:(NSError **)error {
+    NSMutableArray<NSNumber *> *generations = [NSMutableArray array];
+    for (NSString *fileName in [self autosaveFileNamesAtDirectoryURL:directoryURL]) {
+        if (fileName.pathExtension.length == 0) {
+            NSUInteger generation = RTEAutosaveGenerationOfFileName(fileName, RTEAutosaveSnapshotPrefix);
+            if (generation != NSNotFound) {
+                [generations addObject:@(generation)];
+            }
+        }
+    }
+    [generations sortUsingSelector:@selector(compare:)];
+
+    // Newest intact snapshot...
+    NSMutableAttributedString *text = nil;
+    NSUInteger generation = 0;
+    for (NSNumber *candidate in generations.reverseObjectEnumerator) {
+        generation = candidate.unsignedIntegerValue;
+        text = [[self snapshotAtURL:[directoryURL URLByAppendingPathComponent:[self snapshotFileNameForGeneration:generation]]
+                         generation:generation] mutableCopy];
+        if (text) {
+            break;
+        }
+    }
+    if (!text) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadNoSuchFileError
+                                     userInfo:@{NSLocalizedFailureReasonErrorKey: @"There is no intact autosave snapshot.",
+                                                NSURLErrorKey: directoryURL}];
+        }
+        return nil;
+    }
+    // ...and the journals from then on, until one is missing or doesn't end cleanly
+    NSUInteger count = 0;
+    while (YES) {
+        NSURL *journalURL = [directoryURL URLByAppendingPathComponent:[self journalFileNameForGeneration:generation]];
+        NSData *journal = [NSData dataWithContentsOfURL:journalURL options:NSDataReadingMappedIfSafe error:NULL];
+        if (!journal || ![self replayJournal:journal generation:generation text:text editCount:&count]) {
+            break;
+        }
+        generation++;
+    }
+    if (editCount) {
+        *editCount = count;
+    }
+    return text;
+}
+
+@end
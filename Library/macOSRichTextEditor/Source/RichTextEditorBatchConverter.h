@@ -0,0 +1,154 @@
+//
+//  RichTextEditorBatchConverter.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+/// Number of per-file latency buckets in a RichTextEditorBatchConversionReport. Bucket i counts
+/// files that took less than 2^i microseconds (and at least 2^(i-1)); the last bucket also holds
+/// everything slower.
+#define RTE_BATCH_CONVERSION_BUCKET_COUNT 32
+
+typedef NS_ENUM(NSInteger, RichTextEditorFileFormat) {
+    RichTextEditorFileFormatHTML,
+    RichTextEditorFileFormatRTF,
+    RichTextEditorFileFormatPlainText,
+    RichTextEditorFileFormatMarkdown
+};
+
+/// Counts, throughput, latency and failures of a batch conversion. Updated by the workers while
+/// the conversion runs, so it can be read for progress at any time; each counter is updated
+/// atomically on its own, so a read during a run may be off by the files in flight.
+@interface RichTextEditorBatchConversionReport : NSObject
+
+@property (nonatomic, readonly) NSUInteger convertedCount;
+
+/// Files whose output was already up to date (see -[RichTextEditorBatchConverter resumes]).
+@property (nonatomic, readonly) NSUInteger skippedCount;
+
+@property (nonatomic, readonly) NSUInteger failedCount;
+
+/// Bytes read from converted files and written to their outputs.
+@property (nonatomic, readonly) unsigned long long bytesRead;
+@property (nonatomic, readonly) unsigned long long bytesWritten;
+
+/// Time since the conversion started, or its total time once it has finished.
+@property (nonatomic, readonly) NSTimeInterval elapsedTime;
+
+/// Converted files per second of elapsedTime.
+@property (nonatomic, readonly) double filesPerSecond;
+
+/// The first failures, as errors with NSFilePathErrorKey set to the input file. Only
+/// maximumRecordedFailures are kept; failedCount counts all of them.
+@property (nonatomic, readonly) NSArray<NSError *> *failures;
+
+/// Defaults to 1000.
+@property (nonatomic) NSUInteger maximumRecordedFailures;
+
+/// Per-file conversion time (read, convert and write) in microseconds: the upper bound of the
+/// bucket the percentile falls in, e.g. 0.5 or 0.99. 0 if nothing has been converted.
+- (uint64_t)latencyMicrosecondsAtPercentile:(double)percentile;
+
+@property (nonatomic, readonly) uint64_t maximumLatencyMicroseconds;
+
+/// Counts per latency bucket (RTE_BATCH_CONVERSION_BUCKET_COUNT numbers).
+- (NSArray<NSNumber *> *)latencyHistogram;
+
+/// Everything above as property list types:
+///   { "converted", "skipped", "failed", "bytesRead", "bytesWritten", "elapsedSeconds",
+///     "filesPerSecond", "p50Microseconds", "p99Microseconds", "maxMicroseconds", "histogram",
+///     "failures": [{ "path", "error" }, ...] }
+- (NSDictionary *)snapshot;
+
+/// snapshot as JSON.
+- (NSData *)JSONData;
+
+@end
+
+/// Converts stored documents between HTML, RTF, plain text and Markdown without an editor or a
+/// window. Documents are read the way a RichTextEditor reads them: HTML with
+/// RichTextEditorHTMLReader, falling back to Cocoa's importer like
+/// +[RichTextEditor attributedStringFromHTMLString:], and dropping the trailing newline like
+/// setHtmlString:. HTML is written with RichTextEditorHTMLWriter, which is also what
+/// -[RichTextEditor htmlString] uses. Bullets, indentation and colors can be cleaned up on the
+/// way with RichTextEditorDocument.
+///
+/// HTML and Markdown inputs are fed to their readers from a stream, and HTML and Markdown outputs
+/// are written by their writers straight to the output file, so neither the input bytes nor the
+/// output bytes of a file are ever in memory as a whole. RTF and plain text are read from a
+/// mapped file and written from a single buffer, as Cocoa's RTF reader and writer need them whole.
+///
+/// Directories are converted by a fixed number of workers. Files are picked up as the directory
+/// is enumerated, and no more than maximumConcurrentFileCount of them are read or held in memory
+/// at once, so a run over millions of files uses the same memory as a run over a hundred.
+/// Outputs are written to a temporary file (the output's name plus .tmp) and renamed into place,
+/// so a run that is stopped never leaves half an output behind, and (with resumes) running again
+/// picks up where it stopped.
+///
+/// HTML that RichTextEditorHTMLReader doesn't understand can only be read by Cocoa on the main
+/// thread. A directory conversion hands such files to the main queue without holding up its
+/// workers, so the main thread must keep running its run loop while a directory is being
+/// converted. The single file methods fail for them when they are called on another thread.
+@interface RichTextEditorBatchConverter : NSObject
+
+@property (nonatomic) RichTextEditorFileFormat sourceFormat;
+@property (nonatomic) RichTextEditorFileFormat destinationFormat;
+
+/// Replace list markers (see +[RichTextEditorDocument commonListMarkers]) with the editor's bullet
+/// and give list items the editor's bullet indentation. Defaults to NO.
+@property (nonatomic) BOOL normalizesBullets;
+
+/// Round indentation to whole indentation steps. Defaults to NO.
+@property (nonatomic) BOOL normalizesIndentation;
+
+/// Remove text and background colors. Defaults to NO.
+@property (nonatomic) BOOL removesColors;
+
+/// Indentation step used for normalizing. 0 (the default) uses the width of a tab in the font
+/// each document starts with, like a new editor does.
+@property (nonatomic) CGFloat indentationSize;
+
+/// Attributes given to plain text input. Defaults to the user's default font. Set it to an editor's
+/// typingAttributes to get what pasting the text into that editor gives. Markdown input is read
+/// in the font set here.
+@property (nonatomic, copy) NSDictionary<NSString *, id> *plainTextAttributes;
+
+/// Number of files converted at the same time. Defaults to the number of active processors.
+@property (nonatomic) NSUInteger maximumConcurrentFileCount;
+
+/// Skip files whose output exists and is at least as new as the file. Defaults to YES.
+@property (nonatomic) BOOL resumes;
+
+/// Extension given to output files; defaults to html, rtf or txt for destinationFormat.
+@property (nonatomic, copy) NSString *destinationPathExtension;
+
+/// Extensions of the files to convert (case insensitive); defaults to html and htm, rtf, or txt
+/// for sourceFormat.
+@property (nonatomic, copy) NSArray<NSString *> *sourcePathExtensions;
+
+/// The report of the running (or last) conversion.
+@property (nonatomic, readonly) RichTextEditorBatchConversionReport *report;
+
+/// Converts every matching file below sourceURL to a file at the same relative path below
+/// destinationURL (which must not be inside sourceURL), creating directories as needed. Returns
+/// at once; completion is called on the main queue when every file has been handled or the run
+/// was cancelled.
+- (void)convertDirectoryAtURL:(NSURL *)sourceURL toURL:(NSURL *)destinationURL
+                   completion:(void (^)(RichTextEditorBatchConversionReport *report))completion;
+
+/// Stops handing out files; files already being converted are finished.
+- (void)cancel;
+
+/// Converts one file, replacing destinationURL. Can be called from any thread.
+- (BOOL)convertFileAtURL:(NSURL *)sourceURL toURL:(NSURL *)destinationURL error:(NSError **)error;
+
+/// The steps convertFileAtURL:toURL:error: takes, on whole documents in memory. Give the same
+/// results as converting a file. Can be called from any thread.
+- (NSAttributedString *)attributedStringFromData:(NSData *)data error:(NSError **)error;
+- (NSAttributedString *)normalizedAttributedString:(NSAttributedString *)string;
+- (NSData *)dataFromAttributedString:(NSAttributedString *)string error:(NSError **)error;
+
+@end
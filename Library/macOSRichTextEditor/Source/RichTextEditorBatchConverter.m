@@ -0,0 +1,590 @@
+//
+//  RichTextEditorBatchConverter.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorBatchConverter.h"
+#import "RichTextEditor.h"
+#import "RichTextEditorDocument.h"
+#import "RichTextEditorHTMLReader.h"
+#import "RichTextEditorHTMLWriter.h"
+#import "RichTextEditorMarkdownReader.h"
+#import "RichTextEditorMarkdownWriter.h"
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static NSUInteger RTEBatchBucketForMicroseconds(uint64_t microseconds) {
+    NSUInteger bucket = 0;
+    while (microseconds > 0 && bucket < RTE_BATCH_CONVERSION_BUCKET_COUNT - 1) {
+        microseconds >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static NSError *RTEBatchConversionPOSIXError(NSString *path) {
+    return [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey: path}];
+}
+
+static NSError *RTEBatchConversionError(NSError *error, NSURL *fileURL) {
+    NSMutableDictionary *userInfo = [error.userInfo mutableCopy] ?: [NSMutableDictionary dictionary];
+    userInfo[NSFilePathErrorKey] = fileURL.path;
+    return [NSError errorWithDomain:(error ? error.domain : NSCocoaErrorDomain)
+                               code:(error ? error.code : NSFileReadCorruptFileError)
+                           userInfo:userInfo];
+}
+
+#pragma mark - Report -
+
+@interface RichTextEditorBatchConversionReport () {
+    _Atomic(uint64_t) _converted;
+    _Atomic(uint64_t) _skipped;
+    _Atomic(uint64_t) _failed;
+    _Atomic(uint64_t) _bytesRead;
+    _Atomic(uint64_t) _bytesWritten;
+    _Atomic(uint64_t) _maxMicroseconds;
+    _Atomic(uint64_t) _buckets[RTE_BATCH_CONVERSION_BUCKET_COUNT];
+    NSTimeInterval _startTime;
+    NSTimeInterval _finishTime;
+}
+
+@property NSMutableArray<NSError *> *recordedFailures;
+
+@end
+
+@implementation RichTextEditorBatchConversionReport
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _recordedFailures = [NSMutableArray array];
+        _maximumRecordedFailures = 1000;
+    }
+    return self;
+}
+
+- (void)start {
+    _startTime = [NSProcessInfo processInfo].systemUptime;
+}
+
+- (void)finish {
+    _finishTime = [NSProcessInfo processInfo].systemUptime;
+}
+
+- (void)recordConvertedFileWithBytesRead:(uint64_t)bytesRead bytesWritten:(uint64_t)bytesWritten duration:(NSTimeInterval)duration {
+    uint64_t microseconds = duration > 0 ? (uint64_t)llround(duration * 1000000.0) : 0;
+    atomic_fetch_add_explicit(&_converted, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_bytesRead, bytesRead, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_bytesWritten, bytesWritten, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_buckets[RTEBatchBucketForMicroseconds(microseconds)], 1, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&_maxMicroseconds, memory_order_relaxed);
+    while (microseconds > max &&
+           !atomic_compare_exchange_weak_explicit(&_maxMicroseconds, &max, microseconds, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+- (void)recordSkippedFile {
+    atomic_fetch_add_explicit(&_skipped, 1, memory_order_relaxed);
+}
+
+- (void)recordFailure:(NSError *)error {
+    atomic_fetch_add_explicit(&_failed, 1, memory_order_relaxed);
+    @synchronized (self.recordedFailures) {
+        if (self.recordedFailures.count < self.maximumRecordedFailures) {
+            [self.recordedFailures addObject:error];
+        }
+    }
+}
+
+- (NSUInteger)convertedCount {
+    return (NSUInteger)atomic_load_explicit(&_converted, memory_order_relaxed);
+}
+
+- (NSUInteger)skippedCount {
+    return (NSUInteger)atomic_load_explicit(&_skipped, memory_order_relaxed);
+}
+
+- (NSUInteger)failedCount {
+    return (NSUInteger)atomic_load_explicit(&_failed, memory_order_relaxed);
+}
+
+- (unsigned long long)bytesRead {
+    return atomic_load_explicit(&_bytesRead, memory_order_relaxed);
+}
+
+- (unsigned long long)bytesWritten {
+    return atomic_load_explicit(&_bytesWritten, memory_order_relaxed);
+}
+
+- (uint64_t)maximumLatencyMicroseconds {
+    return atomic_load_explicit(&_maxMicroseconds, memory_order_relaxed);
+}
+
+- (NSTimeInterval)elapsedTime {
+    if (_startTime == 0) {
+        return 0;
+    }
+    return (_finishTime > 0 ? _finishTime : [NSProcessInfo processInfo].systemUptime) - _startTime;
+}
+
+- (double)filesPerSecond {
+    NSTimeInterval elapsedTime = self.elapsedTime;
+    return elapsedTime > 0 ? self.convertedCount / elapsedTime : 0;
+}
+
+- (NSArray<NSError *> *)failures {
+    @synchronized (self.recordedFailures) {
+        return [self.recordedFailures copy];
+    }
+}
+
+- (NSArray<NSNumber *> *)latencyHistogram {
+    NSMutableArray *histogram = [NSMutableArray arrayWithCapacity:RTE_BATCH_CONVERSION_BUCKET_COUNT];
+    for (NSUInteger i = 0; i < RTE_BATCH_CONVERSION_BUCKET_COUNT; i++) {
+        [histogram addObject:@(atomic_load_explicit(&_buckets[i], memory_order_relaxed))];
+    }
+    return histogram;
+}
+
+- (uint64_t)latencyMicrosecondsAtPercentile:(double)percentile {
+    NSArray<NSNumber *> *histogram = [self latencyHistogram];
+    uint64_t total = 0;
+    for (NSNumber *count in histogram) {
+        total += count.unsignedLongLongValue;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = MAX((uint64_t)ceil(percentile * total), (uint64_t)1);
+    uint64_t seen = 0;
+    for (NSUInteger i = 0; i < histogram.count; i++) {
+        seen += histogram[i].unsignedLongLongValue;
+        if (seen >= rank) {
+            return (uint64_t)1 << i;
+        }
+    }
+    return (uint64_t)1 << (histogram.count - 1);
+}
+
+- (NSDictionary *)snapshot {
+    NSMutableArray *failures = [NSMutableArray array];
+    for (NSError *error in self.failures) {
+        [failures addObject:@{@"path": error.userInfo[NSFilePathErrorKey] ?: @"",
+                              @"error": error.localizedDescription ?: @""}];
+    }
+    return @{@"converted": @(self.convertedCount),
+             @"skipped": @(self.skippedCount),
+             @"failed": @(self.failedCount),
+             @"bytesRead": @(self.bytesRead),
+             @"bytesWritten": @(self.bytesWritten),
+             @"elapsedSeconds": @(self.elapsedTime),
+             @"filesPerSecond": @(self.filesPerSecond),
+             @"p50Microseconds": @([self latencyMicrosecondsAtPercentile:0.50]),
+             @"p99Microseconds": @([self latencyMicrosecondsAtPercentile:0.99]),
+             @"maxMicroseconds": @(self.maximumLatencyMicroseconds),
+             @"histogram": [self latencyHistogram],
+             @"failures": failures};
+}
+
+- (NSData *)JSONData {
+    return [NSJSONSerialization dataWithJSONObject:[self snapshot] options:NSJSONWritingPrettyPrinted error:nil];
+}
+
+@end
+
+#pragma mark - Converter -
+
+@interface RichTextEditorBatchConverter ()
+
+@property (nonatomic, readwrite) RichTextEditorBatchConversionReport *report;
+@property (atomic) BOOL cancelled;
+
+@end
+
+@implementation RichTextEditorBatchConverter
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _sourceFormat = RichTextEditorFileFormatHTML;
+        _destinationFormat = RichTextEditorFileFormatHTML;
+        _plainTextAttributes = @{NSFontAttributeName: [NSFont userFontOfSize:0]};
+        _maximumConcurrentFileCount = [NSProcessInfo processInfo].activeProcessorCount;
+        _resumes = YES;
+    }
+    return self;
+}
+
++ (NSArray<NSString *> *)pathExtensionsForFormat:(RichTextEditorFileFormat)format {
+    switch (format) {
+        case RichTextEditorFileFormatHTML:
+            return @[@"html", @"htm"];
+        case RichTextEditorFileFormatRTF:
+            return @[@"rtf"];
+        case RichTextEditorFileFormatPlainText:
+            return @[@"txt"];
+        case RichTextEditorFileFormatMarkdown:
+            return @[@"md", @"markdown"];
+    }
+    return @[];
+}
+
+- (NSString *)destinationPathExtension {
+    return _destinationPathExtension ?: [RichTextEditorBatchConverter pathExtensionsForFormat:self.destinationFormat].firstObject;
+}
+
+- (NSArray<NSString *> *)sourcePathExtensions {
+    return _sourcePathExtensions ?: [RichTextEditorBatchConverter pathExtensionsForFormat:self.sourceFormat];
+}
+
+- (void)cancel {
+    self.cancelled = YES;
+}
+
+#pragma mark - Directories
+
+- (void)convertDirectoryAtURL:(NSURL *)sourceURL toURL:(NSURL *)destinationURL
+                   completion:(void (^)(RichTextEditorBatchConversionReport *report))completion {
+    RichTextEditorBatchConversionReport *report = [[RichTextEditorBatchConversionReport alloc] init];
+    self.report = report;
+    self.cancelled = NO;
+    [report start];
+
+    NSMutableSet *extensions = [NSMutableSet set];
+    for (NSString *extension in self.sourcePathExtensions) {
+        [extensions addObject:extension.lowercaseString];
+    }
+    NSString *destinationExtension = self.destinationPathExtension;
+    BOOL resumes = self.resumes;
+    // The enumeration only runs ahead of the workers by the files they are converting, so
+    // memory stays flat however large the directory is
+    dispatch_semaphore_t slots = dispatch_semaphore_create((long)MAX(self.maximumConcurrentFileCount, (NSUInteger)1));
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t workers = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_queue_t enumerationQueue = dispatch_queue_create("com.pikleproductions.macOSRichTextEditor.batchConverter", DISPATCH_QUEUE_SERIAL);
+
+    dispatch_async(enumerationQueue, ^{
+        NSFileManager *fileManager = [[NSFileManager alloc] init];
+        NSDirectoryEnumerator *enumerator = [fileManager enumeratorAtPath:sourceURL.path];
+        if (!enumerator) {
+            [report recordFailure:RTEBatchConversionError([NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadNoSuchFileError userInfo:nil], sourceURL)];
+        }
+        while (!self.cancelled) {
+            @autoreleasepool {
+                NSString *relativePath = [enumerator nextObject];
+                if (!relativePath) {
+                    break;
+                }
+                NSDictionary *attributes = enumerator.fileAttributes;
+                if (![attributes.fileType isEqualToString:NSFileTypeRegular] ||
+                    ![extensions containsObject:relativePath.pathExtension.lowercaseString]) {
+                    continue;
+                }
+                NSURL *fileURL = [sourceURL URLByAppendingPathComponent:relativePath];
+                NSURL *outputURL = [[[destinationURL URLByAppendingPathComponent:relativePath] URLByDeletingPathExtension]
+                                    URLByAppendingPathExtension:destinationExtension];
+                if (resumes) {
+                    NSDate *outputDate = [fileManager attributesOfItemAtPath:outputURL.path error:NULL].fileModificationDate;
+                    if (outputDate && [outputDate compare:attributes.fileModificationDate] != NSOrderedAscending) {
+                        [report recordSkippedFile];
+                        continue;
+                    }
+                }
+                dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+                dispatch_group_enter(group);
+                dispatch_async(workers, ^{
+                    @autoreleasepool {
+                        [self convertFileAtURL:fileURL toURL:outputURL report:report completion:^{
+                            dispatch_semaphore_signal(slots);
+                            dispatch_group_leave(group);
+                        }];
+                    }
+                });
+            }
+        }
+        dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+            [report finish];
+            if (completion) {
+                completion(report);
+            }
+        });
+    });
+}
+
+// Calls completion once the file has been converted or has failed. HTML that only Cocoa can read
+// is handed to the main queue and finished on a worker afterwards, rather than holding up this
+// worker while the main thread gets to it.
+- (void)convertFileAtURL:(NSURL *)sourceURL toURL:(NSURL *)destinationURL report:(RichTextEditorBatchConversionReport *)report
+              completion:(void (^)(void))completion {
+    NSTimeInterval startTime = [NSProcessInfo processInfo].systemUptime;
+    NSError *error;
+    NSUInteger bytesRead = 0;
+    BOOL needsMainThread = NO;
+    NSAttributedString *string = [self attributedStringFromFileAtURL:sourceURL bytesRead:&bytesRead needsMainThread:&needsMainThread error:&error];
+    if (!string && needsMainThread) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            NSError *mainError;
+            NSUInteger mainBytesRead = 0;
+            NSAttributedString *mainString = [self attributedStringFromFileAtURL:sourceURL bytesRead:&mainBytesRead needsMainThread:NULL error:&mainError];
+            dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+                @autoreleasepool {
+                    [self finishConvertingAttributedString:mainString fromURL:sourceURL toURL:destinationURL report:report
+                                                 bytesRead:mainBytesRead startTime:startTime error:mainError];
+                }
+                completion();
+            });
+        });
+        return;
+    }
+    [self finishConvertingAttributedString:string fromURL:sourceURL toURL:destinationURL report:report
+                                 bytesRead:bytesRead startTime:startTime error:error];
+    completion();
+}
+
+- (void)finishConvertingAttributedString:(NSAttributedString *)string fromURL:(NSURL *)sourceURL toURL:(NSURL *)destinationURL
+                                  report:(RichTextEditorBatchConversionReport *)report
+                               bytesRead:(NSUInteger)bytesRead startTime:(NSTimeInterval)startTime error:(NSError *)error {
+    NSUInteger bytesWritten = 0;
+    if (string && [self writeAttributedString:string toURL:destinationURL bytesWritten:&bytesWritten error:&error]) {
+        [report recordConvertedFileWithBytesRead:bytesRead bytesWritten:bytesWritten
+                                        duration:[NSProcessInfo processInfo].systemUptime - startTime];
+    }
+    else {
+        [report recordFailure:RTEBatchConversionError(error, sourceURL)];
+    }
+}
+
+#pragma mark - Files
+
+- (BOOL)convertFileAtURL:(NSURL *)sourceURL toURL:(NSURL *)destinationURL error:(NSError **)error {
+    NSError *conversionError;
+    if ([self convertFileAtURL:sourceURL toURL:destinationURL bytesRead:NULL bytesWritten:NULL error:&conversionError]) {
+        return YES;
+    }
+    if (error) {
+        *error = RTEBatchConversionError(conversionError, sourceURL);
+    }
+    return NO;
+}
+
+- (BOOL)convertFileAtURL:(NSURL *)sourceURL toURL:(NSURL *)destinationURL
+               bytesRead:(NSUInteger *)bytesRead bytesWritten:(NSUInteger *)bytesWritten error:(NSError **)error {
+    NSAttributedString *string = [self attributedStringFromFileAtURL:sourceURL bytesRead:bytesRead needsMainThread:NULL error:error];
+    if (!string) {
+        return NO;
+    }
+    return [self writeAttributedString:string toURL:destinationURL bytesWritten:bytesWritten error:error];
+}
+
+// needsMainThread is set to YES if the file couldn't be read here but may be on the main thread
+- (NSAttributedString *)attributedStringFromFileAtURL:(NSURL *)sourceURL bytesRead:(NSUInteger *)bytesRead
+                                      needsMainThread:(BOOL *)needsMainThread error:(NSError **)error {
+    NSNumber *fileSize;
+    if (![sourceURL getResourceValue:&fileSize forKey:NSURLFileSizeKey error:error]) {
+        return nil;
+    }
+    NSAttributedString *string;
+    switch (self.sourceFormat) {
+        case RichTextEditorFileFormatHTML:
+        case RichTextEditorFileFormatMarkdown:
+            // Fed to the reader a chunk at a time, so the file is never in memory as a whole
+            string = [self attributedStringFromStreamAtURL:sourceURL needsMainThread:needsMainThread error:error];
+            break;
+        case RichTextEditorFileFormatRTF:
+        case RichTextEditorFileFormatPlainText: {
+            // Cocoa's RTF reader and NSString need all of it; mapped, so only the pages read are loaded
+            NSData *data = [NSData dataWithContentsOfURL:sourceURL options:NSDataReadingMappedIfSafe error:error];
+            string = data ? [self attributedStringFromData:data error:error] : nil;
+            break;
+        }
+    }
+    if (string && bytesRead) {
+        *bytesRead = fileSize.unsignedIntegerValue;
+    }
+    return string;
+}
+
+- (NSAttributedString *)attributedStringFromStreamAtURL:(NSURL *)sourceURL needsMainThread:(BOOL *)needsMainThread error:(NSError **)error {
+    NSInputStream *stream = [NSInputStream inputStreamWithURL:sourceURL];
+    [stream open];
+    NSAttributedString *string;
+    BOOL isUnsupported = NO;
+    if (self.sourceFormat == RichTextEditorFileFormatHTML) {
+        RichTextEditorHTMLReader *reader = [[RichTextEditorHTMLReader alloc] init];
+        NSMutableAttributedString *attr = [[reader attributedStringFromStream:stream] mutableCopy];
+        if ([attr.string hasSuffix:@"\n"]) { // same as setHtmlString:
+            [attr replaceCharactersInRange:NSMakeRange(attr.length - 1, 1) withString:@""];
+        }
+        string = attr;
+        isUnsupported = (reader.unsupportedMarkup != nil);
+    }
+    else {
+        RichTextEditorMarkdownReader *reader = [[RichTextEditorMarkdownReader alloc] init];
+        if (self.plainTextAttributes[NSFontAttributeName]) {
+            reader.font = self.plainTextAttributes[NSFontAttributeName];
+        }
+        string = [reader attributedStringFromStream:stream];
+    }
+    NSError *streamError = stream.streamStatus == NSStreamStatusError ? stream.streamError : nil;
+    [stream close];
+    if (string) {
+        return string;
+    }
+    if (isUnsupported && !streamError) {
+        if ([NSThread isMainThread]) {
+            // Only Cocoa's importer can read it, and it needs the whole file
+            NSData *data = [NSData dataWithContentsOfURL:sourceURL options:NSDataReadingMappedIfSafe error:error];
+            return data ? [self attributedStringFromData:data error:error] : nil;
+        }
+        if (needsMainThread) {
+            *needsMainThread = YES;
+        }
+    }
+    if (error) {
+        *error = streamError ?: [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError
+                                                userInfo:isUnsupported ? @{NSLocalizedFailureReasonErrorKey: @"The HTML can only be read by Cocoa's HTML importer, which has to run on the main thread."} : nil];
+    }
+    return nil;
+}
+
+// Written to a temporary file next to the destination and renamed into place, so the
+// destination never holds half a document. HTML and Markdown are written straight to the file
+// through the writers' buffers rather than built in memory first.
+- (BOOL)writeAttributedString:(NSAttributedString *)string toURL:(NSURL *)destinationURL
+                 bytesWritten:(NSUInteger *)bytesWritten error:(NSError **)error {
+    NSAttributedString *normalizedString = [self normalizedAttributedString:string];
+    NSFileManager *fileManager = [[NSFileManager alloc] init];
+    if (![fileManager createDirectoryAtURL:[destinationURL URLByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:error]) {
+        return NO;
+    }
+    NSString *path = destinationURL.path;
+    NSString *temporaryPath = [path stringByAppendingPathExtension:@"tmp"];
+    BOOL written = NO;
+    switch (self.destinationFormat) {
+        case RichTextEditorFileFormatHTML: {
+            NSOutputStream *stream = [NSOutputStream outputStreamToFileAtPath:temporaryPath append:NO];
+            written = [[[RichTextEditorHTMLWriter alloc] initWithAttributedString:normalizedString] writeToStream:stream error:error];
+            break;
+        }
+        case RichTextEditorFileFormatMarkdown: {
+            int fd = open(temporaryPath.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                if (error) {
+                    *error = RTEBatchConversionPOSIXError(temporaryPath);
+                }
+                return NO;
+            }
+            NSFileHandle *fileHandle = [[NSFileHandle alloc] initWithFileDescriptor:fd closeOnDealloc:YES];
+            written = [[[RichTextEditorMarkdownWriter alloc] initWithAttributedString:normalizedString] writeToFileHandle:fileHandle error:error];
+            [fileHandle closeFile];
+            break;
+        }
+        case RichTextEditorFileFormatRTF:
+        case RichTextEditorFileFormatPlainText: {
+            NSData *output = [self dataFromAttributedString:normalizedString error:error];
+            written = output && [output writeToFile:temporaryPath options:0 error:error];
+            break;
+        }
+    }
+    unsigned long long fileSize = written ? [fileManager attributesOfItemAtPath:temporaryPath error:NULL].fileSize : 0;
+    if (written && rename(temporaryPath.fileSystemRepresentation, path.fileSystemRepresentation) != 0) {
+        if (error) {
+            *error = RTEBatchConversionPOSIXError(path);
+        }
+        written = NO;
+    }
+    if (!written) {
+        unlink(temporaryPath.fileSystemRepresentation);
+        return NO;
+    }
+    if (bytesWritten) {
+        *bytesWritten = (NSUInteger)fileSize;
+    }
+    return YES;
+}
+
+- (NSAttributedString *)attributedStringFromData:(NSData *)data error:(NSError **)error {
+    NSAttributedString *string;
+    switch (self.sourceFormat) {
+        case RichTextEditorFileFormatHTML: {
+            NSString *html = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+            NSMutableAttributedString *attr = html ? [[RichTextEditor attributedStringFromHTMLString:html] mutableCopy] : nil;
+            if ([attr.string hasSuffix:@"\n"]) { // same as setHtmlString:
+                [attr replaceCharactersInRange:NSMakeRange(attr.length - 1, 1) withString:@""];
+            }
+            string = attr;
+            break;
+        }
+        case RichTextEditorFileFormatRTF:
+            string = [[NSAttributedString alloc] initWithRTF:data documentAttributes:NULL];
+            break;
+        case RichTextEditorFileFormatPlainText: {
+            NSString *text = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+            string = text ? [[NSAttributedString alloc] initWithString:text attributes:self.plainTextAttributes] : nil;
+            break;
+        }
+        case RichTextEditorFileFormatMarkdown: {
+            RichTextEditorMarkdownReader *reader = [[RichTextEditorMarkdownReader alloc] init];
+            if (self.plainTextAttributes[NSFontAttributeName]) {
+                reader.font = self.plainTextAttributes[NSFontAttributeName];
+            }
+            [reader appendData:data];
+            string = [reader finish];
+            break;
+        }
+    }
+    if (!string && error) {
+        NSDictionary *userInfo = nil;
+        if (self.sourceFormat == RichTextEditorFileFormatHTML && ![NSThread isMainThread]) {
+            userInfo = @{NSLocalizedFailureReasonErrorKey: @"The HTML can only be read by Cocoa's HTML importer, which has to run on the main thread."};
+        }
+        *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:userInfo];
+    }
+    return string;
+}
+
+- (NSAttributedString *)normalizedAttributedString:(NSAttributedString *)string {
+    if (!self.normalizesBullets && !self.normalizesIndentation && !self.removesColors) {
+        return string;
+    }
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:string];
+    if (self.indentationSize > 0) {
+        document.defaultIndentationSize = self.indentationSize;
+        document.maximumIndentation = self.indentationSize * 10;
+    }
+    if (self.normalizesBullets) {
+        [document normalizeBulletsWithListMarkers:[RichTextEditorDocument commonListMarkers]];
+    }
+    if (self.normalizesIndentation) {
+        [document normalizeIndentation];
+    }
+    if (self.removesColors) {
+        [document removeColors];
+    }
+    return document.textStorage;
+}
+
+- (NSData *)dataFromAttributedString:(NSAttributedString *)string error:(NSError **)error {
+    NSData *data;
+    switch (self.destinationFormat) {
+        case RichTextEditorFileFormatHTML:
+            data = [[[[RichTextEditorHTMLWriter alloc] initWithAttributedString:string] htmlString] dataUsingEncoding:NSUTF8StringEncoding];
+            break;
+        case RichTextEditorFileFormatRTF:
+            data = [string RTFFromRange:NSMakeRange(0, string.length) documentAttributes:@{}];
+            break;
+        case RichTextEditorFileFormatPlainText:
+            data = [string.string dataUsingEncoding:NSUTF8StringEncoding];
+            break;
+        case RichTextEditorFileFormatMarkdown:
+            data = [[[[RichTextEditorMarkdownWriter alloc] initWithAttributedString:string] markdownString] dataUsingEncoding:NSUTF8StringEncoding];
+            break;
+    }
+    if (!data && error) {
+        *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:nil];
+    }
+    return data;
+}
+
+@end
@@ -0,0 +1,64 @@
+//
+//  RichTextEditorBinaryDocument.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+/// Current version of the binary document format. Readers refuse files with a newer version.
+#define RTE_BINARY_DOCUMENT_VERSION 1
+
+/// Compact binary encoding of an attributed string, used to save and load documents and as the
+/// payload of +[RichTextEditor pasteboardDataType].
+///
+/// A file is a fixed size header followed by three sections, all little endian:
+///
+/// - the text as UTF-16 code units, so any range of it can be read without decoding the rest;
+/// - an attribute table with one entry per distinct attribute dictionary (font, colors,
+///   underline/strikethrough, paragraph style including tab stops and list markers, link,
+///   superscript, baseline offset, kern), each entry found through an offset table;
+/// - the attribute runs, as (start location, attribute table index) pairs sorted by location.
+///
+/// Other attributes (e.g. attachments) are not stored. Attribute values inside an entry are
+/// tagged and sized, so readers skip values they don't know.
+///
+/// initWithData:error: only checks the header and section bounds; text, attribute entries and
+/// runs are decoded when asked for, and only the parts needed for the requested range.
+/// Together with initWithContentsOfURL:error: (which memory maps the file) this means opening
+/// a large document doesn't read the whole file up front. Decoded attribute entries are kept,
+/// so a document instance must only be used from one thread at a time.
+@interface RichTextEditorBinaryDocument : NSObject
+
+/// Length of the text, in UTF-16 code units (like NSString).
+@property (nonatomic, readonly) NSUInteger length;
+
+/// Number of attribute runs.
+@property (nonatomic, readonly) NSUInteger runCount;
+
+/// Number of distinct attribute dictionaries.
+@property (nonatomic, readonly) NSUInteger attributeTableCount;
+
+@property (nonatomic, readonly) NSData *data;
+
+/// Encodes string in the binary format.
++ (NSData *)dataWithAttributedString:(NSAttributedString *)string;
+
+/// Encodes string and writes it atomically to the given file URL.
++ (BOOL)writeAttributedString:(NSAttributedString *)string toURL:(NSURL *)url error:(NSError **)error;
+
+/// Returns nil (with an NSFileReadCorruptFileError) if data is not a binary document this
+/// version can read.
+- (instancetype)initWithData:(NSData *)data error:(NSError **)error;
+
+/// Memory maps the file when possible and then behaves like initWithData:error:.
+- (instancetype)initWithContentsOfURL:(NSURL *)url error:(NSError **)error;
+
+/// Decodes the whole document. Returns nil if the text or runs turn out to be corrupt.
+- (NSAttributedString *)attributedStringWithError:(NSError **)error;
+
+/// Decodes only the text and runs that overlap range (clamped to the document).
+- (NSAttributedString *)attributedSubstringFromRange:(NSRange)range error:(NSError **)error;
+
+@end
@@ -0,0 +1,656 @@
+//
+//  RichTextEditorBinaryDocument.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorBinaryDocument.h"
+
+// Header (all little endian):
+//    0  char[4]  magic "RTEB"
+//    4  uint16   version
+//    6  uint16   header size
+//    8  uint32   text length (UTF-16 code units)
+//   12  uint32   attribute table count
+//   16  uint32   run count
+//   20  uint32   reserved (0)
+//   24  uint64   text offset
+//   32  uint64   attribute offsets offset (table count + 1 uint32s, relative to the attribute data)
+//   40  uint64   attribute data offset
+//   48  uint64   runs offset (run count pairs of uint32 start location, uint32 table index)
+#define RTE_BINARY_HEADER_SIZE 56
+
+// An attribute table entry is a uint16 value count followed by that many values, each a uint8
+// tag, a uint32 payload length and the payload.
+typedef NS_ENUM(uint8_t, RTEBinaryAttributeTag) {
+    RTEBinaryAttributeFont = 1,                // double point size, string PostScript name
+    RTEBinaryAttributeForegroundColor = 2,     // 4 doubles, sRGB + alpha
+    RTEBinaryAttributeBackgroundColor = 3,
+    RTEBinaryAttributeUnderlineColor = 4,
+    RTEBinaryAttributeStrikethroughColor = 5,
+    RTEBinaryAttributeUnderlineStyle = 6,      // int64
+    RTEBinaryAttributeStrikethroughStyle = 7,
+    RTEBinaryAttributeSuperscript = 8,
+    RTEBinaryAttributeBaselineOffset = 9,      // double
+    RTEBinaryAttributeKern = 10,
+    RTEBinaryAttributeParagraphStyle = 11,     // see RTEAppendParagraphStyle
+    RTEBinaryAttributeLink = 12,               // uint8 1 for NSURL/0 for NSString, string
+};
+
+// Strings inside payloads are a uint32 byte count followed by UTF-8.
+
+#pragma mark - Writing
+
+static void RTEAppendUInt8(NSMutableData *data, uint8_t value) {
+    [data appendBytes:&value length:sizeof(value)];
+}
+
+static void RTEAppendUInt16(NSMutableData *data, uint16_t value) {
+    value = CFSwapInt16HostToLittle(value);
+    [data appendBytes:&value length:sizeof(value)];
+}
+
+static void RTEAppendUInt32(NSMutableData *data, uint32_t value) {
+    value = CFSwapInt32HostToLittle(value);
+    [data appendBytes:&value length:sizeof(value)];
+}
+
+static void RTEAppendUInt64(NSMutableData *data, uint64_t value) {
+    value = CFSwapInt64HostToLittle(value);
+    [data appendBytes:&value length:sizeof(value)];
+}
+
+static void RTEAppendDouble(NSMutableData *data, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    RTEAppendUInt64(data, bits);
+}
+
+static void RTEAppendString(NSMutableData *data, NSString *string) {
+    NSData *utf8 = [string dataUsingEncoding:NSUTF8StringEncoding] ?: [NSData data];
+    RTEAppendUInt32(data, (uint32_t)utf8.length);
+    [data appendData:utf8];
+}
+
+static void RTEPadData(NSMutableData *data, NSUInteger alignment) {
+    if (data.length % alignment != 0) {
+        [data increaseLengthBy:alignment - data.length % alignment];
+    }
+}
+
+// Values are written as tag, length placeholder, payload; the length is filled in afterwards
+static NSUInteger RTEBeginValue(NSMutableData *data, RTEBinaryAttributeTag tag) {
+    RTEAppendUInt8(data, tag);
+    RTEAppendUInt32(data, 0);
+    return data.length;
+}
+
+static void RTEEndValue(NSMutableData *data, NSUInteger payloadStart, uint16_t *valueCount) {
+    uint32_t length = CFSwapInt32HostToLittle((uint32_t)(data.length - payloadStart));
+    [data replaceBytesInRange:NSMakeRange(payloadStart - sizeof(length), sizeof(length)) withBytes:&length];
+    (*valueCount)++;
+}
+
+static void RTEAppendColor(NSMutableData *data, RTEBinaryAttributeTag tag, id value, uint16_t *valueCount) {
+    if (![value isKindOfClass:[NSColor class]]) {
+        return;
+    }
+    // Pattern and catalog colors without an sRGB equivalent are dropped
+    NSColor *color = [(NSColor *)value colorUsingColorSpace:[NSColorSpace sRGBColorSpace]];
+    if (!color) {
+        return;
+    }
+    NSUInteger start = RTEBeginValue(data, tag);
+    RTEAppendDouble(data, color.redComponent);
+    RTEAppendDouble(data, color.greenComponent);
+    RTEAppendDouble(data, color.blueComponent);
+    RTEAppendDouble(data, color.alphaComponent);
+    RTEEndValue(data, start, valueCount);
+}
+
+static void RTEAppendInteger(NSMutableData *data, RTEBinaryAttributeTag tag, id value, uint16_t *valueCount) {
+    if (![value isKindOfClass:[NSNumber class]]) {
+        return;
+    }
+    NSUInteger start = RTEBeginValue(data, tag);
+    RTEAppendUInt64(data, (uint64_t)[value longLongValue]);
+    RTEEndValue(data, start, valueCount);
+}
+
+static void RTEAppendFloatingPoint(NSMutableData *data, RTEBinaryAttributeTag tag, id value, uint16_t *valueCount) {
+    if (![value isKindOfClass:[NSNumber class]]) {
+        return;
+    }
+    NSUInteger start = RTEBeginValue(data, tag);
+    RTEAppendDouble(data, [value doubleValue]);
+    RTEEndValue(data, start, valueCount);
+}
+
+// uint8 alignment, int8 writing direction, uint8 line break mode, uint8 reserved,
+// 11 doubles (see below), uint32 tab stop count + (uint8 alignment, double location) each,
+// uint32 text list count + (uint64 options, string marker format) each
+static void RTEAppendParagraphStyle(NSMutableData *data, id value, uint16_t *valueCount) {
+    if (![value isKindOfClass:[NSParagraphStyle class]]) {
+        return;
+    }
+    NSParagraphStyle *style = value;
+    NSUInteger start = RTEBeginValue(data, RTEBinaryAttributeParagraphStyle);
+    RTEAppendUInt8(data, (uint8_t)style.alignment);
+    RTEAppendUInt8(data, (uint8_t)(int8_t)style.baseWritingDirection);
+    RTEAppendUInt8(data, (uint8_t)style.lineBreakMode);
+    RTEAppendUInt8(data, 0);
+    RTEAppendDouble(data, style.firstLineHeadIndent);
+    RTEAppendDouble(data, style.headIndent);
+    RTEAppendDouble(data, style.tailIndent);
+    RTEAppendDouble(data, style.lineSpacing);
+    RTEAppendDouble(data, style.paragraphSpacing);
+    RTEAppendDouble(data, style.paragraphSpacingBefore);
+    RTEAppendDouble(data, style.lineHeightMultiple);
+    RTEAppendDouble(data, style.minimumLineHeight);
+    RTEAppendDouble(data, style.maximumLineHeight);
+    RTEAppendDouble(data, style.defaultTabInterval);
+    RTEAppendDouble(data, style.hyphenationFactor);
+    RTEAppendUInt32(data, (uint32_t)style.tabStops.count);
+    for (NSTextTab *tab in style.tabStops) {
+        RTEAppendUInt8(data, (uint8_t)tab.alignment);
+        RTEAppendDouble(data, tab.location);
+    }
+    RTEAppendUInt32(data, (uint32_t)style.textLists.count);
+    for (NSTextList *list in style.textLists) {
+        RTEAppendUInt64(data, list.listOptions);
+        RTEAppendString(data, list.markerFormat);
+    }
+    RTEEndValue(data, start, valueCount);
+}
+
+static NSData *RTEEncodeAttributes(NSDictionary *attributes) {
+    NSMutableData *data = [NSMutableData dataWithLength:sizeof(uint16_t)]; // value count, filled in at the end
+    uint16_t valueCount = 0;
+    NSFont *font = attributes[NSFontAttributeName];
+    if ([font isKindOfClass:[NSFont class]]) {
+        NSUInteger start = RTEBeginValue(data, RTEBinaryAttributeFont);
+        RTEAppendDouble(data, font.pointSize);
+        RTEAppendString(data, font.fontName);
+        RTEEndValue(data, start, &valueCount);
+    }
+    RTEAppendColor(data, RTEBinaryAttributeForegroundColor, attributes[NSForegroundColorAttributeName], &valueCount);
+    RTEAppendColor(data, RTEBinaryAttributeBackgroundColor, attributes[NSBackgroundColorAttributeName], &valueCount);
+    RTEAppendColor(data, RTEBinaryAttributeUnderlineColor, attributes[NSUnderlineColorAttributeName], &valueCount);
+    RTEAppendColor(data, RTEBinaryAttributeStrikethroughColor, attributes[NSStrikethroughColorAttributeName], &valueCount);
+    RTEAppendInteger(data, RTEBinaryAttributeUnderlineStyle, attributes[NSUnderlineStyleAttributeName], &valueCount);
+    RTEAppendInteger(data, RTEBinaryAttributeStrikethroughStyle, attributes[NSStrikethroughStyleAttributeName], &valueCount);
+    RTEAppendInteger(data, RTEBinaryAttributeSuperscript, attributes[NSSuperscriptAttributeName], &valueCount);
+    RTEAppendFloatingPoint(data, RTEBinaryAttributeBaselineOffset, attributes[NSBaselineOffsetAttributeName], &valueCount);
+    RTEAppendFloatingPoint(data, RTEBinaryAttributeKern, attributes[NSKernAttributeName], &valueCount);
+    RTEAppendParagraphStyle(data, attributes[NSParagraphStyleAttributeName], &valueCount);
+    id link = attributes[NSLinkAttributeName];
+    if ([link isKindOfClass:[NSURL class]] || [link isKindOfClass:[NSString class]]) {
+        NSUInteger start = RTEBeginValue(data, RTEBinaryAttributeLink);
+        BOOL isURL = [link isKindOfClass:[NSURL class]];
+        RTEAppendUInt8(data, isURL ? 1 : 0);
+        RTEAppendString(data, isURL ? [link absoluteString] : link);
+        RTEEndValue(data, start, &valueCount);
+    }
+    valueCount = CFSwapInt16HostToLittle(valueCount);
+    [data replaceBytesInRange:NSMakeRange(0, sizeof(valueCount)) withBytes:&valueCount];
+    return data;
+}
+
+#pragma mark - Reading
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger position;
+    BOOL failed;
+} RTEBinaryCursor;
+
+static const uint8_t *RTEReadBytes(RTEBinaryCursor *cursor, NSUInteger count) {
+    if (cursor->failed || count > cursor->length - cursor->position) {
+        cursor->failed = YES;
+        return NULL;
+    }
+    const uint8_t *bytes = cursor->bytes + cursor->position;
+    cursor->position += count;
+    return bytes;
+}
+
+static uint8_t RTEReadUInt8(RTEBinaryCursor *cursor) {
+    const uint8_t *bytes = RTEReadBytes(cursor, 1);
+    return bytes ? bytes[0] : 0;
+}
+
+static uint16_t RTEReadUInt16(RTEBinaryCursor *cursor) {
+    uint16_t value = 0;
+    const uint8_t *bytes = RTEReadBytes(cursor, sizeof(value));
+    if (bytes) {
+        memcpy(&value, bytes, sizeof(value));
+    }
+    return CFSwapInt16LittleToHost(value);
+}
+
+static uint32_t RTEReadUInt32(RTEBinaryCursor *cursor) {
+    uint32_t value = 0;
+    const uint8_t *bytes = RTEReadBytes(cursor, sizeof(value));
+    if (bytes) {
+        memcpy(&value, bytes, sizeof(value));
+    }
+    return CFSwapInt32LittleToHost(value);
+}
+
+static uint64_t RTEReadUInt64(RTEBinaryCursor *cursor) {
+    uint64_t value = 0;
+    const uint8_t *bytes = RTEReadBytes(cursor, sizeof(value));
+    if (bytes) {
+        memcpy(&value, bytes, sizeof(value));
+    }
+    return CFSwapInt64LittleToHost(value);
+}
+
+static double RTEReadDouble(RTEBinaryCursor *cursor) {
+    uint64_t bits = RTEReadUInt64(cursor);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static NSString *RTEReadString(RTEBinaryCursor *cursor) {
+    uint32_t length = RTEReadUInt32(cursor);
+    const uint8_t *bytes = RTEReadBytes(cursor, length);
+    if (!bytes) {
+        return nil;
+    }
+    NSString *string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    if (!string) {
+        cursor->failed = YES;
+    }
+    return string;
+}
+
+static uint32_t RTEUInt32AtOffset(const uint8_t *bytes, NSUInteger offset) {
+    uint32_t value;
+    memcpy(&value, bytes + offset, sizeof(value));
+    return CFSwapInt32LittleToHost(value);
+}
+
+static NSColor *RTEReadColor(RTEBinaryCursor *cursor) {
+    double red = RTEReadDouble(cursor);
+    double green = RTEReadDouble(cursor);
+    double blue = RTEReadDouble(cursor);
+    double alpha = RTEReadDouble(cursor);
+    return cursor->failed ? nil : [NSColor colorWithSRGBRed:red green:green blue:blue alpha:alpha];
+}
+
+static NSParagraphStyle *RTEReadParagraphStyle(RTEBinaryCursor *cursor) {
+    NSMutableParagraphStyle *style = [[NSMutableParagraphStyle alloc] init];
+    style.alignment = (NSTextAlignment)RTEReadUInt8(cursor);
+    style.baseWritingDirection = (NSWritingDirection)(int8_t)RTEReadUInt8(cursor);
+    style.lineBreakMode = (NSLineBreakMode)RTEReadUInt8(cursor);
+    RTEReadUInt8(cursor);
+    style.firstLineHeadIndent = RTEReadDouble(cursor);
+    style.headIndent = RTEReadDouble(cursor);
+    style.tailIndent = RTEReadDouble(cursor);
+    style.lineSpacing = RTEReadDouble(cursor);
+    style.paragraphSpacing = RTEReadDouble(cursor);
+    style.paragraphSpacingBefore = RTEReadDouble(cursor);
+    style.lineHeightMultiple = RTEReadDouble(cursor);
+    style.minimumLineHeight = RTEReadDouble(cursor);
+    style.maximumLineHeight = RTEReadDouble(cursor);
+    style.defaultTabInterval = RTEReadDouble(cursor);
+    style.hyphenationFactor = (float)RTEReadDouble(cursor);
+    uint32_t tabCount = RTEReadUInt32(cursor);
+    NSMutableArray *tabStops = [NSMutableArray array];
+    for (uint32_t i = 0; i < tabCount && !cursor->failed; i++) {
+        NSTextAlignment alignment = (NSTextAlignment)RTEReadUInt8(cursor);
+        double location = RTEReadDouble(cursor);
+        [tabStops addObject:[[NSTextTab alloc] initWithTextAlignment:alignment location:location options:@{}]];
+    }
+    style.tabStops = tabStops;
+    uint32_t listCount = RTEReadUInt32(cursor);
+    NSMutableArray *textLists = [NSMutableArray array];
+    for (uint32_t i = 0; i < listCount && !cursor->failed; i++) {
+        NSUInteger options = (NSUInteger)RTEReadUInt64(cursor);
+        NSString *markerFormat = RTEReadString(cursor);
+        if (markerFormat) {
+            [textLists addObject:[[NSTextList alloc] initWithMarkerFormat:markerFormat options:options]];
+        }
+    }
+    style.textLists = textLists;
+    return cursor->failed ? nil : [style copy];
+}
+
+static NSDictionary *RTEDecodeAttributes(RTEBinaryCursor *cursor) {
+    NSMutableDictionary *attributes = [NSMutableDictionary dictionary];
+    uint16_t valueCount = RTEReadUInt16(cursor);
+    for (uint16_t i = 0; i < valueCount && !cursor->failed; i++) {
+        RTEBinaryAttributeTag tag = RTEReadUInt8(cursor);
+        uint32_t length = RTEReadUInt32(cursor);
+        const uint8_t *payload = RTEReadBytes(cursor, length);
+        if (!payload) {
+            break;
+        }
+        RTEBinaryCursor value = { payload, length, 0, NO };
+        switch (tag) {
+            case RTEBinaryAttributeFont: {
+                double size = RTEReadDouble(&value);
+                NSString *name = RTEReadString(&value);
+                if (!isfinite(size) || size <= 0) {
+                    value.failed = YES;
+                }
+                else if (name) {
+                    // Fonts that aren't installed here fall back to the user font at the same size
+                    attributes[NSFontAttributeName] = [NSFont fontWithName:name size:size] ?: [NSFont userFontOfSize:size];
+                }
+                break;
+            }
+            case RTEBinaryAttributeForegroundColor:
+                attributes[NSForegroundColorAttributeName] = RTEReadColor(&value);
+                break;
+            case RTEBinaryAttributeBackgroundColor:
+                attributes[NSBackgroundColorAttributeName] = RTEReadColor(&value);
+                break;
+            case RTEBinaryAttributeUnderlineColor:
+                attributes[NSUnderlineColorAttributeName] = RTEReadColor(&value);
+                break;
+            case RTEBinaryAttributeStrikethroughColor:
+                attributes[NSStrikethroughColorAttributeName] = RTEReadColor(&value);
+                break;
+            case RTEBinaryAttributeUnderlineStyle:
+                attributes[NSUnderlineStyleAttributeName] = @((int64_t)RTEReadUInt64(&value));
+                break;
+            case RTEBinaryAttributeStrikethroughStyle:
+                attributes[NSStrikethroughStyleAttributeName] = @((int64_t)RTEReadUInt64(&value));
+                break;
+            case RTEBinaryAttributeSuperscript:
+                attributes[NSSuperscriptAttributeName] = @((int64_t)RTEReadUInt64(&value));
+                break;
+            case RTEBinaryAttributeBaselineOffset:
+                attributes[NSBaselineOffsetAttributeName] = @(RTEReadDouble(&value));
+                break;
+            case RTEBinaryAttributeKern:
+                attributes[NSKernAttributeName] = @(RTEReadDouble(&value));
+                break;
+            case RTEBinaryAttributeParagraphStyle:
+                attributes[NSParagraphStyleAttributeName] = RTEReadParagraphStyle(&value);
+                break;
+            case RTEBinaryAttributeLink: {
+                BOOL isURL = RTEReadUInt8(&value) == 1;
+                NSString *link = RTEReadString(&value);
+                if (link) {
+                    attributes[NSLinkAttributeName] = isURL ? ([NSURL URLWithString:link] ?: link) : link;
+                }
+                break;
+            }
+            default:
+                break; // written by a newer version; skip it
+        }
+        if (value.failed) {
+            cursor->failed = YES;
+        }
+    }
+    return cursor->failed ? nil : attributes;
+}
+
+static NSError *RTECorruptDocumentError(NSString *reason) {
+    return [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError
+                           userInfo:@{NSLocalizedFailureReasonErrorKey: reason}];
+}
+
+// YES if count items of size bytes starting at offset fit in length bytes
+static BOOL RTESectionFits(uint64_t offset, uint64_t count, uint64_t size, NSUInteger length) {
+    return offset <= length && count <= (length - offset) / size;
+}
+
+@interface RichTextEditorBinaryDocument () {
+    const uint8_t *_bytes;
+    NSUInteger _textOffset;
+    NSUInteger _attributeOffsetsOffset;
+    NSUInteger _attributeDataOffset;
+    NSUInteger _attributeDataLength;
+    NSUInteger _runsOffset;
+    NSMutableDictionary *_decodedAttributes; // table index -> attributes
+}
+
+@end
+
+@implementation RichTextEditorBinaryDocument
+
++ (NSData *)dataWithAttributedString:(NSAttributedString *)string {
+    NSUInteger length = string.length;
+    NSAssert(length <= UINT32_MAX, @"Text is too long for the binary document format");
+    NSMutableData *attributeOffsets = [NSMutableData data];
+    NSMutableData *attributeData = [NSMutableData data];
+    NSMutableData *runs = [NSMutableData data];
+    // Text storages hand out the same dictionary for runs with the same attributes, so most
+    // runs are found by pointer; the rest are interned by their encoding
+    NSMapTable *indexesByDictionary = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsObjectPointerPersonality | NSPointerFunctionsStrongMemory
+                                                            valueOptions:NSPointerFunctionsStrongMemory];
+    NSMutableDictionary *indexesByEncoding = [NSMutableDictionary dictionary];
+    __block NSUInteger lastIndex = NSNotFound;
+    [string enumerateAttributesInRange:NSMakeRange(0, length) options:0 usingBlock:^(NSDictionary *attributes, NSRange range, BOOL *stop) {
+        NSNumber *index = [indexesByDictionary objectForKey:attributes];
+        if (!index) {
+            NSData *encoded = RTEEncodeAttributes(attributes);
+            index = indexesByEncoding[encoded];
+            if (!index) {
+                index = @(indexesByEncoding.count);
+                indexesByEncoding[encoded] = index;
+                RTEAppendUInt32(attributeOffsets, (uint32_t)attributeData.length);
+                [attributeData appendData:encoded];
+            }
+            [indexesByDictionary setObject:index forKey:attributes];
+        }
+        // Runs that only differed in attributes that aren't stored become one run
+        if (index.unsignedIntegerValue != lastIndex) {
+            RTEAppendUInt32(runs, (uint32_t)range.location);
+            RTEAppendUInt32(runs, index.unsignedIntValue);
+            lastIndex = index.unsignedIntegerValue;
+        }
+    }];
+    RTEAppendUInt32(attributeOffsets, (uint32_t)attributeData.length);
+
+    NSMutableData *text = [NSMutableData dataWithLength:length * sizeof(unichar)];
+    [string.string getCharacters:text.mutableBytes range:NSMakeRange(0, length)];
+    if (NSHostByteOrder() != NS_LittleEndian) {
+        unichar *characters = text.mutableBytes;
+        for (NSUInteger i = 0; i < length; i++) {
+            characters[i] = CFSwapInt16HostToLittle(characters[i]);
+        }
+    }
+
+    uint64_t textOffset = RTE_BINARY_HEADER_SIZE;
+    uint64_t attributeOffsetsOffset = (textOffset + text.length + 3) / 4 * 4;
+    uint64_t attributeDataOffset = attributeOffsetsOffset + attributeOffsets.length;
+    uint64_t runsOffset = (attributeDataOffset + attributeData.length + 3) / 4 * 4;
+    NSMutableData *data = [NSMutableData dataWithCapacity:(NSUInteger)runsOffset + runs.length];
+    [data appendBytes:"RTEB" length:4];
+    RTEAppendUInt16(data, RTE_BINARY_DOCUMENT_VERSION);
+    RTEAppendUInt16(data, RTE_BINARY_HEADER_SIZE);
+    RTEAppendUInt32(data, (uint32_t)length);
+    RTEAppendUInt32(data, (uint32_t)indexesByEncoding.count);
+    RTEAppendUInt32(data, (uint32_t)(runs.length / (2 * sizeof(uint32_t))));
+    RTEAppendUInt32(data, 0);
+    RTEAppendUInt64(data, textOffset);
+    RTEAppendUInt64(data, attributeOffsetsOffset);
+    RTEAppendUInt64(data, attributeDataOffset);
+    RTEAppendUInt64(data, runsOffset);
+    [data appendData:text];
+    RTEPadData(data, 4);
+    [data appendData:attributeOffsets];
+    [data appendData:attributeData];
+    RTEPadData(data, 4);
+    [data appendData:runs];
+    return data;
+}
+
++ (BOOL)writeAttributedString:(NSAttributedString *)string toURL:(NSURL *)url error:(NSError **)error {
+    return [[self dataWithAttributedString:string] writeToURL:url options:NSDataWritingAtomic error:error];
+}
+
+- (instancetype)initWithContentsOfURL:(NSURL *)url error:(NSError **)error {
+    NSData *data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:error];
+    if (!data) {
+        return nil;
+    }
+    return [self initWithData:data error:error];
+}
+
+- (instancetype)initWithData:(NSData *)data error:(NSError **)error {
+    if (self = [super init]) {
+        _data = data;
+        _bytes = data.bytes;
+        _decodedAttributes = [NSMutableDictionary dictionary];
+        NSString *problem = [self readHeader];
+        if (problem) {
+            if (error) {
+                *error = RTECorruptDocumentError(problem);
+            }
+            return nil;
+        }
+    }
+    return self;
+}
+
+// Checks that every section lies inside the data. Returns a description of the problem, or nil.
+- (NSString *)readHeader {
+    NSUInteger dataLength = self.data.length;
+    RTEBinaryCursor cursor = { _bytes, dataLength, 0, NO };
+    const uint8_t *magic = RTEReadBytes(&cursor, 4);
+    if (!magic || memcmp(magic, "RTEB", 4) != 0) {
+        return @"Not a binary rich text document.";
+    }
+    uint16_t version = RTEReadUInt16(&cursor);
+    uint16_t headerSize = RTEReadUInt16(&cursor);
+    if (version == 0 || version > RTE_BINARY_DOCUMENT_VERSION) {
+        return [NSString stringWithFormat:@"Unsupported binary document version %u.", version];
+    }
+    _length = RTEReadUInt32(&cursor);
+    _attributeTableCount = RTEReadUInt32(&cursor);
+    _runCount = RTEReadUInt32(&cursor);
+    RTEReadUInt32(&cursor);
+    uint64_t textOffset = RTEReadUInt64(&cursor);
+    uint64_t attributeOffsetsOffset = RTEReadUInt64(&cursor);
+    uint64_t attributeDataOffset = RTEReadUInt64(&cursor);
+    uint64_t runsOffset = RTEReadUInt64(&cursor);
+    if (cursor.failed || headerSize < RTE_BINARY_HEADER_SIZE || headerSize > dataLength) {
+        return @"The header is truncated.";
+    }
+    if (!RTESectionFits(textOffset, _length, sizeof(unichar), dataLength) ||
+        !RTESectionFits(attributeOffsetsOffset, (uint64_t)_attributeTableCount + 1, sizeof(uint32_t), dataLength) ||
+        !RTESectionFits(runsOffset, _runCount, 2 * sizeof(uint32_t), dataLength)) {
+        return @"A section lies outside the file.";
+    }
+    _textOffset = (NSUInteger)textOffset;
+    _attributeOffsetsOffset = (NSUInteger)attributeOffsetsOffset;
+    _runsOffset = (NSUInteger)runsOffset;
+    _attributeDataLength = RTEUInt32AtOffset(_bytes, _attributeOffsetsOffset + _attributeTableCount * sizeof(uint32_t));
+    if (!RTESectionFits(attributeDataOffset, _attributeDataLength, 1, dataLength)) {
+        return @"The attribute table lies outside the file.";
+    }
+    _attributeDataOffset = (NSUInteger)attributeDataOffset;
+    if ((_length > 0 && _runCount == 0) || (_runCount > 0 && [self runLocationAtIndex:0] != 0)) {
+        return @"The attribute runs don't cover the text.";
+    }
+    return nil;
+}
+
+- (NSUInteger)runLocationAtIndex:(NSUInteger)index {
+    return RTEUInt32AtOffset(_bytes, _runsOffset + index * 2 * sizeof(uint32_t));
+}
+
+- (NSUInteger)runAttributeIndexAtIndex:(NSUInteger)index {
+    return RTEUInt32AtOffset(_bytes, _runsOffset + index * 2 * sizeof(uint32_t) + sizeof(uint32_t));
+}
+
+// Index of the run containing location (runs are sorted by start location)
+- (NSUInteger)runIndexForLocation:(NSUInteger)location {
+    NSUInteger low = 0;
+    NSUInteger high = self.runCount;
+    while (high - low > 1) {
+        NSUInteger middle = low + (high - low) / 2;
+        if ([self runLocationAtIndex:middle] <= location) {
+            low = middle;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+- (NSDictionary *)attributesAtTableIndex:(NSUInteger)index {
+    NSNumber *key = @(index);
+    NSDictionary *attributes = _decodedAttributes[key];
+    if (attributes || index >= self.attributeTableCount) {
+        return attributes;
+    }
+    NSUInteger start = RTEUInt32AtOffset(_bytes, _attributeOffsetsOffset + index * sizeof(uint32_t));
+    NSUInteger end = RTEUInt32AtOffset(_bytes, _attributeOffsetsOffset + (index + 1) * sizeof(uint32_t));
+    if (start > end || end > _attributeDataLength) {
+        return nil;
+    }
+    RTEBinaryCursor cursor = { _bytes + _attributeDataOffset + start, end - start, 0, NO };
+    attributes = RTEDecodeAttributes(&cursor);
+    if (attributes) {
+        _decodedAttributes[key] = attributes;
+    }
+    return attributes;
+}
+
+- (NSString *)textInRange:(NSRange)range {
+    const uint8_t *bytes = _bytes + _textOffset + range.location * sizeof(unichar);
+    if (NSHostByteOrder() == NS_LittleEndian && (uintptr_t)bytes % sizeof(unichar) == 0) {
+        return [[NSString alloc] initWithCharacters:(const unichar *)bytes length:range.length];
+    }
+    unichar *characters = malloc(MAX(range.length, (NSUInteger)1) * sizeof(unichar));
+    for (NSUInteger i = 0; i < range.length; i++) {
+        characters[i] = (unichar)(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+    }
+    return [[NSString alloc] initWithCharactersNoCopy:characters length:range.length freeWhenDone:YES];
+}
+
+- (NSAttributedString *)attributedStringWithError:(NSError **)error {
+    return [self attributedSubstringFromRange:NSMakeRange(0, self.length) error:error];
+}
+
+- (NSAttributedString *)attributedSubstringFromRange:(NSRange)range error:(NSError **)error {
+    range.location = MIN(range.location, self.length);
+    range.length = MIN(range.length, self.length - range.location);
+    NSMutableAttributedString *result = [[NSMutableAttributedString alloc] initWithString:[self textInRange:range]];
+    if (range.length == 0) {
+        return result;
+    }
+    NSString *problem = nil;
+    NSUInteger end = NSMaxRange(range);
+    [result beginEditing];
+    for (NSUInteger runIndex = [self runIndexForLocation:range.location]; runIndex < self.runCount; runIndex++) {
+        NSUInteger runStart = [self runLocationAtIndex:runIndex];
+        if (runStart >= end) {
+            break;
+        }
+        NSUInteger runEnd = runIndex + 1 < self.runCount ? [self runLocationAtIndex:runIndex + 1] : self.length;
+        if (runEnd <= runStart || runEnd > self.length) {
+            problem = @"The attribute runs are out of order.";
+            break;
+        }
+        NSDictionary *attributes = [self attributesAtTableIndex:[self runAttributeIndexAtIndex:runIndex]];
+        if (!attributes) {
+            problem = @"An attribute table entry can't be read.";
+            break;
+        }
+        NSUInteger start = MAX(runStart, range.location);
+        NSUInteger stop = MIN(runEnd, end);
+        [result setAttributes:attributes range:NSMakeRange(start - range.location, stop - start)];
+    }
+    [result endEditing];
+    if (problem) {
+        if (error) {
+            *error = RTECorruptDocumentError(problem);
+        }
+        return nil;
+    }
+    return result;
+}
+
+@end
@@ -0,0 +1,56 @@
+//
+//  RichTextEditorCommandMetrics.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+#import "RichTextEditor.h"
+
+/// Number of latency buckets per command type. Bucket i counts commands that took less than
+/// 2^i microseconds (and at least 2^(i-1)); the last bucket also holds everything slower.
+#define RTE_COMMAND_METRICS_BUCKET_COUNT 32
+
+/// Latency histograms and touched-text counts per RichTextEditorPreviewChange type.
+///
+/// Set an instance as a RichTextEditor's commandMetrics to have every command timed from its
+/// changeAboutToOccurOfType: notification until the end of the run loop turn it ran in, which
+/// includes the text storage edit, delegate callbacks, and any layout and display done for it.
+/// One instance can be shared by several editors.
+///
+/// Recording and snapshots don't lock: each counter is updated atomically on its own, so a
+/// snapshot taken while commands are being recorded may be off by the commands in flight.
+@interface RichTextEditorCommandMetrics : NSObject
+
+/// Adds one command. Types outside of RichTextEditorPreviewChange (e.g. a subclass's own types)
+/// are all counted as "other".
+- (void)recordCommandOfType:(RichTextEditorPreviewChange)type
+                   duration:(NSTimeInterval)duration
+          charactersTouched:(NSUInteger)charactersTouched
+       attributeRunsTouched:(NSUInteger)attributeRunsTouched;
+
+/// Number of commands of type recorded so far.
+- (NSUInteger)countForType:(RichTextEditorPreviewChange)type;
+
+/// Counts per bucket for type (RTE_COMMAND_METRICS_BUCKET_COUNT numbers).
+- (NSArray<NSNumber *> *)histogramForType:(RichTextEditorPreviewChange)type;
+
+/// Everything recorded so far, as property list types. Only command types that were recorded
+/// are included:
+///   { "bucketUpperBoundsMicroseconds": [1, 2, 4, ...],
+///     "commands": { "bold": { "type", "count", "totalMicroseconds", "maxMicroseconds",
+///                             "p50Microseconds", "p99Microseconds", "charactersTouched",
+///                             "attributeRunsTouched", "histogram" }, ... } }
+/// Percentiles are the upper bound of the bucket they fall in.
+- (NSDictionary *)snapshot;
+
+/// snapshot as JSON, or nil with the serialization error.
+- (NSData *)JSONDataWithError:(NSError **)error;
+
+- (void)reset;
+
+/// Key used for type in snapshot, e.g. "bold" or "indentIncrease".
++ (NSString *)keyForType:(RichTextEditorPreviewChange)type;
+
+@end
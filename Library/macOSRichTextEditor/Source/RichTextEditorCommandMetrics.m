@@ -0,0 +1,166 @@
+//
+//  RichTextEditorCommandMetrics.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorCommandMetrics.h"
+#include <stdatomic.h>
+
+// One slot per RichTextEditorPreviewChange value plus one for everything else
+#define RTE_COMMAND_METRICS_KNOWN_TYPE_COUNT (RichTextEditorPreviewChangeFindReplace + 1)
+#define RTE_COMMAND_METRICS_SLOT_COUNT (RTE_COMMAND_METRICS_KNOWN_TYPE_COUNT + 1)
+
+typedef struct {
+    _Atomic(uint64_t) count;
+    _Atomic(uint64_t) totalMicroseconds;
+    _Atomic(uint64_t) maxMicroseconds;
+    _Atomic(uint64_t) charactersTouched;
+    _Atomic(uint64_t) attributeRunsTouched;
+    _Atomic(uint64_t) buckets[RTE_COMMAND_METRICS_BUCKET_COUNT];
+} RTECommandMetricsSlot;
+
+static NSString *const RTECommandMetricsKeys[RTE_COMMAND_METRICS_SLOT_COUNT] = {
+    @"bold", @"italic", @"underline", @"fontResize", @"highlight", @"fontSize", @"fontColor",
+    @"indentIncrease", @"indentDecrease", @"cut", @"paste", @"space", @"enter", @"bullet",
+    @"mouseDown", @"arrowKey", @"keyDown", @"delete", @"findReplace", @"other"
+};
+
+static NSUInteger RTESlotForType(RichTextEditorPreviewChange type) {
+    if (type < 0 || type >= RTE_COMMAND_METRICS_KNOWN_TYPE_COUNT) {
+        return RTE_COMMAND_METRICS_KNOWN_TYPE_COUNT;
+    }
+    return (NSUInteger)type;
+}
+
+static NSUInteger RTEBucketForMicroseconds(uint64_t microseconds) {
+    NSUInteger bucket = 0;
+    while (microseconds > 0 && bucket < RTE_COMMAND_METRICS_BUCKET_COUNT - 1) {
+        microseconds >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+@interface RichTextEditorCommandMetrics () {
+    RTECommandMetricsSlot *_slots;
+}
+
+@end
+
+@implementation RichTextEditorCommandMetrics
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _slots = calloc(RTE_COMMAND_METRICS_SLOT_COUNT, sizeof(RTECommandMetricsSlot));
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_slots);
+}
+
++ (NSString *)keyForType:(RichTextEditorPreviewChange)type {
+    return RTECommandMetricsKeys[RTESlotForType(type)];
+}
+
+- (void)recordCommandOfType:(RichTextEditorPreviewChange)type
+                   duration:(NSTimeInterval)duration
+          charactersTouched:(NSUInteger)charactersTouched
+       attributeRunsTouched:(NSUInteger)attributeRunsTouched {
+    RTECommandMetricsSlot *slot = &_slots[RTESlotForType(type)];
+    uint64_t microseconds = duration > 0 ? (uint64_t)llround(duration * 1000000.0) : 0;
+    atomic_fetch_add_explicit(&slot->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&slot->totalMicroseconds, microseconds, memory_order_relaxed);
+    atomic_fetch_add_explicit(&slot->charactersTouched, charactersTouched, memory_order_relaxed);
+    atomic_fetch_add_explicit(&slot->attributeRunsTouched, attributeRunsTouched, memory_order_relaxed);
+    atomic_fetch_add_explicit(&slot->buckets[RTEBucketForMicroseconds(microseconds)], 1, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&slot->maxMicroseconds, memory_order_relaxed);
+    while (microseconds > max &&
+           !atomic_compare_exchange_weak_explicit(&slot->maxMicroseconds, &max, microseconds, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+- (NSUInteger)countForType:(RichTextEditorPreviewChange)type {
+    return (NSUInteger)atomic_load_explicit(&_slots[RTESlotForType(type)].count, memory_order_relaxed);
+}
+
+- (NSArray<NSNumber *> *)histogramForType:(RichTextEditorPreviewChange)type {
+    return [self histogramForSlot:&_slots[RTESlotForType(type)]];
+}
+
+- (NSArray<NSNumber *> *)histogramForSlot:(RTECommandMetricsSlot *)slot {
+    NSMutableArray *histogram = [NSMutableArray arrayWithCapacity:RTE_COMMAND_METRICS_BUCKET_COUNT];
+    for (NSUInteger i = 0; i < RTE_COMMAND_METRICS_BUCKET_COUNT; i++) {
+        [histogram addObject:@(atomic_load_explicit(&slot->buckets[i], memory_order_relaxed))];
+    }
+    return histogram;
+}
+
+// Upper bound of the bucket the given percentile falls in
+static uint64_t RTEPercentileFromHistogram(NSArray<NSNumber *> *histogram, double percentile) {
+    uint64_t total = 0;
+    for (NSNumber *count in histogram) {
+        total += count.unsignedLongLongValue;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)ceil(percentile * total);
+    uint64_t seen = 0;
+    for (NSUInteger i = 0; i < histogram.count; i++) {
+        seen += histogram[i].unsignedLongLongValue;
+        if (seen >= rank) {
+            return (uint64_t)1 << i;
+        }
+    }
+    return (uint64_t)1 << (histogram.count - 1);
+}
+
+- (NSDictionary *)snapshot {
+    NSMutableDictionary *commands = [NSMutableDictionary dictionary];
+    for (NSUInteger i = 0; i < RTE_COMMAND_METRICS_SLOT_COUNT; i++) {
+        RTECommandMetricsSlot *slot = &_slots[i];
+        uint64_t count = atomic_load_explicit(&slot->count, memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+        NSArray *histogram = [self histogramForSlot:slot];
+        commands[RTECommandMetricsKeys[i]] = @{@"type": i < RTE_COMMAND_METRICS_KNOWN_TYPE_COUNT ? @(i) : @(-1),
+                                               @"count": @(count),
+                                               @"totalMicroseconds": @(atomic_load_explicit(&slot->totalMicroseconds, memory_order_relaxed)),
+                                               @"maxMicroseconds": @(atomic_load_explicit(&slot->maxMicroseconds, memory_order_relaxed)),
+                                               @"p50Microseconds": @(RTEPercentileFromHistogram(histogram, 0.50)),
+                                               @"p99Microseconds": @(RTEPercentileFromHistogram(histogram, 0.99)),
+                                               @"charactersTouched": @(atomic_load_explicit(&slot->charactersTouched, memory_order_relaxed)),
+                                               @"attributeRunsTouched": @(atomic_load_explicit(&slot->attributeRunsTouched, memory_order_relaxed)),
+                                               @"histogram": histogram};
+    }
+    NSMutableArray *upperBounds = [NSMutableArray arrayWithCapacity:RTE_COMMAND_METRICS_BUCKET_COUNT];
+    for (NSUInteger i = 0; i < RTE_COMMAND_METRICS_BUCKET_COUNT; i++) {
+        [upperBounds addObject:@((uint64_t)1 << i)];
+    }
+    return @{@"bucketUpperBoundsMicroseconds": upperBounds, @"commands": commands};
+}
+
+- (NSData *)JSONDataWithError:(NSError **)error {
+    return [NSJSONSerialization dataWithJSONObject:[self snapshot] options:0 error:error];
+}
+
+- (void)reset {
+    for (NSUInteger i = 0; i < RTE_COMMAND_METRICS_SLOT_COUNT; i++) {
+        RTECommandMetricsSlot *slot = &_slots[i];
+        atomic_store_explicit(&slot->count, 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->totalMicroseconds, 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->maxMicroseconds, 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->charactersTouched, 0, memory_order_relaxed);
+        atomic_store_explicit(&slot->attributeRunsTouched, 0, memory_order_relaxed);
+        for (NSUInteger j = 0; j < RTE_COMMAND_METRICS_BUCKET_COUNT; j++) {
+            atomic_store_explicit(&slot->buckets[j], 0, memory_order_relaxed);
+        }
+    }
+}
+
+@end
@@ -0,0 +1,194 @@
+//
+//  RichTextEditorDocument.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "RichTextEditorFoundationText.h"
+
+@class RichTextEditorParagraphIndex;
+@class RichTextEditorParagraphBatch;
+@class RichTextEditorStyleTransform;
+@class RichTextEditorAttributeInterner;
+
+typedef NS_ENUM(NSInteger, ParagraphIndentation) {
+    ParagraphIndentationIncrease,
+    ParagraphIndentationDecrease
+};
+
+/// The editing rules of RichTextEditor (bullets, indentation limits, alignment, font traits and
+/// sizes, colors) on a text storage, without a view. Use it to convert or clean up documents
+/// where there is no window server, e.g. on a worker machine or on a background queue.
+///
+/// Commands act on selectedRange the same way the editor's commands act on its selection, and
+/// update selectedRange and typingAttributes the same way. RichTextEditor keeps one document for
+/// its own text storage and plans its paragraph and font changes with it.
+///
+/// A document is not thread safe, but separate documents can be used on separate threads.
+///
+/// In the framework it uses Foundation and the AppKit text attribute classes (no NSView or
+/// NSWindow). Built with RTE_FOUNDATION_ONLY (see the GNUmakefile) it needs nothing but
+/// Foundation, e.g. gnustep-base on Linux: every command, HTML included, works on the stand-ins in
+/// RichTextEditorFoundationText.h. Their fonts are a family, traits and a size (fontName
+/// "Helvetica-Bold" is Helvetica in bold, whether or not the machine has it) and their colors are RGB.
+///
+/// With no fonts to measure, that build approximates the two widths the rules need, so its
+/// indentation can differ from what the framework produces for the same text:
+/// - A tab (defaultIndentationSize) is the paragraph style's defaultTabInterval, or
+///   RTE_FOUNDATION_ONLY_TAB_INTERVAL. AppKit measures it up to the first tab stop, which is the
+///   same 28 points for the default tab stops, but not for paragraph styles with their own tabStops.
+/// - bulletString is RTE_FOUNDATION_ONLY_CHARACTER_WIDTH points per character. AppKit measures it
+///   in the paragraph's font, so wrapped lines of list items (headIndent) start at a different place.
+/// Set defaultIndentationSize and stringWidthMeasurement to match the fonts the documents are
+/// shown with.
+@interface RichTextEditorDocument : NSObject
+
+@property (nonatomic, readonly) NSTextStorage *textStorage;
+
+/// Paragraph and list lookups for textStorage.
+@property (nonatomic, readonly) RichTextEditorParagraphIndex *paragraphIndex;
+
+/// The range commands act on. Defaults to {0, 0}.
+@property (nonatomic) NSRange selectedRange;
+
+/// Attributes for text at the end of the document and for an empty selection, like
+/// -[NSTextView typingAttributes]. Commands with an empty selection change these.
+@property (nonatomic, copy) NSDictionary<NSString *, id> *typingAttributes;
+
+/// Marks a paragraph as a list item. Defaults to a bullet followed by a no-break space.
+@property (nonatomic, copy) NSString *bulletString;
+
+/// Amount one indentation step adds. Defaults to the width of a tab in the typing attributes' font.
+@property (nonatomic) CGFloat defaultIndentationSize;
+
+/// Measures the width of bulletString in a list item's attributes, which the wrapped lines of the
+/// item are indented past. nil (the default) measures with -[NSString sizeWithAttributes:], like
+/// RichTextEditor, or with RTE_FOUNDATION_ONLY_CHARACTER_WIDTH in RTE_FOUNDATION_ONLY builds.
+@property (nonatomic, copy) CGFloat (^stringWidthMeasurement)(NSString *string, NSDictionary<NSString *, id> *attributes);
+
+/// Indentation is not increased past this. Defaults to 10 times defaultIndentationSize.
+@property (nonatomic) CGFloat maximumIndentation;
+
+/// Amount increaseFontSize and decreaseFontSize change the size by. Defaults to 6.
+@property (nonatomic) CGFloat fontSizeChangeAmount;
+
+/// Font size limits for increaseFontSize and decreaseFontSize. Default to 10 and 128.
+@property (nonatomic) CGFloat minFontSize;
+@property (nonatomic) CGFloat maxFontSize;
+
+/// If set, paragraph styles and fonts are interned as they are applied.
+@property (nonatomic) RichTextEditorAttributeInterner *attributeInterner;
+
+/// An empty document.
+- (instancetype)init;
+
+/// A document holding a copy of string.
+- (instancetype)initWithAttributedString:(NSAttributedString *)string;
+
+/// A document that edits textStorage itself (this is how RichTextEditor uses it).
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage;
+
+/// A document read by RichTextEditorHTMLReader, or nil if the HTML couldn't be read.
+- (instancetype)initWithHTMLString:(NSString *)htmlString;
+
+/// Width of a tab with the font, paragraph style (tab stops), kern and expansion of attributes.
+/// Cached per combination of those and shared by every document and editor. In RTE_FOUNDATION_ONLY
+/// builds, the paragraph style's defaultTabInterval, or RTE_FOUNDATION_ONLY_TAB_INTERVAL if it has none.
++ (CGFloat)indentationSizeForAttributes:(NSDictionary *)attributes;
+
+#pragma mark - Commands
+
+/// Same as -[RichTextEditor userSelectedBullet].
+- (void)toggleBullets;
+
+/// Same as -[RichTextEditor userSelectedIncreaseIndent] and userSelectedDecreaseIndent.
+- (void)increaseIndentation;
+- (void)decreaseIndentation;
+
+/// Same as -[RichTextEditor userSelectedParagraphFirstLineHeadIndent].
+- (void)toggleFirstLineHeadIndent;
+
+/// Same as -[RichTextEditor userSelectedTextAlignment:].
+- (void)setTextAlignment:(NSTextAlignment)textAlignment;
+
+/// Changes the fonts of the selected text (or of the typing attributes if nothing is selected).
+/// nil arguments keep what each font already has.
+- (void)applyFontWithBoldTrait:(NSNumber *)isBold italicTrait:(NSNumber *)isItalic fontName:(NSString *)fontName fontSize:(NSNumber *)fontSize;
+
+- (void)setFontSize:(CGFloat)fontSize;
+- (void)setFontName:(NSString *)fontName;
+
+/// Same as -[RichTextEditor increaseFontSize] and decreaseFontSize.
+- (void)increaseFontSize;
+- (void)decreaseFontSize;
+
+/// Colors the selected text (or the typing attributes if nothing is selected). nil removes the color.
+- (void)setTextColor:(NSColor *)color;
+- (void)setTextBackgroundColor:(NSColor *)color;
+
+/// The document as HTML, written by RichTextEditorHTMLWriter.
+- (NSString *)htmlString;
+
+#pragma mark - Normalizing
+
+/// Markers that other editors and plain text commonly start list items with: a bullet followed
+/// by a space or a tab, a white bullet followed by a space, "- " and "* ".
++ (NSArray<NSString *> *)commonListMarkers;
+
+/// Turns every paragraph that starts with bulletString or one of listMarkers into a list item
+/// like the ones toggleBullets makes: the marker is replaced with bulletString, the first line
+/// is indented by at least defaultIndentationSize and wrapped lines start after the bullet.
+/// Everything is changed in one batch. Returns the number of paragraphs that changed.
+- (NSUInteger)normalizeBulletsWithListMarkers:(NSArray<NSString *> *)listMarkers;
+
+/// Rounds the indentation of every paragraph to a whole number of defaultIndentationSize steps,
+/// no deeper than increaseIndentation can go. Wrapped lines of list items start after the bullet.
+/// Returns the number of paragraphs that changed.
+- (NSUInteger)normalizeIndentation;
+
+/// Removes text and background colors from the whole document and from the typing attributes.
+- (void)removeColors;
+
+#pragma mark - Planning
+
+/// Attributes of the character at index, or typingAttributes at the end of the text.
+- (NSDictionary<NSString *, id> *)attributesAtIndex:(NSUInteger)index;
+
+/// YES if the paragraph starting at location starts with bulletString.
+- (BOOL)hasBulletAtLocation:(NSUInteger)location;
+
+/// A copy of the paragraph style in attributes (or a default one) moved one step in or out,
+/// within 0 and maximumIndentation.
+- (NSMutableParagraphStyle *)paragraphStyleFromAttributes:(NSDictionary *)attributes withIndentation:(ParagraphIndentation)paragraphIndentation;
+
+/// A batch for textStorage, using attributeInterner.
+- (RichTextEditorParagraphBatch *)createParagraphBatch;
+
+/// A style transform over range of textStorage, using attributeInterner.
+- (RichTextEditorStyleTransform *)createStyleTransformInRange:(NSRange)range;
+
+/// The changes (not yet applied) each command makes to paragraphRanges, as given by
+/// -[RichTextEditorParagraphIndex rangeOfParagraphsFromTextRange:].
+- (RichTextEditorParagraphBatch *)paragraphBatchChangingIndentation:(ParagraphIndentation)paragraphIndentation ofParagraphs:(NSArray *)paragraphRanges;
+- (RichTextEditorParagraphBatch *)paragraphBatchTogglingFirstLineHeadIndentOfParagraphs:(NSArray *)paragraphRanges;
+- (RichTextEditorParagraphBatch *)paragraphBatchSettingTextAlignment:(NSTextAlignment)textAlignment ofParagraphs:(NSArray *)paragraphRanges;
+
+/// Adds bullets to the paragraphs if the first one has none, otherwise removes them (and one
+/// level of indentation). Paragraphs that don't match the first one are left alone.
+- (RichTextEditorParagraphBatch *)paragraphBatchTogglingBulletsOfParagraphs:(NSArray *)paragraphRanges;
+
+/// font with the given traits, name and size; nil arguments keep what font has.
+- (NSFont *)fontWithBoldTrait:(NSNumber *)isBold italicTrait:(NSNumber *)isItalic fontName:(NSString *)fontName fontSize:(NSNumber *)fontSize fromFont:(NSFont *)font;
+
+/// Planned font changes for range (not yet applied).
+- (RichTextEditorStyleTransform *)styleTransformWithBoldTrait:(NSNumber *)isBold italicTrait:(NSNumber *)isItalic fontName:(NSString *)fontName fontSize:(NSNumber *)fontSize inRange:(NSRange)range;
+
+/// Planned font size changes for range; sizes outside minFontSize and maxFontSize are left alone.
+- (RichTextEditorStyleTransform *)styleTransformChangingFontSizeInRange:(NSRange)range operation:(CGFloat (^)(CGFloat fontSize))operation;
+
+/// Planned change of every font in range to font's family, keeping bold and italic.
+- (RichTextEditorStyleTransform *)styleTransformChangingFontFamilyTo:(NSFont *)font inRange:(NSRange)range;
+
+@end
@@ -0,0 +1,613 @@
+//
+//  RichTextEditorDocument.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorDocument.h"
+#import "RichTextEditorParagraphIndex.h"
+#import "RichTextEditorParagraphBatch.h"
+#import "RichTextEditorAttributeInterner.h"
+#import "RichTextEditorStyleTransform.h"
+#import "RichTextEditorHTMLReader.h"
+#import "RichTextEditorHTMLWriter.h"
+#if !RTE_FOUNDATION_ONLY
+#import <AppKit/NSStringDrawing.h>
+#import "NSFont+RichTextEditor.h"
+
+// The attributes that change the width of a tab: its font, the tab stops and the spacing
+@interface RichTextEditorIndentationSizeKey : NSObject <NSCopying>
+
+@property (readonly) NSDictionary *attributes;
+
+@end
+
+@implementation RichTextEditorIndentationSizeKey {
+    NSUInteger _hash;
+}
+
+- (instancetype)initWithAttributes:(NSDictionary *)attributes {
+    if (self = [super init]) {
+        NSMutableDictionary *measuredAttributes = [NSMutableDictionary dictionaryWithCapacity:4];
+        for (NSString *name in @[NSFontAttributeName, NSParagraphStyleAttributeName, NSKernAttributeName, NSExpansionAttributeName]) {
+            if (attributes[name]) {
+                measuredAttributes[name] = attributes[name];
+            }
+        }
+        _attributes = [measuredAttributes copy];
+        // NSDictionary's hash is only its count
+        _hash = [attributes[NSFontAttributeName] hash] ^ ([attributes[NSParagraphStyleAttributeName] hash] << 1) ^
+            ([attributes[NSKernAttributeName] hash] << 2) ^ ([attributes[NSExpansionAttributeName] hash] << 3);
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // immutable
+}
+
+- (NSUInteger)hash {
+    return _hash;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[RichTextEditorIndentationSizeKey class]]) {
+        return NO;
+    }
+    RichTextEditorIndentationSizeKey *other = object;
+    return _hash == other->_hash && [_attributes isEqualToDictionary:other.attributes];
+}
+
+@end
+#endif
+
+@implementation RichTextEditorDocument
+
+- (instancetype)init {
+    return [self initWithTextStorage:[[NSTextStorage alloc] init]];
+}
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)string {
+    return [self initWithTextStorage:[[NSTextStorage alloc] initWithAttributedString:string]];
+}
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage {
+    if (self = [super init]) {
+        _textStorage = textStorage;
+        _paragraphIndex = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+        _selectedRange = NSMakeRange(0, 0);
+        _typingAttributes = textStorage.length > 0 ? [textStorage attributesAtIndex:0 effectiveRange:NULL] : @{};
+        self.bulletString = @"\u2022\u00A0";
+        _defaultIndentationSize = [RichTextEditorDocument indentationSizeForAttributes:_typingAttributes];
+        _maximumIndentation = _defaultIndentationSize * 10;
+        _fontSizeChangeAmount = 6.0f;
+        _minFontSize = 10.0f;
+        _maxFontSize = 128.0f;
+    }
+    return self;
+}
+
+- (instancetype)initWithHTMLString:(NSString *)htmlString {
+    NSMutableAttributedString *string = [[RichTextEditorHTMLReader attributedStringFromHTMLString:htmlString] mutableCopy];
+    if (!string) {
+        return nil;
+    }
+    // Same as -[RichTextEditor setHtmlString:]
+    if ([string.string hasSuffix:@"\n"]) {
+        [string deleteCharactersInRange:NSMakeRange(string.length - 1, 1)];
+    }
+    return [self initWithAttributedString:string];
+}
+
+// Measuring a tab goes through the text system, and a table full of editors would do it
+// once per editor with the same attributes, so the widths are shared. The tab is measured with
+// only the attributes in the key, so two attribute sets with the same key always measure the same
++ (CGFloat)indentationSizeForAttributes:(NSDictionary *)attributes {
+#if RTE_FOUNDATION_ONLY
+    // Nothing to measure with, but from the start of a line a tab goes to the first tab stop
+    NSParagraphStyle *paragraphStyle = attributes[NSParagraphStyleAttributeName];
+    return paragraphStyle.defaultTabInterval > 0 ? paragraphStyle.defaultTabInterval : RTE_FOUNDATION_ONLY_TAB_INTERVAL;
+#else
+    static NSCache *indentationSizes;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        indentationSizes = [[NSCache alloc] init];
+    });
+    RichTextEditorIndentationSizeKey *key = [[RichTextEditorIndentationSizeKey alloc] initWithAttributes:attributes];
+    NSNumber *indentationSize = [indentationSizes objectForKey:key];
+    if (!indentationSize) {
+        indentationSize = @([@"\t" sizeWithAttributes:key.attributes].width);
+        [indentationSizes setObject:indentationSize forKey:key];
+    }
+    return indentationSize.doubleValue;
+#endif
+}
+
+- (void)setBulletString:(NSString *)bulletString {
+    _bulletString = [bulletString copy];
+    // The paragraph index remembers which paragraphs are list items, so keep its marker in step
+    self.paragraphIndex.listMarkers = bulletString ? @[bulletString] : @[];
+}
+
+- (void)setSelectedRange:(NSRange)selectedRange {
+    NSUInteger location = MIN(selectedRange.location, self.textStorage.length);
+    _selectedRange = NSMakeRange(location, MIN(selectedRange.length, self.textStorage.length - location));
+}
+
+#pragma mark - Commands
+
+- (void)toggleBullets {
+    NSRange initialSelectedRange = self.selectedRange;
+    NSArray *paragraphRanges = [self.paragraphIndex rangeOfParagraphsFromTextRange:initialSelectedRange];
+    NSRange rangeOfCurrentParagraph = [paragraphRanges[0] rangeValue];
+    BOOL isRemovingBullets = [self hasBulletAtLocation:rangeOfCurrentParagraph.location];
+    RichTextEditorParagraphBatch *batch = [self paragraphBatchTogglingBulletsOfParagraphs:paragraphRanges];
+    [self applyParagraphBatch:batch];
+    NSInteger rangeOffset = batch.changeInLength;
+    // If the paragraph is empty, put the cursor after the bullet so typing can start right away
+    if (paragraphRanges.count == 1 && rangeOfCurrentParagraph.length == 0 && !isRemovingBullets) {
+        self.selectedRange = NSMakeRange(rangeOfCurrentParagraph.location + self.bulletString.length, 0);
+    }
+    else if (initialSelectedRange.length == 0) {
+        self.selectedRange = NSMakeRange(initialSelectedRange.location + rangeOffset, 0);
+    }
+    else {
+        NSRange fullRange = [self fullRangeOfParagraphRanges:paragraphRanges];
+        self.selectedRange = NSMakeRange(fullRange.location, fullRange.length + rangeOffset);
+    }
+}
+
+- (void)increaseIndentation {
+    NSArray *paragraphRanges = [self.paragraphIndex rangeOfParagraphsFromTextRange:self.selectedRange];
+    [self applyParagraphBatch:[self paragraphBatchChangingIndentation:ParagraphIndentationIncrease ofParagraphs:paragraphRanges]];
+}
+
+- (void)decreaseIndentation {
+    NSArray *paragraphRanges = [self.paragraphIndex rangeOfParagraphsFromTextRange:self.selectedRange];
+    [self applyParagraphBatch:[self paragraphBatchChangingIndentation:ParagraphIndentationDecrease ofParagraphs:paragraphRanges]];
+}
+
+- (void)toggleFirstLineHeadIndent {
+    NSArray *paragraphRanges = [self.paragraphIndex rangeOfParagraphsFromTextRange:self.selectedRange];
+    [self applyParagraphBatch:[self paragraphBatchTogglingFirstLineHeadIndentOfParagraphs:paragraphRanges]];
+    self.selectedRange = [self fullRangeOfParagraphRanges:paragraphRanges];
+}
+
+- (void)setTextAlignment:(NSTextAlignment)textAlignment {
+    NSArray *paragraphRanges = [self.paragraphIndex rangeOfParagraphsFromTextRange:self.selectedRange];
+    RichTextEditorParagraphBatch *batch = [self paragraphBatchSettingTextAlignment:textAlignment ofParagraphs:paragraphRanges];
+    [self applyParagraphBatch:batch];
+    if (batch.lastParagraphStyle) {
+        [self setTypingAttribute:batch.lastParagraphStyle forKey:NSParagraphStyleAttributeName];
+    }
+    self.selectedRange = [self fullRangeOfParagraphRanges:paragraphRanges];
+}
+
+- (void)applyFontWithBoldTrait:(NSNumber *)isBold italicTrait:(NSNumber *)isItalic fontName:(NSString *)fontName fontSize:(NSNumber *)fontSize {
+    if (self.selectedRange.length > 0) {
+        [[self styleTransformWithBoldTrait:isBold italicTrait:isItalic fontName:fontName fontSize:fontSize inRange:self.selectedRange] applyToTextStorage:self.textStorage];
+        [self updateTypingAttributes];
+    }
+    else {
+        NSFont *font = [self fontWithBoldTrait:isBold italicTrait:isItalic fontName:fontName fontSize:fontSize
+                                      fromFont:self.typingAttributes[NSFontAttributeName]];
+        if (font) {
+            [self setTypingAttribute:font forKey:NSFontAttributeName];
+        }
+    }
+}
+
+- (void)setFontSize:(CGFloat)fontSize {
+    [self applyFontWithBoldTrait:nil italicTrait:nil fontName:nil fontSize:@(fontSize)];
+}
+
+- (void)setFontName:(NSString *)fontName {
+    [self applyFontWithBoldTrait:nil italicTrait:nil fontName:fontName fontSize:nil];
+}
+
+- (void)increaseFontSize {
+    [self changeFontSizeBy:self.fontSizeChangeAmount];
+}
+
+- (void)decreaseFontSize {
+    [self changeFontSizeBy:-self.fontSizeChangeAmount];
+}
+
+- (void)changeFontSizeBy:(CGFloat)amount {
+    if (self.selectedRange.length == 0) {
+        NSFont *font = self.typingAttributes[NSFontAttributeName];
+        if (font) {
+            CGFloat nextFontSize = MAX(self.minFontSize, MIN(self.maxFontSize, font.pointSize + amount));
+            [self setTypingAttribute:[NSFont fontWithDescriptor:font.fontDescriptor size:nextFontSize] forKey:NSFontAttributeName];
+        }
+        return;
+    }
+    RichTextEditorStyleTransform *transform = [self styleTransformChangingFontSizeInRange:self.selectedRange operation:^CGFloat(CGFloat fontSize) {
+        return fontSize + amount;
+    }];
+    [transform applyToTextStorage:self.textStorage];
+    [self updateTypingAttributes];
+}
+
+- (void)setTextColor:(NSColor *)color {
+    [self setAttribute:color forKey:NSForegroundColorAttributeName];
+}
+
+- (void)setTextBackgroundColor:(NSColor *)color {
+    [self setAttribute:color forKey:NSBackgroundColorAttributeName];
+}
+
+- (void)setAttribute:(id)value forKey:(NSString *)key {
+    if (self.selectedRange.length == 0) {
+        [self setTypingAttribute:value forKey:key];
+    }
+    else if (value) {
+        [self.textStorage addAttribute:key value:(self.attributeInterner ? [self.attributeInterner internedValue:value] : value) range:self.selectedRange];
+        [self updateTypingAttributes];
+    }
+    else {
+        [self.textStorage removeAttribute:key range:self.selectedRange];
+        [self updateTypingAttributes];
+    }
+}
+
+- (NSString *)htmlString {
+    return [[[RichTextEditorHTMLWriter alloc] initWithAttributedString:self.textStorage] htmlString];
+}
+
+#pragma mark - Normalizing
+
++ (NSArray<NSString *> *)commonListMarkers {
+    return @[@"\u2022 ", @"\u2022\t", @"\u25E6 ", @"- ", @"* "];
+}
+
+- (NSUInteger)normalizeBulletsWithListMarkers:(NSArray<NSString *> *)listMarkers {
+    NSString *text = self.textStorage.string;
+    NSString *bulletString = self.bulletString;
+    RichTextEditorParagraphBatch *batch = [self createParagraphBatch];
+    NSUInteger paragraphCount = self.paragraphIndex.paragraphCount;
+    for (NSUInteger i = 0; i < paragraphCount; i++) {
+        NSRange paragraphRange = [self.paragraphIndex rangeOfParagraphAtIndex:i];
+        NSString *marker = [self.paragraphIndex listMarkerOfParagraphAtIndex:i];
+        BOOL hasBullet = marker != nil;
+        for (NSUInteger j = 0; !marker && j < listMarkers.count; j++) {
+            NSString *listMarker = listMarkers[j];
+            if (paragraphRange.length >= listMarker.length &&
+                [text compare:listMarker options:NSLiteralSearch range:NSMakeRange(paragraphRange.location, listMarker.length)] == NSOrderedSame) {
+                marker = listMarker;
+            }
+        }
+        if (!marker) {
+            continue;
+        }
+        NSDictionary *attributes = [self attributesAtIndex:paragraphRange.location];
+        NSMutableParagraphStyle *paragraphStyle = [self mutableParagraphStyleFromAttributes:attributes];
+        paragraphStyle.firstLineHeadIndent = MAX(paragraphStyle.firstLineHeadIndent, self.defaultIndentationSize);
+        paragraphStyle.headIndent = [self widthOfString:bulletString withAttributes:attributes] + paragraphStyle.firstLineHeadIndent;
+        if (hasBullet && [paragraphStyle isEqual:attributes[NSParagraphStyleAttributeName]]) {
+            continue; // already what toggleBullets would have made
+        }
+        NSAttributedString *bullet = hasBullet ? nil : [[NSAttributedString alloc] initWithString:bulletString attributes:attributes];
+        [batch changeParagraph:paragraphRange deletingPrefixLength:(hasBullet ? 0 : marker.length) insertingPrefix:bullet paragraphStyle:paragraphStyle];
+    }
+    return [self applyDocumentWideParagraphBatch:batch];
+}
+
+- (NSUInteger)normalizeIndentation {
+    RichTextEditorParagraphBatch *batch = [self createParagraphBatch];
+    NSUInteger paragraphCount = self.paragraphIndex.paragraphCount;
+    for (NSUInteger i = 0; i < paragraphCount; i++) {
+        NSRange paragraphRange = [self.paragraphIndex rangeOfParagraphAtIndex:i];
+        if (paragraphRange.length == 0) {
+            continue; // no characters to hold a style
+        }
+        NSDictionary *attributes = [self attributesAtIndex:paragraphRange.location];
+        NSParagraphStyle *currentStyle = attributes[NSParagraphStyleAttributeName];
+        if (!currentStyle) {
+            continue;
+        }
+        NSMutableParagraphStyle *paragraphStyle = [currentStyle mutableCopy];
+        paragraphStyle.firstLineHeadIndent = [self normalizedIndentation:currentStyle.firstLineHeadIndent];
+        if ([self.paragraphIndex listMarkerOfParagraphAtIndex:i]) {
+            paragraphStyle.headIndent = [self widthOfString:self.bulletString withAttributes:attributes] + paragraphStyle.firstLineHeadIndent;
+        }
+        else {
+            paragraphStyle.headIndent = [self normalizedIndentation:currentStyle.headIndent];
+        }
+        if (![paragraphStyle isEqual:currentStyle]) {
+            [batch changeParagraph:paragraphRange deletingPrefixLength:0 insertingPrefix:nil paragraphStyle:paragraphStyle];
+        }
+    }
+    return [self applyDocumentWideParagraphBatch:batch];
+}
+
+- (void)removeColors {
+    NSRange range = NSMakeRange(0, self.textStorage.length);
+    [self.textStorage beginEditing];
+    [self.textStorage removeAttribute:NSForegroundColorAttributeName range:range];
+    [self.textStorage removeAttribute:NSBackgroundColorAttributeName range:range];
+    [self.textStorage endEditing];
+    [self setTypingAttribute:nil forKey:NSForegroundColorAttributeName];
+    [self setTypingAttribute:nil forKey:NSBackgroundColorAttributeName];
+}
+
+#pragma mark - Planning
+
+- (NSDictionary<NSString *, id> *)attributesAtIndex:(NSUInteger)index {
+    if (index >= self.textStorage.length) {
+        return self.typingAttributes; // end of string, use whatever we're currently using
+    }
+    return [self.textStorage attributesAtIndex:index effectiveRange:NULL];
+}
+
+- (BOOL)hasBulletAtLocation:(NSUInteger)location {
+    // O(1) for paragraph starts, and never copies the text
+    return [self.paragraphIndex listMarkerAtLocation:location] != nil;
+}
+
+- (NSMutableParagraphStyle *)mutableParagraphStyleFromAttributes:(NSDictionary *)attributes {
+    NSMutableParagraphStyle *paragraphStyle = [attributes[NSParagraphStyleAttributeName] mutableCopy];
+    if (!paragraphStyle) {
+        paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+    }
+    return paragraphStyle;
+}
+
+- (NSMutableParagraphStyle *)paragraphStyleFromAttributes:(NSDictionary *)attributes withIndentation:(ParagraphIndentation)paragraphIndentation {
+    NSMutableParagraphStyle *paragraphStyle = [self mutableParagraphStyleFromAttributes:attributes];
+    if (paragraphIndentation == ParagraphIndentationIncrease &&
+        paragraphStyle.headIndent < self.maximumIndentation && paragraphStyle.firstLineHeadIndent < self.maximumIndentation) {
+        paragraphStyle.headIndent += self.defaultIndentationSize;
+        paragraphStyle.firstLineHeadIndent += self.defaultIndentationSize;
+    }
+    else if (paragraphIndentation == ParagraphIndentationDecrease) {
+        paragraphStyle.headIndent = MAX(0, paragraphStyle.headIndent - self.defaultIndentationSize); // right cursor placement
+        paragraphStyle.firstLineHeadIndent = MAX(0, paragraphStyle.firstLineHeadIndent - self.defaultIndentationSize); // left cursor placement
+    }
+    return paragraphStyle;
+}
+
+- (RichTextEditorParagraphBatch *)createParagraphBatch {
+    RichTextEditorParagraphBatch *batch = [[RichTextEditorParagraphBatch alloc] initWithTextStorage:self.textStorage];
+    batch.attributeInterner = self.attributeInterner;
+    return batch;
+}
+
+- (RichTextEditorStyleTransform *)createStyleTransformInRange:(NSRange)range {
+    RichTextEditorStyleTransform *transform = [[RichTextEditorStyleTransform alloc] initWithAttributedString:self.textStorage range:range];
+    transform.attributeInterner = self.attributeInterner;
+    return transform;
+}
+
+- (RichTextEditorParagraphBatch *)paragraphBatchChangingIndentation:(ParagraphIndentation)paragraphIndentation ofParagraphs:(NSArray *)paragraphRanges {
+    RichTextEditorParagraphBatch *batch = [self createParagraphBatch];
+    for (NSValue *paragraphRangeValue in paragraphRanges) {
+        NSRange paragraphRange = [paragraphRangeValue rangeValue];
+        NSMutableParagraphStyle *paragraphStyle = [self paragraphStyleFromAttributes:[self attributesAtIndex:paragraphRange.location]
+                                                                     withIndentation:paragraphIndentation];
+        [batch changeParagraph:paragraphRange deletingPrefixLength:0 insertingPrefix:nil paragraphStyle:paragraphStyle];
+    }
+    return batch;
+}
+
+- (RichTextEditorParagraphBatch *)paragraphBatchTogglingFirstLineHeadIndentOfParagraphs:(NSArray *)paragraphRanges {
+    RichTextEditorParagraphBatch *batch = [self createParagraphBatch];
+    for (NSValue *paragraphRangeValue in paragraphRanges) {
+        NSRange paragraphRange = [paragraphRangeValue rangeValue];
+        NSMutableParagraphStyle *paragraphStyle = [self mutableParagraphStyleFromAttributes:[self attributesAtIndex:paragraphRange.location]];
+        if (paragraphStyle.headIndent == paragraphStyle.firstLineHeadIndent) {
+            paragraphStyle.firstLineHeadIndent += self.defaultIndentationSize;
+        }
+        else {
+            paragraphStyle.firstLineHeadIndent = paragraphStyle.headIndent;
+        }
+        [batch changeParagraph:paragraphRange deletingPrefixLength:0 insertingPrefix:nil paragraphStyle:paragraphStyle];
+    }
+    return batch;
+}
+
+- (RichTextEditorParagraphBatch *)paragraphBatchSettingTextAlignment:(NSTextAlignment)textAlignment ofParagraphs:(NSArray *)paragraphRanges {
+    RichTextEditorParagraphBatch *batch = [self createParagraphBatch];
+    for (NSValue *paragraphRangeValue in paragraphRanges) {
+        NSRange paragraphRange = [paragraphRangeValue rangeValue];
+        NSMutableParagraphStyle *paragraphStyle = [self mutableParagraphStyleFromAttributes:[self attributesAtIndex:paragraphRange.location]];
+        paragraphStyle.alignment = textAlignment;
+        [batch changeParagraph:paragraphRange deletingPrefixLength:0 insertingPrefix:nil paragraphStyle:paragraphStyle];
+    }
+    return batch;
+}
+
+- (RichTextEditorParagraphBatch *)paragraphBatchTogglingBulletsOfParagraphs:(NSArray *)paragraphRanges {
+    if (paragraphRanges.count == 0) {
+        return [self createParagraphBatch];
+    }
+    NSString *bulletString = self.bulletString;
+    NSRange rangeOfCurrentParagraph = [paragraphRanges[0] rangeValue];
+    BOOL firstParagraphHasBullet = [self hasBulletAtLocation:rangeOfCurrentParagraph.location];
+
+    NSRange rangeOfPreviousParagraph = [self.paragraphIndex firstParagraphRangeFromTextRange:NSMakeRange(rangeOfCurrentParagraph.location - 1, 0)];
+    NSParagraphStyle *previousParagraphStyle = [self attributesAtIndex:rangeOfPreviousParagraph.location][NSParagraphStyleAttributeName];
+    BOOL previousParagraphHasBullet = rangeOfPreviousParagraph.length >= bulletString.length &&
+        [self hasBulletAtLocation:rangeOfPreviousParagraph.location];
+
+    RichTextEditorParagraphBatch *batch = [self createParagraphBatch];
+    for (NSValue *paragraphRangeValue in paragraphRanges) {
+        NSRange paragraphRange = [paragraphRangeValue rangeValue];
+        BOOL currentParagraphHasBullet = [self hasBulletAtLocation:paragraphRange.location];
+        if (firstParagraphHasBullet != currentParagraphHasBullet) {
+            continue;
+        }
+        NSDictionary *attributes = [self attributesAtIndex:(paragraphRange.location > 0 ? paragraphRange.location - 1 : 0)];
+        NSMutableParagraphStyle *paragraphStyle = [self mutableParagraphStyleFromAttributes:attributes];
+        if (currentParagraphHasBullet) {
+            paragraphStyle.firstLineHeadIndent = 0;
+            paragraphStyle.headIndent = 0;
+            [batch changeParagraph:paragraphRange deletingPrefixLength:bulletString.length insertingPrefix:nil paragraphStyle:paragraphStyle];
+        }
+        else {
+            NSAttributedString *bullet = [[NSAttributedString alloc] initWithString:bulletString attributes:attributes];
+            // A bullet continues the indentation of a bullet right above it
+            paragraphStyle.firstLineHeadIndent = previousParagraphHasBullet ? previousParagraphStyle.firstLineHeadIndent : self.defaultIndentationSize;
+            paragraphStyle.headIndent = [self widthOfString:bulletString withAttributes:attributes] + paragraphStyle.firstLineHeadIndent;
+            [batch changeParagraph:paragraphRange deletingPrefixLength:0 insertingPrefix:bullet paragraphStyle:paragraphStyle];
+        }
+    }
+    if (firstParagraphHasBullet) {
+        // Removing bullets also removes one level of indentation from the selected paragraphs
+        // (the extra indentation added by the bullet), so fold that into the same batch.
+        batch = [self paragraphBatchRemovingBulletIndentationFromBatch:batch paragraphRanges:paragraphRanges];
+    }
+    return batch;
+}
+
+// Builds a new batch with the same bullet removals as the given batch, but where every
+// selected paragraph also loses one level of indentation.
+- (RichTextEditorParagraphBatch *)paragraphBatchRemovingBulletIndentationFromBatch:(RichTextEditorParagraphBatch *)bulletBatch paragraphRanges:(NSArray *)paragraphRanges {
+    RichTextEditorParagraphBatch *batch = [self createParagraphBatch];
+    NSUInteger bulletLength = self.bulletString.length;
+    for (NSValue *paragraphRangeValue in paragraphRanges) {
+        NSRange paragraphRange = [paragraphRangeValue rangeValue];
+        BOOL hasBullet = [self hasBulletAtLocation:paragraphRange.location];
+        NSMutableParagraphStyle *paragraphStyle;
+        if (hasBullet && paragraphRange.length > bulletLength) {
+            // Bullet indentation has already been reset to 0; decreasing it further does nothing.
+            paragraphStyle = [self mutableParagraphStyleFromAttributes:[self attributesAtIndex:(paragraphRange.location > 0 ? paragraphRange.location - 1 : 0)]];
+            paragraphStyle.firstLineHeadIndent = 0;
+            paragraphStyle.headIndent = 0;
+        }
+        else {
+            // Either a paragraph without a bullet or a paragraph that will be empty once its bullet
+            // is gone. Both are indented based on the first character that will be left in the paragraph.
+            NSUInteger firstCharacterLocation = paragraphRange.location + (hasBullet ? bulletLength : 0);
+            paragraphStyle = [self paragraphStyleFromAttributes:[self attributesAtIndex:firstCharacterLocation]
+                                                withIndentation:ParagraphIndentationDecrease];
+        }
+        [batch changeParagraph:paragraphRange deletingPrefixLength:(hasBullet ? bulletLength : 0) insertingPrefix:nil paragraphStyle:paragraphStyle];
+    }
+    NSAssert(batch.changeInLength == bulletBatch.changeInLength, @"Bullet removal batches should remove the same bullets");
+    return batch;
+}
+
+// TODO: You can't create a font that isn't bold from a font that is bold by passing nil for
+// isBold, since nil means "keep what the font has".
+- (NSFont *)fontWithBoldTrait:(NSNumber *)isBold italicTrait:(NSNumber *)isItalic fontName:(NSString *)fontName fontSize:(NSNumber *)fontSize fromFont:(NSFont *)font {
+    BOOL newBold = (isBold) ? isBold.intValue : [font isBold];
+    BOOL newItalic = (isItalic) ? isItalic.intValue : [font isItalic];
+    CGFloat newFontSize = (fontSize) ? fontSize.floatValue : font.pointSize;
+    if (fontName) {
+        return [NSFont fontWithName:fontName size:newFontSize boldTrait:newBold italicTrait:newItalic];
+    }
+    return [font fontWithBoldTrait:newBold italicTrait:newItalic andSize:newFontSize];
+}
+
+- (RichTextEditorStyleTransform *)styleTransformWithBoldTrait:(NSNumber *)isBold italicTrait:(NSNumber *)isItalic fontName:(NSString *)fontName fontSize:(NSNumber *)fontSize inRange:(NSRange)range {
+    // One font lookup per distinct font in the range instead of one per run
+    RichTextEditorStyleTransform *transform = [self createStyleTransformInRange:range];
+    [transform planWithFontMapping:^NSFont *(NSFont *font) {
+        return [self fontWithBoldTrait:isBold italicTrait:isItalic fontName:fontName fontSize:fontSize fromFont:font];
+    }];
+    return transform;
+}
+
+- (RichTextEditorStyleTransform *)styleTransformChangingFontSizeInRange:(NSRange)range operation:(CGFloat (^)(CGFloat fontSize))operation {
+    RichTextEditorStyleTransform *transform = [self createStyleTransformInRange:range];
+    CGFloat minFontSize = self.minFontSize;
+    CGFloat maxFontSize = self.maxFontSize;
+    [transform planWithFontMapping:^NSFont *(NSFont *currFont) {
+        if (!currFont) {
+            return nil;
+        }
+        CGFloat currFontSize = currFont.pointSize;
+        CGFloat nextFontSize = operation(currFontSize);
+        if ((currFontSize < nextFontSize && nextFontSize <= maxFontSize) || // sizing up
+            (currFontSize > nextFontSize && minFontSize <= nextFontSize)) { // sizing down
+            return [self fontWithBoldTrait:@(currFont.isBold) italicTrait:@(currFont.isItalic)
+                                  fontName:currFont.fontName fontSize:@(nextFontSize) fromFont:currFont];
+        }
+        return nil;
+    }];
+    return transform;
+}
+
+- (RichTextEditorStyleTransform *)styleTransformChangingFontFamilyTo:(NSFont *)font inRange:(NSRange)range {
+    RichTextEditorStyleTransform *transform = [self createStyleTransformInRange:range];
+    [transform planWithFontMapping:^NSFont *(NSFont *currFont) {
+        return currFont ? [font fontWithBoldTrait:currFont.isBold andItalicTrait:currFont.isItalic] : nil;
+    }];
+    return transform;
+}
+
+#pragma mark - Private
+
+- (void)applyParagraphBatch:(RichTextEditorParagraphBatch *)batch {
+    [batch apply];
+    if (batch.styledNonEmptyParagraph) {
+        [self updateTypingAttributes];
+    }
+    if (batch.lastEmptyParagraphStyle) {
+        // Empty paragraphs can't hold a paragraph style, so use it for whatever gets typed next
+        [self setTypingAttribute:batch.lastEmptyParagraphStyle forKey:NSParagraphStyleAttributeName];
+    }
+}
+
+- (CGFloat)widthOfString:(NSString *)string withAttributes:(NSDictionary *)attributes {
+    if (self.stringWidthMeasurement) {
+        return self.stringWidthMeasurement(string, attributes);
+    }
+#if RTE_FOUNDATION_ONLY
+    return string.length * RTE_FOUNDATION_ONLY_CHARACTER_WIDTH;
+#else
+    return [string sizeWithAttributes:attributes].width;
+#endif
+}
+
+// Whole document changes don't map the selection through the edit; it goes back to the start
+- (NSUInteger)applyDocumentWideParagraphBatch:(RichTextEditorParagraphBatch *)batch {
+    NSUInteger paragraphCount = batch.paragraphCount;
+    if (paragraphCount > 0) {
+        self.selectedRange = NSMakeRange(0, 0);
+        [self applyParagraphBatch:batch];
+    }
+    return paragraphCount;
+}
+
+// Nearest whole number of indentation steps. increaseIndentation keeps adding steps while the
+// indentation is below maximumIndentation, so the deepest it gets is maximumIndentation rounded up.
+- (CGFloat)normalizedIndentation:(CGFloat)indentation {
+    CGFloat step = self.defaultIndentationSize;
+    if (step <= 0) {
+        return indentation;
+    }
+    CGFloat deepest = ceil(self.maximumIndentation / step) * step;
+    return MIN(MAX(0, round(indentation / step) * step), deepest);
+}
+
+- (void)updateTypingAttributes {
+    NSUInteger length = self.textStorage.length;
+    if (length > 0) {
+        self.typingAttributes = [self.textStorage attributesAtIndex:MIN(self.selectedRange.location, length - 1) effectiveRange:NULL];
+    }
+}
+
+- (void)setTypingAttribute:(id)value forKey:(NSString *)key {
+    NSMutableDictionary *typingAttributes = [self.typingAttributes mutableCopy] ?: [NSMutableDictionary dictionary];
+    if (value) {
+        typingAttributes[key] = self.attributeInterner ? [self.attributeInterner internedValue:value] : value;
+    }
+    else {
+        [typingAttributes removeObjectForKey:key];
+    }
+    self.typingAttributes = typingAttributes;
+}
+
+- (NSRange)fullRangeOfParagraphRanges:(NSArray *)paragraphRanges {
+    if (paragraphRanges.count == 0) {
+        return NSMakeRange(0, 0);
+    }
+    NSRange firstRange = [paragraphRanges.firstObject rangeValue];
+    NSRange lastRange = [paragraphRanges.lastObject rangeValue];
+    return NSMakeRange(firstRange.location, NSMaxRange(lastRange) - firstRange.location);
+}
+
+@end
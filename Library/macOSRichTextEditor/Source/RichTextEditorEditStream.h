@@ -0,0 +1,63 @@
+//
+//  RichTextEditorEditStream.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+/// One change to a text storage.
+@interface RichTextEditorEditRecord : NSObject
+
+/// The range that was replaced (or whose attributes changed), in the text as it was just
+/// before this edit.
+@property (nonatomic, readonly) NSRange range;
+
+/// Length of the text that took the place of range. Equal to range.length for attribute-only edits.
+@property (nonatomic, readonly) NSUInteger replacementLength;
+
+@property (nonatomic, readonly) NSInteger changeInLength;
+
+@property (nonatomic, readonly) BOOL charactersChanged;
+@property (nonatomic, readonly) BOOL attributesChanged;
+
+/// The text (with its attribute runs) that is now at {range.location, replacementLength}, or
+/// nil if the stream doesn't include it.
+@property (nonatomic, readonly) NSAttributedString *replacementText;
+
+- (instancetype)initWithRange:(NSRange)range replacementLength:(NSUInteger)replacementLength
+            charactersChanged:(BOOL)charactersChanged attributesChanged:(BOOL)attributesChanged
+              replacementText:(NSAttributedString *)replacementText;
+
+@end
+
+/// Reports every edit made to a text storage (typing, pastes and the editor's own changes to the
+/// text storage alike) as RichTextEditorEditRecords, so that something that mirrors the text
+/// (a sync layer, a search index, autosave) can keep up at the cost of the edit rather than of
+/// the whole document.
+///
+/// Edits are observed through NSTextStorageDidProcessEditingNotification. Outside of a batch each
+/// edit is handed to the handler as soon as it has been processed. Inside a batch, records are
+/// collected and handed over together, in order, when the outermost batch ends; each record is
+/// relative to the text left by the one before it.
+@interface RichTextEditorEditStream : NSObject
+
+@property (nonatomic, readonly) NSTextStorage *textStorage;
+
+@property (nonatomic, copy) void (^handler)(NSArray<RichTextEditorEditRecord *> *records);
+
+/// Whether records carry their replacementText. Copying it costs as much as the edit itself;
+/// turn it off if only the ranges are needed. Defaults to YES.
+@property (nonatomic) BOOL includesReplacementText;
+
+/// YES between beginBatch and the matching endBatch.
+@property (nonatomic, readonly) BOOL isBatching;
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage;
+
+/// Batches may be nested; records are delivered when the outermost one ends.
+- (void)beginBatch;
+- (void)endBatch;
+
+@end
@@ -0,0 +1,113 @@
+//
+//  RichTextEditorEditStream.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorEditStream.h"
+
+@implementation RichTextEditorEditRecord
+
+- (instancetype)initWithRange:(NSRange)range replacementLength:(NSUInteger)replacementLength
+            charactersChanged:(BOOL)charactersChanged attributesChanged:(BOOL)attributesChanged
+              replacementText:(NSAttributedString *)replacementText {
+    if (self = [super init]) {
+        _range = range;
+        _replacementLength = replacementLength;
+        _charactersChanged = charactersChanged;
+        _attributesChanged = attributesChanged;
+        _replacementText = replacementText;
+    }
+    return self;
+}
+
+- (NSInteger)changeInLength {
+    return (NSInteger)self.replacementLength - (NSInteger)self.range.length;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ %@ -> %lu%@%@>", NSStringFromClass([self class]), NSStringFromRange(self.range),
+            (unsigned long)self.replacementLength, self.charactersChanged ? @" characters" : @"", self.attributesChanged ? @" attributes" : @""];
+}
+
+@end
+
+@interface RichTextEditorEditStream () {
+    NSUInteger _batchDepth;
+}
+
+@property NSMutableArray<RichTextEditorEditRecord *> *pendingRecords;
+
+@end
+
+@implementation RichTextEditorEditStream
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage {
+    if (self = [super init]) {
+        _textStorage = textStorage;
+        _includesReplacementText = YES;
+        _pendingRecords = [NSMutableArray array];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(textStorageDidProcessEditing:)
+                                                     name:NSTextStorageDidProcessEditingNotification
+                                                   object:textStorage];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (BOOL)isBatching {
+    return _batchDepth > 0;
+}
+
+- (void)beginBatch {
+    _batchDepth++;
+}
+
+- (void)endBatch {
+    NSAssert(_batchDepth > 0, @"endBatch without beginBatch");
+    if (_batchDepth == 0 || --_batchDepth > 0) {
+        return;
+    }
+    [self deliverPendingRecords];
+}
+
+- (void)deliverPendingRecords {
+    if (self.pendingRecords.count == 0) {
+        return;
+    }
+    NSArray *records = self.pendingRecords;
+    self.pendingRecords = [NSMutableArray array];
+    if (self.handler) {
+        self.handler(records);
+    }
+}
+
+- (void)textStorageDidProcessEditing:(NSNotification *)notification {
+    if (!self.handler) {
+        return;
+    }
+    NSTextStorage *textStorage = notification.object;
+    NSRange editedRange = textStorage.editedRange;
+    if (editedRange.location == NSNotFound) {
+        return;
+    }
+    NSInteger changeInLength = textStorage.changeInLength;
+    NSRange replacedRange = NSMakeRange(editedRange.location, (NSUInteger)((NSInteger)editedRange.length - changeInLength));
+    NSAttributedString *replacementText = self.includesReplacementText ? [textStorage attributedSubstringFromRange:editedRange] : nil;
+    RichTextEditorEditRecord *record = [[RichTextEditorEditRecord alloc] initWithRange:replacedRange
+                                                                    replacementLength:editedRange.length
+                                                                    charactersChanged:(textStorage.editedMask & NSTextStorageEditedCharacters) != 0
+                                                                    attributesChanged:(textStorage.editedMask & NSTextStorageEditedAttributes) != 0
+                                                                      replacementText:replacementText];
+    [self.pendingRecords addObject:record];
+    if (_batchDepth == 0) {
+        [self deliverPendingRecords];
+    }
+}
+
+@end
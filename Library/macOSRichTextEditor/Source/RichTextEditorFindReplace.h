@@ -0,0 +1,84 @@
+//
+//  RichTextEditorFindReplace.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+typedef NS_OPTIONS(NSUInteger, RichTextEditorFindOptions) {
+    RichTextEditorFindOptionsNone               = 0,
+    RichTextEditorFindOptionsCaseInsensitive    = 1 << 0,
+    /// Only matches with no letter, digit or underscore right before or after them.
+    RichTextEditorFindOptionsWholeWord          = 1 << 1,
+    /// The pattern is an NSRegularExpression pattern and replacement templates may use $1 etc.
+    RichTextEditorFindOptionsRegularExpression  = 1 << 2,
+};
+
+/// Finds and replaces text in an attributed string.
+///
+/// Literal searches use -[NSString rangeOfString:options:range:]; regular expressions use
+/// NSRegularExpression. Matches can be restricted to text with certain attributes (see
+/// attributeFilter), and never include a list marker at the start of a paragraph: a match that
+/// starts in one begins after it instead, and a match that would delete the marker of a later
+/// paragraph is skipped.
+///
+/// Searching only reads the string, so it can run on any thread. The configuration
+/// (attributeFilter, listMarkers) must not change while a background search is running.
+@interface RichTextEditorFindReplace : NSObject
+
+@property (nonatomic, readonly) NSString *pattern;
+@property (nonatomic, readonly) RichTextEditorFindOptions options;
+
+/// If set, a match is only kept if the filter returns YES for the attributes of every character
+/// in it, e.g. ^BOOL(NSDictionary *attributes) { return [attributes[NSFontAttributeName] isBold]; }
+@property (nonatomic, copy) BOOL (^attributeFilter)(NSDictionary<NSString *, id> *attributes);
+
+/// Paragraph prefixes that are never part of a match (the editor passes its bullet string).
+@property (nonatomic, copy) NSArray<NSString *> *listMarkers;
+
+/// Number of matches handed to the batch handler at a time by a background search. Defaults to 1000.
+@property (nonatomic) NSUInteger batchSize;
+
+/// Returns nil with an error if options include RichTextEditorFindOptionsRegularExpression and
+/// the pattern is not a valid regular expression.
+- (instancetype)initWithPattern:(NSString *)pattern options:(RichTextEditorFindOptions)options error:(NSError **)error;
+
+/// Calls block for each match in range, in order.
+- (void)enumerateMatchesInString:(NSAttributedString *)string range:(NSRange)range usingBlock:(void (^)(NSRange matchRange, BOOL *stop))block;
+
+/// The ranges of all matches in range, in order.
+- (NSArray<NSValue *> *)rangesOfMatchesInString:(NSAttributedString *)string range:(NSRange)range;
+
+/// Searches a copy of string on a background queue, so the string may be edited meanwhile.
+/// Matches are handed to batchHandler on the main queue batchSize at a time as they are found;
+/// completion is called on the main queue with the total count, and finished is NO if the search
+/// was cancelled. Starting a new background search cancels the previous one.
+- (void)findMatchesInBackgroundInString:(NSAttributedString *)string
+                           batchHandler:(void (^)(NSArray<NSValue *> *matchRanges))batchHandler
+                             completion:(void (^)(NSUInteger matchCount, BOOL finished))completion;
+
+- (void)cancelBackgroundSearch;
+
+/// Replaces every match in range with replacementTemplate (expanded per match for regular
+/// expressions) in a single beginEditing/endEditing transaction. Each replacement gets the
+/// attributes of the first character of its match. Returns the number of replacements; if
+/// replacedRange isn't NULL it is set to the range of the new text that spans them all.
+- (NSUInteger)replaceMatchesInTextStorage:(NSMutableAttributedString *)textStorage
+                                    range:(NSRange)range
+                             withTemplate:(NSString *)replacementTemplate
+                            replacedRange:(NSRange *)replacedRange;
+
+/// The first half of replaceMatchesInTextStorage:range:withTemplate:replacedRange:, for callers
+/// that need to know what will change before changing it (e.g. to record undo for just that
+/// span). Returns the text that replaces spanRange, which is set to the range from the start of
+/// the first match in range to the end of the last one; matchCount is set to the number of
+/// matches. Returns nil if there are no matches.
+- (NSAttributedString *)replacementForMatchesInString:(NSAttributedString *)string
+                                                range:(NSRange)range
+                                         withTemplate:(NSString *)replacementTemplate
+                                            spanRange:(NSRange *)spanRange
+                                           matchCount:(NSUInteger *)matchCount;
+
+@end
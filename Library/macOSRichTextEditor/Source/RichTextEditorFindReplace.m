@@ -0,0 +1,277 @@
+//
+//  RichTextEditorFindReplace.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFindReplace.h"
+
+static BOOL RTEIsWordCharacter(unichar character) {
+    return character == '_' || [[NSCharacterSet alphanumericCharacterSet] characterIsMember:character];
+}
+
+static BOOL RTEIsParagraphStart(NSString *text, NSUInteger location) {
+    return location == 0 || [[NSCharacterSet newlineCharacterSet] characterIsMember:[text characterAtIndex:location - 1]];
+}
+
+@interface RichTextEditorFindReplace ()
+
+@property NSRegularExpression *regularExpression;
+@property (atomic) NSUInteger searchGeneration;
+
+@end
+
+@implementation RichTextEditorFindReplace
+
+- (instancetype)initWithPattern:(NSString *)pattern options:(RichTextEditorFindOptions)options error:(NSError **)error {
+    if (self = [super init]) {
+        _pattern = [pattern copy];
+        _options = options;
+        _batchSize = 1000;
+        if (options & RichTextEditorFindOptionsRegularExpression) {
+            NSString *expression = (options & RichTextEditorFindOptionsWholeWord) ? [NSString stringWithFormat:@"\\b(?:%@)\\b", pattern] : pattern;
+            NSRegularExpressionOptions regularExpressionOptions = (options & RichTextEditorFindOptionsCaseInsensitive) ? NSRegularExpressionCaseInsensitive : 0;
+            _regularExpression = [NSRegularExpression regularExpressionWithPattern:expression options:regularExpressionOptions error:error];
+            if (!_regularExpression) {
+                return nil;
+            }
+        }
+    }
+    return self;
+}
+
+#pragma mark - Matching
+
+// Matches of the pattern alone, before list markers and the attribute filter are applied.
+// result is only set for regular expressions.
+- (void)enumeratePatternMatchesInString:(NSString *)text range:(NSRange)range
+                             usingBlock:(void (^)(NSRange matchRange, NSTextCheckingResult *result, BOOL *stop))block {
+    if (self.regularExpression) {
+        // Transparent, non-anchoring bounds so that a search of part of the text sees the same
+        // word boundaries and line starts as a search of all of it
+        [self.regularExpression enumerateMatchesInString:text options:NSMatchingWithTransparentBounds | NSMatchingWithoutAnchoringBounds range:range
+                                              usingBlock:^(NSTextCheckingResult *result, NSMatchingFlags flags, BOOL *stop) {
+            if (result.range.length > 0) {
+                block(result.range, result, stop);
+            }
+        }];
+        return;
+    }
+    if (self.pattern.length == 0) {
+        return;
+    }
+    NSStringCompareOptions compareOptions = NSLiteralSearch | ((self.options & RichTextEditorFindOptionsCaseInsensitive) ? NSCaseInsensitiveSearch : 0);
+    BOOL wholeWord = (self.options & RichTextEditorFindOptionsWholeWord) != 0;
+    NSUInteger location = range.location;
+    NSUInteger end = NSMaxRange(range);
+    BOOL stop = NO;
+    while (location < end && !stop) {
+        NSRange found = [text rangeOfString:self.pattern options:compareOptions range:NSMakeRange(location, end - location)];
+        if (found.location == NSNotFound) {
+            break;
+        }
+        if (wholeWord && ((found.location > 0 && RTEIsWordCharacter([text characterAtIndex:found.location - 1])) ||
+                          (NSMaxRange(found) < text.length && RTEIsWordCharacter([text characterAtIndex:NSMaxRange(found)])))) {
+            location = found.location + 1;
+            continue;
+        }
+        block(found, nil, &stop);
+        location = NSMaxRange(found);
+    }
+}
+
+// The part of range that doesn't touch a list marker at the start of a paragraph, or
+// NSNotFound if there is nothing left or the match would delete a later paragraph's marker
+- (NSRange)rangeExcludingListMarkers:(NSRange)range inString:(NSString *)text {
+    for (NSString *marker in self.listMarkers) {
+        if (marker.length == 0) {
+            continue;
+        }
+        // Markers that start before the match but reach into it, or start in it and reach past it
+        NSUInteger searchStart = range.location >= marker.length - 1 ? range.location - (marker.length - 1) : 0;
+        NSUInteger searchEnd = MIN(NSMaxRange(range) + marker.length - 1, text.length);
+        NSRange found = [text rangeOfString:marker options:NSLiteralSearch range:NSMakeRange(searchStart, searchEnd - searchStart)];
+        while (found.location != NSNotFound && found.location < NSMaxRange(range)) {
+            if (RTEIsParagraphStart(text, found.location) && NSMaxRange(found) > range.location) {
+                if (found.location > range.location) {
+                    return NSMakeRange(NSNotFound, 0);
+                }
+                if (NSMaxRange(found) >= NSMaxRange(range)) {
+                    return NSMakeRange(NSNotFound, 0);
+                }
+                range = NSMakeRange(NSMaxRange(found), NSMaxRange(range) - NSMaxRange(found));
+            }
+            NSUInteger next = found.location + 1;
+            found = next < searchEnd ? [text rangeOfString:marker options:NSLiteralSearch range:NSMakeRange(next, searchEnd - next)] : NSMakeRange(NSNotFound, 0);
+        }
+    }
+    return range;
+}
+
+- (BOOL)attributesInRange:(NSRange)range ofString:(NSAttributedString *)string passFilter:(BOOL (^)(NSDictionary *))filter {
+    __block BOOL passes = YES;
+    [string enumerateAttributesInRange:range options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                            usingBlock:^(NSDictionary *attributes, NSRange attributeRange, BOOL *stop) {
+        if (!filter(attributes)) {
+            passes = NO;
+            *stop = YES;
+        }
+    }];
+    return passes;
+}
+
+- (void)enumerateMatchesWithResultsInString:(NSAttributedString *)string range:(NSRange)range
+                                 usingBlock:(void (^)(NSRange matchRange, NSTextCheckingResult *result, BOOL *stop))block {
+    NSString *text = string.string;
+    range.location = MIN(range.location, text.length);
+    range.length = MIN(range.length, text.length - range.location);
+    BOOL (^filter)(NSDictionary *) = self.attributeFilter;
+    BOOL checksListMarkers = self.listMarkers.count > 0;
+    [self enumeratePatternMatchesInString:text range:range usingBlock:^(NSRange matchRange, NSTextCheckingResult *result, BOOL *stop) {
+        if (checksListMarkers) {
+            matchRange = [self rangeExcludingListMarkers:matchRange inString:text];
+            if (matchRange.location == NSNotFound) {
+                return;
+            }
+        }
+        if (filter && ![self attributesInRange:matchRange ofString:string passFilter:filter]) {
+            return;
+        }
+        block(matchRange, result, stop);
+    }];
+}
+
+- (void)enumerateMatchesInString:(NSAttributedString *)string range:(NSRange)range usingBlock:(void (^)(NSRange matchRange, BOOL *stop))block {
+    [self enumerateMatchesWithResultsInString:string range:range usingBlock:^(NSRange matchRange, NSTextCheckingResult *result, BOOL *stop) {
+        block(matchRange, stop);
+    }];
+}
+
+- (NSArray<NSValue *> *)rangesOfMatchesInString:(NSAttributedString *)string range:(NSRange)range {
+    NSMutableArray *ranges = [NSMutableArray array];
+    [self enumerateMatchesInString:string range:range usingBlock:^(NSRange matchRange, BOOL *stop) {
+        [ranges addObject:[NSValue valueWithRange:matchRange]];
+    }];
+    return ranges;
+}
+
+#pragma mark - Background Search
+
+- (void)findMatchesInBackgroundInString:(NSAttributedString *)string
+                           batchHandler:(void (^)(NSArray<NSValue *> *matchRanges))batchHandler
+                             completion:(void (^)(NSUInteger matchCount, BOOL finished))completion {
+    NSUInteger generation = ++self.searchGeneration;
+    NSAttributedString *snapshot = [string copy];
+    NSUInteger batchSize = MAX(self.batchSize, (NSUInteger)1);
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        __block NSMutableArray *batch = [NSMutableArray arrayWithCapacity:batchSize];
+        __block NSUInteger matchCount = 0;
+        __block BOOL cancelled = NO;
+        void (^deliver)(NSArray *) = ^(NSArray *matches) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if (batchHandler && self.searchGeneration == generation) {
+                    batchHandler(matches);
+                }
+            });
+        };
+        [self enumerateMatchesInString:snapshot range:NSMakeRange(0, snapshot.length) usingBlock:^(NSRange matchRange, BOOL *stop) {
+            if (self.searchGeneration != generation) {
+                cancelled = YES;
+                *stop = YES;
+                return;
+            }
+            [batch addObject:[NSValue valueWithRange:matchRange]];
+            matchCount++;
+            if (batch.count == batchSize) {
+                deliver(batch);
+                batch = [NSMutableArray arrayWithCapacity:batchSize];
+            }
+        }];
+        if (batch.count > 0 && !cancelled) {
+            deliver(batch);
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (completion) {
+                completion(matchCount, !cancelled && self.searchGeneration == generation);
+            }
+        });
+    });
+}
+
+- (void)cancelBackgroundSearch {
+    self.searchGeneration++;
+}
+
+#pragma mark - Replacing
+
+- (NSUInteger)replaceMatchesInTextStorage:(NSMutableAttributedString *)textStorage
+                                    range:(NSRange)range
+                             withTemplate:(NSString *)replacementTemplate
+                            replacedRange:(NSRange *)replacedRange {
+    NSRange spanRange;
+    NSUInteger matchCount = 0;
+    NSAttributedString *replacementSpan = [self replacementForMatchesInString:textStorage range:range withTemplate:replacementTemplate
+                                                                    spanRange:&spanRange matchCount:&matchCount];
+    if (!replacementSpan) {
+        if (replacedRange) {
+            *replacedRange = NSMakeRange(NSNotFound, 0);
+        }
+        return 0;
+    }
+    [textStorage beginEditing];
+    [textStorage replaceCharactersInRange:spanRange withAttributedString:replacementSpan];
+    [textStorage endEditing];
+    if (replacedRange) {
+        *replacedRange = NSMakeRange(spanRange.location, replacementSpan.length);
+    }
+    return matchCount;
+}
+
+- (NSAttributedString *)replacementForMatchesInString:(NSAttributedString *)string
+                                                range:(NSRange)range
+                                         withTemplate:(NSString *)replacementTemplate
+                                            spanRange:(NSRange *)spanRange
+                                           matchCount:(NSUInteger *)matchCount {
+    NSString *text = [string.string copy];
+    NSMutableArray *matchRanges = [NSMutableArray array];
+    NSMutableArray *replacements = [NSMutableArray array];
+    NSString *literalReplacement = replacementTemplate ?: @"";
+    [self enumerateMatchesWithResultsInString:string range:range usingBlock:^(NSRange matchRange, NSTextCheckingResult *result, BOOL *stop) {
+        [matchRanges addObject:[NSValue valueWithRange:matchRange]];
+        [replacements addObject:result ? [self.regularExpression replacementStringForResult:result inString:text offset:0 template:literalReplacement]
+                                       : literalReplacement];
+    }];
+    if (matchCount) {
+        *matchCount = matchRanges.count;
+    }
+    if (matchRanges.count == 0) {
+        return nil;
+    }
+    // Build the new text from the first match to the end of the last one, so it can be put in
+    // with a single replacement rather than editing the text storage once per match
+    NSUInteger spanStart = [matchRanges.firstObject rangeValue].location;
+    NSUInteger spanEnd = NSMaxRange([matchRanges.lastObject rangeValue]);
+    NSMutableAttributedString *replacementSpan = [[NSMutableAttributedString alloc] init];
+    [replacementSpan beginEditing];
+    NSUInteger location = spanStart;
+    for (NSUInteger i = 0; i < matchRanges.count; i++) {
+        NSRange matchRange = [matchRanges[i] rangeValue];
+        if (matchRange.location > location) {
+            [replacementSpan appendAttributedString:[string attributedSubstringFromRange:NSMakeRange(location, matchRange.location - location)]];
+        }
+        NSString *replacement = replacements[i];
+        if (replacement.length > 0) {
+            NSDictionary *attributes = [string attributesAtIndex:matchRange.location effectiveRange:NULL];
+            [replacementSpan appendAttributedString:[[NSAttributedString alloc] initWithString:replacement attributes:attributes]];
+        }
+        location = NSMaxRange(matchRange);
+    }
+    [replacementSpan endEditing];
+    if (spanRange) {
+        *spanRange = NSMakeRange(spanStart, spanEnd - spanStart);
+    }
+    return replacementSpan;
+}
+
+@end
@@ -0,0 +1,47 @@
+//
+//  RichTextEditorFontCache.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+/// Remembers the results of the NSFont(RichTextEditor) trait conversions so that changing the
+/// font, size or bold/italic of many attribute runs only goes to Core Text once per distinct font.
+///
+/// The cache is bounded (see countLimit) and safe to use from any thread.
+@interface RichTextEditorFontCache : NSObject
+
+/// The cache used by NSFont(RichTextEditor).
++ (instancetype)sharedCache;
+
+/// Maximum number of resolved fonts and names to keep. Defaults to 512.
+@property (nonatomic) NSUInteger countLimit;
+
+/// Set to NO to resolve every font through Core Text again (for debugging and benchmarks). Defaults to YES.
+@property (atomic, getter=isEnabled) BOOL enabled;
+
+/// Number of lookups answered from the cache. Each call to one of the methods below counts once
+/// as a hit or a miss; lookups it makes internally while resolving a font aren't counted.
+@property (nonatomic, readonly) NSUInteger hitCount;
+
+/// Number of lookups that had to resolve the font.
+@property (nonatomic, readonly) NSUInteger missCount;
+
+/// Cached version of +[NSFont fontWithName:size:boldTrait:italicTrait:].
+- (NSFont *)fontWithName:(NSString *)name size:(CGFloat)size boldTrait:(BOOL)isBold italicTrait:(BOOL)isItalic;
+
+/// Cached version of -[NSFont fontWithBoldTrait:italicTrait:andSize:].
+- (NSFont *)fontFromFont:(NSFont *)font withBoldTrait:(BOOL)isBold italicTrait:(BOOL)isItalic size:(CGFloat)size;
+
+/// Cached version of +[NSFont postscriptNameFromFullName:].
+- (NSString *)postscriptNameFromFullName:(NSString *)fullName;
+
+/// Forgets every cached font. Counters are left alone.
+- (void)removeAllFonts;
+
+/// Sets hitCount and missCount back to 0.
+- (void)resetStatistics;
+
+@end
@@ -0,0 +1,243 @@
+//
+//  RichTextEditorFontCache.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFontCache.h"
+#import <CoreText/CoreText.h>
+#import <stdatomic.h>
+
+typedef NS_ENUM(uint8_t, RichTextEditorFontCacheKeyKind) {
+    RichTextEditorFontCacheKeyKindName,     // fontWithName:size:boldTrait:italicTrait:
+    RichTextEditorFontCacheKeyKindFont,     // fontFromFont:withBoldTrait:italicTrait:size:
+    RichTextEditorFontCacheKeyKindPostScript // postscriptNameFromFullName:
+};
+
+@interface RichTextEditorFontCacheKey : NSObject <NSCopying>
+
+@property (readonly) NSString *name;
+@property (readonly) CGFloat size;
+@property (readonly) uint8_t traits;
+@property (readonly) RichTextEditorFontCacheKeyKind kind;
+
+@end
+
+@implementation RichTextEditorFontCacheKey {
+    NSUInteger _hash;
+}
+
+- (instancetype)initWithName:(NSString *)name size:(CGFloat)size bold:(BOOL)isBold italic:(BOOL)isItalic kind:(RichTextEditorFontCacheKeyKind)kind {
+    if (self = [super init]) {
+        _name = [name copy];
+        _size = size;
+        _traits = (isBold ? 1 : 0) | (isItalic ? 2 : 0);
+        _kind = kind;
+        _hash = _name.hash ^ ((NSUInteger)(size * 64) << 4) ^ ((NSUInteger)_traits << 1) ^ ((NSUInteger)kind << 2);
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // immutable
+}
+
+- (NSUInteger)hash {
+    return _hash;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[RichTextEditorFontCacheKey class]]) {
+        return NO;
+    }
+    RichTextEditorFontCacheKey *other = object;
+    return _hash == other->_hash && _size == other.size && _traits == other.traits && _kind == other.kind &&
+        (_name == other.name || [_name isEqualToString:other.name]);
+}
+
+@end
+
+@interface RichTextEditorFontCache () {
+    atomic_ulong _hitCount;
+    atomic_ulong _missCount;
+}
+
+@property NSCache *cache;
+
+@end
+
+@implementation RichTextEditorFontCache
+
++ (instancetype)sharedCache {
+    static RichTextEditorFontCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[RichTextEditorFontCache alloc] init];
+    });
+    return sharedCache;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _cache = [[NSCache alloc] init];
+        _cache.name = @"RichTextEditorFontCache";
+        self.countLimit = 512;
+        _enabled = YES;
+        atomic_init(&_hitCount, 0);
+        atomic_init(&_missCount, 0);
+    }
+    return self;
+}
+
+- (void)setCountLimit:(NSUInteger)countLimit {
+    _countLimit = countLimit;
+    self.cache.countLimit = countLimit;
+}
+
+- (NSUInteger)hitCount {
+    return atomic_load_explicit(&_hitCount, memory_order_relaxed);
+}
+
+- (NSUInteger)missCount {
+    return atomic_load_explicit(&_missCount, memory_order_relaxed);
+}
+
+- (void)resetStatistics {
+    atomic_store_explicit(&_hitCount, 0, memory_order_relaxed);
+    atomic_store_explicit(&_missCount, 0, memory_order_relaxed);
+}
+
+- (void)removeAllFonts {
+    [self.cache removeAllObjects];
+}
+
+#pragma mark - Lookups -
+
+// Returns the cached value for key, or resolves, caches and returns it.
+// Failed lookups are cached too (as NSNull) so they aren't retried for every run.
+// Lookups made while resolving another one pass counted:NO, so that each public call counts
+// as exactly one hit or miss.
+- (id)objectForKey:(RichTextEditorFontCacheKey *)key counted:(BOOL)counted resolvingWith:(id (^)(void))resolve {
+    if (!self.enabled) {
+        return resolve();
+    }
+    id object = [self.cache objectForKey:key];
+    if (object) {
+        if (counted) {
+            atomic_fetch_add_explicit(&_hitCount, 1, memory_order_relaxed);
+        }
+        return object == [NSNull null] ? nil : object;
+    }
+    if (counted) {
+        atomic_fetch_add_explicit(&_missCount, 1, memory_order_relaxed);
+    }
+    object = resolve();
+    [self.cache setObject:(object ? object : [NSNull null]) forKey:key];
+    return object;
+}
+
+- (NSFont *)fontWithName:(NSString *)name size:(CGFloat)size boldTrait:(BOOL)isBold italicTrait:(BOOL)isItalic {
+    return [self fontWithName:name size:size boldTrait:isBold italicTrait:isItalic counted:YES];
+}
+
+- (NSFont *)fontWithName:(NSString *)name size:(CGFloat)size boldTrait:(BOOL)isBold italicTrait:(BOOL)isItalic counted:(BOOL)counted {
+    if (!name) {
+        return nil;
+    }
+    RichTextEditorFontCacheKey *key = [[RichTextEditorFontCacheKey alloc] initWithName:name size:size bold:isBold italic:isItalic
+                                                                                  kind:RichTextEditorFontCacheKeyKindName];
+    return [self objectForKey:key counted:counted resolvingWith:^id{
+        return [self resolveFontWithName:name size:size boldTrait:isBold italicTrait:isItalic];
+    }];
+}
+
+- (NSFont *)fontFromFont:(NSFont *)font withBoldTrait:(BOOL)isBold italicTrait:(BOOL)isItalic size:(CGFloat)size {
+    if (!font) {
+        return nil;
+    }
+    RichTextEditorFontCacheKey *key = [[RichTextEditorFontCacheKey alloc] initWithName:font.fontName size:size bold:isBold italic:isItalic
+                                                                                  kind:RichTextEditorFontCacheKeyKindFont];
+    return [self objectForKey:key counted:YES resolvingWith:^id{
+        NSString *familyName = CFBridgingRelease(CTFontCopyName((__bridge CTFontRef)font, kCTFontFamilyNameKey));
+        NSString *postScriptName = [self postscriptNameFromFullName:familyName counted:NO];
+        return [self fontWithName:postScriptName size:size boldTrait:isBold italicTrait:isItalic counted:NO];
+    }];
+}
+
+- (NSString *)postscriptNameFromFullName:(NSString *)fullName {
+    return [self postscriptNameFromFullName:fullName counted:YES];
+}
+
+- (NSString *)postscriptNameFromFullName:(NSString *)fullName counted:(BOOL)counted {
+    if (!fullName) {
+        return nil;
+    }
+    // avoid error with "All system UI font access should be through proper APIs..."
+    // by bailing early if the user gets here with a system font
+    if ([fullName containsString:@"SFNS"]) {
+        return fullName;
+    }
+    RichTextEditorFontCacheKey *key = [[RichTextEditorFontCacheKey alloc] initWithName:fullName size:0 bold:NO italic:NO
+                                                                                  kind:RichTextEditorFontCacheKeyKindPostScript];
+    return [self objectForKey:key counted:counted resolvingWith:^id{
+        NSFont *font = [NSFont fontWithName:fullName size:1];
+        return font ? CFBridgingRelease(CTFontCopyPostScriptName((__bridge CTFontRef)font)) : nil;
+    }];
+}
+
+#pragma mark - Resolving -
+
+- (NSFont *)resolveFontWithName:(NSString *)name size:(CGFloat)size boldTrait:(BOOL)isBold italicTrait:(BOOL)isItalic {
+    // avoid error with "All system UI font access should be through proper APIs..."
+    // by bailing early if the user gets here with a system font
+    if ([name containsString:@"SFNS"]) {
+        NSFontManager *fontManager = [NSFontManager sharedFontManager];
+        NSFont *sysFont = [NSFont systemFontOfSize:size];
+        if (isItalic) {
+            sysFont = [fontManager convertFont:sysFont toHaveTrait:NSFontItalicTrait];
+        }
+        if (isBold) {
+            sysFont = [fontManager convertFont:sysFont toHaveTrait:NSFontBoldTrait];
+        }
+        return sysFont;
+    }
+    NSString *postScriptName = [self postscriptNameFromFullName:name counted:NO];
+    if (!postScriptName) {
+        postScriptName = name;
+    }
+
+    CTFontRef fontWithoutTrait = CTFontCreateWithName((__bridge CFStringRef)(postScriptName), size, NULL);
+    CTFontSymbolicTraits traits = 0;
+    CTFontRef newFontRef;
+
+    if (isItalic) {
+        traits |= kCTFontItalicTrait;
+    }
+
+    if (isBold) {
+        traits |= kCTFontBoldTrait;
+    }
+
+    if (traits == 0) {
+        newFontRef = CTFontCreateCopyWithAttributes(fontWithoutTrait, 0.0, NULL, NULL);
+    }
+    else {
+        newFontRef = CTFontCreateCopyWithSymbolicTraits(fontWithoutTrait, 0.0, NULL, traits, traits);
+    }
+
+    if (fontWithoutTrait) {
+        CFRelease(fontWithoutTrait);
+    }
+
+    if (newFontRef) {
+        NSString *fontNameKey = CFBridgingRelease(CTFontCopyName(newFontRef, kCTFontPostScriptNameKey));
+        CGFloat fontSize = CTFontGetSize(newFontRef);
+        CFRelease(newFontRef);
+        return [NSFont fontWithName:fontNameKey size:fontSize];
+    }
+
+    return nil;
+}
+
+@end
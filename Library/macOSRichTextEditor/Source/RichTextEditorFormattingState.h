@@ -0,0 +1,47 @@
+//
+//  RichTextEditorFormattingState.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+typedef NS_OPTIONS(NSUInteger, RichTextEditorFormattingField) {
+    RichTextEditorFormattingFieldNone               = 0,
+    RichTextEditorFormattingFieldSelectedRange      = 1 << 0,
+    RichTextEditorFormattingFieldBold               = 1 << 1,
+    RichTextEditorFormattingFieldItalic             = 1 << 2,
+    RichTextEditorFormattingFieldUnderline          = 1 << 3,
+    RichTextEditorFormattingFieldBulletedList       = 1 << 4,
+    RichTextEditorFormattingFieldTextBackgroundColor = 1 << 5,
+    RichTextEditorFormattingFieldTextColor          = 1 << 6,
+    RichTextEditorFormattingFieldAll                = (1 << 7) - 1
+};
+
+/// Immutable snapshot of the selection and typing attributes that a toolbar cares about.
+/// The editor hands one of these to richTextEditor:formattingStateChanged: together with
+/// the fields that differ from the previous snapshot, so toolbars only redraw what changed.
+@interface RichTextEditorFormattingState : NSObject <NSCopying>
+
+@property (nonatomic, readonly) NSRange selectedRange;
+@property (nonatomic, readonly) BOOL isBold;
+@property (nonatomic, readonly) BOOL isItalic;
+@property (nonatomic, readonly) BOOL isUnderline;
+@property (nonatomic, readonly) BOOL isInBulletedList;
+@property (nonatomic, readonly) NSColor *textBackgroundColor;
+@property (nonatomic, readonly) NSColor *textColor;
+
+/// Fields that differ from the state delivered before this one.
+/// RichTextEditorFormattingFieldAll for the first state an editor delivers.
+@property (nonatomic, readonly) RichTextEditorFormattingField changedFields;
+
+- (instancetype)initWithSelectedRange:(NSRange)selectedRange isBold:(BOOL)isBold isItalic:(BOOL)isItalic
+                          isUnderline:(BOOL)isUnderline isInBulletedList:(BOOL)isInBulletedList
+                  textBackgroundColor:(NSColor *)textBackgroundColor textColor:(NSColor *)textColor
+                        previousState:(RichTextEditorFormattingState *)previousState;
+
+/// Fields whose values differ between the receiver and state. Ignores changedFields.
+- (RichTextEditorFormattingField)fieldsDifferingFromState:(RichTextEditorFormattingState *)state;
+
+@end
@@ -0,0 +1,80 @@
+//
+//  RichTextEditorFormattingState.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFormattingState.h"
+
+@implementation RichTextEditorFormattingState
+
+- (instancetype)initWithSelectedRange:(NSRange)selectedRange isBold:(BOOL)isBold isItalic:(BOOL)isItalic
+                          isUnderline:(BOOL)isUnderline isInBulletedList:(BOOL)isInBulletedList
+                  textBackgroundColor:(NSColor *)textBackgroundColor textColor:(NSColor *)textColor
+                        previousState:(RichTextEditorFormattingState *)previousState {
+    if (self = [super init]) {
+        _selectedRange = selectedRange;
+        _isBold = isBold;
+        _isItalic = isItalic;
+        _isUnderline = isUnderline;
+        _isInBulletedList = isInBulletedList;
+        _textBackgroundColor = textBackgroundColor;
+        _textColor = textColor;
+        _changedFields = previousState ? [self fieldsDifferingFromState:previousState] : RichTextEditorFormattingFieldAll;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // immutable
+}
+
+static BOOL RTEColorsAreEqual(NSColor *first, NSColor *second) {
+    return first == second || [first isEqual:second];
+}
+
+- (RichTextEditorFormattingField)fieldsDifferingFromState:(RichTextEditorFormattingState *)state {
+    RichTextEditorFormattingField fields = RichTextEditorFormattingFieldNone;
+    if (!NSEqualRanges(_selectedRange, state.selectedRange)) {
+        fields |= RichTextEditorFormattingFieldSelectedRange;
+    }
+    if (_isBold != state.isBold) {
+        fields |= RichTextEditorFormattingFieldBold;
+    }
+    if (_isItalic != state.isItalic) {
+        fields |= RichTextEditorFormattingFieldItalic;
+    }
+    if (_isUnderline != state.isUnderline) {
+        fields |= RichTextEditorFormattingFieldUnderline;
+    }
+    if (_isInBulletedList != state.isInBulletedList) {
+        fields |= RichTextEditorFormattingFieldBulletedList;
+    }
+    if (!RTEColorsAreEqual(_textBackgroundColor, state.textBackgroundColor)) {
+        fields |= RichTextEditorFormattingFieldTextBackgroundColor;
+    }
+    if (!RTEColorsAreEqual(_textColor, state.textColor)) {
+        fields |= RichTextEditorFormattingFieldTextColor;
+    }
+    return fields;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[RichTextEditorFormattingState class]]) {
+        return NO;
+    }
+    return [self fieldsDifferingFromState:object] == RichTextEditorFormattingFieldNone;
+}
+
+- (NSUInteger)hash {
+    return _selectedRange.location ^ (_selectedRange.length << 8) ^ (NSUInteger)(_isBold | (_isItalic << 1) | (_isUnderline << 2) | (_isInBulletedList << 3));
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p; range = %@; bold = %d; italic = %d; underline = %d; bulleted = %d; changed = 0x%lx>",
+            NSStringFromClass([self class]), self, NSStringFromRange(_selectedRange), _isBold, _isItalic, _isUnderline,
+            _isInBulletedList, (unsigned long)_changedFields];
+}
+
+@end
@@ -0,0 +1,175 @@
+//
+//  RichTextEditorFoundationText.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+// The text attribute classes the document model (RichTextEditorDocument, RichTextEditorParagraphIndex,
+// RichTextEditorParagraphBatch, RichTextEditorAttributeInterner, RichTextEditorStyleTransform and
+// the HTML reader and writer) is written against.
+//
+// Normally these are AppKit's. The GNUmakefile builds the model with RTE_FOUNDATION_ONLY set and
+// only gnustep-base, for machines without a window server; then this header declares stand-ins
+// that hold what the model needs, under the AppKit names. Fonts and colors keep their values but
+// can't be measured or drawn, so text widths are approximated (see RichTextEditorDocument).
+
+#ifndef RTE_FOUNDATION_ONLY
+#define RTE_FOUNDATION_ONLY 0
+#endif
+
+#if RTE_FOUNDATION_ONLY
+
+#import <Foundation/Foundation.h>
+#import <dispatch/dispatch.h>
+
+// Widths used where AppKit would measure text. Both can be set on the compiler command line.
+#ifndef RTE_FOUNDATION_ONLY_CHARACTER_WIDTH
+// Half of the default 12 point font, which is about how wide a bullet or a space is
+#define RTE_FOUNDATION_ONLY_CHARACTER_WIDTH 6.0
+#endif
+#ifndef RTE_FOUNDATION_ONLY_TAB_INTERVAL
+// AppKit's default tab stops are 28 points apart
+#define RTE_FOUNDATION_ONLY_TAB_INTERVAL 28.0
+#endif
+
+// Same names as AppKit's, so documents keep their attributes when they get there
+#define NSFontAttributeName @"NSFont"
+#define NSParagraphStyleAttributeName @"NSParagraphStyle"
+#define NSForegroundColorAttributeName @"NSColor"
+#define NSBackgroundColorAttributeName @"NSBackgroundColor"
+#define NSUnderlineStyleAttributeName @"NSUnderline"
+#define NSStrikethroughStyleAttributeName @"NSStrikethrough"
+#define NSKernAttributeName @"NSKern"
+#define NSExpansionAttributeName @"NSExpansion"
+
+// Keys of a font descriptor's attributes
+#define NSFontFamilyAttribute @"NSFontFamilyAttribute"
+#define NSFontNameAttribute @"NSFontNameAttribute"
+
+typedef NS_ENUM(NSInteger, NSUnderlineStyle) {
+    NSUnderlineStyleNone = 0x00,
+    NSUnderlineStyleSingle = 0x01
+};
+
+typedef NS_ENUM(NSInteger, NSTextAlignment) {
+    NSLeftTextAlignment = 0,
+    NSRightTextAlignment = 1,
+    NSCenterTextAlignment = 2,
+    NSJustifiedTextAlignment = 3,
+    NSNaturalTextAlignment = 4,
+    NSTextAlignmentLeft = NSLeftTextAlignment,
+    NSTextAlignmentRight = NSRightTextAlignment,
+    NSTextAlignmentCenter = NSCenterTextAlignment,
+    NSTextAlignmentJustified = NSJustifiedTextAlignment,
+    NSTextAlignmentNatural = NSNaturalTextAlignment
+};
+
+typedef NS_OPTIONS(NSUInteger, RichTextEditorTextStorageEditActions) {
+    NSTextStorageEditedAttributes = 1,
+    NSTextStorageEditedCharacters = 2
+};
+
+/// Posted by RichTextEditorTextStorage once an edit (or a beginEditing/endEditing block) is done.
+extern NSString * const RichTextEditorTextStorageDidProcessEditingNotification;
+#define NSTextStorageDidProcessEditingNotification RichTextEditorTextStorageDidProcessEditingNotification
+
+/// The parts of NSParagraphStyle the editing rules use.
+@interface RichTextEditorParagraphStyle : NSObject <NSCopying, NSMutableCopying>
+
++ (RichTextEditorParagraphStyle *)defaultParagraphStyle;
+
+@property (nonatomic, readonly) NSTextAlignment alignment;
+@property (nonatomic, readonly) CGFloat firstLineHeadIndent;
+@property (nonatomic, readonly) CGFloat headIndent;
+/// Distance between tab stops. 0 (the default) means AppKit's default tab stops, 28 points apart.
+@property (nonatomic, readonly) CGFloat defaultTabInterval;
+
+@end
+
+@interface RichTextEditorMutableParagraphStyle : RichTextEditorParagraphStyle
+
+@property (nonatomic) NSTextAlignment alignment;
+@property (nonatomic) CGFloat firstLineHeadIndent;
+@property (nonatomic) CGFloat headIndent;
+@property (nonatomic) CGFloat defaultTabInterval;
+
+@end
+
+/// The parts of NSTextStorage the editing rules use: a mutable attributed string that records what
+/// changed and posts NSTextStorageDidProcessEditingNotification, so the paragraph index keeps up.
+@interface RichTextEditorTextStorage : NSMutableAttributedString
+
+@property (nonatomic, readonly) NSUInteger editedMask;
+/// The changed text, in the coordinates of the text after the edit.
+@property (nonatomic, readonly) NSRange editedRange;
+@property (nonatomic, readonly) NSInteger changeInLength;
+
+- (void)edited:(NSUInteger)editedMask range:(NSRange)range changeInLength:(NSInteger)delta;
+
+@end
+
+/// The parts of NSFont, and of NSFont+RichTextEditor, the model uses. With no font files to look
+/// at, a font is a family, bold and italic traits and a size, and fontName is the family with a
+/// PostScript style suffix: "Helvetica-BoldOblique" is Helvetica, bold and italic. Any name gives
+/// a font.
+@interface RichTextEditorFont : NSObject <NSCopying>
+
++ (RichTextEditorFont *)fontWithName:(NSString *)fontName size:(CGFloat)fontSize;
++ (RichTextEditorFont *)fontWithName:(NSString *)name size:(CGFloat)size boldTrait:(BOOL)isBold italicTrait:(BOOL)isItalic;
+
+/// A font from the NSFontNameAttribute, or else the NSFontFamilyAttribute, of fontDescriptor.
++ (RichTextEditorFont *)fontWithDescriptor:(NSDictionary<NSString *, id> *)fontDescriptor size:(CGFloat)fontSize;
+
+@property (nonatomic, readonly) NSString *fontName;
+@property (nonatomic, readonly) NSString *familyName;
+@property (nonatomic, readonly) CGFloat pointSize;
+/// The font's attributes, for fontWithDescriptor:size: (NSFontDescriptor's fontAttributes).
+@property (nonatomic, readonly) NSDictionary<NSString *, id> *fontDescriptor;
+
+- (BOOL)isBold;
+- (BOOL)isItalic;
+
+- (RichTextEditorFont *)fontWithBoldTrait:(BOOL)bold italicTrait:(BOOL)italic andSize:(CGFloat)size;
+- (RichTextEditorFont *)fontWithBoldTrait:(BOOL)bold andItalicTrait:(BOOL)italic;
+
+@end
+
+/// The parts of NSColor the model uses: an RGB color with alpha, components from 0 to 1.
+@interface RichTextEditorColor : NSObject <NSCopying>
+
++ (RichTextEditorColor *)colorWithCalibratedRed:(CGFloat)red green:(CGFloat)green blue:(CGFloat)blue alpha:(CGFloat)alpha;
+
+@property (nonatomic, readonly) CGFloat redComponent;
+@property (nonatomic, readonly) CGFloat greenComponent;
+@property (nonatomic, readonly) CGFloat blueComponent;
+@property (nonatomic, readonly) CGFloat alphaComponent;
+
+- (void)getRed:(CGFloat *)red green:(CGFloat *)green blue:(CGFloat *)blue alpha:(CGFloat *)alpha;
+
+@end
+
+@compatibility_alias NSParagraphStyle RichTextEditorParagraphStyle;
+@compatibility_alias NSMutableParagraphStyle RichTextEditorMutableParagraphStyle;
+@compatibility_alias NSTextStorage RichTextEditorTextStorage;
+@compatibility_alias NSFont RichTextEditorFont;
+@compatibility_alias NSColor RichTextEditorColor;
+
+// The UTF-16 helpers of Core Foundation the HTML writer uses
+static inline BOOL CFStringIsSurrogateHighCharacter(unichar character) {
+    return character >= 0xD800 && character <= 0xDBFF;
+}
+
+static inline BOOL CFStringIsSurrogateLowCharacter(unichar character) {
+    return character >= 0xDC00 && character <= 0xDFFF;
+}
+
+static inline uint32_t CFStringGetLongCharacterForSurrogatePair(unichar surrogateHigh, unichar surrogateLow) {
+    return (((uint32_t)surrogateHigh - 0xD800) << 10) + ((uint32_t)surrogateLow - 0xDC00) + 0x10000;
+}
+
+#else
+
+#import <Cocoa/Cocoa.h>
+
+#endif
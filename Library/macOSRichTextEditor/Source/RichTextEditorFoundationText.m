@@ -0,0 +1,349 @@
+//
+//  RichTextEditorFoundationText.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFoundationText.h"
+
+#if RTE_FOUNDATION_ONLY
+
+NSString * const RichTextEditorTextStorageDidProcessEditingNotification = @"NSTextStorageDidProcessEditingNotification";
+
+@interface RichTextEditorParagraphStyle () {
+@protected
+    NSTextAlignment _alignment;
+    CGFloat _firstLineHeadIndent;
+    CGFloat _headIndent;
+    CGFloat _defaultTabInterval;
+}
+
+@end
+
+@implementation RichTextEditorParagraphStyle
+
++ (RichTextEditorParagraphStyle *)defaultParagraphStyle {
+    static RichTextEditorParagraphStyle *defaultParagraphStyle;
+    @synchronized (self) {
+        if (!defaultParagraphStyle) {
+            defaultParagraphStyle = [[RichTextEditorParagraphStyle alloc] init];
+        }
+    }
+    return defaultParagraphStyle;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _alignment = NSNaturalTextAlignment;
+    }
+    return self;
+}
+
+- (void)copyValuesFromParagraphStyle:(RichTextEditorParagraphStyle *)paragraphStyle {
+    _alignment = paragraphStyle.alignment;
+    _firstLineHeadIndent = paragraphStyle.firstLineHeadIndent;
+    _headIndent = paragraphStyle.headIndent;
+    _defaultTabInterval = paragraphStyle.defaultTabInterval;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    if ([self isMemberOfClass:[RichTextEditorParagraphStyle class]]) {
+        return self; // immutable
+    }
+    RichTextEditorParagraphStyle *copy = [[RichTextEditorParagraphStyle alloc] init];
+    [copy copyValuesFromParagraphStyle:self];
+    return copy;
+}
+
+- (id)mutableCopyWithZone:(NSZone *)zone {
+    RichTextEditorMutableParagraphStyle *copy = [[RichTextEditorMutableParagraphStyle alloc] init];
+    [copy copyValuesFromParagraphStyle:self];
+    return copy;
+}
+
+- (NSUInteger)hash {
+    return (NSUInteger)_alignment ^ ((NSUInteger)lround(_firstLineHeadIndent) << 4) ^ ((NSUInteger)lround(_headIndent) << 12) ^
+        ((NSUInteger)lround(_defaultTabInterval) << 20);
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[RichTextEditorParagraphStyle class]]) {
+        return NO;
+    }
+    RichTextEditorParagraphStyle *other = object;
+    return _alignment == other.alignment && _firstLineHeadIndent == other.firstLineHeadIndent &&
+        _headIndent == other.headIndent && _defaultTabInterval == other.defaultTabInterval;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: alignment %ld, firstLineHeadIndent %g, headIndent %g, defaultTabInterval %g>",
+            NSStringFromClass([self class]), (long)_alignment, _firstLineHeadIndent, _headIndent, _defaultTabInterval];
+}
+
+@end
+
+@implementation RichTextEditorMutableParagraphStyle
+
+@dynamic alignment, firstLineHeadIndent, headIndent, defaultTabInterval;
+
+- (void)setAlignment:(NSTextAlignment)alignment {
+    _alignment = alignment;
+}
+
+- (void)setFirstLineHeadIndent:(CGFloat)firstLineHeadIndent {
+    _firstLineHeadIndent = firstLineHeadIndent;
+}
+
+- (void)setHeadIndent:(CGFloat)headIndent {
+    _headIndent = headIndent;
+}
+
+- (void)setDefaultTabInterval:(CGFloat)defaultTabInterval {
+    _defaultTabInterval = defaultTabInterval;
+}
+
+@end
+
+@implementation RichTextEditorTextStorage {
+    NSMutableAttributedString *_storage;
+    NSUInteger _editingCount;
+}
+
+// gnustep-base's NSAttributedString sends every other initializer, including init, to this one and
+// leaves it to the subclass, so it doesn't call super
+- (instancetype)initWithString:(NSString *)string attributes:(NSDictionary *)attributes {
+    _storage = [[NSMutableAttributedString alloc] initWithString:(string ?: @"") attributes:attributes];
+    _editedRange = NSMakeRange(NSNotFound, 0);
+    return self;
+}
+
+- (instancetype)init {
+    return [self initWithString:@"" attributes:nil];
+}
+
+- (instancetype)initWithString:(NSString *)string {
+    return [self initWithString:string attributes:nil];
+}
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)string {
+    self = [self initWithString:@"" attributes:nil];
+    if (string) {
+        [_storage setAttributedString:string];
+    }
+    return self;
+}
+
+- (NSString *)string {
+    return _storage.string;
+}
+
+- (NSDictionary *)attributesAtIndex:(NSUInteger)location effectiveRange:(NSRangePointer)range {
+    return [_storage attributesAtIndex:location effectiveRange:range];
+}
+
+- (void)replaceCharactersInRange:(NSRange)range withString:(NSString *)string {
+    [_storage replaceCharactersInRange:range withString:string];
+    [self edited:NSTextStorageEditedCharacters range:range changeInLength:(NSInteger)string.length - (NSInteger)range.length];
+}
+
+- (void)setAttributes:(NSDictionary *)attributes range:(NSRange)range {
+    [_storage setAttributes:attributes range:range];
+    [self edited:NSTextStorageEditedAttributes range:range changeInLength:0];
+}
+
+- (void)beginEditing {
+    _editingCount++;
+}
+
+- (void)endEditing {
+    if (_editingCount > 0 && --_editingCount == 0 && _editedMask != 0) {
+        [self processEditing];
+    }
+}
+
+// Like NSTextStorage, edits made inside one beginEditing/endEditing block are reported together
+- (void)edited:(NSUInteger)editedMask range:(NSRange)range changeInLength:(NSInteger)delta {
+    NSUInteger end = NSMaxRange(range) + delta;
+    if (_editedMask == 0) {
+        _editedRange = NSMakeRange(range.location, end - range.location);
+        _changeInLength = delta;
+    }
+    else {
+        // The text already edited moves with this edit if it is after it
+        NSUInteger editedEnd = NSMaxRange(_editedRange);
+        editedEnd = editedEnd >= NSMaxRange(range) ? editedEnd + delta : MAX(editedEnd, end);
+        NSUInteger location = MIN(_editedRange.location, range.location);
+        _editedRange = NSMakeRange(location, editedEnd - location);
+        _changeInLength += delta;
+    }
+    _editedMask |= editedMask;
+    if (_editingCount == 0) {
+        [self processEditing];
+    }
+}
+
+- (void)processEditing {
+    [[NSNotificationCenter defaultCenter] postNotificationName:RichTextEditorTextStorageDidProcessEditingNotification object:self];
+    _editedMask = 0;
+    _editedRange = NSMakeRange(NSNotFound, 0);
+    _changeInLength = 0;
+}
+
+@end
+
+@implementation RichTextEditorFont {
+    BOOL _isBold;
+    BOOL _isItalic;
+}
+
++ (RichTextEditorFont *)fontWithName:(NSString *)fontName size:(CGFloat)fontSize {
+    if (fontName.length == 0) {
+        return nil;
+    }
+    NSString *familyName = fontName;
+    BOOL isBold = NO;
+    BOOL isItalic = NO;
+    NSRange dash = [fontName rangeOfString:@"-" options:NSBackwardsSearch];
+    if (dash.location != NSNotFound && dash.location > 0) {
+        NSString *style = [fontName substringFromIndex:NSMaxRange(dash)];
+        static NSSet *styleNames;
+        static dispatch_once_t onceToken;
+        dispatch_once(&onceToken, ^{
+            styleNames = [NSSet setWithObjects:@"Regular", @"Roman", @"Bold", @"Italic", @"Oblique", @"BoldItalic", @"BoldOblique", nil];
+        });
+        if ([styleNames containsObject:style]) {
+            familyName = [fontName substringToIndex:dash.location];
+            isBold = [style hasPrefix:@"Bold"];
+            isItalic = [style hasSuffix:@"Italic"] || [style hasSuffix:@"Oblique"];
+        }
+    }
+    return [[RichTextEditorFont alloc] initWithFamilyName:familyName size:fontSize bold:isBold italic:isItalic];
+}
+
++ (RichTextEditorFont *)fontWithName:(NSString *)name size:(CGFloat)size boldTrait:(BOOL)isBold italicTrait:(BOOL)isItalic {
+    return [[self fontWithName:name size:size] fontWithBoldTrait:isBold italicTrait:isItalic andSize:size];
+}
+
++ (RichTextEditorFont *)fontWithDescriptor:(NSDictionary<NSString *, id> *)fontDescriptor size:(CGFloat)fontSize {
+    return [self fontWithName:(fontDescriptor[NSFontNameAttribute] ?: fontDescriptor[NSFontFamilyAttribute]) size:fontSize];
+}
+
+- (instancetype)initWithFamilyName:(NSString *)familyName size:(CGFloat)size bold:(BOOL)isBold italic:(BOOL)isItalic {
+    if (self = [super init]) {
+        _familyName = [familyName copy];
+        _pointSize = size;
+        _isBold = isBold;
+        _isItalic = isItalic;
+        if (isBold || isItalic) {
+            _fontName = [NSString stringWithFormat:@"%@-%@%@", familyName, (isBold ? @"Bold" : @""), (isItalic ? @"Italic" : @"")];
+        }
+        else {
+            _fontName = _familyName;
+        }
+    }
+    return self;
+}
+
+- (NSDictionary<NSString *, id> *)fontDescriptor {
+    return @{NSFontNameAttribute: self.fontName, NSFontFamilyAttribute: self.familyName};
+}
+
+- (BOOL)isBold {
+    return _isBold;
+}
+
+- (BOOL)isItalic {
+    return _isItalic;
+}
+
+- (RichTextEditorFont *)fontWithBoldTrait:(BOOL)bold italicTrait:(BOOL)italic andSize:(CGFloat)size {
+    if (bold == _isBold && italic == _isItalic && size == _pointSize) {
+        return self;
+    }
+    return [[RichTextEditorFont alloc] initWithFamilyName:self.familyName size:size bold:bold italic:italic];
+}
+
+- (RichTextEditorFont *)fontWithBoldTrait:(BOOL)bold andItalicTrait:(BOOL)italic {
+    return [self fontWithBoldTrait:bold italicTrait:italic andSize:self.pointSize];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // immutable
+}
+
+- (NSUInteger)hash {
+    return self.fontName.hash ^ (NSUInteger)lround(_pointSize * 16);
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[RichTextEditorFont class]]) {
+        return NO;
+    }
+    RichTextEditorFont *other = object;
+    return _pointSize == other.pointSize && [self.fontName isEqualToString:other.fontName];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %@ %gpt>", NSStringFromClass([self class]), self.fontName, _pointSize];
+}
+
+@end
+
+@implementation RichTextEditorColor
+
++ (RichTextEditorColor *)colorWithCalibratedRed:(CGFloat)red green:(CGFloat)green blue:(CGFloat)blue alpha:(CGFloat)alpha {
+    return [[RichTextEditorColor alloc] initWithRed:red green:green blue:blue alpha:alpha];
+}
+
+- (instancetype)initWithRed:(CGFloat)red green:(CGFloat)green blue:(CGFloat)blue alpha:(CGFloat)alpha {
+    if (self = [super init]) {
+        _redComponent = MIN(MAX(red, 0), 1);
+        _greenComponent = MIN(MAX(green, 0), 1);
+        _blueComponent = MIN(MAX(blue, 0), 1);
+        _alphaComponent = MIN(MAX(alpha, 0), 1);
+    }
+    return self;
+}
+
+- (void)getRed:(CGFloat *)red green:(CGFloat *)green blue:(CGFloat *)blue alpha:(CGFloat *)alpha {
+    if (red) {
+        *red = _redComponent;
+    }
+    if (green) {
+        *green = _greenComponent;
+    }
+    if (blue) {
+        *blue = _blueComponent;
+    }
+    if (alpha) {
+        *alpha = _alphaComponent;
+    }
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self; // immutable
+}
+
+- (NSUInteger)hash {
+    return (NSUInteger)lround(_redComponent * 255) ^ ((NSUInteger)lround(_greenComponent * 255) << 8) ^
+        ((NSUInteger)lround(_blueComponent * 255) << 16) ^ ((NSUInteger)lround(_alphaComponent * 255) << 24);
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[RichTextEditorColor class]]) {
+        return NO;
+    }
+    RichTextEditorColor *other = object;
+    return _redComponent == other.redComponent && _greenComponent == other.greenComponent &&
+        _blueComponent == other.blueComponent && _alphaComponent == other.alphaComponent;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: red %g, green %g, blue %g, alpha %g>", NSStringFromClass([self class]),
+            _redComponent, _greenComponent, _blueComponent, _alphaComponent];
+}
+
+@end
+
+#endif
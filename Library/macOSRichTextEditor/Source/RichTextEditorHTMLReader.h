@@ -0,0 +1,49 @@
+//
+//  RichTextEditorHTMLReader.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFoundationText.h"
+
+/// Builds an NSAttributedString from HTML without going through NSHTMLTextDocumentType
+/// (and therefore WebKit), so it is fast and can be used from any thread.
+///
+/// Only the subset of HTML that the editor writes and commonly receives is understood:
+/// p/div with align and margin-left/text-indent, font face/size/color, span, b/strong,
+/// i/em, u, strike/s/del, br, ul/li (as bullet paragraphs), and simple class rules in a
+/// <style> block (as written by Cocoa). As soon as anything else shows up the reader gives up
+/// and returns nil, so that callers can fall back to the Cocoa importer.
+///
+/// Input is read incrementally with appendData:, so large files don't have to be loaded
+/// into memory first. A reader instance must only be used from one thread at a time.
+@interface RichTextEditorHTMLReader : NSObject
+
+/// Font family and size used for text without a font. Defaults to Times 12, like Cocoa.
+@property (nonatomic, copy) NSString *defaultFontFamily;
+@property (nonatomic) CGFloat defaultFontSize;
+
+/// Prefix added to each <li> paragraph. Defaults to the editor's bullet string.
+@property (nonatomic, copy) NSString *bulletString;
+
+/// First line head indent of a <li> paragraph per level of list nesting. Defaults to 15.
+@property (nonatomic) CGFloat bulletIndentation;
+
+/// Description of the first markup the reader couldn't handle, or nil.
+@property (nonatomic, readonly) NSString *unsupportedMarkup;
+
+/// Feeds the next chunk of UTF-8 encoded HTML to the reader.
+- (void)appendData:(NSData *)data;
+
+/// Finishes reading and returns the document, or nil if unsupported markup was found.
+- (NSAttributedString *)finish;
+
+/// Reads the whole stream and returns the document, or nil if unsupported markup was found
+/// or the stream couldn't be read.
+- (NSAttributedString *)attributedStringFromStream:(NSInputStream *)stream;
+
+/// Convenience for reading an HTML string with a new reader.
++ (NSAttributedString *)attributedStringFromHTMLString:(NSString *)htmlString;
+
+@end
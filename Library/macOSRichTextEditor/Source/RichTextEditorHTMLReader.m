@@ -0,0 +1,995 @@
+//
+//  RichTextEditorHTMLReader.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorHTMLReader.h"
+#if !RTE_FOUNDATION_ONLY
+#import <CoreText/CoreText.h>
+#endif
+
+#define RTE_HTML_READ_CHUNK_SIZE (64 * 1024)
+
+typedef NS_ENUM(NSInteger, RichTextEditorHTMLReaderState) {
+    RichTextEditorHTMLReaderStateText,
+    RichTextEditorHTMLReaderStateTag,
+    RichTextEditorHTMLReaderStateComment,
+    RichTextEditorHTMLReaderStateRawText // contents of <style>, <script> and <title>
+};
+
+#pragma mark - Style -
+
+// Text and paragraph formatting in effect for an open element
+@interface RichTextEditorHTMLStyle : NSObject <NSCopying>
+
+@property NSString *tagName;
+@property NSString *fontFamily;
+@property CGFloat fontSize;
+@property BOOL isBold;
+@property BOOL isItalic;
+@property BOOL hasUnderline;
+@property BOOL hasStrikeThrough;
+@property NSColor *color;
+@property NSColor *backgroundColor;
+@property BOOL preservesWhitespace;
+@property NSTextAlignment alignment;
+@property BOOL hasAlignment;
+@property CGFloat marginLeft;
+@property CGFloat textIndent;
+@property NSDictionary *attributes; // cached text attributes, built by the reader
+
+@end
+
+@implementation RichTextEditorHTMLStyle
+
+- (id)copyWithZone:(NSZone *)zone {
+    RichTextEditorHTMLStyle *style = [[RichTextEditorHTMLStyle alloc] init];
+    style.tagName = self.tagName;
+    style.fontFamily = self.fontFamily;
+    style.fontSize = self.fontSize;
+    style.isBold = self.isBold;
+    style.isItalic = self.isItalic;
+    style.hasUnderline = self.hasUnderline;
+    style.hasStrikeThrough = self.hasStrikeThrough;
+    style.color = self.color;
+    style.backgroundColor = self.backgroundColor;
+    style.preservesWhitespace = self.preservesWhitespace;
+    style.alignment = self.alignment;
+    style.hasAlignment = self.hasAlignment;
+    style.marginLeft = self.marginLeft;
+    style.textIndent = self.textIndent;
+    return style;
+}
+
+@end
+
+#pragma mark - Reader -
+
+@interface RichTextEditorHTMLReader () {
+    RichTextEditorHTMLReaderState _state;
+    char _quote;
+    BOOL _lastCharacterWasSpace;
+    BOOL _paragraphOpen;
+    BOOL _paragraphEndsWithBreak;
+    NSUInteger _paragraphStart;
+    NSInteger _listLevel;
+}
+
+@property NSMutableData *pendingText;
+@property NSMutableData *pendingTag;
+@property NSString *rawTextTagName;
+@property NSMutableAttributedString *output;
+@property NSMutableArray *styleStack;
+@property NSMutableDictionary *styleSheet; // selector -> declarations
+@property NSMutableDictionary *fonts;
+@property NSParagraphStyle *paragraphStyle;
+@property (nonatomic, readwrite) NSString *unsupportedMarkup;
+
+@end
+
+@implementation RichTextEditorHTMLReader
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _defaultFontFamily = @"Times";
+        _defaultFontSize = 12;
+        _bulletString = @"•\u00A0";
+        _bulletIndentation = 15;
+        _pendingText = [NSMutableData data];
+        _pendingTag = [NSMutableData data];
+        _output = [[NSMutableAttributedString alloc] init];
+        _styleStack = [NSMutableArray array];
+        _styleSheet = [NSMutableDictionary dictionary];
+        _fonts = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
++ (NSAttributedString *)attributedStringFromHTMLString:(NSString *)htmlString {
+    RichTextEditorHTMLReader *reader = [[RichTextEditorHTMLReader alloc] init];
+    [reader appendData:[htmlString dataUsingEncoding:NSUTF8StringEncoding]];
+    return [reader finish];
+}
+
+- (NSAttributedString *)attributedStringFromStream:(NSInputStream *)stream {
+    BOOL shouldOpenStream = (stream.streamStatus == NSStreamStatusNotOpen);
+    if (shouldOpenStream) {
+        [stream open];
+    }
+    uint8_t *buffer = malloc(RTE_HTML_READ_CHUNK_SIZE);
+    BOOL failed = NO;
+    while (!self.unsupportedMarkup) {
+        NSInteger length = [stream read:buffer maxLength:RTE_HTML_READ_CHUNK_SIZE];
+        if (length < 0) {
+            failed = YES;
+            break;
+        }
+        if (length == 0) {
+            break;
+        }
+        @autoreleasepool {
+            [self appendData:[NSData dataWithBytesNoCopy:buffer length:(NSUInteger)length freeWhenDone:NO]];
+        }
+    }
+    free(buffer);
+    if (shouldOpenStream) {
+        [stream close];
+    }
+    NSAttributedString *attributedString = [self finish];
+    return failed ? nil : attributedString;
+}
+
+#pragma mark - Tokenizing -
+
+- (void)appendData:(NSData *)data {
+    const char *bytes = data.bytes;
+    NSUInteger length = data.length;
+    NSUInteger i = 0;
+    while (i < length && !self.unsupportedMarkup) {
+        switch (_state) {
+            case RichTextEditorHTMLReaderStateText: {
+                const char *tagStart = memchr(bytes + i, '<', length - i);
+                NSUInteger end = tagStart ? (NSUInteger)(tagStart - bytes) : length;
+                [self.pendingText appendBytes:bytes + i length:end - i];
+                i = end;
+                if (tagStart) {
+                    [self flushText];
+                    [self.pendingTag setLength:0];
+                    _quote = 0;
+                    _state = RichTextEditorHTMLReaderStateTag;
+                    i++;
+                }
+                break;
+            }
+            case RichTextEditorHTMLReaderStateTag: {
+                // Look at the first few bytes on their own so that comments are recognised
+                // even if "<!--" is split across two chunks
+                while (i < length && self.pendingTag.length < 3 && bytes[i] != '>') {
+                    [self.pendingTag appendBytes:bytes + i length:1];
+                    i++;
+                }
+                if (self.pendingTag.length == 3 && memcmp(self.pendingTag.bytes, "!--", 3) == 0) {
+                    _state = RichTextEditorHTMLReaderStateComment;
+                    break;
+                }
+                NSUInteger start = i;
+                BOOL tagEnded = NO;
+                for (; i < length; i++) {
+                    char c = bytes[i];
+                    if (_quote) {
+                        if (c == _quote) {
+                            _quote = 0;
+                        }
+                    }
+                    else if (c == '"' || c == '\'') {
+                        _quote = c;
+                    }
+                    else if (c == '>') {
+                        tagEnded = YES;
+                        break;
+                    }
+                }
+                [self.pendingTag appendBytes:bytes + start length:i - start];
+                if (tagEnded) {
+                    i++;
+                    _state = RichTextEditorHTMLReaderStateText;
+                    [self handleTag:self.pendingTag];
+                }
+                break;
+            }
+            case RichTextEditorHTMLReaderStateComment: {
+                // pendingTag holds the comment so far; we only need to find "-->"
+                const char *end = memchr(bytes + i, '>', length - i);
+                NSUInteger stop = end ? (NSUInteger)(end - bytes) : length;
+                [self.pendingTag appendBytes:bytes + i length:stop - i];
+                i = stop;
+                if (end) {
+                    i++;
+                    const char *comment = self.pendingTag.bytes;
+                    NSUInteger commentLength = self.pendingTag.length;
+                    if (commentLength >= 5 && comment[commentLength - 1] == '-' && comment[commentLength - 2] == '-') {
+                        [self.pendingTag setLength:0];
+                        _state = RichTextEditorHTMLReaderStateText;
+                    }
+                    else {
+                        [self.pendingTag appendBytes:">" length:1];
+                    }
+                }
+                break;
+            }
+            case RichTextEditorHTMLReaderStateRawText: {
+                const char *end = memchr(bytes + i, '>', length - i);
+                NSUInteger stop = end ? (NSUInteger)(end - bytes) : length;
+                [self.pendingText appendBytes:bytes + i length:stop - i];
+                i = stop;
+                if (end) {
+                    i++;
+                    [self checkForEndOfRawText];
+                }
+                break;
+            }
+        }
+    }
+}
+
+// Raw text ends at "</name>". Called when a '>' has been seen.
+- (void)checkForEndOfRawText {
+    NSMutableData *text = self.pendingText;
+    NSString *closingTag = [@"</" stringByAppendingString:self.rawTextTagName];
+    NSUInteger closingLength = closingTag.length;
+    const char *bytes = text.bytes;
+    NSUInteger length = text.length;
+    NSUInteger end = length;
+    while (end > 0 && isspace((unsigned char)bytes[end - 1])) {
+        end--;
+    }
+    if (end >= closingLength &&
+        strncasecmp(bytes + end - closingLength, closingTag.UTF8String, closingLength) == 0) {
+        NSString *content = [[NSString alloc] initWithBytes:bytes length:end - closingLength encoding:NSUTF8StringEncoding];
+        if ([self.rawTextTagName isEqualToString:@"style"] && content) {
+            [self parseStyleSheet:content];
+        }
+        [text setLength:0];
+        [self endElement:self.rawTextTagName];
+        self.rawTextTagName = nil;
+        _state = RichTextEditorHTMLReaderStateText;
+    }
+    else {
+        [text appendBytes:">" length:1];
+    }
+}
+
+- (NSAttributedString *)finish {
+    if (_state == RichTextEditorHTMLReaderStateText) {
+        [self flushText];
+    }
+    [self closeParagraph];
+    if (self.unsupportedMarkup) {
+        return nil;
+    }
+    return [self.output copy];
+}
+
+- (void)markUnsupported:(NSString *)markup {
+    if (!self.unsupportedMarkup) {
+        self.unsupportedMarkup = markup;
+    }
+}
+
+#pragma mark - Tags -
+
+- (void)handleTag:(NSData *)tagData {
+    NSString *tag = [[NSString alloc] initWithData:tagData encoding:NSUTF8StringEncoding];
+    if (!tag) {
+        [self markUnsupported:@"Tag isn't valid UTF-8"];
+        return;
+    }
+    if ([tag hasPrefix:@"!"] || [tag hasPrefix:@"?"]) {
+        return; // <!DOCTYPE ...>, <?xml ...?>
+    }
+    NSScanner *scanner = [NSScanner scannerWithString:tag];
+    scanner.charactersToBeSkipped = nil;
+    scanner.caseSensitive = NO;
+    BOOL isEndTag = [scanner scanString:@"/" intoString:nil];
+    NSString *name = nil;
+    NSCharacterSet *nameEnd = [NSCharacterSet characterSetWithCharactersInString:@" \t\r\n/="];
+    [scanner scanUpToCharactersFromSet:nameEnd intoString:&name];
+    name = [name lowercaseString];
+    if (name.length == 0) {
+        [self markUnsupported:[NSString stringWithFormat:@"<%@>", tag]];
+        return;
+    }
+    if (isEndTag) {
+        [self endElement:name];
+        return;
+    }
+    NSMutableDictionary *attributes = [NSMutableDictionary dictionary];
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    while (!scanner.isAtEnd) {
+        [scanner scanCharactersFromSet:whitespace intoString:nil];
+        if ([scanner scanString:@"/" intoString:nil]) {
+            continue;
+        }
+        NSString *attributeName = nil;
+        if (![scanner scanUpToCharactersFromSet:nameEnd intoString:&attributeName]) {
+            break;
+        }
+        NSString *value = @"";
+        [scanner scanCharactersFromSet:whitespace intoString:nil];
+        if ([scanner scanString:@"=" intoString:nil]) {
+            [scanner scanCharactersFromSet:whitespace intoString:nil];
+            if ([scanner scanString:@"\"" intoString:nil]) {
+                [scanner scanUpToString:@"\"" intoString:&value];
+                [scanner scanString:@"\"" intoString:nil];
+            }
+            else if ([scanner scanString:@"'" intoString:nil]) {
+                [scanner scanUpToString:@"'" intoString:&value];
+                [scanner scanString:@"'" intoString:nil];
+            }
+            else {
+                [scanner scanUpToCharactersFromSet:whitespace intoString:&value];
+            }
+        }
+        attributes[[attributeName lowercaseString]] = [self stringByDecodingEntities:value ? value : @""];
+    }
+    [self startElement:name attributes:attributes];
+}
+
++ (NSSet *)ignoredElements {
+    static NSSet *elements;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        elements = [NSSet setWithObjects:@"meta", @"link", @"base", nil];
+    });
+    return elements;
+}
+
++ (NSSet *)inlineElements {
+    static NSSet *elements;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        elements = [NSSet setWithObjects:@"html", @"head", @"body", @"span", @"font", @"b", @"strong", @"i", @"em",
+                    @"u", @"ins", @"strike", @"s", @"del", nil];
+    });
+    return elements;
+}
+
++ (NSSet *)blockElements {
+    static NSSet *elements;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        elements = [NSSet setWithObjects:@"p", @"div", @"li", @"ul", nil];
+    });
+    return elements;
+}
+
+- (void)startElement:(NSString *)name attributes:(NSDictionary *)attributes {
+    if ([[RichTextEditorHTMLReader ignoredElements] containsObject:name]) {
+        return;
+    }
+    if ([name isEqualToString:@"br"]) {
+        [self appendLineBreak];
+        return;
+    }
+    BOOL isRawText = [name isEqualToString:@"style"] || [name isEqualToString:@"script"] || [name isEqualToString:@"title"];
+    BOOL isBlock = [[RichTextEditorHTMLReader blockElements] containsObject:name];
+    if (!isRawText && !isBlock && ![[RichTextEditorHTMLReader inlineElements] containsObject:name]) {
+        [self markUnsupported:[NSString stringWithFormat:@"<%@>", name]];
+        return;
+    }
+
+    RichTextEditorHTMLStyle *style = [[self currentStyle] copy];
+    style.tagName = name;
+    if (isBlock) {
+        // Margins belong to the block they are set on
+        style.marginLeft = 0;
+        style.textIndent = 0;
+    }
+    [self applyElement:name attributes:attributes toStyle:style];
+    [self.styleStack addObject:style];
+
+    if (isRawText) {
+        self.rawTextTagName = name;
+        [self.pendingText setLength:0];
+        _state = RichTextEditorHTMLReaderStateRawText;
+    }
+    else if ([name isEqualToString:@"ul"]) {
+        [self closeParagraph];
+        _listLevel++;
+    }
+    else if (isBlock) {
+        [self openParagraphWithStyle:style];
+        if ([name isEqualToString:@"li"]) {
+            [self appendBullet];
+        }
+    }
+}
+
+- (void)endElement:(NSString *)name {
+    NSUInteger index = self.styleStack.count;
+    while (index > 0 && ![[self.styleStack[index - 1] tagName] isEqualToString:name]) {
+        index--;
+    }
+    if (index == 0) {
+        return; // stray end tag
+    }
+    if ([[RichTextEditorHTMLReader blockElements] containsObject:name]) {
+        [self closeParagraph];
+        if ([name isEqualToString:@"ul"]) {
+            _listLevel = MAX(_listLevel - 1, 0);
+        }
+    }
+    // Also closes any elements that were left open inside this one
+    [self.styleStack removeObjectsInRange:NSMakeRange(index - 1, self.styleStack.count - index + 1)];
+}
+
+- (RichTextEditorHTMLStyle *)currentStyle {
+    RichTextEditorHTMLStyle *style = self.styleStack.lastObject;
+    if (!style) {
+        style = [[RichTextEditorHTMLStyle alloc] init];
+        style.fontFamily = self.defaultFontFamily;
+        style.fontSize = self.defaultFontSize;
+        style.alignment = NSNaturalTextAlignment;
+        [self.styleStack addObject:style];
+    }
+    return style;
+}
+
+- (void)applyElement:(NSString *)name attributes:(NSDictionary *)attributes toStyle:(RichTextEditorHTMLStyle *)style {
+    if ([name isEqualToString:@"b"] || [name isEqualToString:@"strong"]) {
+        style.isBold = YES;
+    }
+    else if ([name isEqualToString:@"i"] || [name isEqualToString:@"em"]) {
+        style.isItalic = YES;
+    }
+    else if ([name isEqualToString:@"u"] || [name isEqualToString:@"ins"]) {
+        style.hasUnderline = YES;
+    }
+    else if ([name isEqualToString:@"strike"] || [name isEqualToString:@"s"] || [name isEqualToString:@"del"]) {
+        style.hasStrikeThrough = YES;
+    }
+    else if ([name isEqualToString:@"font"]) {
+        NSString *face = attributes[@"face"];
+        if (face.length > 0) {
+            style.fontFamily = face;
+        }
+        NSString *size = attributes[@"size"];
+        if (size.length > 0) {
+            // <font size="1"> to <font size="7">
+            static const CGFloat sizes[] = { 10, 13, 16, 18, 24, 32, 48 };
+            NSInteger sizeIndex = size.integerValue;
+            if ([size hasPrefix:@"+"] || [size hasPrefix:@"-"]) {
+                sizeIndex += 3;
+            }
+            style.fontSize = sizes[MIN(MAX(sizeIndex, 1), 7) - 1];
+        }
+        NSColor *color = [self colorFromString:attributes[@"color"]];
+        if (color) {
+            style.color = color;
+        }
+    }
+    NSString *align = attributes[@"align"];
+    if (align) {
+        [self applyDeclaration:@"text-align" value:align toStyle:style];
+    }
+    // Style sheet rules, then inline style
+    NSString *classes = attributes[@"class"];
+    if (classes.length > 0 && self.styleSheet.count > 0) {
+        NSString *declarations = self.styleSheet[name];
+        if (declarations) {
+            [self applyDeclarations:declarations toStyle:style];
+        }
+        for (NSString *className in [classes componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceCharacterSet]]) {
+            if (className.length == 0) {
+                continue;
+            }
+            for (NSString *selector in @[[@"." stringByAppendingString:className],
+                                         [NSString stringWithFormat:@"%@.%@", name, className]]) {
+                declarations = self.styleSheet[selector];
+                if (declarations) {
+                    [self applyDeclarations:declarations toStyle:style];
+                }
+            }
+        }
+    }
+    else if (self.styleSheet[name]) {
+        [self applyDeclarations:self.styleSheet[name] toStyle:style];
+    }
+    NSString *inlineStyle = attributes[@"style"];
+    if (inlineStyle.length > 0) {
+        [self applyDeclarations:inlineStyle toStyle:style];
+    }
+}
+
+#pragma mark - CSS -
+
+- (void)parseStyleSheet:(NSString *)css {
+    // Strip comments
+    NSMutableString *styleSheet = [css mutableCopy];
+    NSRange commentStart;
+    while ((commentStart = [styleSheet rangeOfString:@"/*"]).location != NSNotFound) {
+        NSRange commentEnd = [styleSheet rangeOfString:@"*/" options:0 range:NSMakeRange(NSMaxRange(commentStart), styleSheet.length - NSMaxRange(commentStart))];
+        NSUInteger end = commentEnd.location == NSNotFound ? styleSheet.length : NSMaxRange(commentEnd);
+        [styleSheet deleteCharactersInRange:NSMakeRange(commentStart.location, end - commentStart.location)];
+    }
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    for (NSString *rule in [styleSheet componentsSeparatedByString:@"}"]) {
+        NSRange open = [rule rangeOfString:@"{"];
+        if (open.location == NSNotFound) {
+            continue;
+        }
+        NSString *declarations = [rule substringFromIndex:NSMaxRange(open)];
+        for (NSString *selector in [[rule substringToIndex:open.location] componentsSeparatedByString:@","]) {
+            NSString *key = [[selector stringByTrimmingCharactersInSet:whitespace] lowercaseString];
+            if (key.length == 0) {
+                continue;
+            }
+            NSString *existing = self.styleSheet[key];
+            self.styleSheet[key] = existing ? [NSString stringWithFormat:@"%@;%@", existing, declarations] : declarations;
+        }
+    }
+}
+
+- (void)applyDeclarations:(NSString *)declarations toStyle:(RichTextEditorHTMLStyle *)style {
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    for (NSString *declaration in [declarations componentsSeparatedByString:@";"]) {
+        NSRange colon = [declaration rangeOfString:@":"];
+        if (colon.location == NSNotFound) {
+            continue;
+        }
+        NSString *property = [[[declaration substringToIndex:colon.location] stringByTrimmingCharactersInSet:whitespace] lowercaseString];
+        NSString *value = [[declaration substringFromIndex:NSMaxRange(colon)] stringByTrimmingCharactersInSet:whitespace];
+        [self applyDeclaration:property value:value toStyle:style];
+    }
+}
+
+// Anything that doesn't change how the text looks in the editor (line height, top/bottom margins, ...) is ignored
+- (void)applyDeclaration:(NSString *)property value:(NSString *)value toStyle:(RichTextEditorHTMLStyle *)style {
+    NSString *lowercaseValue = [value lowercaseString];
+    if ([property isEqualToString:@"font"]) {
+        [self applyFontShorthand:value toStyle:style];
+    }
+    else if ([property isEqualToString:@"font-family"]) {
+        style.fontFamily = value;
+    }
+    else if ([property isEqualToString:@"font-size"]) {
+        CGFloat size = [self lengthFromString:value relativeTo:style.fontSize];
+        if (size > 0) {
+            style.fontSize = size;
+        }
+    }
+    else if ([property isEqualToString:@"font-weight"]) {
+        style.isBold = [lowercaseValue hasPrefix:@"bold"] || lowercaseValue.integerValue >= 600;
+    }
+    else if ([property isEqualToString:@"font-style"]) {
+        style.isItalic = [lowercaseValue isEqualToString:@"italic"] || [lowercaseValue isEqualToString:@"oblique"];
+    }
+    else if ([property isEqualToString:@"color"]) {
+        style.color = [self colorFromString:value];
+    }
+    else if ([property isEqualToString:@"background-color"] || [property isEqualToString:@"background"]) {
+        style.backgroundColor = [self colorFromString:value];
+    }
+    else if ([property isEqualToString:@"text-decoration"] || [property isEqualToString:@"text-decoration-line"]) {
+        style.hasUnderline = [lowercaseValue containsString:@"underline"];
+        style.hasStrikeThrough = [lowercaseValue containsString:@"line-through"];
+    }
+    else if ([property isEqualToString:@"text-align"]) {
+        style.hasAlignment = YES;
+        if ([lowercaseValue isEqualToString:@"left"]) {
+            style.alignment = NSLeftTextAlignment;
+        }
+        else if ([lowercaseValue isEqualToString:@"center"]) {
+            style.alignment = NSCenterTextAlignment;
+        }
+        else if ([lowercaseValue isEqualToString:@"right"]) {
+            style.alignment = NSRightTextAlignment;
+        }
+        else if ([lowercaseValue isEqualToString:@"justify"]) {
+            style.alignment = NSJustifiedTextAlignment;
+        }
+        else {
+            style.hasAlignment = NO;
+            style.alignment = NSNaturalTextAlignment;
+        }
+    }
+    else if ([property isEqualToString:@"margin-left"]) {
+        style.marginLeft = [self lengthFromString:value relativeTo:style.fontSize];
+    }
+    else if ([property isEqualToString:@"margin"]) {
+        // margin: all | vertical horizontal | top horizontal bottom | top right bottom left
+        NSArray *values = [self componentsOfValue:value];
+        if (values.count > 0) {
+            NSString *left = values.count == 4 ? values[3] : (values.count >= 2 ? values[1] : values[0]);
+            style.marginLeft = [self lengthFromString:left relativeTo:style.fontSize];
+        }
+    }
+    else if ([property isEqualToString:@"text-indent"]) {
+        style.textIndent = [self lengthFromString:value relativeTo:style.fontSize];
+    }
+    else if ([property isEqualToString:@"white-space"]) {
+        style.preservesWhitespace = [lowercaseValue hasPrefix:@"pre"];
+    }
+}
+
+- (NSArray *)componentsOfValue:(NSString *)value {
+    NSMutableArray *components = [NSMutableArray array];
+    for (NSString *component in [value componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]]) {
+        if (component.length > 0) {
+            [components addObject:component];
+        }
+    }
+    return components;
+}
+
+// font: [style] [weight] size[/line-height] family[, family...]
+- (void)applyFontShorthand:(NSString *)value toStyle:(RichTextEditorHTMLStyle *)style {
+    NSArray *components = [self componentsOfValue:value];
+    NSUInteger index = 0;
+    for (; index < components.count; index++) {
+        NSString *component = [components[index] lowercaseString];
+        if ([component isEqualToString:@"bold"] || [component isEqualToString:@"bolder"] || component.integerValue >= 600) {
+            style.isBold = YES;
+        }
+        else if ([component isEqualToString:@"italic"] || [component isEqualToString:@"oblique"]) {
+            style.isItalic = YES;
+        }
+        else if ([component isEqualToString:@"normal"]) {
+            continue;
+        }
+        else if (component.length > 0 && (([component characterAtIndex:0] >= '0' && [component characterAtIndex:0] <= '9') || [component characterAtIndex:0] == '.')) {
+            NSString *size = [component componentsSeparatedByString:@"/"][0];
+            CGFloat fontSize = [self lengthFromString:size relativeTo:style.fontSize];
+            if (fontSize > 0) {
+                style.fontSize = fontSize;
+            }
+            index++;
+            break;
+        }
+        else {
+            break;
+        }
+    }
+    if (index < components.count) {
+        style.fontFamily = [[components subarrayWithRange:NSMakeRange(index, components.count - index)] componentsJoinedByString:@" "];
+    }
+}
+
+- (CGFloat)lengthFromString:(NSString *)value relativeTo:(CGFloat)fontSize {
+    NSString *lowercaseValue = [[value stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] lowercaseString];
+    CGFloat length = (CGFloat)lowercaseValue.doubleValue;
+    if ([lowercaseValue hasSuffix:@"em"]) {
+        return length * fontSize;
+    }
+    if ([lowercaseValue hasSuffix:@"%"]) {
+        return length * fontSize / 100;
+    }
+    return length; // px and pt are the same thing as far as the text system is concerned
+}
+
+- (NSColor *)colorFromString:(NSString *)value {
+    NSString *color = [[value stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] lowercaseString];
+    if (color.length == 0) {
+        return nil;
+    }
+    if ([color hasPrefix:@"#"]) {
+        unsigned int hex = 0;
+        NSString *digits = [color substringFromIndex:1];
+        if (![[NSScanner scannerWithString:digits] scanHexInt:&hex]) {
+            return nil;
+        }
+        if (digits.length == 3) {
+            return [NSColor colorWithCalibratedRed:((hex >> 8) & 0xF) / 15.0 green:((hex >> 4) & 0xF) / 15.0 blue:(hex & 0xF) / 15.0 alpha:1];
+        }
+        if (digits.length == 6) {
+            return [NSColor colorWithCalibratedRed:((hex >> 16) & 0xFF) / 255.0 green:((hex >> 8) & 0xFF) / 255.0 blue:(hex & 0xFF) / 255.0 alpha:1];
+        }
+        return nil;
+    }
+    if ([color hasPrefix:@"rgb"]) {
+        NSRange open = [color rangeOfString:@"("];
+        NSRange close = [color rangeOfString:@")"];
+        if (open.location == NSNotFound || close.location == NSNotFound || close.location < open.location) {
+            return nil;
+        }
+        NSArray *components = [[color substringWithRange:NSMakeRange(NSMaxRange(open), close.location - NSMaxRange(open))] componentsSeparatedByString:@","];
+        if (components.count < 3) {
+            return nil;
+        }
+        CGFloat alpha = components.count > 3 ? (CGFloat)[components[3] doubleValue] : 1;
+        return [NSColor colorWithCalibratedRed:[components[0] doubleValue] / 255.0 green:[components[1] doubleValue] / 255.0
+                                          blue:[components[2] doubleValue] / 255.0 alpha:alpha];
+    }
+    static NSDictionary *namedColors;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        namedColors = @{@"black": @0x000000, @"white": @0xFFFFFF, @"red": @0xFF0000, @"green": @0x008000,
+                        @"blue": @0x0000FF, @"yellow": @0xFFFF00, @"gray": @0x808080, @"grey": @0x808080,
+                        @"silver": @0xC0C0C0, @"maroon": @0x800000, @"purple": @0x800080, @"fuchsia": @0xFF00FF,
+                        @"lime": @0x00FF00, @"olive": @0x808000, @"navy": @0x000080, @"teal": @0x008080,
+                        @"aqua": @0x00FFFF, @"orange": @0xFFA500};
+    });
+    NSNumber *named = namedColors[color];
+    if (named) {
+        NSUInteger hex = named.unsignedIntegerValue;
+        return [NSColor colorWithCalibratedRed:((hex >> 16) & 0xFF) / 255.0 green:((hex >> 8) & 0xFF) / 255.0 blue:(hex & 0xFF) / 255.0 alpha:1];
+    }
+    return nil;
+}
+
+#pragma mark - Text -
+
+- (void)flushText {
+    NSMutableData *data = self.pendingText;
+    if (data.length == 0) {
+        return;
+    }
+    NSString *text = [[NSString alloc] initWithBytes:data.bytes length:data.length encoding:NSUTF8StringEncoding];
+    if (!text) {
+        text = [[NSString alloc] initWithBytes:data.bytes length:data.length encoding:NSWindowsCP1252StringEncoding];
+    }
+    [data setLength:0];
+    RichTextEditorHTMLStyle *style = [self currentStyle];
+    if (!style.preservesWhitespace) {
+        text = [self stringByCollapsingWhitespace:text];
+    }
+    text = [self stringByDecodingEntities:text];
+    if (text.length == 0) {
+        return;
+    }
+    if (!_paragraphOpen) {
+        [self openParagraphWithStyle:style];
+    }
+    [self appendText:text withStyle:style];
+}
+
+- (NSString *)stringByCollapsingWhitespace:(NSString *)text {
+    NSUInteger length = text.length;
+    unichar *characters = malloc(sizeof(unichar) * MAX(length, (NSUInteger)1));
+    [text getCharacters:characters range:NSMakeRange(0, length)];
+    // Whitespace at the start of a paragraph or after another space is dropped
+    BOOL lastWasSpace = _lastCharacterWasSpace || !_paragraphOpen || self.output.length == _paragraphStart;
+    NSUInteger count = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        unichar c = characters[i];
+        if (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f') {
+            if (!lastWasSpace) {
+                characters[count++] = ' ';
+            }
+            lastWasSpace = YES;
+        }
+        else {
+            characters[count++] = c;
+            lastWasSpace = NO;
+        }
+    }
+    NSString *collapsed = [[NSString alloc] initWithCharactersNoCopy:characters length:count freeWhenDone:YES];
+    return collapsed;
+}
+
+- (NSString *)stringByDecodingEntities:(NSString *)text {
+    NSRange ampersand = [text rangeOfString:@"&"];
+    if (ampersand.location == NSNotFound) {
+        return text;
+    }
+    static NSDictionary *namedEntities;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        namedEntities = @{@"amp": @"&", @"lt": @"<", @"gt": @">", @"quot": @"\"", @"apos": @"'", @"nbsp": @"\u00A0",
+                          @"copy": @"©", @"reg": @"®", @"trade": @"™", @"mdash": @"—", @"ndash": @"–",
+                          @"hellip": @"…", @"lsquo": @"‘", @"rsquo": @"’", @"ldquo": @"“",
+                          @"rdquo": @"”", @"bull": @"•", @"middot": @"·", @"euro": @"€"};
+    });
+    NSMutableString *decoded = [NSMutableString stringWithCapacity:text.length];
+    NSUInteger location = 0;
+    while (ampersand.location != NSNotFound) {
+        [decoded appendString:[text substringWithRange:NSMakeRange(location, ampersand.location - location)]];
+        location = ampersand.location;
+        NSRange semicolon = [text rangeOfString:@";" options:NSLiteralSearch
+                                          range:NSMakeRange(location, MIN(text.length - location, (NSUInteger)12))];
+        NSString *replacement = nil;
+        if (semicolon.location != NSNotFound) {
+            NSString *entity = [text substringWithRange:NSMakeRange(location + 1, semicolon.location - location - 1)];
+            if ([entity hasPrefix:@"#"]) {
+                unsigned int codePoint = 0;
+                if ([entity hasPrefix:@"#x"] || [entity hasPrefix:@"#X"]) {
+                    [[NSScanner scannerWithString:[entity substringFromIndex:2]] scanHexInt:&codePoint];
+                }
+                else {
+                    codePoint = (unsigned int)[entity substringFromIndex:1].integerValue;
+                }
+                if (codePoint > 0 && codePoint <= 0x10FFFF) {
+                    UTF32Char character = OSSwapHostToLittleInt32(codePoint);
+                    replacement = [[NSString alloc] initWithBytes:&character length:sizeof(character) encoding:NSUTF32LittleEndianStringEncoding];
+                }
+            }
+            else {
+                replacement = namedEntities[entity];
+            }
+        }
+        if (replacement) {
+            [decoded appendString:replacement];
+            location = NSMaxRange(semicolon);
+        }
+        else {
+            [decoded appendString:@"&"];
+            location++;
+        }
+        ampersand = [text rangeOfString:@"&" options:NSLiteralSearch range:NSMakeRange(location, text.length - location)];
+    }
+    [decoded appendString:[text substringFromIndex:location]];
+    return decoded;
+}
+
+- (void)appendText:(NSString *)text withStyle:(RichTextEditorHTMLStyle *)style {
+    [self.output appendAttributedString:[[NSAttributedString alloc] initWithString:text attributes:[self attributesForStyle:style]]];
+    unichar last = [text characterAtIndex:text.length - 1];
+    _lastCharacterWasSpace = (last == ' ');
+    _paragraphEndsWithBreak = NO;
+}
+
+- (void)appendBullet {
+    if (self.bulletString.length == 0) {
+        return;
+    }
+    [self appendText:self.bulletString withStyle:[self currentStyle]];
+    _lastCharacterWasSpace = YES;
+}
+
+#pragma mark - Paragraphs -
+
+- (void)openParagraphWithStyle:(RichTextEditorHTMLStyle *)style {
+    if (_paragraphOpen && (self.output.length > _paragraphStart || _paragraphEndsWithBreak)) {
+        [self closeParagraph];
+    }
+    NSMutableParagraphStyle *paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+    paragraphStyle.alignment = style.hasAlignment ? style.alignment : NSNaturalTextAlignment;
+    if ([style.tagName isEqualToString:@"li"]) {
+        paragraphStyle.firstLineHeadIndent = self.bulletIndentation * MAX(_listLevel, (NSInteger)1) + style.marginLeft;
+        paragraphStyle.headIndent = paragraphStyle.firstLineHeadIndent + [self widthOfBulletWithStyle:style];
+    }
+    else {
+        paragraphStyle.headIndent = style.marginLeft;
+        paragraphStyle.firstLineHeadIndent = MAX(style.marginLeft + style.textIndent, 0);
+    }
+    self.paragraphStyle = paragraphStyle;
+    _paragraphOpen = YES;
+    _paragraphEndsWithBreak = NO;
+    _paragraphStart = self.output.length;
+    _lastCharacterWasSpace = NO;
+}
+
+- (void)closeParagraph {
+    if (!_paragraphOpen) {
+        return;
+    }
+    if (!_paragraphEndsWithBreak) {
+        [self.output appendAttributedString:[[NSAttributedString alloc] initWithString:@"\n" attributes:[self attributesForStyle:[self currentStyle]]]];
+    }
+    [self applyParagraphStyleFromLocation:_paragraphStart];
+    _paragraphOpen = NO;
+    _paragraphEndsWithBreak = NO;
+    _lastCharacterWasSpace = NO;
+}
+
+// <br> ends the current paragraph; the following text carries on with the same paragraph style
+- (void)appendLineBreak {
+    RichTextEditorHTMLStyle *style = [self currentStyle];
+    if (!_paragraphOpen) {
+        [self openParagraphWithStyle:style];
+    }
+    [self.output appendAttributedString:[[NSAttributedString alloc] initWithString:@"\n" attributes:[self attributesForStyle:style]]];
+    [self applyParagraphStyleFromLocation:_paragraphStart];
+    _paragraphStart = self.output.length;
+    _paragraphEndsWithBreak = YES;
+    _lastCharacterWasSpace = NO;
+}
+
+- (void)applyParagraphStyleFromLocation:(NSUInteger)location {
+    NSUInteger length = self.output.length - location;
+    if (length > 0) {
+        [self.output addAttribute:NSParagraphStyleAttributeName value:self.paragraphStyle range:NSMakeRange(location, length)];
+    }
+}
+
+#pragma mark - Fonts -
+
+- (NSDictionary *)attributesForStyle:(RichTextEditorHTMLStyle *)style {
+    if (!style.attributes) {
+        NSMutableDictionary *attributes = [NSMutableDictionary dictionary];
+        NSFont *font = [self fontWithFamily:style.fontFamily size:style.fontSize bold:style.isBold italic:style.isItalic];
+        if (font) {
+            attributes[NSFontAttributeName] = font;
+        }
+        if (style.color) {
+            attributes[NSForegroundColorAttributeName] = style.color;
+        }
+        if (style.backgroundColor) {
+            attributes[NSBackgroundColorAttributeName] = style.backgroundColor;
+        }
+        if (style.hasUnderline) {
+            attributes[NSUnderlineStyleAttributeName] = @(NSUnderlineStyleSingle);
+        }
+        if (style.hasStrikeThrough) {
+            attributes[NSStrikethroughStyleAttributeName] = @(NSUnderlineStyleSingle);
+        }
+        style.attributes = attributes;
+    }
+    return style.attributes;
+}
+
+- (CGFloat)widthOfBulletWithStyle:(RichTextEditorHTMLStyle *)style {
+#if RTE_FOUNDATION_ONLY
+    // Nothing to measure with; same width as RichTextEditorDocument gives the bullet
+    return self.bulletString.length * RTE_FOUNDATION_ONLY_CHARACTER_WIDTH;
+#else
+    NSAttributedString *bullet = [[NSAttributedString alloc] initWithString:self.bulletString attributes:[self attributesForStyle:style]];
+    CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)bullet);
+    CGFloat width = (CGFloat)CTLineGetTypographicBounds(line, NULL, NULL, NULL);
+    CFRelease(line);
+    return width;
+#endif
+}
+
+// Fonts are created through Core Text, which (unlike NSFontManager) is safe to use on any thread.
+- (NSFont *)fontWithFamily:(NSString *)family size:(CGFloat)size bold:(BOOL)isBold italic:(BOOL)isItalic {
+    NSString *key = [NSString stringWithFormat:@"%@|%f|%d|%d", family, size, isBold, isItalic];
+    NSFont *font = self.fonts[key];
+    if (font) {
+        return font;
+    }
+    NSCharacterSet *quotesAndWhitespace = [NSCharacterSet characterSetWithCharactersInString:@"'\" \t\r\n"];
+    NSMutableArray *candidates = [NSMutableArray array];
+    for (NSString *candidate in [family componentsSeparatedByString:@","]) {
+        NSString *name = [candidate stringByTrimmingCharactersInSet:quotesAndWhitespace];
+        if (name.length > 0) {
+            [candidates addObject:name];
+        }
+    }
+    [candidates addObject:self.defaultFontFamily];
+#if RTE_FOUNDATION_ONLY
+    // No installed fonts to match against, so the first name wins
+    font = [NSFont fontWithName:candidates.firstObject size:size boldTrait:isBold italicTrait:isItalic];
+#else
+    CTFontRef ctFont = NULL;
+    for (NSString *name in candidates) {
+        // Family names first (<font face="Helvetica">), then PostScript/full names (Cocoa's style sheets)
+        for (NSString *attribute in @[(__bridge NSString *)kCTFontFamilyNameAttribute, (__bridge NSString *)kCTFontNameAttribute]) {
+            CTFontDescriptorRef descriptor = CTFontDescriptorCreateWithAttributes((__bridge CFDictionaryRef)@{attribute: name});
+            CTFontDescriptorRef match = CTFontDescriptorCreateMatchingFontDescriptor(descriptor, NULL);
+            CFRelease(descriptor);
+            if (match) {
+                ctFont = CTFontCreateWithFontDescriptor(match, size, NULL);
+                CFRelease(match);
+                break;
+            }
+        }
+        if (ctFont) {
+            break;
+        }
+    }
+    if (!ctFont) {
+        ctFont = CTFontCreateUIFontForLanguage(kCTFontUIFontUser, size, NULL);
+    }
+    if (ctFont) {
+        CTFontSymbolicTraits traits = (isBold ? kCTFontBoldTrait : 0) | (isItalic ? kCTFontItalicTrait : 0);
+        CTFontSymbolicTraits currentTraits = CTFontGetSymbolicTraits(ctFont) & (kCTFontBoldTrait | kCTFontItalicTrait);
+        if (traits != currentTraits) {
+            CTFontRef styledFont = CTFontCreateCopyWithSymbolicTraits(ctFont, size, NULL, traits, kCTFontBoldTrait | kCTFontItalicTrait);
+            if (styledFont) {
+                CFRelease(ctFont);
+                ctFont = styledFont;
+            }
+        }
+        font = (__bridge_transfer NSFont *)ctFont;
+    }
+#endif
+    if (font) {
+        self.fonts[key] = font;
+    }
+    return font;
+}
+
+@end
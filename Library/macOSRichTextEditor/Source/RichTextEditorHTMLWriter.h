@@ -0,0 +1,35 @@
+//
+//  RichTextEditorHTMLWriter.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFoundationText.h"
+
+/// Writes the same HTML as -[NSAttributedString htmlString] in a single pass over the text,
+/// through a fixed size buffer, so large documents can be exported straight to a file
+/// without building the whole HTML string in memory.
+///
+/// Adjacent runs that produce the same markup are merged, the markup for each font, color
+/// and paragraph style is only built once, and text is escaped (&, <, >, ").
+@interface RichTextEditorHTMLWriter : NSObject
+
+@property (nonatomic, readonly) NSAttributedString *attributedString;
+
+/// Number of bytes collected before they are written to the stream. Defaults to 64 KB.
+@property (nonatomic) NSUInteger bufferSize;
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)attributedString;
+
+/// Writes the HTML as UTF-8. If the stream has not been opened yet, it is opened and
+/// closed again by the writer; otherwise it is left open.
+- (BOOL)writeToStream:(NSOutputStream *)stream error:(NSError **)error;
+
+/// Writes the HTML as UTF-8 to the given file URL, replacing any existing file.
+- (BOOL)writeToURL:(NSURL *)url error:(NSError **)error;
+
+/// Returns the HTML as a string.
+- (NSString *)htmlString;
+
+@end
@@ -0,0 +1,434 @@
+//
+//  RichTextEditorHTMLWriter.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorHTMLWriter.h"
+#if !RTE_FOUNDATION_ONLY
+#import "NSFont+RichTextEditor.h"
+#endif
+
+#define RTE_HTML_DEFAULT_BUFFER_SIZE (64 * 1024)
+#define RTE_HTML_CHARACTER_CHUNK 1024
+
+// Cached markup for one font: the face/size part of the <font> tag plus the traits
+// that decide whether the run is wrapped in <b>/<i>.
+@interface RichTextEditorHTMLFontMarkup : NSObject
+
+@property NSData *markup;
+@property BOOL isBold;
+@property BOOL isItalic;
+
+@end
+
+@implementation RichTextEditorHTMLFontMarkup
+
+@end
+
+@interface RichTextEditorHTMLWriter () {
+    uint8_t *_buffer;
+    NSUInteger _bufferLength;
+    NSUInteger _bufferCapacity;
+    NSOutputStream *_stream;
+    NSError *_streamError;
+}
+
+@property NSMapTable *fontMarkup;      // NSFont -> RichTextEditorHTMLFontMarkup
+@property NSMapTable *colorMarkup;     // NSColor -> NSData
+@property NSMapTable *paragraphMarkup; // NSParagraphStyle -> NSData
+
+@end
+
+@implementation RichTextEditorHTMLWriter
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)attributedString {
+    if (self = [super init]) {
+        _attributedString = [attributedString copy];
+        _bufferSize = RTE_HTML_DEFAULT_BUFFER_SIZE;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_buffer);
+}
+
+#pragma mark - Public Methods -
+
+- (BOOL)writeToStream:(NSOutputStream *)stream error:(NSError **)error {
+    BOOL shouldOpenStream = (stream.streamStatus == NSStreamStatusNotOpen);
+    if (shouldOpenStream) {
+        [stream open];
+    }
+    _stream = stream;
+    _streamError = stream.streamStatus == NSStreamStatusError ? stream.streamError : nil;
+    _bufferCapacity = MAX(self.bufferSize, (NSUInteger)256);
+    _bufferLength = 0;
+    _buffer = realloc(_buffer, _bufferCapacity);
+    self.fontMarkup = [NSMapTable strongToStrongObjectsMapTable];
+    self.colorMarkup = [NSMapTable strongToStrongObjectsMapTable];
+    self.paragraphMarkup = [NSMapTable strongToStrongObjectsMapTable];
+
+    [self writeParagraphs];
+    [self flush];
+
+    NSError *streamError = _streamError;
+    if (shouldOpenStream) {
+        [stream close];
+    }
+    _stream = nil;
+    _streamError = nil;
+    free(_buffer);
+    _buffer = NULL;
+    self.fontMarkup = nil;
+    self.colorMarkup = nil;
+    self.paragraphMarkup = nil;
+    if (streamError && error) {
+        *error = streamError;
+    }
+    return streamError == nil;
+}
+
+- (BOOL)writeToURL:(NSURL *)url error:(NSError **)error {
+    NSOutputStream *stream = [NSOutputStream outputStreamWithURL:url append:NO];
+    if (!stream) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:@{NSURLErrorKey: url}];
+        }
+        return NO;
+    }
+    return [self writeToStream:stream error:error];
+}
+
+- (NSString *)htmlString {
+    NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+    if (![self writeToStream:stream error:nil]) {
+        return nil;
+    }
+    NSData *data = [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+    return data ? [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] : @"";
+}
+
+#pragma mark - Document -
+
+- (void)writeParagraphs {
+    NSString *string = self.attributedString.string;
+    NSUInteger length = string.length;
+    NSUInteger location = 0;
+    while (location < length && !_streamError) {
+        NSRange newline = [string rangeOfString:@"\n" options:NSLiteralSearch range:NSMakeRange(location, length - location)];
+        NSUInteger end = newline.location == NSNotFound ? length : newline.location;
+        @autoreleasepool {
+            [self writeParagraphInRange:NSMakeRange(location, end - location)];
+        }
+        // Like the original exporter, the empty paragraph after a trailing newline is not written
+        location = end + 1;
+    }
+}
+
+- (void)writeParagraphInRange:(NSRange)paragraphRange {
+    NSAttributedString *attributedString = self.attributedString;
+    NSParagraphStyle *paragraphStyle = [attributedString attribute:NSParagraphStyleAttributeName atIndex:paragraphRange.location effectiveRange:nil];
+    [self appendData:[self markupForParagraphStyle:paragraphStyle]];
+
+    // The run being written; extended for as long as following runs produce the same markup
+    __block NSRange runRange = NSMakeRange(NSNotFound, 0);
+    __block RichTextEditorHTMLFontMarkup *runFont = nil;
+    __block NSData *runColor = nil;
+    __block NSData *runBackgroundColor = nil;
+    __block BOOL runHasUnderline = NO;
+    __block BOOL runHasStrikeThrough = NO;
+    [attributedString enumerateAttributesInRange:paragraphRange
+                                         options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                                      usingBlock:^(NSDictionary *dictionary, NSRange range, BOOL *stop) {
+        RichTextEditorHTMLFontMarkup *font = [self markupForFont:[dictionary objectForKey:NSFontAttributeName]];
+        NSData *color = [self markupForColor:[dictionary objectForKey:NSForegroundColorAttributeName]];
+        NSData *backgroundColor = [self markupForColor:[dictionary objectForKey:NSBackgroundColorAttributeName]];
+        NSNumber *underline = [dictionary objectForKey:NSUnderlineStyleAttributeName];
+        BOOL hasUnderline = (!underline || underline.intValue == NSUnderlineStyleNone) ? NO : YES;
+        NSNumber *strikeThrough = [dictionary objectForKey:NSStrikethroughStyleAttributeName];
+        BOOL hasStrikeThrough = (!strikeThrough || strikeThrough.intValue == NSUnderlineStyleNone) ? NO : YES;
+        // Markup is cached per value, so pointer comparison is enough here
+        if (runRange.location != NSNotFound && NSMaxRange(runRange) == range.location &&
+            font == runFont && color == runColor && backgroundColor == runBackgroundColor &&
+            hasUnderline == runHasUnderline && hasStrikeThrough == runHasStrikeThrough) {
+            runRange.length += range.length;
+            return;
+        }
+        if (runRange.location != NSNotFound) {
+            [self writeRunInRange:runRange font:runFont color:runColor backgroundColor:runBackgroundColor
+                        underline:runHasUnderline strikeThrough:runHasStrikeThrough];
+        }
+        runRange = range;
+        runFont = font;
+        runColor = color;
+        runBackgroundColor = backgroundColor;
+        runHasUnderline = hasUnderline;
+        runHasStrikeThrough = hasStrikeThrough;
+    }];
+    if (runRange.location != NSNotFound) {
+        [self writeRunInRange:runRange font:runFont color:runColor backgroundColor:runBackgroundColor
+                    underline:runHasUnderline strikeThrough:runHasStrikeThrough];
+    }
+    [self appendCString:"</p>"];
+}
+
+- (void)writeRunInRange:(NSRange)range font:(RichTextEditorHTMLFontMarkup *)font color:(NSData *)color backgroundColor:(NSData *)backgroundColor
+              underline:(BOOL)hasUnderline strikeThrough:(BOOL)hasStrikeThrough {
+    if (hasStrikeThrough) {
+        [self appendCString:"<strike>"];
+    }
+    if (hasUnderline) {
+        [self appendCString:"<u>"];
+    }
+    if (font.isItalic) {
+        [self appendCString:"<i>"];
+    }
+    if (font.isBold) {
+        [self appendCString:"<b>"];
+    }
+    [self appendCString:"<font "];
+    [self appendData:font.markup];
+    if (color) {
+        [self appendCString:"color:"];
+        [self appendData:color];
+        [self appendCString:"; "];
+    }
+    if (backgroundColor) {
+        [self appendCString:"background-color:"];
+        [self appendData:backgroundColor];
+        [self appendCString:"; "];
+    }
+    [self appendCString:"\" >"];
+    [self appendEscapedCharactersInRange:range];
+    [self appendCString:"</font>"];
+    if (font.isBold) {
+        [self appendCString:"</b>"];
+    }
+    if (font.isItalic) {
+        [self appendCString:"</i>"];
+    }
+    if (hasUnderline) {
+        [self appendCString:"</u>"];
+    }
+    if (hasStrikeThrough) {
+        [self appendCString:"</strike>"];
+    }
+}
+
+#pragma mark - Markup Caches -
+
+- (NSData *)markupForParagraphStyle:(NSParagraphStyle *)paragraphStyle {
+    id key = paragraphStyle ? paragraphStyle : [NSNull null];
+    NSData *markup = [self.paragraphMarkup objectForKey:key];
+    if (!markup) {
+        NSMutableString *string = [NSMutableString stringWithString:@"<p "];
+        NSString *textAlignmentString = [self htmlTextAlignmentString:paragraphStyle.alignment];
+        if (textAlignmentString) {
+            [string appendFormat:@"align=\"%@\" ", textAlignmentString];
+        }
+        [string appendString:@"style=\""];
+        if (paragraphStyle.firstLineHeadIndent > 0) {
+            [string appendFormat:@"text-indent:%.0fpx; ", paragraphStyle.firstLineHeadIndent - paragraphStyle.headIndent];
+        }
+        if (paragraphStyle.headIndent > 0) {
+            [string appendFormat:@"margin-left:%.0fpx; ", paragraphStyle.headIndent];
+        }
+        [string appendString:@" \">"];
+        markup = [string dataUsingEncoding:NSUTF8StringEncoding];
+        [self.paragraphMarkup setObject:markup forKey:key];
+    }
+    return markup;
+}
+
+- (RichTextEditorHTMLFontMarkup *)markupForFont:(NSFont *)font {
+    id key = font ? font : [NSNull null];
+    RichTextEditorHTMLFontMarkup *fontMarkup = [self.fontMarkup objectForKey:key];
+    if (!fontMarkup) {
+        fontMarkup = [[RichTextEditorHTMLFontMarkup alloc] init];
+        NSMutableString *string = [NSMutableString string];
+        if (font) {
+            [string appendFormat:@"face=\"%@\" ", [self escapedAttributeValue:font.familyName]];
+        }
+        [string appendString:@" style=\" "];
+        if (font) {
+            [string appendFormat:@"font-size:%.0fpx; ", font.pointSize];
+        }
+        fontMarkup.markup = [string dataUsingEncoding:NSUTF8StringEncoding];
+        fontMarkup.isBold = [font isBold];
+        fontMarkup.isItalic = [font isItalic];
+        [self.fontMarkup setObject:fontMarkup forKey:key];
+    }
+    return fontMarkup;
+}
+
+- (NSData *)markupForColor:(NSColor *)color {
+    if (!color || ![color isKindOfClass:[NSColor class]]) {
+        return nil;
+    }
+    NSData *markup = [self.colorMarkup objectForKey:color];
+    if (!markup) {
+        CGFloat red = 0.0, green = 0.0, blue = 0.0, alpha = 0.0;
+        [color getRed:&red green:&green blue:&blue alpha:&alpha];
+        char rgb[64];
+        int length = snprintf(rgb, sizeof(rgb), "rgb(%d,%d,%d)", (int)(red*255.0), (int)(green*255.0), (int)(blue*255.0));
+        markup = [NSData dataWithBytes:rgb length:(NSUInteger)length];
+        [self.colorMarkup setObject:markup forKey:color];
+    }
+    return markup;
+}
+
+- (NSString *)htmlTextAlignmentString:(NSTextAlignment)textAlignment {
+    switch (textAlignment) {
+        case NSLeftTextAlignment:
+            return @"left";
+        case NSCenterTextAlignment:
+            return @"center";
+        case NSRightTextAlignment:
+            return @"right";
+        case NSJustifiedTextAlignment:
+            return @"justify";
+        default:
+            return nil;
+    }
+}
+
+- (NSString *)escapedAttributeValue:(NSString *)value {
+    if (!value) {
+        return @"";
+    }
+    NSMutableString *escaped = [value mutableCopy];
+    [escaped replaceOccurrencesOfString:@"&" withString:@"&amp;" options:NSLiteralSearch range:NSMakeRange(0, escaped.length)];
+    [escaped replaceOccurrencesOfString:@"\"" withString:@"&quot;" options:NSLiteralSearch range:NSMakeRange(0, escaped.length)];
+    [escaped replaceOccurrencesOfString:@"<" withString:@"&lt;" options:NSLiteralSearch range:NSMakeRange(0, escaped.length)];
+    [escaped replaceOccurrencesOfString:@">" withString:@"&gt;" options:NSLiteralSearch range:NSMakeRange(0, escaped.length)];
+    return escaped;
+}
+
+#pragma mark - Output -
+
+// Escapes and UTF-8 encodes the text in range straight into the output buffer
+- (void)appendEscapedCharactersInRange:(NSRange)range {
+    NSString *string = self.attributedString.string;
+    unichar characters[RTE_HTML_CHARACTER_CHUNK];
+    // Worst case per UTF-16 unit is "&quot;" (6 bytes)
+    uint8_t bytes[RTE_HTML_CHARACTER_CHUNK * 6 + 4];
+    unichar highSurrogate = 0;
+    NSUInteger location = range.location;
+    NSUInteger end = NSMaxRange(range);
+    while (location < end && !_streamError) {
+        NSUInteger chunkLength = MIN((NSUInteger)RTE_HTML_CHARACTER_CHUNK, end - location);
+        [string getCharacters:characters range:NSMakeRange(location, chunkLength)];
+        NSUInteger byteCount = 0;
+        for (NSUInteger i = 0; i < chunkLength; i++) {
+            uint32_t c = characters[i];
+            if (highSurrogate) {
+                if (CFStringIsSurrogateLowCharacter(c)) {
+                    c = CFStringGetLongCharacterForSurrogatePair(highSurrogate, (unichar)c);
+                    highSurrogate = 0;
+                    bytes[byteCount++] = (uint8_t)(0xF0 | (c >> 18));
+                    bytes[byteCount++] = (uint8_t)(0x80 | ((c >> 12) & 0x3F));
+                    bytes[byteCount++] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+                    bytes[byteCount++] = (uint8_t)(0x80 | (c & 0x3F));
+                    continue;
+                }
+                highSurrogate = 0;
+                c = 0xFFFD; // unpaired surrogate; written below, then this character is handled again
+                i--;
+            }
+            else if (CFStringIsSurrogateHighCharacter(c)) {
+                highSurrogate = (unichar)c;
+                continue;
+            }
+            else if (CFStringIsSurrogateLowCharacter(c)) {
+                c = 0xFFFD;
+            }
+            switch (c) {
+                case '&':
+                    memcpy(bytes + byteCount, "&amp;", 5);
+                    byteCount += 5;
+                    break;
+                case '<':
+                    memcpy(bytes + byteCount, "&lt;", 4);
+                    byteCount += 4;
+                    break;
+                case '>':
+                    memcpy(bytes + byteCount, "&gt;", 4);
+                    byteCount += 4;
+                    break;
+                case '"':
+                    memcpy(bytes + byteCount, "&quot;", 6);
+                    byteCount += 6;
+                    break;
+                default:
+                    if (c < 0x80) {
+                        bytes[byteCount++] = (uint8_t)c;
+                    }
+                    else if (c < 0x800) {
+                        bytes[byteCount++] = (uint8_t)(0xC0 | (c >> 6));
+                        bytes[byteCount++] = (uint8_t)(0x80 | (c & 0x3F));
+                    }
+                    else {
+                        bytes[byteCount++] = (uint8_t)(0xE0 | (c >> 12));
+                        bytes[byteCount++] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+                        bytes[byteCount++] = (uint8_t)(0x80 | (c & 0x3F));
+                    }
+                    break;
+            }
+        }
+        [self appendBytes:bytes length:byteCount];
+        location += chunkLength;
+    }
+    if (highSurrogate) {
+        [self appendBytes:"\xEF\xBF\xBD" length:3]; // U+FFFD
+    }
+}
+
+- (void)appendCString:(const char *)string {
+    [self appendBytes:string length:strlen(string)];
+}
+
+- (void)appendData:(NSData *)data {
+    [self appendBytes:data.bytes length:data.length];
+}
+
+- (void)appendBytes:(const void *)bytes length:(NSUInteger)length {
+    if (_streamError || length == 0) {
+        return;
+    }
+    if (_bufferLength + length > _bufferCapacity) {
+        [self flush];
+        if (length > _bufferCapacity) {
+            [self writeBytes:bytes length:length];
+            return;
+        }
+    }
+    memcpy(_buffer + _bufferLength, bytes, length);
+    _bufferLength += length;
+}
+
+- (void)flush {
+    if (_bufferLength > 0) {
+        [self writeBytes:_buffer length:_bufferLength];
+        _bufferLength = 0;
+    }
+}
+
+- (void)writeBytes:(const uint8_t *)bytes length:(NSUInteger)length {
+    while (length > 0 && !_streamError) {
+        NSInteger written = [_stream write:bytes maxLength:length];
+        if (written <= 0) {
+            _streamError = _stream.streamError;
+            if (!_streamError) {
+                _streamError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:nil];
+            }
+            return;
+        }
+        bytes += written;
+        length -= (NSUInteger)written;
+    }
+}
+
+@end
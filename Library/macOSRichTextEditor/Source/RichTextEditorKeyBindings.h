@@ -0,0 +1,61 @@
+//
+//  RichTextEditorKeyBindings.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+#import "RichTextEditor.h"
+
+/// Runs a bound command. Return NO if the command doesn't apply right now (e.g. leaving a
+/// list when the selection isn't in one); the key is then handled as if it weren't bound.
+typedef BOOL (^RichTextEditorKeyCommand)(RichTextEditor *editor);
+
+/// A table of key + modifier flags -> command that RichTextEditor checks in keyDown: before
+/// handling a key as typing.
+///
+/// Bindings are compiled into a sorted array the first time a key is looked up after they (or
+/// enabledShortcuts) change, so a lookup is a binary search over the bound keys. Keys typed
+/// without command, control or option are rejected with a single bit test unless a binding
+/// uses them, so ordinary typing pays almost nothing for the table.
+///
+/// Keys are matched on charactersIgnoringModifiers and on the shift, control, option and
+/// command flags only. Letters are matched in the case shift gives them (so caps lock doesn't
+/// matter), and shift-tab's back tab character is matched as a tab. A binding needs its flags
+/// exactly, except for any control and option flags it was bound ignoring; a binding that
+/// needs them exactly wins over one that ignores them.
+@interface RichTextEditorKeyBindings : NSObject <NSCopying>
+
+/// Shortcuts the editor's data source enabled (see -[RichTextEditorDataSource enabledKeyboardShortcuts]).
+/// Bindings added with a shortcut other than RichTextEditorShortcutAll are left out of the
+/// table unless it is enabled here. Defaults to RichTextEditorShortcutAll.
+@property (nonatomic) RichTextEditorShortcut enabledShortcuts;
+
+/// Number of keys bound, including ones left out by enabledShortcuts.
+@property (nonatomic, readonly) NSUInteger count;
+
+/// Binds key (a single character, or a function key such as NSF5FunctionKey) with
+/// modifierFlags to command, replacing any earlier binding of the same key. shortcut is the
+/// RichTextEditorShortcut that enables the binding, or RichTextEditorShortcutAll to always
+/// enable it.
+- (void)bindKey:(NSString *)key modifierFlags:(NSEventModifierFlags)modifierFlags shortcut:(RichTextEditorShortcut)shortcut command:(RichTextEditorKeyCommand)command;
+
+/// Like bindKey:modifierFlags:shortcut:command:, but the key also matches with any of
+/// ignoredModifierFlags (NSControlKeyMask and/or NSAlternateKeyMask) held down as well. The
+/// editor's default bindings ignore both, so that e.g. command-option-B still toggles bold.
+- (void)bindKey:(NSString *)key modifierFlags:(NSEventModifierFlags)modifierFlags ignoringModifierFlags:(NSEventModifierFlags)ignoredModifierFlags
+       shortcut:(RichTextEditorShortcut)shortcut command:(RichTextEditorKeyCommand)command;
+
+/// Binds key to an action sent up the responder chain from the editor with tryToPerform:with:,
+/// so an app can bind keys to its own actions without subclassing the editor.
+- (void)bindKey:(NSString *)key modifierFlags:(NSEventModifierFlags)modifierFlags action:(SEL)action;
+
+- (void)unbindKey:(NSString *)key modifierFlags:(NSEventModifierFlags)modifierFlags;
+
+- (void)removeAllBindings;
+
+/// The enabled command for a key from an NSEvent, or nil.
+- (RichTextEditorKeyCommand)commandForKeyCharacter:(unichar)keyCharacter modifierFlags:(NSEventModifierFlags)modifierFlags;
+
+@end
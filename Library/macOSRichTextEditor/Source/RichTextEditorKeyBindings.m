@@ -0,0 +1,218 @@
+//
+//  RichTextEditorKeyBindings.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorKeyBindings.h"
+
+static const NSEventModifierFlags RTEKeyBindingModifierMask = NSShiftKeyMask | NSControlKeyMask | NSAlternateKeyMask | NSCommandKeyMask;
+static const NSEventModifierFlags RTEKeyBindingCommandModifierMask = NSControlKeyMask | NSAlternateKeyMask | NSCommandKeyMask;
+static const NSEventModifierFlags RTEKeyBindingIgnorableModifierMask = NSControlKeyMask | NSAlternateKeyMask;
+
+// Character in the high half, modifier flags (all below bit 32) in the low half
+static inline uint64_t RTEKeyBindingCode(unichar c, NSEventModifierFlags modifierFlags) {
+    modifierFlags &= RTEKeyBindingModifierMask;
+    if (c == NSBackTabCharacter) {
+        c = '\t';
+    }
+    else if (modifierFlags & NSShiftKeyMask) {
+        if (c >= 'a' && c <= 'z') {
+            c -= 'a' - 'A';
+        }
+    }
+    else if (c >= 'A' && c <= 'Z') {
+        c += 'a' - 'A';
+    }
+    return ((uint64_t)c << 32) | (uint64_t)modifierFlags;
+}
+
+@interface RichTextEditorKeyBinding : NSObject
+
+@property (nonatomic) RichTextEditorShortcut shortcut;
+@property (nonatomic) NSEventModifierFlags ignoredModifierFlags;
+@property (nonatomic, copy) RichTextEditorKeyCommand command;
+
+@end
+
+@implementation RichTextEditorKeyBinding
+
+@end
+
+@interface RichTextEditorKeyBindings () {
+    // Compiled table: sorted codes, and the ignored modifier flags and command for each
+    uint64_t *_codes;
+    NSEventModifierFlags *_ignoredModifierFlags;
+    NSUInteger _codeCount;
+    // Bit per ASCII character bound without command, control or option
+    uint64_t _plainKeyBits[2];
+    BOOL _hasNonASCIIPlainKeys;
+    BOOL _needsCompile;
+}
+
+@property NSMutableDictionary<NSNumber *, RichTextEditorKeyBinding *> *bindings;
+@property NSArray<RichTextEditorKeyCommand> *commands;
+
+@end
+
+@implementation RichTextEditorKeyBindings
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _bindings = [NSMutableDictionary dictionary];
+        _enabledShortcuts = RichTextEditorShortcutAll;
+        _needsCompile = YES;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_codes);
+    free(_ignoredModifierFlags);
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    RichTextEditorKeyBindings *copy = [[[self class] allocWithZone:zone] init];
+    copy.bindings = [self.bindings mutableCopy];
+    copy.enabledShortcuts = self.enabledShortcuts;
+    return copy;
+}
+
+#pragma mark - Bindings -
+
+- (NSUInteger)count {
+    return self.bindings.count;
+}
+
+- (void)setEnabledShortcuts:(RichTextEditorShortcut)enabledShortcuts {
+    if (enabledShortcuts != _enabledShortcuts) {
+        _enabledShortcuts = enabledShortcuts;
+        _needsCompile = YES;
+    }
+}
+
+- (void)bindKey:(NSString *)key modifierFlags:(NSEventModifierFlags)modifierFlags shortcut:(RichTextEditorShortcut)shortcut command:(RichTextEditorKeyCommand)command {
+    [self bindKey:key modifierFlags:modifierFlags ignoringModifierFlags:0 shortcut:shortcut command:command];
+}
+
+- (void)bindKey:(NSString *)key modifierFlags:(NSEventModifierFlags)modifierFlags ignoringModifierFlags:(NSEventModifierFlags)ignoredModifierFlags
+       shortcut:(RichTextEditorShortcut)shortcut command:(RichTextEditorKeyCommand)command {
+    NSParameterAssert(key.length == 1 && command);
+    NSParameterAssert((ignoredModifierFlags & ~RTEKeyBindingIgnorableModifierMask) == 0);
+    RichTextEditorKeyBinding *binding = [[RichTextEditorKeyBinding alloc] init];
+    binding.shortcut = shortcut;
+    binding.ignoredModifierFlags = ignoredModifierFlags & RTEKeyBindingIgnorableModifierMask & ~modifierFlags;
+    binding.command = command;
+    self.bindings[@(RTEKeyBindingCode([key characterAtIndex:0], modifierFlags))] = binding;
+    _needsCompile = YES;
+}
+
+- (void)bindKey:(NSString *)key modifierFlags:(NSEventModifierFlags)modifierFlags action:(SEL)action {
+    [self bindKey:key modifierFlags:modifierFlags shortcut:RichTextEditorShortcutAll command:^BOOL(RichTextEditor *editor) {
+        return [editor tryToPerform:action with:editor];
+    }];
+}
+
+- (void)unbindKey:(NSString *)key modifierFlags:(NSEventModifierFlags)modifierFlags {
+    if (key.length == 1) {
+        [self.bindings removeObjectForKey:@(RTEKeyBindingCode([key characterAtIndex:0], modifierFlags))];
+        _needsCompile = YES;
+    }
+}
+
+- (void)removeAllBindings {
+    [self.bindings removeAllObjects];
+    _needsCompile = YES;
+}
+
+#pragma mark - Lookup -
+
+- (void)compile {
+    RichTextEditorShortcut enabledShortcuts = self.enabledShortcuts;
+    NSMutableArray<NSNumber *> *codes = [NSMutableArray arrayWithCapacity:self.bindings.count];
+    [self.bindings enumerateKeysAndObjectsUsingBlock:^(NSNumber *code, RichTextEditorKeyBinding *binding, BOOL *stop) {
+        if (enabledShortcuts == RichTextEditorShortcutAll || binding.shortcut == RichTextEditorShortcutAll ||
+            (enabledShortcuts & binding.shortcut)) {
+            [codes addObject:code];
+        }
+    }];
+    [codes sortUsingSelector:@selector(compare:)];
+
+    free(_codes);
+    free(_ignoredModifierFlags);
+    _codes = malloc(MAX(codes.count, (NSUInteger)1) * sizeof(uint64_t));
+    _ignoredModifierFlags = malloc(MAX(codes.count, (NSUInteger)1) * sizeof(NSEventModifierFlags));
+    _codeCount = codes.count;
+    _plainKeyBits[0] = 0;
+    _plainKeyBits[1] = 0;
+    _hasNonASCIIPlainKeys = NO;
+    NSMutableArray<RichTextEditorKeyCommand> *commands = [NSMutableArray arrayWithCapacity:codes.count];
+    for (NSUInteger i = 0; i < codes.count; i++) {
+        uint64_t code = codes[i].unsignedLongLongValue;
+        RichTextEditorKeyBinding *binding = self.bindings[codes[i]];
+        _codes[i] = code;
+        _ignoredModifierFlags[i] = binding.ignoredModifierFlags;
+        [commands addObject:binding.command];
+        if ((code & RTEKeyBindingCommandModifierMask) == 0) {
+            unichar c = (unichar)(code >> 32);
+            if (c < 128) {
+                _plainKeyBits[c >> 6] |= (uint64_t)1 << (c & 63);
+            }
+            else {
+                _hasNonASCIIPlainKeys = YES;
+            }
+        }
+    }
+    self.commands = commands;
+    _needsCompile = NO;
+}
+
+- (RichTextEditorKeyCommand)commandForKeyCharacter:(unichar)keyCharacter modifierFlags:(NSEventModifierFlags)modifierFlags {
+    if (_needsCompile) {
+        [self compile];
+    }
+    uint64_t code = RTEKeyBindingCode(keyCharacter, modifierFlags);
+    if ((modifierFlags & RTEKeyBindingCommandModifierMask) == 0) {
+        unichar c = (unichar)(code >> 32);
+        if (c < 128 ? !(_plainKeyBits[c >> 6] & ((uint64_t)1 << (c & 63))) : !_hasNonASCIIPlainKeys) {
+            return nil;
+        }
+    }
+    NSUInteger index = [self indexOfCode:code];
+    if (index != NSNotFound) {
+        return _commands[index];
+    }
+    // Otherwise look for a binding that ignores the control and option flags that are down:
+    // leaving out one of them before both, so the closest binding wins
+    NSEventModifierFlags extraFlags = modifierFlags & RTEKeyBindingIgnorableModifierMask;
+    const NSEventModifierFlags candidates[] = { NSAlternateKeyMask, NSControlKeyMask, RTEKeyBindingIgnorableModifierMask };
+    for (NSUInteger i = 0; extraFlags && i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        NSEventModifierFlags ignored = candidates[i];
+        if ((extraFlags & ignored) != ignored) {
+            continue;
+        }
+        index = [self indexOfCode:RTEKeyBindingCode(keyCharacter, modifierFlags & ~ignored)];
+        if (index != NSNotFound && (_ignoredModifierFlags[index] & ignored) == ignored) {
+            return _commands[index];
+        }
+    }
+    return nil;
+}
+
+- (NSUInteger)indexOfCode:(uint64_t)code {
+    NSUInteger low = 0;
+    NSUInteger high = _codeCount;
+    while (low < high) {
+        NSUInteger middle = (low + high) / 2;
+        if (_codes[middle] < code) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return (low < _codeCount && _codes[low] == code) ? low : NSNotFound;
+}
+
+@end
@@ -0,0 +1,54 @@
+//
+//  RichTextEditorMarkdownReader.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+/// Builds an NSAttributedString from Markdown, mapped onto what the editor itself uses: bold,
+/// italic, underline and strike through runs, and list items as bullet paragraphs indented by
+/// their nesting level.
+///
+/// Understood: paragraphs (with soft and hard line breaks), ATX and setext headings (bold,
+/// larger text), - * + and numbered list items (as bullets), block quotes (indented), fenced and
+/// indented code blocks and `code spans` (fixed pitch font), **strong** / __strong__,
+/// *emphasis* / _emphasis_, ~~strike through~~, <u>underline</u>, [links](url) and <autolinks>,
+/// backslash escapes and entities, and <p align="..."> paragraphs as written by
+/// RichTextEditorMarkdownWriter. Empty paragraphs can't be expressed in Markdown, so there are none
+/// in the result.
+///
+/// Input is read line by line with appendData:, and every step is linear in the size of the
+/// input, so multi-megabyte files can be read without loading them first. Fonts are made
+/// through Core Text, so a reader can be used on any thread (one thread at a time).
+@interface RichTextEditorMarkdownReader : NSObject
+
+/// Font of body text; bold, italic, heading and code fonts are derived from it. Defaults to
+/// the user font at 12 points.
+@property (nonatomic) NSFont *font;
+
+/// Prefix added to each list item paragraph. Defaults to the editor's bullet string.
+@property (nonatomic, copy) NSString *bulletString;
+
+/// First line head indent of a list item per level of nesting, and the head indent of each
+/// level of block quote. Defaults to 15.
+@property (nonatomic) CGFloat bulletIndentation;
+
+/// Set if the input wasn't valid UTF-8; finish then returns nil.
+@property (nonatomic, readonly) NSError *error;
+
+/// Feeds the next chunk of UTF-8 encoded Markdown to the reader.
+- (void)appendData:(NSData *)data;
+
+/// Finishes reading and returns the document (without a newline after the last paragraph),
+/// or nil if the input wasn't valid UTF-8.
+- (NSAttributedString *)finish;
+
+/// Reads the whole stream and returns the document, or nil if the stream couldn't be read.
+- (NSAttributedString *)attributedStringFromStream:(NSInputStream *)stream;
+
+/// Convenience for reading a Markdown string with a new reader.
++ (NSAttributedString *)attributedStringFromMarkdownString:(NSString *)markdownString;
+
+@end
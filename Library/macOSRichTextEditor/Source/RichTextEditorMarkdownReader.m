@@ -0,0 +1,1249 @@
+//
+//  RichTextEditorMarkdownReader.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorMarkdownReader.h"
+#import <CoreText/CoreText.h>
+
+#define RTE_MARKDOWN_READ_CHUNK_SIZE (64 * 1024)
+
+typedef NS_ENUM(NSInteger, RichTextEditorMarkdownBlockType) {
+    RichTextEditorMarkdownBlockNone,
+    RichTextEditorMarkdownBlockParagraph,
+    RichTextEditorMarkdownBlockListItem,
+    RichTextEditorMarkdownBlockListParagraph, // paragraph after a blank line inside a list item
+    RichTextEditorMarkdownBlockHeading
+};
+
+typedef NS_OPTIONS(NSUInteger, RichTextEditorMarkdownStyle) {
+    RichTextEditorMarkdownStyleBold = 1 << 0,
+    RichTextEditorMarkdownStyleItalic = 1 << 1,
+    RichTextEditorMarkdownStyleStrikeThrough = 1 << 2,
+    RichTextEditorMarkdownStyleUnderline = 1 << 3,
+    RichTextEditorMarkdownStyleCode = 1 << 4
+};
+
+typedef NS_ENUM(uint8_t, RichTextEditorMarkdownMarkerKind) {
+    RichTextEditorMarkdownMarkerDelimiter, // run of *, _ or ~
+    RichTextEditorMarkdownMarkerBracket,   // [ that may start a link; written as text if it doesn't
+    RichTextEditorMarkdownMarkerLinkOpen,
+    RichTextEditorMarkdownMarkerLinkClose,
+    RichTextEditorMarkdownMarkerUnderlineOpen,
+    RichTextEditorMarkdownMarkerUnderlineClose,
+    RichTextEditorMarkdownMarkerCodeOpen,
+    RichTextEditorMarkdownMarkerCodeClose
+};
+
+// Emphasis a delimiter run starts or ends, by index
+enum {
+    RTEMarkdownEmphasisBold,
+    RTEMarkdownEmphasisItalic,
+    RTEMarkdownEmphasisStrikeThrough,
+    RTEMarkdownEmphasisCount
+};
+
+// Something in a paragraph's inline content that isn't plain text. Markers are kept in the
+// order they were found, at the position in the decoded text where they take effect.
+typedef struct {
+    RichTextEditorMarkdownMarkerKind kind;
+    unichar character;
+    BOOL canOpen;
+    BOOL canClose;
+    NSUInteger position;
+    NSUInteger count;         // delimiter characters not used for emphasis; written as text
+    NSUInteger originalCount;
+    NSInteger previous;       // neighbours in the list of delimiters still open for matching
+    NSInteger next;
+    NSInteger delimiterBottom; // brackets: the last delimiter before the bracket
+    NSUInteger link;           // link open: index into links
+    uint16_t opens[RTEMarkdownEmphasisCount];
+    uint16_t closes[RTEMarkdownEmphasisCount];
+} RTEMarkdownMarker;
+
+static BOOL RTEMarkdownIsWhitespace(unichar c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == 0x00A0 ||
+        (c > 0x7F && CFCharacterSetIsCharacterMember(CFCharacterSetGetPredefined(kCFCharacterSetWhitespaceAndNewline), c));
+}
+
+static BOOL RTEMarkdownIsASCIIPunctuation(unichar c) {
+    return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+}
+
+static BOOL RTEMarkdownIsPunctuation(unichar c) {
+    if (c < 0x80) {
+        return RTEMarkdownIsASCIIPunctuation(c);
+    }
+    return CFCharacterSetIsCharacterMember(CFCharacterSetGetPredefined(kCFCharacterSetPunctuation), c);
+}
+
+// YES if the (ASCII) tag is at index, ignoring case
+static BOOL RTEMarkdownHasTag(const unichar *characters, NSUInteger length, NSUInteger index, const char *tag) {
+    NSUInteger tagLength = strlen(tag);
+    if (index + tagLength > length) {
+        return NO;
+    }
+    for (NSUInteger i = 0; i < tagLength; i++) {
+        unichar c = characters[index + i];
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        if (c != (unichar)tag[i]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+static RichTextEditorMarkdownStyle RTEMarkdownStyle(const NSInteger *emphasis, NSInteger underline, NSInteger code) {
+    return (emphasis[RTEMarkdownEmphasisBold] > 0 ? RichTextEditorMarkdownStyleBold : 0) |
+        (emphasis[RTEMarkdownEmphasisItalic] > 0 ? RichTextEditorMarkdownStyleItalic : 0) |
+        (emphasis[RTEMarkdownEmphasisStrikeThrough] > 0 ? RichTextEditorMarkdownStyleStrikeThrough : 0) |
+        (underline > 0 ? RichTextEditorMarkdownStyleUnderline : 0) | (code > 0 ? RichTextEditorMarkdownStyleCode : 0);
+}
+
+@interface RichTextEditorMarkdownReader () {
+    // Lines
+    BOOL _isFirstLine;
+    BOOL _previousLineWasBlank;
+    unichar _fenceCharacter;
+    NSUInteger _fenceLength;
+
+    // The block being collected
+    RichTextEditorMarkdownBlockType _blockType;
+    NSUInteger _blockLevel;
+    NSUInteger _blockHeadingLevel;
+    NSUInteger _blockQuoteDepth;
+    NSTextAlignment _blockAlignment;
+    BOOL _blockEndsWithHardBreak;
+
+    // Inline parsing of one block
+    unichar *_text;
+    NSUInteger _textLength;
+    RTEMarkdownMarker *_markers;
+    NSUInteger _markerCount;
+    NSUInteger _markerCapacity;
+    NSInteger _lastDelimiter;
+    NSInteger *_brackets;
+    NSUInteger _bracketCount;
+    NSUInteger _bracketCapacity;
+    NSUInteger _inactiveBracketCount; // brackets below this can't start a link any more
+}
+
+@property NSMutableData *pendingLine;
+@property NSMutableString *blockText;
+@property NSMutableArray<NSValue *> *listLevels; // NSRange: location = marker column, length = content column - marker column
+@property NSMutableArray<NSString *> *links;
+@property NSMutableAttributedString *output;
+@property NSMutableDictionary *attributes;
+@property NSMutableDictionary *fonts;
+@property NSMutableDictionary *paragraphStyles;
+@property CGFloat bulletWidth;
+@property (nonatomic, readwrite) NSError *error;
+
+@end
+
+@implementation RichTextEditorMarkdownReader
+
+- (instancetype)init {
+    if (self = [super init]) {
+        CTFontRef userFont = CTFontCreateUIFontForLanguage(kCTFontUIFontUser, 12, NULL);
+        _font = (__bridge_transfer NSFont *)userFont;
+        _bulletString = @"\u2022\u00A0";
+        _bulletIndentation = 15;
+        _isFirstLine = YES;
+        _lastDelimiter = -1;
+        _pendingLine = [NSMutableData data];
+        _blockText = [NSMutableString string];
+        _listLevels = [NSMutableArray array];
+        _links = [NSMutableArray array];
+        _output = [[NSMutableAttributedString alloc] init];
+        _attributes = [NSMutableDictionary dictionary];
+        _fonts = [NSMutableDictionary dictionary];
+        _paragraphStyles = [NSMutableDictionary dictionary];
+        _bulletWidth = -1;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_markers);
+    free(_brackets);
+}
+
++ (NSAttributedString *)attributedStringFromMarkdownString:(NSString *)markdownString {
+    RichTextEditorMarkdownReader *reader = [[RichTextEditorMarkdownReader alloc] init];
+    [reader appendData:[markdownString dataUsingEncoding:NSUTF8StringEncoding]];
+    return [reader finish];
+}
+
+- (NSAttributedString *)attributedStringFromStream:(NSInputStream *)stream {
+    BOOL shouldOpenStream = (stream.streamStatus == NSStreamStatusNotOpen);
+    if (shouldOpenStream) {
+        [stream open];
+    }
+    uint8_t *buffer = malloc(RTE_MARKDOWN_READ_CHUNK_SIZE);
+    BOOL failed = NO;
+    while (!self.error) {
+        NSInteger length = [stream read:buffer maxLength:RTE_MARKDOWN_READ_CHUNK_SIZE];
+        if (length < 0) {
+            failed = YES;
+            break;
+        }
+        if (length == 0) {
+            break;
+        }
+        @autoreleasepool {
+            [self appendData:[NSData dataWithBytesNoCopy:buffer length:(NSUInteger)length freeWhenDone:NO]];
+        }
+    }
+    free(buffer);
+    if (shouldOpenStream) {
+        [stream close];
+    }
+    NSAttributedString *attributedString = [self finish];
+    return failed ? nil : attributedString;
+}
+
+#pragma mark - Lines -
+
+- (void)appendData:(NSData *)data {
+    const char *bytes = data.bytes;
+    NSUInteger length = data.length;
+    NSUInteger i = 0;
+    while (i < length && !self.error) {
+        const char *newline = memchr(bytes + i, '\n', length - i);
+        if (!newline) {
+            [self.pendingLine appendBytes:bytes + i length:length - i];
+            break;
+        }
+        NSUInteger end = (NSUInteger)(newline - bytes);
+        @autoreleasepool {
+            if (self.pendingLine.length > 0) {
+                [self.pendingLine appendBytes:bytes + i length:end - i];
+                [self processLineBytes:self.pendingLine.bytes length:self.pendingLine.length];
+                [self.pendingLine setLength:0];
+            }
+            else {
+                [self processLineBytes:bytes + i length:end - i];
+            }
+        }
+        i = end + 1;
+    }
+}
+
+- (void)processLineBytes:(const char *)bytes length:(NSUInteger)length {
+    if (_isFirstLine) {
+        _isFirstLine = NO;
+        if (length >= 3 && memcmp(bytes, "\xEF\xBB\xBF", 3) == 0) {
+            bytes += 3;
+            length -= 3;
+        }
+    }
+    if (length > 0 && bytes[length - 1] == '\r') {
+        length--;
+    }
+    NSString *line = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    if (!line) {
+        self.error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadInapplicableStringEncodingError
+                                     userInfo:@{NSLocalizedDescriptionKey: @"The Markdown isn't valid UTF-8."}];
+        return;
+    }
+    [self processLine:line];
+}
+
+- (NSAttributedString *)finish {
+    if (self.pendingLine.length > 0 && !self.error) {
+        [self processLineBytes:self.pendingLine.bytes length:self.pendingLine.length];
+        [self.pendingLine setLength:0];
+    }
+    [self finishBlock];
+    if (self.error) {
+        return nil;
+    }
+    if ([self.output.string hasSuffix:@"\n"]) {
+        [self.output deleteCharactersInRange:NSMakeRange(self.output.length - 1, 1)];
+    }
+    return [self.output copy];
+}
+
+// Skips spaces and tabs from *index, counting columns (tabs go to the next multiple of 4)
+static void RTEMarkdownSkipIndentation(NSString *line, NSUInteger *index, NSUInteger *column) {
+    NSUInteger length = line.length;
+    while (*index < length) {
+        unichar c = [line characterAtIndex:*index];
+        if (c == ' ') {
+            (*column)++;
+        }
+        else if (c == '\t') {
+            *column += 4 - *column % 4;
+        }
+        else {
+            break;
+        }
+        (*index)++;
+    }
+}
+
+- (void)processLine:(NSString *)line {
+    NSUInteger length = line.length;
+    NSUInteger index = 0;
+    NSUInteger column = 0;
+    RTEMarkdownSkipIndentation(line, &index, &column);
+
+    if (_fenceLength > 0) {
+        if (column < 4 && [self isFenceInLine:line atIndex:index character:_fenceCharacter minimumLength:_fenceLength closing:YES]) {
+            _fenceLength = 0;
+        }
+        else {
+            [self appendCodeLine:line];
+        }
+        return;
+    }
+
+    // Block quote markers; columns below are counted from the content after them
+    NSUInteger quoteDepth = 0;
+    while (index < length && column < 4 && [line characterAtIndex:index] == '>') {
+        quoteDepth++;
+        index++;
+        column = 0;
+        if (index < length && [line characterAtIndex:index] == ' ') {
+            index++;
+        }
+        RTEMarkdownSkipIndentation(line, &index, &column);
+    }
+    NSUInteger indent = column;
+
+    BOOL previousLineWasBlank = _previousLineWasBlank;
+    if (index == length) {
+        [self finishBlock];
+        _previousLineWasBlank = YES;
+        return;
+    }
+    _previousLineWasBlank = NO;
+    if (quoteDepth != _blockQuoteDepth) {
+        [self finishBlock];
+        if (quoteDepth < _blockQuoteDepth) {
+            [self.listLevels removeAllObjects];
+        }
+    }
+    _blockQuoteDepth = quoteDepth;
+    NSString *content = [line substringFromIndex:index];
+    unichar first = [content characterAtIndex:0];
+
+    if (indent >= 4 && _blockType == RichTextEditorMarkdownBlockNone && self.listLevels.count == 0) {
+        NSString *padding = [@"" stringByPaddingToLength:indent - 4 withString:@" " startingAtIndex:0];
+        [self appendCodeLine:[padding stringByAppendingString:content]];
+        return;
+    }
+    if (indent < 4 && (first == '`' || first == '~') &&
+        [self isFenceInLine:content atIndex:0 character:first minimumLength:3 closing:NO]) {
+        [self finishBlock];
+        _fenceCharacter = first;
+        _fenceLength = 0;
+        while (_fenceLength < content.length && [content characterAtIndex:_fenceLength] == first) {
+            _fenceLength++;
+        }
+        return;
+    }
+    if (indent < 4 && first == '#' && [self processHeading:content]) {
+        return;
+    }
+    if (indent < 4 && (first == '-' || first == '*' || first == '_' || first == '=') && [self processRule:content]) {
+        return;
+    }
+    if (indent < 4 || self.listLevels.count > 0) {
+        NSUInteger markerLength = [self listMarkerLengthOfString:content];
+        if (markerLength > 0) {
+            [self processListItem:content markerLength:markerLength indent:indent];
+            return;
+        }
+    }
+    if (indent < 4 && first == '<' && [self processAlignedParagraph:content]) {
+        return;
+    }
+
+    if (!previousLineWasBlank && (_blockType == RichTextEditorMarkdownBlockParagraph ||
+                                  _blockType == RichTextEditorMarkdownBlockListItem ||
+                                  _blockType == RichTextEditorMarkdownBlockListParagraph)) {
+        [self appendLineToBlock:content];
+        return;
+    }
+    [self finishBlock];
+    while (self.listLevels.count > 0 && indent < NSMaxRange(self.listLevels.lastObject.rangeValue)) {
+        [self.listLevels removeLastObject];
+    }
+    if (self.listLevels.count > 0) {
+        [self startBlock:RichTextEditorMarkdownBlockListParagraph];
+    }
+    else {
+        [self startBlock:RichTextEditorMarkdownBlockParagraph];
+    }
+    [self appendLineToBlock:content];
+}
+
+- (BOOL)isFenceInLine:(NSString *)line atIndex:(NSUInteger)index character:(unichar)character minimumLength:(NSUInteger)minimumLength closing:(BOOL)isClosing {
+    NSUInteger length = line.length;
+    NSUInteger end = index;
+    while (end < length && [line characterAtIndex:end] == character) {
+        end++;
+    }
+    if (end - index < minimumLength) {
+        return NO;
+    }
+    NSString *rest = [line substringFromIndex:end];
+    if (isClosing) {
+        return [rest stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]].length == 0;
+    }
+    // The info string of a backtick fence can't contain backticks
+    return character != '`' || [rest rangeOfString:@"`"].location == NSNotFound;
+}
+
+- (BOOL)processHeading:(NSString *)content {
+    NSUInteger length = content.length;
+    NSUInteger level = 0;
+    while (level < length && [content characterAtIndex:level] == '#') {
+        level++;
+    }
+    if (level > 6 || (level < length && [content characterAtIndex:level] != ' ' && [content characterAtIndex:level] != '\t')) {
+        return NO;
+    }
+    NSString *text = [[content substringFromIndex:level] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    // Optional closing sequence: " ###"
+    NSUInteger end = text.length;
+    while (end > 0 && [text characterAtIndex:end - 1] == '#') {
+        end--;
+    }
+    if (end == 0 || [text characterAtIndex:end - 1] == ' ' || [text characterAtIndex:end - 1] == '\t') {
+        text = [[text substringToIndex:end] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    }
+    [self finishBlock];
+    [self.listLevels removeAllObjects];
+    [self startBlock:RichTextEditorMarkdownBlockHeading];
+    _blockHeadingLevel = level;
+    [self.blockText appendString:text];
+    [self finishBlock];
+    return YES;
+}
+
+// Thematic breaks (---, ***, ___) and setext heading underlines (===, ---)
+- (BOOL)processRule:(NSString *)content {
+    unichar character = [content characterAtIndex:0];
+    NSUInteger count = 0;
+    BOOL hasInnerSpace = NO;
+    NSUInteger length = [content stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]].length;
+    for (NSUInteger i = 0; i < length; i++) {
+        unichar c = [content characterAtIndex:i];
+        if (c == character) {
+            count++;
+        }
+        else if (c == ' ' || c == '\t') {
+            hasInnerSpace = YES;
+        }
+        else {
+            return NO;
+        }
+    }
+    if ((character == '=' || character == '-') && !hasInnerSpace && _blockType == RichTextEditorMarkdownBlockParagraph) {
+        _blockType = RichTextEditorMarkdownBlockHeading;
+        _blockHeadingLevel = character == '=' ? 1 : 2;
+        [self finishBlock];
+        return YES;
+    }
+    if (character == '=' || count < 3) {
+        return NO;
+    }
+    // The editor has nothing to show a thematic break with; it just ends the block
+    [self finishBlock];
+    [self.listLevels removeAllObjects];
+    return YES;
+}
+
+// Length of "-", "*", "+", "1." or "1)" at the start of content if it is followed by
+// whitespace or the end of the line, otherwise 0
+- (NSUInteger)listMarkerLengthOfString:(NSString *)content {
+    NSUInteger length = content.length;
+    unichar first = [content characterAtIndex:0];
+    NSUInteger markerLength = 0;
+    if (first == '-' || first == '*' || first == '+') {
+        markerLength = 1;
+    }
+    else if (first >= '0' && first <= '9') {
+        NSUInteger digits = 0;
+        while (digits < length && digits < 10 && [content characterAtIndex:digits] >= '0' && [content characterAtIndex:digits] <= '9') {
+            digits++;
+        }
+        if (digits < 10 && digits < length && ([content characterAtIndex:digits] == '.' || [content characterAtIndex:digits] == ')')) {
+            markerLength = digits + 1;
+        }
+    }
+    if (markerLength == 0 || (markerLength < length && [content characterAtIndex:markerLength] != ' ' && [content characterAtIndex:markerLength] != '\t')) {
+        return 0;
+    }
+    return markerLength;
+}
+
+- (void)processListItem:(NSString *)content markerLength:(NSUInteger)markerLength indent:(NSUInteger)indent {
+    [self finishBlock];
+    NSUInteger index = markerLength;
+    NSUInteger column = indent + markerLength;
+    RTEMarkdownSkipIndentation(content, &index, &column);
+    NSUInteger spacing = column - indent - markerLength;
+    if (spacing == 0 || spacing > 4) {
+        spacing = 1;
+    }
+    NSRange level = NSMakeRange(indent, markerLength + spacing);
+    // A marker to the right of the previous item's text starts a nested list; one further left
+    // goes back out to the list it lines up with
+    NSMutableArray<NSValue *> *listLevels = self.listLevels;
+    while (listLevels.count > 0 && indent < listLevels.lastObject.rangeValue.location) {
+        [listLevels removeLastObject];
+    }
+    if (listLevels.count > 0 && indent < NSMaxRange(listLevels.lastObject.rangeValue)) {
+        [listLevels removeLastObject];
+    }
+    [listLevels addObject:[NSValue valueWithRange:level]];
+    [self startBlock:RichTextEditorMarkdownBlockListItem];
+    [self appendLineToBlock:[content substringFromIndex:index]];
+}
+
+// <p align="center">text</p>, as written by RichTextEditorMarkdownWriter
+- (BOOL)processAlignedParagraph:(NSString *)content {
+    NSScanner *scanner = [NSScanner scannerWithString:content];
+    scanner.caseSensitive = NO;
+    scanner.charactersToBeSkipped = nil;
+    NSString *alignment = nil;
+    if (![scanner scanString:@"<p align=\"" intoString:nil] || ![scanner scanUpToString:@"\"" intoString:&alignment] ||
+        ![scanner scanString:@"\">" intoString:nil]) {
+        return NO;
+    }
+    NSDictionary *alignments = @{@"left": @(NSLeftTextAlignment), @"center": @(NSCenterTextAlignment),
+                                 @"right": @(NSRightTextAlignment), @"justify": @(NSJustifiedTextAlignment)};
+    NSNumber *value = alignments[alignment.lowercaseString];
+    if (!value) {
+        return NO;
+    }
+    NSString *text = [content substringFromIndex:scanner.scanLocation];
+    BOOL isClosed = [text.lowercaseString hasSuffix:@"</p>"];
+    if (isClosed) {
+        text = [text substringToIndex:text.length - 4];
+    }
+    [self finishBlock];
+    [self.listLevels removeAllObjects];
+    [self startBlock:RichTextEditorMarkdownBlockParagraph];
+    _blockAlignment = (NSTextAlignment)value.integerValue;
+    [self appendLineToBlock:text];
+    if (isClosed) {
+        [self finishBlock];
+    }
+    return YES;
+}
+
+- (void)appendCodeLine:(NSString *)line {
+    [self finishBlock];
+    NSUInteger start = self.output.length;
+    NSDictionary *attributes = [self attributesForStyle:RichTextEditorMarkdownStyleCode headingLevel:0 link:nil];
+    [self.output appendAttributedString:[[NSAttributedString alloc] initWithString:[line stringByAppendingString:@"\n"] attributes:attributes]];
+    [self.output addAttribute:NSParagraphStyleAttributeName
+                        value:[self paragraphStyleForBlock:RichTextEditorMarkdownBlockParagraph level:0 alignment:NSNaturalTextAlignment]
+                        range:NSMakeRange(start, self.output.length - start)];
+}
+
+#pragma mark - Blocks -
+
+- (void)startBlock:(RichTextEditorMarkdownBlockType)type {
+    _blockType = type;
+    _blockLevel = self.listLevels.count;
+    _blockHeadingLevel = 0;
+    _blockAlignment = NSNaturalTextAlignment;
+    _blockEndsWithHardBreak = NO;
+    [self.blockText setString:@""];
+}
+
+// Adds a line to the block: joined with a space, or a paragraph break after a hard line break
+// (two or more spaces or a backslash at the end of the previous line)
+- (void)appendLineToBlock:(NSString *)line {
+    NSUInteger end = line.length;
+    NSUInteger trailingSpaces = 0;
+    while (end > 0 && ([line characterAtIndex:end - 1] == ' ' || [line characterAtIndex:end - 1] == '\t')) {
+        end--;
+        trailingSpaces++;
+    }
+    BOOL isHardBreak = trailingSpaces >= 2;
+    if (!isHardBreak && end > 0 && [line characterAtIndex:end - 1] == '\\' && (end < 2 || [line characterAtIndex:end - 2] != '\\')) {
+        end--;
+        isHardBreak = YES;
+    }
+    NSUInteger start = 0;
+    while (start < end && ([line characterAtIndex:start] == ' ' || [line characterAtIndex:start] == '\t')) {
+        start++;
+    }
+    if (self.blockText.length > 0 || _blockEndsWithHardBreak) {
+        [self.blockText appendString:_blockEndsWithHardBreak ? @"\n" : @" "];
+    }
+    [self.blockText appendString:[line substringWithRange:NSMakeRange(start, end - start)]];
+    _blockEndsWithHardBreak = isHardBreak;
+}
+
+- (void)finishBlock {
+    RichTextEditorMarkdownBlockType type = _blockType;
+    if (type == RichTextEditorMarkdownBlockNone) {
+        return;
+    }
+    _blockType = RichTextEditorMarkdownBlockNone;
+    NSMutableAttributedString *output = self.output;
+    NSUInteger start = output.length;
+    NSDictionary *attributes = [self attributesForStyle:0 headingLevel:_blockHeadingLevel link:nil];
+    if (type == RichTextEditorMarkdownBlockListItem && self.bulletString.length > 0) {
+        [output appendAttributedString:[[NSAttributedString alloc] initWithString:self.bulletString attributes:attributes]];
+    }
+    [self appendInlinesOfString:self.blockText headingLevel:_blockHeadingLevel];
+    [output appendAttributedString:[[NSAttributedString alloc] initWithString:@"\n" attributes:attributes]];
+    NSRange range = NSMakeRange(start, output.length - start);
+    [output addAttribute:NSParagraphStyleAttributeName value:[self paragraphStyleForBlock:type level:_blockLevel alignment:_blockAlignment] range:range];
+    if (type == RichTextEditorMarkdownBlockListItem) {
+        // Paragraphs after a hard line break carry on the item's text without a bullet
+        NSRange lineBreak = [output.string rangeOfString:@"\n" options:NSLiteralSearch range:NSMakeRange(start, range.length - 1)];
+        if (lineBreak.location != NSNotFound) {
+            NSParagraphStyle *continuation = [self paragraphStyleForBlock:RichTextEditorMarkdownBlockListParagraph level:_blockLevel alignment:_blockAlignment];
+            [output addAttribute:NSParagraphStyleAttributeName value:continuation range:NSMakeRange(NSMaxRange(lineBreak), NSMaxRange(range) - NSMaxRange(lineBreak))];
+        }
+    }
+    [self.blockText setString:@""];
+}
+
+#pragma mark - Inlines -
+
+- (NSInteger)addMarker:(RichTextEditorMarkdownMarkerKind)kind {
+    if (_markerCount == _markerCapacity) {
+        _markerCapacity = MAX(_markerCapacity * 2, (NSUInteger)64);
+        _markers = realloc(_markers, _markerCapacity * sizeof(RTEMarkdownMarker));
+    }
+    RTEMarkdownMarker *marker = &_markers[_markerCount];
+    memset(marker, 0, sizeof(RTEMarkdownMarker));
+    marker->kind = kind;
+    marker->position = _textLength;
+    marker->previous = -1;
+    marker->next = -1;
+    marker->delimiterBottom = -1;
+    return (NSInteger)_markerCount++;
+}
+
+- (void)removeDelimiter:(NSInteger)index {
+    RTEMarkdownMarker *marker = &_markers[index];
+    if (marker->previous != -1) {
+        _markers[marker->previous].next = marker->next;
+    }
+    if (marker->next != -1) {
+        _markers[marker->next].previous = marker->previous;
+    }
+    else {
+        _lastDelimiter = marker->previous;
+    }
+}
+
+// Parses the inline content of a block and appends it to the output
+- (void)appendInlinesOfString:(NSString *)string headingLevel:(NSUInteger)headingLevel {
+    NSUInteger length = string.length;
+    if (length == 0) {
+        return;
+    }
+    unichar *source = malloc(length * sizeof(unichar));
+    [string getCharacters:source range:NSMakeRange(0, length)];
+    // Decoded text is never longer than its source
+    _text = malloc(length * sizeof(unichar));
+    _textLength = 0;
+    _markerCount = 0;
+    _lastDelimiter = -1;
+    _bracketCount = 0;
+    _inactiveBracketCount = 0;
+    [self.links removeAllObjects];
+    NSMutableIndexSet *unmatchedCodeSpanLengths = [NSMutableIndexSet indexSet];
+
+    NSUInteger i = 0;
+    while (i < length) {
+        unichar c = source[i];
+        switch (c) {
+            case '\\':
+                if (i + 1 < length && RTEMarkdownIsASCIIPunctuation(source[i + 1])) {
+                    _text[_textLength++] = source[i + 1];
+                    i += 2;
+                }
+                else {
+                    _text[_textLength++] = c;
+                    i++;
+                }
+                break;
+            case '*':
+            case '_':
+            case '~':
+                i = [self scanDelimiterRunInCharacters:source length:length atIndex:i];
+                break;
+            case '`':
+                i = [self scanCodeSpanInCharacters:source length:length atIndex:i unmatchedLengths:unmatchedCodeSpanLengths];
+                break;
+            case '[': {
+                NSInteger bracket = [self addMarker:RichTextEditorMarkdownMarkerBracket];
+                _markers[bracket].delimiterBottom = _lastDelimiter;
+                if (_bracketCount == _bracketCapacity) {
+                    _bracketCapacity = MAX(_bracketCapacity * 2, (NSUInteger)16);
+                    _brackets = realloc(_brackets, _bracketCapacity * sizeof(NSInteger));
+                }
+                _brackets[_bracketCount++] = bracket;
+                i++;
+                break;
+            }
+            case ']':
+                i = [self scanLinkInCharacters:source length:length atIndex:i];
+                break;
+            case '<':
+                i = [self scanTagInCharacters:source length:length atIndex:i];
+                break;
+            case '&':
+                i = [self scanEntityInCharacters:source length:length atIndex:i];
+                break;
+            default:
+                _text[_textLength++] = c;
+                i++;
+                break;
+        }
+    }
+    [self processEmphasisAbove:-1];
+    free(source);
+    [self appendDecodedTextWithHeadingLevel:headingLevel];
+    free(_text);
+    _text = NULL;
+}
+
+- (NSUInteger)scanDelimiterRunInCharacters:(const unichar *)source length:(NSUInteger)length atIndex:(NSUInteger)index {
+    unichar c = source[index];
+    NSUInteger end = index;
+    while (end < length && source[end] == c) {
+        end++;
+    }
+    NSUInteger count = end - index;
+    if (c == '~' && count > 2) {
+        for (NSUInteger i = 0; i < count; i++) {
+            _text[_textLength++] = c;
+        }
+        return end;
+    }
+    unichar before = index > 0 ? source[index - 1] : ' ';
+    unichar after = end < length ? source[end] : ' ';
+    BOOL isSpaceBefore = RTEMarkdownIsWhitespace(before);
+    BOOL isSpaceAfter = RTEMarkdownIsWhitespace(after);
+    BOOL isPunctuationBefore = RTEMarkdownIsPunctuation(before);
+    BOOL isPunctuationAfter = RTEMarkdownIsPunctuation(after);
+    BOOL isLeftFlanking = !isSpaceAfter && (!isPunctuationAfter || isSpaceBefore || isPunctuationBefore);
+    BOOL isRightFlanking = !isSpaceBefore && (!isPunctuationBefore || isSpaceAfter || isPunctuationAfter);
+
+    NSInteger delimiter = [self addMarker:RichTextEditorMarkdownMarkerDelimiter];
+    RTEMarkdownMarker *marker = &_markers[delimiter];
+    marker->character = c;
+    marker->count = count;
+    marker->originalCount = count;
+    if (c == '_') {
+        // No emphasis inside words with underscores (snake_case_names)
+        marker->canOpen = isLeftFlanking && (!isRightFlanking || isPunctuationBefore);
+        marker->canClose = isRightFlanking && (!isLeftFlanking || isPunctuationAfter);
+    }
+    else {
+        marker->canOpen = isLeftFlanking;
+        marker->canClose = isRightFlanking;
+    }
+    marker->previous = _lastDelimiter;
+    if (_lastDelimiter != -1) {
+        _markers[_lastDelimiter].next = delimiter;
+    }
+    _lastDelimiter = delimiter;
+    return end;
+}
+
+- (NSUInteger)scanCodeSpanInCharacters:(const unichar *)source length:(NSUInteger)length atIndex:(NSUInteger)index unmatchedLengths:(NSMutableIndexSet *)unmatchedLengths {
+    NSUInteger end = index;
+    while (end < length && source[end] == '`') {
+        end++;
+    }
+    NSUInteger count = end - index;
+    NSUInteger closing = NSNotFound;
+    if (![unmatchedLengths containsIndex:count]) {
+        NSUInteger i = end;
+        while (i < length) {
+            if (source[i] != '`') {
+                i++;
+                continue;
+            }
+            NSUInteger runEnd = i;
+            while (runEnd < length && source[runEnd] == '`') {
+                runEnd++;
+            }
+            if (runEnd - i == count) {
+                closing = i;
+                break;
+            }
+            i = runEnd;
+        }
+        if (closing == NSNotFound) {
+            // Nothing later in the block can close a run of this length either
+            [unmatchedLengths addIndex:count];
+        }
+    }
+    if (closing == NSNotFound) {
+        for (NSUInteger i = 0; i < count; i++) {
+            _text[_textLength++] = '`';
+        }
+        return end;
+    }
+    NSUInteger contentStart = end;
+    NSUInteger contentEnd = closing;
+    BOOL isAllSpace = YES;
+    for (NSUInteger i = contentStart; i < contentEnd && isAllSpace; i++) {
+        isAllSpace = source[i] == ' ' || source[i] == '\n';
+    }
+    if (!isAllSpace && contentEnd - contentStart >= 2 &&
+        (source[contentStart] == ' ' || source[contentStart] == '\n') && (source[contentEnd - 1] == ' ' || source[contentEnd - 1] == '\n')) {
+        contentStart++;
+        contentEnd--;
+    }
+    [self addMarker:RichTextEditorMarkdownMarkerCodeOpen];
+    for (NSUInteger i = contentStart; i < contentEnd; i++) {
+        _text[_textLength++] = source[i] == '\n' ? ' ' : source[i];
+    }
+    [self addMarker:RichTextEditorMarkdownMarkerCodeClose];
+    return closing + count;
+}
+
+// At a ]: if it closes a [ and is followed by (destination), the two make a link
+- (NSUInteger)scanLinkInCharacters:(const unichar *)source length:(NSUInteger)length atIndex:(NSUInteger)index {
+    if (_bracketCount == 0 || _bracketCount <= _inactiveBracketCount) {
+        if (_bracketCount > 0) {
+            _bracketCount--;
+            _inactiveBracketCount = MIN(_inactiveBracketCount, _bracketCount);
+        }
+        _text[_textLength++] = ']';
+        return index + 1;
+    }
+    NSInteger opener = _brackets[--_bracketCount];
+    NSString *destination = nil;
+    NSUInteger end = [self scanLinkDestinationInCharacters:source length:length atIndex:index + 1 destination:&destination];
+    if (end == NSNotFound) {
+        _text[_textLength++] = ']';
+        _inactiveBracketCount = MIN(_inactiveBracketCount, _bracketCount);
+        return index + 1;
+    }
+    [self processEmphasisAbove:_markers[opener].delimiterBottom];
+    _markers[opener].kind = RichTextEditorMarkdownMarkerLinkOpen;
+    _markers[opener].link = self.links.count;
+    [self.links addObject:destination];
+    [self addMarker:RichTextEditorMarkdownMarkerLinkClose];
+    // Links can't contain links
+    _inactiveBracketCount = _bracketCount;
+    return end;
+}
+
+// Parses "(destination)" or "(destination "title")" at index; returns the index after it or NSNotFound
+- (NSUInteger)scanLinkDestinationInCharacters:(const unichar *)source length:(NSUInteger)length atIndex:(NSUInteger)index destination:(NSString **)destination {
+    if (index >= length || source[index] != '(') {
+        return NSNotFound;
+    }
+    NSUInteger i = index + 1;
+    while (i < length && RTEMarkdownIsWhitespace(source[i])) {
+        i++;
+    }
+    NSMutableString *url = [NSMutableString string];
+    if (i < length && source[i] == '<') {
+        i++;
+        while (i < length && source[i] != '>' && source[i] != '\n') {
+            if (source[i] == '\\' && i + 1 < length && RTEMarkdownIsASCIIPunctuation(source[i + 1])) {
+                i++;
+            }
+            [url appendFormat:@"%C", source[i]];
+            i++;
+        }
+        if (i >= length || source[i] != '>') {
+            return NSNotFound;
+        }
+        i++;
+    }
+    else {
+        NSInteger depth = 0;
+        while (i < length && !RTEMarkdownIsWhitespace(source[i])) {
+            unichar c = source[i];
+            if (c == '\\' && i + 1 < length && RTEMarkdownIsASCIIPunctuation(source[i + 1])) {
+                i++;
+                c = source[i];
+            }
+            else if (c == '(') {
+                depth++;
+            }
+            else if (c == ')') {
+                if (depth == 0) {
+                    break;
+                }
+                depth--;
+            }
+            [url appendFormat:@"%C", c];
+            i++;
+        }
+    }
+    while (i < length && RTEMarkdownIsWhitespace(source[i])) {
+        i++;
+    }
+    if (i < length && (source[i] == '"' || source[i] == '\'' || source[i] == '(')) {
+        // The title isn't kept
+        unichar close = source[i] == '(' ? ')' : source[i];
+        i++;
+        while (i < length && source[i] != close) {
+            i += (source[i] == '\\' && i + 1 < length) ? 2 : 1;
+        }
+        if (i >= length) {
+            return NSNotFound;
+        }
+        i++;
+        while (i < length && RTEMarkdownIsWhitespace(source[i])) {
+            i++;
+        }
+    }
+    if (i >= length || source[i] != ')') {
+        return NSNotFound;
+    }
+    *destination = url;
+    return i + 1;
+}
+
+// <u>, </u>, <br> and <scheme:autolinks>; any other < is text
+- (NSUInteger)scanTagInCharacters:(const unichar *)source length:(NSUInteger)length atIndex:(NSUInteger)index {
+    if (RTEMarkdownHasTag(source, length, index, "<u>")) {
+        [self addMarker:RichTextEditorMarkdownMarkerUnderlineOpen];
+        return index + 3;
+    }
+    if (RTEMarkdownHasTag(source, length, index, "</u>")) {
+        [self addMarker:RichTextEditorMarkdownMarkerUnderlineClose];
+        return index + 4;
+    }
+    const char *lineBreaks[] = {"<br>", "<br/>", "<br />"};
+    for (NSUInteger i = 0; i < sizeof(lineBreaks) / sizeof(lineBreaks[0]); i++) {
+        if (RTEMarkdownHasTag(source, length, index, lineBreaks[i])) {
+            _text[_textLength++] = '\n';
+            return index + strlen(lineBreaks[i]);
+        }
+    }
+    // Autolink: a scheme of 2-32 characters, a colon, and no spaces or < before the >
+    NSUInteger i = index + 1;
+    while (i < length && i - index <= 33 && ((source[i] >= 'a' && source[i] <= 'z') || (source[i] >= 'A' && source[i] <= 'Z') ||
+                                             (i > index + 1 && ((source[i] >= '0' && source[i] <= '9') || source[i] == '+' || source[i] == '.' || source[i] == '-')))) {
+        i++;
+    }
+    if (i - index - 1 >= 2 && i - index - 1 <= 32 && i < length && source[i] == ':') {
+        NSUInteger end = i;
+        while (end < length && source[end] != '>' && source[end] != '<' && !RTEMarkdownIsWhitespace(source[end])) {
+            end++;
+        }
+        if (end < length && source[end] == '>') {
+            NSInteger open = [self addMarker:RichTextEditorMarkdownMarkerLinkOpen];
+            _markers[open].link = self.links.count;
+            [self.links addObject:[NSString stringWithCharacters:source + index + 1 length:end - index - 1]];
+            for (NSUInteger j = index + 1; j < end; j++) {
+                _text[_textLength++] = source[j];
+            }
+            [self addMarker:RichTextEditorMarkdownMarkerLinkClose];
+            return end + 1;
+        }
+    }
+    _text[_textLength++] = '<';
+    return index + 1;
+}
+
+- (NSUInteger)scanEntityInCharacters:(const unichar *)source length:(NSUInteger)length atIndex:(NSUInteger)index {
+    NSUInteger end = index + 1;
+    while (end < length && end - index < 12 && source[end] != ';' && !RTEMarkdownIsWhitespace(source[end])) {
+        end++;
+    }
+    if (end < length && source[end] == ';' && end > index + 1) {
+        NSString *name = [NSString stringWithCharacters:source + index + 1 length:end - index - 1];
+        uint32_t codePoint = 0;
+        if ([name hasPrefix:@"#x"] || [name hasPrefix:@"#X"]) {
+            unsigned int value = 0;
+            if (name.length > 2 && name.length <= 8 && [[NSScanner scannerWithString:[name substringFromIndex:2]] scanHexInt:&value]) {
+                codePoint = value;
+            }
+        }
+        else if ([name hasPrefix:@"#"]) {
+            NSInteger value = [name substringFromIndex:1].integerValue;
+            if (name.length > 1 && name.length <= 8 && value > 0) {
+                codePoint = (uint32_t)value;
+            }
+        }
+        else {
+            static NSDictionary *entities;
+            static dispatch_once_t onceToken;
+            dispatch_once(&onceToken, ^{
+                entities = @{@"amp": @'&', @"lt": @'<', @"gt": @'>', @"quot": @'"', @"apos": @'\'',
+                             @"nbsp": @0x00A0, @"copy": @0x00A9, @"reg": @0x00AE, @"hellip": @0x2026,
+                             @"mdash": @0x2014, @"ndash": @0x2013};
+            });
+            codePoint = [entities[name] unsignedIntValue];
+        }
+        if (codePoint > 0) {
+            if (codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+                codePoint = 0xFFFD;
+            }
+            if (codePoint > 0xFFFF) {
+                codePoint -= 0x10000;
+                _text[_textLength++] = (unichar)(0xD800 + (codePoint >> 10));
+                _text[_textLength++] = (unichar)(0xDC00 + (codePoint & 0x3FF));
+            }
+            else {
+                _text[_textLength++] = (unichar)codePoint;
+            }
+            return end + 1;
+        }
+    }
+    _text[_textLength++] = '&';
+    return index + 1;
+}
+
+// Matches emphasis delimiters above stackBottom, as in the CommonMark spec's "process emphasis",
+// and takes them out of the delimiter list
+- (void)processEmphasisAbove:(NSInteger)stackBottom {
+    NSInteger closer = -1;
+    for (NSInteger delimiter = _lastDelimiter; delimiter != -1 && delimiter > stackBottom; delimiter = _markers[delimiter].previous) {
+        closer = delimiter;
+    }
+    // Where the last unsuccessful search for an opener stopped, per character, whether the
+    // closer can open, and length modulo 3, so a search never goes over the same delimiters twice
+    NSInteger openersBottom[3][2][3];
+    for (NSUInteger c = 0; c < 3; c++) {
+        for (NSUInteger o = 0; o < 2; o++) {
+            for (NSUInteger m = 0; m < 3; m++) {
+                openersBottom[c][o][m] = stackBottom;
+            }
+        }
+    }
+    while (closer != -1) {
+        RTEMarkdownMarker *closing = &_markers[closer];
+        if (!closing->canClose) {
+            closer = closing->next;
+            continue;
+        }
+        NSUInteger characterIndex = closing->character == '*' ? 0 : (closing->character == '_' ? 1 : 2);
+        NSInteger *bottom = &openersBottom[characterIndex][closing->canOpen ? 1 : 0][closing->originalCount % 3];
+        NSInteger opener = closing->previous;
+        BOOL found = NO;
+        while (opener != -1 && opener > stackBottom && opener > *bottom) {
+            RTEMarkdownMarker *opening = &_markers[opener];
+            if (opening->canOpen && opening->character == closing->character) {
+                BOOL isOddMatch = closing->character != '~' && (opening->canClose || closing->canOpen) &&
+                    (opening->originalCount + closing->originalCount) % 3 == 0 &&
+                    !(opening->originalCount % 3 == 0 && closing->originalCount % 3 == 0);
+                BOOL isLengthMismatch = closing->character == '~' && opening->count != closing->count;
+                if (!isOddMatch && !isLengthMismatch) {
+                    found = YES;
+                    break;
+                }
+            }
+            opener = opening->previous;
+        }
+        NSInteger next = closing->next;
+        if (!found) {
+            *bottom = closing->previous;
+            if (!closing->canOpen) {
+                [self removeDelimiter:closer];
+            }
+            closer = next;
+            continue;
+        }
+        RTEMarkdownMarker *opening = &_markers[opener];
+        NSUInteger used;
+        NSUInteger emphasis;
+        if (closing->character == '~') {
+            used = closing->count;
+            emphasis = RTEMarkdownEmphasisStrikeThrough;
+        }
+        else {
+            used = (opening->count >= 2 && closing->count >= 2) ? 2 : 1;
+            emphasis = used == 2 ? RTEMarkdownEmphasisBold : RTEMarkdownEmphasisItalic;
+        }
+        opening->opens[emphasis]++;
+        closing->closes[emphasis]++;
+        opening->count -= used;
+        closing->count -= used;
+        // Delimiters between the two can't match any more
+        opening->next = closer;
+        closing->previous = opener;
+        if (opening->count == 0) {
+            [self removeDelimiter:opener];
+        }
+        if (closing->count == 0) {
+            [self removeDelimiter:closer];
+            closer = next;
+        }
+    }
+    while (_lastDelimiter != -1 && _lastDelimiter > stackBottom) {
+        [self removeDelimiter:_lastDelimiter];
+    }
+}
+
+- (void)appendDecodedTextWithHeadingLevel:(NSUInteger)headingLevel {
+    NSString *text = [[NSString alloc] initWithCharacters:_text length:_textLength];
+    NSInteger emphasis[RTEMarkdownEmphasisCount] = {0, 0, 0};
+    NSInteger underline = 0;
+    NSInteger code = 0;
+    NSString *link = nil;
+    NSUInteger cursor = 0;
+    for (NSUInteger m = 0; m <= _markerCount; m++) {
+        NSUInteger position = m < _markerCount ? _markers[m].position : _textLength;
+        RichTextEditorMarkdownStyle style = RTEMarkdownStyle(emphasis, underline, code);
+        if (position > cursor) {
+            [self.output appendAttributedString:[[NSAttributedString alloc] initWithString:[text substringWithRange:NSMakeRange(cursor, position - cursor)]
+                                                                                attributes:[self attributesForStyle:style headingLevel:headingLevel link:link]]];
+            cursor = position;
+        }
+        if (m == _markerCount) {
+            break;
+        }
+        RTEMarkdownMarker *marker = &_markers[m];
+        switch (marker->kind) {
+            case RichTextEditorMarkdownMarkerDelimiter: {
+                // Emphasis it ends, then its unused characters as text, then emphasis it starts
+                for (NSUInteger e = 0; e < RTEMarkdownEmphasisCount; e++) {
+                    emphasis[e] -= marker->closes[e];
+                }
+                if (marker->count > 0) {
+                    RichTextEditorMarkdownStyle textStyle = RTEMarkdownStyle(emphasis, underline, code);
+                    NSString *literal = [@"" stringByPaddingToLength:marker->count withString:[NSString stringWithCharacters:&marker->character length:1] startingAtIndex:0];
+                    [self.output appendAttributedString:[[NSAttributedString alloc] initWithString:literal
+                                                                                        attributes:[self attributesForStyle:textStyle headingLevel:headingLevel link:link]]];
+                }
+                for (NSUInteger e = 0; e < RTEMarkdownEmphasisCount; e++) {
+                    emphasis[e] += marker->opens[e];
+                }
+                break;
+            }
+            case RichTextEditorMarkdownMarkerBracket:
+                [self.output appendAttributedString:[[NSAttributedString alloc] initWithString:@"["
+                                                                                    attributes:[self attributesForStyle:style headingLevel:headingLevel link:link]]];
+                break;
+            case RichTextEditorMarkdownMarkerLinkOpen:
+                link = self.links[marker->link];
+                break;
+            case RichTextEditorMarkdownMarkerLinkClose:
+                link = nil;
+                break;
+            case RichTextEditorMarkdownMarkerUnderlineOpen:
+                underline++;
+                break;
+            case RichTextEditorMarkdownMarkerUnderlineClose:
+                underline = MAX(underline - 1, (NSInteger)0);
+                break;
+            case RichTextEditorMarkdownMarkerCodeOpen:
+                code++;
+                break;
+            case RichTextEditorMarkdownMarkerCodeClose:
+                code--;
+                break;
+        }
+    }
+}
+
+#pragma mark - Attributes -
+
+- (NSDictionary *)attributesForStyle:(RichTextEditorMarkdownStyle)style headingLevel:(NSUInteger)headingLevel link:(NSString *)link {
+    id key = link ? [NSString stringWithFormat:@"%lu %lu %@", (unsigned long)style, (unsigned long)headingLevel, link] : @(style | headingLevel << 8);
+    NSDictionary *attributes = self.attributes[key];
+    if (attributes) {
+        return attributes;
+    }
+    NSMutableDictionary *newAttributes = [NSMutableDictionary dictionary];
+    NSFont *font = [self fontForStyle:style headingLevel:headingLevel];
+    if (font) {
+        newAttributes[NSFontAttributeName] = font;
+    }
+    if (style & RichTextEditorMarkdownStyleUnderline) {
+        newAttributes[NSUnderlineStyleAttributeName] = @(NSUnderlineStyleSingle);
+    }
+    if (style & RichTextEditorMarkdownStyleStrikeThrough) {
+        newAttributes[NSStrikethroughStyleAttributeName] = @(NSUnderlineStyleSingle);
+    }
+    if (link) {
+        newAttributes[NSLinkAttributeName] = [NSURL URLWithString:link] ?: link;
+    }
+    attributes = [newAttributes copy];
+    self.attributes[key] = attributes;
+    return attributes;
+}
+
+// Fonts are made through Core Text, which (unlike NSFontManager) is safe to use on any thread.
+- (NSFont *)fontForStyle:(RichTextEditorMarkdownStyle)style headingLevel:(NSUInteger)headingLevel {
+    BOOL isBold = (style & RichTextEditorMarkdownStyleBold) || headingLevel > 0;
+    BOOL isItalic = (style & RichTextEditorMarkdownStyleItalic) != 0;
+    BOOL isCode = (style & RichTextEditorMarkdownStyleCode) != 0;
+    NSNumber *key = @((isBold ? 1 : 0) | (isItalic ? 2 : 0) | (isCode ? 4 : 0) | headingLevel << 4);
+    NSFont *font = self.fonts[key];
+    if (font) {
+        return font;
+    }
+    static const CGFloat headingScales[] = {1.0, 2.0, 1.5, 1.25, 1.1, 1.0, 1.0};
+    CGFloat size = self.font.pointSize * headingScales[MIN(headingLevel, (NSUInteger)6)];
+    CTFontRef ctFont = isCode ? CTFontCreateUIFontForLanguage(kCTFontUIFontUserFixedPitch, size, NULL)
+                              : CTFontCreateCopyWithAttributes((__bridge CTFontRef)self.font, size, NULL, NULL);
+    if (!ctFont) {
+        return self.font;
+    }
+    CTFontSymbolicTraits traits = (isBold ? kCTFontBoldTrait : 0) | (isItalic ? kCTFontItalicTrait : 0);
+    CTFontSymbolicTraits currentTraits = CTFontGetSymbolicTraits(ctFont) & (kCTFontBoldTrait | kCTFontItalicTrait);
+    if (traits != currentTraits) {
+        CTFontRef styledFont = CTFontCreateCopyWithSymbolicTraits(ctFont, size, NULL, traits, kCTFontBoldTrait | kCTFontItalicTrait);
+        if (styledFont) {
+            CFRelease(ctFont);
+            ctFont = styledFont;
+        }
+    }
+    font = (__bridge_transfer NSFont *)ctFont;
+    self.fonts[key] = font;
+    return font;
+}
+
+- (NSParagraphStyle *)paragraphStyleForBlock:(RichTextEditorMarkdownBlockType)type level:(NSUInteger)level alignment:(NSTextAlignment)alignment {
+    if (type != RichTextEditorMarkdownBlockListItem && type != RichTextEditorMarkdownBlockListParagraph) {
+        level = 0;
+    }
+    NSString *key = [NSString stringWithFormat:@"%ld %lu %lu %ld", (long)type, (unsigned long)level, (unsigned long)_blockQuoteDepth, (long)alignment];
+    NSParagraphStyle *paragraphStyle = self.paragraphStyles[key];
+    if (paragraphStyle) {
+        return paragraphStyle;
+    }
+    NSMutableParagraphStyle *newStyle = [[NSMutableParagraphStyle alloc] init];
+    newStyle.alignment = alignment;
+    CGFloat quoteIndentation = self.bulletIndentation * _blockQuoteDepth;
+    if (type == RichTextEditorMarkdownBlockListItem) {
+        newStyle.firstLineHeadIndent = quoteIndentation + self.bulletIndentation * MAX(level, (NSUInteger)1);
+        newStyle.headIndent = newStyle.firstLineHeadIndent + [self widthOfBullet];
+    }
+    else if (type == RichTextEditorMarkdownBlockListParagraph) {
+        newStyle.headIndent = quoteIndentation + self.bulletIndentation * MAX(level, (NSUInteger)1) + [self widthOfBullet];
+        newStyle.firstLineHeadIndent = newStyle.headIndent;
+    }
+    else {
+        newStyle.headIndent = quoteIndentation;
+        newStyle.firstLineHeadIndent = quoteIndentation;
+    }
+    paragraphStyle = [newStyle copy];
+    self.paragraphStyles[key] = paragraphStyle;
+    return paragraphStyle;
+}
+
+- (CGFloat)widthOfBullet {
+    if (self.bulletWidth < 0) {
+        NSAttributedString *bullet = [[NSAttributedString alloc] initWithString:self.bulletString ?: @""
+                                                                     attributes:[self attributesForStyle:0 headingLevel:0 link:nil]];
+        CTLineRef line = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)bullet);
+        self.bulletWidth = (CGFloat)CTLineGetTypographicBounds(line, NULL, NULL, NULL);
+        CFRelease(line);
+    }
+    return self.bulletWidth;
+}
+
+@end
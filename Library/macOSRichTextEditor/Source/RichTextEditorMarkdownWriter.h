@@ -0,0 +1,48 @@
+//
+//  RichTextEditorMarkdownWriter.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+/// Writes an NSAttributedString as Markdown in a single pass over the text, through a fixed
+/// size buffer, so large documents can be exported straight to a file.
+///
+/// Bold and italic fonts become **strong** and *emphasis*, strike through ~~strike~~, underline
+/// <u>underline</u> and NSLinkAttributeName [links](url). Paragraphs starting with bulletString
+/// become "- " list items, nested by their first line head indent in steps of bulletIndentation.
+/// Centered, right aligned and justified paragraphs are wrapped in <p align="...">, which
+/// RichTextEditorMarkdownReader reads back. Fonts, sizes, colors and other indentation can't
+/// be expressed and are left out, as are empty paragraphs. Markdown characters in the text are
+/// escaped with backslashes.
+@interface RichTextEditorMarkdownWriter : NSObject
+
+@property (nonatomic, readonly) NSAttributedString *attributedString;
+
+/// Prefix of list item paragraphs. Defaults to the editor's bullet string.
+@property (nonatomic, copy) NSString *bulletString;
+
+/// First line head indent of a list item per level of nesting. Defaults to 15.
+@property (nonatomic) CGFloat bulletIndentation;
+
+/// Number of bytes collected before they are written out. Defaults to 64 KB.
+@property (nonatomic) NSUInteger bufferSize;
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)attributedString;
+
+/// Writes the Markdown as UTF-8 at the file handle's current offset. The handle is left open.
+- (BOOL)writeToFileHandle:(NSFileHandle *)fileHandle error:(NSError **)error;
+
+/// Writes the Markdown as UTF-8. If the stream has not been opened yet, it is opened and
+/// closed again by the writer; otherwise it is left open.
+- (BOOL)writeToStream:(NSOutputStream *)stream error:(NSError **)error;
+
+/// Writes the Markdown as UTF-8 to the given file URL, replacing any existing file.
+- (BOOL)writeToURL:(NSURL *)url error:(NSError **)error;
+
+/// Returns the Markdown as a string.
+- (NSString *)markdownString;
+
+@end
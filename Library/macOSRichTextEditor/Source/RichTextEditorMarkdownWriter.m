@@ -0,0 +1,478 @@
+//
+//  RichTextEditorMarkdownWriter.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorMarkdownWriter.h"
+#import "NSFont+RichTextEditor.h"
+#include <unistd.h>
+
+#define RTE_MARKDOWN_DEFAULT_BUFFER_SIZE (64 * 1024)
+#define RTE_MARKDOWN_CHARACTER_CHUNK 1024
+
+// Markup of the inline styles, outermost first. A link is "[" plus its URL.
+static NSString * const RTEMarkdownStrikeThrough = @"~~";
+static NSString * const RTEMarkdownUnderline = @"<u>";
+static NSString * const RTEMarkdownItalic = @"*";
+static NSString * const RTEMarkdownBold = @"**";
+
+static BOOL RTEMarkdownWriterIsWhitespace(unichar c) {
+    return c == ' ' || c == '\t' || c == 0x00A0;
+}
+
+@interface RichTextEditorMarkdownWriter () {
+    uint8_t *_buffer;
+    NSUInteger _bufferLength;
+    NSUInteger _bufferCapacity;
+    NSOutputStream *_stream;
+    int _fileDescriptor;
+    NSError *_writeError;
+    BOOL _hasWrittenParagraph;
+    NSUInteger _previousListLevel; // 0 if the previous paragraph wasn't a list item
+    NSUInteger _escapedIndex;      // block syntax at the start of a paragraph to escape
+    NSRange _pendingWhitespace;    // held back until it is known whether styles end before it
+}
+
+@property NSMutableArray<NSString *> *openStyles;
+@property NSMapTable *runStyles; // attributes (by pointer) -> NSArray of styles
+
+@end
+
+@implementation RichTextEditorMarkdownWriter
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)attributedString {
+    if (self = [super init]) {
+        _attributedString = [attributedString copy];
+        _bulletString = @"\u2022\u00A0";
+        _bulletIndentation = 15;
+        _bufferSize = RTE_MARKDOWN_DEFAULT_BUFFER_SIZE;
+        _fileDescriptor = -1;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_buffer);
+}
+
+#pragma mark - Public Methods -
+
+- (BOOL)writeToFileHandle:(NSFileHandle *)fileHandle error:(NSError **)error {
+    _fileDescriptor = fileHandle.fileDescriptor;
+    BOOL success = [self writeDocumentWithError:error];
+    _fileDescriptor = -1;
+    return success;
+}
+
+- (BOOL)writeToStream:(NSOutputStream *)stream error:(NSError **)error {
+    BOOL shouldOpenStream = (stream.streamStatus == NSStreamStatusNotOpen);
+    if (shouldOpenStream) {
+        [stream open];
+    }
+    _stream = stream;
+    _writeError = stream.streamStatus == NSStreamStatusError ? stream.streamError : nil;
+    BOOL success = [self writeDocumentWithError:error];
+    if (shouldOpenStream) {
+        [stream close];
+    }
+    _stream = nil;
+    return success;
+}
+
+- (BOOL)writeToURL:(NSURL *)url error:(NSError **)error {
+    NSOutputStream *stream = [NSOutputStream outputStreamWithURL:url append:NO];
+    if (!stream) {
+        if (error) {
+            *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:@{NSURLErrorKey: url}];
+        }
+        return NO;
+    }
+    return [self writeToStream:stream error:error];
+}
+
+- (NSString *)markdownString {
+    NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+    if (![self writeToStream:stream error:nil]) {
+        return nil;
+    }
+    NSData *data = [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+    return data ? [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] : @"";
+}
+
+#pragma mark - Document -
+
+- (BOOL)writeDocumentWithError:(NSError **)error {
+    _bufferCapacity = MAX(self.bufferSize, (NSUInteger)256);
+    _bufferLength = 0;
+    _buffer = realloc(_buffer, _bufferCapacity);
+    _hasWrittenParagraph = NO;
+    _previousListLevel = 0;
+    self.openStyles = [NSMutableArray array];
+    self.runStyles = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                           valueOptions:NSPointerFunctionsStrongMemory];
+
+    NSString *string = self.attributedString.string;
+    NSUInteger length = string.length;
+    NSUInteger location = 0;
+    while (location < length && !_writeError) {
+        NSRange newline = [string rangeOfString:@"\n" options:NSLiteralSearch range:NSMakeRange(location, length - location)];
+        NSUInteger end = newline.location == NSNotFound ? length : newline.location;
+        @autoreleasepool {
+            [self writeParagraphInRange:NSMakeRange(location, end - location)];
+        }
+        location = end + 1;
+    }
+    if (_hasWrittenParagraph) {
+        [self appendCString:"\n"];
+    }
+    [self flush];
+
+    NSError *writeError = _writeError;
+    _writeError = nil;
+    free(_buffer);
+    _buffer = NULL;
+    self.openStyles = nil;
+    self.runStyles = nil;
+    if (writeError && error) {
+        *error = writeError;
+    }
+    return writeError == nil;
+}
+
+- (void)writeParagraphInRange:(NSRange)paragraphRange {
+    NSAttributedString *attributedString = self.attributedString;
+    NSString *string = attributedString.string;
+    NSString *bulletString = self.bulletString;
+    BOOL isListItem = bulletString.length > 0 && paragraphRange.length >= bulletString.length &&
+        [string compare:bulletString options:NSLiteralSearch range:NSMakeRange(paragraphRange.location, bulletString.length)] == NSOrderedSame;
+    NSRange contentRange = paragraphRange;
+    if (isListItem) {
+        contentRange = NSMakeRange(paragraphRange.location + bulletString.length, paragraphRange.length - bulletString.length);
+    }
+    // Leading whitespace would be read as indentation (or a code block)
+    while (contentRange.length > 0 && RTEMarkdownWriterIsWhitespace([string characterAtIndex:contentRange.location])) {
+        contentRange.location++;
+        contentRange.length--;
+    }
+    if (contentRange.length == 0 && !isListItem) {
+        return;
+    }
+
+    NSParagraphStyle *paragraphStyle = [attributedString attribute:NSParagraphStyleAttributeName atIndex:paragraphRange.location effectiveRange:NULL];
+    NSUInteger listLevel = 0;
+    if (isListItem) {
+        CGFloat indentation = self.bulletIndentation > 0 ? self.bulletIndentation : 15;
+        listLevel = (NSUInteger)MAX(lround(paragraphStyle.firstLineHeadIndent / indentation), 1L);
+        // A list can only go one level deeper at a time
+        listLevel = MIN(listLevel, _previousListLevel + 1);
+    }
+    if (_hasWrittenParagraph) {
+        [self appendCString:(isListItem && _previousListLevel > 0) ? "\n" : "\n\n"];
+    }
+    _hasWrittenParagraph = YES;
+    _previousListLevel = listLevel;
+
+    const char *alignment = NULL;
+    if (isListItem) {
+        for (NSUInteger level = 1; level < listLevel; level++) {
+            [self appendCString:"  "];
+        }
+        [self appendCString:"- "];
+    }
+    else {
+        alignment = [self markdownAlignmentString:paragraphStyle.alignment];
+        if (alignment) {
+            [self appendCString:"<p align=\""];
+            [self appendCString:alignment];
+            [self appendCString:"\">"];
+        }
+    }
+    [self prepareEscapingParagraphStartInRange:contentRange];
+    _pendingWhitespace = NSMakeRange(contentRange.location, 0);
+    [attributedString enumerateAttributesInRange:contentRange
+                                         options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                                      usingBlock:^(NSDictionary *attributes, NSRange range, BOOL *stop) {
+        [self writeRunInRange:range styles:[self stylesForAttributes:attributes]];
+    }];
+    // Trailing whitespace is dropped: two spaces at the end of a line are a line break
+    [self closeStylesFromIndex:0];
+    if (alignment) {
+        [self appendCString:"</p>"];
+    }
+}
+
+// Text is written as soon as it is known, except whitespace at the end of a run: if styles end
+// there, their closing markup has to come before the whitespace for Markdown to see it.
+- (void)writeRunInRange:(NSRange)range styles:(NSArray<NSString *> *)styles {
+    NSString *string = self.attributedString.string;
+    NSUInteger textStart = range.location;
+    NSUInteger textEnd = NSMaxRange(range);
+    while (textStart < textEnd && RTEMarkdownWriterIsWhitespace([string characterAtIndex:textStart])) {
+        textStart++;
+    }
+    if (textStart == textEnd) {
+        _pendingWhitespace = NSUnionRange(_pendingWhitespace, range);
+        return;
+    }
+    while (RTEMarkdownWriterIsWhitespace([string characterAtIndex:textEnd - 1])) {
+        textEnd--;
+    }
+    NSArray<NSString *> *openStyles = self.openStyles;
+    if ([openStyles isEqualToArray:styles]) {
+        [self appendEscapedCharactersInRange:NSMakeRange(_pendingWhitespace.location, textStart - _pendingWhitespace.location)];
+    }
+    else {
+        NSUInteger kept = 0;
+        while (kept < openStyles.count && kept < styles.count && [openStyles[kept] isEqualToString:styles[kept]]) {
+            kept++;
+        }
+        [self closeStylesFromIndex:kept];
+        [self appendEscapedCharactersInRange:NSMakeRange(_pendingWhitespace.location, textStart - _pendingWhitespace.location)];
+        for (NSUInteger i = kept; i < styles.count; i++) {
+            NSString *style = styles[i];
+            [self appendString:[style hasPrefix:@"["] ? @"[" : style];
+            [self.openStyles addObject:style];
+        }
+    }
+    [self appendEscapedCharactersInRange:NSMakeRange(textStart, textEnd - textStart)];
+    _pendingWhitespace = NSMakeRange(textEnd, NSMaxRange(range) - textEnd);
+}
+
+- (void)closeStylesFromIndex:(NSUInteger)index {
+    NSMutableArray<NSString *> *openStyles = self.openStyles;
+    while (openStyles.count > index) {
+        NSString *style = openStyles.lastObject;
+        if ([style hasPrefix:@"["]) {
+            [self appendCString:"]("];
+            [self appendString:[self markdownLinkDestination:[style substringFromIndex:1]]];
+            [self appendCString:")"];
+        }
+        else if (style == RTEMarkdownUnderline) {
+            [self appendCString:"</u>"];
+        }
+        else {
+            [self appendString:style];
+        }
+        [openStyles removeLastObject];
+    }
+}
+
+- (NSArray<NSString *> *)stylesForAttributes:(NSDictionary *)attributes {
+    NSArray<NSString *> *styles = [self.runStyles objectForKey:attributes];
+    if (styles) {
+        return styles;
+    }
+    NSMutableArray<NSString *> *newStyles = [NSMutableArray array];
+    id link = attributes[NSLinkAttributeName];
+    if (link) {
+        NSString *destination = [link isKindOfClass:[NSURL class]] ? [link absoluteString] : [link description];
+        [newStyles addObject:[@"[" stringByAppendingString:destination]];
+    }
+    NSNumber *strikeThrough = attributes[NSStrikethroughStyleAttributeName];
+    if (strikeThrough && strikeThrough.intValue != NSUnderlineStyleNone) {
+        [newStyles addObject:RTEMarkdownStrikeThrough];
+    }
+    NSNumber *underline = attributes[NSUnderlineStyleAttributeName];
+    if (underline && underline.intValue != NSUnderlineStyleNone) {
+        [newStyles addObject:RTEMarkdownUnderline];
+    }
+    NSFont *font = attributes[NSFontAttributeName];
+    if ([font isItalic]) {
+        [newStyles addObject:RTEMarkdownItalic];
+    }
+    if ([font isBold]) {
+        [newStyles addObject:RTEMarkdownBold];
+    }
+    styles = [newStyles copy];
+    [self.runStyles setObject:styles forKey:attributes];
+    return styles;
+}
+
+- (NSString *)markdownLinkDestination:(NSString *)destination {
+    NSCharacterSet *special = [NSCharacterSet characterSetWithCharactersInString:@" \t()<>\\"];
+    if ([destination rangeOfCharacterFromSet:special].location == NSNotFound) {
+        return destination;
+    }
+    NSMutableString *escaped = [destination mutableCopy];
+    [escaped replaceOccurrencesOfString:@"\\" withString:@"\\\\" options:NSLiteralSearch range:NSMakeRange(0, escaped.length)];
+    [escaped replaceOccurrencesOfString:@"<" withString:@"\\<" options:NSLiteralSearch range:NSMakeRange(0, escaped.length)];
+    [escaped replaceOccurrencesOfString:@">" withString:@"\\>" options:NSLiteralSearch range:NSMakeRange(0, escaped.length)];
+    return [NSString stringWithFormat:@"<%@>", escaped];
+}
+
+- (const char *)markdownAlignmentString:(NSTextAlignment)textAlignment {
+    switch (textAlignment) {
+        case NSCenterTextAlignment:
+            return "center";
+        case NSRightTextAlignment:
+            return "right";
+        case NSJustifiedTextAlignment:
+            return "justify";
+        default:
+            return NULL;
+    }
+}
+
+// At the start of a paragraph, # > - + = and the . or ) after a number would start a block
+- (void)prepareEscapingParagraphStartInRange:(NSRange)range {
+    _escapedIndex = NSNotFound;
+    if (range.length == 0) {
+        return;
+    }
+    NSString *string = self.attributedString.string;
+    unichar first = [string characterAtIndex:range.location];
+    if (first == '#' || first == '>' || first == '-' || first == '+' || first == '=') {
+        _escapedIndex = range.location;
+    }
+    else if (first >= '0' && first <= '9') {
+        NSUInteger i = range.location;
+        while (i < NSMaxRange(range) && i - range.location < 10 && [string characterAtIndex:i] >= '0' && [string characterAtIndex:i] <= '9') {
+            i++;
+        }
+        if (i < NSMaxRange(range) && ([string characterAtIndex:i] == '.' || [string characterAtIndex:i] == ')')) {
+            _escapedIndex = i;
+        }
+    }
+}
+
+#pragma mark - Output -
+
+// Escapes and UTF-8 encodes the text in range straight into the output buffer
+- (void)appendEscapedCharactersInRange:(NSRange)range {
+    NSString *string = self.attributedString.string;
+    unichar characters[RTE_MARKDOWN_CHARACTER_CHUNK];
+    // Worst case per UTF-16 unit is a backslash and 3 bytes
+    uint8_t bytes[RTE_MARKDOWN_CHARACTER_CHUNK * 4 + 4];
+    unichar highSurrogate = 0;
+    NSUInteger location = range.location;
+    NSUInteger end = NSMaxRange(range);
+    while (location < end && !_writeError) {
+        NSUInteger chunkLength = MIN((NSUInteger)RTE_MARKDOWN_CHARACTER_CHUNK, end - location);
+        [string getCharacters:characters range:NSMakeRange(location, chunkLength)];
+        NSUInteger byteCount = 0;
+        for (NSUInteger i = 0; i < chunkLength; i++) {
+            uint32_t c = characters[i];
+            if (highSurrogate) {
+                if (CFStringIsSurrogateLowCharacter(c)) {
+                    c = CFStringGetLongCharacterForSurrogatePair(highSurrogate, (UniChar)c);
+                    highSurrogate = 0;
+                    bytes[byteCount++] = (uint8_t)(0xF0 | (c >> 18));
+                    bytes[byteCount++] = (uint8_t)(0x80 | ((c >> 12) & 0x3F));
+                    bytes[byteCount++] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+                    bytes[byteCount++] = (uint8_t)(0x80 | (c & 0x3F));
+                    continue;
+                }
+                highSurrogate = 0;
+                c = 0xFFFD; // unpaired surrogate; written below, then this character is handled again
+                i--;
+            }
+            else if (CFStringIsSurrogateHighCharacter(c)) {
+                highSurrogate = (unichar)c;
+                continue;
+            }
+            else if (CFStringIsSurrogateLowCharacter(c)) {
+                c = 0xFFFD;
+            }
+            switch (c) {
+                case '\\':
+                case '*':
+                case '_':
+                case '~':
+                case '`':
+                case '[':
+                case ']':
+                case '<':
+                case '&':
+                    bytes[byteCount++] = '\\';
+                    bytes[byteCount++] = (uint8_t)c;
+                    break;
+                default:
+                    if (location + i == _escapedIndex) {
+                        bytes[byteCount++] = '\\';
+                    }
+                    if (c < 0x80) {
+                        bytes[byteCount++] = (uint8_t)c;
+                    }
+                    else if (c < 0x800) {
+                        bytes[byteCount++] = (uint8_t)(0xC0 | (c >> 6));
+                        bytes[byteCount++] = (uint8_t)(0x80 | (c & 0x3F));
+                    }
+                    else {
+                        bytes[byteCount++] = (uint8_t)(0xE0 | (c >> 12));
+                        bytes[byteCount++] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+                        bytes[byteCount++] = (uint8_t)(0x80 | (c & 0x3F));
+                    }
+                    break;
+            }
+        }
+        [self appendBytes:bytes length:byteCount];
+        location += chunkLength;
+    }
+    if (highSurrogate) {
+        [self appendBytes:"\xEF\xBF\xBD" length:3]; // U+FFFD
+    }
+}
+
+- (void)appendString:(NSString *)string {
+    NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    [self appendBytes:data.bytes length:data.length];
+}
+
+- (void)appendCString:(const char *)string {
+    [self appendBytes:string length:strlen(string)];
+}
+
+- (void)appendBytes:(const void *)bytes length:(NSUInteger)length {
+    if (_writeError || length == 0) {
+        return;
+    }
+    if (_bufferLength + length > _bufferCapacity) {
+        [self flush];
+        if (length > _bufferCapacity) {
+            [self writeBytes:bytes length:length];
+            return;
+        }
+    }
+    memcpy(_buffer + _bufferLength, bytes, length);
+    _bufferLength += length;
+}
+
+- (void)flush {
+    if (_bufferLength > 0) {
+        [self writeBytes:_buffer length:_bufferLength];
+        _bufferLength = 0;
+    }
+}
+
+- (void)writeBytes:(const uint8_t *)bytes length:(NSUInteger)length {
+    while (length > 0 && !_writeError) {
+        NSInteger written;
+        if (_stream) {
+            written = [_stream write:bytes maxLength:length];
+            if (written <= 0) {
+                _writeError = _stream.streamError;
+            }
+        }
+        else {
+            written = write(_fileDescriptor, bytes, length);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                _writeError = [NSError errorWithDomain:NSPOSIXErrorDomain code:written < 0 ? errno : EIO userInfo:nil];
+            }
+        }
+        if (written <= 0) {
+            if (!_writeError) {
+                _writeError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:nil];
+            }
+            return;
+        }
+        bytes += written;
+        length -= (NSUInteger)written;
+    }
+}
+
+@end
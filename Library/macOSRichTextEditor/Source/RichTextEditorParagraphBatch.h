@@ -0,0 +1,57 @@
+//
+//  RichTextEditorParagraphBatch.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFoundationText.h"
+
+@class RichTextEditorAttributeInterner;
+
+/// Collects changes to a set of paragraphs (prefix insertions/deletions such as bullets,
+/// and new paragraph styles) and then applies all of them inside a single
+/// beginEditing/endEditing transaction, so the layout manager only has to process one edit.
+///
+/// Paragraph ranges are given in the coordinates of the text *before* the batch is applied,
+/// must not include the trailing newline, and must be planned in ascending order.
+@interface RichTextEditorParagraphBatch : NSObject
+
+@property (nonatomic, readonly) NSMutableAttributedString *textStorage;
+
+/// If set, paragraph styles and prefix attributes are interned as they are planned.
+@property (nonatomic) RichTextEditorAttributeInterner *attributeInterner;
+
+/// Number of planned paragraph changes.
+@property (nonatomic, readonly) NSUInteger paragraphCount;
+
+/// Total change in length once the batch has been applied.
+@property (nonatomic, readonly) NSInteger changeInLength;
+
+/// The text of every planned paragraph, from the start of the first to the end of the last, in
+/// the coordinates of the text *after* the batch has been applied. {NSNotFound, 0} if nothing is planned.
+@property (nonatomic, readonly) NSRange affectedRange;
+
+/// YES if at least one paragraph style was applied to a paragraph that still has text after the batch.
+@property (nonatomic, readonly) BOOL styledNonEmptyParagraph;
+
+/// The style planned for the last planned paragraph, or nil.
+@property (nonatomic, readonly) NSParagraphStyle *lastParagraphStyle;
+
+/// If the last planned paragraph is empty once the batch has been applied, the style that was
+/// planned for it. Empty paragraphs have no characters to hold the style, so callers usually
+/// put it in the typing attributes instead.
+@property (nonatomic, readonly) NSParagraphStyle *lastEmptyParagraphStyle;
+
+- (instancetype)initWithTextStorage:(NSMutableAttributedString *)textStorage;
+
+/// Plans a change to the paragraph at paragraphRange. The first deleteLength characters of the
+/// paragraph are deleted, then prefix (if any) is inserted at the start of the paragraph, then
+/// paragraphStyle (if any) is applied to the resulting paragraph text.
+- (void)changeParagraph:(NSRange)paragraphRange deletingPrefixLength:(NSUInteger)deleteLength
+        insertingPrefix:(NSAttributedString *)prefix paragraphStyle:(NSParagraphStyle *)paragraphStyle;
+
+/// Performs every planned change in one text storage transaction. A batch can only be applied once.
+- (void)apply;
+
+@end
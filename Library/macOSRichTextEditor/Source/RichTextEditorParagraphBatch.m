@@ -0,0 +1,111 @@
+//
+//  RichTextEditorParagraphBatch.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorParagraphBatch.h"
+#import "RichTextEditorAttributeInterner.h"
+
+@interface RichTextEditorParagraphChange : NSObject
+
+@property NSRange paragraphRange;
+@property NSUInteger deleteLength;
+@property NSAttributedString *prefix;
+@property NSParagraphStyle *paragraphStyle;
+
+@end
+
+@implementation RichTextEditorParagraphChange
+
+- (NSUInteger)lengthAfterChange {
+    return self.paragraphRange.length - self.deleteLength + self.prefix.length;
+}
+
+@end
+
+@interface RichTextEditorParagraphBatch ()
+
+@property NSMutableArray *changes;
+@property BOOL hasBeenApplied;
+
+@end
+
+@implementation RichTextEditorParagraphBatch
+
+- (instancetype)initWithTextStorage:(NSMutableAttributedString *)textStorage {
+    if (self = [super init]) {
+        _textStorage = textStorage;
+        _changes = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (NSUInteger)paragraphCount {
+    return self.changes.count;
+}
+
+- (NSRange)affectedRange {
+    if (self.changes.count == 0) {
+        return NSMakeRange(NSNotFound, 0);
+    }
+    NSUInteger start = [self.changes.firstObject paragraphRange].location;
+    NSUInteger end = NSMaxRange([self.changes.lastObject paragraphRange]) + self.changeInLength;
+    return NSMakeRange(start, end - start);
+}
+
+- (void)changeParagraph:(NSRange)paragraphRange deletingPrefixLength:(NSUInteger)deleteLength
+        insertingPrefix:(NSAttributedString *)prefix paragraphStyle:(NSParagraphStyle *)paragraphStyle {
+    NSAssert(!self.hasBeenApplied, @"Paragraph batch has already been applied");
+    NSAssert(deleteLength <= paragraphRange.length, @"Can't delete more than the paragraph");
+    NSAssert(self.changes.count == 0 || NSMaxRange([self.changes.lastObject paragraphRange]) < paragraphRange.location,
+             @"Paragraph changes must be planned in ascending order");
+    if (self.attributeInterner) {
+        paragraphStyle = [self.attributeInterner internedParagraphStyle:paragraphStyle];
+        prefix = prefix ? [self.attributeInterner internedAttributedString:prefix] : nil;
+    }
+    RichTextEditorParagraphChange *change = [[RichTextEditorParagraphChange alloc] init];
+    change.paragraphRange = paragraphRange;
+    change.deleteLength = deleteLength;
+    change.prefix = prefix;
+    change.paragraphStyle = paragraphStyle;
+    [self.changes addObject:change];
+
+    _changeInLength += (NSInteger)prefix.length - (NSInteger)deleteLength;
+    if (paragraphStyle && [change lengthAfterChange] > 0) {
+        _styledNonEmptyParagraph = YES;
+    }
+    _lastParagraphStyle = paragraphStyle;
+    _lastEmptyParagraphStyle = [change lengthAfterChange] == 0 ? paragraphStyle : nil;
+}
+
+- (void)apply {
+    if (self.hasBeenApplied) {
+        return;
+    }
+    self.hasBeenApplied = YES;
+    if (self.changes.count == 0) {
+        return;
+    }
+    NSMutableAttributedString *textStorage = self.textStorage;
+    [textStorage beginEditing];
+    // Work from the end of the text towards the start so that the planned (pre-edit)
+    // locations stay valid without having to track a running offset.
+    for (RichTextEditorParagraphChange *change in [self.changes reverseObjectEnumerator]) {
+        NSUInteger location = change.paragraphRange.location;
+        if (change.deleteLength > 0) {
+            [textStorage deleteCharactersInRange:NSMakeRange(location, change.deleteLength)];
+        }
+        if (change.prefix.length > 0) {
+            [textStorage insertAttributedString:change.prefix atIndex:location];
+        }
+        NSUInteger length = [change lengthAfterChange];
+        if (change.paragraphStyle && length > 0) {
+            [textStorage addAttribute:NSParagraphStyleAttributeName value:change.paragraphStyle range:NSMakeRange(location, length)];
+        }
+    }
+    [textStorage endEditing];
+}
+
+@end
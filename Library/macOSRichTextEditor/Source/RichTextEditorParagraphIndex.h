@@ -0,0 +1,70 @@
+//
+//  RichTextEditorParagraphIndex.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFoundationText.h"
+
+/// Keeps a sorted table of the newline offsets in an NSTextStorage so that paragraph
+/// lookups don't have to walk the string character by character.
+/// The table is updated from NSTextStorageDidProcessEditingNotification, so edits only
+/// rescan the characters that actually changed. Lookups are binary searches (O(log n)).
+/// Paragraph ranges use the exact same rules as -[NSAttributedString firstParagraphRangeFromTextRange:].
+@interface RichTextEditorParagraphIndex : NSObject
+
+@property (nonatomic, readonly) NSTextStorage *textStorage;
+
+/// Length of the text the index currently describes.
+@property (nonatomic, readonly) NSUInteger length;
+
+/// Number of paragraphs (newline count + 1).
+@property (nonatomic, readonly) NSUInteger paragraphCount;
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage;
+
+/// YES if the index matches the current contents of its text storage. This is NO while
+/// the text storage is in the middle of a beginEditing/endEditing block that changes characters.
+- (BOOL)isInSync;
+
+/// Throws away the table and rescans the whole text storage.
+- (void)rebuild;
+
+/// Updates the table for a character edit. editedRange is in post-edit coordinates.
+/// This is called automatically when the text storage processes an edit.
+- (void)textStorageDidEditCharactersInRange:(NSRange)editedRange changeInLength:(NSInteger)delta;
+
+/// Same result as -[NSAttributedString firstParagraphRangeFromTextRange:].
+- (NSRange)firstParagraphRangeFromTextRange:(NSRange)range;
+
+/// Same result as -[NSAttributedString rangeOfParagraphsFromTextRange:].
+- (NSArray *)rangeOfParagraphsFromTextRange:(NSRange)textRange;
+
+/// Zero-based index of the paragraph containing the given character location.
+- (NSUInteger)paragraphIndexAtLocation:(NSUInteger)location;
+
+/// Range (without the trailing newline) of the paragraph at the given zero-based paragraph index.
+- (NSRange)rangeOfParagraphAtIndex:(NSUInteger)paragraphIndex;
+
+#pragma mark - Lists -
+
+/// Strings that mark a paragraph as a list item when the paragraph starts with them (for
+/// example the editor's bullet string). The index remembers which marker, if any, each
+/// paragraph starts with, so list queries don't need to look at (or copy) the text.
+/// The text itself stays the source of truth, so documents keep the plain marker text form.
+/// Markers may be any length; at most 255 are supported. Setting this rescans the text.
+@property (nonatomic, copy) NSArray *listMarkers;
+
+/// The list marker the paragraph at the given zero-based paragraph index starts with, or nil.
+- (NSString *)listMarkerOfParagraphAtIndex:(NSUInteger)paragraphIndex;
+
+/// The list marker that the text at location starts with, or nil. O(1) for paragraph starts;
+/// other locations compare the marker characters directly.
+- (NSString *)listMarkerAtLocation:(NSUInteger)location;
+
+/// Nesting level of the list item at the given paragraph index, based on its first line head
+/// indent and the given indentation per level. Returns 0 for paragraphs that aren't list items.
+- (NSUInteger)listLevelOfParagraphAtIndex:(NSUInteger)paragraphIndex indentation:(CGFloat)indentation;
+
+@end
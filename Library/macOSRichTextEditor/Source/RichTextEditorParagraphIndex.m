@@ -0,0 +1,368 @@
+//
+//  RichTextEditorParagraphIndex.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorParagraphIndex.h"
+#import "NSAttributedString+RichTextEditor.h"
+
+#define RTE_SCAN_BUFFER_SIZE 1024
+// Markers are stored per paragraph as a uint8_t, with 0 meaning none
+#define RTE_MAX_LIST_MARKERS UINT8_MAX
+
+@interface RichTextEditorParagraphIndex () {
+    NSUInteger *_newlines; // sorted offsets of every '\n' in the text
+    NSUInteger _newlineCount;
+    NSUInteger _newlineCapacity;
+    NSUInteger _length;
+    // The character edit the text storage is processing, once the table has been updated for it
+    BOOL _hasProcessedEdit;
+    NSRange _processedEditedRange;
+    NSInteger _processedChangeInLength;
+    uint8_t *_markers; // per paragraph: 0 for no list marker, otherwise 1 + index into listMarkers
+    NSUInteger _markerCapacity;
+    NSUInteger _listMarkerCount;
+    NSUInteger *_listMarkerLengths;
+    unichar *_listMarkerCharacters; // every marker's characters, back to back
+    unichar *_listMarkerBuffer; // room for the longest marker, for comparing text against
+    NSUInteger _maxListMarkerLength;
+}
+
+@end
+
+@implementation RichTextEditorParagraphIndex
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage {
+    if (self = [super init]) {
+        _textStorage = textStorage;
+        [self rebuild];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(textStorageDidProcessEditing:)
+                                                     name:NSTextStorageDidProcessEditingNotification
+                                                   object:textStorage];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    free(_newlines);
+    free(_markers);
+    free(_listMarkerLengths);
+    free(_listMarkerCharacters);
+    free(_listMarkerBuffer);
+}
+
+- (NSUInteger)length {
+    return _length;
+}
+
+- (NSUInteger)paragraphCount {
+    return _newlineCount + 1;
+}
+
+- (BOOL)isInSync {
+    NSTextStorage *textStorage = self.textStorage;
+    if ((textStorage.editedMask & NSTextStorageEditedCharacters) == 0) {
+        _hasProcessedEdit = NO;
+        return textStorage.length == _length;
+    }
+    // Characters have changed since the text storage last finished processing. That's only
+    // reflected in the table once textStorageDidProcessEditing: has seen this very edit; before
+    // then an edit that keeps the length (e.g. a newline replaced by another character) would
+    // otherwise look in sync.
+    return _hasProcessedEdit && NSEqualRanges(textStorage.editedRange, _processedEditedRange) &&
+        textStorage.changeInLength == _processedChangeInLength && textStorage.length == _length;
+}
+
+#pragma mark - Updating -
+
+- (void)textStorageDidProcessEditing:(NSNotification *)notification {
+    NSTextStorage *textStorage = notification.object;
+    if ((textStorage.editedMask & NSTextStorageEditedCharacters) == 0) {
+        return; // attribute-only change; paragraph boundaries are the same
+    }
+    [self textStorageDidEditCharactersInRange:textStorage.editedRange changeInLength:textStorage.changeInLength];
+    _hasProcessedEdit = YES;
+    _processedEditedRange = textStorage.editedRange;
+    _processedChangeInLength = textStorage.changeInLength;
+}
+
+- (void)ensureCapacity:(NSUInteger)capacity {
+    if (capacity <= _newlineCapacity) {
+        return;
+    }
+    NSUInteger newCapacity = MAX(_newlineCapacity * 2, (NSUInteger)64);
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    _newlines = realloc(_newlines, newCapacity * sizeof(NSUInteger));
+    _newlineCapacity = newCapacity;
+}
+
+// Markers are stored per paragraph, so there is always one more than there are newlines
+- (void)ensureMarkerCapacity:(NSUInteger)capacity {
+    if (capacity <= _markerCapacity) {
+        return;
+    }
+    NSUInteger newCapacity = MAX(_markerCapacity * 2, (NSUInteger)64);
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    _markers = realloc(_markers, newCapacity * sizeof(uint8_t));
+    _markerCapacity = newCapacity;
+}
+
+// Calls block for every newline in range, in order. Reads the string in chunks
+// so we don't pay for an Objective-C message per character.
+- (void)enumerateNewlinesInString:(NSString *)string range:(NSRange)range usingBlock:(void (^)(NSUInteger location))block {
+    unichar buffer[RTE_SCAN_BUFFER_SIZE];
+    NSUInteger location = range.location;
+    NSUInteger end = NSMaxRange(range);
+    while (location < end) {
+        NSUInteger chunkLength = MIN((NSUInteger)RTE_SCAN_BUFFER_SIZE, end - location);
+        [string getCharacters:buffer range:NSMakeRange(location, chunkLength)];
+        for (NSUInteger i = 0; i < chunkLength; i++) {
+            if (buffer[i] == '\n') {
+                block(location + i);
+            }
+        }
+        location += chunkLength;
+    }
+}
+
+- (void)rebuild {
+    NSString *string = self.textStorage.string;
+    _newlineCount = 0;
+    _length = string.length;
+    [self enumerateNewlinesInString:string range:NSMakeRange(0, _length) usingBlock:^(NSUInteger location) {
+        [self ensureCapacity:self->_newlineCount + 1];
+        self->_newlines[self->_newlineCount++] = location;
+    }];
+    [self ensureMarkerCapacity:_newlineCount + 1];
+    [self updateMarkersOfParagraphsInRange:NSMakeRange(0, _newlineCount + 1)];
+}
+
+- (void)textStorageDidEditCharactersInRange:(NSRange)editedRange changeInLength:(NSInteger)delta {
+    NSString *string = self.textStorage.string;
+    NSInteger oldEditedLength = (NSInteger)editedRange.length - delta;
+    if (oldEditedLength < 0 || (NSInteger)_length + delta != (NSInteger)string.length ||
+        NSMaxRange(editedRange) > string.length) {
+        // We missed an edit somewhere; start over rather than guessing.
+        [self rebuild];
+        return;
+    }
+    NSUInteger oldStart = editedRange.location;
+    NSUInteger oldEnd = oldStart + (NSUInteger)oldEditedLength;
+    NSUInteger firstRemoved = [self lowerBound:oldStart];
+    NSUInteger lastRemoved = [self lowerBound:oldEnd]; // exclusive
+
+    NSMutableData *insertedData = [NSMutableData data];
+    [self enumerateNewlinesInString:string range:editedRange usingBlock:^(NSUInteger location) {
+        [insertedData appendBytes:&location length:sizeof(NSUInteger)];
+    }];
+    NSUInteger insertedCount = insertedData.length / sizeof(NSUInteger);
+    NSUInteger removedCount = lastRemoved - firstRemoved;
+    NSUInteger tailCount = _newlineCount - lastRemoved;
+
+    [self ensureCapacity:_newlineCount - removedCount + insertedCount];
+    [self ensureMarkerCapacity:_newlineCount - removedCount + insertedCount + 1];
+    if (insertedCount != removedCount && tailCount > 0) {
+        memmove(_newlines + firstRemoved + insertedCount, _newlines + lastRemoved, tailCount * sizeof(NSUInteger));
+        // Paragraphs after the edit keep their markers; they just move to a new paragraph index
+        memmove(_markers + firstRemoved + insertedCount + 1, _markers + lastRemoved + 1, tailCount * sizeof(uint8_t));
+    }
+    if (insertedCount > 0) {
+        memcpy(_newlines + firstRemoved, insertedData.bytes, insertedCount * sizeof(NSUInteger));
+    }
+    _newlineCount = _newlineCount - removedCount + insertedCount;
+    if (delta != 0) {
+        for (NSUInteger i = firstRemoved + insertedCount; i < _newlineCount; i++) {
+            _newlines[i] = (NSUInteger)((NSInteger)_newlines[i] + delta);
+        }
+    }
+    _length = string.length;
+    // Only the paragraphs the edit touched can start differently now
+    [self updateMarkersOfParagraphsInRange:NSMakeRange(firstRemoved, insertedCount + 1)];
+}
+
+#pragma mark - Lookups -
+
+// Index of the first newline at or after location
+- (NSUInteger)lowerBound:(NSUInteger)location {
+    NSUInteger low = 0;
+    NSUInteger high = _newlineCount;
+    while (low < high) {
+        NSUInteger mid = low + (high - low) / 2;
+        if (_newlines[mid] < location) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+- (BOOL)hasNewlineAtLocation:(NSUInteger)location {
+    NSUInteger index = [self lowerBound:location];
+    return index < _newlineCount && _newlines[index] == location;
+}
+
+- (NSRange)firstParagraphRangeFromTextRange:(NSRange)range {
+    if (![self isInSync]) {
+        // The text storage is mid-edit; the index will catch up when the edit is processed.
+        return [self.textStorage firstParagraphRangeFromTextRange:range];
+    }
+    if (_length == 0 || _length < range.location) {
+        return NSMakeRange(0, 0);
+    }
+    NSUInteger location = range.location;
+    BOOL startsOnNewline = (location == _length || [self hasNewlineAtLocation:location]);
+
+    NSUInteger start = 0;
+    if (!(startsOnNewline && location == 0)) {
+        // Find the last newline at or before the starting point (the character before a
+        // newline/end of text, or the location itself).
+        NSUInteger startingPoint = startsOnNewline ? location - 1 : location;
+        NSUInteger index = [self lowerBound:startingPoint + 1];
+        if (index > 0) {
+            start = _newlines[index - 1] + 1;
+        }
+    }
+    NSUInteger moveForwardIndex = MAX(location, start);
+    NSUInteger endIndex = [self lowerBound:moveForwardIndex];
+    NSUInteger end = endIndex < _newlineCount ? _newlines[endIndex] : _length;
+    return NSMakeRange(start, end - start);
+}
+
+- (NSArray *)rangeOfParagraphsFromTextRange:(NSRange)textRange {
+    if (![self isInSync]) {
+        return [self.textStorage rangeOfParagraphsFromTextRange:textRange];
+    }
+    NSMutableArray *paragraphRanges = [NSMutableArray array];
+    NSUInteger rangeStartIndex = textRange.location;
+    while (true) {
+        NSRange range = [self firstParagraphRangeFromTextRange:NSMakeRange(rangeStartIndex, 0)];
+        rangeStartIndex = range.location + range.length + 1;
+        [paragraphRanges addObject:[NSValue valueWithRange:range]];
+        if (NSMaxRange(range) >= NSMaxRange(textRange) || NSMaxRange(range) >= _length) {
+            break;
+        }
+    }
+    return paragraphRanges;
+}
+
+- (NSUInteger)paragraphIndexAtLocation:(NSUInteger)location {
+    return [self lowerBound:MIN(location, _length)];
+}
+
+- (NSRange)rangeOfParagraphAtIndex:(NSUInteger)paragraphIndex {
+    if (paragraphIndex > _newlineCount) {
+        return NSMakeRange(NSNotFound, 0);
+    }
+    NSUInteger start = paragraphIndex == 0 ? 0 : _newlines[paragraphIndex - 1] + 1;
+    NSUInteger end = paragraphIndex < _newlineCount ? _newlines[paragraphIndex] : _length;
+    return NSMakeRange(start, end - start);
+}
+
+#pragma mark - Lists -
+
+- (void)setListMarkers:(NSArray *)listMarkers {
+    if (listMarkers.count > RTE_MAX_LIST_MARKERS) {
+        [NSException raise:NSInvalidArgumentException format:@"At most %d list markers are supported", RTE_MAX_LIST_MARKERS];
+    }
+    NSMutableArray *markers = [NSMutableArray array];
+    NSUInteger totalLength = 0;
+    for (NSString *marker in listMarkers) {
+        if (marker.length > 0) { // an empty marker would match every paragraph
+            [markers addObject:[marker copy]];
+            totalLength += marker.length;
+        }
+    }
+    free(_listMarkerLengths);
+    free(_listMarkerCharacters);
+    free(_listMarkerBuffer);
+    _listMarkerLengths = malloc(MAX(markers.count, (NSUInteger)1) * sizeof(NSUInteger));
+    _listMarkerCharacters = malloc(MAX(totalLength, (NSUInteger)1) * sizeof(unichar));
+    _maxListMarkerLength = 0;
+    NSUInteger offset = 0;
+    for (NSUInteger i = 0; i < markers.count; i++) {
+        NSString *marker = markers[i];
+        [marker getCharacters:_listMarkerCharacters + offset range:NSMakeRange(0, marker.length)];
+        _listMarkerLengths[i] = marker.length;
+        _maxListMarkerLength = MAX(_maxListMarkerLength, marker.length);
+        offset += marker.length;
+    }
+    _listMarkerBuffer = malloc(MAX(_maxListMarkerLength, (NSUInteger)1) * sizeof(unichar));
+    _listMarkers = markers;
+    _listMarkerCount = markers.count;
+    if ([self isInSync]) {
+        [self updateMarkersOfParagraphsInRange:NSMakeRange(0, _newlineCount + 1)];
+    }
+}
+
+// Returns 0 or 1 + the index of the marker that the text at location starts with
+- (uint8_t)markerAtLocation:(NSUInteger)location inString:(NSString *)string {
+    if (_listMarkerCount == 0 || location >= string.length) {
+        return 0;
+    }
+    NSUInteger available = MIN(string.length - location, _maxListMarkerLength);
+    [string getCharacters:_listMarkerBuffer range:NSMakeRange(location, available)];
+    const unichar *markerCharacters = _listMarkerCharacters;
+    for (NSUInteger i = 0; i < _listMarkerCount; i++) {
+        NSUInteger markerLength = _listMarkerLengths[i];
+        if (markerLength <= available && memcmp(_listMarkerBuffer, markerCharacters, markerLength * sizeof(unichar)) == 0) {
+            return (uint8_t)(i + 1);
+        }
+        markerCharacters += markerLength;
+    }
+    return 0;
+}
+
+- (void)updateMarkersOfParagraphsInRange:(NSRange)paragraphRange {
+    NSString *string = self.textStorage.string;
+    NSUInteger end = MIN(NSMaxRange(paragraphRange), _newlineCount + 1);
+    for (NSUInteger i = paragraphRange.location; i < end; i++) {
+        NSUInteger start = i == 0 ? 0 : _newlines[i - 1] + 1;
+        _markers[i] = [self markerAtLocation:start inString:string];
+    }
+}
+
+- (NSString *)listMarkerOfParagraphAtIndex:(NSUInteger)paragraphIndex {
+    if (![self isInSync]) {
+        NSRange range = [self rangeOfParagraphAtIndex:paragraphIndex];
+        return range.location == NSNotFound ? nil : [self listMarkerAtLocation:range.location];
+    }
+    if (paragraphIndex > _newlineCount || _markers[paragraphIndex] == 0) {
+        return nil;
+    }
+    return self.listMarkers[_markers[paragraphIndex] - 1];
+}
+
+- (NSString *)listMarkerAtLocation:(NSUInteger)location {
+    NSString *string = self.textStorage.string;
+    if ([self isInSync] && location < _length && (location == 0 || [string characterAtIndex:location - 1] == '\n')) {
+        // Start of a paragraph; use the table
+        uint8_t marker = _markers[[self lowerBound:location]];
+        return marker == 0 ? nil : self.listMarkers[marker - 1];
+    }
+    uint8_t marker = [self markerAtLocation:location inString:string];
+    return marker == 0 ? nil : self.listMarkers[marker - 1];
+}
+
+- (NSUInteger)listLevelOfParagraphAtIndex:(NSUInteger)paragraphIndex indentation:(CGFloat)indentation {
+    if (![self listMarkerOfParagraphAtIndex:paragraphIndex]) {
+        return 0;
+    }
+    NSRange range = [self rangeOfParagraphAtIndex:paragraphIndex];
+    NSParagraphStyle *paragraphStyle = [self.textStorage attribute:NSParagraphStyleAttributeName atIndex:range.location effectiveRange:nil];
+    if (indentation <= 0) {
+        return 1;
+    }
+    return MAX((NSUInteger)1, (NSUInteger)lround(paragraphStyle.firstLineHeadIndent / indentation));
+}
+
+@end
@@ -0,0 +1,44 @@
+//
+//  RichTextEditorPool.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+@class RichTextEditor;
+
+/// Keeps editors that are no longer shown so they can be handed out again instead of creating
+/// a new editor (and a new text system) for every table or collection view cell that scrolls in.
+///
+/// Editors are reset with -[RichTextEditor prepareForReuse] when they are put back. Use the pool
+/// on the main thread.
+@interface RichTextEditorPool : NSObject
+
+/// Makes a new editor when the pool is empty. Defaults to -[RichTextEditor initWithFrame:] with
+/// an empty frame.
+@property (nonatomic, copy) RichTextEditor *(^editorFactory)(void);
+
+/// Most editors to keep; editors put back beyond this are let go. Defaults to 32.
+@property (nonatomic) NSUInteger maximumIdleCount;
+
+/// Number of editors waiting to be reused.
+@property (nonatomic, readonly) NSUInteger idleCount;
+
+/// Number of editors the pool has had to create.
+@property (nonatomic, readonly) NSUInteger createdCount;
+
+/// Number of times dequeueEditor handed out an editor that was put back earlier.
+@property (nonatomic, readonly) NSUInteger reusedCount;
+
+/// An editor that isn't in a view hierarchy, either one put back earlier or a new one.
+- (RichTextEditor *)dequeueEditor;
+
+/// Removes editor from its superview, resets it and keeps it for dequeueEditor.
+- (void)enqueueEditor:(RichTextEditor *)editor;
+
+/// Lets go of every idle editor (e.g. on memory pressure).
+- (void)removeAllIdleEditors;
+
+@end
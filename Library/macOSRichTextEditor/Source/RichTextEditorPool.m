@@ -0,0 +1,68 @@
+//
+//  RichTextEditorPool.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorPool.h"
+#import "RichTextEditor.h"
+
+@interface RichTextEditorPool ()
+
+@property NSMutableArray<RichTextEditor *> *idleEditors;
+@property (nonatomic, readwrite) NSUInteger createdCount;
+@property (nonatomic, readwrite) NSUInteger reusedCount;
+
+@end
+
+@implementation RichTextEditorPool
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _idleEditors = [NSMutableArray array];
+        _maximumIdleCount = 32;
+    }
+    return self;
+}
+
+- (NSUInteger)idleCount {
+    return self.idleEditors.count;
+}
+
+- (void)setMaximumIdleCount:(NSUInteger)maximumIdleCount {
+    _maximumIdleCount = maximumIdleCount;
+    if (self.idleEditors.count > maximumIdleCount) {
+        [self.idleEditors removeObjectsInRange:NSMakeRange(maximumIdleCount, self.idleEditors.count - maximumIdleCount)];
+    }
+}
+
+- (RichTextEditor *)dequeueEditor {
+    RichTextEditor *editor = self.idleEditors.lastObject;
+    if (editor) {
+        [self.idleEditors removeLastObject];
+        self.reusedCount++;
+        return editor;
+    }
+    self.createdCount++;
+    return self.editorFactory ? self.editorFactory() : [[RichTextEditor alloc] initWithFrame:NSZeroRect];
+}
+
+- (void)enqueueEditor:(RichTextEditor *)editor {
+    if (!editor || [self.idleEditors indexOfObjectIdenticalTo:editor] != NSNotFound) {
+        return;
+    }
+    // A scroll view around the editor (see NSTextView's scrollableTextView) goes with it
+    NSView *container = editor.enclosingScrollView.documentView == editor ? editor.enclosingScrollView : editor;
+    [container removeFromSuperview];
+    [editor prepareForReuse];
+    if (self.idleEditors.count < self.maximumIdleCount) {
+        [self.idleEditors addObject:editor];
+    }
+}
+
+- (void)removeAllIdleEditors {
+    [self.idleEditors removeAllObjects];
+}
+
+@end
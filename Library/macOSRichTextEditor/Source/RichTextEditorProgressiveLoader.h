@@ -0,0 +1,57 @@
+//
+//  RichTextEditorProgressiveLoader.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+/// Loads a document into a text storage a piece at a time, so that the first screen of a large
+/// document shows up without waiting for the whole thing to be appended and laid out.
+///
+/// The source is produced (parsed, converted, copied) on a background queue. It is then
+/// appended on the main thread in chunks that always end after a newline, so no paragraph is
+/// ever half loaded. Each main run loop turn appends chunks until frameBudget is used up and
+/// then lets the run loop draw before the next turn. The first chunk replaces whatever the
+/// text storage held before.
+///
+/// A loader is used for one load. All methods must be called on the main thread.
+@interface RichTextEditorProgressiveLoader : NSObject
+
+@property (nonatomic, readonly) NSTextStorage *textStorage;
+
+/// Approximate number of characters per chunk. Defaults to 32768.
+@property (nonatomic) NSUInteger chunkLength;
+
+/// Time to spend appending chunks per run loop turn. Defaults to 1/120 s.
+@property (nonatomic) NSTimeInterval frameBudget;
+
+/// YES from loadFromSource: until the load finishes or is cancelled.
+@property (nonatomic, readonly) BOOL isLoading;
+
+/// Characters appended so far and the length of the whole document (0 until the source is ready).
+@property (nonatomic, readonly) NSUInteger loadedLength;
+@property (nonatomic, readonly) NSUInteger totalLength;
+
+/// Called on the main thread after every run loop turn that appended text.
+@property (nonatomic, copy) void (^progressHandler)(NSUInteger loadedLength, NSUInteger totalLength);
+
+/// Called on the main thread once: finished is YES if the whole document was loaded, NO if
+/// the load was cancelled or the source returned nil.
+@property (nonatomic, copy) void (^completionHandler)(BOOL finished);
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage;
+
+/// Runs source on a background queue and loads the string it returns.
+- (void)loadFromSource:(NSAttributedString *(^)(void))source;
+
+/// Like loadFromSource:, but if source returns nil, mainThreadFallback (if not nil) is run on the
+/// main thread and the string it returns is loaded instead. For sources that can only be read on
+/// the main thread some of the time, like HTML that only Cocoa's importer understands.
+- (void)loadFromSource:(NSAttributedString *(^)(void))source mainThreadFallback:(NSAttributedString *(^)(void))mainThreadFallback;
+
+/// Stops loading. Text that was already appended stays in the text storage.
+- (void)cancel;
+
+@end
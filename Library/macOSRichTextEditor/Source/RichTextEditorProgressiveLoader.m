@@ -0,0 +1,125 @@
+//
+//  RichTextEditorProgressiveLoader.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorProgressiveLoader.h"
+
+@interface RichTextEditorProgressiveLoader ()
+
+@property (nonatomic, readwrite) BOOL isLoading;
+@property (nonatomic, readwrite) NSUInteger loadedLength;
+@property (nonatomic, readwrite) NSUInteger totalLength;
+
+@property NSAttributedString *source;
+@property BOOL hasStarted;
+
+@end
+
+@implementation RichTextEditorProgressiveLoader
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage {
+    if (self = [super init]) {
+        _textStorage = textStorage;
+        _chunkLength = 32768;
+        _frameBudget = 1.0 / 120.0;
+    }
+    return self;
+}
+
+- (void)loadFromSource:(NSAttributedString *(^)(void))source {
+    [self loadFromSource:source mainThreadFallback:nil];
+}
+
+- (void)loadFromSource:(NSAttributedString *(^)(void))source mainThreadFallback:(NSAttributedString *(^)(void))mainThreadFallback {
+    NSAssert(!self.hasStarted, @"A progressive loader can only be used once");
+    self.hasStarted = YES;
+    self.isLoading = YES;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSAttributedString *string = source();
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (!self.isLoading) {
+                return; // cancelled while the source was being produced
+            }
+            NSAttributedString *loaded = string;
+            if (!loaded && mainThreadFallback) {
+                loaded = mainThreadFallback();
+            }
+            if (!loaded) {
+                [self finish:NO];
+                return;
+            }
+            self.source = loaded;
+            self.totalLength = loaded.length;
+            [self appendChunks];
+        });
+    });
+}
+
+- (void)cancel {
+    if (!self.isLoading) {
+        return;
+    }
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(appendChunks) object:nil];
+    [self finish:NO];
+}
+
+- (void)finish:(BOOL)finished {
+    self.isLoading = NO;
+    self.source = nil;
+    void (^completionHandler)(BOOL) = self.completionHandler;
+    self.completionHandler = nil;
+    self.progressHandler = nil;
+    if (completionHandler) {
+        completionHandler(finished);
+    }
+}
+
+// End of the chunk that starts at location: just after the first newline at or past
+// location + chunkLength, or the end of the document
+- (NSUInteger)endOfChunkStartingAt:(NSUInteger)location {
+    NSString *text = self.source.string;
+    NSUInteger length = text.length;
+    NSUInteger target = MIN(location + MAX(self.chunkLength, (NSUInteger)1), length);
+    if (target == length) {
+        return length;
+    }
+    NSRange newline = [text rangeOfString:@"\n" options:NSLiteralSearch range:NSMakeRange(target - 1, length - target + 1)];
+    return newline.location == NSNotFound ? length : NSMaxRange(newline);
+}
+
+- (void)appendChunks {
+    if (!self.isLoading) {
+        return;
+    }
+    NSTimeInterval start = [NSProcessInfo processInfo].systemUptime;
+    do {
+        NSUInteger end = [self endOfChunkStartingAt:self.loadedLength];
+        NSAttributedString *chunk = [self.source attributedSubstringFromRange:NSMakeRange(self.loadedLength, end - self.loadedLength)];
+        if (self.loadedLength == 0) {
+            [self.textStorage setAttributedString:chunk];
+        }
+        else {
+            [self.textStorage appendAttributedString:chunk];
+        }
+        self.loadedLength = end;
+    } while (self.loadedLength < self.totalLength && [NSProcessInfo processInfo].systemUptime - start < self.frameBudget);
+
+    if (self.progressHandler) {
+        self.progressHandler(self.loadedLength, self.totalLength);
+    }
+    if (!self.isLoading) {
+        return; // cancelled from the progress handler
+    }
+    if (self.loadedLength < self.totalLength) {
+        // A timer rather than the main queue, so the run loop gets to draw in between
+        [self performSelector:@selector(appendChunks) withObject:nil afterDelay:0 inModes:@[NSRunLoopCommonModes]];
+    }
+    else {
+        [self finish:YES];
+    }
+}
+
+@end
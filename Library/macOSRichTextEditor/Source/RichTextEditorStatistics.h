@@ -0,0 +1,56 @@
+//
+//  RichTextEditorStatistics.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+@class RichTextEditorParagraphIndex;
+
+/// Word, character, paragraph and list item counts of a text storage, and the fonts and colors
+/// it uses, kept up to date as the text is edited.
+///
+/// Counts are kept per paragraph. An edit only recounts the paragraphs it touched, so the cost
+/// of keeping up depends on the size of the edit and not the size of the document, and every
+/// value can be read at any time without looking at the text. Use it on the main thread.
+///
+/// Words are runs of characters that aren't whitespace. List markers aren't counted as words or
+/// characters, and paragraph breaks aren't counted as characters.
+@interface RichTextEditorStatistics : NSObject
+
+@property (nonatomic, readonly) NSTextStorage *textStorage;
+
+@property (nonatomic, readonly) NSUInteger wordCount;
+@property (nonatomic, readonly) NSUInteger characterCount;
+@property (nonatomic, readonly) NSUInteger paragraphCount;
+
+/// Paragraphs that start with one of listMarkers.
+@property (nonatomic, readonly) NSUInteger listItemCount;
+
+/// Fonts, text colors and background colors of the text (typing attributes aren't included).
+@property (nonatomic, readonly) NSSet<NSFont *> *fonts;
+@property (nonatomic, readonly) NSSet<NSColor *> *textColors;
+@property (nonatomic, readonly) NSSet<NSColor *> *backgroundColors;
+
+/// Strings that start a list item, e.g. the editor's bullet string. Setting this recounts.
+@property (nonatomic, copy) NSArray<NSString *> *listMarkers;
+
+/// Statistics that follow textStorage. paragraphIndex must be an index of the same text storage;
+/// it is used to find which paragraphs an edit replaced. If it is nil the statistics make their own.
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage paragraphIndex:(RichTextEditorParagraphIndex *)paragraphIndex;
+
+/// Counts everything again from the text.
+- (void)rebuild;
+
+/// Counts a copy of the text again on a background queue and compares the result with the
+/// current values. If they differ (and the text hasn't been edited in the meantime) the
+/// statistics are rebuilt. completion is called on the main queue with NO if they differed.
+- (void)verifyInBackgroundWithCompletion:(void (^)(BOOL consistent))completion;
+
+/// All values as property list types (fonts by name and size, colors by description), for
+/// comparing and logging.
+- (NSDictionary *)snapshot;
+
+@end
@@ -0,0 +1,520 @@
+//
+//  RichTextEditorStatistics.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorStatistics.h"
+#import "RichTextEditorParagraphIndex.h"
+
+#define RTE_STATISTICS_SCAN_BUFFER_SIZE 1024
+
+typedef struct {
+    NSUInteger characterCount;
+    NSUInteger wordCount;
+    NSUInteger signature; // index into signatures
+    BOOL isListItem;
+} RTEParagraphStatistics;
+
+// Start of the paragraph holding location
+static NSUInteger RTEParagraphStart(NSString *string, NSUInteger location) {
+    unichar buffer[RTE_STATISTICS_SCAN_BUFFER_SIZE];
+    while (location > 0) {
+        NSUInteger chunkLength = MIN((NSUInteger)RTE_STATISTICS_SCAN_BUFFER_SIZE, location);
+        [string getCharacters:buffer range:NSMakeRange(location - chunkLength, chunkLength)];
+        for (NSUInteger i = chunkLength; i > 0; i--) {
+            if (buffer[i - 1] == '\n') {
+                return location - chunkLength + i;
+            }
+        }
+        location -= chunkLength;
+    }
+    return 0;
+}
+
+// End (the newline, or the end of the text) of the paragraph holding location
+static NSUInteger RTEParagraphEnd(NSString *string, NSUInteger location) {
+    unichar buffer[RTE_STATISTICS_SCAN_BUFFER_SIZE];
+    NSUInteger length = string.length;
+    while (location < length) {
+        NSUInteger chunkLength = MIN((NSUInteger)RTE_STATISTICS_SCAN_BUFFER_SIZE, length - location);
+        [string getCharacters:buffer range:NSMakeRange(location, chunkLength)];
+        for (NSUInteger i = 0; i < chunkLength; i++) {
+            if (buffer[i] == '\n') {
+                return location + i;
+            }
+        }
+        location += chunkLength;
+    }
+    return length;
+}
+
+static NSUInteger RTEWordCount(NSString *string, NSRange range) {
+    CFCharacterSetRef whitespace = CFCharacterSetGetPredefined(kCFCharacterSetWhitespaceAndNewline);
+    unichar buffer[RTE_STATISTICS_SCAN_BUFFER_SIZE];
+    NSUInteger wordCount = 0;
+    BOOL isInWord = NO;
+    NSUInteger location = range.location;
+    NSUInteger end = NSMaxRange(range);
+    while (location < end) {
+        NSUInteger chunkLength = MIN((NSUInteger)RTE_STATISTICS_SCAN_BUFFER_SIZE, end - location);
+        [string getCharacters:buffer range:NSMakeRange(location, chunkLength)];
+        for (NSUInteger i = 0; i < chunkLength; i++) {
+            BOOL isWhitespace = CFCharacterSetIsCharacterMember(whitespace, buffer[i]);
+            if (!isWhitespace && !isInWord) {
+                wordCount++;
+            }
+            isInWord = !isWhitespace;
+        }
+        location += chunkLength;
+    }
+    return wordCount;
+}
+
+// The fonts and colors one paragraph uses. Most paragraphs share one with many others, so the
+// statistics keep each distinct one once and count the paragraphs using it.
+@interface RTEStyleSignature : NSObject {
+    NSUInteger _hash;
+}
+
+@property (readonly) NSSet *fonts;
+@property (readonly) NSSet *textColors;
+@property (readonly) NSSet *backgroundColors;
+
+@end
+
+@implementation RTEStyleSignature
+
+- (instancetype)initWithFonts:(NSSet *)fonts textColors:(NSSet *)textColors backgroundColors:(NSSet *)backgroundColors {
+    if (self = [super init]) {
+        _fonts = [fonts copy];
+        _textColors = [textColors copy];
+        _backgroundColors = [backgroundColors copy];
+        // -[NSSet hash] is just the count
+        for (NSSet *set in @[_fonts, _textColors, _backgroundColors]) {
+            for (id value in set) {
+                _hash ^= [value hash];
+            }
+            _hash = _hash * 31 + set.count;
+        }
+    }
+    return self;
+}
+
+- (NSUInteger)hash {
+    return _hash;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[RTEStyleSignature class]]) {
+        return NO;
+    }
+    RTEStyleSignature *other = object;
+    return _hash == other->_hash && [self.fonts isEqualToSet:other.fonts] &&
+        [self.textColors isEqualToSet:other.textColors] && [self.backgroundColors isEqualToSet:other.backgroundColors];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+@end
+
+@interface RichTextEditorStatistics () {
+    RTEParagraphStatistics *_paragraphs;
+    NSUInteger _paragraphCount;
+    NSUInteger _paragraphCapacity;
+    NSUInteger _length; // length of the text the counts describe
+    NSUInteger _wordCount;
+    NSUInteger _characterCount;
+    NSUInteger _listItemCount;
+    BOOL _hasPendingEdit;
+    NSUInteger _pendingFirstParagraph;
+    NSUInteger _pendingLastParagraph;
+    NSUInteger _editCount;
+}
+
+@property NSAttributedString *source;
+@property RichTextEditorParagraphIndex *paragraphIndex;
+
+@property NSMutableArray<RTEStyleSignature *> *signatures;
+@property NSMutableDictionary<RTEStyleSignature *, NSNumber *> *signatureIndexes;
+@property NSMutableData *signatureUseCounts; // NSUInteger per signature: paragraphs using it
+@property NSCountedSet *fontCounts; // per font: signatures in use that have it
+@property NSCountedSet *textColorCounts;
+@property NSCountedSet *backgroundColorCounts;
+@property (nonatomic, readwrite) NSSet *fonts;
+@property (nonatomic, readwrite) NSSet *textColors;
+@property (nonatomic, readwrite) NSSet *backgroundColors;
+
+// A paragraph that is one run whose attributes are the same object as those of the last such
+// paragraph gets the same signature without looking at the attributes
+@property NSDictionary *lastSingleRunAttributes;
+@property NSUInteger lastSingleRunSignature;
+
+@end
+
+@implementation RichTextEditorStatistics
+
+- (instancetype)initWithSource:(NSAttributedString *)source listMarkers:(NSArray<NSString *> *)listMarkers {
+    if (self = [super init]) {
+        _source = source;
+        _listMarkers = [listMarkers copy];
+        [self rebuild];
+    }
+    return self;
+}
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage paragraphIndex:(RichTextEditorParagraphIndex *)paragraphIndex {
+    if (self = [self initWithSource:textStorage listMarkers:@[]]) {
+        _textStorage = textStorage;
+        _paragraphIndex = paragraphIndex ?: [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(textStorageWillProcessEditing:)
+                                                     name:NSTextStorageWillProcessEditingNotification
+                                                   object:textStorage];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(textStorageDidProcessEditing:)
+                                                     name:NSTextStorageDidProcessEditingNotification
+                                                   object:textStorage];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    free(_paragraphs);
+}
+
+- (NSUInteger)wordCount {
+    return _wordCount;
+}
+
+- (NSUInteger)characterCount {
+    return _characterCount;
+}
+
+- (NSUInteger)paragraphCount {
+    return _paragraphCount;
+}
+
+- (NSUInteger)listItemCount {
+    return _listItemCount;
+}
+
+- (NSSet<NSFont *> *)fonts {
+    if (!_fonts) {
+        _fonts = [NSSet setWithArray:self.fontCounts.allObjects];
+    }
+    return _fonts;
+}
+
+- (NSSet<NSColor *> *)textColors {
+    if (!_textColors) {
+        _textColors = [NSSet setWithArray:self.textColorCounts.allObjects];
+    }
+    return _textColors;
+}
+
+- (NSSet<NSColor *> *)backgroundColors {
+    if (!_backgroundColors) {
+        _backgroundColors = [NSSet setWithArray:self.backgroundColorCounts.allObjects];
+    }
+    return _backgroundColors;
+}
+
+- (void)setListMarkers:(NSArray<NSString *> *)listMarkers {
+    if ([_listMarkers isEqualToArray:listMarkers]) {
+        return;
+    }
+    _listMarkers = [listMarkers copy];
+    [self rebuild];
+}
+
+#pragma mark - Counting -
+
+- (void)ensureCapacity:(NSUInteger)capacity {
+    if (capacity <= _paragraphCapacity) {
+        return;
+    }
+    NSUInteger newCapacity = MAX(_paragraphCapacity * 2, (NSUInteger)64);
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    _paragraphs = realloc(_paragraphs, newCapacity * sizeof(RTEParagraphStatistics));
+    _paragraphCapacity = newCapacity;
+}
+
+- (void)rebuild {
+    _paragraphCount = 0;
+    _wordCount = 0;
+    _characterCount = 0;
+    _listItemCount = 0;
+    _hasPendingEdit = NO;
+    _editCount++;
+    self.signatures = [NSMutableArray array];
+    self.signatureIndexes = [NSMutableDictionary dictionary];
+    self.signatureUseCounts = [NSMutableData data];
+    self.fontCounts = [NSCountedSet set];
+    self.textColorCounts = [NSCountedSet set];
+    self.backgroundColorCounts = [NSCountedSet set];
+    self.fonts = nil;
+    self.textColors = nil;
+    self.backgroundColors = nil;
+    self.lastSingleRunAttributes = nil;
+
+    NSString *string = self.source.string;
+    _length = string.length;
+    [self enumerateParagraphsOfString:string inRange:NSMakeRange(0, _length) usingBlock:^(NSRange paragraphRange) {
+        RTEParagraphStatistics paragraph = [self statisticsOfParagraphInRange:paragraphRange string:string];
+        [self ensureCapacity:self->_paragraphCount + 1];
+        self->_paragraphs[self->_paragraphCount++] = paragraph;
+        [self addParagraph:paragraph];
+    }];
+}
+
+// range starts at the start of a paragraph and ends at the end of one; the last paragraph may be empty
+- (void)enumerateParagraphsOfString:(NSString *)string inRange:(NSRange)range usingBlock:(void (^)(NSRange paragraphRange))block {
+    unichar buffer[RTE_STATISTICS_SCAN_BUFFER_SIZE];
+    NSUInteger paragraphStart = range.location;
+    NSUInteger location = range.location;
+    NSUInteger end = NSMaxRange(range);
+    while (location < end) {
+        NSUInteger chunkLength = MIN((NSUInteger)RTE_STATISTICS_SCAN_BUFFER_SIZE, end - location);
+        [string getCharacters:buffer range:NSMakeRange(location, chunkLength)];
+        for (NSUInteger i = 0; i < chunkLength; i++) {
+            if (buffer[i] == '\n') {
+                block(NSMakeRange(paragraphStart, location + i - paragraphStart));
+                paragraphStart = location + i + 1;
+            }
+        }
+        location += chunkLength;
+    }
+    block(NSMakeRange(paragraphStart, end - paragraphStart));
+}
+
+- (RTEParagraphStatistics)statisticsOfParagraphInRange:(NSRange)range string:(NSString *)string {
+    RTEParagraphStatistics paragraph = {0, 0, 0, NO};
+    NSUInteger markerLength = 0;
+    for (NSString *marker in self.listMarkers) {
+        if (range.length >= marker.length &&
+            [string compare:marker options:NSLiteralSearch range:NSMakeRange(range.location, marker.length)] == NSOrderedSame) {
+            markerLength = marker.length;
+            paragraph.isListItem = YES;
+            break;
+        }
+    }
+    NSRange textRange = NSMakeRange(range.location + markerLength, range.length - markerLength);
+    paragraph.characterCount = textRange.length;
+    paragraph.wordCount = RTEWordCount(string, textRange);
+    paragraph.signature = [self signatureOfParagraphInRange:range];
+    return paragraph;
+}
+
+- (NSUInteger)signatureOfParagraphInRange:(NSRange)range {
+    NSMutableSet *fonts = [NSMutableSet set];
+    NSMutableSet *textColors = [NSMutableSet set];
+    NSMutableSet *backgroundColors = [NSMutableSet set];
+    NSUInteger location = range.location;
+    while (location < NSMaxRange(range)) {
+        NSRange runRange;
+        NSDictionary *attributes = [self.source attributesAtIndex:location effectiveRange:&runRange];
+        if (location == range.location && NSMaxRange(runRange) >= NSMaxRange(range)) {
+            if (attributes == self.lastSingleRunAttributes) {
+                return self.lastSingleRunSignature;
+            }
+            NSUInteger signature = [self signatureForAttributes:attributes];
+            self.lastSingleRunAttributes = attributes;
+            self.lastSingleRunSignature = signature;
+            return signature;
+        }
+        [self addAttributes:attributes toFonts:fonts textColors:textColors backgroundColors:backgroundColors];
+        location = NSMaxRange(runRange);
+    }
+    return [self internSignature:[[RTEStyleSignature alloc] initWithFonts:fonts textColors:textColors backgroundColors:backgroundColors]];
+}
+
+- (NSUInteger)signatureForAttributes:(NSDictionary *)attributes {
+    NSMutableSet *fonts = [NSMutableSet set];
+    NSMutableSet *textColors = [NSMutableSet set];
+    NSMutableSet *backgroundColors = [NSMutableSet set];
+    [self addAttributes:attributes toFonts:fonts textColors:textColors backgroundColors:backgroundColors];
+    return [self internSignature:[[RTEStyleSignature alloc] initWithFonts:fonts textColors:textColors backgroundColors:backgroundColors]];
+}
+
+- (void)addAttributes:(NSDictionary *)attributes toFonts:(NSMutableSet *)fonts textColors:(NSMutableSet *)textColors backgroundColors:(NSMutableSet *)backgroundColors {
+    id font = attributes[NSFontAttributeName];
+    id textColor = attributes[NSForegroundColorAttributeName];
+    id backgroundColor = attributes[NSBackgroundColorAttributeName];
+    if (font) {
+        [fonts addObject:font];
+    }
+    if (textColor) {
+        [textColors addObject:textColor];
+    }
+    if (backgroundColor) {
+        [backgroundColors addObject:backgroundColor];
+    }
+}
+
+- (NSUInteger)internSignature:(RTEStyleSignature *)signature {
+    NSNumber *index = self.signatureIndexes[signature];
+    if (index) {
+        return index.unsignedIntegerValue;
+    }
+    NSUInteger newIndex = self.signatures.count;
+    [self.signatures addObject:signature];
+    self.signatureIndexes[signature] = @(newIndex);
+    NSUInteger useCount = 0;
+    [self.signatureUseCounts appendBytes:&useCount length:sizeof(NSUInteger)];
+    return newIndex;
+}
+
+- (void)addParagraph:(RTEParagraphStatistics)paragraph {
+    _wordCount += paragraph.wordCount;
+    _characterCount += paragraph.characterCount;
+    _listItemCount += paragraph.isListItem ? 1 : 0;
+    NSUInteger *useCounts = self.signatureUseCounts.mutableBytes;
+    if (useCounts[paragraph.signature]++ == 0) {
+        [self updateStyleCountsForSignature:self.signatures[paragraph.signature] inUse:YES];
+    }
+}
+
+- (void)removeParagraph:(RTEParagraphStatistics)paragraph {
+    _wordCount -= paragraph.wordCount;
+    _characterCount -= paragraph.characterCount;
+    _listItemCount -= paragraph.isListItem ? 1 : 0;
+    NSUInteger *useCounts = self.signatureUseCounts.mutableBytes;
+    if (--useCounts[paragraph.signature] == 0) {
+        [self updateStyleCountsForSignature:self.signatures[paragraph.signature] inUse:NO];
+    }
+}
+
+// Only called when a signature starts or stops being used, which typing almost never does
+- (void)updateStyleCountsForSignature:(RTEStyleSignature *)signature inUse:(BOOL)inUse {
+    NSArray *pairs = @[@[signature.fonts, self.fontCounts], @[signature.textColors, self.textColorCounts],
+                       @[signature.backgroundColors, self.backgroundColorCounts]];
+    for (NSArray *pair in pairs) {
+        NSCountedSet *counts = pair[1];
+        for (id value in pair[0]) {
+            if (inUse) {
+                [counts addObject:value];
+            }
+            else {
+                [counts removeObject:value];
+            }
+        }
+    }
+    self.fonts = nil;
+    self.textColors = nil;
+    self.backgroundColors = nil;
+}
+
+#pragma mark - Updating -
+
+- (void)textStorageWillProcessEditing:(NSNotification *)notification {
+    NSTextStorage *textStorage = notification.object;
+    NSRange editedRange = textStorage.editedRange;
+    NSInteger oldEditedLength = (NSInteger)editedRange.length - textStorage.changeInLength;
+    // The paragraph index catches up once the edit has been processed, so right now it still
+    // describes the text our counts are for and can say which paragraphs the edit replaced
+    RichTextEditorParagraphIndex *paragraphIndex = self.paragraphIndex;
+    _hasPendingEdit = editedRange.location != NSNotFound && oldEditedLength >= 0 &&
+        paragraphIndex.length == _length && paragraphIndex.paragraphCount == _paragraphCount &&
+        editedRange.location + (NSUInteger)oldEditedLength <= _length;
+    if (_hasPendingEdit) {
+        _pendingFirstParagraph = [paragraphIndex paragraphIndexAtLocation:editedRange.location];
+        _pendingLastParagraph = [paragraphIndex paragraphIndexAtLocation:editedRange.location + (NSUInteger)oldEditedLength];
+    }
+}
+
+- (void)textStorageDidProcessEditing:(NSNotification *)notification {
+    NSTextStorage *textStorage = notification.object;
+    NSRange editedRange = textStorage.editedRange;
+    NSString *string = textStorage.string;
+    if (!_hasPendingEdit || (NSInteger)_length + textStorage.changeInLength != (NSInteger)string.length ||
+        NSMaxRange(editedRange) > string.length) {
+        // We missed an edit somewhere; start over rather than guessing.
+        [self rebuild];
+        return;
+    }
+    _hasPendingEdit = NO;
+    _editCount++;
+
+    // The edit replaced whole paragraphs _pendingFirstParagraph...Last with the paragraphs around editedRange
+    NSUInteger start = RTEParagraphStart(string, editedRange.location);
+    NSUInteger end = RTEParagraphEnd(string, NSMaxRange(editedRange));
+    NSMutableData *insertedData = [NSMutableData data];
+    [self enumerateParagraphsOfString:string inRange:NSMakeRange(start, end - start) usingBlock:^(NSRange paragraphRange) {
+        RTEParagraphStatistics paragraph = [self statisticsOfParagraphInRange:paragraphRange string:string];
+        [insertedData appendBytes:&paragraph length:sizeof(RTEParagraphStatistics)];
+    }];
+    const RTEParagraphStatistics *inserted = insertedData.bytes;
+    NSUInteger insertedCount = insertedData.length / sizeof(RTEParagraphStatistics);
+    NSUInteger firstRemoved = _pendingFirstParagraph;
+    NSUInteger removedCount = _pendingLastParagraph - firstRemoved + 1;
+    NSUInteger tailCount = _paragraphCount - firstRemoved - removedCount;
+
+    // Add before removing so that a style used before and after the edit stays counted
+    for (NSUInteger i = 0; i < insertedCount; i++) {
+        [self addParagraph:inserted[i]];
+    }
+    for (NSUInteger i = 0; i < removedCount; i++) {
+        [self removeParagraph:_paragraphs[firstRemoved + i]];
+    }
+    [self ensureCapacity:_paragraphCount - removedCount + insertedCount];
+    if (insertedCount != removedCount && tailCount > 0) {
+        memmove(_paragraphs + firstRemoved + insertedCount, _paragraphs + firstRemoved + removedCount, tailCount * sizeof(RTEParagraphStatistics));
+    }
+    memcpy(_paragraphs + firstRemoved, inserted, insertedCount * sizeof(RTEParagraphStatistics));
+    _paragraphCount = _paragraphCount - removedCount + insertedCount;
+    _length = string.length;
+}
+
+#pragma mark - Verifying -
+
+- (void)verifyInBackgroundWithCompletion:(void (^)(BOOL consistent))completion {
+    NSAttributedString *text = [[NSAttributedString alloc] initWithAttributedString:self.textStorage];
+    NSArray *listMarkers = self.listMarkers;
+    NSDictionary *current = [self snapshot];
+    NSUInteger editCount = _editCount;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        RichTextEditorStatistics *recount = [[RichTextEditorStatistics alloc] initWithSource:text listMarkers:listMarkers];
+        BOOL consistent = [[recount snapshot] isEqualToDictionary:current];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (!consistent) {
+                if (editCount == self->_editCount) {
+                    [self rebuild];
+                }
+            }
+            if (completion) {
+                completion(consistent);
+            }
+        });
+    });
+}
+
+- (NSDictionary *)snapshot {
+    NSMutableArray *fonts = [NSMutableArray array];
+    for (NSFont *font in self.fonts) {
+        [fonts addObject:[NSString stringWithFormat:@"%@ %g", font.fontName, font.pointSize]];
+    }
+    NSMutableArray *textColors = [NSMutableArray array];
+    for (NSColor *color in self.textColors) {
+        [textColors addObject:color.description];
+    }
+    NSMutableArray *backgroundColors = [NSMutableArray array];
+    for (NSColor *color in self.backgroundColors) {
+        [backgroundColors addObject:color.description];
+    }
+    return @{@"wordCount": @(self.wordCount),
+             @"characterCount": @(self.characterCount),
+             @"paragraphCount": @(self.paragraphCount),
+             @"listItemCount": @(self.listItemCount),
+             @"fonts": [fonts sortedArrayUsingSelector:@selector(compare:)],
+             @"textColors": [textColors sortedArrayUsingSelector:@selector(compare:)],
+             @"backgroundColors": [backgroundColors sortedArrayUsingSelector:@selector(compare:)]};
+}
+
+@end
@@ -0,0 +1,61 @@
+//
+//  RichTextEditorStyleTransform.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFoundationText.h"
+
+@class RichTextEditorAttributeInterner;
+
+/// Changes the fonts of a range of text in two phases, so that a document-wide change costs one
+/// font lookup per distinct font instead of one per attribute run:
+///
+/// 1. initWithAttributedString:range: scans the font runs and collects the distinct fonts.
+/// 2. planWithFontMapping: calls the mapping once per distinct font.
+/// 3. applyToTextStorage: sets the new fonts in a single beginEditing/endEditing transaction.
+///    Neighbouring runs that end up with the same font are set with one call, so they merge
+///    back into one run wherever the rest of their attributes match.
+///
+/// Steps 1 and 2 only read the string they were given, so they can run on a background queue
+/// from a copy of the text storage; step 3 must run wherever the text storage is edited.
+///
+///     NSAttributedString *snapshot = [textStorage copy];
+///     dispatch_async(queue, ^{
+///         RichTextEditorStyleTransform *transform = [[RichTextEditorStyleTransform alloc] initWithAttributedString:snapshot range:range];
+///         [transform planWithFontMapping:mapping];
+///         dispatch_async(dispatch_get_main_queue(), ^{
+///             [transform applyToTextStorage:textStorage];
+///         });
+///     });
+@interface RichTextEditorStyleTransform : NSObject
+
+@property (nonatomic, readonly) NSRange range;
+
+/// If set, the planned fonts are interned when they are applied (on the queue that applies them).
+@property (nonatomic) RichTextEditorAttributeInterner *attributeInterner;
+
+/// Number of font runs found in range (neighbouring characters with the same font are one run,
+/// whatever their other attributes are).
+@property (nonatomic, readonly) NSUInteger runCount;
+
+/// Number of distinct fonts in range, counting "no font" as one.
+@property (nonatomic, readonly) NSUInteger distinctFontCount;
+
+/// Number of font runs planWithFontMapping: gave a different font. 0 before planning.
+@property (nonatomic, readonly) NSUInteger changedRunCount;
+
+/// Scans the font runs of string in range.
+- (instancetype)initWithAttributedString:(NSAttributedString *)string range:(NSRange)range;
+
+/// Works out the new font of every distinct font. mapping is called once per distinct font (with
+/// nil for text that has no font) and returns the font to use instead, or nil to leave the
+/// text alone. mapping may be called on the current queue, so it must be safe to use there.
+- (void)planWithFontMapping:(NSFont *(^)(NSFont *font))mapping;
+
+/// Applies the planned fonts. Returns NO without changing anything if the text storage no
+/// longer has the fonts that were scanned (e.g. it was edited after a background scan).
+- (BOOL)applyToTextStorage:(NSMutableAttributedString *)textStorage;
+
+@end
@@ -0,0 +1,149 @@
+//
+//  RichTextEditorStyleTransform.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorStyleTransform.h"
+#import "RichTextEditorAttributeInterner.h"
+
+typedef struct {
+    NSRange range;
+    NSUInteger fontIndex;
+} RTEStyleRun;
+
+@interface RichTextEditorStyleTransform ()
+
+@property (nonatomic, readwrite) NSUInteger changedRunCount;
+
+@property NSUInteger stringLength;
+@property NSMutableData *runs;
+@property NSMutableArray *sourceFonts; // NSNull for text without a font
+@property NSArray *targetFonts; // NSNull where the font doesn't change
+
+@end
+
+@implementation RichTextEditorStyleTransform
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)string range:(NSRange)range {
+    if (self = [super init]) {
+        if (NSMaxRange(range) > string.length) {
+            range = NSMakeRange(MIN(range.location, string.length), 0);
+            range.length = string.length - range.location;
+        }
+        _range = range;
+        _stringLength = string.length;
+        _runs = [NSMutableData data];
+        _sourceFonts = [NSMutableArray array];
+        NSMutableDictionary *fontIndexes = [NSMutableDictionary dictionary];
+        __block id lastFont = nil;
+        __block NSUInteger lastFontIndex = 0;
+        // Options 0 gives the longest range per font, so runs that only differ in other attributes are one run here
+        [string enumerateAttribute:NSFontAttributeName inRange:range options:0 usingBlock:^(id value, NSRange runRange, BOOL *stop) {
+            id font = value ?: [NSNull null];
+            if (font != lastFont) {
+                NSNumber *index = fontIndexes[font];
+                if (!index) {
+                    index = @(self.sourceFonts.count);
+                    fontIndexes[font] = index;
+                    [self.sourceFonts addObject:font];
+                }
+                lastFont = font;
+                lastFontIndex = index.unsignedIntegerValue;
+            }
+            RTEStyleRun run = { runRange, lastFontIndex };
+            [self.runs appendBytes:&run length:sizeof(RTEStyleRun)];
+        }];
+    }
+    return self;
+}
+
+- (NSUInteger)runCount {
+    return self.runs.length / sizeof(RTEStyleRun);
+}
+
+- (NSUInteger)distinctFontCount {
+    return self.sourceFonts.count;
+}
+
+- (void)planWithFontMapping:(NSFont *(^)(NSFont *font))mapping {
+    NSMutableArray *targetFonts = [NSMutableArray arrayWithCapacity:self.sourceFonts.count];
+    for (id sourceFont in self.sourceFonts) {
+        NSFont *font = sourceFont == [NSNull null] ? nil : sourceFont;
+        NSFont *targetFont = mapping(font);
+        [targetFonts addObject:(targetFont && ![targetFont isEqual:font]) ? targetFont : [NSNull null]];
+    }
+    self.targetFonts = targetFonts;
+    const RTEStyleRun *runs = self.runs.bytes;
+    NSUInteger changedRunCount = 0;
+    for (NSUInteger i = 0; i < self.runCount; i++) {
+        if (targetFonts[runs[i].fontIndex] != [NSNull null]) {
+            changedRunCount++;
+        }
+    }
+    self.changedRunCount = changedRunCount;
+}
+
+- (BOOL)textStorageMatchesScan:(NSAttributedString *)textStorage {
+    if (textStorage.length != self.stringLength) {
+        return NO;
+    }
+    const RTEStyleRun *runs = self.runs.bytes;
+    for (NSUInteger i = 0; i < self.runCount; i++) {
+        if (self.targetFonts[runs[i].fontIndex] == [NSNull null]) {
+            continue;
+        }
+        id sourceFont = self.sourceFonts[runs[i].fontIndex];
+        NSFont *font = [textStorage attribute:NSFontAttributeName atIndex:runs[i].range.location effectiveRange:NULL];
+        if (!(font == sourceFont || (!font && sourceFont == [NSNull null]) || [font isEqual:sourceFont])) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (BOOL)applyToTextStorage:(NSMutableAttributedString *)textStorage {
+    if (!self.targetFonts) {
+        return NO; // not planned
+    }
+    if (self.changedRunCount == 0) {
+        return YES;
+    }
+    if (![self textStorageMatchesScan:textStorage]) {
+        return NO;
+    }
+    if (self.attributeInterner) {
+        NSMutableArray *targetFonts = [NSMutableArray arrayWithCapacity:self.targetFonts.count];
+        for (id targetFont in self.targetFonts) {
+            [targetFonts addObject:targetFont == [NSNull null] ? targetFont : [self.attributeInterner internedFont:targetFont]];
+        }
+        self.targetFonts = targetFonts;
+    }
+    const RTEStyleRun *runs = self.runs.bytes;
+    NSRange pendingRange = NSMakeRange(NSNotFound, 0);
+    NSFont *pendingFont = nil;
+    [textStorage beginEditing];
+    for (NSUInteger i = 0; i < self.runCount; i++) {
+        id targetFont = self.targetFonts[runs[i].fontIndex];
+        if (targetFont == [NSNull null]) {
+            continue;
+        }
+        if (targetFont == pendingFont && NSMaxRange(pendingRange) == runs[i].range.location) {
+            pendingRange.length += runs[i].range.length;
+            continue;
+        }
+        if (pendingFont) {
+            [textStorage addAttribute:NSFontAttributeName value:pendingFont range:pendingRange];
+        }
+        pendingFont = targetFont;
+        pendingRange = runs[i].range;
+    }
+    if (pendingFont) {
+        [textStorage addAttribute:NSFontAttributeName value:pendingFont range:pendingRange];
+    }
+    [textStorage endEditing];
+    return YES;
+}
+
+@end
@@ -0,0 +1,70 @@
+//
+//  RichTextEditorUndoJournal.h
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+/// Undo/redo history for an NSTextStorage that stores each command as a compact delta:
+/// the location, the text (with attributes) it replaced and the text it left behind.
+/// Attribute-only changes keep the new attribute runs instead of a second copy of the text.
+///
+/// Edits are recorded in groups. A group is told up front which range of the text it may
+/// change; that range is saved when the group starts and compared with the result when it
+/// ends, and the unchanged start and end are trimmed off. Every edit to the text storage is
+/// watched: if characters change outside of a group (or outside the range a group declared),
+/// the history can no longer be replayed and is discarded.
+///
+/// History is limited by size (byteBudget) rather than by number of steps; the oldest entries
+/// are dropped first.
+@interface RichTextEditorUndoJournal : NSObject
+
+@property (nonatomic, readonly) NSTextStorage *textStorage;
+
+/// Approximate maximum number of bytes of history to keep. Defaults to 8 MB.
+/// The most recent entry is always kept, even if it is larger than the budget.
+@property (nonatomic) NSUInteger byteBudget;
+
+/// Approximate number of bytes used by the undo and redo entries.
+@property (nonatomic, readonly) NSUInteger byteCount;
+
+@property (nonatomic, readonly) NSUInteger undoCount;
+@property (nonatomic, readonly) NSUInteger redoCount;
+@property (nonatomic, readonly) BOOL canUndo;
+@property (nonatomic, readonly) BOOL canRedo;
+
+/// YES between beginGroupInRange:... and the matching endGroupWithSelectedRange:.
+@property (nonatomic, readonly) BOOL isGrouping;
+
+/// Number of times the history was thrown away because of an edit the journal couldn't record.
+@property (nonatomic, readonly) NSUInteger discardedHistoryCount;
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage;
+
+/// Starts a group that may change the characters and attributes in range (in the current text).
+/// selectedRange is restored when the group is undone.
+/// If coalescing is YES and the previous entry was also coalescing, the two are merged into one
+/// entry when the new change touches the text the previous one left behind (e.g. typing a word).
+/// Groups may be nested; only the outermost one is recorded and its range must cover the others.
+- (void)beginGroupInRange:(NSRange)range selectedRange:(NSRange)selectedRange coalescing:(BOOL)coalescing;
+
+/// Ends the current group. selectedRange is restored when the group is redone.
+/// Nothing is recorded if the group didn't change anything.
+- (void)endGroupWithSelectedRange:(NSRange)selectedRange;
+
+/// Makes sure the next group is not merged with the previous one.
+- (void)breakCoalescing;
+
+/// Reverts the most recent entry. Returns the selection to restore, or NSNotFound if there
+/// was nothing to undo.
+- (NSRange)undo;
+
+/// Re-applies the most recently undone entry. Returns the selection to restore, or NSNotFound
+/// if there was nothing to redo.
+- (NSRange)redo;
+
+- (void)removeAllEntries;
+
+@end
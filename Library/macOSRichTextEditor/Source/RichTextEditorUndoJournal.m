@@ -0,0 +1,427 @@
+//
+//  RichTextEditorUndoJournal.m
+//  macOSRichTextEditor
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorUndoJournal.h"
+
+#define RTE_COMPARE_BUFFER_SIZE 128
+// Rough per-object costs used for the byte budget
+#define RTE_ENTRY_OVERHEAD 96
+#define RTE_ATTRIBUTE_RUN_COST 32
+
+static NSUInteger RTEAttributeRunCount(NSAttributedString *string) {
+    __block NSUInteger count = 0;
+    [string enumerateAttributesInRange:NSMakeRange(0, string.length) options:0 usingBlock:^(NSDictionary *attrs, NSRange range, BOOL *stop) {
+        count++;
+    }];
+    return count;
+}
+
+// Number of characters at the start of a and b that have the same characters and attributes
+static NSUInteger RTECommonPrefixLength(NSAttributedString *a, NSAttributedString *b) {
+    NSString *aString = a.string;
+    NSString *bString = b.string;
+    NSUInteger maximum = MIN(aString.length, bString.length);
+    unichar aBuffer[RTE_COMPARE_BUFFER_SIZE];
+    unichar bBuffer[RTE_COMPARE_BUFFER_SIZE];
+    NSUInteger length = 0;
+    while (length < maximum) {
+        NSUInteger chunkLength = MIN((NSUInteger)RTE_COMPARE_BUFFER_SIZE, maximum - length);
+        [aString getCharacters:aBuffer range:NSMakeRange(length, chunkLength)];
+        [bString getCharacters:bBuffer range:NSMakeRange(length, chunkLength)];
+        NSUInteger i = 0;
+        while (i < chunkLength && aBuffer[i] == bBuffer[i]) {
+            i++;
+        }
+        length += i;
+        if (i < chunkLength) {
+            break;
+        }
+    }
+    NSUInteger matched = 0;
+    while (matched < length) {
+        NSRange aRange, bRange;
+        NSDictionary *aAttributes = [a attributesAtIndex:matched effectiveRange:&aRange];
+        NSDictionary *bAttributes = [b attributesAtIndex:matched effectiveRange:&bRange];
+        if (![aAttributes isEqualToDictionary:bAttributes]) {
+            break;
+        }
+        matched = MIN(NSMaxRange(aRange), NSMaxRange(bRange));
+    }
+    return MIN(matched, length);
+}
+
+// Number of characters (at most limit) at the end of a and b that have the same characters and attributes
+static NSUInteger RTECommonSuffixLength(NSAttributedString *a, NSAttributedString *b, NSUInteger limit) {
+    NSString *aString = a.string;
+    NSString *bString = b.string;
+    NSUInteger aLength = aString.length;
+    NSUInteger bLength = bString.length;
+    NSUInteger maximum = MIN(MIN(aLength, bLength), limit);
+    unichar aBuffer[RTE_COMPARE_BUFFER_SIZE];
+    unichar bBuffer[RTE_COMPARE_BUFFER_SIZE];
+    NSUInteger length = 0;
+    while (length < maximum) {
+        NSUInteger chunkLength = MIN((NSUInteger)RTE_COMPARE_BUFFER_SIZE, maximum - length);
+        [aString getCharacters:aBuffer range:NSMakeRange(aLength - length - chunkLength, chunkLength)];
+        [bString getCharacters:bBuffer range:NSMakeRange(bLength - length - chunkLength, chunkLength)];
+        NSUInteger i = chunkLength;
+        while (i > 0 && aBuffer[i - 1] == bBuffer[i - 1]) {
+            i--;
+        }
+        length += chunkLength - i;
+        if (i > 0) {
+            break;
+        }
+    }
+    NSUInteger matched = 0;
+    while (matched < length) {
+        NSUInteger aIndex = aLength - matched - 1;
+        NSUInteger bIndex = bLength - matched - 1;
+        NSRange aRange, bRange;
+        NSDictionary *aAttributes = [a attributesAtIndex:aIndex effectiveRange:&aRange];
+        NSDictionary *bAttributes = [b attributesAtIndex:bIndex effectiveRange:&bRange];
+        if (![aAttributes isEqualToDictionary:bAttributes]) {
+            break;
+        }
+        matched += MIN(aIndex - aRange.location, bIndex - bRange.location) + 1;
+    }
+    return MIN(matched, length);
+}
+
+#pragma mark - Entries -
+
+/// One undoable change: at location, before was replaced by the "after" text.
+/// If only attributes changed, the after text is before.string with afterAttributes applied over afterRunRanges.
+@interface RichTextEditorUndoEntry : NSObject
+
+@property (readonly) NSUInteger location;
+@property (readonly) NSAttributedString *before;
+@property (readonly) NSAttributedString *after;
+@property (readonly) NSArray *afterAttributes;
+@property (readonly) NSData *afterRunRanges;
+@property (readonly) NSUInteger cost;
+@property NSRange selectionBefore;
+@property NSRange selectionAfter;
+@property BOOL coalescing;
+
+@end
+
+@implementation RichTextEditorUndoEntry
+
+- (instancetype)initWithLocation:(NSUInteger)location before:(NSAttributedString *)before after:(NSAttributedString *)after {
+    if (self = [super init]) {
+        _location = location;
+        _before = before;
+        NSUInteger cost = RTE_ENTRY_OVERHEAD + before.length * sizeof(unichar) + RTEAttributeRunCount(before) * RTE_ATTRIBUTE_RUN_COST;
+        if (before.length > 0 && [before.string isEqualToString:after.string]) {
+            // Attribute change only; don't keep a second copy of the text
+            NSMutableArray *attributes = [NSMutableArray array];
+            NSMutableData *ranges = [NSMutableData data];
+            [after enumerateAttributesInRange:NSMakeRange(0, after.length) options:0 usingBlock:^(NSDictionary *attrs, NSRange range, BOOL *stop) {
+                [attributes addObject:attrs];
+                [ranges appendBytes:&range length:sizeof(NSRange)];
+            }];
+            _afterAttributes = attributes;
+            _afterRunRanges = ranges;
+            cost += attributes.count * RTE_ATTRIBUTE_RUN_COST;
+        }
+        else {
+            _after = after;
+            cost += after.length * sizeof(unichar) + RTEAttributeRunCount(after) * RTE_ATTRIBUTE_RUN_COST;
+        }
+        _cost = cost;
+    }
+    return self;
+}
+
+- (NSUInteger)afterLength {
+    return self.after ? self.after.length : self.before.length;
+}
+
+- (NSAttributedString *)afterAttributedString {
+    if (self.after) {
+        return self.after;
+    }
+    NSMutableAttributedString *after = [[NSMutableAttributedString alloc] initWithString:self.before.string];
+    const NSRange *ranges = self.afterRunRanges.bytes;
+    [after beginEditing];
+    for (NSUInteger i = 0; i < self.afterAttributes.count; i++) {
+        [after setAttributes:self.afterAttributes[i] range:ranges[i]];
+    }
+    [after endEditing];
+    return after;
+}
+
+@end
+
+#pragma mark - Journal -
+
+@interface RichTextEditorUndoJournal () {
+    NSUInteger _groupDepth;
+    NSRange _groupRange;
+    NSInteger _groupDelta;
+    NSUInteger _lengthAtGroupStart;
+    NSRange _groupSelection;
+    NSAttributedString *_groupBefore;
+    BOOL _groupCoalescing;
+    BOOL _groupChangedText;
+    BOOL _groupIsInvalid;
+    BOOL _isApplying;
+    BOOL _canCoalesceWithLastEntry;
+}
+
+@property NSMutableArray *undoEntries;
+@property NSMutableArray *redoEntries;
+@property (nonatomic, readwrite) NSUInteger byteCount;
+@property (nonatomic, readwrite) NSUInteger discardedHistoryCount;
+
+@end
+
+@implementation RichTextEditorUndoJournal
+
+- (instancetype)initWithTextStorage:(NSTextStorage *)textStorage {
+    if (self = [super init]) {
+        _textStorage = textStorage;
+        _byteBudget = 8 * 1024 * 1024;
+        _undoEntries = [NSMutableArray array];
+        _redoEntries = [NSMutableArray array];
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(textStorageDidProcessEditing:)
+                                                     name:NSTextStorageDidProcessEditingNotification
+                                                   object:textStorage];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (NSUInteger)undoCount {
+    return self.undoEntries.count;
+}
+
+- (NSUInteger)redoCount {
+    return self.redoEntries.count;
+}
+
+- (BOOL)canUndo {
+    return self.undoEntries.count > 0 && !self.isGrouping;
+}
+
+- (BOOL)canRedo {
+    return self.redoEntries.count > 0 && !self.isGrouping;
+}
+
+- (BOOL)isGrouping {
+    return _groupDepth > 0;
+}
+
+- (void)setByteBudget:(NSUInteger)byteBudget {
+    _byteBudget = byteBudget;
+    [self enforceByteBudget];
+}
+
+- (void)removeAllEntries {
+    [self.undoEntries removeAllObjects];
+    [self.redoEntries removeAllObjects];
+    self.byteCount = 0;
+    _canCoalesceWithLastEntry = NO;
+}
+
+- (void)discardHistory {
+    if (self.undoEntries.count > 0 || self.redoEntries.count > 0) {
+        self.discardedHistoryCount++;
+    }
+    [self removeAllEntries];
+}
+
+#pragma mark - Recording -
+
+- (void)textStorageDidProcessEditing:(NSNotification *)notification {
+    if (_isApplying) {
+        return;
+    }
+    NSTextStorage *textStorage = notification.object;
+    BOOL charactersChanged = (textStorage.editedMask & NSTextStorageEditedCharacters) != 0;
+    if (_groupDepth == 0) {
+        // Attribute-only changes (e.g. attribute fixing) leave every recorded location valid
+        if (charactersChanged) {
+            [self discardHistory];
+        }
+        return;
+    }
+    _groupChangedText = YES;
+    if (!charactersChanged) {
+        return;
+    }
+    NSRange editedRange = textStorage.editedRange;
+    NSInteger delta = textStorage.changeInLength;
+    NSInteger oldEditedLength = (NSInteger)editedRange.length - delta;
+    NSUInteger groupEnd = (NSUInteger)((NSInteger)NSMaxRange(_groupRange) + _groupDelta);
+    if (editedRange.location < _groupRange.location || oldEditedLength < 0 ||
+        editedRange.location + (NSUInteger)oldEditedLength > groupEnd) {
+        _groupIsInvalid = YES;
+    }
+    _groupDelta += delta;
+}
+
+- (void)beginGroupInRange:(NSRange)range selectedRange:(NSRange)selectedRange coalescing:(BOOL)coalescing {
+    if (_groupDepth++ > 0) {
+        return; // the outermost group records everything
+    }
+    if (NSMaxRange(range) > self.textStorage.length) {
+        range = NSMakeRange(MIN(range.location, self.textStorage.length), 0);
+        range.length = self.textStorage.length - range.location;
+    }
+    _groupRange = range;
+    _groupDelta = 0;
+    _lengthAtGroupStart = self.textStorage.length;
+    _groupSelection = selectedRange;
+    _groupBefore = [self.textStorage attributedSubstringFromRange:range];
+    _groupCoalescing = coalescing;
+    _groupChangedText = NO;
+    _groupIsInvalid = NO;
+}
+
+- (void)endGroupWithSelectedRange:(NSRange)selectedRange {
+    if (_groupDepth == 0 || --_groupDepth > 0) {
+        return;
+    }
+    NSAttributedString *before = _groupBefore;
+    _groupBefore = nil;
+    if (_groupIsInvalid) {
+        [self discardHistory];
+        return;
+    }
+    if (!_groupChangedText) {
+        return;
+    }
+    NSInteger delta = (NSInteger)self.textStorage.length - (NSInteger)_lengthAtGroupStart;
+    NSInteger afterLength = (NSInteger)_groupRange.length + delta;
+    if (afterLength < 0 || _groupRange.location + (NSUInteger)afterLength > self.textStorage.length) {
+        [self discardHistory];
+        return;
+    }
+    NSAttributedString *after = [self.textStorage attributedSubstringFromRange:NSMakeRange(_groupRange.location, (NSUInteger)afterLength)];
+    // The group range is usually generous (whole paragraphs); only keep what actually changed
+    NSUInteger prefixLength = RTECommonPrefixLength(before, after);
+    NSUInteger suffixLength = RTECommonSuffixLength(before, after, MIN(before.length, after.length) - prefixLength);
+    if (before.length == after.length && prefixLength + suffixLength == before.length) {
+        return; // nothing changed
+    }
+    before = [before attributedSubstringFromRange:NSMakeRange(prefixLength, before.length - prefixLength - suffixLength)];
+    after = [after attributedSubstringFromRange:NSMakeRange(prefixLength, after.length - prefixLength - suffixLength)];
+    RichTextEditorUndoEntry *entry = [[RichTextEditorUndoEntry alloc] initWithLocation:_groupRange.location + prefixLength before:before after:after];
+    entry.selectionBefore = _groupSelection;
+    entry.selectionAfter = selectedRange;
+    entry.coalescing = _groupCoalescing;
+
+    for (RichTextEditorUndoEntry *redoEntry in self.redoEntries) {
+        self.byteCount -= redoEntry.cost;
+    }
+    [self.redoEntries removeAllObjects];
+    if (!(_groupCoalescing && _canCoalesceWithLastEntry && [self coalesceEntry:entry])) {
+        [self.undoEntries addObject:entry];
+        self.byteCount += entry.cost;
+    }
+    _canCoalesceWithLastEntry = _groupCoalescing;
+    [self enforceByteBudget];
+}
+
+// Merges entry into the most recent entry if entry only touched the text that one left behind
+// (typing or deleting inside/at the end of it), or deleted text right in front of it (backspacing).
+- (BOOL)coalesceEntry:(RichTextEditorUndoEntry *)entry {
+    RichTextEditorUndoEntry *last = self.undoEntries.lastObject;
+    if (!last.coalescing) {
+        return NO;
+    }
+    NSUInteger lastStart = last.location;
+    NSUInteger lastEnd = last.location + last.afterLength;
+    NSUInteger start = entry.location;
+    NSUInteger end = entry.location + entry.before.length;
+    RichTextEditorUndoEntry *merged;
+    if (lastStart <= start && end <= lastEnd) {
+        NSMutableAttributedString *after = [[last afterAttributedString] mutableCopy];
+        [after replaceCharactersInRange:NSMakeRange(start - lastStart, entry.before.length) withAttributedString:[entry afterAttributedString]];
+        merged = [[RichTextEditorUndoEntry alloc] initWithLocation:lastStart before:last.before after:after];
+    }
+    else if (entry.afterLength == 0 && end == lastStart) {
+        NSMutableAttributedString *before = [entry.before mutableCopy];
+        [before appendAttributedString:last.before];
+        merged = [[RichTextEditorUndoEntry alloc] initWithLocation:start before:before after:[last afterAttributedString]];
+    }
+    else {
+        return NO;
+    }
+    merged.selectionBefore = last.selectionBefore;
+    merged.selectionAfter = entry.selectionAfter;
+    merged.coalescing = YES;
+    self.byteCount = self.byteCount - last.cost + merged.cost;
+    self.undoEntries[self.undoEntries.count - 1] = merged;
+    return YES;
+}
+
+- (void)breakCoalescing {
+    _canCoalesceWithLastEntry = NO;
+}
+
+- (void)enforceByteBudget {
+    while (self.byteCount > self.byteBudget && self.undoEntries.count + self.redoEntries.count > 1) {
+        // Oldest undo entries go first; the entry that would be undone next is kept the longest
+        NSMutableArray *entries = self.undoEntries.count > 1 || self.redoEntries.count == 0 ? self.undoEntries : self.redoEntries;
+        RichTextEditorUndoEntry *entry = entries.firstObject;
+        self.byteCount -= entry.cost;
+        [entries removeObjectAtIndex:0];
+    }
+}
+
+#pragma mark - Undo/Redo -
+
+- (NSRange)replaceEntryRange:(NSRange)range withAttributedString:(NSAttributedString *)string {
+    if (NSMaxRange(range) > self.textStorage.length) {
+        [self discardHistory];
+        return NSMakeRange(NSNotFound, 0);
+    }
+    _isApplying = YES;
+    [self.textStorage beginEditing];
+    [self.textStorage replaceCharactersInRange:range withAttributedString:string];
+    [self.textStorage endEditing];
+    _isApplying = NO;
+    _canCoalesceWithLastEntry = NO;
+    return range;
+}
+
+- (NSRange)undo {
+    RichTextEditorUndoEntry *entry = self.undoEntries.lastObject;
+    if (!entry || self.isGrouping) {
+        return NSMakeRange(NSNotFound, 0);
+    }
+    NSRange range = [self replaceEntryRange:NSMakeRange(entry.location, entry.afterLength) withAttributedString:entry.before];
+    if (range.location == NSNotFound) {
+        return range;
+    }
+    [self.undoEntries removeLastObject];
+    [self.redoEntries addObject:entry];
+    return entry.selectionBefore;
+}
+
+- (NSRange)redo {
+    RichTextEditorUndoEntry *entry = self.redoEntries.lastObject;
+    if (!entry || self.isGrouping) {
+        return NSMakeRange(NSNotFound, 0);
+    }
+    NSRange range = [self replaceEntryRange:NSMakeRange(entry.location, entry.before.length) withAttributedString:[entry afterAttributedString]];
+    if (range.location == NSNotFound) {
+        return range;
+    }
+    [self.redoEntries removeLastObject];
+    [self.undoEntries addObject:entry];
+    return entry.selectionAfter;
+}
+
+@end
@@ -13,6 +13,15 @@
 @property (unsafe_unretained) id receiver;
 @property (unsafe_unretained) id middleMan;
 
+/// If YES (the default), which object handles a selector (middle man, receiver or neither) is
+/// worked out once and remembered until receiver or middleMan changes, instead of asking both
+/// objects and walking the protocols on every message. Set to NO to resolve every message again.
+@property (nonatomic) BOOL cachesSelectorResolution;
+
+/// Forgets every resolved selector. Setting receiver or middleMan does this already; call it if
+/// one of them starts or stops responding to a selector on its own.
+- (void)invalidateSelectorCache;
+
 - (instancetype)initWithInterceptedProtocol:(Protocol *)interceptedProtocol;
 - (instancetype)initWithInterceptedProtocols:(Protocol *)firstInterceptedProtocol, ... NS_REQUIRES_NIL_TERMINATION;
 - (instancetype)initWithArrayOfInterceptedProtocols:(NSArray *)arrayOfInterceptedProtocols;
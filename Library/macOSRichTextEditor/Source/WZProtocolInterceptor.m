@@ -7,40 +7,130 @@
 
 #import "WZProtocolInterceptor.h"
 #import  <objc/runtime.h>
+#include <stdatomic.h>
 
 static inline BOOL selector_belongsToProtocol(SEL selector, Protocol * protocol);
 
+// Selector resolution cache: a small open-addressed table where each slot is one atomic word
+// holding the selector (upper 48 bits), the generation it was resolved in (14 bits) and the
+// target (2 bits). Readers and writers never lock; a slot that is overwritten by another
+// selector is simply resolved again, and entries from an older generation are ignored.
+#define WZ_SELECTOR_CACHE_SIZE 128
+#define WZ_SELECTOR_CACHE_PROBES 4
+#define WZ_SELECTOR_CACHE_GENERATION_MASK 0x3FFF
+
+typedef NS_ENUM(uint64_t, WZSelectorTarget) {
+    WZSelectorTargetNone = 1,
+    WZSelectorTargetMiddleMan = 2,
+    WZSelectorTargetReceiver = 3
+};
+
+@interface WZProtocolInterceptor () {
+    __unsafe_unretained id _receiver;
+    __unsafe_unretained id _middleMan;
+    _Atomic(uint64_t) _selectorCache[WZ_SELECTOR_CACHE_SIZE];
+    _Atomic(uint64_t) _selectorCacheGeneration;
+}
+
+@end
+
 @implementation WZProtocolInterceptor
 - (id)forwardingTargetForSelector:(SEL)aSelector {
-    if (self.middleMan && [self.middleMan respondsToSelector:aSelector] &&
-        [self isSelectorContainedInInterceptedProtocols:aSelector]) {
-        return self.middleMan;
+    switch ([self targetForSelector:aSelector]) {
+        case WZSelectorTargetMiddleMan:
+            return self.middleMan;
+        case WZSelectorTargetReceiver:
+            return self.receiver;
+        default:
+            return [super forwardingTargetForSelector:aSelector];
     }
-    
-    if ([self.receiver respondsToSelector:aSelector]) {
-        return self.receiver;
+}
+
+- (BOOL)respondsToSelector:(SEL)aSelector {
+    if ([self targetForSelector:aSelector] != WZSelectorTargetNone) {
+        return YES;
     }
     
-    return [super forwardingTargetForSelector:aSelector];
+    return [super respondsToSelector:aSelector];
 }
 
-- (BOOL)respondsToSelector:(SEL)aSelector {
+- (WZSelectorTarget)resolveTargetForSelector:(SEL)aSelector {
     if (self.middleMan && [self.middleMan respondsToSelector:aSelector] &&
         [self isSelectorContainedInInterceptedProtocols:aSelector]) {
-        return YES;
+        return WZSelectorTargetMiddleMan;
     }
     
     if (self.receiver && [self.receiver respondsToSelector:aSelector]) {
-        return YES;
+        return WZSelectorTargetReceiver;
     }
     
-    return [super respondsToSelector:aSelector];
+    return WZSelectorTargetNone;
+}
+
+#pragma mark - Selector cache
+
+- (WZSelectorTarget)targetForSelector:(SEL)aSelector {
+    uint64_t selectorBits = (uint64_t)(uintptr_t)aSelector;
+    if (!_cachesSelectorResolution || (selectorBits >> 48) != 0) {
+        return [self resolveTargetForSelector:aSelector];
+    }
+    uint64_t generation = atomic_load_explicit(&_selectorCacheGeneration, memory_order_acquire) & WZ_SELECTOR_CACHE_GENERATION_MASK;
+    uint64_t key = (selectorBits << 16) | (generation << 2);
+    NSUInteger start = (NSUInteger)((selectorBits >> 3) ^ (selectorBits >> 11));
+    for (NSUInteger probe = 0; probe < WZ_SELECTOR_CACHE_PROBES; probe++) {
+        uint64_t entry = atomic_load_explicit(&_selectorCache[(start + probe) % WZ_SELECTOR_CACHE_SIZE], memory_order_relaxed);
+        if ((entry & ~(uint64_t)3) == key) {
+            return (WZSelectorTarget)(entry & 3);
+        }
+    }
+    WZSelectorTarget target = [self resolveTargetForSelector:aSelector];
+    // Prefer an empty or out of date slot; otherwise replace the first one
+    NSUInteger slot = start % WZ_SELECTOR_CACHE_SIZE;
+    for (NSUInteger probe = 0; probe < WZ_SELECTOR_CACHE_PROBES; probe++) {
+        NSUInteger index = (start + probe) % WZ_SELECTOR_CACHE_SIZE;
+        uint64_t entry = atomic_load_explicit(&_selectorCache[index], memory_order_relaxed);
+        if (entry == 0 || ((entry >> 2) & WZ_SELECTOR_CACHE_GENERATION_MASK) != generation) {
+            slot = index;
+            break;
+        }
+    }
+    atomic_store_explicit(&_selectorCache[slot], key | target, memory_order_relaxed);
+    return target;
+}
+
+- (void)invalidateSelectorCache {
+    uint64_t generation = atomic_fetch_add_explicit(&_selectorCacheGeneration, 1, memory_order_acq_rel) + 1;
+    if ((generation & WZ_SELECTOR_CACHE_GENERATION_MASK) == 0) {
+        // The generation number wrapped; make sure no entry from 16384 changes ago comes back
+        for (NSUInteger i = 0; i < WZ_SELECTOR_CACHE_SIZE; i++) {
+            atomic_store_explicit(&_selectorCache[i], 0, memory_order_relaxed);
+        }
+    }
+}
+
+- (id)receiver {
+    return _receiver;
+}
+
+- (void)setReceiver:(id)receiver {
+    _receiver = receiver;
+    [self invalidateSelectorCache];
+}
+
+- (id)middleMan {
+    return _middleMan;
+}
+
+- (void)setMiddleMan:(id)middleMan {
+    _middleMan = middleMan;
+    [self invalidateSelectorCache];
 }
 
 - (instancetype)initWithInterceptedProtocol:(Protocol *)interceptedProtocol {
     self = [super init];
     if (self) {
         _interceptedProtocols = @[interceptedProtocol];
+        _cachesSelectorResolution = YES;
     }
     return self;
 }
@@ -60,6 +150,7 @@ static inline BOOL selector_belongsToProtocol(SEL selector, Protocol * protocol)
             va_end(argumentList);
         }
         _interceptedProtocols = [mutableProtocols copy];
+        _cachesSelectorResolution = YES;
     }
     return self;
 }
@@ -68,6 +159,7 @@ static inline BOOL selector_belongsToProtocol(SEL selector, Protocol * protocol)
     self = [super init];
     if (self) {
         _interceptedProtocols = [arrayOfInterceptedProtocols copy];
+        _cachesSelectorResolution = YES;
     }
     return self;
 }
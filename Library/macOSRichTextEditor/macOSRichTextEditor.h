@@ -19,3 +19,26 @@ FOUNDATION_EXPORT const unsigned char macOSRichTextEditorVersionString[];
 #include <macOSRichTextEditor/RichTextEditor.h>
 #include <macOSRichTextEditor/NSFont+RichTextEditor.h>
 #include <macOSRichTextEditor/NSAttributedString+RichTextEditor.h>
+#include <macOSRichTextEditor/RichTextEditorParagraphIndex.h>
+#include <macOSRichTextEditor/RichTextEditorParagraphBatch.h>
+#include <macOSRichTextEditor/RichTextEditorHTMLWriter.h>
+#include <macOSRichTextEditor/RichTextEditorHTMLReader.h>
+#include <macOSRichTextEditor/RichTextEditorFontCache.h>
+#include <macOSRichTextEditor/RichTextEditorFormattingState.h>
+#include <macOSRichTextEditor/RichTextEditorUndoJournal.h>
+#include <macOSRichTextEditor/RichTextEditorCommandMetrics.h>
+#include <macOSRichTextEditor/RichTextEditorStyleTransform.h>
+#include <macOSRichTextEditor/RichTextEditorBinaryDocument.h>
+#include <macOSRichTextEditor/RichTextEditorProgressiveLoader.h>
+#include <macOSRichTextEditor/RichTextEditorFindReplace.h>
+#include <macOSRichTextEditor/RichTextEditorEditStream.h>
+#include <macOSRichTextEditor/RichTextEditorAttributeInterner.h>
+#include <macOSRichTextEditor/RichTextEditorPool.h>
+#include <macOSRichTextEditor/RichTextEditorFoundationText.h>
+#include <macOSRichTextEditor/RichTextEditorDocument.h>
+#include <macOSRichTextEditor/RichTextEditorBatchConverter.h>
+#include <macOSRichTextEditor/RichTextEditorStatistics.h>
+#include <macOSRichTextEditor/RichTextEditorMarkdownReader.h>
+#include <macOSRichTextEditor/RichTextEditorMarkdownWriter.h>
+#include <macOSRichTextEditor/RichTextEditorKeyBindings.h>
+#include <macOSRichTextEditor/RichTextEditorAutosave.h>
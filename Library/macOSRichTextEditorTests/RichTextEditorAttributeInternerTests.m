@@ -0,0 +1,159 @@
+//
+//  RichTextEditorAttributeInternerTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorAttributeInternerTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorAttributeInternerTests
+
+- (NSMutableParagraphStyle *)paragraphStyleWithIndent:(CGFloat)indent {
+    NSMutableParagraphStyle *paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+    paragraphStyle.firstLineHeadIndent = indent;
+    paragraphStyle.headIndent = indent;
+    return paragraphStyle;
+}
+
+- (void)testEqualValuesShareOneObject {
+    RichTextEditorAttributeInterner *interner = [[RichTextEditorAttributeInterner alloc] init];
+    NSMutableParagraphStyle *first = [self paragraphStyleWithIndent:20];
+    NSParagraphStyle *interned = [interner internedParagraphStyle:first];
+    XCTAssertTrue([interner internedParagraphStyle:[self paragraphStyleWithIndent:20]] == interned);
+    XCTAssertFalse([interner internedParagraphStyle:[self paragraphStyleWithIndent:40]] == interned);
+    // The interned copy doesn't follow later changes to the original
+    first.headIndent = 100;
+    XCTAssertEqual(interned.headIndent, 20);
+
+    NSColor *red = [interner internedColor:[NSColor colorWithSRGBRed:1 green:0 blue:0 alpha:1]];
+    XCTAssertTrue([interner internedValue:[NSColor colorWithSRGBRed:1 green:0 blue:0 alpha:1]] == red);
+    NSFont *font = [interner internedFont:[NSFont fontWithName:@"Helvetica" size:12]];
+    XCTAssertTrue([interner internedFont:[NSFont fontWithName:@"Helvetica" size:12]] == font);
+    XCTAssertEqualObjects([interner internedValue:@(1)], @(1)); // other values are left alone
+
+    XCTAssertEqual(interner.internedValueCount, (NSUInteger)4);
+    XCTAssertEqual(interner.missCount, (NSUInteger)4);
+    XCTAssertEqual(interner.hitCount, (NSUInteger)3);
+    [interner removeAllValues];
+    XCTAssertEqual(interner.internedValueCount, (NSUInteger)0);
+}
+
+- (void)testInternedAttributesOnlyCopiesWhenNeeded {
+    RichTextEditorAttributeInterner *interner = [[RichTextEditorAttributeInterner alloc] init];
+    NSDictionary *attributes = @{NSParagraphStyleAttributeName: [self paragraphStyleWithIndent:20], NSKernAttributeName: @(1)};
+    NSDictionary *interned = [interner internedAttributes:attributes];
+    XCTAssertEqualObjects(interned, attributes);
+    XCTAssertTrue([interner internedAttributes:interned] == interned);
+}
+
+- (void)testCompactRuns {
+    RichTextEditorAttributeInterner *interner = [[RichTextEditorAttributeInterner alloc] init];
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] init];
+    for (NSUInteger i = 0; i < 100; i++) {
+        NSDictionary *attributes = @{NSParagraphStyleAttributeName: [self paragraphStyleWithIndent:(i < 50 ? 20 : 40)],
+                                     NSForegroundColorAttributeName: [NSColor colorWithSRGBRed:0 green:0 blue:1 alpha:1]};
+        [string appendAttributedString:[[NSAttributedString alloc] initWithString:@"ab" attributes:attributes]];
+    }
+    NSAttributedString *original = [string copy];
+    NSUInteger runCount = [RichTextEditorAttributeInterner runCountOfAttributedString:string range:NSMakeRange(0, string.length)];
+    NSUInteger removed = [interner compactRunsInTextStorage:string range:NSMakeRange(0, string.length)];
+    XCTAssertTrue([string isEqualToAttributedString:original]);
+    XCTAssertEqual([RichTextEditorAttributeInterner runCountOfAttributedString:string range:NSMakeRange(0, string.length)], (NSUInteger)2);
+    XCTAssertEqual(removed, runCount - 2);
+    XCTAssertEqual([RichTextEditorAttributeInterner attributeObjectCountOfAttributedString:string range:NSMakeRange(0, string.length)], (NSUInteger)3);
+    // Nothing left to do the second time
+    XCTAssertEqual([interner compactRunsInTextStorage:string range:NSMakeRange(0, string.length)], (NSUInteger)0);
+}
+
+- (void)testCompactRunsOnlyTouchesRange {
+    RichTextEditorAttributeInterner *interner = [[RichTextEditorAttributeInterner alloc] init];
+    NSTextStorage *textStorage = [[NSTextStorage alloc] init];
+    for (NSUInteger i = 0; i < 10; i++) {
+        [textStorage appendAttributedString:[[NSAttributedString alloc] initWithString:@"abcd" attributes:@{NSParagraphStyleAttributeName: [self paragraphStyleWithIndent:20]}]];
+    }
+    __block NSRange editedRange = NSMakeRange(NSNotFound, 0);
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:NSTextStorageDidProcessEditingNotification object:textStorage queue:nil
+                                                                usingBlock:^(NSNotification *notification) {
+        editedRange = textStorage.editedRange;
+    }];
+    [interner compactRunsInTextStorage:textStorage range:NSMakeRange(8, 16)];
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    if (editedRange.location != NSNotFound) {
+        XCTAssertTrue(NSLocationInRange(editedRange.location, NSMakeRange(8, 16)));
+        XCTAssertLessThanOrEqual(NSMaxRange(editedRange), (NSUInteger)24);
+    }
+}
+
+#pragma mark - Editor
+
+- (void)testParagraphCommandsShareParagraphStyles {
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[RichTextEditorBenchmarkSupport documentWithParagraphCount:500 maximumListDepth:2]];
+    [editor compactAttributeRuns];
+    editor.selectedRange = NSMakeRange(0, editor.string.length);
+    for (NSUInteger i = 0; i < 5; i++) {
+        [editor userSelectedIncreaseIndent];
+        [editor userSelectedBullet];
+        [editor userSelectedBullet];
+        [editor userSelectedDecreaseIndent];
+    }
+    // One paragraph style per distinct indentation rather than one per paragraph per command
+    XCTAssertLessThan(editor.attributeObjectCount, (NSUInteger)50);
+    NSUInteger runCount = editor.attributeRunCount;
+    NSAttributedString *text = [editor.attributedString copy];
+    [editor compactAttributeRuns];
+    XCTAssertLessThanOrEqual(editor.attributeRunCount, runCount);
+    XCTAssertTrue([editor.attributedString isEqualToAttributedString:text]);
+}
+
+- (void)testTypingAttributesAreInterned {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    NSMutableParagraphStyle *paragraphStyle = [self paragraphStyleWithIndent:20];
+    editor.typingAttributes = @{NSParagraphStyleAttributeName: paragraphStyle};
+    XCTAssertTrue(editor.typingAttributes[NSParagraphStyleAttributeName] == [editor.attributeInterner internedParagraphStyle:paragraphStyle]);
+}
+
+- (void)testColorCommandsShareColors {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:@"one two three four"]];
+    for (NSUInteger i = 0; i < 4; i++) {
+        editor.selectedRange = NSMakeRange(i * 4, 3);
+        [editor userSelectedTextColor:[NSColor colorWithSRGBRed:1 green:0 blue:0 alpha:1]];
+    }
+    NSColor *first = [editor.textStorage attribute:NSForegroundColorAttributeName atIndex:0 effectiveRange:NULL];
+    NSColor *last = [editor.textStorage attribute:NSForegroundColorAttributeName atIndex:12 effectiveRange:NULL];
+    XCTAssertTrue(first == last);
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceCompactRuns {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:10000 maximumListDepth:4];
+    [self measureBlock:^{
+        RichTextEditorAttributeInterner *interner = [[RichTextEditorAttributeInterner alloc] init];
+        NSMutableAttributedString *string = [document mutableCopy];
+        [interner compactRunsInTextStorage:string range:NSMakeRange(0, string.length)];
+    }];
+}
+
+// htmlString after a long session of paragraph commands, with the runs compacted first
+- (void)testPerformanceHTMLAfterCompaction {
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[RichTextEditorBenchmarkSupport documentWithParagraphCount:2000 maximumListDepth:4]];
+    editor.selectedRange = NSMakeRange(0, editor.string.length);
+    for (NSUInteger i = 0; i < 3; i++) {
+        [editor userSelectedIncreaseIndent];
+        [editor userSelectedDecreaseIndent];
+    }
+    [editor compactAttributeRuns];
+    [self measureBlock:^{
+        XCTAssertNotNil([editor htmlString]);
+    }];
+}
+
+@end
@@ -0,0 +1,324 @@
+//
+//  RichTextEditorAutosaveTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+@interface RichTextEditorAutosaveTests : XCTestCase
+
+@property NSURL *directoryURL;
+
+@end
+
+@implementation RichTextEditorAutosaveTests
+
+- (void)setUp {
+    [super setUp];
+    self.directoryURL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[NSUUID UUID].UUIDString];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+    [super tearDown];
+}
+
+- (NSDictionary *)attributes {
+    return @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]};
+}
+
+- (NSAttributedString *)recovered {
+    NSError *error = nil;
+    NSAttributedString *recovered = [RichTextEditorAutosave recoveredAttributedStringAtDirectoryURL:self.directoryURL editCount:NULL error:&error];
+    XCTAssertNotNil(recovered, @"%@", error);
+    return recovered;
+}
+
+- (NSArray<NSString *> *)fileNames {
+    NSArray<NSString *> *fileNames = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:self.directoryURL.path error:nil];
+    return [fileNames sortedArrayUsingSelector:@selector(compare:)];
+}
+
+- (void)testJournalRecovery {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"hello world" attributes:[self attributes]];
+    RichTextEditorAutosave *autosave = [[RichTextEditorAutosave alloc] initWithTextStorage:textStorage directoryURL:self.directoryURL];
+    NSError *error = nil;
+    XCTAssertTrue([autosave startWithError:&error], @"%@", error);
+    XCTAssertEqual(autosave.generation, (NSUInteger)1);
+
+    [textStorage replaceCharactersInRange:NSMakeRange(5, 0) withString:@","];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, 1) withString:@"J"];
+    [textStorage addAttribute:NSForegroundColorAttributeName value:[NSColor redColor] range:NSMakeRange(7, 5)];
+    [textStorage beginEditing];
+    [textStorage deleteCharactersInRange:NSMakeRange(6, 1)];
+    [textStorage replaceCharactersInRange:NSMakeRange(textStorage.length, 0) withString:@"!"];
+    [textStorage endEditing];
+    [autosave synchronize];
+    XCTAssertEqual(autosave.journalEntryCount, (NSUInteger)4);
+
+    NSUInteger editCount = 0;
+    NSAttributedString *recovered = [RichTextEditorAutosave recoveredAttributedStringAtDirectoryURL:self.directoryURL editCount:&editCount error:&error];
+    XCTAssertEqualObjects(recovered.string, @"Jello,world!");
+    XCTAssertTrue([recovered isEqualToAttributedString:textStorage]);
+    XCTAssertEqual(editCount, (NSUInteger)4);
+
+    // Nothing is journaled once stopped
+    [autosave stop];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, 0) withString:@"x"];
+    XCTAssertEqualObjects([self recovered].string, @"Jello,world!");
+    XCTAssertEqualObjects([self fileNames], (@[@"journal-1", @"snapshot-1"]));
+}
+
+- (void)testCompaction {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"one" attributes:[self attributes]];
+    RichTextEditorAutosave *autosave = [[RichTextEditorAutosave alloc] initWithTextStorage:textStorage directoryURL:self.directoryURL];
+    XCTAssertTrue([autosave startWithError:nil]);
+    [textStorage replaceCharactersInRange:NSMakeRange(3, 0) withString:@" two"];
+    [autosave compact];
+    [textStorage replaceCharactersInRange:NSMakeRange(7, 0) withString:@" three"];
+    [autosave synchronize];
+    XCTAssertEqual(autosave.generation, (NSUInteger)2);
+    XCTAssertEqual(autosave.compactionCount, (NSUInteger)2);
+    XCTAssertEqualObjects([self fileNames], (@[@"journal-2", @"snapshot-2"]));
+
+    NSUInteger editCount = 0;
+    NSAttributedString *recovered = [RichTextEditorAutosave recoveredAttributedStringAtDirectoryURL:self.directoryURL editCount:&editCount error:nil];
+    XCTAssertEqualObjects(recovered.string, @"one two three");
+    XCTAssertEqual(editCount, (NSUInteger)1);
+
+    // A compaction asked for in the middle of an edit waits for it to end
+    [textStorage beginEditing];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, 3) withString:@"zero"];
+    [autosave compact];
+    [textStorage endEditing];
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+    [autosave synchronize];
+    XCTAssertEqual(autosave.generation, (NSUInteger)3);
+    XCTAssertEqualObjects([self recovered].string, @"zero two three");
+
+    // Starting again replaces the old generations once its own snapshot is written
+    [autosave stop];
+    RichTextEditorAutosave *next = [[RichTextEditorAutosave alloc] initWithTextStorage:textStorage directoryURL:self.directoryURL];
+    XCTAssertTrue([next startWithError:nil]);
+    XCTAssertEqual(next.generation, (NSUInteger)4);
+    XCTAssertEqualObjects([self fileNames], (@[@"journal-4", @"snapshot-4"]));
+    [next stop];
+
+    XCTAssertTrue([RichTextEditorAutosave hasAutosaveAtDirectoryURL:self.directoryURL]);
+    XCTAssertTrue([RichTextEditorAutosave removeAutosaveAtDirectoryURL:self.directoryURL error:nil]);
+    XCTAssertFalse([RichTextEditorAutosave hasAutosaveAtDirectoryURL:self.directoryURL]);
+    NSError *error = nil;
+    XCTAssertNil([RichTextEditorAutosave recoveredAttributedStringAtDirectoryURL:self.directoryURL editCount:NULL error:&error]);
+    XCTAssertEqual(error.code, NSFileReadNoSuchFileError);
+}
+
+- (void)testDamagedJournal {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"abc" attributes:[self attributes]];
+    RichTextEditorAutosave *autosave = [[RichTextEditorAutosave alloc] initWithTextStorage:textStorage directoryURL:self.directoryURL];
+    XCTAssertTrue([autosave startWithError:nil]);
+    [textStorage replaceCharactersInRange:NSMakeRange(3, 0) withString:@"d"];
+    [textStorage replaceCharactersInRange:NSMakeRange(4, 0) withString:@"e"];
+    [autosave stop];
+
+    NSURL *journalURL = [self.directoryURL URLByAppendingPathComponent:[RichTextEditorAutosave journalFileNameForGeneration:1]];
+    NSMutableData *journal = [NSMutableData dataWithContentsOfURL:journalURL];
+    NSData *intact = [journal copy];
+    RichTextEditorEditRecord *record = [[RichTextEditorEditRecord alloc] initWithRange:NSMakeRange(5, 0) replacementLength:1 charactersChanged:YES attributesChanged:NO
+                                                                       replacementText:[[NSAttributedString alloc] initWithString:@"f" attributes:[self attributes]]];
+    NSData *entry = [RichTextEditorAutosave journalEntryForEditRecord:record];
+
+    // Cut short
+    [journal appendData:[entry subdataWithRange:NSMakeRange(0, entry.length - 3)]];
+    XCTAssertTrue([journal writeToURL:journalURL atomically:NO]);
+    NSUInteger editCount = 0;
+    XCTAssertEqualObjects([RichTextEditorAutosave recoveredAttributedStringAtDirectoryURL:self.directoryURL editCount:&editCount error:nil].string, @"abcde");
+    XCTAssertEqual(editCount, (NSUInteger)2);
+
+    // Whole
+    journal = [intact mutableCopy];
+    [journal appendData:entry];
+    XCTAssertTrue([journal writeToURL:journalURL atomically:NO]);
+    XCTAssertEqualObjects([self recovered].string, @"abcdef");
+
+    // Corrupt in the middle: everything from there on is ignored
+    ((uint8_t *)journal.mutableBytes)[intact.length - 2] ^= 0xFF;
+    XCTAssertTrue([journal writeToURL:journalURL atomically:NO]);
+    XCTAssertEqualObjects([self recovered].string, @"abcd");
+
+    // Out of range for the text
+    journal = [intact mutableCopy];
+    record = [[RichTextEditorEditRecord alloc] initWithRange:NSMakeRange(9, 0) replacementLength:1 charactersChanged:YES attributesChanged:NO
+                                             replacementText:[[NSAttributedString alloc] initWithString:@"f"]];
+    [journal appendData:[RichTextEditorAutosave journalEntryForEditRecord:record]];
+    XCTAssertTrue([journal writeToURL:journalURL atomically:NO]);
+    XCTAssertEqualObjects([self recovered].string, @"abcde");
+}
+
+- (void)testDroppedEditsWaitForSnapshot {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"abc" attributes:[self attributes]];
+    RichTextEditorAutosave *autosave = [[RichTextEditorAutosave alloc] initWithTextStorage:textStorage directoryURL:self.directoryURL];
+    XCTAssertTrue([autosave startWithError:nil]);
+    [textStorage replaceCharactersInRange:NSMakeRange(3, 0) withString:@"d"];
+    autosave.maximumPendingBytes = 0;
+    [textStorage replaceCharactersInRange:NSMakeRange(4, 0) withString:@"e"];
+    [textStorage replaceCharactersInRange:NSMakeRange(5, 0) withString:@"f"];
+    XCTAssertEqual(autosave.droppedEditCount, (NSUInteger)2);
+    [autosave synchronize];
+    // Recovery stops where edits were dropped rather than replaying later ones onto the wrong text
+    XCTAssertEqualObjects([self recovered].string, @"abcd");
+
+    autosave.maximumPendingBytes = 1024 * 1024;
+    [autosave compact];
+    [textStorage replaceCharactersInRange:NSMakeRange(6, 0) withString:@"g"];
+    [autosave synchronize];
+    XCTAssertEqual(autosave.generation, (NSUInteger)2);
+    XCTAssertEqualObjects([self recovered].string, @"abcdefg");
+    [autosave stop];
+}
+
+// A child process appends journal entries the way the journal queue does, each with two
+// write()s, and is killed at a random point. Recovery must give exactly the text after the
+// last entry that was completely written.
+- (void)testRecoveryAfterKillMidWrite {
+    NSUInteger editCount = 300;
+    for (NSUInteger trial = 0; trial < 5; trial++) {
+        [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+        NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"Start\n" attributes:[self attributes]];
+        RichTextEditorAutosave *autosave = [[RichTextEditorAutosave alloc] initWithTextStorage:textStorage directoryURL:self.directoryURL];
+        XCTAssertTrue([autosave startWithError:nil]);
+        [autosave stop];
+
+        // Everything the child writes is encoded before the fork
+        NSMutableAttributedString *text = [textStorage mutableCopy];
+        NSMutableArray<NSString *> *states = [NSMutableArray arrayWithObject:text.string];
+        NSMutableData *entries = [NSMutableData data];
+        NSUInteger *ends = malloc(editCount * sizeof(NSUInteger));
+        for (NSUInteger i = 0; i < editCount; i++) {
+            NSRange range = NSMakeRange(arc4random_uniform((uint32_t)text.length + 1), 0);
+            if (i % 5 == 4 && text.length > 10) {
+                range = NSMakeRange(arc4random_uniform((uint32_t)text.length - 5), 5);
+            }
+            NSAttributedString *replacement = [[NSAttributedString alloc] initWithString:[NSString stringWithFormat:@"w%lu ", (unsigned long)i]
+                                                                              attributes:[self attributes]];
+            RichTextEditorEditRecord *record = [[RichTextEditorEditRecord alloc] initWithRange:range replacementLength:replacement.length
+                                                                             charactersChanged:YES attributesChanged:NO replacementText:replacement];
+            [entries appendData:[RichTextEditorAutosave journalEntryForEditRecord:record]];
+            ends[i] = entries.length;
+            [text replaceCharactersInRange:range withAttributedString:replacement];
+            [states addObject:text.string];
+        }
+        NSString *journalPath = [self.directoryURL URLByAppendingPathComponent:[RichTextEditorAutosave journalFileNameForGeneration:1]].path;
+        int fd = open(journalPath.fileSystemRepresentation, O_WRONLY | O_APPEND);
+        XCTAssertGreaterThanOrEqual(fd, 0);
+        const uint8_t *bytes = entries.bytes;
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            // Only async-signal-safe calls from here on
+            NSUInteger start = 0;
+            for (NSUInteger i = 0; i < editCount; i++) {
+                NSUInteger middle = start + (ends[i] - start) / 2;
+                write(fd, bytes + start, middle - start);
+                usleep(20);
+                write(fd, bytes + middle, ends[i] - middle);
+                start = ends[i];
+                usleep(20);
+            }
+            pause();
+            _exit(0);
+        }
+        XCTAssertGreaterThan(pid, 0);
+        close(fd);
+        usleep(arc4random_uniform(10000));
+        kill(pid, SIGKILL);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        XCTAssertTrue(WIFSIGNALED(status));
+
+        NSUInteger recoveredCount = 0;
+        NSAttributedString *recovered = [RichTextEditorAutosave recoveredAttributedStringAtDirectoryURL:self.directoryURL editCount:&recoveredCount error:nil];
+        NSUInteger journalLength = [[[NSFileManager defaultManager] attributesOfItemAtPath:journalPath error:nil] fileSize];
+        NSUInteger written = journalLength - [RichTextEditorAutosave journalHeaderForGeneration:1].length;
+        NSUInteger complete = 0;
+        while (complete < editCount && ends[complete] <= written) {
+            complete++;
+        }
+        XCTAssertEqual(recoveredCount, complete);
+        XCTAssertEqualObjects(recovered.string, states[recoveredCount]);
+        free(ends);
+    }
+}
+
+- (void)testEditorAutosave {
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[RichTextEditorBenchmarkSupport documentWithParagraphCount:50 maximumListDepth:3]];
+    NSError *error = nil;
+    XCTAssertTrue([editor startAutosavingToDirectoryURL:self.directoryURL error:&error], @"%@", error);
+    XCTAssertNotNil(editor.autosave);
+    editor.selectedRange = NSMakeRange(editor.string.length / 2, 0);
+    [editor insertText:@"typed" replacementRange:editor.selectedRange];
+    editor.selectedRange = NSMakeRange(0, 20);
+    [editor userSelectedBold];
+    [editor userSelectedBullet];
+    [editor.autosave synchronize];
+    NSAttributedString *edited = [editor.attributedString copy];
+    XCTAssertTrue([[self recovered] isEqualToAttributedString:edited]);
+
+    // A new editor picks up where the first one left off
+    RichTextEditor *other = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] initWithString:@""]];
+    XCTAssertTrue([other startAutosavingToDirectoryURL:self.directoryURL error:nil]);
+    XCTAssertTrue([other.attributedString isEqualToAttributedString:edited]);
+    [other stopAutosaving];
+    XCTAssertNil(other.autosave);
+
+    // prepareForReuse stops autosaving before clearing the text
+    [editor stopAutosaving];
+    XCTAssertTrue([editor startAutosavingToDirectoryURL:self.directoryURL error:nil]);
+    [editor prepareForReuse];
+    XCTAssertNil(editor.autosave);
+    XCTAssertTrue([[self recovered] isEqualToAttributedString:edited]);
+}
+
+#pragma mark - Benchmarks
+
+// Main thread time per key press with autosave on, against the same typing without it. The
+// journal is written on a background queue, so the difference is the cost of handing each edit over.
+- (void)testBenchmarkTypingWithAutosave {
+    RichTextEditorBenchmarkSupport *support = [RichTextEditorBenchmarkSupport sharedSupport];
+    NSUInteger paragraphCount = 10000;
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:paragraphCount maximumListDepth:4];
+    NSUInteger keyPresses = 100;
+    NSDictionary *results[2];
+    for (NSUInteger autosaving = 0; autosaving < 2; autosaving++) {
+        RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:document];
+        if (autosaving) {
+            [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+            XCTAssertTrue([editor startAutosavingToDirectoryURL:self.directoryURL error:nil]);
+        }
+        editor.selectedRange = NSMakeRange(editor.string.length / 2, 0);
+        results[autosaving] = [support measureOperation:autosaving ? @"typing (autosave)" : @"typing (no autosave)" paragraphCount:paragraphCount
+                                             iterations:50 warmupIterations:3 block:^(NSUInteger iteration) {
+            for (NSUInteger i = 0; i < keyPresses; i++) {
+                [editor insertText:(i % 8 == 7 ? @" " : @"a") replacementRange:editor.selectedRange];
+            }
+        }];
+        if (autosaving) {
+            [editor.autosave synchronize];
+            XCTAssertNil(editor.autosave.error);
+            XCTAssertEqualObjects([self recovered].string, editor.string);
+            [editor stopAutosaving];
+        }
+    }
+    NSLog(@"[RTE] main thread per edit: %.1f us without autosave, %.1f us with autosave (p99 %.1f us)",
+          [results[0][@"p50Microseconds"] doubleValue] / keyPresses, [results[1][@"p50Microseconds"] doubleValue] / keyPresses,
+          [results[1][@"p99Microseconds"] doubleValue] / keyPresses);
+}
+
+@end
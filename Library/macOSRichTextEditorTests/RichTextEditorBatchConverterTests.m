@@ -0,0 +1,247 @@
+//
+//  RichTextEditorBatchConverterTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorBatchConverterTests : XCTestCase
+
+@property NSURL *directoryURL;
+
+@end
+
+@implementation RichTextEditorBatchConverterTests
+
+- (void)setUp {
+    [super setUp];
+    self.directoryURL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    [[NSFileManager defaultManager] createDirectoryAtURL:self.directoryURL withIntermediateDirectories:YES attributes:nil error:nil];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+    [super tearDown];
+}
+
++ (NSAttributedString *)noteWithIndex:(NSUInteger)index {
+    NSDictionary *attributes = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:14],
+                                 NSForegroundColorAttributeName: [NSColor redColor]};
+    NSString *text = [NSString stringWithFormat:@"Note %lu\n- first point\n- second point\nThe end", (unsigned long)index];
+    return [[NSAttributedString alloc] initWithString:text attributes:attributes];
+}
+
+// count HTML notes below source, half of them in a subdirectory
+- (NSURL *)writeHTMLNotes:(NSUInteger)count {
+    NSURL *sourceURL = [self.directoryURL URLByAppendingPathComponent:@"source"];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSURL *folderURL = i % 2 == 0 ? sourceURL : [sourceURL URLByAppendingPathComponent:@"nested"];
+        [[NSFileManager defaultManager] createDirectoryAtURL:folderURL withIntermediateDirectories:YES attributes:nil error:nil];
+        NSString *html = [RichTextEditor htmlStringFromAttributedText:[RichTextEditorBatchConverterTests noteWithIndex:i]];
+        NSURL *fileURL = [folderURL URLByAppendingPathComponent:[NSString stringWithFormat:@"note%lu.html", (unsigned long)i]];
+        XCTAssertTrue([html writeToURL:fileURL atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    }
+    return sourceURL;
+}
+
+- (RichTextEditorBatchConversionReport *)runConverter:(RichTextEditorBatchConverter *)converter from:(NSURL *)sourceURL to:(NSURL *)destinationURL {
+    XCTestExpectation *finished = [self expectationWithDescription:@"conversion finished"];
+    __block RichTextEditorBatchConversionReport *result = nil;
+    [converter convertDirectoryAtURL:sourceURL toURL:destinationURL completion:^(RichTextEditorBatchConversionReport *report) {
+        XCTAssertTrue([NSThread isMainThread]);
+        result = report;
+        [finished fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:60 handler:nil];
+    return result;
+}
+
+- (void)testConvertsDirectoryLikeAnEditor {
+    NSURL *sourceURL = [self writeHTMLNotes:6];
+    NSURL *destinationURL = [self.directoryURL URLByAppendingPathComponent:@"destination"];
+    RichTextEditorBatchConverter *converter = [[RichTextEditorBatchConverter alloc] init];
+    converter.maximumConcurrentFileCount = 3;
+    RichTextEditorBatchConversionReport *report = [self runConverter:converter from:sourceURL to:destinationURL];
+    XCTAssertEqual(report.convertedCount, (NSUInteger)6);
+    XCTAssertEqual(report.failedCount, (NSUInteger)0);
+    XCTAssertGreaterThan(report.bytesRead, (unsigned long long)0);
+    XCTAssertGreaterThan([report latencyMicrosecondsAtPercentile:0.99], (uint64_t)0);
+
+    for (NSUInteger i = 0; i < 6; i++) {
+        NSString *relativePath = [NSString stringWithFormat:(i % 2 == 0 ? @"note%lu.html" : @"nested/note%lu.html"), (unsigned long)i];
+        NSString *input = [NSString stringWithContentsOfURL:[sourceURL URLByAppendingPathComponent:relativePath] encoding:NSUTF8StringEncoding error:nil];
+        NSString *output = [NSString stringWithContentsOfURL:[destinationURL URLByAppendingPathComponent:relativePath] encoding:NSUTF8StringEncoding error:nil];
+        RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+        [editor setHtmlString:input];
+        XCTAssertEqualObjects(output, [editor htmlString]);
+    }
+}
+
+- (void)testStreamsMarkdownBothWays {
+    NSURL *sourceURL = [self writeHTMLNotes:4];
+    RichTextEditorBatchConverter *converter = [[RichTextEditorBatchConverter alloc] init];
+    converter.destinationFormat = RichTextEditorFileFormatMarkdown;
+    NSURL *markdownURL = [self.directoryURL URLByAppendingPathComponent:@"markdown"];
+    XCTAssertEqual([self runConverter:converter from:sourceURL to:markdownURL].convertedCount, (NSUInteger)4);
+    NSAttributedString *read = [converter attributedStringFromData:[NSData dataWithContentsOfURL:[sourceURL URLByAppendingPathComponent:@"note0.html"]] error:nil];
+    NSString *markdown = [NSString stringWithContentsOfURL:[markdownURL URLByAppendingPathComponent:@"note0.md"] encoding:NSUTF8StringEncoding error:nil];
+    XCTAssertEqualObjects(markdown, [[[RichTextEditorMarkdownWriter alloc] initWithAttributedString:read] markdownString]);
+
+    converter.sourceFormat = RichTextEditorFileFormatMarkdown;
+    converter.destinationFormat = RichTextEditorFileFormatHTML;
+    NSURL *htmlURL = [self.directoryURL URLByAppendingPathComponent:@"html"];
+    RichTextEditorBatchConversionReport *report = [self runConverter:converter from:markdownURL to:htmlURL];
+    XCTAssertEqual(report.convertedCount, (NSUInteger)4);
+    XCTAssertEqual(report.failedCount, (NSUInteger)0);
+    NSArray *outputs = [[NSFileManager defaultManager] subpathsOfDirectoryAtPath:htmlURL.path error:nil];
+    XCTAssertEqual([outputs filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"pathExtension == 'tmp'"]].count, (NSUInteger)0);
+    XCTAssertGreaterThan(report.bytesWritten, (unsigned long long)0);
+    NSString *html = [NSString stringWithContentsOfURL:[htmlURL URLByAppendingPathComponent:@"nested/note1.html"] encoding:NSUTF8StringEncoding error:nil];
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor setHtmlString:html];
+    XCTAssertEqualObjects(html, [editor htmlString]);
+}
+
+- (void)testConvertsToRTFAndPlainText {
+    NSURL *sourceURL = [self writeHTMLNotes:2];
+    RichTextEditorBatchConverter *converter = [[RichTextEditorBatchConverter alloc] init];
+    converter.destinationFormat = RichTextEditorFileFormatRTF;
+    NSURL *rtfURL = [self.directoryURL URLByAppendingPathComponent:@"rtf"];
+    XCTAssertEqual([self runConverter:converter from:sourceURL to:rtfURL].convertedCount, (NSUInteger)2);
+    NSAttributedString *rtf = [[NSAttributedString alloc] initWithURL:[rtfURL URLByAppendingPathComponent:@"note0.rtf"] options:@{} documentAttributes:NULL error:nil];
+    XCTAssertEqualObjects(rtf.string, [RichTextEditorBatchConverterTests noteWithIndex:0].string);
+
+    converter.sourceFormat = RichTextEditorFileFormatRTF;
+    converter.destinationFormat = RichTextEditorFileFormatPlainText;
+    NSURL *textURL = [self.directoryURL URLByAppendingPathComponent:@"text"];
+    XCTAssertEqual([self runConverter:converter from:rtfURL to:textURL].convertedCount, (NSUInteger)2);
+    NSString *text = [NSString stringWithContentsOfURL:[textURL URLByAppendingPathComponent:@"nested/note1.txt"] encoding:NSUTF8StringEncoding error:nil];
+    XCTAssertEqualObjects(text, [RichTextEditorBatchConverterTests noteWithIndex:1].string);
+}
+
+- (void)testResumeSkipsOutputsThatAreUpToDate {
+    NSURL *sourceURL = [self writeHTMLNotes:4];
+    NSURL *destinationURL = [self.directoryURL URLByAppendingPathComponent:@"destination"];
+    RichTextEditorBatchConverter *converter = [[RichTextEditorBatchConverter alloc] init];
+    XCTAssertEqual([self runConverter:converter from:sourceURL to:destinationURL].convertedCount, (NSUInteger)4);
+
+    RichTextEditorBatchConversionReport *report = [self runConverter:converter from:sourceURL to:destinationURL];
+    XCTAssertEqual(report.convertedCount, (NSUInteger)0);
+    XCTAssertEqual(report.skippedCount, (NSUInteger)4);
+
+    // An input changed after its output was written is converted again
+    [[NSFileManager defaultManager] setAttributes:@{NSFileModificationDate: [NSDate dateWithTimeIntervalSinceNow:60]}
+                                     ofItemAtPath:[sourceURL URLByAppendingPathComponent:@"note2.html"].path error:nil];
+    report = [self runConverter:converter from:sourceURL to:destinationURL];
+    XCTAssertEqual(report.convertedCount, (NSUInteger)1);
+    XCTAssertEqual(report.skippedCount, (NSUInteger)3);
+
+    converter.resumes = NO;
+    XCTAssertEqual([self runConverter:converter from:sourceURL to:destinationURL].convertedCount, (NSUInteger)4);
+}
+
+- (void)testFailuresAreReported {
+    NSURL *sourceURL = [self.directoryURL URLByAppendingPathComponent:@"source"];
+    [[NSFileManager defaultManager] createDirectoryAtURL:sourceURL withIntermediateDirectories:YES attributes:nil error:nil];
+    NSData *notUTF8 = [NSData dataWithBytes:"\xff\xfe\xc3" length:3];
+    XCTAssertTrue([notUTF8 writeToURL:[sourceURL URLByAppendingPathComponent:@"broken.txt"] atomically:YES]);
+    NSData *text = [@"fine" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertTrue([text writeToURL:[sourceURL URLByAppendingPathComponent:@"fine.txt"] atomically:YES]);
+    XCTAssertTrue([text writeToURL:[sourceURL URLByAppendingPathComponent:@"ignored.md"] atomically:YES]);
+
+    RichTextEditorBatchConverter *converter = [[RichTextEditorBatchConverter alloc] init];
+    converter.sourceFormat = RichTextEditorFileFormatPlainText;
+    RichTextEditorBatchConversionReport *report = [self runConverter:converter from:sourceURL to:[self.directoryURL URLByAppendingPathComponent:@"destination"]];
+    XCTAssertEqual(report.convertedCount, (NSUInteger)1);
+    XCTAssertEqual(report.failedCount, (NSUInteger)1);
+    XCTAssertEqual(report.failures.count, (NSUInteger)1);
+    XCTAssertTrue([report.failures[0].userInfo[NSFilePathErrorKey] hasSuffix:@"broken.txt"]);
+    XCTAssertEqual([report.snapshot[@"failures"] count], (NSUInteger)1);
+    XCTAssertNotNil([report JSONData]);
+}
+
+- (void)testPlainTextGetsEditorAttributes {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    RichTextEditorBatchConverter *converter = [[RichTextEditorBatchConverter alloc] init];
+    converter.sourceFormat = RichTextEditorFileFormatPlainText;
+    converter.plainTextAttributes = editor.typingAttributes;
+    NSAttributedString *string = [converter attributedStringFromData:[@"one\ntwo" dataUsingEncoding:NSUTF8StringEncoding] error:nil];
+    [editor insertText:@"one\ntwo" replacementRange:NSMakeRange(0, 0)];
+    XCTAssertTrue([string isEqualToAttributedString:editor.attributedString]);
+}
+
+#pragma mark - Normalizing
+
+- (void)testNormalizedBulletsMatchToggledBullets {
+    NSDictionary *attributes = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:14]};
+    RichTextEditorDocument *toggled = [[RichTextEditorDocument alloc] initWithAttributedString:
+                                       [[NSAttributedString alloc] initWithString:@"one\ntwo" attributes:attributes]];
+    toggled.selectedRange = NSMakeRange(0, toggled.textStorage.length);
+    [toggled toggleBullets];
+
+    RichTextEditorDocument *normalized = [[RichTextEditorDocument alloc] initWithAttributedString:
+                                          [[NSAttributedString alloc] initWithString:@"- one\n\u2022 two" attributes:attributes]];
+    XCTAssertEqual([normalized normalizeBulletsWithListMarkers:[RichTextEditorDocument commonListMarkers]], (NSUInteger)2);
+    XCTAssertTrue([normalized.textStorage isEqualToAttributedString:toggled.textStorage]);
+    // Already normalized
+    XCTAssertEqual([normalized normalizeBulletsWithListMarkers:[RichTextEditorDocument commonListMarkers]], (NSUInteger)0);
+}
+
+- (void)testNormalizeIndentationAndColors {
+    NSMutableParagraphStyle *paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+    paragraphStyle.firstLineHeadIndent = 37;
+    paragraphStyle.headIndent = 1000;
+    NSDictionary *attributes = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:14],
+                                 NSParagraphStyleAttributeName: paragraphStyle,
+                                 NSBackgroundColorAttributeName: [NSColor yellowColor]};
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:
+                                        [[NSAttributedString alloc] initWithString:@"indented" attributes:attributes]];
+    document.defaultIndentationSize = 10;
+    document.maximumIndentation = 95;
+    XCTAssertEqual([document normalizeIndentation], (NSUInteger)1);
+    NSParagraphStyle *normalizedStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(normalizedStyle.firstLineHeadIndent, 40);
+    XCTAssertEqual(normalizedStyle.headIndent, 100);
+    XCTAssertEqual([document normalizeIndentation], (NSUInteger)0);
+
+    [document removeColors];
+    XCTAssertNil([document.textStorage attribute:NSBackgroundColorAttributeName atIndex:0 effectiveRange:NULL]);
+    XCTAssertNil(document.typingAttributes[NSBackgroundColorAttributeName]);
+}
+
+- (void)testConverterNormalizes {
+    RichTextEditorBatchConverter *converter = [[RichTextEditorBatchConverter alloc] init];
+    converter.normalizesBullets = YES;
+    converter.removesColors = YES;
+    NSAttributedString *string = [converter normalizedAttributedString:[RichTextEditorBatchConverterTests noteWithIndex:0]];
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] init];
+    XCTAssertTrue([string.string containsString:[document.bulletString stringByAppendingString:@"first point"]]);
+    [string enumerateAttribute:NSForegroundColorAttributeName inRange:NSMakeRange(0, string.length) options:0 usingBlock:^(id value, NSRange range, BOOL *stop) {
+        XCTAssertNil(value);
+    }];
+}
+
+#pragma mark - Benchmarks
+
+// 400 notes, HTML to HTML with every clean up, on all cores
+- (void)testPerformanceConvertDirectory {
+    NSURL *sourceURL = [self writeHTMLNotes:400];
+    RichTextEditorBatchConverter *converter = [[RichTextEditorBatchConverter alloc] init];
+    converter.resumes = NO;
+    converter.normalizesBullets = YES;
+    converter.normalizesIndentation = YES;
+    converter.removesColors = YES;
+    __block NSUInteger run = 0;
+    [self measureBlock:^{
+        NSURL *destinationURL = [self.directoryURL URLByAppendingPathComponent:[NSString stringWithFormat:@"destination%lu", (unsigned long)run++]];
+        RichTextEditorBatchConversionReport *report = [self runConverter:converter from:sourceURL to:destinationURL];
+        XCTAssertEqual(report.convertedCount, (NSUInteger)400);
+    }];
+    NSLog(@"[RTE] batch conversion: %@", [[NSString alloc] initWithData:[converter.report JSONData] encoding:NSUTF8StringEncoding]);
+}
+
+@end
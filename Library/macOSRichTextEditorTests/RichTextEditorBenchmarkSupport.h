@@ -0,0 +1,51 @@
+//
+//  RichTextEditorBenchmarkSupport.h
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+@class RichTextEditor;
+
+/// Synthetic documents and latency/allocation bookkeeping for RichTextEditorBenchmarks.
+///
+/// Each operation is timed one iteration at a time so that p50/p99 can be reported, not just
+/// an average. Results are collected per run and written as JSON (see writeResults) so that
+/// two commits can be compared with a script instead of by reading Xcode's measureBlock output.
+///
+/// Environment variables:
+///   RTE_BENCHMARK_PARAGRAPHS  comma separated document sizes, e.g. "1000,100000,1000000" (default "1000,10000")
+///   RTE_BENCHMARK_OUTPUT      path of the JSON file to write (default: a file in NSTemporaryDirectory())
+///   RTE_BENCHMARK_COMMIT      commit identifier stored in the results (optional)
+@interface RichTextEditorBenchmarkSupport : NSObject
+
+/// Shared recorder; all benchmark test cases in a run add to the same results.
++ (instancetype)sharedSupport;
+
+/// Document sizes (in paragraphs) to run every benchmark at.
++ (NSArray<NSNumber *> *)paragraphCounts;
+
+/// A document with paragraphCount paragraphs of mixed runs (plain, bold, italic, underline,
+/// colored, a second font size) where every fifth paragraph starts a bulleted list that nests
+/// up to maximumListDepth levels. The same count always gives the same document.
++ (NSAttributedString *)documentWithParagraphCount:(NSUInteger)paragraphCount maximumListDepth:(NSUInteger)maximumListDepth;
+
+/// An editor that is never put in a window, holding document. Layout is done lazily by the
+/// NSLayoutManager as usual, so the numbers are for the text system work without drawing.
++ (RichTextEditor *)headlessEditorWithDocument:(NSAttributedString *)document;
+
+/// Runs block iterations times (after warmupIterations untimed runs), timing each call and
+/// sampling the malloc statistics around it, and adds the result under name and paragraphCount.
+/// Returns the result dictionary that will be written out.
+- (NSDictionary *)measureOperation:(NSString *)name
+                    paragraphCount:(NSUInteger)paragraphCount
+                        iterations:(NSUInteger)iterations
+                  warmupIterations:(NSUInteger)warmupIterations
+                             block:(void (^)(NSUInteger iteration))block;
+
+/// Writes everything measured so far to the output file. Returns the path, or nil on failure.
+- (NSString *)writeResults;
+
+@end
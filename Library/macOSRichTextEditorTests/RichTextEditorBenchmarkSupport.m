@@ -0,0 +1,237 @@
+//
+//  RichTextEditorBenchmarkSupport.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorBenchmarkSupport.h"
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import <mach/mach_time.h>
+#import <malloc/malloc.h>
+#include <sys/sysctl.h>
+
+static NSString *const RTEBenchmarkWords[] = {
+    @"lorem", @"ipsum", @"dolor", @"sit", @"amet", @"consectetur", @"adipiscing", @"elit",
+    @"sed", @"do", @"eiusmod", @"tempor", @"incididunt", @"ut", @"labore", @"et"
+};
+
+static double RTEPercentile(NSArray<NSNumber *> *sortedValues, double percentile) {
+    if (sortedValues.count == 0) {
+        return 0;
+    }
+    // Nearest rank
+    NSUInteger rank = (NSUInteger)ceil(percentile * sortedValues.count);
+    return sortedValues[MAX(rank, (NSUInteger)1) - 1].doubleValue;
+}
+
+@interface RichTextEditorBenchmarkSupport ()
+
+@property NSMutableArray *results;
+@property double nanosecondsPerTick;
+
+@end
+
+@implementation RichTextEditorBenchmarkSupport
+
++ (instancetype)sharedSupport {
+    static RichTextEditorBenchmarkSupport *support = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        support = [[RichTextEditorBenchmarkSupport alloc] init];
+    });
+    return support;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _results = [NSMutableArray array];
+        mach_timebase_info_data_t timebase;
+        mach_timebase_info(&timebase);
+        _nanosecondsPerTick = (double)timebase.numer / (double)timebase.denom;
+    }
+    return self;
+}
+
++ (NSArray<NSNumber *> *)paragraphCounts {
+    NSString *setting = [[NSProcessInfo processInfo] environment][@"RTE_BENCHMARK_PARAGRAPHS"];
+    if (setting.length == 0) {
+        return @[@1000, @10000];
+    }
+    NSMutableArray *counts = [NSMutableArray array];
+    for (NSString *component in [setting componentsSeparatedByString:@","]) {
+        NSInteger count = [component integerValue];
+        if (count > 0) {
+            [counts addObject:@(count)];
+        }
+    }
+    return counts;
+}
+
+#pragma mark - Documents -
+
++ (NSAttributedString *)documentWithParagraphCount:(NSUInteger)paragraphCount maximumListDepth:(NSUInteger)maximumListDepth {
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:12];
+    NSFont *largeFont = [NSFont fontWithName:@"Helvetica" size:18];
+    NSFont *boldFont = [[NSFontManager sharedFontManager] convertFont:font toHaveTrait:NSBoldFontMask];
+    NSFont *italicFont = [[NSFontManager sharedFontManager] convertFont:font toHaveTrait:NSItalicFontMask];
+    NSDictionary *runAttributes[] = {
+        @{NSFontAttributeName: font},
+        @{NSFontAttributeName: boldFont},
+        @{NSFontAttributeName: italicFont},
+        @{NSFontAttributeName: font, NSUnderlineStyleAttributeName: @(NSUnderlineStyleSingle)},
+        @{NSFontAttributeName: font, NSForegroundColorAttributeName: [NSColor redColor]},
+        @{NSFontAttributeName: largeFont},
+    };
+    NSUInteger runAttributeCount = sizeof(runAttributes) / sizeof(runAttributes[0]);
+    NSUInteger wordCount = sizeof(RTEBenchmarkWords) / sizeof(RTEBenchmarkWords[0]);
+    NSMutableParagraphStyle *plainStyle = [[NSMutableParagraphStyle alloc] init];
+    NSMutableArray *listStyles = [NSMutableArray array];
+    for (NSUInteger depth = 0; depth < MAX(maximumListDepth, (NSUInteger)1); depth++) {
+        NSMutableParagraphStyle *style = [[NSMutableParagraphStyle alloc] init];
+        style.headIndent = 15.0 * (depth + 1);
+        style.firstLineHeadIndent = 15.0 * (depth + 1);
+        [listStyles addObject:style];
+    }
+
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] init];
+    [document beginEditing];
+    uint32_t seed = 12345;
+    NSUInteger listDepth = 0;
+    BOOL isInList = NO;
+    for (NSUInteger paragraph = 0; paragraph < paragraphCount; paragraph++) {
+        if (paragraph % 5 == 0) {
+            isInList = maximumListDepth > 0 && !isInList;
+            listDepth = 0;
+        }
+        NSUInteger start = document.length;
+        if (isInList) {
+            [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"\u2022\u00A0" attributes:runAttributes[0]]];
+        }
+        NSUInteger runs = 2 + paragraph % 4;
+        for (NSUInteger run = 0; run < runs; run++) {
+            NSMutableString *text = [NSMutableString string];
+            NSUInteger words = 2 + (seed >> 8) % 6;
+            for (NSUInteger word = 0; word < words; word++) {
+                seed = seed * 1103515245 + 12345; // fixed LCG so documents are the same every run
+                [text appendString:RTEBenchmarkWords[(seed >> 16) % wordCount]];
+                [text appendString:@" "];
+            }
+            [document appendAttributedString:[[NSAttributedString alloc] initWithString:text attributes:runAttributes[(paragraph + run) % runAttributeCount]]];
+        }
+        [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"\n" attributes:runAttributes[0]]];
+        NSParagraphStyle *style = isInList ? listStyles[MIN(listDepth, listStyles.count - 1)] : plainStyle;
+        [document addAttribute:NSParagraphStyleAttributeName value:style range:NSMakeRange(start, document.length - start)];
+        if (isInList && listDepth + 1 < maximumListDepth) {
+            listDepth++;
+        }
+    }
+    [document endEditing];
+    return document;
+}
+
++ (RichTextEditor *)headlessEditorWithDocument:(NSAttributedString *)document {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 600, 800)];
+    [editor changeToAttributedString:document];
+    editor.selectedRange = NSMakeRange(0, 0);
+    return editor;
+}
+
+#pragma mark - Measuring -
+
+- (NSDictionary *)measureOperation:(NSString *)name
+                    paragraphCount:(NSUInteger)paragraphCount
+                        iterations:(NSUInteger)iterations
+                  warmupIterations:(NSUInteger)warmupIterations
+                             block:(void (^)(NSUInteger iteration))block {
+    for (NSUInteger i = 0; i < warmupIterations; i++) {
+        @autoreleasepool {
+            block(i);
+        }
+    }
+    NSMutableArray<NSNumber *> *durations = [NSMutableArray arrayWithCapacity:iterations];
+    unsigned long long allocatedBytes = 0;
+    unsigned long long allocatedBlocks = 0;
+    for (NSUInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            // Sampled before the pool drains so autoreleased temporaries are counted. malloc only
+            // keeps bytes/blocks in use, so this is growth during the call, not a count of every
+            // malloc -- memory allocated and freed inside the call is not seen.
+            malloc_statistics_t before, after;
+            malloc_zone_statistics(NULL, &before);
+            uint64_t start = mach_absolute_time();
+            block(warmupIterations + i);
+            uint64_t end = mach_absolute_time();
+            malloc_zone_statistics(NULL, &after);
+            [durations addObject:@((end - start) * self.nanosecondsPerTick / 1000.0)];
+            if (after.size_in_use > before.size_in_use) {
+                allocatedBytes += after.size_in_use - before.size_in_use;
+            }
+            if (after.blocks_in_use > before.blocks_in_use) {
+                allocatedBlocks += after.blocks_in_use - before.blocks_in_use;
+            }
+        }
+    }
+    NSArray<NSNumber *> *sorted = [durations sortedArrayUsingSelector:@selector(compare:)];
+    double total = 0;
+    for (NSNumber *duration in durations) {
+        total += duration.doubleValue;
+    }
+    NSDictionary *result = @{@"operation": name,
+                             @"paragraphs": @(paragraphCount),
+                             @"iterations": @(iterations),
+                             @"meanMicroseconds": @(iterations > 0 ? total / iterations : 0),
+                             @"p50Microseconds": @(RTEPercentile(sorted, 0.50)),
+                             @"p99Microseconds": @(RTEPercentile(sorted, 0.99)),
+                             @"maxMicroseconds": sorted.lastObject ?: @0,
+                             @"allocatedBytesPerIteration": @(iterations > 0 ? allocatedBytes / iterations : 0),
+                             @"allocatedBlocksPerIteration": @(iterations > 0 ? allocatedBlocks / iterations : 0)};
+    @synchronized (self.results) {
+        [self.results addObject:result];
+    }
+    NSLog(@"[RTE] %@ (%lu paragraphs): p50 %.1f us, p99 %.1f us, %llu bytes/op", name, (unsigned long)paragraphCount,
+          [result[@"p50Microseconds"] doubleValue], [result[@"p99Microseconds"] doubleValue],
+          [result[@"allocatedBytesPerIteration"] unsignedLongLongValue]);
+    return result;
+}
+
+- (NSString *)machineModel {
+    char model[256];
+    size_t size = sizeof(model);
+    if (sysctlbyname("hw.model", model, &size, NULL, 0) != 0) {
+        return @"unknown";
+    }
+    return [NSString stringWithUTF8String:model];
+}
+
+- (NSString *)writeResults {
+    NSDictionary *environment = [[NSProcessInfo processInfo] environment];
+    NSString *path = environment[@"RTE_BENCHMARK_OUTPUT"];
+    if (path.length == 0) {
+        NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+        formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        formatter.dateFormat = @"yyyyMMdd-HHmmss";
+        NSString *fileName = [NSString stringWithFormat:@"rte-benchmarks-%@.json", [formatter stringFromDate:[NSDate date]]];
+        path = [NSTemporaryDirectory() stringByAppendingPathComponent:fileName];
+    }
+    NSArray *results;
+    @synchronized (self.results) {
+        results = [self.results copy];
+    }
+    NSDictionary *report = @{@"formatVersion": @1,
+                             @"commit": environment[@"RTE_BENCHMARK_COMMIT"] ?: @"",
+                             @"date": @([[NSDate date] timeIntervalSince1970]),
+                             @"machine": [self machineModel],
+                             @"osVersion": [[NSProcessInfo processInfo] operatingSystemVersionString],
+                             @"results": results};
+    NSError *error = nil;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:&error];
+    if (!data || ![data writeToFile:path options:NSDataWritingAtomic error:&error]) {
+        NSLog(@"[RTE] Unable to write benchmark results to %@: %@", path, error);
+        return nil;
+    }
+    NSLog(@"[RTE] Benchmark results written to %@", path);
+    return path;
+}
+
+@end
@@ -0,0 +1,209 @@
+//
+//  RichTextEditorBenchmarks.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+// Latency of the operations users trigger, on synthetic documents of increasing size.
+// Every editor here is headless (never in a window). Results are written as JSON when the
+// class finishes; see RichTextEditorBenchmarkSupport.h for the environment variables.
+@interface RichTextEditorBenchmarks : XCTestCase
+
+@end
+
+@implementation RichTextEditorBenchmarks
+
++ (void)tearDown {
+    [[RichTextEditorBenchmarkSupport sharedSupport] writeResults];
+    [super tearDown];
+}
+
+// Fewer iterations for the big documents so a 1M paragraph run still finishes
+- (NSUInteger)iterationsForParagraphCount:(NSUInteger)paragraphCount base:(NSUInteger)base {
+    NSUInteger iterations = base;
+    for (NSUInteger count = paragraphCount; count > 10000 && iterations > 5; count /= 10) {
+        iterations /= 4;
+    }
+    return MAX(iterations, (NSUInteger)5);
+}
+
+- (void)runBenchmark:(NSString *)name baseIterations:(NSUInteger)baseIterations
+          usingBlock:(void (^)(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration))block {
+    RichTextEditorBenchmarkSupport *support = [RichTextEditorBenchmarkSupport sharedSupport];
+    for (NSNumber *count in [RichTextEditorBenchmarkSupport paragraphCounts]) {
+        NSUInteger paragraphCount = count.unsignedIntegerValue;
+        @autoreleasepool {
+            NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:paragraphCount maximumListDepth:4];
+            RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:document];
+            NSUInteger iterations = [self iterationsForParagraphCount:paragraphCount base:baseIterations];
+            NSDictionary *result = [support measureOperation:name paragraphCount:paragraphCount iterations:iterations
+                                            warmupIterations:MIN(iterations / 10, (NSUInteger)5) block:^(NSUInteger iteration) {
+                block(editor, paragraphCount, iteration);
+            }];
+            XCTAssertGreaterThan([result[@"p99Microseconds"] doubleValue], 0);
+        }
+    }
+}
+
+// A location spread over the document that is different on every iteration
+- (NSUInteger)locationInEditor:(RichTextEditor *)editor iteration:(NSUInteger)iteration {
+    return (iteration * 7919 + 13) % MAX(editor.string.length, (NSUInteger)1);
+}
+
+- (void)testDocumentGenerator {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:100 maximumListDepth:3];
+    NSAttributedString *again = [RichTextEditorBenchmarkSupport documentWithParagraphCount:100 maximumListDepth:3];
+    XCTAssertTrue([document isEqualToAttributedString:again]);
+    XCTAssertEqual([document.string componentsSeparatedByString:@"\n"].count, (NSUInteger)101);
+    XCTAssertTrue([document.string containsString:@"\u2022\u00A0"]);
+}
+
+- (void)testBenchmarkTyping {
+    [self runBenchmark:@"typing" baseIterations:400 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        if (iteration % 40 == 0) {
+            editor.selectedRange = NSMakeRange([self locationInEditor:editor iteration:iteration], 0);
+        }
+        // Goes through shouldChangeTextInRange: and textDidChange: like a key press
+        [editor insertText:(iteration % 8 == 7 ? @" " : @"a") replacementRange:editor.selectedRange];
+    }];
+}
+
+- (void)testBenchmarkSelectionMoves {
+    [self runBenchmark:@"selection" baseIterations:2000 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        NSUInteger location = [self locationInEditor:editor iteration:iteration];
+        NSUInteger length = iteration % 3 == 0 ? MIN((NSUInteger)50, editor.string.length - location) : 0;
+        [editor setSelectedRange:NSMakeRange(location, length) affinity:NSSelectionAffinityDownstream stillSelecting:NO];
+    }];
+}
+
+- (void)testBenchmarkBulletToggle {
+    [self runBenchmark:@"userSelectedBullet" baseIterations:200 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        // Toggle the same paragraphs on and off so the document doesn't drift
+        if (iteration % 2 == 0) {
+            editor.selectedRange = NSMakeRange([self locationInEditor:editor iteration:iteration / 2], 0);
+        }
+        [editor userSelectedBullet];
+    }];
+}
+
+- (void)testBenchmarkIndentation {
+    [self runBenchmark:@"indentation" baseIterations:400 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        if (iteration % 2 == 0) {
+            NSUInteger location = [self locationInEditor:editor iteration:iteration / 2];
+            editor.selectedRange = NSMakeRange(location, MIN((NSUInteger)200, editor.string.length - location));
+            [editor userSelectedIncreaseIndent];
+        }
+        else {
+            [editor userSelectedDecreaseIndent];
+        }
+    }];
+}
+
+- (void)testBenchmarkIncreaseFontSize {
+    [self runBenchmark:@"increaseFontSize" baseIterations:400 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        if (iteration % 2 == 0) {
+            NSUInteger location = [self locationInEditor:editor iteration:iteration / 2];
+            editor.selectedRange = NSMakeRange(location, MIN((NSUInteger)200, editor.string.length - location));
+            [editor increaseFontSize];
+        }
+        else {
+            [editor decreaseFontSize];
+        }
+    }];
+}
+
+- (void)testBenchmarkChangeToFont {
+    NSArray *fonts = @[[NSFont fontWithName:@"Times New Roman" size:12], [NSFont fontWithName:@"Helvetica" size:12]];
+    [self runBenchmark:@"changeToFont" baseIterations:40 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        [editor changeToFont:fonts[iteration % fonts.count]];
+    }];
+}
+
+- (void)testBenchmarkHTMLString {
+    [self runBenchmark:@"htmlString" baseIterations:20 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        XCTAssertGreaterThan([editor htmlString].length, (NSUInteger)0);
+    }];
+}
+
+- (void)testBenchmarkSetHTMLString {
+    RichTextEditorBenchmarkSupport *support = [RichTextEditorBenchmarkSupport sharedSupport];
+    for (NSNumber *count in [RichTextEditorBenchmarkSupport paragraphCounts]) {
+        NSUInteger paragraphCount = count.unsignedIntegerValue;
+        @autoreleasepool {
+            NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:paragraphCount maximumListDepth:4];
+            NSString *html = [RichTextEditor htmlStringFromAttributedText:document];
+            RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] init]];
+            [support measureOperation:@"setHtmlString" paragraphCount:paragraphCount
+                           iterations:[self iterationsForParagraphCount:paragraphCount base:20] warmupIterations:1 block:^(NSUInteger iteration) {
+                [editor setHtmlString:html];
+            }];
+            XCTAssertGreaterThan(editor.string.length, (NSUInteger)0);
+        }
+    }
+}
+
+- (void)testBenchmarkMarkdownString {
+    [self runBenchmark:@"markdownString" baseIterations:20 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        XCTAssertGreaterThan([editor markdownString].length, (NSUInteger)0);
+    }];
+}
+
+- (void)testBenchmarkSetMarkdownString {
+    RichTextEditorBenchmarkSupport *support = [RichTextEditorBenchmarkSupport sharedSupport];
+    for (NSNumber *count in [RichTextEditorBenchmarkSupport paragraphCounts]) {
+        NSUInteger paragraphCount = count.unsignedIntegerValue;
+        @autoreleasepool {
+            NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:paragraphCount maximumListDepth:4];
+            NSString *markdown = [[[RichTextEditorMarkdownWriter alloc] initWithAttributedString:document] markdownString];
+            RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] init]];
+            [support measureOperation:@"setMarkdownString" paragraphCount:paragraphCount
+                           iterations:[self iterationsForParagraphCount:paragraphCount base:20] warmupIterations:1 block:^(NSUInteger iteration) {
+                [editor setMarkdownString:markdown];
+            }];
+            XCTAssertGreaterThan(editor.string.length, (NSUInteger)0);
+        }
+    }
+}
+
+- (void)testBenchmarkBinaryDocumentData {
+    [self runBenchmark:@"binaryDocumentData" baseIterations:20 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        XCTAssertGreaterThan([editor binaryDocumentData].length, (NSUInteger)0);
+    }];
+}
+
+- (void)testBenchmarkRTFData {
+    [self runBenchmark:@"rtfData" baseIterations:20 usingBlock:^(RichTextEditor *editor, NSUInteger paragraphCount, NSUInteger iteration) {
+        XCTAssertGreaterThan([editor RTFFromRange:NSMakeRange(0, editor.string.length)].length, (NSUInteger)0);
+    }];
+}
+
+// Loading the same document from each format into an empty editor
+- (void)testBenchmarkLoadFormats {
+    RichTextEditorBenchmarkSupport *support = [RichTextEditorBenchmarkSupport sharedSupport];
+    for (NSNumber *count in [RichTextEditorBenchmarkSupport paragraphCounts]) {
+        NSUInteger paragraphCount = count.unsignedIntegerValue;
+        @autoreleasepool {
+            NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:paragraphCount maximumListDepth:4];
+            NSData *binary = [RichTextEditorBinaryDocument dataWithAttributedString:document];
+            NSData *rtf = [document RTFFromRange:NSMakeRange(0, document.length) documentAttributes:@{}];
+            NSLog(@"[RTE] %lu paragraphs: binary %lu bytes, RTF %lu bytes", (unsigned long)paragraphCount,
+                  (unsigned long)binary.length, (unsigned long)rtf.length);
+            RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] init]];
+            NSUInteger iterations = [self iterationsForParagraphCount:paragraphCount base:20];
+            [support measureOperation:@"setBinaryDocumentData" paragraphCount:paragraphCount iterations:iterations warmupIterations:1 block:^(NSUInteger iteration) {
+                [editor setBinaryDocumentData:binary error:nil];
+            }];
+            XCTAssertEqual(editor.string.length, document.length);
+            [support measureOperation:@"setRTFData" paragraphCount:paragraphCount iterations:iterations warmupIterations:1 block:^(NSUInteger iteration) {
+                [editor replaceCharactersInRange:NSMakeRange(0, editor.string.length) withRTF:rtf];
+            }];
+        }
+    }
+}
+
+@end
@@ -0,0 +1,223 @@
+//
+//  RichTextEditorBinaryDocumentTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorBinaryDocumentTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorBinaryDocumentTests
+
+- (NSAttributedString *)richDocument {
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] init];
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:13];
+    NSMutableParagraphStyle *listStyle = [[NSMutableParagraphStyle alloc] init];
+    listStyle.firstLineHeadIndent = 15;
+    listStyle.headIndent = 30;
+    listStyle.alignment = NSTextAlignmentRight;
+    listStyle.lineSpacing = 2.5;
+    listStyle.tabStops = @[[[NSTextTab alloc] initWithTextAlignment:NSTextAlignmentLeft location:42 options:@{}]];
+    listStyle.textLists = @[[[NSTextList alloc] initWithMarkerFormat:@"{disc}" options:0]];
+    [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"Plain "
+                                                                     attributes:@{NSFontAttributeName: font}]];
+    [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"bold red"
+                                                                     attributes:@{NSFontAttributeName: [NSFont fontWithName:@"Helvetica-Bold" size:13],
+                                                                                  NSForegroundColorAttributeName: [NSColor colorWithSRGBRed:0.8 green:0.1 blue:0.2 alpha:1]}]];
+    [document appendAttributedString:[[NSAttributedString alloc] initWithString:@" underlined, highlighted\n"
+                                                                     attributes:@{NSFontAttributeName: font,
+                                                                                  NSUnderlineStyleAttributeName: @(NSUnderlineStyleSingle),
+                                                                                  NSBackgroundColorAttributeName: [NSColor colorWithSRGBRed:1 green:1 blue:0 alpha:0.5]}]];
+    [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"\u2022 list item with \U0001F600 and a link\n"
+                                                                     attributes:@{NSFontAttributeName: font,
+                                                                                  NSParagraphStyleAttributeName: listStyle}]];
+    [document addAttribute:NSLinkAttributeName value:[NSURL URLWithString:@"https://example.com/a?b=c"]
+                     range:NSMakeRange(document.length - 5, 4)];
+    [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"struck"
+                                                                     attributes:@{NSFontAttributeName: [NSFont fontWithName:@"Times New Roman" size:20],
+                                                                                  NSStrikethroughStyleAttributeName: @(NSUnderlineStyleDouble),
+                                                                                  NSSuperscriptAttributeName: @1,
+                                                                                  NSKernAttributeName: @1.5}]];
+    return document;
+}
+
+- (NSAttributedString *)roundTrip:(NSAttributedString *)string {
+    NSError *error = nil;
+    RichTextEditorBinaryDocument *document = [[RichTextEditorBinaryDocument alloc] initWithData:[RichTextEditorBinaryDocument dataWithAttributedString:string]
+                                                                                          error:&error];
+    XCTAssertNotNil(document, @"%@", error);
+    NSAttributedString *result = [document attributedStringWithError:&error];
+    XCTAssertNotNil(result, @"%@", error);
+    return result;
+}
+
+- (void)testRoundTrip {
+    NSAttributedString *original = [self richDocument];
+    NSAttributedString *result = [self roundTrip:original];
+    XCTAssertEqualObjects(result.string, original.string);
+    XCTAssertTrue([result isEqualToAttributedString:original]);
+}
+
+- (void)testEmptyDocument {
+    NSAttributedString *result = [self roundTrip:[[NSAttributedString alloc] init]];
+    XCTAssertEqual(result.length, (NSUInteger)0);
+}
+
+- (void)testAttributeTableIsInterned {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:2000 maximumListDepth:4];
+    RichTextEditorBinaryDocument *binary = [[RichTextEditorBinaryDocument alloc] initWithData:[RichTextEditorBinaryDocument dataWithAttributedString:document] error:nil];
+    XCTAssertEqual(binary.length, document.length);
+    XCTAssertGreaterThan(binary.runCount, (NSUInteger)2000);
+    XCTAssertLessThan(binary.attributeTableCount, (NSUInteger)100);
+    XCTAssertTrue([[binary attributedStringWithError:nil] isEqualToAttributedString:document]);
+}
+
+- (void)testSubstringOnlyDecodesRange {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:500 maximumListDepth:3];
+    RichTextEditorBinaryDocument *binary = [[RichTextEditorBinaryDocument alloc] initWithData:[RichTextEditorBinaryDocument dataWithAttributedString:document] error:nil];
+    for (NSUInteger location = 0; location < document.length; location += 997) {
+        NSRange range = NSMakeRange(location, MIN((NSUInteger)300, document.length - location));
+        NSAttributedString *substring = [binary attributedSubstringFromRange:range error:nil];
+        XCTAssertTrue([substring isEqualToAttributedString:[document attributedSubstringFromRange:range]], @"%@", NSStringFromRange(range));
+    }
+    XCTAssertEqual([binary attributedSubstringFromRange:NSMakeRange(document.length + 10, 5) error:nil].length, (NSUInteger)0);
+}
+
+- (void)testRejectsBadData {
+    NSData *data = [RichTextEditorBinaryDocument dataWithAttributedString:[self richDocument]];
+    NSError *error = nil;
+    XCTAssertNil([[RichTextEditorBinaryDocument alloc] initWithData:[@"<html>" dataUsingEncoding:NSUTF8StringEncoding] error:&error]);
+    XCTAssertEqual(error.code, NSFileReadCorruptFileError);
+    XCTAssertNil([[RichTextEditorBinaryDocument alloc] initWithData:[NSData data] error:nil]);
+    // Every truncation either fails to open or fails to decode; none of them crash
+    for (NSUInteger length = 0; length < data.length; length += 7) {
+        RichTextEditorBinaryDocument *document = [[RichTextEditorBinaryDocument alloc] initWithData:[data subdataWithRange:NSMakeRange(0, length)] error:nil];
+        XCTAssertNil(document, @"%lu", (unsigned long)length);
+    }
+    NSMutableData *newer = [data mutableCopy];
+    uint16_t version = CFSwapInt16HostToLittle(RTE_BINARY_DOCUMENT_VERSION + 1);
+    [newer replaceBytesInRange:NSMakeRange(4, sizeof(version)) withBytes:&version];
+    XCTAssertNil([[RichTextEditorBinaryDocument alloc] initWithData:newer error:&error]);
+}
+
+- (void)testCorruptAttributeEntriesFailToDecode {
+    NSMutableData *data = [[RichTextEditorBinaryDocument dataWithAttributedString:[self richDocument]] mutableCopy];
+    RichTextEditorBinaryDocument *document = [[RichTextEditorBinaryDocument alloc] initWithData:data error:nil];
+    XCTAssertNotNil(document);
+    // Scribble over everything after the text; decoding must fail cleanly or still produce the same text
+    uint8_t *bytes = data.mutableBytes;
+    NSUInteger textEnd = 56 + document.length * sizeof(unichar); // header, then the text
+    for (NSUInteger i = textEnd; i < data.length; i += 3) {
+        bytes[i] ^= 0x5A;
+    }
+    RichTextEditorBinaryDocument *corrupt = [[RichTextEditorBinaryDocument alloc] initWithData:data error:nil];
+    NSAttributedString *result = [corrupt attributedStringWithError:nil];
+    if (result) {
+        XCTAssertEqualObjects(result.string, [self richDocument].string);
+    }
+}
+
+- (void)testEditorSaveAndLoad {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[self richDocument]];
+    NSURL *url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+    NSError *error = nil;
+    XCTAssertTrue([editor saveBinaryDocumentToURL:url error:&error], @"%@", error);
+    RichTextEditor *other = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    XCTAssertTrue([other loadBinaryDocumentFromURL:url error:&error], @"%@", error);
+    XCTAssertTrue([other.attributedString isEqualToAttributedString:editor.attributedString]);
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+
+    XCTAssertFalse([other setBinaryDocumentData:[NSData dataWithBytes:"RTEB" length:4] error:&error]);
+    XCTAssertTrue([other.attributedString isEqualToAttributedString:editor.attributedString]);
+    XCTAssertTrue([other setBinaryDocumentData:[editor binaryDocumentData] error:&error]);
+}
+
+- (void)testCopyPasteBetweenEditorsKeepsAttributes {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[self richDocument]];
+    editor.selectedRange = NSMakeRange(6, 30);
+    [editor copy:nil];
+    NSData *data = [[NSPasteboard generalPasteboard] dataForType:[RichTextEditor pasteboardDataType]];
+    XCTAssertGreaterThan(data.length, (NSUInteger)0);
+
+    RichTextEditor *other = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [other changeToAttributedString:[[NSAttributedString alloc] initWithString:@"ab"]];
+    other.selectedRange = NSMakeRange(1, 0);
+    [other paste:nil];
+    XCTAssertTrue([[other.attributedString attributedSubstringFromRange:NSMakeRange(1, 30)]
+                   isEqualToAttributedString:[editor.attributedString attributedSubstringFromRange:NSMakeRange(6, 30)]]);
+    XCTAssertTrue(NSEqualRanges(other.selectedRange, NSMakeRange(31, 0)));
+}
+
+#pragma mark - Benchmarks
+
+- (NSAttributedString *)benchmarkDocument {
+    return [RichTextEditorBenchmarkSupport documentWithParagraphCount:20000 maximumListDepth:4];
+}
+
+- (NSData *)rtfDataFromString:(NSAttributedString *)string {
+    return [string RTFFromRange:NSMakeRange(0, string.length) documentAttributes:@{}];
+}
+
+- (void)testDocumentSizes {
+    NSAttributedString *document = [self benchmarkDocument];
+    NSUInteger binarySize = [RichTextEditorBinaryDocument dataWithAttributedString:document].length;
+    NSUInteger rtfSize = [self rtfDataFromString:document].length;
+    NSUInteger htmlSize = [[RichTextEditor htmlStringFromAttributedText:document] lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    NSLog(@"[RTE] 20000 paragraphs: binary %lu bytes, RTF %lu bytes, HTML %lu bytes",
+          (unsigned long)binarySize, (unsigned long)rtfSize, (unsigned long)htmlSize);
+    XCTAssertGreaterThan(binarySize, (NSUInteger)0);
+}
+
+- (void)testPerformanceSaveBinary {
+    NSAttributedString *document = [self benchmarkDocument];
+    [self measureBlock:^{
+        [RichTextEditorBinaryDocument dataWithAttributedString:document];
+    }];
+}
+
+- (void)testPerformanceSaveRTF {
+    NSAttributedString *document = [self benchmarkDocument];
+    [self measureBlock:^{
+        [self rtfDataFromString:document];
+    }];
+}
+
+- (void)testPerformanceSaveHTML {
+    NSAttributedString *document = [self benchmarkDocument];
+    [self measureBlock:^{
+        [RichTextEditor htmlStringFromAttributedText:document];
+    }];
+}
+
+- (void)testPerformanceLoadBinary {
+    NSData *data = [RichTextEditorBinaryDocument dataWithAttributedString:[self benchmarkDocument]];
+    [self measureBlock:^{
+        RichTextEditorBinaryDocument *document = [[RichTextEditorBinaryDocument alloc] initWithData:data error:nil];
+        [document attributedStringWithError:nil];
+    }];
+}
+
+- (void)testPerformanceLoadRTF {
+    NSData *data = [self rtfDataFromString:[self benchmarkDocument]];
+    [self measureBlock:^{
+        NSAttributedString *string = [[NSAttributedString alloc] initWithRTF:data documentAttributes:nil];
+        XCTAssertNotNil(string);
+    }];
+}
+
+- (void)testPerformanceLoadHTML {
+    NSString *html = [RichTextEditor htmlStringFromAttributedText:[self benchmarkDocument]];
+    [self measureBlock:^{
+        [RichTextEditor attributedStringFromHTMLString:html];
+    }];
+}
+
+@end
@@ -0,0 +1,147 @@
+//
+//  RichTextEditorCommandMetricsTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+@interface RichTextEditorCommandMetricsTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorCommandMetricsTests
+
+- (void)spinRunLoop {
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+}
+
+- (RichTextEditor *)editorWithText:(NSString *)text {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    NSDictionary *attributes = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]};
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:text attributes:attributes]];
+    return editor;
+}
+
+- (void)testHistogramBuckets {
+    RichTextEditorCommandMetrics *metrics = [[RichTextEditorCommandMetrics alloc] init];
+    [metrics recordCommandOfType:RichTextEditorPreviewChangeBold duration:0.0000004 charactersTouched:3 attributeRunsTouched:1]; // 0 us
+    [metrics recordCommandOfType:RichTextEditorPreviewChangeBold duration:0.000003 charactersTouched:4 attributeRunsTouched:2];  // 3 us
+    [metrics recordCommandOfType:RichTextEditorPreviewChangeBold duration:0.001 charactersTouched:0 attributeRunsTouched:0];     // 1000 us
+    XCTAssertEqual([metrics countForType:RichTextEditorPreviewChangeBold], (NSUInteger)3);
+    XCTAssertEqual([metrics countForType:RichTextEditorPreviewChangeItalic], (NSUInteger)0);
+    NSArray *histogram = [metrics histogramForType:RichTextEditorPreviewChangeBold];
+    XCTAssertEqual(histogram.count, (NSUInteger)RTE_COMMAND_METRICS_BUCKET_COUNT);
+    XCTAssertEqualObjects(histogram[0], @1);
+    XCTAssertEqualObjects(histogram[2], @1);  // [2, 4)
+    XCTAssertEqualObjects(histogram[10], @1); // [512, 1024)
+
+    NSDictionary *bold = [metrics snapshot][@"commands"][@"bold"];
+    XCTAssertEqualObjects(bold[@"count"], @3);
+    XCTAssertEqualObjects(bold[@"charactersTouched"], @7);
+    XCTAssertEqualObjects(bold[@"attributeRunsTouched"], @3);
+    XCTAssertEqualObjects(bold[@"maxMicroseconds"], @1000);
+    XCTAssertEqualObjects(bold[@"p50Microseconds"], @4);
+    XCTAssertEqualObjects(bold[@"p99Microseconds"], @1024);
+    XCTAssertNil([metrics snapshot][@"commands"][@"italic"]);
+}
+
+- (void)testUnknownTypesAreCountedAsOther {
+    RichTextEditorCommandMetrics *metrics = [[RichTextEditorCommandMetrics alloc] init];
+    [metrics recordCommandOfType:(RichTextEditorPreviewChange)9999 duration:0.01 charactersTouched:0 attributeRunsTouched:0];
+    [metrics recordCommandOfType:(RichTextEditorPreviewChange)-1 duration:0.01 charactersTouched:0 attributeRunsTouched:0];
+    XCTAssertEqualObjects([metrics snapshot][@"commands"][@"other"][@"count"], @2);
+    XCTAssertEqualObjects([RichTextEditorCommandMetrics keyForType:RichTextEditorPreviewChangeIndentIncrease], @"indentIncrease");
+    XCTAssertEqualObjects([RichTextEditorCommandMetrics keyForType:RichTextEditorPreviewChangeFindReplace], @"findReplace");
+}
+
+- (void)testJSONAndReset {
+    RichTextEditorCommandMetrics *metrics = [[RichTextEditorCommandMetrics alloc] init];
+    [metrics recordCommandOfType:RichTextEditorPreviewChangePaste duration:0.02 charactersTouched:100 attributeRunsTouched:5];
+    NSDictionary *parsed = [NSJSONSerialization JSONObjectWithData:[metrics JSONDataWithError:nil] options:0 error:nil];
+    XCTAssertEqualObjects(parsed[@"commands"][@"paste"][@"charactersTouched"], @100);
+    XCTAssertEqual([parsed[@"bucketUpperBoundsMicroseconds"] count], (NSUInteger)RTE_COMMAND_METRICS_BUCKET_COUNT);
+    [metrics reset];
+    XCTAssertEqual([metrics countForType:RichTextEditorPreviewChangePaste], (NSUInteger)0);
+    XCTAssertEqual([[metrics snapshot][@"commands"] count], (NSUInteger)0);
+}
+
+- (void)testConcurrentRecording {
+    RichTextEditorCommandMetrics *metrics = [[RichTextEditorCommandMetrics alloc] init];
+    dispatch_apply(8, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t thread) {
+        for (NSUInteger i = 0; i < 10000; i++) {
+            [metrics recordCommandOfType:RichTextEditorPreviewChangeKeyDown duration:(i % 100) / 1000000.0 charactersTouched:1 attributeRunsTouched:1];
+            if (i % 1000 == 0) {
+                [metrics snapshot];
+            }
+        }
+    });
+    XCTAssertEqual([metrics countForType:RichTextEditorPreviewChangeKeyDown], (NSUInteger)80000);
+    NSUInteger histogramTotal = 0;
+    for (NSNumber *count in [metrics histogramForType:RichTextEditorPreviewChangeKeyDown]) {
+        histogramTotal += count.unsignedIntegerValue;
+    }
+    XCTAssertEqual(histogramTotal, (NSUInteger)80000);
+    XCTAssertEqualObjects([metrics snapshot][@"commands"][@"keyDown"][@"maxMicroseconds"], @99);
+}
+
+- (void)testEditorRecordsCommands {
+    RichTextEditor *editor = [self editorWithText:@"one two three\nfour five six\n"];
+    RichTextEditorCommandMetrics *metrics = [[RichTextEditorCommandMetrics alloc] init];
+    editor.commandMetrics = metrics;
+    editor.selectedRange = NSMakeRange(0, 7);
+    [editor userSelectedBold];
+    [self spinRunLoop];
+    XCTAssertEqual([metrics countForType:RichTextEditorPreviewChangeBold], (NSUInteger)1);
+    NSDictionary *bold = [metrics snapshot][@"commands"][@"bold"];
+    XCTAssertGreaterThanOrEqual([bold[@"charactersTouched"] unsignedIntegerValue], (NSUInteger)7);
+    XCTAssertGreaterThanOrEqual([bold[@"attributeRunsTouched"] unsignedIntegerValue], (NSUInteger)1);
+
+    // Two commands in one run loop turn are measured separately
+    [editor userSelectedItalic];
+    [editor userSelectedIncreaseIndent];
+    [self spinRunLoop];
+    XCTAssertEqual([metrics countForType:RichTextEditorPreviewChangeItalic], (NSUInteger)1);
+    XCTAssertEqual([metrics countForType:RichTextEditorPreviewChangeIndentIncrease], (NSUInteger)1);
+}
+
+- (void)testEditorCountsEditsAfterTextStorageIsReplaced {
+    RichTextEditor *editor = [self editorWithText:@"one two three\n"];
+    RichTextEditorCommandMetrics *metrics = [[RichTextEditorCommandMetrics alloc] init];
+    editor.commandMetrics = metrics;
+    NSDictionary *attributes = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]};
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"four five six\n" attributes:attributes];
+    [editor.layoutManager replaceTextStorage:textStorage];
+    editor.selectedRange = NSMakeRange(0, 4);
+    [editor userSelectedBold];
+    [self spinRunLoop];
+    NSDictionary *bold = [metrics snapshot][@"commands"][@"bold"];
+    XCTAssertEqualObjects(bold[@"count"], @1);
+    XCTAssertGreaterThanOrEqual([bold[@"charactersTouched"] unsignedIntegerValue], (NSUInteger)4);
+}
+
+- (void)testEditorWithoutMetricsRecordsNothing {
+    RichTextEditor *editor = [self editorWithText:@"one two three\n"];
+    RichTextEditorCommandMetrics *metrics = [[RichTextEditorCommandMetrics alloc] init];
+    editor.commandMetrics = metrics;
+    editor.commandMetrics = nil;
+    editor.selectedRange = NSMakeRange(0, 3);
+    [editor userSelectedBold];
+    [self spinRunLoop];
+    XCTAssertEqual([metrics countForType:RichTextEditorPreviewChangeBold], (NSUInteger)0);
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceRecord {
+    RichTextEditorCommandMetrics *metrics = [[RichTextEditorCommandMetrics alloc] init];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 1000000; i++) {
+            [metrics recordCommandOfType:(RichTextEditorPreviewChange)(i % 19) duration:(i % 5000) / 1000000.0 charactersTouched:i % 7 attributeRunsTouched:1];
+        }
+    }];
+}
+
+@end
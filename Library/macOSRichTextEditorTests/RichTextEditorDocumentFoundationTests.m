@@ -0,0 +1,246 @@
+//
+//  RichTextEditorDocumentFoundationTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFoundationTesting.h"
+
+// Only uses what the Foundation-only build has, so these also run there (make check with the
+// GNUmakefile)
+@interface RichTextEditorDocumentFoundationTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorDocumentFoundationTests
+
++ (NSAttributedString *)noteWithParagraphCount:(NSUInteger)paragraphCount {
+    NSMutableString *text = [NSMutableString string];
+    for (NSUInteger i = 0; i < paragraphCount; i++) {
+        [text appendFormat:(i == 0 ? @"item %lu" : @"\nitem %lu"), (unsigned long)i];
+    }
+    return [[NSAttributedString alloc] initWithString:text];
+}
+
+- (void)testToggleBullets {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentFoundationTests noteWithParagraphCount:3]];
+    NSString *bullet = document.bulletString;
+    document.selectedRange = NSMakeRange(0, document.textStorage.length);
+    [document toggleBullets];
+    XCTAssertEqualObjects(document.textStorage.string, ([NSString stringWithFormat:@"%@item 0\n%@item 1\n%@item 2", bullet, bullet, bullet]));
+    XCTAssertEqual(document.selectedRange.length, document.textStorage.length);
+    NSParagraphStyle *paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.firstLineHeadIndent, document.defaultIndentationSize);
+    XCTAssertGreaterThan(paragraphStyle.headIndent, paragraphStyle.firstLineHeadIndent);
+    XCTAssertTrue([document hasBulletAtLocation:0]);
+    XCTAssertEqualObjects([document.paragraphIndex listMarkerOfParagraphAtIndex:2], bullet);
+
+    [document toggleBullets];
+    XCTAssertEqualObjects(document.textStorage.string, @"item 0\nitem 1\nitem 2");
+    paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.headIndent, 0);
+    XCTAssertEqual(paragraphStyle.firstLineHeadIndent, 0);
+    XCTAssertNil([document.paragraphIndex listMarkerOfParagraphAtIndex:2]);
+}
+
+- (void)testBulletInEmptyDocumentMovesSelectionAfterBullet {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] init];
+    [document toggleBullets];
+    XCTAssertEqualObjects(document.textStorage.string, document.bulletString);
+    XCTAssertEqual(document.selectedRange.location, document.bulletString.length);
+}
+
+- (void)testIndentationStopsAtMaximum {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentFoundationTests noteWithParagraphCount:1]];
+    document.defaultIndentationSize = 10;
+    document.maximumIndentation = 30;
+    for (NSUInteger i = 0; i < 10; i++) {
+        [document increaseIndentation];
+    }
+    NSParagraphStyle *paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.headIndent, 30);
+    for (NSUInteger i = 0; i < 10; i++) {
+        [document decreaseIndentation];
+    }
+    paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.headIndent, 0);
+}
+
+- (void)testAlignmentAndFirstLineHeadIndent {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentFoundationTests noteWithParagraphCount:2]];
+    document.selectedRange = NSMakeRange(8, 0); // second paragraph
+    [document setTextAlignment:NSTextAlignmentCenter];
+    NSParagraphStyle *paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:8 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.alignment, NSTextAlignmentCenter);
+    XCTAssertEqual(((NSParagraphStyle *)document.typingAttributes[NSParagraphStyleAttributeName]).alignment, NSTextAlignmentCenter);
+    XCTAssertNil([document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL]);
+    [document toggleFirstLineHeadIndent];
+    paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:8 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.firstLineHeadIndent, document.defaultIndentationSize);
+    XCTAssertEqual(paragraphStyle.alignment, NSTextAlignmentCenter);
+}
+
+- (void)testNormalizedBulletsMatchToggledBullets {
+    RichTextEditorDocument *toggled = [[RichTextEditorDocument alloc] initWithAttributedString:[[NSAttributedString alloc] initWithString:@"one\ntwo"]];
+    toggled.selectedRange = NSMakeRange(0, toggled.textStorage.length);
+    [toggled toggleBullets];
+
+    RichTextEditorDocument *normalized = [[RichTextEditorDocument alloc] initWithAttributedString:[[NSAttributedString alloc] initWithString:@"- one\n\u2022 two"]];
+    XCTAssertEqual([normalized normalizeBulletsWithListMarkers:[RichTextEditorDocument commonListMarkers]], (NSUInteger)2);
+    XCTAssertTrue([normalized.textStorage isEqualToAttributedString:toggled.textStorage]);
+    // Already normalized
+    XCTAssertEqual([normalized normalizeBulletsWithListMarkers:[RichTextEditorDocument commonListMarkers]], (NSUInteger)0);
+}
+
+- (void)testNormalizeIndentationAndRemoveColors {
+    NSMutableParagraphStyle *paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+    paragraphStyle.firstLineHeadIndent = 37;
+    paragraphStyle.headIndent = 1000;
+    NSDictionary *attributes = @{NSParagraphStyleAttributeName: paragraphStyle,
+                                 NSBackgroundColorAttributeName: [NSColor colorWithCalibratedRed:1 green:1 blue:0 alpha:1]};
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:
+                                        [[NSAttributedString alloc] initWithString:@"indented" attributes:attributes]];
+    document.defaultIndentationSize = 10;
+    document.maximumIndentation = 95;
+    XCTAssertEqual([document normalizeIndentation], (NSUInteger)1);
+    NSParagraphStyle *normalizedStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(normalizedStyle.firstLineHeadIndent, 40);
+    XCTAssertEqual(normalizedStyle.headIndent, 100);
+    XCTAssertEqual([document normalizeIndentation], (NSUInteger)0);
+
+    [document removeColors];
+    XCTAssertNil([document.textStorage attribute:NSBackgroundColorAttributeName atIndex:0 effectiveRange:NULL]);
+    XCTAssertNil(document.typingAttributes[NSBackgroundColorAttributeName]);
+}
+
+- (void)testParagraphIndexFollowsTextStorageEdits {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[[NSAttributedString alloc] initWithString:@"one\ntwo"]];
+    XCTAssertEqual(document.paragraphIndex.paragraphCount, (NSUInteger)2);
+    [document.textStorage beginEditing];
+    [document.textStorage replaceCharactersInRange:NSMakeRange(7, 0) withString:@"\nthree"];
+    XCTAssertFalse([document.paragraphIndex isInSync]);
+    [document.textStorage endEditing];
+    XCTAssertTrue([document.paragraphIndex isInSync]);
+    XCTAssertEqual(document.paragraphIndex.paragraphCount, (NSUInteger)3);
+    // Same length, one paragraph fewer
+    [document.textStorage replaceCharactersInRange:NSMakeRange(3, 1) withString:@" "];
+    XCTAssertEqual(document.paragraphIndex.paragraphCount, (NSUInteger)2);
+    XCTAssertEqual([document.paragraphIndex rangeOfParagraphAtIndex:1].location, (NSUInteger)8);
+}
+
+- (void)testFontSizeStaysWithinLimits {
+    NSDictionary *attributes = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]};
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:
+                                        [[NSAttributedString alloc] initWithString:@"one two" attributes:attributes]];
+    document.selectedRange = NSMakeRange(0, document.textStorage.length);
+    [document increaseFontSize];
+    NSFont *font = [document.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(font.pointSize, 18);
+    XCTAssertEqualObjects(font.familyName, @"Helvetica");
+    // 6 points is below minFontSize
+    [document decreaseFontSize];
+    [document decreaseFontSize];
+    font = [document.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(font.pointSize, 12);
+
+    [document setFontSize:30];
+    font = [document.textStorage attribute:NSFontAttributeName atIndex:4 effectiveRange:NULL];
+    XCTAssertEqual(font.pointSize, 30);
+    XCTAssertEqual(((NSFont *)document.typingAttributes[NSFontAttributeName]).pointSize, 30);
+}
+
+- (void)testBoldAndColorsOfSelection {
+    NSDictionary *attributes = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]};
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:
+                                        [[NSAttributedString alloc] initWithString:@"one two" attributes:attributes]];
+    NSColor *red = [NSColor colorWithCalibratedRed:1 green:0 blue:0 alpha:1];
+    document.selectedRange = NSMakeRange(0, 3);
+    [document applyFontWithBoldTrait:@YES italicTrait:nil fontName:nil fontSize:nil];
+    [document setTextColor:red];
+    NSFont *font = [document.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertTrue([font isBold]);
+    XCTAssertFalse([font isItalic]);
+    XCTAssertEqual(font.pointSize, 12);
+    XCTAssertEqualObjects([document.textStorage attribute:NSForegroundColorAttributeName atIndex:0 effectiveRange:NULL], red);
+    font = [document.textStorage attribute:NSFontAttributeName atIndex:4 effectiveRange:NULL];
+    XCTAssertFalse([font isBold]);
+    XCTAssertNil([document.textStorage attribute:NSForegroundColorAttributeName atIndex:4 effectiveRange:NULL]);
+
+    // Nothing selected: only the typing attributes change
+    document.selectedRange = NSMakeRange(7, 0);
+    [document setTextBackgroundColor:red];
+    XCTAssertEqualObjects(document.typingAttributes[NSBackgroundColorAttributeName], red);
+    XCTAssertNil([document.textStorage attribute:NSBackgroundColorAttributeName atIndex:6 effectiveRange:NULL]);
+}
+
+- (void)testHTMLRoundTrip {
+    NSMutableParagraphStyle *centered = [[NSMutableParagraphStyle alloc] init];
+    centered.alignment = NSTextAlignmentCenter;
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:14];
+    NSColor *red = [NSColor colorWithCalibratedRed:1 green:0 blue:0 alpha:1];
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] initWithString:@"bold & red\nplain"
+                                                                               attributes:@{NSFontAttributeName: font}];
+    [string addAttributes:@{NSFontAttributeName: [font fontWithBoldTrait:YES andItalicTrait:NO], NSForegroundColorAttributeName: red,
+                            NSParagraphStyleAttributeName: centered} range:NSMakeRange(0, 11)];
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:string];
+    NSString *html = [document htmlString];
+    XCTAssertEqualObjects(html, [document.textStorage htmlString]);
+    XCTAssertTrue([html rangeOfString:@"<b>"].location != NSNotFound);
+    XCTAssertTrue([html rangeOfString:@"bold &amp; red"].location != NSNotFound);
+
+    RichTextEditorDocument *read = [[RichTextEditorDocument alloc] initWithHTMLString:html];
+    XCTAssertEqualObjects(read.textStorage.string, string.string);
+    NSDictionary *attributes = [read.textStorage attributesAtIndex:0 effectiveRange:NULL];
+    NSFont *readFont = attributes[NSFontAttributeName];
+    XCTAssertTrue([readFont isBold]);
+    XCTAssertEqual(readFont.pointSize, 14);
+    XCTAssertEqualObjects(readFont.familyName, @"Helvetica");
+    XCTAssertEqualObjects(attributes[NSForegroundColorAttributeName], red);
+    XCTAssertEqual(((NSParagraphStyle *)attributes[NSParagraphStyleAttributeName]).alignment, NSTextAlignmentCenter);
+    XCTAssertFalse([[read.textStorage attribute:NSFontAttributeName atIndex:11 effectiveRange:NULL] isBold]);
+    XCTAssertEqualObjects([read htmlString], html);
+}
+
+- (void)testStringWidthMeasurement {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentFoundationTests noteWithParagraphCount:1]];
+    document.defaultIndentationSize = 20;
+    document.stringWidthMeasurement = ^CGFloat(NSString *string, NSDictionary *attributes) {
+        return string.length * 5;
+    };
+    [document toggleBullets];
+    NSParagraphStyle *bulletStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(bulletStyle.firstLineHeadIndent, 20);
+    XCTAssertEqual(bulletStyle.headIndent, 20 + document.bulletString.length * (CGFloat)5);
+}
+
+#if defined(RTE_FOUNDATION_ONLY) && RTE_FOUNDATION_ONLY
+- (void)testIndentationWithoutFonts {
+    NSMutableParagraphStyle *paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+    paragraphStyle.defaultTabInterval = 100;
+    XCTAssertEqual([RichTextEditorDocument indentationSizeForAttributes:@{}], RTE_FOUNDATION_ONLY_TAB_INTERVAL);
+    XCTAssertEqual([RichTextEditorDocument indentationSizeForAttributes:@{NSParagraphStyleAttributeName: paragraphStyle}], 100);
+
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentFoundationTests noteWithParagraphCount:1]];
+    [document toggleBullets];
+    NSParagraphStyle *bulletStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(bulletStyle.firstLineHeadIndent, RTE_FOUNDATION_ONLY_TAB_INTERVAL);
+    XCTAssertEqual(bulletStyle.headIndent, RTE_FOUNDATION_ONLY_TAB_INTERVAL + document.bulletString.length * RTE_FOUNDATION_ONLY_CHARACTER_WIDTH);
+}
+#endif
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceNormalizeBullets {
+    NSMutableString *text = [NSMutableString string];
+    for (NSUInteger i = 0; i < 10000; i++) {
+        [text appendFormat:(i % 2 == 0 ? @"- item %lu\n" : @"note %lu\n"), (unsigned long)i];
+    }
+    NSAttributedString *note = [[NSAttributedString alloc] initWithString:text];
+    [self measureBlock:^{
+        RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:note];
+        XCTAssertEqual([document normalizeBulletsWithListMarkers:[RichTextEditorDocument commonListMarkers]], (NSUInteger)5000);
+    }];
+}
+
+@end
@@ -0,0 +1,194 @@
+//
+//  RichTextEditorDocumentTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorDocumentTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorDocumentTests
+
++ (NSAttributedString *)noteWithParagraphCount:(NSUInteger)paragraphCount {
+    NSMutableString *text = [NSMutableString string];
+    for (NSUInteger i = 0; i < paragraphCount; i++) {
+        [text appendFormat:(i == 0 ? @"item %lu" : @"\nitem %lu"), (unsigned long)i];
+    }
+    return [[NSAttributedString alloc] initWithString:text attributes:@{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:14]}];
+}
+
+- (void)testToggleBullets {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentTests noteWithParagraphCount:3]];
+    NSString *bullet = document.bulletString;
+    document.selectedRange = NSMakeRange(0, document.textStorage.length);
+    [document toggleBullets];
+    XCTAssertEqualObjects(document.textStorage.string, ([NSString stringWithFormat:@"%@item 0\n%@item 1\n%@item 2", bullet, bullet, bullet]));
+    XCTAssertEqual(document.selectedRange.length, document.textStorage.length);
+    NSParagraphStyle *paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.firstLineHeadIndent, document.defaultIndentationSize);
+    XCTAssertGreaterThan(paragraphStyle.headIndent, paragraphStyle.firstLineHeadIndent);
+    XCTAssertTrue([document hasBulletAtLocation:0]);
+
+    [document toggleBullets];
+    XCTAssertEqualObjects(document.textStorage.string, @"item 0\nitem 1\nitem 2");
+    paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.headIndent, 0);
+    XCTAssertEqual(paragraphStyle.firstLineHeadIndent, 0);
+}
+
+- (void)testBulletInEmptyDocumentMovesSelectionAfterBullet {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] init];
+    [document toggleBullets];
+    XCTAssertEqualObjects(document.textStorage.string, document.bulletString);
+    XCTAssertEqual(document.selectedRange.location, document.bulletString.length);
+}
+
+- (void)testIndentationStopsAtMaximum {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentTests noteWithParagraphCount:1]];
+    document.defaultIndentationSize = 10;
+    document.maximumIndentation = 30;
+    for (NSUInteger i = 0; i < 10; i++) {
+        [document increaseIndentation];
+    }
+    NSParagraphStyle *paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.headIndent, 30);
+    for (NSUInteger i = 0; i < 10; i++) {
+        [document decreaseIndentation];
+    }
+    paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.headIndent, 0);
+}
+
+- (void)testAlignmentAndFirstLineHeadIndent {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentTests noteWithParagraphCount:2]];
+    document.selectedRange = NSMakeRange(8, 0); // second paragraph
+    [document setTextAlignment:NSTextAlignmentCenter];
+    XCTAssertEqual(((NSParagraphStyle *)[document.textStorage attribute:NSParagraphStyleAttributeName atIndex:8 effectiveRange:NULL]).alignment, NSTextAlignmentCenter);
+    XCTAssertNil([document.textStorage attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL]);
+    [document toggleFirstLineHeadIndent];
+    NSParagraphStyle *paragraphStyle = [document.textStorage attribute:NSParagraphStyleAttributeName atIndex:8 effectiveRange:NULL];
+    XCTAssertEqual(paragraphStyle.firstLineHeadIndent, document.defaultIndentationSize);
+    XCTAssertEqual(paragraphStyle.alignment, NSTextAlignmentCenter);
+}
+
+- (void)testFontSizeAndColor {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentTests noteWithParagraphCount:1]];
+    document.selectedRange = NSMakeRange(0, 4);
+    [document increaseFontSize];
+    XCTAssertEqual([[document.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL] pointSize], 14 + document.fontSizeChangeAmount);
+    XCTAssertEqual([[document.textStorage attribute:NSFontAttributeName atIndex:5 effectiveRange:NULL] pointSize], 14);
+    document.maxFontSize = 24;
+    [document increaseFontSize]; // past the limit, so nothing changes
+    XCTAssertEqual([[document.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL] pointSize], 20);
+    [document setFontSize:12];
+    XCTAssertEqual([[document.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL] pointSize], 12);
+    [document applyFontWithBoldTrait:@YES italicTrait:nil fontName:nil fontSize:nil];
+    XCTAssertTrue([[document.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL] isBold]);
+
+    [document setTextColor:[NSColor redColor]];
+    XCTAssertEqualObjects([document.textStorage attribute:NSForegroundColorAttributeName atIndex:0 effectiveRange:NULL], [NSColor redColor]);
+    XCTAssertNil([document.textStorage attribute:NSForegroundColorAttributeName atIndex:5 effectiveRange:NULL]);
+    [document setTextColor:nil];
+    XCTAssertNil([document.textStorage attribute:NSForegroundColorAttributeName atIndex:0 effectiveRange:NULL]);
+
+    // Nothing selected: only the typing attributes change
+    document.selectedRange = NSMakeRange(2, 0);
+    [document setTextBackgroundColor:[NSColor yellowColor]];
+    XCTAssertEqualObjects(document.typingAttributes[NSBackgroundColorAttributeName], [NSColor yellowColor]);
+    XCTAssertNil([document.textStorage attribute:NSBackgroundColorAttributeName atIndex:2 effectiveRange:NULL]);
+}
+
+- (void)testHTMLRoundTrip {
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:[RichTextEditorDocumentTests noteWithParagraphCount:2]];
+    NSString *html = [document htmlString];
+    XCTAssertTrue([html containsString:@"item 1"]);
+    RichTextEditorDocument *copy = [[RichTextEditorDocument alloc] initWithHTMLString:html];
+    XCTAssertEqualObjects(copy.textStorage.string, document.textStorage.string);
+}
+
+// The editor plans its commands with a document, so both give the same text
+- (void)testSameResultAsEditor {
+    NSAttributedString *note = [RichTextEditorDocumentTests noteWithParagraphCount:5];
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:note];
+    RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:editor.attributedString];
+    document.defaultIndentationSize = editor.defaultIndentationSize;
+    document.maximumIndentation = editor.defaultIndentationSize * 10;
+
+    editor.selectedRange = NSMakeRange(0, editor.string.length);
+    document.selectedRange = editor.selectedRange;
+    [editor userSelectedBullet];
+    [document toggleBullets];
+    XCTAssertTrue([document.textStorage isEqualToAttributedString:editor.attributedString]);
+
+    editor.selectedRange = NSMakeRange(0, editor.string.length);
+    document.selectedRange = editor.selectedRange;
+    [editor userSelectedIncreaseIndent];
+    [document increaseIndentation];
+    XCTAssertTrue([document.textStorage isEqualToAttributedString:editor.attributedString]);
+
+    editor.selectedRange = NSMakeRange(0, editor.string.length);
+    document.selectedRange = editor.selectedRange;
+    [editor userSelectedBullet];
+    [document toggleBullets];
+    XCTAssertTrue([document.textStorage isEqualToAttributedString:editor.attributedString]);
+}
+
+- (void)testDocumentsOnSeparateQueues {
+    NSAttributedString *note = [RichTextEditorDocumentTests noteWithParagraphCount:50];
+    NSUInteger count = 16;
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSUInteger i = 0; i < count; i++) {
+        [results addObject:[NSNull null]];
+    }
+    dispatch_apply(count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:note];
+        document.selectedRange = NSMakeRange(0, document.textStorage.length);
+        [document toggleBullets];
+        [document increaseIndentation];
+        NSString *html = [document htmlString];
+        @synchronized (results) {
+            results[i] = html;
+        }
+    });
+    for (NSUInteger i = 1; i < count; i++) {
+        XCTAssertEqualObjects(results[i], results[0]);
+    }
+}
+
+#pragma mark - Benchmarks
+
+// Normalizing many stored notes: bullets, one indentation step, HTML out, without any views
+- (void)testPerformanceBatchProcessWithDocuments {
+    NSAttributedString *note = [RichTextEditorDocumentTests noteWithParagraphCount:20];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 500; i++) {
+            RichTextEditorDocument *document = [[RichTextEditorDocument alloc] initWithAttributedString:note];
+            document.selectedRange = NSMakeRange(0, document.textStorage.length);
+            [document toggleBullets];
+            [document increaseIndentation];
+            XCTAssertNotNil([document htmlString]);
+        }
+    }];
+}
+
+// The same work through an editor per note
+- (void)testPerformanceBatchProcessWithEditors {
+    NSAttributedString *note = [RichTextEditorDocumentTests noteWithParagraphCount:20];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 500; i++) {
+            RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:note];
+            editor.selectedRange = NSMakeRange(0, editor.string.length);
+            [editor userSelectedBullet];
+            [editor userSelectedIncreaseIndent];
+            XCTAssertNotNil([editor htmlString]);
+        }
+    }];
+}
+
+@end
@@ -0,0 +1,217 @@
+//
+//  RichTextEditorEditStreamTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorEditStreamTests : XCTestCase
+
+@property NSMutableArray<NSArray<RichTextEditorEditRecord *> *> *batches;
+@property NSMutableArray *events;
+
+@end
+
+@implementation RichTextEditorEditStreamTests
+
+- (void)setUp {
+    [super setUp];
+    self.batches = [NSMutableArray array];
+    self.events = [NSMutableArray array];
+}
+
+- (void)textDidChange:(NSNotification *)notification {
+    [self.events addObject:@"textDidChange"];
+}
+
+- (RichTextEditorEditStream *)streamForTextStorage:(NSTextStorage *)textStorage {
+    RichTextEditorEditStream *stream = [[RichTextEditorEditStream alloc] initWithTextStorage:textStorage];
+    stream.handler = ^(NSArray<RichTextEditorEditRecord *> *records) {
+        [self.batches addObject:records];
+        [self.events addObject:@"records"];
+    };
+    return stream;
+}
+
++ (void)applyRecords:(NSArray<RichTextEditorEditRecord *> *)records toMirror:(NSMutableAttributedString *)mirror {
+    for (RichTextEditorEditRecord *record in records) {
+        [mirror replaceCharactersInRange:record.range withAttributedString:record.replacementText];
+    }
+}
+
+- (void)testRecords {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"hello world"];
+    RichTextEditorEditStream *stream = [self streamForTextStorage:textStorage];
+    [textStorage replaceCharactersInRange:NSMakeRange(6, 5) withString:@"there"];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, 6) withString:@""];
+    [textStorage addAttribute:NSForegroundColorAttributeName value:[NSColor redColor] range:NSMakeRange(1, 2)];
+    XCTAssertEqual(self.batches.count, (NSUInteger)3);
+
+    RichTextEditorEditRecord *replace = self.batches[0].firstObject;
+    XCTAssertTrue(NSEqualRanges(replace.range, NSMakeRange(6, 5)));
+    XCTAssertEqual(replace.replacementLength, (NSUInteger)5);
+    XCTAssertEqualObjects(replace.replacementText.string, @"there");
+    XCTAssertTrue(replace.charactersChanged);
+
+    RichTextEditorEditRecord *delete = self.batches[1].firstObject;
+    XCTAssertTrue(NSEqualRanges(delete.range, NSMakeRange(0, 6)));
+    XCTAssertEqual(delete.changeInLength, -6);
+    XCTAssertEqualObjects(delete.replacementText.string, @"");
+
+    RichTextEditorEditRecord *attributes = self.batches[2].firstObject;
+    XCTAssertTrue(NSEqualRanges(attributes.range, NSMakeRange(1, 2)));
+    XCTAssertFalse(attributes.charactersChanged);
+    XCTAssertTrue(attributes.attributesChanged);
+    XCTAssertEqualObjects([attributes.replacementText attribute:NSForegroundColorAttributeName atIndex:0 effectiveRange:NULL], [NSColor redColor]);
+    stream.handler = nil;
+}
+
+- (void)testBatchesReplayInOrder {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithAttributedString:[RichTextEditorBenchmarkSupport documentWithParagraphCount:50 maximumListDepth:2]];
+    NSMutableAttributedString *mirror = [textStorage mutableCopy];
+    RichTextEditorEditStream *stream = [self streamForTextStorage:textStorage];
+    srandom(17);
+    [stream beginBatch];
+    for (NSUInteger i = 0; i < 200; i++) {
+        if (i == 100) {
+            [stream beginBatch]; // nested batches are part of the outer one
+        }
+        NSUInteger location = (NSUInteger)random() % (textStorage.length + 1);
+        NSUInteger length = MIN((NSUInteger)random() % 8, textStorage.length - location);
+        switch (random() % 3) {
+            case 0:
+                [textStorage replaceCharactersInRange:NSMakeRange(location, length) withString:(i % 2 ? @"ab\n" : @"")];
+                break;
+            case 1:
+                [textStorage addAttribute:NSUnderlineStyleAttributeName value:@(NSUnderlineStyleSingle) range:NSMakeRange(location, length)];
+                break;
+            default:
+                [textStorage replaceCharactersInRange:NSMakeRange(location, length)
+                                 withAttributedString:[[NSAttributedString alloc] initWithString:@"xyz" attributes:@{NSForegroundColorAttributeName: [NSColor blueColor]}]];
+                break;
+        }
+        XCTAssertEqual(self.batches.count, (NSUInteger)0);
+    }
+    [stream endBatch];
+    XCTAssertTrue(stream.isBatching);
+    [stream endBatch];
+    XCTAssertFalse(stream.isBatching);
+    XCTAssertEqual(self.batches.count, (NSUInteger)1);
+    [RichTextEditorEditStreamTests applyRecords:self.batches[0] toMirror:mirror];
+    XCTAssertTrue([mirror isEqualToAttributedString:textStorage]);
+    stream.handler = nil;
+}
+
+- (void)testWithoutReplacementText {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"hello"];
+    RichTextEditorEditStream *stream = [self streamForTextStorage:textStorage];
+    stream.includesReplacementText = NO;
+    [textStorage replaceCharactersInRange:NSMakeRange(5, 0) withString:@" world"];
+    XCTAssertNil(self.batches[0].firstObject.replacementText);
+    XCTAssertEqual(self.batches[0].firstObject.replacementLength, (NSUInteger)6);
+    stream.handler = nil;
+}
+
+#pragma mark - Editor
+
+- (RichTextEditor *)editorWithString:(NSString *)string mirror:(NSMutableAttributedString **)mirror {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:string attributes:@{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]}]];
+    *mirror = [editor.textStorage mutableCopy];
+    editor.editStream.handler = ^(NSArray<RichTextEditorEditRecord *> *records) {
+        [self.batches addObject:records];
+        [self.events addObject:@"records"];
+    };
+    editor.delegate = (id<NSTextViewDelegate>)self;
+    return editor;
+}
+
+- (void)testTypingAndBulletIsOneBatchBeforeTextDidChange {
+    NSMutableAttributedString *mirror = nil;
+    RichTextEditor *editor = [self editorWithString:@"" mirror:&mirror];
+    NSString *bullet = editor.bulletString;
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:[NSString stringWithFormat:@"%@item", bullet]]];
+    mirror = [editor.textStorage mutableCopy];
+    [self.batches removeAllObjects];
+    [self.events removeAllObjects];
+
+    editor.selectedRange = NSMakeRange(editor.string.length, 0);
+    [editor insertText:@"\n" replacementRange:editor.selectedRange];
+    XCTAssertEqualObjects(editor.string, ([NSString stringWithFormat:@"%@item\n%@", bullet, bullet]));
+    XCTAssertEqual(self.batches.count, (NSUInteger)1);
+    XCTAssertGreaterThanOrEqual(self.batches[0].count, (NSUInteger)2); // the newline and the new bullet
+    XCTAssertEqualObjects(self.events, (@[@"records", @"textDidChange"]));
+    [RichTextEditorEditStreamTests applyRecords:self.batches[0] toMirror:mirror];
+    XCTAssertTrue([mirror isEqualToAttributedString:editor.textStorage]);
+    editor.delegate = nil;
+}
+
+- (void)testCommandIsOneBatch {
+    NSMutableAttributedString *mirror = nil;
+    RichTextEditor *editor = [self editorWithString:@"one\ntwo\nthree" mirror:&mirror];
+    editor.selectedRange = NSMakeRange(0, editor.string.length);
+    [editor userSelectedBullet];
+    XCTAssertEqual(self.batches.count, (NSUInteger)1);
+    XCTAssertGreaterThanOrEqual(self.batches[0].count, (NSUInteger)1);
+    [RichTextEditorEditStreamTests applyRecords:self.batches[0] toMirror:mirror];
+    XCTAssertTrue([mirror isEqualToAttributedString:editor.textStorage]);
+
+    editor.selectedRange = NSMakeRange(0, 3);
+    [editor userSelectedBold];
+    XCTAssertEqual(self.batches.count, (NSUInteger)2);
+    XCTAssertFalse(self.batches[1].firstObject.charactersChanged);
+    [RichTextEditorEditStreamTests applyRecords:self.batches[1] toMirror:mirror];
+    XCTAssertTrue([mirror isEqualToAttributedString:editor.textStorage]);
+    editor.delegate = nil;
+}
+
+- (void)testUndoIsOneBatch {
+    NSMutableAttributedString *mirror = nil;
+    RichTextEditor *editor = [self editorWithString:@"one\ntwo" mirror:&mirror];
+    editor.usesUndoJournal = YES;
+    editor.selectedRange = NSMakeRange(0, editor.string.length);
+    [editor userSelectedBullet];
+    [editor undo];
+    XCTAssertEqual(self.batches.count, (NSUInteger)2);
+    for (NSArray *records in self.batches) {
+        [RichTextEditorEditStreamTests applyRecords:records toMirror:mirror];
+    }
+    XCTAssertTrue([mirror isEqualToAttributedString:editor.textStorage]);
+    editor.delegate = nil;
+}
+
+#pragma mark - Benchmarks
+
+// Keeping a copy of a large document in step while typing, compared with re-exporting it on every change
+- (void)testPerformanceMirrorFromEditStream {
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[RichTextEditorBenchmarkSupport documentWithParagraphCount:10000 maximumListDepth:4]];
+    NSMutableAttributedString *mirror = [editor.textStorage mutableCopy];
+    editor.editStream.handler = ^(NSArray<RichTextEditorEditRecord *> *records) {
+        [RichTextEditorEditStreamTests applyRecords:records toMirror:mirror];
+    };
+    [self measureBlock:^{
+        editor.selectedRange = NSMakeRange(editor.string.length / 2, 0);
+        for (NSUInteger i = 0; i < 100; i++) {
+            [editor insertText:@"a" replacementRange:editor.selectedRange];
+        }
+    }];
+    XCTAssertTrue([mirror isEqualToAttributedString:editor.textStorage]);
+    editor.editStream.handler = nil;
+}
+
+- (void)testPerformanceMirrorFromHTMLExport {
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[RichTextEditorBenchmarkSupport documentWithParagraphCount:10000 maximumListDepth:4]];
+    [self measureBlock:^{
+        editor.selectedRange = NSMakeRange(editor.string.length / 2, 0);
+        for (NSUInteger i = 0; i < 100; i++) {
+            [editor insertText:@"a" replacementRange:editor.selectedRange];
+            XCTAssertNotNil([editor htmlString]);
+        }
+    }];
+}
+
+@end
@@ -0,0 +1,316 @@
+//
+//  RichTextEditorFindReplaceTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorFindReplaceTests : XCTestCase
+
+@property NSUInteger textDidChangeCount;
+
+@end
+
+@implementation RichTextEditorFindReplaceTests
+
+- (void)textDidChange:(NSNotification *)notification {
+    self.textDidChangeCount++;
+}
+
+- (RichTextEditorFindReplace *)findReplaceWithPattern:(NSString *)pattern options:(RichTextEditorFindOptions)options {
+    NSError *error = nil;
+    RichTextEditorFindReplace *findReplace = [[RichTextEditorFindReplace alloc] initWithPattern:pattern options:options error:&error];
+    XCTAssertNotNil(findReplace);
+    XCTAssertNil(error);
+    return findReplace;
+}
+
+- (NSArray *)rangesOf:(NSString *)pattern options:(RichTextEditorFindOptions)options inString:(NSString *)string {
+    NSAttributedString *attributedString = [[NSAttributedString alloc] initWithString:string];
+    return [[self findReplaceWithPattern:pattern options:options] rangesOfMatchesInString:attributedString range:NSMakeRange(0, string.length)];
+}
+
+// A paragraph (with its newline) of 'cat dog ' pairs in which every other pair is bold
++ (NSAttributedString *)documentWithMatchCount:(NSUInteger)matchCount {
+    NSDictionary *plain = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]};
+    NSDictionary *bold = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica-Bold" size:12]};
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] init];
+    [document beginEditing];
+    for (NSUInteger i = 0; i < matchCount; i++) {
+        [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"cat dog " attributes:(i % 2 ? bold : plain)]];
+        if (i % 10 == 9) {
+            [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"\n" attributes:plain]];
+        }
+    }
+    [document endEditing];
+    return document;
+}
+
+- (void)testLiteralMatching {
+    NSArray *expected = @[[NSValue valueWithRange:NSMakeRange(0, 3)], [NSValue valueWithRange:NSMakeRange(8, 3)]];
+    XCTAssertEqualObjects([self rangesOf:@"cat" options:RichTextEditorFindOptionsNone inString:@"cat Cat cat"], expected);
+    XCTAssertEqual([self rangesOf:@"cat" options:RichTextEditorFindOptionsCaseInsensitive inString:@"cat Cat cat"].count, (NSUInteger)3);
+    XCTAssertEqual([self rangesOf:@"aa" options:RichTextEditorFindOptionsNone inString:@"aaaa"].count, (NSUInteger)2);
+    XCTAssertEqual([self rangesOf:@"" options:RichTextEditorFindOptionsNone inString:@"aaaa"].count, (NSUInteger)0);
+}
+
+- (void)testWholeWordMatching {
+    NSString *string = @"cat concat cats cat_ cat. (cat)";
+    NSArray *expected = @[[NSValue valueWithRange:NSMakeRange(0, 3)], [NSValue valueWithRange:NSMakeRange(21, 3)], [NSValue valueWithRange:NSMakeRange(27, 3)]];
+    XCTAssertEqualObjects([self rangesOf:@"cat" options:RichTextEditorFindOptionsWholeWord inString:string], expected);
+    XCTAssertEqualObjects([self rangesOf:@"cat" options:RichTextEditorFindOptionsWholeWord | RichTextEditorFindOptionsRegularExpression inString:string], expected);
+}
+
+- (void)testRegularExpressionMatching {
+    NSArray *ranges = [self rangesOf:@"c[a-z]t" options:RichTextEditorFindOptionsRegularExpression | RichTextEditorFindOptionsCaseInsensitive inString:@"cat COT cut c t"];
+    XCTAssertEqual(ranges.count, (NSUInteger)3);
+    // Empty matches are never reported
+    XCTAssertEqual([self rangesOf:@"x*" options:RichTextEditorFindOptionsRegularExpression inString:@"abc"].count, (NSUInteger)0);
+
+    NSError *error = nil;
+    XCTAssertNil([[RichTextEditorFindReplace alloc] initWithPattern:@"(unclosed" options:RichTextEditorFindOptionsRegularExpression error:&error]);
+    XCTAssertNotNil(error);
+}
+
+- (void)testSearchingPartOfTheTextSeesTheWholeText {
+    NSAttributedString *string = [[NSAttributedString alloc] initWithString:@"abc bc"];
+    RichTextEditorFindReplace *wordStart = [self findReplaceWithPattern:@"\\bbc" options:RichTextEditorFindOptionsRegularExpression];
+    NSArray *ranges = [wordStart rangesOfMatchesInString:string range:NSMakeRange(1, string.length - 1)];
+    XCTAssertEqualObjects(ranges, @[[NSValue valueWithRange:NSMakeRange(4, 2)]]);
+    RichTextEditorFindReplace *wholeWord = [self findReplaceWithPattern:@"bc" options:RichTextEditorFindOptionsWholeWord];
+    XCTAssertEqual([wholeWord rangesOfMatchesInString:string range:NSMakeRange(1, 2)].count, (NSUInteger)0);
+}
+
+- (void)testAttributeFilter {
+    NSAttributedString *document = [RichTextEditorFindReplaceTests documentWithMatchCount:10];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsNone];
+    findReplace.attributeFilter = ^BOOL(NSDictionary *attributes) {
+        return ([attributes[NSFontAttributeName] fontDescriptor].symbolicTraits & NSFontBoldTrait) != 0;
+    };
+    NSArray *ranges = [findReplace rangesOfMatchesInString:document range:NSMakeRange(0, document.length)];
+    XCTAssertEqual(ranges.count, (NSUInteger)5);
+    XCTAssertEqual([ranges[0] rangeValue].location, (NSUInteger)12);
+
+    // A match that is only partly bold doesn't pass
+    RichTextEditorFindReplace *acrossRuns = [self findReplaceWithPattern:@"dog cat" options:RichTextEditorFindOptionsNone];
+    acrossRuns.attributeFilter = findReplace.attributeFilter;
+    XCTAssertEqual([acrossRuns rangesOfMatchesInString:document range:NSMakeRange(0, document.length)].count, (NSUInteger)0);
+}
+
+- (void)testListMarkersAreNeverMatched {
+    NSString *bullet = @"* ";
+    NSAttributedString *string = [[NSAttributedString alloc] initWithString:@"* one\n* two\nthree * four"];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"\\* \\w+" options:RichTextEditorFindOptionsRegularExpression];
+    findReplace.listMarkers = @[bullet];
+    NSArray *expected = @[[NSValue valueWithRange:NSMakeRange(2, 3)], [NSValue valueWithRange:NSMakeRange(8, 3)], [NSValue valueWithRange:NSMakeRange(18, 6)]];
+    XCTAssertEqualObjects([findReplace rangesOfMatchesInString:string range:NSMakeRange(0, string.length)], expected);
+
+    // Matching across paragraphs would delete the next paragraph's marker
+    RichTextEditorFindReplace *acrossParagraphs = [self findReplaceWithPattern:@"one\n* two" options:RichTextEditorFindOptionsNone];
+    acrossParagraphs.listMarkers = @[bullet];
+    XCTAssertEqual([acrossParagraphs rangesOfMatchesInString:string range:NSMakeRange(0, string.length)].count, (NSUInteger)0);
+}
+
+- (void)testReplaceKeepsAttributes {
+    NSMutableAttributedString *textStorage = [[RichTextEditorFindReplaceTests documentWithMatchCount:4] mutableCopy];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsNone];
+    NSRange replacedRange;
+    NSUInteger count = [findReplace replaceMatchesInTextStorage:textStorage range:NSMakeRange(0, textStorage.length) withTemplate:@"horse" replacedRange:&replacedRange];
+    XCTAssertEqual(count, (NSUInteger)4);
+    XCTAssertEqualObjects(textStorage.string, @"cat horse cat horse cat horse cat horse ");
+    XCTAssertTrue(NSEqualRanges(replacedRange, NSMakeRange(4, 35)));
+    NSFont *plainFont = [textStorage attribute:NSFontAttributeName atIndex:4 effectiveRange:NULL];
+    NSFont *boldFont = [textStorage attribute:NSFontAttributeName atIndex:14 effectiveRange:NULL];
+    XCTAssertEqualObjects(plainFont.fontName, @"Helvetica");
+    XCTAssertEqualObjects(boldFont.fontName, @"Helvetica-Bold");
+
+    NSUInteger none = [findReplace replaceMatchesInTextStorage:textStorage range:NSMakeRange(0, textStorage.length) withTemplate:@"horse" replacedRange:&replacedRange];
+    XCTAssertEqual(none, (NSUInteger)0);
+    XCTAssertEqual(replacedRange.location, (NSUInteger)NSNotFound);
+}
+
+- (void)testRegularExpressionReplacementTemplate {
+    NSMutableAttributedString *textStorage = [[NSMutableAttributedString alloc] initWithString:@"Smith, Jane; Doe, John"];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"(\\w+), (\\w+)" options:RichTextEditorFindOptionsRegularExpression];
+    [findReplace replaceMatchesInTextStorage:textStorage range:NSMakeRange(0, textStorage.length) withTemplate:@"$2 $1" replacedRange:NULL];
+    XCTAssertEqualObjects(textStorage.string, @"Jane Smith; John Doe");
+}
+
+- (void)testReplaceIsOneTextStorageEdit {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithAttributedString:[RichTextEditorFindReplaceTests documentWithMatchCount:100]];
+    __block NSUInteger editCount = 0;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:NSTextStorageDidProcessEditingNotification object:textStorage queue:nil
+                                                                usingBlock:^(NSNotification *notification) {
+        editCount++;
+    }];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"cat" options:RichTextEditorFindOptionsNone];
+    XCTAssertEqual([findReplace replaceMatchesInTextStorage:textStorage range:NSMakeRange(0, textStorage.length) withTemplate:@"" replacedRange:NULL], (NSUInteger)100);
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    XCTAssertEqual(editCount, (NSUInteger)1);
+    XCTAssertFalse([textStorage.string containsString:@"cat"]);
+}
+
+- (void)testBackgroundSearch {
+    NSAttributedString *document = [RichTextEditorFindReplaceTests documentWithMatchCount:2500];
+    NSMutableAttributedString *string = [document mutableCopy];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsNone];
+    findReplace.batchSize = 1000;
+    NSMutableArray *batchSizes = [NSMutableArray array];
+    NSMutableArray *ranges = [NSMutableArray array];
+    XCTestExpectation *done = [self expectationWithDescription:@"searched"];
+    [findReplace findMatchesInBackgroundInString:string batchHandler:^(NSArray<NSValue *> *matchRanges) {
+        XCTAssertTrue([NSThread isMainThread]);
+        [batchSizes addObject:@(matchRanges.count)];
+        [ranges addObjectsFromArray:matchRanges];
+    } completion:^(NSUInteger matchCount, BOOL finished) {
+        XCTAssertTrue(finished);
+        XCTAssertEqual(matchCount, (NSUInteger)2500);
+        [done fulfill];
+    }];
+    // The search works on a snapshot
+    [string deleteCharactersInRange:NSMakeRange(0, string.length)];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertEqualObjects(batchSizes, (@[@1000, @1000, @500]));
+    XCTAssertEqualObjects(ranges, [findReplace rangesOfMatchesInString:document range:NSMakeRange(0, document.length)]);
+}
+
+- (void)testBackgroundSearchCancel {
+    NSAttributedString *document = [RichTextEditorFindReplaceTests documentWithMatchCount:50000];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsNone];
+    __block NSUInteger batchesAfterCancel = 0;
+    __block BOOL cancelled = NO;
+    XCTestExpectation *done = [self expectationWithDescription:@"cancelled"];
+    [findReplace findMatchesInBackgroundInString:document batchHandler:^(NSArray<NSValue *> *matchRanges) {
+        if (cancelled) {
+            batchesAfterCancel++;
+        }
+    } completion:^(NSUInteger matchCount, BOOL finished) {
+        XCTAssertFalse(finished);
+        [done fulfill];
+    }];
+    [findReplace cancelBackgroundSearch];
+    cancelled = YES;
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertEqual(batchesAfterCancel, (NSUInteger)0);
+}
+
+#pragma mark - Editor
+
+- (void)testEditorSelectNextMatchWraps {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:@"cat dog cat"]];
+    editor.selectedRange = NSMakeRange(1, 0);
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"cat" options:RichTextEditorFindOptionsNone];
+    XCTAssertTrue(NSEqualRanges([editor selectNextMatch:findReplace], NSMakeRange(8, 3)));
+    XCTAssertTrue(NSEqualRanges(editor.selectedRange, NSMakeRange(8, 3)));
+    XCTAssertTrue(NSEqualRanges([editor selectNextMatch:findReplace], NSMakeRange(0, 3)));
+    RichTextEditorFindReplace *missing = [self findReplaceWithPattern:@"horse" options:RichTextEditorFindOptionsNone];
+    XCTAssertEqual([editor selectNextMatch:missing].location, (NSUInteger)NSNotFound);
+    XCTAssertTrue(NSEqualRanges(editor.selectedRange, NSMakeRange(0, 3)));
+}
+
+- (void)testEditorReplaceAllSkipsBullets {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    NSString *bullet = editor.bulletString;
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:[NSString stringWithFormat:@"%@one\n%@two", bullet, bullet]]];
+    // Replacing every character but the newline leaves the bullets alone
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"[^\\n]+" options:RichTextEditorFindOptionsRegularExpression];
+    XCTAssertEqual([editor replaceAllMatches:findReplace withTemplate:@"x"], (NSUInteger)2);
+    XCTAssertEqualObjects(editor.string, ([NSString stringWithFormat:@"%@x\n%@x", bullet, bullet]));
+}
+
+- (void)testEditorReplaceAllIsOneChangeAndOneUndoStep {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    editor.usesUndoJournal = YES;
+    [editor changeToAttributedString:[RichTextEditorFindReplaceTests documentWithMatchCount:1000]];
+    NSAttributedString *document = [editor.attributedString copy];
+    [editor.undoJournal removeAllEntries];
+    editor.delegate = (id<NSTextViewDelegate>)self;
+    self.textDidChangeCount = 0;
+
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsNone];
+    XCTAssertEqual([editor replaceAllMatches:findReplace withTemplate:@"horse"], (NSUInteger)1000);
+    XCTAssertEqual(self.textDidChangeCount, (NSUInteger)1);
+    XCTAssertTrue(editor.undoJournal.canUndo);
+    [editor undo];
+    XCTAssertTrue([editor.attributedString isEqualToAttributedString:document]);
+    XCTAssertFalse(editor.undoJournal.canUndo);
+    [editor redo];
+    XCTAssertFalse([editor.string containsString:@"dog"]);
+    editor.delegate = nil;
+}
+
+- (void)testEditorReplaceAllRecordsOnlyTheMatchedSpan {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    editor.usesUndoJournal = YES;
+    NSString *padding = [@"" stringByPaddingToLength:100000 withString:@"lorem ipsum " startingAtIndex:0];
+    NSString *text = [NSString stringWithFormat:@"%@\ncat dog cat dog\n%@", padding, padding];
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:text
+                                                                    attributes:@{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]}]];
+    NSAttributedString *document = [editor.attributedString copy];
+    [editor.undoJournal removeAllEntries];
+
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsNone];
+    XCTAssertEqual([editor replaceAllMatches:findReplace withTemplate:@"horse"], (NSUInteger)2);
+    XCTAssertLessThan(editor.undoJournal.byteCount, (NSUInteger)10000);
+    [editor undo];
+    XCTAssertTrue([editor.attributedString isEqualToAttributedString:document]);
+}
+
+- (void)testEditorReplaceAllUndoManager {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    NSUndoManager *undoManager = editor.undoManager;
+    if (!undoManager) {
+        return; // no window or delegate to provide one
+    }
+    [editor changeToAttributedString:[RichTextEditorFindReplaceTests documentWithMatchCount:100]];
+    NSAttributedString *document = [editor.attributedString copy];
+    [undoManager removeAllActions];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsNone];
+    [editor replaceAllMatches:findReplace withTemplate:@"horse"];
+    [undoManager undo];
+    XCTAssertTrue([editor.attributedString isEqualToAttributedString:document]);
+    XCTAssertFalse(undoManager.canUndo);
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceFind100kMatches {
+    NSAttributedString *document = [RichTextEditorFindReplaceTests documentWithMatchCount:100000];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsWholeWord];
+    findReplace.listMarkers = @[@"\u2022\u00A0"];
+    [self measureBlock:^{
+        XCTAssertEqual([findReplace rangesOfMatchesInString:document range:NSMakeRange(0, document.length)].count, (NSUInteger)100000);
+    }];
+}
+
+- (void)testPerformanceReplaceAll100kMatches {
+    NSAttributedString *document = [RichTextEditorFindReplaceTests documentWithMatchCount:100000];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsNone];
+    [self measureBlock:^{
+        RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:document];
+        XCTAssertEqual([editor replaceAllMatches:findReplace withTemplate:@"horse"], (NSUInteger)100000);
+    }];
+}
+
+// The same replacements made one match at a time, for comparison
+- (void)testPerformanceReplaceEachOf100kMatches {
+    NSAttributedString *document = [RichTextEditorFindReplaceTests documentWithMatchCount:100000];
+    RichTextEditorFindReplace *findReplace = [self findReplaceWithPattern:@"dog" options:RichTextEditorFindOptionsNone];
+    [self measureBlock:^{
+        RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:document];
+        NSArray *ranges = [findReplace rangesOfMatchesInString:editor.textStorage range:NSMakeRange(0, editor.textStorage.length)];
+        for (NSValue *range in ranges.reverseObjectEnumerator) {
+            if ([editor shouldChangeTextInRange:range.rangeValue replacementString:@"horse"]) {
+                [editor.textStorage replaceCharactersInRange:range.rangeValue withString:@"horse"];
+                [editor didChangeText];
+            }
+        }
+    }];
+}
+
+@end
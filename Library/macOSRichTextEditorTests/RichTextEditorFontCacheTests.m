@@ -0,0 +1,127 @@
+//
+//  RichTextEditorFontCacheTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+@interface RichTextEditorFontCacheTests : XCTestCase
+
+@property RichTextEditorFontCache *cache;
+
+@end
+
+@implementation RichTextEditorFontCacheTests
+
+- (void)setUp {
+    [super setUp];
+    self.cache = [[RichTextEditorFontCache alloc] init];
+}
+
+- (void)tearDown {
+    [RichTextEditorFontCache sharedCache].enabled = YES;
+    [super tearDown];
+}
+
+- (void)testCachedFontsMatchResolvedFonts {
+    RichTextEditorFontCache *uncached = [[RichTextEditorFontCache alloc] init];
+    uncached.enabled = NO;
+    for (NSString *name in @[@"Helvetica", @"Times New Roman", @"Courier", @"Menlo-Regular"]) {
+        for (int traits = 0; traits < 4; traits++) {
+            BOOL isBold = (traits & 1) != 0;
+            BOOL isItalic = (traits & 2) != 0;
+            NSFont *expected = [uncached fontWithName:name size:13 boldTrait:isBold italicTrait:isItalic];
+            XCTAssertEqualObjects([self.cache fontWithName:name size:13 boldTrait:isBold italicTrait:isItalic], expected);
+            XCTAssertEqualObjects([self.cache fontWithName:name size:13 boldTrait:isBold italicTrait:isItalic], expected);
+        }
+    }
+    XCTAssertEqual(uncached.hitCount, (NSUInteger)0);
+    XCTAssertEqual(uncached.missCount, (NSUInteger)0);
+}
+
+- (void)testCountsHitsAndMisses {
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:12];
+    NSFont *bold = [self.cache fontFromFont:font withBoldTrait:YES italicTrait:NO size:12];
+    XCTAssertTrue(bold.isBold);
+    // One lookup is one miss, however many lookups resolving it took
+    XCTAssertEqual(self.cache.missCount, (NSUInteger)1);
+    XCTAssertEqual(self.cache.hitCount, (NSUInteger)0);
+    XCTAssertEqualObjects([self.cache fontFromFont:font withBoldTrait:YES italicTrait:NO size:12], bold);
+    XCTAssertEqual(self.cache.missCount, (NSUInteger)1);
+    XCTAssertEqual(self.cache.hitCount, (NSUInteger)1);
+    // Different size is a different font
+    XCTAssertEqual([self.cache fontFromFont:font withBoldTrait:YES italicTrait:NO size:14].pointSize, (CGFloat)14);
+    XCTAssertEqual(self.cache.missCount, (NSUInteger)2);
+    XCTAssertEqual(self.cache.hitCount, (NSUInteger)1);
+    [self.cache resetStatistics];
+    XCTAssertEqual(self.cache.hitCount, (NSUInteger)0);
+    XCTAssertEqual(self.cache.missCount, (NSUInteger)0);
+}
+
+- (void)testUnknownPostScriptNameIsCached {
+    XCTAssertNil([self.cache postscriptNameFromFullName:@"No Such Font Anywhere"]);
+    XCTAssertNil([self.cache postscriptNameFromFullName:@"No Such Font Anywhere"]);
+    XCTAssertEqual(self.cache.hitCount, (NSUInteger)1);
+}
+
+- (void)testConcurrentLookups {
+    NSArray *names = @[@"Helvetica", @"Times New Roman", @"Courier"];
+    dispatch_apply(2000, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        NSFont *font = [self.cache fontWithName:names[i % names.count] size:10 + (i % 5) boldTrait:(i & 1) != 0 italicTrait:(i & 2) != 0];
+        XCTAssertNotNil(font);
+    });
+    // Each call is one lookup, plus nested name lookups on a miss
+    XCTAssertGreaterThanOrEqual(self.cache.hitCount + self.cache.missCount, (NSUInteger)2000);
+    XCTAssertGreaterThan(self.cache.hitCount, self.cache.missCount);
+}
+
+- (void)testCountLimit {
+    self.cache.countLimit = 4;
+    XCTAssertEqual(self.cache.countLimit, (NSUInteger)4);
+    for (NSUInteger size = 8; size < 40; size++) {
+        XCTAssertNotNil([self.cache fontWithName:@"Helvetica" size:size boldTrait:NO italicTrait:NO]);
+    }
+}
+
+#pragma mark - Benchmarks
+
+// Per-run cost of a bold toggle over a selection with a handful of distinct fonts
+- (void)measureBoldToggleWithCacheEnabled:(BOOL)enabled {
+    [RichTextEditorFontCache sharedCache].enabled = enabled;
+    NSArray *fonts = @[[NSFont fontWithName:@"Helvetica" size:12], [NSFont fontWithName:@"Helvetica" size:14],
+                       [NSFont fontWithName:@"Times New Roman" size:12], [NSFont fontWithName:@"Courier" size:12]];
+    [self measureBlock:^{
+        for (NSUInteger run = 0; run < 5000; run++) {
+            NSFont *font = fonts[run % fonts.count];
+            [font fontWithBoldTrait:!font.isBold andItalicTrait:font.isItalic];
+        }
+    }];
+}
+
+- (void)testPerformanceTraitConversionUncached {
+    [self measureBoldToggleWithCacheEnabled:NO];
+}
+
+- (void)testPerformanceTraitConversionCached {
+    [self measureBoldToggleWithCacheEnabled:YES];
+}
+
+- (void)testPerformanceBoldSelectionInEditor {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] init];
+    for (NSUInteger i = 0; i < 2000; i++) {
+        NSFont *font = [NSFont fontWithName:(i % 2 ? @"Helvetica" : @"Times New Roman") size:12 + (i % 3)];
+        [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"run of text "
+                                                                         attributes:@{NSFontAttributeName: font}]];
+    }
+    [self measureBlock:^{
+        [editor changeToAttributedString:document];
+        editor.selectedRange = NSMakeRange(0, document.length);
+        [editor userSelectedBold];
+    }];
+}
+
+@end
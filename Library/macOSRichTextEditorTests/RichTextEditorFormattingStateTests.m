@@ -0,0 +1,165 @@
+//
+//  RichTextEditorFormattingStateTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+@interface RichTextEditorFormattingStateRecorder : NSObject <RichTextEditorDelegate>
+
+@property NSUInteger legacyCallCount;
+@property NSMutableArray *states;
+
+@end
+
+@implementation RichTextEditorFormattingStateRecorder
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _states = [NSMutableArray array];
+    }
+    return self;
+}
+
+-(void)selectionForEditor:(RichTextEditor*)editor changedTo:(NSRange)range isBold:(BOOL)isBold isItalic:(BOOL)isItalic isUnderline:(BOOL)isUnderline isInBulletedList:(BOOL)isInBulletedList textBackgroundColor:(NSColor*)textBackgroundColor textColor:(NSColor*)textColor {
+    self.legacyCallCount++;
+}
+
+- (void)richTextEditor:(RichTextEditor*)editor formattingStateChanged:(RichTextEditorFormattingState*)state {
+    [self.states addObject:state];
+}
+
+@end
+
+@interface RichTextEditorFormattingStateTests : XCTestCase
+
+@property RichTextEditor *editor;
+@property RichTextEditorFormattingStateRecorder *recorder;
+
+@end
+
+@implementation RichTextEditorFormattingStateTests
+
+- (void)setUp {
+    [super setUp];
+    self.editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:12];
+    NSMutableAttributedString *text = [[NSMutableAttributedString alloc] initWithString:@"plain bold plain"
+                                                                            attributes:@{NSFontAttributeName: font}];
+    [text addAttribute:NSFontAttributeName value:[font fontWithBoldTrait:YES andItalicTrait:NO] range:NSMakeRange(6, 4)];
+    [self.editor changeToAttributedString:text];
+    self.recorder = [[RichTextEditorFormattingStateRecorder alloc] init];
+    self.editor.rteDelegate = self.recorder;
+}
+
+- (void)spinRunLoop {
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+}
+
+- (void)testChangedFields {
+    RichTextEditorFormattingState *first = [[RichTextEditorFormattingState alloc] initWithSelectedRange:NSMakeRange(0, 0) isBold:NO isItalic:NO
+                                                                                           isUnderline:NO isInBulletedList:NO
+                                                                                   textBackgroundColor:nil textColor:[NSColor blackColor]
+                                                                                         previousState:nil];
+    XCTAssertEqual(first.changedFields, RichTextEditorFormattingFieldAll);
+    RichTextEditorFormattingState *second = [[RichTextEditorFormattingState alloc] initWithSelectedRange:NSMakeRange(3, 0) isBold:YES isItalic:NO
+                                                                                            isUnderline:NO isInBulletedList:NO
+                                                                                    textBackgroundColor:nil textColor:[NSColor blackColor]
+                                                                                          previousState:first];
+    XCTAssertEqual(second.changedFields, RichTextEditorFormattingFieldSelectedRange | RichTextEditorFormattingFieldBold);
+    RichTextEditorFormattingState *third = [[RichTextEditorFormattingState alloc] initWithSelectedRange:NSMakeRange(3, 0) isBold:YES isItalic:NO
+                                                                                           isUnderline:NO isInBulletedList:NO
+                                                                                   textBackgroundColor:nil textColor:[NSColor blackColor]
+                                                                                         previousState:second];
+    XCTAssertEqual(third.changedFields, RichTextEditorFormattingFieldNone);
+    XCTAssertEqualObjects(second, third);
+    XCTAssertEqual(second.hash, third.hash);
+}
+
+- (void)testUpdatesAreImmediateByDefault {
+    for (NSUInteger i = 0; i < 5; i++) {
+        self.editor.selectedRange = NSMakeRange(i, 0);
+    }
+    XCTAssertGreaterThanOrEqual(self.recorder.legacyCallCount, (NSUInteger)5);
+    XCTAssertEqual(self.recorder.states.count, self.recorder.legacyCallCount);
+    XCTAssertEqual(self.editor.suppressedFormattingStateUpdateCount, (NSUInteger)0);
+}
+
+- (void)testUpdatesAreCoalescedPerRunLoopTurn {
+    self.editor.coalescesFormattingStateUpdates = YES;
+    for (NSUInteger i = 0; i < 8; i++) {
+        self.editor.selectedRange = NSMakeRange(i, 0);
+    }
+    XCTAssertEqual(self.recorder.legacyCallCount, (NSUInteger)0);
+    [self spinRunLoop];
+    XCTAssertEqual(self.recorder.legacyCallCount, (NSUInteger)1);
+    XCTAssertEqual(self.recorder.states.count, (NSUInteger)1);
+    RichTextEditorFormattingState *state = self.recorder.states.lastObject;
+    XCTAssertTrue(NSEqualRanges(state.selectedRange, NSMakeRange(7, 0)));
+    XCTAssertTrue(state.isBold);
+    XCTAssertEqualObjects(self.editor.formattingState, state);
+    XCTAssertEqual(self.editor.formattingStateUpdateCount, (NSUInteger)1);
+    XCTAssertGreaterThanOrEqual(self.editor.suppressedFormattingStateUpdateCount, (NSUInteger)7);
+
+    // Moving within the bold word only changes the selected range
+    self.editor.selectedRange = NSMakeRange(8, 0);
+    [self spinRunLoop];
+    XCTAssertEqual(self.recorder.states.count, (NSUInteger)2);
+    XCTAssertEqual([self.recorder.states.lastObject changedFields], RichTextEditorFormattingFieldSelectedRange);
+
+    // Nothing changed at all; nothing is delivered
+    [self.editor sendDelegateTypingAttrsUpdate];
+    [self spinRunLoop];
+    XCTAssertEqual(self.recorder.states.count, (NSUInteger)2);
+
+    [self.editor resetFormattingStateUpdateStatistics];
+    XCTAssertEqual(self.editor.formattingStateUpdateCount, (NSUInteger)0);
+    XCTAssertEqual(self.editor.suppressedFormattingStateUpdateCount, (NSUInteger)0);
+}
+
+- (void)testDragSelectionOnlyNotifiesAtTheEnd {
+    self.editor.coalescesFormattingStateUpdates = YES;
+    for (NSUInteger i = 1; i < 10; i++) {
+        [self.editor setSelectedRange:NSMakeRange(0, i) affinity:NSSelectionAffinityDownstream stillSelecting:YES];
+        [self spinRunLoop];
+    }
+    XCTAssertEqual(self.recorder.states.count, (NSUInteger)0);
+    [self.editor setSelectedRange:NSMakeRange(0, 10) affinity:NSSelectionAffinityDownstream stillSelecting:NO];
+    [self spinRunLoop];
+    XCTAssertEqual(self.recorder.states.count, (NSUInteger)1);
+    XCTAssertTrue(NSEqualRanges([self.recorder.states.lastObject selectedRange], NSMakeRange(0, 10)));
+}
+
+- (void)testTurningOffCoalescingFlushesPendingUpdate {
+    self.editor.coalescesFormattingStateUpdates = YES;
+    self.editor.selectedRange = NSMakeRange(2, 0);
+    XCTAssertEqual(self.recorder.states.count, (NSUInteger)0);
+    self.editor.coalescesFormattingStateUpdates = NO;
+    XCTAssertEqual(self.recorder.states.count, (NSUInteger)1);
+}
+
+#pragma mark - Benchmarks
+
+- (void)measureCaretMovesWithCoalescing:(BOOL)coalesces {
+    self.editor.coalescesFormattingStateUpdates = coalesces;
+    NSUInteger length = self.editor.string.length;
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 2000; i++) {
+            self.editor.selectedRange = NSMakeRange(i % length, 0);
+        }
+        [self spinRunLoop];
+    }];
+}
+
+- (void)testPerformanceCaretMovesImmediate {
+    [self measureCaretMovesWithCoalescing:NO];
+}
+
+- (void)testPerformanceCaretMovesCoalesced {
+    [self measureCaretMovesWithCoalescing:YES];
+}
+
+@end
@@ -0,0 +1,73 @@
+//
+//  RichTextEditorFoundationTesting.h
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+// Lets a test file run both in the test target and in the RTE_FOUNDATION_ONLY build from the
+// GNUmakefile, where there is no XCTest. There, this declares just enough of XCTestCase for the
+// document model tests, and RichTextEditorFoundationTesting.m runs every test method of every
+// XCTestCase subclass.
+
+#if defined(RTE_FOUNDATION_ONLY) && RTE_FOUNDATION_ONLY
+
+#import <Foundation/Foundation.h>
+#import "RichTextEditorDocument.h"
+#import "RichTextEditorParagraphIndex.h"
+#import "RichTextEditorParagraphBatch.h"
+#import "RichTextEditorAttributeInterner.h"
+
+@interface XCTestCase : NSObject
+
+/// Runs block once and prints how long it took.
+- (void)measureBlock:(void (^)(void))block;
+
+- (void)recordFailureWithDescription:(NSString *)description inFile:(NSString *)filePath atLine:(NSUInteger)lineNumber expected:(BOOL)expected;
+
+@end
+
+#define RTEFailTest(...) \
+    [self recordFailureWithDescription:[NSString stringWithFormat:__VA_ARGS__] inFile:@__FILE__ atLine:__LINE__ expected:YES]
+
+#define XCTAssertTrue(expression, ...) \
+    do { if (!(expression)) { RTEFailTest(@"(%s) is not true", #expression); } } while (0)
+
+#define XCTAssertFalse(expression, ...) \
+    do { if ((expression)) { RTEFailTest(@"(%s) is not false", #expression); } } while (0)
+
+#define XCTAssertNil(expression, ...) \
+    do { if ((expression) != nil) { RTEFailTest(@"(%s) is not nil", #expression); } } while (0)
+
+#define XCTAssertNotNil(expression, ...) \
+    do { if ((expression) == nil) { RTEFailTest(@"(%s) is nil", #expression); } } while (0)
+
+#define XCTAssertEqual(expression1, expression2, ...) \
+    do { \
+        __typeof__(expression1) rteValue1 = (expression1); \
+        __typeof__(expression2) rteValue2 = (expression2); \
+        if (rteValue1 != rteValue2) { RTEFailTest(@"(%s) is not equal to (%s)", #expression1, #expression2); } \
+    } while (0)
+
+#define XCTAssertGreaterThan(expression1, expression2, ...) \
+    do { \
+        __typeof__(expression1) rteValue1 = (expression1); \
+        __typeof__(expression2) rteValue2 = (expression2); \
+        if (!(rteValue1 > rteValue2)) { RTEFailTest(@"(%s) is not greater than (%s)", #expression1, #expression2); } \
+    } while (0)
+
+#define XCTAssertEqualObjects(expression1, expression2, ...) \
+    do { \
+        id rteObject1 = (expression1); \
+        id rteObject2 = (expression2); \
+        if (rteObject1 != rteObject2 && ![rteObject1 isEqual:rteObject2]) { \
+            RTEFailTest(@"(%@) is not equal to (%@)", rteObject1, rteObject2); \
+        } \
+    } while (0)
+
+#else
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+#endif
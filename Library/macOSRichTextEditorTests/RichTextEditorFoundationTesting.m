@@ -0,0 +1,69 @@
+//
+//  RichTextEditorFoundationTesting.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import "RichTextEditorFoundationTesting.h"
+
+#if defined(RTE_FOUNDATION_ONLY) && RTE_FOUNDATION_ONLY
+
+#import <objc/runtime.h>
+
+static NSUInteger RTEFailureCount = 0;
+
+@implementation XCTestCase
+
+- (void)measureBlock:(void (^)(void))block {
+    NSDate *start = [NSDate date];
+    block();
+    printf("    measured %.3f s\n", -[start timeIntervalSinceNow]);
+}
+
+- (void)recordFailureWithDescription:(NSString *)description inFile:(NSString *)filePath atLine:(NSUInteger)lineNumber expected:(BOOL)expected {
+    RTEFailureCount++;
+    // Same form as a compiler error, so editors can jump to it
+    fprintf(stderr, "%s:%lu: error: %s\n", filePath.UTF8String, (unsigned long)lineNumber, description.UTF8String);
+}
+
+@end
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        NSUInteger testCount = 0;
+        NSUInteger failedTestCount = 0;
+        int classCount = objc_getClassList(NULL, 0);
+        Class *classes = malloc(sizeof(Class) * (NSUInteger)classCount);
+        classCount = objc_getClassList(classes, classCount);
+        for (int i = 0; i < classCount; i++) {
+            if (class_getSuperclass(classes[i]) != [XCTestCase class]) {
+                continue;
+            }
+            unsigned int methodCount = 0;
+            Method *methods = class_copyMethodList(classes[i], &methodCount);
+            for (unsigned int j = 0; j < methodCount; j++) {
+                SEL selector = method_getName(methods[j]);
+                NSString *name = NSStringFromSelector(selector);
+                if (![name hasPrefix:@"test"] || [name rangeOfString:@":"].location != NSNotFound) {
+                    continue;
+                }
+                @autoreleasepool {
+                    NSUInteger failureCount = RTEFailureCount;
+                    XCTestCase *testCase = [[classes[i] alloc] init];
+                    ((void (*)(id, SEL))method_getImplementation(methods[j]))(testCase, selector);
+                    BOOL passed = RTEFailureCount == failureCount;
+                    testCount++;
+                    failedTestCount += passed ? 0 : 1;
+                    printf("Test Case '-[%s %s]' %s.\n", class_getName(classes[i]), name.UTF8String, passed ? "passed" : "failed");
+                }
+            }
+            free(methods);
+        }
+        free(classes);
+        printf("Executed %lu tests, with %lu failures\n", (unsigned long)testCount, (unsigned long)failedTestCount);
+        return testCount > 0 && failedTestCount == 0 ? 0 : 1;
+    }
+}
+
+#endif
@@ -0,0 +1,199 @@
+//
+//  RichTextEditorHTMLReaderTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+@interface RichTextEditorHTMLReaderTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorHTMLReaderTests
+
+- (NSAttributedString *)editorDocument {
+    NSFont *regular = [NSFont fontWithName:@"Helvetica" size:14];
+    NSFont *boldItalic = [regular fontWithBoldTrait:YES italicTrait:YES andSize:14];
+    NSMutableParagraphStyle *centered = [[NSMutableParagraphStyle alloc] init];
+    centered.alignment = NSCenterTextAlignment;
+    NSMutableParagraphStyle *indented = [[NSMutableParagraphStyle alloc] init];
+    indented.alignment = NSLeftTextAlignment;
+    indented.firstLineHeadIndent = 30;
+    indented.headIndent = 20;
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] init];
+    [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"Plain & <simple> "
+                                                                     attributes:@{NSFontAttributeName: regular, NSParagraphStyleAttributeName: centered}]];
+    [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"bold italic red\n"
+                                                                     attributes:@{NSFontAttributeName: boldItalic, NSParagraphStyleAttributeName: centered,
+                                                                                  NSForegroundColorAttributeName: [NSColor colorWithCalibratedRed:1 green:0 blue:0 alpha:1]}]];
+    [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"• underlined"
+                                                                     attributes:@{NSFontAttributeName: regular, NSParagraphStyleAttributeName: indented,
+                                                                                  NSUnderlineStyleAttributeName: @(NSUnderlineStyleSingle)}]];
+    return document;
+}
+
+- (void)testReadsEditorOutput {
+    NSAttributedString *document = [self editorDocument];
+    NSAttributedString *read = [RichTextEditorHTMLReader attributedStringFromHTMLString:[document htmlString]];
+    XCTAssertNotNil(read);
+    XCTAssertEqualObjects(read.string, [document.string stringByAppendingString:@"\n"]);
+
+    NSDictionary *attributes = [read attributesAtIndex:[read.string rangeOfString:@"bold"].location effectiveRange:nil];
+    NSFont *font = attributes[NSFontAttributeName];
+    XCTAssertTrue(font.isBold);
+    XCTAssertTrue(font.isItalic);
+    XCTAssertEqual(font.pointSize, (CGFloat)14);
+    XCTAssertEqualObjects(font.familyName, @"Helvetica");
+    NSColor *color = [attributes[NSForegroundColorAttributeName] colorUsingColorSpaceName:NSCalibratedRGBColorSpace];
+    XCTAssertEqualWithAccuracy(color.redComponent, 1, 0.01);
+    XCTAssertEqual([attributes[NSParagraphStyleAttributeName] alignment], NSCenterTextAlignment);
+
+    attributes = [read attributesAtIndex:[read.string rangeOfString:@"underlined"].location effectiveRange:nil];
+    XCTAssertEqualObjects(attributes[NSUnderlineStyleAttributeName], @(NSUnderlineStyleSingle));
+    NSParagraphStyle *paragraphStyle = attributes[NSParagraphStyleAttributeName];
+    XCTAssertEqual(paragraphStyle.headIndent, (CGFloat)20);
+    XCTAssertEqual(paragraphStyle.firstLineHeadIndent, (CGFloat)30);
+}
+
+- (void)testReadsCocoaStyleSheets {
+    NSString *html = @"<!DOCTYPE html PUBLIC \"-//W3C//DTD HTML 4.01//EN\" \"http://www.w3.org/TR/html4/strict.dtd\">\n"
+    "<html>\n<head>\n<meta http-equiv=\"Content-Type\" content=\"text/html; charset=UTF-8\">\n<title></title>\n"
+    "<meta name=\"Generator\" content=\"Cocoa HTML Writer\">\n"
+    "<style type=\"text/css\">\n"
+    "p.p1 {margin: 0.0px 0.0px 0.0px 0.0px; text-align: right; font: 12.0px Helvetica}\n"
+    "p.p2 {margin: 0.0px 0.0px 0.0px 0.0px; font: 12.0px Helvetica; min-height: 14.0px}\n"
+    "span.s1 {font: 18.0px 'Helvetica Neue'; color: #0000ff}\n"
+    "span.s2 {text-decoration: line-through}\n"
+    "span.Apple-tab-span {white-space:pre}\n"
+    "</style>\n</head>\n<body>\n"
+    "<!-- a comment with <p>markup</p> -->\n"
+    "<p class=\"p1\">One <span class=\"s1\"><b>two</b></span><span class=\"Apple-tab-span\">\t</span><span class=\"s2\">three</span></p>\n"
+    "<p class=\"p2\"><br></p>\n"
+    "<p class=\"p1\">four&nbsp;&amp;&#160;five</p>\n"
+    "</body>\n</html>\n";
+    NSAttributedString *read = [RichTextEditorHTMLReader attributedStringFromHTMLString:html];
+    XCTAssertNotNil(read);
+    XCTAssertEqualObjects(read.string, @"One two\tthree\n\nfour\u00A0&\u00A0five\n");
+    NSDictionary *attributes = [read attributesAtIndex:4 effectiveRange:nil];
+    NSFont *font = attributes[NSFontAttributeName];
+    XCTAssertEqualObjects(font.familyName, @"Helvetica Neue");
+    XCTAssertEqual(font.pointSize, (CGFloat)18);
+    XCTAssertTrue(font.isBold);
+    XCTAssertEqual([attributes[NSParagraphStyleAttributeName] alignment], NSRightTextAlignment);
+    XCTAssertEqualObjects([read attribute:NSStrikethroughStyleAttributeName atIndex:8 effectiveRange:nil], @(NSUnderlineStyleSingle));
+}
+
+- (void)testListsBecomeBulletParagraphs {
+    NSString *html = @"<ul>\n  <li>first</li>\n  <li>second</li>\n</ul><p>after</p>";
+    RichTextEditorHTMLReader *reader = [[RichTextEditorHTMLReader alloc] init];
+    [reader appendData:[html dataUsingEncoding:NSUTF8StringEncoding]];
+    NSAttributedString *read = [reader finish];
+    NSString *bullet = reader.bulletString;
+    NSString *expected = [NSString stringWithFormat:@"%@first\n%@second\nafter\n", bullet, bullet];
+    XCTAssertEqualObjects(read.string, expected);
+    NSParagraphStyle *paragraphStyle = [read attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:nil];
+    XCTAssertEqual(paragraphStyle.firstLineHeadIndent, reader.bulletIndentation);
+    XCTAssertGreaterThan(paragraphStyle.headIndent, paragraphStyle.firstLineHeadIndent);
+}
+
+- (void)testWhitespaceIsCollapsed {
+    NSAttributedString *read = [RichTextEditorHTMLReader attributedStringFromHTMLString:@"<p>  a \n  <b> b </b>   c  </p>"];
+    XCTAssertEqualObjects(read.string, @"a b c \n");
+}
+
+- (void)testUnsupportedMarkupReturnsNil {
+    for (NSString *html in @[@"<p><a href=\"https://example.com\">link</a></p>", @"<table><tr><td>x</td></tr></table>",
+                             @"<p><img src=\"x.png\"></p>", @"<ol><li>numbered</li></ol>"]) {
+        RichTextEditorHTMLReader *reader = [[RichTextEditorHTMLReader alloc] init];
+        [reader appendData:[html dataUsingEncoding:NSUTF8StringEncoding]];
+        XCTAssertNil([reader finish], @"%@", html);
+        XCTAssertNotNil(reader.unsupportedMarkup);
+    }
+}
+
+- (void)testUnsupportedMarkupFallsBackToCocoa {
+    NSAttributedString *read = [RichTextEditor attributedStringFromHTMLString:@"<p><a href=\"https://example.com\">link</a></p>"];
+    XCTAssertNotNil([read attribute:NSLinkAttributeName atIndex:0 effectiveRange:nil]);
+}
+
+- (void)testUnsupportedMarkupOffTheMainThreadDoesNotWaitForIt {
+    NSString *html = @"<p><a href=\"https://example.com\">link</a></p>";
+    XCTestExpectation *expectation = [self expectationWithDescription:@"read"];
+    // The main thread is blocked in waitForExpectations, so waiting for it would never return
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        XCTAssertNil([RichTextEditor attributedStringFromHTMLString:html]);
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+
+    XCTestExpectation *completion = [self expectationWithDescription:@"completion"];
+    [RichTextEditor attributedStringFromHTMLString:html completion:^(NSAttributedString *attributedString) {
+        XCTAssertNotNil([attributedString attribute:NSLinkAttributeName atIndex:0 effectiveRange:nil]);
+        [completion fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+}
+
+- (void)testStreamingInTinyChunks {
+    NSString *html = [[self editorDocument] htmlString];
+    html = [@"<!-- comment -->" stringByAppendingString:html];
+    NSData *data = [html dataUsingEncoding:NSUTF8StringEncoding];
+    RichTextEditorHTMLReader *reader = [[RichTextEditorHTMLReader alloc] init];
+    for (NSUInteger i = 0; i < data.length; i++) {
+        [reader appendData:[data subdataWithRange:NSMakeRange(i, 1)]];
+    }
+    NSAttributedString *chunked = [reader finish];
+    XCTAssertTrue([chunked isEqualToAttributedString:[RichTextEditorHTMLReader attributedStringFromHTMLString:html]]);
+}
+
+- (void)testReadsOnBackgroundQueue {
+    NSString *html = [[self editorDocument] htmlString];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"read"];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        XCTAssertNotNil([RichTextEditorHTMLReader attributedStringFromHTMLString:html]);
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+
+    XCTestExpectation *completion = [self expectationWithDescription:@"completion"];
+    [RichTextEditor attributedStringFromHTMLString:html completion:^(NSAttributedString *attributedString) {
+        XCTAssertTrue([NSThread isMainThread]);
+        XCTAssertNotNil(attributedString);
+        [completion fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+}
+
+#pragma mark - Benchmarks
+
+- (NSString *)largeHTMLDocument {
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] init];
+    for (NSUInteger i = 0; i < 200; i++) {
+        [document appendAttributedString:[self editorDocument]];
+        [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"\n"]];
+    }
+    return [document htmlString];
+}
+
+- (void)testPerformanceCocoaImporter {
+    NSString *html = [self largeHTMLDocument];
+    NSData *data = [html dataUsingEncoding:NSUTF8StringEncoding];
+    [self measureBlock:^{
+        [[NSAttributedString alloc] initWithData:data
+                                         options:@{NSDocumentTypeDocumentAttribute: NSHTMLTextDocumentType,
+                                                   NSCharacterEncodingDocumentAttribute: @(NSUTF8StringEncoding)}
+                              documentAttributes:nil error:nil];
+    }];
+}
+
+- (void)testPerformanceNativeReader {
+    NSString *html = [self largeHTMLDocument];
+    [self measureBlock:^{
+        [RichTextEditorHTMLReader attributedStringFromHTMLString:html];
+    }];
+}
+
+@end
@@ -0,0 +1,196 @@
+//
+//  RichTextEditorHTMLWriterTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+@interface RichTextEditorHTMLWriterTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorHTMLWriterTests
+
+#pragma mark - Legacy exporter
+
+// The exporter that used to live in NSAttributedString+RichTextEditor, kept here to check
+// that the writer produces the same markup and to benchmark against.
+- (NSString *)legacyHTMLStringFromAttributedString:(NSAttributedString *)attributedString {
+    NSMutableString *htmlString = [NSMutableString string];
+    NSArray *paragraphRanges = [attributedString rangeOfParagraphsFromTextRange:NSMakeRange(0, attributedString.string.length-1)];
+    for (NSValue *value in paragraphRanges) {
+        NSRange range = [value rangeValue];
+        NSParagraphStyle *paragraphStyle = [[attributedString attributesAtIndex:range.location effectiveRange:nil] objectForKey:NSParagraphStyleAttributeName];
+        NSString *textAlignmentString = nil;
+        switch (paragraphStyle.alignment) {
+            case NSLeftTextAlignment: textAlignmentString = @"left"; break;
+            case NSCenterTextAlignment: textAlignmentString = @"center"; break;
+            case NSRightTextAlignment: textAlignmentString = @"right"; break;
+            case NSJustifiedTextAlignment: textAlignmentString = @"justify"; break;
+            default: break;
+        }
+        [htmlString appendString:@"<p "];
+        if (textAlignmentString) {
+            [htmlString appendFormat:@"align=\"%@\" ", textAlignmentString];
+        }
+        [htmlString appendFormat:@"style=\""];
+        if (paragraphStyle.firstLineHeadIndent > 0) {
+            [htmlString appendFormat:@"text-indent:%.0fpx; ", paragraphStyle.firstLineHeadIndent - paragraphStyle.headIndent];
+        }
+        if (paragraphStyle.headIndent > 0) {
+            [htmlString appendFormat:@"margin-left:%.0fpx; ", paragraphStyle.headIndent];
+        }
+        [htmlString appendString:@" \">"];
+        [attributedString enumerateAttributesInRange:range
+                                             options:NSAttributedStringEnumerationLongestEffectiveRangeNotRequired
+                                          usingBlock:^(NSDictionary *dictionary, NSRange range, BOOL *stop) {
+            NSMutableString *fontString = [NSMutableString string];
+            NSFont *font = [dictionary objectForKey:NSFontAttributeName];
+            NSColor *foregroundColor = [dictionary objectForKey:NSForegroundColorAttributeName];
+            NSNumber *underline = [dictionary objectForKey:NSUnderlineStyleAttributeName];
+            BOOL hasUnderline = (!underline || underline.intValue == NSUnderlineStyleNone) ? NO : YES;
+            [fontString appendFormat:@"<font "];
+            [fontString appendFormat:@"face=\"%@\" ", font.familyName];
+            [fontString appendString:@" style=\" "];
+            [fontString appendFormat:@"font-size:%.0fpx; ", font.pointSize];
+            if (foregroundColor) {
+                CGFloat red = 0.0, green = 0.0, blue = 0.0, alpha = 0.0;
+                [foregroundColor getRed:&red green:&green blue:&blue alpha:&alpha];
+                [fontString appendFormat:@"color:%@; ", [NSString stringWithFormat:@"rgb(%d,%d,%d)", (int)(red*255.0), (int)(green*255.0), (int)(blue*255.0)]];
+            }
+            [fontString appendString:@"\" "];
+            [fontString appendString:@">"];
+            [fontString appendString:[[attributedString.string substringFromIndex:range.location] substringToIndex:range.length]];
+            [fontString appendString:@"</font>"];
+            if ([font isBold]) {
+                [fontString insertString:@"<b>" atIndex:0];
+                [fontString insertString:@"</b>" atIndex:fontString.length];
+            }
+            if ([font isItalic]) {
+                [fontString insertString:@"<i>" atIndex:0];
+                [fontString insertString:@"</i>" atIndex:fontString.length];
+            }
+            if (hasUnderline) {
+                [fontString insertString:@"<u>" atIndex:0];
+                [fontString insertString:@"</u>" atIndex:fontString.length];
+            }
+            [htmlString appendString:fontString];
+        }];
+        [htmlString appendString:@"</p>"];
+    }
+    return htmlString;
+}
+
+#pragma mark - Helpers
+
+// Every run in the document has different attributes from its neighbours, so the legacy
+// exporter and the writer produce the same runs.
+- (NSAttributedString *)documentWithParagraphCount:(NSUInteger)paragraphCount {
+    NSFont *regular = [NSFont fontWithName:@"Helvetica" size:12];
+    NSFont *bold = [[NSFontManager sharedFontManager] convertFont:regular toHaveTrait:NSBoldFontMask];
+    NSColor *red = [NSColor colorWithCalibratedRed:1 green:0 blue:0 alpha:1];
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] init];
+    for (NSUInteger i = 0; i < paragraphCount; i++) {
+        NSMutableParagraphStyle *paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+        paragraphStyle.alignment = (i % 3 == 0) ? NSCenterTextAlignment : NSLeftTextAlignment;
+        paragraphStyle.firstLineHeadIndent = (i % 4) * 10;
+        paragraphStyle.headIndent = (i % 2) * 10;
+        NSString *number = [NSString stringWithFormat:@"Paragraph %lu ", (unsigned long)i];
+        [document appendAttributedString:[[NSAttributedString alloc] initWithString:number
+                                                                         attributes:@{NSFontAttributeName: regular, NSParagraphStyleAttributeName: paragraphStyle}]];
+        [document appendAttributedString:[[NSAttributedString alloc] initWithString:@"bold and red"
+                                                                         attributes:@{NSFontAttributeName: bold, NSForegroundColorAttributeName: red,
+                                                                                      NSParagraphStyleAttributeName: paragraphStyle}]];
+        [document appendAttributedString:[[NSAttributedString alloc] initWithString:@" underlined text\n"
+                                                                         attributes:@{NSFontAttributeName: regular, NSParagraphStyleAttributeName: paragraphStyle,
+                                                                                      NSUnderlineStyleAttributeName: @(NSUnderlineStyleSingle)}]];
+    }
+    return document;
+}
+
+#pragma mark - Tests
+
+- (void)testMatchesLegacyExporter {
+    NSAttributedString *document = [self documentWithParagraphCount:20];
+    XCTAssertEqualObjects([document htmlString], [self legacyHTMLStringFromAttributedString:document]);
+}
+
+- (void)testEmptyString {
+    XCTAssertEqualObjects([[[NSAttributedString alloc] initWithString:@""] htmlString], @"");
+}
+
+- (void)testTrailingNewlineAndEmptyParagraphs {
+    NSAttributedString *document = [[NSAttributedString alloc] initWithString:@"a\n\nb\n"
+                                                                   attributes:@{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]}];
+    NSString *html = [document htmlString];
+    XCTAssertEqual([html componentsSeparatedByString:@"<p "].count - 1, (NSUInteger)3);
+    XCTAssertEqualObjects(html, [self legacyHTMLStringFromAttributedString:document]);
+}
+
+- (void)testEscapesText {
+    NSAttributedString *document = [[NSAttributedString alloc] initWithString:@"<b>Tom & \"Jerry\"</b> 😀"
+                                                                   attributes:@{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]}];
+    NSString *html = [document htmlString];
+    XCTAssertTrue([html containsString:@"&lt;b&gt;Tom &amp; &quot;Jerry&quot;&lt;/b&gt; 😀</font>"], @"%@", html);
+}
+
+- (void)testMergesRunsWithSameMarkup {
+    NSDictionary *attributes = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]};
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] initWithString:@"one two" attributes:attributes];
+    // Same markup, different attributes (the writer doesn't export links)
+    [document addAttribute:NSLinkAttributeName value:@"https://example.com" range:NSMakeRange(4, 3)];
+    NSString *html = [document htmlString];
+    XCTAssertEqual([html componentsSeparatedByString:@"<font "].count - 1, (NSUInteger)1);
+    XCTAssertTrue([html containsString:@">one two</font>"]);
+}
+
+- (void)testEditorExportsWriterOutput {
+    NSAttributedString *document = [self documentWithParagraphCount:20];
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor setAttributedString:document];
+    XCTAssertEqualObjects([editor htmlString], [editor.attributedString htmlString]);
+    XCTAssertEqualObjects([RichTextEditor htmlStringFromAttributedText:document], [document htmlString]);
+}
+
+- (void)testWritesToFile {
+    NSAttributedString *document = [self documentWithParagraphCount:2000];
+    NSURL *url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+    RichTextEditorHTMLWriter *writer = [[RichTextEditorHTMLWriter alloc] initWithAttributedString:document];
+    writer.bufferSize = 4096; // force plenty of flushes
+    NSError *error = nil;
+    XCTAssertTrue([writer writeToURL:url error:&error], @"%@", error);
+    NSString *written = [NSString stringWithContentsOfURL:url encoding:NSUTF8StringEncoding error:nil];
+    XCTAssertEqualObjects(written, [document htmlString]);
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceLegacyExporter {
+    NSAttributedString *document = [self documentWithParagraphCount:5000];
+    [self measureBlock:^{
+        [self legacyHTMLStringFromAttributedString:document];
+    }];
+}
+
+- (void)testPerformanceWriterToString {
+    NSAttributedString *document = [self documentWithParagraphCount:5000];
+    [self measureBlock:^{
+        [document htmlString];
+    }];
+}
+
+- (void)testPerformanceWriterToFile {
+    NSAttributedString *document = [self documentWithParagraphCount:5000];
+    NSURL *url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+    RichTextEditorHTMLWriter *writer = [[RichTextEditorHTMLWriter alloc] initWithAttributedString:document];
+    [self measureBlock:^{
+        [writer writeToURL:url error:nil];
+    }];
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+}
+
+@end
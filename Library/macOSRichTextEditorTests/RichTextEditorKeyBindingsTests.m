@@ -0,0 +1,217 @@
+//
+//  RichTextEditorKeyBindingsTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorKeyBindingsTestsHelper : NSObject <RichTextEditorDataSource, RichTextEditorDelegate>
+
+@property RichTextEditorShortcut shortcuts;
+@property NSUInteger keyDownCount;
+
+@end
+
+@implementation RichTextEditorKeyBindingsTestsHelper
+
+- (RichTextEditorShortcut)enabledKeyboardShortcuts {
+    return self.shortcuts;
+}
+
+- (void)selectionForEditor:(RichTextEditor *)editor changedTo:(NSRange)range isBold:(BOOL)isBold isItalic:(BOOL)isItalic isUnderline:(BOOL)isUnderline isInBulletedList:(BOOL)isInBulletedList textBackgroundColor:(NSColor *)textBackgroundColor textColor:(NSColor *)textColor {
+}
+
+- (BOOL)richTextEditor:(RichTextEditor *)editor keyDownEvent:(NSEvent *)event {
+    self.keyDownCount++;
+    return YES;
+}
+
+@end
+
+@interface RichTextEditorKeyBindingsTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorKeyBindingsTests
+
+- (NSEvent *)keyEventWithCharacters:(NSString *)characters modifierFlags:(NSEventModifierFlags)modifierFlags {
+    return [NSEvent keyEventWithType:NSKeyDown location:NSZeroPoint modifierFlags:modifierFlags timestamp:0 windowNumber:0 context:nil
+                          characters:characters charactersIgnoringModifiers:characters isARepeat:NO keyCode:0];
+}
+
+- (void)testLookup {
+    RichTextEditorKeyBindings *keyBindings = [RichTextEditor defaultKeyBindings];
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask]);
+    // Caps lock, shift, back tab and device dependent flags
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'B' modifierFlags:NSCommandKeyMask]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'l' modifierFlags:NSCommandKeyMask | NSShiftKeyMask]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:NSBackTabCharacter modifierFlags:NSShiftKeyMask]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask | NSAlphaShiftKeyMask | 0x100]);
+    // The default bindings ignore control and option, but not shift or command
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask | NSAlternateKeyMask]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask | NSControlKeyMask | NSAlternateKeyMask]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'\t' modifierFlags:NSAlternateKeyMask]);
+    XCTAssertNil([keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask | NSShiftKeyMask]);
+    XCTAssertNil([keyBindings commandForKeyCharacter:'b' modifierFlags:NSAlternateKeyMask]);
+    XCTAssertNil([keyBindings commandForKeyCharacter:'b' modifierFlags:0]);
+    XCTAssertNil([keyBindings commandForKeyCharacter:'a' modifierFlags:0]);
+    XCTAssertNil([keyBindings commandForKeyCharacter:0x00E9 modifierFlags:0]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'\t' modifierFlags:0]);
+}
+
+- (void)testIgnoredModifierFlags {
+    RichTextEditorKeyBindings *keyBindings = [[RichTextEditorKeyBindings alloc] init];
+    [keyBindings bindKey:@"k" modifierFlags:NSCommandKeyMask shortcut:RichTextEditorShortcutAll command:^BOOL(RichTextEditor *editor) {
+        return YES;
+    }];
+    [keyBindings bindKey:@"j" modifierFlags:NSCommandKeyMask ignoringModifierFlags:NSAlternateKeyMask shortcut:RichTextEditorShortcutAll command:^BOOL(RichTextEditor *editor) {
+        return YES;
+    }];
+    // Bindings without ignored flags need an exact match
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'k' modifierFlags:NSCommandKeyMask]);
+    XCTAssertNil([keyBindings commandForKeyCharacter:'k' modifierFlags:NSCommandKeyMask | NSAlternateKeyMask]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'j' modifierFlags:NSCommandKeyMask | NSAlternateKeyMask]);
+    XCTAssertNil([keyBindings commandForKeyCharacter:'j' modifierFlags:NSCommandKeyMask | NSControlKeyMask]);
+
+    // An exact binding wins over one that ignores the flag
+    __block BOOL exact = NO;
+    [keyBindings bindKey:@"j" modifierFlags:NSCommandKeyMask | NSAlternateKeyMask shortcut:RichTextEditorShortcutAll command:^BOOL(RichTextEditor *editor) {
+        exact = YES;
+        return YES;
+    }];
+    [keyBindings commandForKeyCharacter:'j' modifierFlags:NSCommandKeyMask | NSAlternateKeyMask](nil);
+    XCTAssertTrue(exact);
+}
+
+- (void)testEnabledShortcuts {
+    RichTextEditorKeyBindings *keyBindings = [RichTextEditor defaultKeyBindings];
+    [keyBindings bindKey:@"k" modifierFlags:NSCommandKeyMask shortcut:RichTextEditorShortcutAll command:^BOOL(RichTextEditor *editor) {
+        return YES;
+    }];
+    keyBindings.enabledShortcuts = RichTextEditorShortcutItalic;
+    XCTAssertNil([keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'i' modifierFlags:NSCommandKeyMask]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'k' modifierFlags:NSCommandKeyMask]);
+    XCTAssertNil([keyBindings commandForKeyCharacter:'\t' modifierFlags:0]);
+
+    keyBindings.enabledShortcuts = RichTextEditorShortcutAll;
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask]);
+}
+
+- (void)testRebinding {
+    RichTextEditorKeyBindings *keyBindings = [RichTextEditor defaultKeyBindings];
+    NSUInteger count = keyBindings.count;
+    RichTextEditorKeyBindings *copy = [keyBindings copy];
+    [copy unbindKey:@"B" modifierFlags:NSCommandKeyMask];
+    XCTAssertNil([copy commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask]);
+    XCTAssertNotNil([keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask]);
+    XCTAssertEqual(copy.count, count - 1);
+
+    __block NSUInteger calls = 0;
+    [copy bindKey:@"i" modifierFlags:NSCommandKeyMask shortcut:RichTextEditorShortcutAll command:^BOOL(RichTextEditor *editor) {
+        calls++;
+        return YES;
+    }];
+    XCTAssertEqual(copy.count, count - 1);
+    XCTAssertTrue([copy commandForKeyCharacter:'i' modifierFlags:NSCommandKeyMask](nil));
+    XCTAssertEqual(calls, (NSUInteger)1);
+
+    [copy removeAllBindings];
+    XCTAssertEqual(copy.count, (NSUInteger)0);
+    XCTAssertNil([copy commandForKeyCharacter:'i' modifierFlags:NSCommandKeyMask]);
+}
+
+- (void)testEditorKeyDown {
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] initWithString:@"hello world"
+                                                                                                                          attributes:@{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]}]];
+    editor.selectedRange = NSMakeRange(0, 5);
+    [editor keyDown:[self keyEventWithCharacters:@"b" modifierFlags:NSCommandKeyMask]];
+    NSFont *font = [editor.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertTrue(font.fontDescriptor.symbolicTraits & NSFontBoldTrait);
+    XCTAssertEqual(editor.lastSingleKeyPressed, (unichar)'b');
+
+    // Remapped without subclassing
+    __block NSUInteger calls = 0;
+    [editor.keyBindings bindKey:@"b" modifierFlags:NSCommandKeyMask shortcut:RichTextEditorShortcutAll command:^BOOL(RichTextEditor *commandEditor) {
+        XCTAssertEqual(commandEditor, editor);
+        calls++;
+        return YES;
+    }];
+    [editor keyDown:[self keyEventWithCharacters:@"b" modifierFlags:NSCommandKeyMask]];
+    XCTAssertEqual(calls, (NSUInteger)1);
+    font = [editor.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertTrue(font.fontDescriptor.symbolicTraits & NSFontBoldTrait);
+
+    [editor.keyBindings bindKey:@"k" modifierFlags:NSCommandKeyMask action:@selector(selectAll:)];
+    [editor keyDown:[self keyEventWithCharacters:@"k" modifierFlags:NSCommandKeyMask]];
+    XCTAssertTrue(NSEqualRanges(editor.selectedRange, NSMakeRange(0, editor.string.length)));
+
+    // Tab is only a shortcut when tabKeyAlwaysIndentsOutdents is set
+    editor.tabKeyAlwaysIndentsOutdents = NO;
+    XCTAssertFalse([editor.keyBindings commandForKeyCharacter:'\t' modifierFlags:0](editor));
+}
+
+- (void)testEditorDataSourceAndDelegate {
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] initWithString:@"hello"]];
+    RichTextEditorKeyBindingsTestsHelper *helper = [[RichTextEditorKeyBindingsTestsHelper alloc] init];
+    helper.shortcuts = RichTextEditorShortcutItalic;
+    editor.rteDataSource = helper;
+    XCTAssertNil([editor.keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask]);
+    XCTAssertNotNil([editor.keyBindings commandForKeyCharacter:'i' modifierFlags:NSCommandKeyMask]);
+
+    helper.shortcuts = RichTextEditorShortcutBold;
+    XCTAssertNil([editor.keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask]);
+    [editor reloadKeyBindings];
+    XCTAssertNotNil([editor.keyBindings commandForKeyCharacter:'b' modifierFlags:NSCommandKeyMask]);
+
+    // A new table keeps the data source's choice
+    editor.keyBindings = [RichTextEditor defaultKeyBindings];
+    XCTAssertNil([editor.keyBindings commandForKeyCharacter:'i' modifierFlags:NSCommandKeyMask]);
+
+    // Keys that aren't shortcuts go to the delegate
+    editor.rteDelegate = helper;
+    [editor keyDown:[self keyEventWithCharacters:@"a" modifierFlags:0]];
+    [editor keyDown:[self keyEventWithCharacters:@"i" modifierFlags:NSCommandKeyMask]];
+    XCTAssertEqual(helper.keyDownCount, (NSUInteger)2);
+    XCTAssertEqualObjects(editor.string, @"hello");
+    editor.rteDelegate = nil;
+    editor.rteDataSource = nil;
+}
+
+#pragma mark - Benchmarks
+
+// Cost of finding the command for a key, for plain typing (which should only take the bit test
+// in front of the table) and for shortcuts. Each iteration looks up 10000 keys.
+- (void)testBenchmarkKeyDispatch {
+    RichTextEditorBenchmarkSupport *support = [RichTextEditorBenchmarkSupport sharedSupport];
+    RichTextEditorKeyBindings *keyBindings = [RichTextEditor defaultKeyBindings];
+    [keyBindings commandForKeyCharacter:'a' modifierFlags:0]; // compile
+    NSString *typed = @"The quick brown fox jumps over the lazy dog. ";
+    NSString *shortcuts = @"biutT";
+    NSUInteger lookups = 10000;
+    __block NSUInteger found = 0;
+    NSDictionary *typing = [support measureOperation:@"key dispatch (typing)" paragraphCount:0 iterations:200 warmupIterations:5 block:^(NSUInteger iteration) {
+        for (NSUInteger i = 0; i < lookups; i++) {
+            if ([keyBindings commandForKeyCharacter:[typed characterAtIndex:i % typed.length] modifierFlags:0]) {
+                found++;
+            }
+        }
+    }];
+    XCTAssertEqual(found, (NSUInteger)0);
+    NSDictionary *shortcut = [support measureOperation:@"key dispatch (shortcut)" paragraphCount:0 iterations:200 warmupIterations:5 block:^(NSUInteger iteration) {
+        for (NSUInteger i = 0; i < lookups; i++) {
+            if ([keyBindings commandForKeyCharacter:[shortcuts characterAtIndex:i % shortcuts.length] modifierFlags:NSCommandKeyMask]) {
+                found++;
+            }
+        }
+    }];
+    XCTAssertEqual(found, lookups * 205);
+    NSLog(@"[RTE] key dispatch per key: typing %.1f ns, shortcut %.1f ns",
+          [typing[@"p50Microseconds"] doubleValue] * 1000 / lookups, [shortcut[@"p50Microseconds"] doubleValue] * 1000 / lookups);
+}
+
+@end
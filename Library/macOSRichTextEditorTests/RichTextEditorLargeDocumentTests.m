@@ -0,0 +1,145 @@
+//
+//  RichTextEditorLargeDocumentTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorLargeDocumentTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorLargeDocumentTests
+
+// An editor inside a scroll view, sized like a window's content, so that visibleRect is a
+// small part of the document as it would be on screen
+- (RichTextEditor *)scrolledEditorWithDocument:(NSAttributedString *)document largeDocumentMode:(BOOL)largeDocumentMode {
+    NSScrollView *scrollView = [[NSScrollView alloc] initWithFrame:NSMakeRect(0, 0, 600, 400)];
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 600, 400)];
+    editor.verticallyResizable = YES;
+    editor.maxSize = NSMakeSize(CGFLOAT_MAX, CGFLOAT_MAX);
+    editor.textContainer.widthTracksTextView = YES;
+    scrollView.documentView = editor;
+    editor.largeDocumentMode = largeDocumentMode;
+    [editor changeToAttributedString:document];
+    return editor;
+}
+
+- (void)testModeTogglesNonContiguousLayout {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    XCTAssertFalse(editor.largeDocumentMode);
+    XCTAssertFalse(editor.layoutManager.allowsNonContiguousLayout);
+    editor.largeDocumentMode = YES;
+    XCTAssertTrue(editor.layoutManager.allowsNonContiguousLayout);
+    editor.largeDocumentMode = NO;
+    XCTAssertFalse(editor.layoutManager.allowsNonContiguousLayout);
+}
+
+- (void)testScrollsOnlyWhenInsertionPointLeavesVisibleRect {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:2000 maximumListDepth:2];
+    RichTextEditor *editor = [self scrolledEditorWithDocument:document largeDocumentMode:YES];
+    editor.selectedRange = NSMakeRange(0, 0);
+    NSRect visibleRect = editor.visibleRect;
+    editor.selectedRange = NSMakeRange(10, 0);
+    XCTAssertTrue(NSEqualRects(editor.visibleRect, visibleRect));
+
+    editor.selectedRange = NSMakeRange(document.length, 0);
+    XCTAssertGreaterThan(NSMinY(editor.visibleRect), NSMinY(visibleRect));
+    visibleRect = editor.visibleRect;
+    editor.selectedRange = NSMakeRange(document.length - 1, 0);
+    XCTAssertTrue(NSEqualRects(editor.visibleRect, visibleRect));
+
+    editor.selectedRange = NSMakeRange(0, 0);
+    XCTAssertEqual(NSMinY(editor.visibleRect), (CGFloat)0);
+}
+
+- (void)testBulletCaretAdjustmentMatchesDefaultMode {
+    // Arrow keys across bulleted and plain paragraphs must land on the same places either way
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:30 maximumListDepth:2];
+    RichTextEditor *editor = [self scrolledEditorWithDocument:document largeDocumentMode:NO];
+    RichTextEditor *largeEditor = [self scrolledEditorWithDocument:document largeDocumentMode:YES];
+    for (RichTextEditor *each in @[editor, largeEditor]) {
+        each.selectedRange = NSMakeRange(0, 0);
+    }
+    for (NSUInteger i = 0; i < 400; i++) {
+        for (RichTextEditor *each in @[editor, largeEditor]) {
+            if (i < 200) {
+                [each moveRight:nil];
+            }
+            else {
+                [each moveLeft:nil];
+            }
+        }
+        XCTAssertTrue(NSEqualRanges(editor.selectedRange, largeEditor.selectedRange), @"step %lu: %@ vs %@",
+                      (unsigned long)i, NSStringFromRange(editor.selectedRange), NSStringFromRange(largeEditor.selectedRange));
+    }
+}
+
+- (void)testParagraphCommandsMatchDefaultMode {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:200 maximumListDepth:3];
+    RichTextEditor *editor = [self scrolledEditorWithDocument:document largeDocumentMode:NO];
+    RichTextEditor *largeEditor = [self scrolledEditorWithDocument:document largeDocumentMode:YES];
+    for (RichTextEditor *each in @[editor, largeEditor]) {
+        each.selectedRange = NSMakeRange(document.length / 2, 300);
+        [each userSelectedBullet];
+        [each userSelectedIncreaseIndent];
+        each.selectedRange = NSMakeRange(document.length / 3, 0);
+        [each userSelectedBullet];
+        [each userSelectedDecreaseIndent];
+    }
+    XCTAssertTrue([editor.attributedString isEqualToAttributedString:largeEditor.attributedString]);
+    XCTAssertTrue(NSEqualRanges(editor.selectedRange, largeEditor.selectedRange));
+}
+
+#pragma mark - Benchmarks
+
+- (NSAttributedString *)benchmarkDocument {
+    return [RichTextEditorBenchmarkSupport documentWithParagraphCount:100000 maximumListDepth:4];
+}
+
+// Loading the document and laying out enough of it to draw the first screen
+- (void)measureTimeToFirstDisplayInLargeDocumentMode:(BOOL)largeDocumentMode {
+    NSAttributedString *document = [self benchmarkDocument];
+    [self measureBlock:^{
+        RichTextEditor *editor = [self scrolledEditorWithDocument:document largeDocumentMode:largeDocumentMode];
+        NSRect visibleRect = editor.visibleRect;
+        [editor.layoutManager ensureLayoutForBoundingRect:visibleRect inTextContainer:editor.textContainer];
+        NSBitmapImageRep *bitmap = [editor bitmapImageRepForCachingDisplayInRect:visibleRect];
+        [editor cacheDisplayInRect:visibleRect toBitmapImageRep:bitmap];
+    }];
+}
+
+- (void)testPerformanceTimeToFirstDisplay {
+    [self measureTimeToFirstDisplayInLargeDocumentMode:NO];
+}
+
+- (void)testPerformanceTimeToFirstDisplayLargeDocumentMode {
+    [self measureTimeToFirstDisplayInLargeDocumentMode:YES];
+}
+
+// Typing in the middle of the document, with the layout the next draw would need
+- (void)measureKeystrokesInLargeDocumentMode:(BOOL)largeDocumentMode {
+    NSAttributedString *document = [self benchmarkDocument];
+    RichTextEditor *editor = [self scrolledEditorWithDocument:document largeDocumentMode:largeDocumentMode];
+    editor.selectedRange = NSMakeRange(document.length / 2, 0);
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 50; i++) {
+            [editor insertText:(i % 8 == 7 ? @" " : @"a") replacementRange:editor.selectedRange];
+            [editor.layoutManager ensureLayoutForBoundingRect:editor.visibleRect inTextContainer:editor.textContainer];
+        }
+    }];
+}
+
+- (void)testPerformanceKeystroke {
+    [self measureKeystrokesInLargeDocumentMode:NO];
+}
+
+- (void)testPerformanceKeystrokeLargeDocumentMode {
+    [self measureKeystrokesInLargeDocumentMode:YES];
+}
+
+@end
@@ -0,0 +1,287 @@
+//
+//  RichTextEditorMarkdownTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorMarkdownTests : XCTestCase
+
+@property NSFont *font;
+
+@end
+
+@implementation RichTextEditorMarkdownTests
+
+- (void)setUp {
+    [super setUp];
+    self.font = [NSFont fontWithName:@"Helvetica" size:12];
+}
+
+- (NSAttributedString *)stringWithText:(NSString *)text attributes:(NSDictionary *)attributes {
+    NSMutableDictionary *allAttributes = [@{NSFontAttributeName: self.font} mutableCopy];
+    [allAttributes addEntriesFromDictionary:attributes];
+    return [[NSAttributedString alloc] initWithString:text attributes:allAttributes];
+}
+
+- (NSAttributedString *)listItem:(NSString *)text indentation:(CGFloat)indentation {
+    NSMutableParagraphStyle *style = [[NSMutableParagraphStyle alloc] init];
+    style.firstLineHeadIndent = indentation;
+    style.headIndent = indentation;
+    return [self stringWithText:[@"\u2022\u00A0" stringByAppendingString:text] attributes:@{NSParagraphStyleAttributeName: style}];
+}
+
+- (NSString *)markdownOfString:(NSAttributedString *)string {
+    return [[[RichTextEditorMarkdownWriter alloc] initWithAttributedString:string] markdownString];
+}
+
+- (NSAttributedString *)attributedStringFromMarkdown:(NSString *)markdown {
+    RichTextEditorMarkdownReader *reader = [[RichTextEditorMarkdownReader alloc] init];
+    reader.font = self.font;
+    [reader appendData:[markdown dataUsingEncoding:NSUTF8StringEncoding]];
+    return [reader finish];
+}
+
+- (NSFontSymbolicTraits)traitsAtIndex:(NSUInteger)index ofString:(NSAttributedString *)string {
+    NSFont *font = [string attribute:NSFontAttributeName atIndex:index effectiveRange:NULL];
+    return font.fontDescriptor.symbolicTraits;
+}
+
+// Non-empty paragraphs without surrounding whitespace
+- (NSArray<NSString *> *)paragraphsOfString:(NSString *)string {
+    NSMutableArray<NSString *> *paragraphs = [NSMutableArray array];
+    for (NSString *paragraph in [string componentsSeparatedByString:@"\n"]) {
+        NSString *trimmed = [paragraph stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        if (trimmed.length > 0) {
+            [paragraphs addObject:trimmed];
+        }
+    }
+    return paragraphs;
+}
+
+#pragma mark - Writer
+
+- (void)testWriteInlineStyles {
+    NSFont *boldFont = [[NSFontManager sharedFontManager] convertFont:self.font toHaveTrait:NSBoldFontMask];
+    NSFont *italicFont = [[NSFontManager sharedFontManager] convertFont:self.font toHaveTrait:NSItalicFontMask];
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] init];
+    [string appendAttributedString:[self stringWithText:@"a " attributes:nil]];
+    [string appendAttributedString:[self stringWithText:@"b" attributes:@{NSFontAttributeName: boldFont}]];
+    [string appendAttributedString:[self stringWithText:@" " attributes:nil]];
+    [string appendAttributedString:[self stringWithText:@"c" attributes:@{NSFontAttributeName: italicFont}]];
+    [string appendAttributedString:[self stringWithText:@" " attributes:nil]];
+    [string appendAttributedString:[self stringWithText:@"d" attributes:@{NSStrikethroughStyleAttributeName: @(NSUnderlineStyleSingle)}]];
+    [string appendAttributedString:[self stringWithText:@" " attributes:nil]];
+    [string appendAttributedString:[self stringWithText:@"e" attributes:@{NSUnderlineStyleAttributeName: @(NSUnderlineStyleSingle)}]];
+    [string appendAttributedString:[self stringWithText:@" " attributes:nil]];
+    [string appendAttributedString:[self stringWithText:@"f" attributes:@{NSLinkAttributeName: [NSURL URLWithString:@"https://example.com"]}]];
+    XCTAssertEqualObjects([self markdownOfString:string], @"a **b** *c* ~~d~~ <u>e</u> [f](https://example.com)\n");
+
+    // Markup closes before the whitespace at the end of a styled run
+    NSMutableAttributedString *trailing = [[NSMutableAttributedString alloc] init];
+    [trailing appendAttributedString:[self stringWithText:@"b " attributes:@{NSFontAttributeName: boldFont}]];
+    [trailing appendAttributedString:[self stringWithText:@"c  " attributes:nil]];
+    XCTAssertEqualObjects([self markdownOfString:trailing], @"**b** c\n");
+}
+
+- (void)testWriteListsAndParagraphs {
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] init];
+    [string appendAttributedString:[self stringWithText:@"before\n\n" attributes:nil]];
+    [string appendAttributedString:[self listItem:@"one\n" indentation:15]];
+    [string appendAttributedString:[self listItem:@"two\n" indentation:30]];
+    [string appendAttributedString:[self listItem:@"three\n" indentation:75]];
+    [string appendAttributedString:[self listItem:@"four\n" indentation:15]];
+    [string appendAttributedString:[self stringWithText:@"after" attributes:nil]];
+    // Empty paragraphs are dropped, and a list only nests one level at a time
+    XCTAssertEqualObjects([self markdownOfString:string], @"before\n\n- one\n  - two\n    - three\n- four\n\nafter\n");
+    XCTAssertEqualObjects([self markdownOfString:[[NSAttributedString alloc] init]], @"");
+}
+
+- (void)testWriteAlignmentAndEscaping {
+    NSMutableParagraphStyle *centered = [[NSMutableParagraphStyle alloc] init];
+    centered.alignment = NSCenterTextAlignment;
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] init];
+    [string appendAttributedString:[self stringWithText:@"title\n" attributes:@{NSParagraphStyleAttributeName: centered}]];
+    [string appendAttributedString:[self stringWithText:@"# not *a* heading\n" attributes:nil]];
+    [string appendAttributedString:[self stringWithText:@"1. not a list\n" attributes:nil]];
+    [string appendAttributedString:[self stringWithText:@"a_b [c] <d> & e\\" attributes:nil]];
+    NSString *expected = @"<p align=\"center\">title</p>\n\n"
+                         @"\\# not \\*a\\* heading\n\n"
+                         @"1\\. not a list\n\n"
+                         @"a\\_b \\[c\\] \\<d> \\& e\\\\\n";
+    XCTAssertEqualObjects([self markdownOfString:string], expected);
+    // Everything escaped reads back as the same text
+    XCTAssertEqualObjects([self attributedStringFromMarkdown:expected].string, @"title\n# not *a* heading\n1. not a list\na_b [c] <d> & e\\");
+    NSParagraphStyle *style = [[self attributedStringFromMarkdown:expected] attribute:NSParagraphStyleAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(style.alignment, NSCenterTextAlignment);
+}
+
+- (void)testWriteToFileHandle {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID].UUIDString stringByAppendingPathExtension:@"md"]];
+    XCTAssertTrue([[NSFileManager defaultManager] createFileAtPath:path contents:nil attributes:nil]);
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingAtPath:path];
+    [fileHandle writeData:[@"# Notes\n\n" dataUsingEncoding:NSUTF8StringEncoding]];
+
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:500 maximumListDepth:3];
+    RichTextEditorMarkdownWriter *writer = [[RichTextEditorMarkdownWriter alloc] initWithAttributedString:document];
+    writer.bufferSize = 1000; // many flushes
+    NSError *error;
+    XCTAssertTrue([writer writeToFileHandle:fileHandle error:&error]);
+    XCTAssertNil(error);
+    [fileHandle closeFile];
+
+    NSString *written = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil];
+    XCTAssertEqualObjects(written, [@"# Notes\n\n" stringByAppendingString:[writer markdownString]]);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+#pragma mark - Reader
+
+- (void)testReadInlineStyles {
+    NSAttributedString *string = [self attributedStringFromMarkdown:@"a **b** *c* ~~d~~ <u>e</u> [f](https://example.com) `g`"];
+    XCTAssertEqualObjects(string.string, @"a b c d e f g");
+    XCTAssertEqual([self traitsAtIndex:0 ofString:string] & (NSFontBoldTrait | NSFontItalicTrait), (NSFontSymbolicTraits)0);
+    XCTAssertTrue([self traitsAtIndex:2 ofString:string] & NSFontBoldTrait);
+    XCTAssertTrue([self traitsAtIndex:4 ofString:string] & NSFontItalicTrait);
+    XCTAssertEqualObjects([string attribute:NSStrikethroughStyleAttributeName atIndex:6 effectiveRange:NULL], @(NSUnderlineStyleSingle));
+    XCTAssertEqualObjects([string attribute:NSUnderlineStyleAttributeName atIndex:8 effectiveRange:NULL], @(NSUnderlineStyleSingle));
+    XCTAssertEqualObjects([string attribute:NSLinkAttributeName atIndex:10 effectiveRange:NULL], [NSURL URLWithString:@"https://example.com"]);
+    XCTAssertNil([string attribute:NSLinkAttributeName atIndex:11 effectiveRange:NULL]);
+    XCTAssertTrue([self traitsAtIndex:12 ofString:string] & NSFontMonoSpaceTrait);
+}
+
+- (void)testReadEmphasisRules {
+    NSAttributedString *string = [self attributedStringFromMarkdown:@"snake_case_name"];
+    XCTAssertEqualObjects(string.string, @"snake_case_name");
+    XCTAssertFalse([self traitsAtIndex:6 ofString:string] & NSFontItalicTrait);
+
+    string = [self attributedStringFromMarkdown:@"*foo**bar**baz*"];
+    XCTAssertEqualObjects(string.string, @"foobarbaz");
+    XCTAssertTrue([self traitsAtIndex:0 ofString:string] & NSFontItalicTrait);
+    XCTAssertFalse([self traitsAtIndex:0 ofString:string] & NSFontBoldTrait);
+    XCTAssertTrue([self traitsAtIndex:3 ofString:string] & NSFontBoldTrait);
+    XCTAssertTrue([self traitsAtIndex:3 ofString:string] & NSFontItalicTrait);
+    XCTAssertTrue([self traitsAtIndex:8 ofString:string] & NSFontItalicTrait);
+
+    string = [self attributedStringFromMarkdown:@"**foo*"];
+    XCTAssertEqualObjects(string.string, @"*foo");
+    XCTAssertFalse([self traitsAtIndex:0 ofString:string] & NSFontItalicTrait);
+    XCTAssertTrue([self traitsAtIndex:1 ofString:string] & NSFontItalicTrait);
+
+    XCTAssertEqualObjects([self attributedStringFromMarkdown:@"2 * 3 * 4"].string, @"2 * 3 * 4");
+    XCTAssertEqualObjects([self attributedStringFromMarkdown:@"\\*not\\* `*code*` [no link] &lt;&#65;&#x42;&gt;"].string, @"*not* *code* [no link] <AB>");
+}
+
+- (void)testReadBlocks {
+    NSString *markdown = @"# Title\n\n"
+                         @"first line\nsecond line  \nthird\n\n"
+                         @"- one\n  - two\n1. three\n\n"
+                         @"> quote\n\n"
+                         @"```\ncode *x*\n```\n";
+    NSAttributedString *string = [self attributedStringFromMarkdown:markdown];
+    XCTAssertEqualObjects(string.string, @"Title\nfirst line second line\nthird\n\u2022\u00A0one\n\u2022\u00A0two\n\u2022\u00A0three\nquote\ncode *x*");
+
+    NSFont *titleFont = [string attribute:NSFontAttributeName atIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(titleFont.pointSize, (CGFloat)24);
+    XCTAssertTrue([self traitsAtIndex:0 ofString:string] & NSFontBoldTrait);
+
+    NSParagraphStyle *(^styleOf)(NSString *) = ^NSParagraphStyle *(NSString *text) {
+        return [string attribute:NSParagraphStyleAttributeName atIndex:[string.string rangeOfString:text].location effectiveRange:NULL];
+    };
+    XCTAssertEqual(styleOf(@"one").firstLineHeadIndent, (CGFloat)15);
+    XCTAssertEqual(styleOf(@"two").firstLineHeadIndent, (CGFloat)30);
+    XCTAssertEqual(styleOf(@"three").firstLineHeadIndent, (CGFloat)15);
+    XCTAssertEqual(styleOf(@"quote").headIndent, (CGFloat)15);
+    XCTAssertEqual(styleOf(@"first").firstLineHeadIndent, (CGFloat)0);
+    XCTAssertTrue([self traitsAtIndex:[string.string rangeOfString:@"code"].location ofString:string] & NSFontMonoSpaceTrait);
+}
+
+- (void)testReadInChunks {
+    NSData *data = [@"caf\u00E9 **b\u00E9**\r\n\r\nnext" dataUsingEncoding:NSUTF8StringEncoding];
+    RichTextEditorMarkdownReader *reader = [[RichTextEditorMarkdownReader alloc] init];
+    // One byte at a time splits every multi-byte character
+    for (NSUInteger i = 0; i < data.length; i++) {
+        [reader appendData:[data subdataWithRange:NSMakeRange(i, 1)]];
+    }
+    NSAttributedString *string = [reader finish];
+    XCTAssertEqualObjects(string.string, @"caf\u00E9 b\u00E9\nnext");
+    XCTAssertTrue([self traitsAtIndex:5 ofString:string] & NSFontBoldTrait);
+
+    RichTextEditorMarkdownReader *invalidReader = [[RichTextEditorMarkdownReader alloc] init];
+    [invalidReader appendData:[NSData dataWithBytes:"ok\n\xff\n" length:5]];
+    XCTAssertNil([invalidReader finish]);
+    XCTAssertNotNil(invalidReader.error);
+}
+
+- (void)testReadOnBackgroundThread {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"read"];
+    NSString *markdown = [self markdownOfString:[RichTextEditorBenchmarkSupport documentWithParagraphCount:1000 maximumListDepth:3]];
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        NSAttributedString *string = [RichTextEditorMarkdownReader attributedStringFromMarkdownString:markdown];
+        XCTAssertEqual([string.string componentsSeparatedByString:@"\n"].count, (NSUInteger)1000);
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:30 handler:nil];
+}
+
+#pragma mark - Round Trip
+
+- (void)testRoundTrip {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:200 maximumListDepth:3];
+    NSString *markdown = [self markdownOfString:document];
+    NSAttributedString *read = [self attributedStringFromMarkdown:markdown];
+    XCTAssertEqualObjects([self paragraphsOfString:read.string], [self paragraphsOfString:document.string]);
+    // Styles and list levels survive, so writing what was read gives the same Markdown
+    XCTAssertEqualObjects([self markdownOfString:read], markdown);
+}
+
+- (void)testEditorMarkdown {
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] init]];
+    [editor setMarkdownString:@"- **a**\n  - b\n\nc"];
+    XCTAssertEqualObjects(editor.string, @"\u2022\u00A0a\n\u2022\u00A0b\nc");
+    XCTAssertEqualObjects([editor markdownString], @"- **a**\n  - b\n\nc\n");
+
+    NSPipe *pipe = [NSPipe pipe];
+    XCTAssertTrue([editor writeMarkdownToFileHandle:pipe.fileHandleForWriting error:nil]);
+    [pipe.fileHandleForWriting closeFile];
+    NSData *data = [pipe.fileHandleForReading readDataToEndOfFile];
+    XCTAssertEqualObjects([[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding], @"- **a**\n  - b\n\nc\n");
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceMarkdownWriter {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:10000 maximumListDepth:4];
+    [self measureBlock:^{
+        [[[RichTextEditorMarkdownWriter alloc] initWithAttributedString:document] markdownString];
+    }];
+}
+
+- (void)testPerformanceHTMLWriter {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:10000 maximumListDepth:4];
+    [self measureBlock:^{
+        [RichTextEditor htmlStringFromAttributedText:document];
+    }];
+}
+
+- (void)testPerformanceMarkdownReader {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:10000 maximumListDepth:4];
+    NSString *markdown = [self markdownOfString:document];
+    [self measureBlock:^{
+        [RichTextEditorMarkdownReader attributedStringFromMarkdownString:markdown];
+    }];
+}
+
+- (void)testPerformanceHTMLReader {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:10000 maximumListDepth:4];
+    NSString *html = [RichTextEditor htmlStringFromAttributedText:document];
+    [self measureBlock:^{
+        [RichTextEditor attributedStringFromHTMLString:html];
+    }];
+}
+
+@end
@@ -0,0 +1,281 @@
+//
+//  RichTextEditorParagraphBatchTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+// Differential tests: the paragraph commands used to edit one paragraph at a time.
+// The legacy* methods below are straight ports of that code (minus the NSTextView selection
+// side effects) and the batched commands must produce exactly the same text and attributes.
+
+static NSDictionary *LegacyAttributesAtIndex(NSAttributedString *string, NSUInteger index, NSDictionary *typingAttributes) {
+    if (string.length == 0 || index == string.length) {
+        return typingAttributes;
+    }
+    return [string attributesAtIndex:index effectiveRange:nil];
+}
+
+static NSMutableParagraphStyle *LegacyMutableParagraphStyle(NSDictionary *dictionary) {
+    NSMutableParagraphStyle *paragraphStyle = [[dictionary objectForKey:NSParagraphStyleAttributeName] mutableCopy];
+    return paragraphStyle ? paragraphStyle : [[NSMutableParagraphStyle alloc] init];
+}
+
+@interface RichTextEditorParagraphBatchTests : XCTestCase
+
+@property RichTextEditor *editor;
+
+@end
+
+@implementation RichTextEditorParagraphBatchTests
+
+- (void)setUp {
+    [super setUp];
+    self.editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+}
+
+- (NSAttributedString *)documentWithParagraphs:(NSArray *)paragraphs {
+    NSMutableAttributedString *document = [[NSMutableAttributedString alloc] init];
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:12];
+    NSString *bullet = self.editor.bulletString;
+    for (NSUInteger i = 0; i < paragraphs.count; i++) {
+        NSString *text = paragraphs[i];
+        NSMutableParagraphStyle *paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+        if ([text hasPrefix:bullet]) {
+            paragraphStyle.firstLineHeadIndent = self.editor.defaultIndentationSize;
+            paragraphStyle.headIndent = self.editor.defaultIndentationSize * 2;
+        }
+        else if (i % 2 == 1) {
+            paragraphStyle.firstLineHeadIndent = self.editor.defaultIndentationSize;
+            paragraphStyle.headIndent = self.editor.defaultIndentationSize;
+        }
+        NSString *paragraph = i + 1 < paragraphs.count ? [text stringByAppendingString:@"\n"] : text;
+        [document appendAttributedString:[[NSAttributedString alloc] initWithString:paragraph
+                                                                         attributes:@{NSFontAttributeName: font,
+                                                                                      NSParagraphStyleAttributeName: paragraphStyle}]];
+    }
+    return document;
+}
+
+- (NSArray *)plainParagraphs {
+    return @[@"First paragraph", @"Second paragraph", @"", @"Fourth paragraph", @"Fifth"];
+}
+
+- (NSArray *)bulletedParagraphs {
+    NSString *bullet = self.editor.bulletString;
+    return @[[bullet stringByAppendingString:@"one"], [bullet stringByAppendingString:@"two"], bullet,
+             [bullet stringByAppendingString:@"four"]];
+}
+
+- (NSArray *)mixedParagraphs {
+    NSString *bullet = self.editor.bulletString;
+    return @[@"Intro", [bullet stringByAppendingString:@"one"], @"plain in the middle", [bullet stringByAppendingString:@"two"], @"Outro"];
+}
+
+// Loads the document, selects the range, and returns a copy of the editor text plus the
+// selection the editor actually ended up with (selection can be adjusted around bullets).
+- (NSTextStorage *)loadDocument:(NSAttributedString *)document selecting:(NSRange)range selection:(NSRange *)actualSelection {
+    [self.editor changeToAttributedString:document];
+    self.editor.selectedRange = range;
+    *actualSelection = self.editor.selectedRange;
+    return [[NSTextStorage alloc] initWithAttributedString:self.editor.textStorage];
+}
+
+- (void)assertEditorMatches:(NSAttributedString *)expected {
+    XCTAssertEqualObjects(self.editor.textStorage.string, expected.string);
+    XCTAssertTrue([self.editor.textStorage isEqualToAttributedString:expected], @"Attributes differ from the legacy implementation");
+}
+
+#pragma mark - Legacy implementations
+
+- (void)legacyIndentTextStorage:(NSTextStorage *)textStorage selection:(NSRange)selection increase:(BOOL)increase typingAttributes:(NSDictionary *)typingAttributes {
+    CGFloat indentation = self.editor.defaultIndentationSize;
+    CGFloat maxIndent = indentation * 10;
+    for (NSValue *value in [textStorage rangeOfParagraphsFromTextRange:selection]) {
+        NSRange paragraphRange = [value rangeValue];
+        NSMutableParagraphStyle *paragraphStyle = LegacyMutableParagraphStyle(LegacyAttributesAtIndex(textStorage, paragraphRange.location, typingAttributes));
+        if (increase && paragraphStyle.headIndent < maxIndent && paragraphStyle.firstLineHeadIndent < maxIndent) {
+            paragraphStyle.headIndent += indentation;
+            paragraphStyle.firstLineHeadIndent += indentation;
+        }
+        else if (!increase) {
+            paragraphStyle.headIndent = MAX(paragraphStyle.headIndent - indentation, 0);
+            paragraphStyle.firstLineHeadIndent = MAX(paragraphStyle.firstLineHeadIndent - indentation, 0);
+        }
+        if (paragraphRange.length > 0) {
+            [textStorage addAttributes:@{NSParagraphStyleAttributeName: paragraphStyle} range:paragraphRange];
+        }
+    }
+}
+
+- (void)legacyToggleBulletInTextStorage:(NSTextStorage *)textStorage selection:(NSRange)selection typingAttributes:(NSDictionary *)typingAttributes {
+    NSString *bullet = self.editor.bulletString;
+    NSArray *paragraphs = [textStorage rangeOfParagraphsFromTextRange:selection];
+    NSRange currentParagraph = [textStorage firstParagraphRangeFromTextRange:selection];
+    BOOL firstParagraphHasBullet = [[textStorage.string substringFromIndex:currentParagraph.location] hasPrefix:bullet];
+    NSRange previousParagraph = [textStorage firstParagraphRangeFromTextRange:NSMakeRange(currentParagraph.location - 1, 0)];
+    NSParagraphStyle *previousStyle = [LegacyAttributesAtIndex(textStorage, previousParagraph.location, typingAttributes) objectForKey:NSParagraphStyleAttributeName];
+    NSInteger rangeOffset = 0;
+    BOOL mustDecreaseIndent = NO;
+    for (NSValue *value in paragraphs) {
+        NSRange range = NSMakeRange([value rangeValue].location + rangeOffset, [value rangeValue].length);
+        NSDictionary *dictionary = LegacyAttributesAtIndex(textStorage, MAX((int)range.location - 1, 0), typingAttributes);
+        NSMutableParagraphStyle *paragraphStyle = LegacyMutableParagraphStyle(dictionary);
+        BOOL hasBullet = [[textStorage.string substringFromIndex:range.location] hasPrefix:bullet];
+        if (hasBullet != firstParagraphHasBullet) {
+            continue;
+        }
+        if (hasBullet) {
+            range.length -= bullet.length;
+            [textStorage deleteCharactersInRange:NSMakeRange(range.location, bullet.length)];
+            paragraphStyle.firstLineHeadIndent = 0;
+            paragraphStyle.headIndent = 0;
+            rangeOffset -= bullet.length;
+            mustDecreaseIndent = YES;
+        }
+        else {
+            range.length += bullet.length;
+            NSMutableAttributedString *bulletString = [[NSMutableAttributedString alloc] initWithString:bullet attributes:nil];
+            [bulletString setAttributes:dictionary range:NSMakeRange(0, bullet.length)];
+            [textStorage insertAttributedString:bulletString atIndex:range.location];
+            CGSize bulletSize = [bullet sizeWithAttributes:dictionary];
+            BOOL previousHasBullet = [[textStorage.string substringWithRange:previousParagraph] hasPrefix:bullet];
+            paragraphStyle.firstLineHeadIndent = previousHasBullet ? previousStyle.firstLineHeadIndent : self.editor.defaultIndentationSize;
+            paragraphStyle.headIndent = bulletSize.width + paragraphStyle.firstLineHeadIndent;
+            rangeOffset += bullet.length;
+        }
+        [textStorage addAttribute:NSParagraphStyleAttributeName value:paragraphStyle range:range];
+    }
+    if (mustDecreaseIndent) {
+        NSRange first = [paragraphs.firstObject rangeValue];
+        NSRange last = [paragraphs.lastObject rangeValue];
+        NSRange fullRange = NSMakeRange(first.location, NSMaxRange(last) - first.location + rangeOffset);
+        [self legacyIndentTextStorage:textStorage selection:fullRange increase:NO typingAttributes:typingAttributes];
+    }
+}
+
+- (void)legacyApplyParagraphStyleChange:(void (^)(NSMutableParagraphStyle *paragraphStyle))change toTextStorage:(NSTextStorage *)textStorage
+                              selection:(NSRange)selection typingAttributes:(NSDictionary *)typingAttributes {
+    for (NSValue *value in [textStorage rangeOfParagraphsFromTextRange:selection]) {
+        NSRange paragraphRange = [value rangeValue];
+        NSMutableParagraphStyle *paragraphStyle = LegacyMutableParagraphStyle(LegacyAttributesAtIndex(textStorage, paragraphRange.location, typingAttributes));
+        change(paragraphStyle);
+        if (paragraphRange.length > 0) {
+            [textStorage addAttributes:@{NSParagraphStyleAttributeName: paragraphStyle} range:paragraphRange];
+        }
+    }
+}
+
+#pragma mark - Tests
+
+- (void)checkBulletToggleWithParagraphs:(NSArray *)paragraphs selecting:(NSRange)range {
+    NSRange selection;
+    NSTextStorage *expected = [self loadDocument:[self documentWithParagraphs:paragraphs] selecting:range selection:&selection];
+    [self legacyToggleBulletInTextStorage:expected selection:selection typingAttributes:self.editor.typingAttributes];
+    [self.editor userSelectedBullet];
+    [self assertEditorMatches:expected];
+}
+
+- (void)testAddingBulletsToWholeDocument {
+    NSAttributedString *document = [self documentWithParagraphs:[self plainParagraphs]];
+    [self checkBulletToggleWithParagraphs:[self plainParagraphs] selecting:NSMakeRange(0, document.length)];
+}
+
+- (void)testAddingBulletAtCaret {
+    [self checkBulletToggleWithParagraphs:[self plainParagraphs] selecting:NSMakeRange(20, 0)];
+}
+
+- (void)testRemovingBulletsFromWholeDocument {
+    NSAttributedString *document = [self documentWithParagraphs:[self bulletedParagraphs]];
+    [self checkBulletToggleWithParagraphs:[self bulletedParagraphs] selecting:NSMakeRange(0, document.length)];
+}
+
+- (void)testRemovingBulletsFromMixedSelection {
+    NSAttributedString *document = [self documentWithParagraphs:[self mixedParagraphs]];
+    NSUInteger start = [document.string rangeOfString:@"one"].location;
+    [self checkBulletToggleWithParagraphs:[self mixedParagraphs] selecting:NSMakeRange(start, document.length - start)];
+}
+
+- (void)testIndentation {
+    NSAttributedString *document = [self documentWithParagraphs:[self mixedParagraphs]];
+    for (NSNumber *increase in @[@YES, @YES, @NO, @NO, @NO]) {
+        NSRange selection;
+        NSTextStorage *expected = [self loadDocument:document selecting:NSMakeRange(3, document.length - 6) selection:&selection];
+        [self legacyIndentTextStorage:expected selection:selection increase:increase.boolValue typingAttributes:self.editor.typingAttributes];
+        if (increase.boolValue) {
+            [self.editor userSelectedIncreaseIndent];
+        }
+        else {
+            [self.editor userSelectedDecreaseIndent];
+        }
+        [self assertEditorMatches:expected];
+        XCTAssertTrue(NSEqualRanges(self.editor.selectedRange, selection));
+        document = [self.editor.textStorage copy];
+    }
+}
+
+- (void)testAlignment {
+    NSAttributedString *document = [self documentWithParagraphs:[self plainParagraphs]];
+    NSRange selection;
+    NSTextStorage *expected = [self loadDocument:document selecting:NSMakeRange(5, document.length - 10) selection:&selection];
+    [self legacyApplyParagraphStyleChange:^(NSMutableParagraphStyle *paragraphStyle) {
+        paragraphStyle.alignment = NSCenterTextAlignment;
+    } toTextStorage:expected selection:selection typingAttributes:self.editor.typingAttributes];
+    [self.editor userSelectedTextAlignment:NSCenterTextAlignment];
+    [self assertEditorMatches:expected];
+    XCTAssertEqual([self.editor.typingAttributes[NSParagraphStyleAttributeName] alignment], NSCenterTextAlignment);
+}
+
+- (void)testFirstLineHeadIndent {
+    NSAttributedString *document = [self documentWithParagraphs:[self plainParagraphs]];
+    CGFloat indentation = self.editor.defaultIndentationSize;
+    NSRange selection;
+    NSTextStorage *expected = [self loadDocument:document selecting:NSMakeRange(0, document.length) selection:&selection];
+    [self legacyApplyParagraphStyleChange:^(NSMutableParagraphStyle *paragraphStyle) {
+        if (paragraphStyle.headIndent == paragraphStyle.firstLineHeadIndent) {
+            paragraphStyle.firstLineHeadIndent += indentation;
+        }
+        else {
+            paragraphStyle.firstLineHeadIndent = paragraphStyle.headIndent;
+        }
+    } toTextStorage:expected selection:selection typingAttributes:self.editor.typingAttributes];
+    [self.editor userSelectedParagraphFirstLineHeadIndent];
+    [self assertEditorMatches:expected];
+}
+
+- (void)testBatchAppliesInOneTransaction {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"aa\nbb\ncc"];
+    __block NSUInteger editCount = 0;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:NSTextStorageDidProcessEditingNotification
+                                                                    object:textStorage queue:nil usingBlock:^(NSNotification *note) {
+        editCount++;
+    }];
+    RichTextEditorParagraphBatch *batch = [[RichTextEditorParagraphBatch alloc] initWithTextStorage:textStorage];
+    NSParagraphStyle *paragraphStyle = [[NSParagraphStyle alloc] init];
+    [batch changeParagraph:NSMakeRange(0, 2) deletingPrefixLength:1 insertingPrefix:nil paragraphStyle:paragraphStyle];
+    [batch changeParagraph:NSMakeRange(3, 2) deletingPrefixLength:0 insertingPrefix:[[NSAttributedString alloc] initWithString:@"xx"] paragraphStyle:nil];
+    [batch changeParagraph:NSMakeRange(6, 2) deletingPrefixLength:2 insertingPrefix:[[NSAttributedString alloc] initWithString:@"y"] paragraphStyle:paragraphStyle];
+    [batch apply];
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    XCTAssertEqualObjects(textStorage.string, @"a\nxxbb\ny");
+    XCTAssertEqual(batch.changeInLength, (NSInteger)0);
+    XCTAssertEqual(editCount, (NSUInteger)1);
+}
+
+- (void)testPerformanceBulletSelectAll {
+    NSMutableArray *paragraphs = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 5000; i++) {
+        [paragraphs addObject:[NSString stringWithFormat:@"List item %lu", (unsigned long)i]];
+    }
+    NSAttributedString *document = [self documentWithParagraphs:paragraphs];
+    [self measureBlock:^{
+        [self.editor changeToAttributedString:document];
+        self.editor.selectedRange = NSMakeRange(0, document.length);
+        [self.editor userSelectedBullet];
+    }];
+}
+
+@end
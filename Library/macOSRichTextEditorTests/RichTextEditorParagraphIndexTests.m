@@ -0,0 +1,261 @@
+//
+//  RichTextEditorParagraphIndexTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+@interface RichTextEditorParagraphIndexTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorParagraphIndexTests
+
+- (NSString *)randomStringOfLength:(NSUInteger)length {
+    static NSString *alphabet = @"abc def\n\n• xyz";
+    NSMutableString *string = [NSMutableString stringWithCapacity:length];
+    for (NSUInteger i = 0; i < length; i++) {
+        unichar c = [alphabet characterAtIndex:arc4random_uniform((uint32_t)alphabet.length)];
+        [string appendFormat:@"%C", c];
+    }
+    return string;
+}
+
+- (NSString *)documentWithParagraphCount:(NSUInteger)paragraphCount {
+    NSMutableString *string = [NSMutableString string];
+    for (NSUInteger i = 0; i < paragraphCount; i++) {
+        [string appendFormat:@"%@Paragraph number %lu with some text in it\n", (i % 3 == 0 ? @"• " : @""), (unsigned long)i];
+    }
+    return string;
+}
+
+- (void)assertIndex:(RichTextEditorParagraphIndex *)index matchesScanningOf:(NSTextStorage *)textStorage {
+    XCTAssertTrue([index isInSync]);
+    for (NSUInteger i = 0; i <= textStorage.length + 1; i++) {
+        NSRange expected = [textStorage firstParagraphRangeFromTextRange:NSMakeRange(i, 0)];
+        NSRange actual = [index firstParagraphRangeFromTextRange:NSMakeRange(i, 0)];
+        XCTAssertTrue(NSEqualRanges(expected, actual), @"Paragraph mismatch at %lu: expected %@, got %@",
+                      (unsigned long)i, NSStringFromRange(expected), NSStringFromRange(actual));
+    }
+    for (NSUInteger i = 0; i < 20 && textStorage.length > 0; i++) {
+        NSUInteger location = arc4random_uniform((uint32_t)textStorage.length);
+        NSUInteger length = arc4random_uniform((uint32_t)(textStorage.length - location));
+        NSRange range = NSMakeRange(location, length);
+        XCTAssertEqualObjects([textStorage rangeOfParagraphsFromTextRange:range], [index rangeOfParagraphsFromTextRange:range]);
+    }
+}
+
+- (void)testEmptyText {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@""];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    XCTAssertEqual(index.paragraphCount, (NSUInteger)1);
+    XCTAssertTrue(NSEqualRanges([index firstParagraphRangeFromTextRange:NSMakeRange(0, 0)], NSMakeRange(0, 0)));
+    [self assertIndex:index matchesScanningOf:textStorage];
+}
+
+- (void)testMatchesScanningAfterRandomEdits {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:[self randomStringOfLength:200]];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    [self assertIndex:index matchesScanningOf:textStorage];
+    for (NSUInteger i = 0; i < 300; i++) {
+        NSUInteger location = arc4random_uniform((uint32_t)textStorage.length + 1);
+        NSUInteger length = arc4random_uniform((uint32_t)MIN((NSUInteger)10, textStorage.length - location) + 1);
+        NSString *replacement = [self randomStringOfLength:arc4random_uniform(8)];
+        [textStorage replaceCharactersInRange:NSMakeRange(location, length) withString:replacement];
+        [self assertIndex:index matchesScanningOf:textStorage];
+    }
+}
+
+- (void)testBatchedEditsAreAppliedAtEndEditing {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:[self documentWithParagraphCount:50]];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    [textStorage beginEditing];
+    [textStorage replaceCharactersInRange:NSMakeRange(10, 0) withString:@"\nnew\n"];
+    [textStorage deleteCharactersInRange:NSMakeRange(100, 40)];
+    // Falls back to scanning while the edit is pending
+    XCTAssertFalse([index isInSync]);
+    XCTAssertTrue(NSEqualRanges([textStorage firstParagraphRangeFromTextRange:NSMakeRange(12, 0)],
+                                [index firstParagraphRangeFromTextRange:NSMakeRange(12, 0)]));
+    [textStorage endEditing];
+    [self assertIndex:index matchesScanningOf:textStorage];
+}
+
+- (void)testLengthPreservingBatchedEditIsNotInSync {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"one\ntwo\nthree"];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    [textStorage beginEditing];
+    [textStorage replaceCharactersInRange:NSMakeRange(3, 1) withString:@"x"];
+    XCTAssertFalse([index isInSync]);
+    XCTAssertTrue(NSEqualRanges([index firstParagraphRangeFromTextRange:NSMakeRange(0, 0)], NSMakeRange(0, 7)));
+    [textStorage endEditing];
+    XCTAssertTrue([index isInSync]);
+    XCTAssertEqual(index.paragraphCount, (NSUInteger)2);
+
+    // The same edit again, right after the last one was processed
+    [textStorage beginEditing];
+    [textStorage replaceCharactersInRange:NSMakeRange(3, 1) withString:@"\n"];
+    XCTAssertFalse([index isInSync]);
+    XCTAssertTrue(NSEqualRanges([index firstParagraphRangeFromTextRange:NSMakeRange(0, 0)], NSMakeRange(0, 3)));
+    [textStorage endEditing];
+    [self assertIndex:index matchesScanningOf:textStorage];
+}
+
+- (void)testParagraphAtIndex {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"one\ntwo\n\nfour"];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    XCTAssertEqual(index.paragraphCount, (NSUInteger)4);
+    XCTAssertEqual([index paragraphIndexAtLocation:0], (NSUInteger)0);
+    XCTAssertEqual([index paragraphIndexAtLocation:3], (NSUInteger)0);
+    XCTAssertEqual([index paragraphIndexAtLocation:4], (NSUInteger)1);
+    XCTAssertEqual([index paragraphIndexAtLocation:9], (NSUInteger)2);
+    XCTAssertTrue(NSEqualRanges([index rangeOfParagraphAtIndex:1], NSMakeRange(4, 3)));
+    XCTAssertTrue(NSEqualRanges([index rangeOfParagraphAtIndex:2], NSMakeRange(8, 0)));
+    XCTAssertTrue(NSEqualRanges([index rangeOfParagraphAtIndex:3], NSMakeRange(9, 4)));
+}
+
+#pragma mark - Lists
+
+- (void)assertListMarkersOfIndex:(RichTextEditorParagraphIndex *)index matchScanningOf:(NSTextStorage *)textStorage {
+    NSString *string = textStorage.string;
+    for (NSUInteger i = 0; i < index.paragraphCount; i++) {
+        NSRange range = [index rangeOfParagraphAtIndex:i];
+        NSString *paragraph = [string substringWithRange:range];
+        NSString *expected = nil;
+        for (NSString *marker in index.listMarkers) {
+            if ([paragraph hasPrefix:marker]) {
+                expected = marker;
+                break;
+            }
+        }
+        XCTAssertEqualObjects([index listMarkerOfParagraphAtIndex:i], expected, @"Paragraph %lu: %@", (unsigned long)i, paragraph);
+        XCTAssertEqualObjects([index listMarkerAtLocation:range.location], range.length > 0 ? expected : nil);
+    }
+}
+
+- (void)testListMarkersMatchScanningAfterRandomEdits {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:[self randomStringOfLength:200]];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    XCTAssertNil([index listMarkerOfParagraphAtIndex:0]);
+    index.listMarkers = @[@"\u2022\u00A0", @"- "];
+    [self assertListMarkersOfIndex:index matchScanningOf:textStorage];
+    for (NSUInteger i = 0; i < 300; i++) {
+        NSUInteger location = arc4random_uniform((uint32_t)textStorage.length + 1);
+        NSUInteger length = arc4random_uniform((uint32_t)MIN((NSUInteger)10, textStorage.length - location) + 1);
+        NSString *replacement = [self randomStringOfLength:arc4random_uniform(8)];
+        [textStorage replaceCharactersInRange:NSMakeRange(location, length) withString:replacement];
+        [self assertListMarkersOfIndex:index matchScanningOf:textStorage];
+    }
+}
+
+- (void)testListMarkersInTheMiddleOfAParagraph {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"a\u2022\u00A0b\n\u2022\u00A0c"];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    index.listMarkers = @[@"\u2022\u00A0"];
+    XCTAssertNil([index listMarkerOfParagraphAtIndex:0]);
+    XCTAssertEqualObjects([index listMarkerAtLocation:1], @"\u2022\u00A0");
+    XCTAssertEqualObjects([index listMarkerAtLocation:5], @"\u2022\u00A0");
+    XCTAssertNil([index listMarkerAtLocation:textStorage.length]);
+}
+
+- (void)testLongListMarkers {
+    NSString *longMarker = @"\u2022\u00A0\u00A0\u00A0\u00A0\u00A0\u00A0\u00A0\u00A0\u00A0\u00A0";
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:[NSString stringWithFormat:@"%@one\n\u2022\u00A0two\n- three", longMarker]];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    NSMutableArray *markers = [NSMutableArray arrayWithObject:longMarker];
+    for (NSUInteger i = 0; i < 10; i++) {
+        [markers addObject:[NSString stringWithFormat:@"%lu. ", (unsigned long)i]];
+    }
+    [markers addObject:@"- "];
+    index.listMarkers = markers;
+    XCTAssertEqual(index.listMarkers.count, (NSUInteger)12);
+    XCTAssertEqualObjects([index listMarkerOfParagraphAtIndex:0], longMarker);
+    XCTAssertNil([index listMarkerOfParagraphAtIndex:1]);
+    XCTAssertEqualObjects([index listMarkerOfParagraphAtIndex:2], @"- ");
+    [textStorage replaceCharactersInRange:NSMakeRange(textStorage.length - 7, 0) withString:longMarker];
+    [self assertListMarkersOfIndex:index matchScanningOf:textStorage];
+}
+
+- (void)testListLevels {
+    NSMutableParagraphStyle *levelOne = [[NSMutableParagraphStyle alloc] init];
+    levelOne.firstLineHeadIndent = 15;
+    NSMutableParagraphStyle *levelThree = [[NSMutableParagraphStyle alloc] init];
+    levelThree.firstLineHeadIndent = 45;
+    NSTextStorage *textStorage = [[NSTextStorage alloc] init];
+    [textStorage appendAttributedString:[[NSAttributedString alloc] initWithString:@"\u2022\u00A0one\n" attributes:@{NSParagraphStyleAttributeName: levelOne}]];
+    [textStorage appendAttributedString:[[NSAttributedString alloc] initWithString:@"- three\n" attributes:@{NSParagraphStyleAttributeName: levelThree}]];
+    [textStorage appendAttributedString:[[NSAttributedString alloc] initWithString:@"plain" attributes:@{NSParagraphStyleAttributeName: levelThree}]];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    index.listMarkers = @[@"\u2022\u00A0", @"- "];
+    XCTAssertEqual([index listLevelOfParagraphAtIndex:0 indentation:15], (NSUInteger)1);
+    XCTAssertEqual([index listLevelOfParagraphAtIndex:1 indentation:15], (NSUInteger)3);
+    XCTAssertEqualObjects([index listMarkerOfParagraphAtIndex:1], @"- ");
+    XCTAssertEqual([index listLevelOfParagraphAtIndex:2 indentation:15], (NSUInteger)0);
+}
+
+- (void)testEditorBulletsRoundTripThroughText {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:@"one\ntwo"]];
+    editor.selectedRange = NSMakeRange(0, 7);
+    [editor userSelectedBullet];
+    NSString *bullet = [editor bulletString];
+    XCTAssertEqualObjects(editor.string, ([NSString stringWithFormat:@"%@one\n%@two", bullet, bullet]));
+    // A different editor loading the same text sees the same list items, so toggling removes them
+    RichTextEditor *other = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [other changeToAttributedString:[editor.attributedString copy]];
+    other.selectedRange = NSMakeRange(0, other.string.length);
+    [other userSelectedBullet];
+    XCTAssertEqualObjects(other.string, @"one\ntwo");
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceScanningLookups {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:[self documentWithParagraphCount:50000]];
+    NSUInteger length = textStorage.length;
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 1000; i++) {
+            [textStorage firstParagraphRangeFromTextRange:NSMakeRange((i * 7919) % length, 0)];
+        }
+    }];
+}
+
+- (void)testPerformanceIndexedLookups {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:[self documentWithParagraphCount:50000]];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    NSUInteger length = textStorage.length;
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 1000; i++) {
+            [index firstParagraphRangeFromTextRange:NSMakeRange((i * 7919) % length, 0)];
+        }
+    }];
+}
+
+- (void)testPerformanceIndexedTyping {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:[self documentWithParagraphCount:50000]];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 1000; i++) {
+            NSUInteger location = (i * 7919) % textStorage.length;
+            [textStorage replaceCharactersInRange:NSMakeRange(location, 0) withString:(i % 10 == 0 ? @"\n" : @"a")];
+            [index firstParagraphRangeFromTextRange:NSMakeRange(location, 0)];
+        }
+    }];
+}
+
+- (void)testPerformanceBulletQueriesOnSelectionChange {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:[self documentWithParagraphCount:50000]];
+    RichTextEditorParagraphIndex *index = [[RichTextEditorParagraphIndex alloc] initWithTextStorage:textStorage];
+    index.listMarkers = @[@"\u2022\u00A0"];
+    NSUInteger length = textStorage.length;
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 10000; i++) {
+            NSRange paragraph = [index firstParagraphRangeFromTextRange:NSMakeRange((i * 7919) % length, 0)];
+            [index listMarkerAtLocation:paragraph.location];
+        }
+    }];
+}
+
+@end
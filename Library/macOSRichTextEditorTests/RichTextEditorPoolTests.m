@@ -0,0 +1,200 @@
+//
+//  RichTextEditorPoolTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <malloc/malloc.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorPoolTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorPoolTests
+
++ (NSAttributedString *)cellDocumentForRow:(NSUInteger)row {
+    return [[NSAttributedString alloc] initWithString:[NSString stringWithFormat:@"Row %lu\nSome notes for this row", (unsigned long)row]
+                                           attributes:@{NSFontAttributeName: [NSFont systemFontOfSize:12]}];
+}
+
+- (void)testPrepareForReuseClearsState {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    editor.usesUndoJournal = YES;
+    NSDictionary *typingAttributes = editor.typingAttributes;
+    CGFloat indentationSize = editor.defaultIndentationSize;
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:@"one\ntwo"]];
+    editor.selectedRange = NSMakeRange(0, 0);
+    [editor userSelectedBullet];
+    [editor userSelectedBold];
+    editor.selectedRange = NSMakeRange(3, 2);
+    XCTAssertTrue(editor.undoJournal.canUndo);
+
+    [editor prepareForReuse];
+    XCTAssertEqual(editor.string.length, (NSUInteger)0);
+    XCTAssertFalse(editor.undoJournal.canUndo);
+    XCTAssertFalse(editor.undoJournal.canRedo);
+    XCTAssertEqual(editor.selectedRange.location, (NSUInteger)0);
+    XCTAssertEqual(editor.selectedRange.length, (NSUInteger)0);
+    XCTAssertEqualObjects(editor.typingAttributes, typingAttributes);
+    XCTAssertEqual(editor.defaultIndentationSize, indentationSize);
+    XCTAssertTrue(editor.usesUndoJournal); // settings are kept
+}
+
+- (void)testReusedEditorBehavesLikeANewOne {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:@"old text"]];
+    editor.selectedRange = NSMakeRange(0, 0);
+    [editor userSelectedBullet];
+    [editor prepareForReuse];
+
+    NSString *bullet = editor.bulletString;
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:[NSString stringWithFormat:@"%@item", bullet]]];
+    editor.selectedRange = NSMakeRange(editor.string.length, 0);
+    [editor insertText:@"\n" replacementRange:editor.selectedRange];
+    XCTAssertEqualObjects(editor.string, ([NSString stringWithFormat:@"%@item\n%@", bullet, bullet]));
+}
+
+- (void)testPrepareForReuseLeavesSharedUndoManagerAlone {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    NSUndoManager *undoManager = editor.undoManager;
+    if (!undoManager) {
+        return; // no window or delegate to provide one
+    }
+    [undoManager removeAllActions];
+    NSMutableArray *other = [NSMutableArray array];
+    [undoManager registerUndoWithTarget:other selector:@selector(removeAllObjects) object:nil];
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:@"text"]];
+    [editor prepareForReuse];
+    XCTAssertTrue(undoManager.canUndo);
+    [undoManager removeAllActions];
+}
+
+- (void)testIndentationSizeIsCachedPerFont {
+    NSDictionary *attributes = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:14]};
+    CGFloat expected = [[[NSAttributedString alloc] initWithString:@"\t" attributes:attributes] size].width;
+    XCTAssertEqual([RichTextEditor indentationSizeForAttributes:attributes], expected);
+    XCTAssertEqual([RichTextEditor indentationSizeForAttributes:attributes], expected);
+    NSDictionary *larger = @{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:28]};
+    XCTAssertGreaterThan([RichTextEditor indentationSizeForAttributes:larger], expected);
+}
+
+- (void)testIndentationSizeIsCachedPerTabStops {
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:14];
+    NSMutableParagraphStyle *paragraphStyle = [[NSMutableParagraphStyle alloc] init];
+    paragraphStyle.tabStops = @[];
+    paragraphStyle.defaultTabInterval = 100;
+    NSDictionary *plain = @{NSFontAttributeName: font};
+    NSDictionary *wideTabs = @{NSFontAttributeName: font, NSParagraphStyleAttributeName: paragraphStyle};
+    CGFloat expected = [[[NSAttributedString alloc] initWithString:@"\t" attributes:wideTabs] size].width;
+    [RichTextEditor indentationSizeForAttributes:plain];
+    XCTAssertEqual([RichTextEditor indentationSizeForAttributes:wideTabs], expected);
+    // Attributes that don't change the width share the entry
+    NSDictionary *colored = @{NSFontAttributeName: font, NSParagraphStyleAttributeName: paragraphStyle,
+                              NSForegroundColorAttributeName: [NSColor redColor]};
+    XCTAssertEqual([RichTextEditor indentationSizeForAttributes:colored], expected);
+}
+
+#pragma mark - Pool
+
+- (void)testPoolReusesEditors {
+    RichTextEditorPool *pool = [[RichTextEditorPool alloc] init];
+    RichTextEditor *first = [pool dequeueEditor];
+    XCTAssertNotNil(first);
+    XCTAssertEqual(pool.createdCount, (NSUInteger)1);
+
+    NSView *cell = [[NSView alloc] initWithFrame:NSMakeRect(0, 0, 300, 100)];
+    [cell addSubview:first];
+    [first changeToAttributedString:[RichTextEditorPoolTests cellDocumentForRow:0]];
+    [pool enqueueEditor:first];
+    XCTAssertNil(first.superview);
+    XCTAssertEqual(first.string.length, (NSUInteger)0);
+    XCTAssertEqual(pool.idleCount, (NSUInteger)1);
+    [pool enqueueEditor:first]; // already idle
+    XCTAssertEqual(pool.idleCount, (NSUInteger)1);
+
+    XCTAssertTrue([pool dequeueEditor] == first);
+    XCTAssertEqual(pool.createdCount, (NSUInteger)1);
+    XCTAssertEqual(pool.reusedCount, (NSUInteger)1);
+    XCTAssertEqual(pool.idleCount, (NSUInteger)0);
+}
+
+- (void)testPoolKeepsAtMostMaximumIdleCount {
+    RichTextEditorPool *pool = [[RichTextEditorPool alloc] init];
+    pool.maximumIdleCount = 2;
+    __block NSUInteger factoryCalls = 0;
+    pool.editorFactory = ^RichTextEditor *{
+        factoryCalls++;
+        return [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 300, 100)];
+    };
+    NSMutableArray<RichTextEditor *> *editors = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 4; i++) {
+        [editors addObject:[pool dequeueEditor]];
+    }
+    XCTAssertEqual(factoryCalls, (NSUInteger)4);
+    for (RichTextEditor *editor in editors) {
+        [pool enqueueEditor:editor];
+    }
+    XCTAssertEqual(pool.idleCount, (NSUInteger)2);
+    pool.maximumIdleCount = 1;
+    XCTAssertEqual(pool.idleCount, (NSUInteger)1);
+    [pool removeAllIdleEditors];
+    XCTAssertEqual(pool.idleCount, (NSUInteger)0);
+}
+
+#pragma mark - Benchmarks
+
+// 500 rows scrolled past a list that shows 20 cells at a time, making a new editor per cell
+- (void)testPerformanceConfigureCellsWithNewEditors {
+    [self measureBlock:^{
+        NSMutableArray<RichTextEditor *> *visible = [NSMutableArray array];
+        for (NSUInteger row = 0; row < 500; row++) {
+            RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 300, 100)];
+            [editor changeToAttributedString:[RichTextEditorPoolTests cellDocumentForRow:row]];
+            [visible addObject:editor];
+            if (visible.count > 20) {
+                [visible removeObjectAtIndex:0];
+            }
+        }
+    }];
+}
+
+// The same rows, taking the editors from a pool
+- (void)testPerformanceConfigureCellsWithPool {
+    [self measureBlock:^{
+        RichTextEditorPool *pool = [[RichTextEditorPool alloc] init];
+        NSMutableArray<RichTextEditor *> *visible = [NSMutableArray array];
+        for (NSUInteger row = 0; row < 500; row++) {
+            RichTextEditor *editor = [pool dequeueEditor];
+            [editor changeToAttributedString:[RichTextEditorPoolTests cellDocumentForRow:row]];
+            [visible addObject:editor];
+            if (visible.count > 20) {
+                [pool enqueueEditor:visible.firstObject];
+                [visible removeObjectAtIndex:0];
+            }
+        }
+        XCTAssertLessThanOrEqual(pool.createdCount, (NSUInteger)21);
+    }];
+}
+
+// Memory in use while 500 configured editors are alive at once
+- (void)testMemoryOfFiveHundredEditors {
+    malloc_statistics_t before, after;
+    NSMutableArray<RichTextEditor *> *editors = [NSMutableArray array];
+    @autoreleasepool {
+        malloc_zone_statistics(NULL, &before);
+        for (NSUInteger row = 0; row < 500; row++) {
+            RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 300, 100)];
+            [editor changeToAttributedString:[RichTextEditorPoolTests cellDocumentForRow:row]];
+            [editors addObject:editor];
+        }
+    }
+    malloc_zone_statistics(NULL, &after);
+    NSLog(@"[RTE] 500 editors: %ld KB in use", ((long)after.size_in_use - (long)before.size_in_use) / 1024);
+    XCTAssertEqual(editors.count, (NSUInteger)500);
+}
+
+@end
@@ -0,0 +1,211 @@
+//
+//  RichTextEditorProgressiveLoaderTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorProgressiveLoaderTests : XCTestCase
+
+@property NSMutableArray *editedRanges;
+
+@end
+
+@implementation RichTextEditorProgressiveLoaderTests
+
+- (void)setUp {
+    [super setUp];
+    self.editedRanges = [NSMutableArray array];
+}
+
+- (void)textStorageDidProcessEditing:(NSNotification *)notification {
+    [self.editedRanges addObject:[NSValue valueWithRange:[notification.object editedRange]]];
+}
+
+- (void)testChunksAreParagraphAligned {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:3000 maximumListDepth:3];
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"previous document"];
+    RichTextEditorProgressiveLoader *loader = [[RichTextEditorProgressiveLoader alloc] initWithTextStorage:textStorage];
+    loader.chunkLength = 1000;
+    loader.frameBudget = 0; // one chunk per turn
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(textStorageDidProcessEditing:)
+                                                 name:NSTextStorageDidProcessEditingNotification object:textStorage];
+    NSMutableArray *progress = [NSMutableArray array];
+    loader.progressHandler = ^(NSUInteger loadedLength, NSUInteger totalLength) {
+        XCTAssertEqual(totalLength, document.length);
+        [progress addObject:@(loadedLength)];
+    };
+    XCTestExpectation *done = [self expectationWithDescription:@"loaded"];
+    loader.completionHandler = ^(BOOL finished) {
+        XCTAssertTrue(finished);
+        [done fulfill];
+    };
+    [loader loadFromSource:^NSAttributedString *{
+        return document;
+    }];
+    XCTAssertTrue(loader.isLoading);
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+
+    XCTAssertFalse(loader.isLoading);
+    XCTAssertTrue([textStorage isEqualToAttributedString:document]);
+    XCTAssertGreaterThan(progress.count, (NSUInteger)10);
+    XCTAssertEqual(progress.count, self.editedRanges.count);
+    for (NSUInteger i = 0; i < progress.count; i++) {
+        NSUInteger loadedLength = [progress[i] unsignedIntegerValue];
+        XCTAssertTrue(loadedLength == document.length || [document.string characterAtIndex:loadedLength - 1] == '\n');
+        if (i > 0) {
+            XCTAssertGreaterThan(loadedLength, [progress[i - 1] unsignedIntegerValue]);
+        }
+    }
+}
+
+- (void)testCancel {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:3000 maximumListDepth:3];
+    NSTextStorage *textStorage = [[NSTextStorage alloc] init];
+    RichTextEditorProgressiveLoader *loader = [[RichTextEditorProgressiveLoader alloc] initWithTextStorage:textStorage];
+    loader.chunkLength = 1000;
+    loader.frameBudget = 0;
+    __weak RichTextEditorProgressiveLoader *weakLoader = loader;
+    loader.progressHandler = ^(NSUInteger loadedLength, NSUInteger totalLength) {
+        if (loadedLength > 5000) {
+            [weakLoader cancel];
+        }
+    };
+    XCTestExpectation *done = [self expectationWithDescription:@"cancelled"];
+    loader.completionHandler = ^(BOOL finished) {
+        XCTAssertFalse(finished);
+        [done fulfill];
+    };
+    [loader loadFromSource:^NSAttributedString *{
+        return document;
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertGreaterThan(textStorage.length, (NSUInteger)5000);
+    XCTAssertLessThan(textStorage.length, document.length);
+    XCTAssertEqualObjects(textStorage.string, [document.string substringToIndex:textStorage.length]);
+}
+
+- (void)testNilSourceFails {
+    RichTextEditorProgressiveLoader *loader = [[RichTextEditorProgressiveLoader alloc] initWithTextStorage:[[NSTextStorage alloc] init]];
+    XCTestExpectation *done = [self expectationWithDescription:@"failed"];
+    loader.completionHandler = ^(BOOL finished) {
+        XCTAssertFalse(finished);
+        [done fulfill];
+    };
+    [loader loadFromSource:^NSAttributedString *{
+        return nil;
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+}
+
+- (void)testEditorLoadsHTMLLikeSetHtmlString {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:2000 maximumListDepth:3];
+    NSString *html = [RichTextEditor htmlStringFromAttributedText:document];
+    RichTextEditor *expected = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [expected setHtmlString:html];
+
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:@"old text"]];
+    editor.selectedRange = NSMakeRange(4, 2);
+    __block double lastProgress = 0;
+    XCTestExpectation *done = [self expectationWithDescription:@"loaded"];
+    [editor loadHtmlStringProgressively:html progress:^(double fractionLoaded) {
+        XCTAssertGreaterThanOrEqual(fractionLoaded, lastProgress);
+        lastProgress = fractionLoaded;
+    } completion:^(BOOL finished) {
+        XCTAssertTrue(finished);
+        [done fulfill];
+    }];
+    XCTAssertTrue(editor.isLoadingProgressively);
+    XCTAssertFalse(editor.isEditable);
+    [self waitForExpectationsWithTimeout:30 handler:nil];
+
+    XCTAssertFalse(editor.isLoadingProgressively);
+    XCTAssertTrue(editor.isEditable);
+    XCTAssertEqual(lastProgress, 1.0);
+    XCTAssertTrue([editor.attributedString isEqualToAttributedString:expected.attributedString]);
+    XCTAssertTrue(NSEqualRanges(editor.selectedRange, NSMakeRange(0, 0)));
+    XCTAssertEqualObjects(editor.typingAttributes[NSFontAttributeName], [editor.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:nil]);
+}
+
+- (void)testBulletsWorkAfterLoading {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    NSString *bullet = editor.bulletString;
+    NSAttributedString *document = [[NSAttributedString alloc] initWithString:[NSString stringWithFormat:@"intro\n%@item", bullet]
+                                                                   attributes:@{NSFontAttributeName: [NSFont fontWithName:@"Helvetica" size:12]}];
+    XCTestExpectation *done = [self expectationWithDescription:@"loaded"];
+    [editor loadAttributedStringProgressively:document progress:nil completion:^(BOOL finished) {
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    // Enter at the end of a list item continues the list
+    editor.selectedRange = NSMakeRange(editor.string.length, 0);
+    [editor insertText:@"\n" replacementRange:editor.selectedRange];
+    XCTAssertEqualObjects(editor.string, ([NSString stringWithFormat:@"intro\n%@item\n%@", bullet, bullet]));
+}
+
+- (void)testOpeningAnotherDocumentCancels {
+    NSAttributedString *first = [RichTextEditorBenchmarkSupport documentWithParagraphCount:5000 maximumListDepth:3];
+    NSAttributedString *second = [[NSAttributedString alloc] initWithString:@"second document"];
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    XCTestExpectation *cancelled = [self expectationWithDescription:@"first cancelled"];
+    XCTestExpectation *loaded = [self expectationWithDescription:@"second loaded"];
+    [editor loadAttributedStringProgressively:first progress:nil completion:^(BOOL finished) {
+        XCTAssertFalse(finished);
+        [cancelled fulfill];
+    }];
+    [editor loadAttributedStringProgressively:second progress:nil completion:^(BOOL finished) {
+        XCTAssertTrue(finished);
+        [loaded fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertEqualObjects(editor.string, second.string);
+
+    XCTestExpectation *replaced = [self expectationWithDescription:@"replaced"];
+    [editor loadAttributedStringProgressively:first progress:nil completion:^(BOOL finished) {
+        XCTAssertFalse(finished);
+        [replaced fulfill];
+    }];
+    [editor changeToAttributedString:second];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertTrue(editor.isEditable);
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+    XCTAssertEqualObjects(editor.string, second.string);
+}
+
+#pragma mark - Benchmarks
+
+// Time until the first chunk is in the text storage and laid out, compared with loading it all at once
+- (void)testPerformanceTimeToFirstChunk {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:100000 maximumListDepth:4];
+    [self measureBlock:^{
+        RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] init]];
+        XCTestExpectation *firstChunk = [self expectationWithDescription:@"first chunk"];
+        __block BOOL seenFirstChunk = NO;
+        [editor loadAttributedStringProgressively:document progress:^(double fractionLoaded) {
+            if (!seenFirstChunk) {
+                seenFirstChunk = YES;
+                [editor.layoutManager ensureLayoutForCharacterRange:NSMakeRange(0, MIN((NSUInteger)2000, editor.string.length))];
+                [editor cancelProgressiveLoad];
+                [firstChunk fulfill];
+            }
+        } completion:nil];
+        [self waitForExpectationsWithTimeout:30 handler:nil];
+    }];
+}
+
+- (void)testPerformanceLoadAllAtOnce {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:100000 maximumListDepth:4];
+    [self measureBlock:^{
+        RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] init]];
+        [editor changeToAttributedString:document];
+        [editor.layoutManager ensureLayoutForCharacterRange:NSMakeRange(0, MIN((NSUInteger)2000, editor.string.length))];
+    }];
+}
+
+@end
@@ -0,0 +1,168 @@
+//
+//  RichTextEditorStatisticsTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+#import "RichTextEditorBenchmarkSupport.h"
+
+@interface RichTextEditorStatisticsTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorStatisticsTests
+
+// A fresh count of the same text
+- (NSDictionary *)recountOfStatistics:(RichTextEditorStatistics *)statistics {
+    RichTextEditorStatistics *recount = [[RichTextEditorStatistics alloc] initWithTextStorage:statistics.textStorage paragraphIndex:nil];
+    recount.listMarkers = statistics.listMarkers;
+    return [recount snapshot];
+}
+
+- (void)testCounts {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"Hello  world\n\n- one two\nthree"];
+    RichTextEditorStatistics *statistics = [[RichTextEditorStatistics alloc] initWithTextStorage:textStorage paragraphIndex:nil];
+    XCTAssertEqual(statistics.wordCount, (NSUInteger)6);
+    XCTAssertEqual(statistics.characterCount, (NSUInteger)26);
+    XCTAssertEqual(statistics.paragraphCount, (NSUInteger)4);
+    XCTAssertEqual(statistics.listItemCount, (NSUInteger)0);
+
+    statistics.listMarkers = @[@"- "];
+    XCTAssertEqual(statistics.wordCount, (NSUInteger)5);
+    XCTAssertEqual(statistics.characterCount, (NSUInteger)24);
+    XCTAssertEqual(statistics.listItemCount, (NSUInteger)1);
+
+    [textStorage replaceCharactersInRange:NSMakeRange(12, 0) withString:@" again\n- four"];
+    XCTAssertEqual(statistics.wordCount, (NSUInteger)7);
+    XCTAssertEqual(statistics.paragraphCount, (NSUInteger)5);
+    XCTAssertEqual(statistics.listItemCount, (NSUInteger)2);
+
+    [textStorage replaceCharactersInRange:NSMakeRange(0, textStorage.length) withString:@""];
+    XCTAssertEqual(statistics.wordCount, (NSUInteger)0);
+    XCTAssertEqual(statistics.characterCount, (NSUInteger)0);
+    XCTAssertEqual(statistics.paragraphCount, (NSUInteger)1);
+    XCTAssertEqual(statistics.listItemCount, (NSUInteger)0);
+}
+
+- (void)testFontsAndColors {
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:12];
+    NSFont *largeFont = [NSFont fontWithName:@"Helvetica" size:18];
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"one\ntwo\nthree" attributes:@{NSFontAttributeName: font}];
+    RichTextEditorStatistics *statistics = [[RichTextEditorStatistics alloc] initWithTextStorage:textStorage paragraphIndex:nil];
+    XCTAssertEqualObjects(statistics.fonts, [NSSet setWithObject:font]);
+    XCTAssertEqual(statistics.textColors.count, (NSUInteger)0);
+
+    [textStorage addAttribute:NSFontAttributeName value:largeFont range:NSMakeRange(5, 1)];
+    [textStorage addAttribute:NSForegroundColorAttributeName value:[NSColor redColor] range:NSMakeRange(9, 2)];
+    [textStorage addAttribute:NSBackgroundColorAttributeName value:[NSColor yellowColor] range:NSMakeRange(0, 1)];
+    XCTAssertEqualObjects(statistics.fonts, ([NSSet setWithObjects:font, largeFont, nil]));
+    XCTAssertEqualObjects(statistics.textColors, [NSSet setWithObject:[NSColor redColor]]);
+    XCTAssertEqualObjects(statistics.backgroundColors, [NSSet setWithObject:[NSColor yellowColor]]);
+
+    // Styles drop out once no paragraph uses them
+    [textStorage replaceCharactersInRange:NSMakeRange(4, 4) withString:@""];
+    XCTAssertEqualObjects(statistics.fonts, [NSSet setWithObject:font]);
+    [textStorage removeAttribute:NSForegroundColorAttributeName range:NSMakeRange(0, textStorage.length)];
+    XCTAssertEqual(statistics.textColors.count, (NSUInteger)0);
+    XCTAssertEqualObjects(statistics.backgroundColors, [NSSet setWithObject:[NSColor yellowColor]]);
+}
+
+- (void)testMatchesRecountAfterEdits {
+    NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:200 maximumListDepth:3];
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithAttributedString:document];
+    RichTextEditorStatistics *statistics = [[RichTextEditorStatistics alloc] initWithTextStorage:textStorage paragraphIndex:nil];
+    statistics.listMarkers = @[@"\u2022\u00A0"];
+    NSArray *insertions = @[@"a", @" ", @"\n", @"word\n\u2022\u00A0item", @"\n\n", @""];
+    uint32_t seed = 42;
+    for (NSUInteger i = 0; i < 300; i++) {
+        seed = seed * 1103515245 + 12345;
+        NSUInteger location = (seed >> 8) % (textStorage.length + 1);
+        NSUInteger length = MIN((NSUInteger)((seed >> 4) % 4 == 0 ? (seed >> 12) % 300 : 0), textStorage.length - location);
+        NSRange range = NSMakeRange(location, length);
+        if (i % 7 == 3 && length > 0) {
+            [textStorage addAttribute:NSForegroundColorAttributeName value:[NSColor blueColor] range:range];
+        }
+        else {
+            [textStorage replaceCharactersInRange:range withString:insertions[(seed >> 16) % insertions.count]];
+        }
+        if (i % 50 == 0) {
+            XCTAssertEqualObjects([statistics snapshot], [self recountOfStatistics:statistics]);
+        }
+    }
+    // Several changes processed as one edit
+    [textStorage beginEditing];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, 10) withString:@"x\ny"];
+    [textStorage replaceCharactersInRange:NSMakeRange(textStorage.length / 2, 0) withString:@"\u2022\u00A0z\n"];
+    [textStorage endEditing];
+    XCTAssertEqualObjects([statistics snapshot], [self recountOfStatistics:statistics]);
+}
+
+- (void)testEditorStatistics {
+    RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:[[NSAttributedString alloc] initWithString:@"one two"]];
+    RichTextEditorStatistics *statistics = editor.statistics;
+    XCTAssertEqual(statistics.wordCount, (NSUInteger)2);
+    editor.selectedRange = NSMakeRange(7, 0);
+    [editor insertText:@" three" replacementRange:editor.selectedRange];
+    XCTAssertEqual(statistics.wordCount, (NSUInteger)3);
+
+    [editor toggleBullets];
+    XCTAssertEqual(editor.statistics.listItemCount, (NSUInteger)1);
+    XCTAssertEqual(editor.statistics.wordCount, (NSUInteger)3);
+
+    [editor changeToAttributedString:[[NSAttributedString alloc] initWithString:@"a\nb\nc"]];
+    XCTAssertEqual(editor.statistics.paragraphCount, (NSUInteger)3);
+    XCTAssertEqual(editor.statistics.listItemCount, (NSUInteger)0);
+}
+
+- (void)testVerifyInBackground {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] initWithString:@"one two\nthree"];
+    RichTextEditorStatistics *statistics = [[RichTextEditorStatistics alloc] initWithTextStorage:textStorage paragraphIndex:nil];
+    XCTestExpectation *consistent = [self expectationWithDescription:@"consistent"];
+    [statistics verifyInBackgroundWithCompletion:^(BOOL isConsistent) {
+        XCTAssertTrue(isConsistent);
+        [consistent fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+
+    // Edits made without notifications are found and fixed
+    RichTextEditorStatistics *stale = [[RichTextEditorStatistics alloc] initWithTextStorage:textStorage paragraphIndex:nil];
+    [[NSNotificationCenter defaultCenter] removeObserver:stale];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, 0) withString:@"zero "];
+    XCTestExpectation *inconsistent = [self expectationWithDescription:@"inconsistent"];
+    [stale verifyInBackgroundWithCompletion:^(BOOL isConsistent) {
+        XCTAssertFalse(isConsistent);
+        [inconsistent fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertEqual(stale.wordCount, (NSUInteger)4);
+}
+
+#pragma mark - Benchmarks
+
+// Per-keystroke cost of keeping statistics while typing, from about 1 KB to about 10 MB of text.
+// The counts only look at the paragraph being typed in, so it should stay flat.
+- (void)testBenchmarkTypingWithStatistics {
+    RichTextEditorBenchmarkSupport *support = [RichTextEditorBenchmarkSupport sharedSupport];
+    NSUInteger sampleLength = [RichTextEditorBenchmarkSupport documentWithParagraphCount:100 maximumListDepth:4].length;
+    for (NSNumber *size in @[@1000, @10000000]) {
+        NSUInteger paragraphCount = MAX(size.unsignedIntegerValue * 100 / sampleLength, (NSUInteger)1);
+        @autoreleasepool {
+            NSAttributedString *document = [RichTextEditorBenchmarkSupport documentWithParagraphCount:paragraphCount maximumListDepth:4];
+            RichTextEditor *editor = [RichTextEditorBenchmarkSupport headlessEditorWithDocument:document];
+            RichTextEditorStatistics *statistics = editor.statistics;
+            editor.selectedRange = NSMakeRange(editor.string.length / 2, 0);
+            NSDictionary *result = [support measureOperation:@"typing with statistics" paragraphCount:paragraphCount iterations:200
+                                            warmupIterations:5 block:^(NSUInteger iteration) {
+                [editor insertText:(iteration % 8 == 7 ? @" " : @"a") replacementRange:editor.selectedRange];
+                (void)statistics.wordCount;
+            }];
+            XCTAssertGreaterThan([result[@"p99Microseconds"] doubleValue], 0);
+            XCTAssertEqualObjects([statistics snapshot], [self recountOfStatistics:statistics]);
+        }
+    }
+}
+
+@end
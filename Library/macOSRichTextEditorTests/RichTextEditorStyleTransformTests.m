@@ -0,0 +1,178 @@
+//
+//  RichTextEditorStyleTransformTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+@interface RichTextEditorStyleTransformTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorStyleTransformTests
+
+// runCount runs cycling through plain/bold/italic Helvetica, every other run also colored
+- (NSTextStorage *)textStorageWithRunCount:(NSUInteger)runCount {
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:12];
+    NSArray *fonts = @[font, [font fontWithBoldTrait:YES andItalicTrait:NO], [font fontWithBoldTrait:NO andItalicTrait:YES]];
+    NSTextStorage *textStorage = [[NSTextStorage alloc] init];
+    [textStorage beginEditing];
+    for (NSUInteger i = 0; i < runCount; i++) {
+        NSMutableDictionary *attributes = [NSMutableDictionary dictionaryWithObject:fonts[(i / 2) % fonts.count] forKey:NSFontAttributeName];
+        if (i % 2 == 1) {
+            attributes[NSForegroundColorAttributeName] = [NSColor redColor];
+        }
+        [textStorage appendAttributedString:[[NSAttributedString alloc] initWithString:(i % 10 == 9 ? @"run\n" : @"run ") attributes:attributes]];
+    }
+    [textStorage endEditing];
+    return textStorage;
+}
+
+- (NSUInteger)attributeRunCountOf:(NSAttributedString *)string {
+    __block NSUInteger count = 0;
+    [string enumerateAttributesInRange:NSMakeRange(0, string.length) options:0 usingBlock:^(NSDictionary *attrs, NSRange range, BOOL *stop) {
+        count++;
+    }];
+    return count;
+}
+
+- (void)testScanCollectsDistinctFonts {
+    NSTextStorage *textStorage = [self textStorageWithRunCount:60];
+    RichTextEditorStyleTransform *transform = [[RichTextEditorStyleTransform alloc] initWithAttributedString:textStorage
+                                                                                                       range:NSMakeRange(0, textStorage.length)];
+    // Pairs of runs share a font and only differ in color
+    XCTAssertEqual(transform.runCount, (NSUInteger)30);
+    XCTAssertEqual(transform.distinctFontCount, (NSUInteger)3);
+    XCTAssertEqual(transform.changedRunCount, (NSUInteger)0);
+
+    __block NSUInteger mappingCalls = 0;
+    [transform planWithFontMapping:^NSFont *(NSFont *font) {
+        mappingCalls++;
+        return font.isItalic ? nil : [NSFont fontWithName:@"Times New Roman" size:14];
+    }];
+    XCTAssertEqual(mappingCalls, (NSUInteger)3);
+    XCTAssertEqual(transform.changedRunCount, (NSUInteger)20);
+}
+
+- (void)testApplyMatchesPerRunChange {
+    NSTextStorage *textStorage = [self textStorageWithRunCount:200];
+    NSTextStorage *expected = [[NSTextStorage alloc] initWithAttributedString:textStorage];
+    NSFont *target = [NSFont fontWithName:@"Times New Roman" size:12];
+    [expected enumerateAttribute:NSFontAttributeName inRange:NSMakeRange(0, expected.length) options:0 usingBlock:^(NSFont *font, NSRange range, BOOL *stop) {
+        [expected addAttribute:NSFontAttributeName value:[target fontWithBoldTrait:font.isBold andItalicTrait:font.isItalic] range:range];
+    }];
+
+    RichTextEditorStyleTransform *transform = [[RichTextEditorStyleTransform alloc] initWithAttributedString:textStorage
+                                                                                                       range:NSMakeRange(0, textStorage.length)];
+    [transform planWithFontMapping:^NSFont *(NSFont *font) {
+        return [target fontWithBoldTrait:font.isBold andItalicTrait:font.isItalic];
+    }];
+    XCTAssertTrue([transform applyToTextStorage:textStorage]);
+    XCTAssertTrue([textStorage isEqualToAttributedString:expected]);
+}
+
+- (void)testRunsThatEndUpIdenticalAreMerged {
+    NSTextStorage *textStorage = [self textStorageWithRunCount:30];
+    [textStorage removeAttribute:NSForegroundColorAttributeName range:NSMakeRange(0, textStorage.length)];
+    XCTAssertEqual([self attributeRunCountOf:textStorage], (NSUInteger)15);
+    NSFont *target = [NSFont fontWithName:@"Courier" size:12];
+    RichTextEditorStyleTransform *transform = [[RichTextEditorStyleTransform alloc] initWithAttributedString:textStorage
+                                                                                                       range:NSMakeRange(0, textStorage.length)];
+    [transform planWithFontMapping:^NSFont *(NSFont *font) {
+        return target;
+    }];
+    XCTAssertTrue([transform applyToTextStorage:textStorage]);
+    XCTAssertEqual([self attributeRunCountOf:textStorage], (NSUInteger)1);
+}
+
+- (void)testPartialRangeAndMissingFonts {
+    NSMutableAttributedString *string = [[NSMutableAttributedString alloc] initWithString:@"no font here"];
+    [string addAttribute:NSFontAttributeName value:[NSFont fontWithName:@"Helvetica" size:12] range:NSMakeRange(3, 4)];
+    RichTextEditorStyleTransform *transform = [[RichTextEditorStyleTransform alloc] initWithAttributedString:string range:NSMakeRange(2, 100)];
+    XCTAssertTrue(NSEqualRanges(transform.range, NSMakeRange(2, string.length - 2)));
+    XCTAssertEqual(transform.distinctFontCount, (NSUInteger)2);
+    NSFont *target = [NSFont fontWithName:@"Courier" size:12];
+    [transform planWithFontMapping:^NSFont *(NSFont *font) {
+        return font ? target : nil;
+    }];
+    XCTAssertTrue([transform applyToTextStorage:string]);
+    XCTAssertEqualObjects([string attribute:NSFontAttributeName atIndex:4 effectiveRange:nil], target);
+    XCTAssertNil([string attribute:NSFontAttributeName atIndex:0 effectiveRange:nil]);
+    XCTAssertNil([string attribute:NSFontAttributeName atIndex:8 effectiveRange:nil]);
+}
+
+- (void)testBackgroundPlanAndStaleSnapshot {
+    NSTextStorage *textStorage = [self textStorageWithRunCount:100];
+    NSAttributedString *snapshot = [textStorage copy];
+    XCTestExpectation *planned = [self expectationWithDescription:@"planned"];
+    __block RichTextEditorStyleTransform *transform = nil;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        transform = [[RichTextEditorStyleTransform alloc] initWithAttributedString:snapshot range:NSMakeRange(0, snapshot.length)];
+        [transform planWithFontMapping:^NSFont *(NSFont *font) {
+            return [font fontWithBoldTrait:YES andItalicTrait:font.isItalic];
+        }];
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [planned fulfill];
+        });
+    });
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+
+    // Edited in the meantime: nothing is applied
+    NSTextStorage *edited = [[NSTextStorage alloc] initWithAttributedString:textStorage];
+    [edited replaceCharactersInRange:NSMakeRange(0, 1) withString:@""];
+    NSAttributedString *editedCopy = [edited copy];
+    XCTAssertFalse([transform applyToTextStorage:edited]);
+    XCTAssertTrue([edited isEqualToAttributedString:editedCopy]);
+
+    XCTAssertTrue([transform applyToTextStorage:textStorage]);
+    XCTAssertTrue([[textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:nil] isBold]);
+}
+
+- (void)testEditorFontSizeAndFontChanges {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[self textStorageWithRunCount:40]];
+    editor.selectedRange = NSMakeRange(0, editor.string.length);
+    [editor increaseFontSize];
+    NSFont *font = [editor.textStorage attribute:NSFontAttributeName atIndex:0 effectiveRange:nil];
+    XCTAssertEqual(font.pointSize, 12 + editor.fontSizeChangeAmount);
+    [editor changeToFont:[NSFont fontWithName:@"Times New Roman" size:12]];
+    [editor.textStorage enumerateAttribute:NSFontAttributeName inRange:NSMakeRange(0, editor.textStorage.length) options:0 usingBlock:^(NSFont *runFont, NSRange range, BOOL *stop) {
+        XCTAssertEqualObjects(runFont.familyName, @"Times New Roman");
+    }];
+    XCTAssertTrue([[editor.textStorage attribute:NSFontAttributeName atIndex:8 effectiveRange:nil] isBold]);
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceChangeFontPerRun {
+    NSTextStorage *textStorage = [self textStorageWithRunCount:100000];
+    NSFont *target = [NSFont fontWithName:@"Times New Roman" size:12];
+    [self measureBlock:^{
+        [textStorage beginEditing];
+        [textStorage enumerateAttributesInRange:NSMakeRange(0, textStorage.length) options:0 usingBlock:^(NSDictionary *attributes, NSRange range, BOOL *stop) {
+            NSFont *font = attributes[NSFontAttributeName];
+            NSFont *newFont = [target fontWithBoldTrait:font.isBold andItalicTrait:font.isItalic];
+            [textStorage removeAttribute:NSFontAttributeName range:range];
+            [textStorage addAttribute:NSFontAttributeName value:newFont range:range];
+        }];
+        [textStorage endEditing];
+    }];
+}
+
+- (void)testPerformanceChangeFontTransform {
+    NSTextStorage *textStorage = [self textStorageWithRunCount:100000];
+    NSFont *target = [NSFont fontWithName:@"Times New Roman" size:12];
+    [self measureBlock:^{
+        RichTextEditorStyleTransform *transform = [[RichTextEditorStyleTransform alloc] initWithAttributedString:textStorage
+                                                                                                           range:NSMakeRange(0, textStorage.length)];
+        [transform planWithFontMapping:^NSFont *(NSFont *font) {
+            return [target fontWithBoldTrait:font.isBold andItalicTrait:font.isItalic];
+        }];
+        [transform applyToTextStorage:textStorage];
+    }];
+}
+
+@end
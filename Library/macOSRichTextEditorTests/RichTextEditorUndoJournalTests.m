@@ -0,0 +1,274 @@
+//
+//  RichTextEditorUndoJournalTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+@interface RichTextEditorUndoJournalTests : XCTestCase
+
+@end
+
+@implementation RichTextEditorUndoJournalTests
+
+- (NSTextStorage *)textStorageWithParagraphCount:(NSUInteger)paragraphCount {
+    NSTextStorage *textStorage = [[NSTextStorage alloc] init];
+    NSFont *font = [NSFont fontWithName:@"Helvetica" size:12];
+    for (NSUInteger i = 0; i < paragraphCount; i++) {
+        NSString *paragraph = [NSString stringWithFormat:@"Paragraph %lu of the test document\n", (unsigned long)i];
+        [textStorage appendAttributedString:[[NSAttributedString alloc] initWithString:paragraph attributes:@{NSFontAttributeName: font}]];
+    }
+    return textStorage;
+}
+
+- (void)testUndoRedoRestoresText {
+    NSTextStorage *textStorage = [self textStorageWithParagraphCount:10];
+    RichTextEditorUndoJournal *journal = [[RichTextEditorUndoJournal alloc] initWithTextStorage:textStorage];
+    NSAttributedString *original = [textStorage copy];
+
+    [journal beginGroupInRange:NSMakeRange(0, textStorage.length) selectedRange:NSMakeRange(3, 0) coalescing:NO];
+    [textStorage replaceCharactersInRange:NSMakeRange(40, 5) withString:@"replaced"];
+    [textStorage addAttribute:NSUnderlineStyleAttributeName value:@(NSUnderlineStyleSingle) range:NSMakeRange(100, 20)];
+    [journal endGroupWithSelectedRange:NSMakeRange(48, 0)];
+    NSAttributedString *edited = [textStorage copy];
+    XCTAssertEqual(journal.undoCount, (NSUInteger)1);
+    // Only the changed part of the declared range is kept
+    XCTAssertLessThan(journal.byteCount, original.length * sizeof(unichar));
+
+    NSRange selection = [journal undo];
+    XCTAssertTrue(NSEqualRanges(selection, NSMakeRange(3, 0)));
+    XCTAssertTrue([textStorage isEqualToAttributedString:original]);
+    XCTAssertTrue(journal.canRedo);
+    selection = [journal redo];
+    XCTAssertTrue(NSEqualRanges(selection, NSMakeRange(48, 0)));
+    XCTAssertTrue([textStorage isEqualToAttributedString:edited]);
+}
+
+- (void)testAttributeOnlyChangesDoNotCopyTheText {
+    NSTextStorage *textStorage = [self textStorageWithParagraphCount:1000];
+    RichTextEditorUndoJournal *journal = [[RichTextEditorUndoJournal alloc] initWithTextStorage:textStorage];
+    NSAttributedString *original = [textStorage copy];
+    [journal beginGroupInRange:NSMakeRange(0, textStorage.length) selectedRange:NSMakeRange(0, 0) coalescing:NO];
+    [textStorage addAttribute:NSForegroundColorAttributeName value:[NSColor redColor] range:NSMakeRange(0, textStorage.length)];
+    [journal endGroupWithSelectedRange:NSMakeRange(0, 0)];
+    // One copy of the text plus a handful of runs, not two copies
+    XCTAssertLessThan(journal.byteCount, textStorage.length * sizeof(unichar) * 3 / 2);
+    [journal undo];
+    XCTAssertTrue([textStorage isEqualToAttributedString:original]);
+    [journal redo];
+    XCTAssertEqualObjects([textStorage attribute:NSForegroundColorAttributeName atIndex:textStorage.length - 1 effectiveRange:nil], [NSColor redColor]);
+}
+
+- (void)testTypingIsCoalesced {
+    NSTextStorage *textStorage = [self textStorageWithParagraphCount:3];
+    RichTextEditorUndoJournal *journal = [[RichTextEditorUndoJournal alloc] initWithTextStorage:textStorage];
+    NSAttributedString *original = [textStorage copy];
+    NSUInteger location = 10;
+    for (NSString *character in @[@"h", @"e", @"l", @"l", @"o"]) {
+        [journal beginGroupInRange:NSMakeRange(0, textStorage.length) selectedRange:NSMakeRange(location, 0) coalescing:YES];
+        [textStorage replaceCharactersInRange:NSMakeRange(location, 0) withString:character];
+        location++;
+        [journal endGroupWithSelectedRange:NSMakeRange(location, 0)];
+    }
+    // Backspacing over what was just typed stays in the same step
+    for (NSUInteger i = 0; i < 4; i++) {
+        [journal beginGroupInRange:NSMakeRange(0, textStorage.length) selectedRange:NSMakeRange(location, 0) coalescing:YES];
+        [textStorage deleteCharactersInRange:NSMakeRange(location - 1, 1)];
+        location--;
+        [journal endGroupWithSelectedRange:NSMakeRange(location, 0)];
+    }
+    XCTAssertEqual(journal.undoCount, (NSUInteger)1);
+    NSAttributedString *typed = [textStorage copy];
+    XCTAssertTrue(NSEqualRanges([journal undo], NSMakeRange(10, 0)));
+    XCTAssertTrue([textStorage isEqualToAttributedString:original]);
+    [journal redo];
+    XCTAssertTrue([textStorage isEqualToAttributedString:typed]);
+
+    // A new word after undo/redo starts a new step
+    [journal beginGroupInRange:NSMakeRange(0, textStorage.length) selectedRange:NSMakeRange(location, 0) coalescing:YES];
+    [textStorage replaceCharactersInRange:NSMakeRange(location, 0) withString:@"x"];
+    [journal endGroupWithSelectedRange:NSMakeRange(location + 1, 0)];
+    XCTAssertEqual(journal.undoCount, (NSUInteger)2);
+}
+
+- (void)testNewEntryClearsRedo {
+    NSTextStorage *textStorage = [self textStorageWithParagraphCount:3];
+    RichTextEditorUndoJournal *journal = [[RichTextEditorUndoJournal alloc] initWithTextStorage:textStorage];
+    for (NSUInteger i = 0; i < 3; i++) {
+        [journal beginGroupInRange:NSMakeRange(0, textStorage.length) selectedRange:NSMakeRange(0, 0) coalescing:NO];
+        [textStorage replaceCharactersInRange:NSMakeRange(0, 0) withString:@"abc\n"];
+        [journal endGroupWithSelectedRange:NSMakeRange(0, 0)];
+    }
+    [journal undo];
+    [journal undo];
+    XCTAssertEqual(journal.redoCount, (NSUInteger)2);
+    [journal beginGroupInRange:NSMakeRange(0, textStorage.length) selectedRange:NSMakeRange(0, 0) coalescing:NO];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, 1) withString:@"z"];
+    [journal endGroupWithSelectedRange:NSMakeRange(0, 0)];
+    XCTAssertEqual(journal.redoCount, (NSUInteger)0);
+    XCTAssertEqual(journal.undoCount, (NSUInteger)2);
+}
+
+- (void)testUnrecordedEditsDiscardHistory {
+    NSTextStorage *textStorage = [self textStorageWithParagraphCount:5];
+    RichTextEditorUndoJournal *journal = [[RichTextEditorUndoJournal alloc] initWithTextStorage:textStorage];
+    [journal beginGroupInRange:NSMakeRange(0, 10) selectedRange:NSMakeRange(0, 0) coalescing:NO];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, 1) withString:@"X"];
+    [journal endGroupWithSelectedRange:NSMakeRange(0, 0)];
+    XCTAssertTrue(journal.canUndo);
+    // Attribute-only changes outside a group don't move any text around
+    [textStorage addAttribute:NSForegroundColorAttributeName value:[NSColor blueColor] range:NSMakeRange(50, 5)];
+    XCTAssertTrue(journal.canUndo);
+    [textStorage replaceCharactersInRange:NSMakeRange(50, 0) withString:@"outside"];
+    XCTAssertFalse(journal.canUndo);
+    XCTAssertEqual(journal.discardedHistoryCount, (NSUInteger)1);
+
+    // Same for a group that edits outside of the range it declared
+    [journal beginGroupInRange:NSMakeRange(0, 10) selectedRange:NSMakeRange(0, 0) coalescing:NO];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, 1) withString:@"Y"];
+    [journal endGroupWithSelectedRange:NSMakeRange(0, 0)];
+    [journal beginGroupInRange:NSMakeRange(0, 10) selectedRange:NSMakeRange(0, 0) coalescing:NO];
+    [textStorage replaceCharactersInRange:NSMakeRange(60, 3) withString:@""];
+    [journal endGroupWithSelectedRange:NSMakeRange(0, 0)];
+    XCTAssertFalse(journal.canUndo);
+    XCTAssertEqual(journal.discardedHistoryCount, (NSUInteger)2);
+}
+
+- (void)testByteBudget {
+    NSTextStorage *textStorage = [self textStorageWithParagraphCount:10];
+    RichTextEditorUndoJournal *journal = [[RichTextEditorUndoJournal alloc] initWithTextStorage:textStorage];
+    journal.byteBudget = 4096;
+    NSString *chunk = [@"" stringByPaddingToLength:200 withString:@"0123456789" startingAtIndex:0];
+    for (NSUInteger i = 0; i < 100; i++) {
+        [journal beginGroupInRange:NSMakeRange(0, 0) selectedRange:NSMakeRange(0, 0) coalescing:NO];
+        [textStorage replaceCharactersInRange:NSMakeRange(0, 0) withString:chunk];
+        [journal endGroupWithSelectedRange:NSMakeRange(0, 0)];
+        XCTAssertLessThanOrEqual(journal.byteCount, journal.byteBudget);
+    }
+    XCTAssertGreaterThan(journal.undoCount, (NSUInteger)1);
+    XCTAssertLessThan(journal.undoCount, (NSUInteger)100);
+    // The newest entries are the ones that are kept
+    NSUInteger length = textStorage.length;
+    [journal undo];
+    XCTAssertEqual(textStorage.length, length - chunk.length);
+}
+
+#pragma mark - Editor
+
+- (RichTextEditor *)journaledEditor {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[self textStorageWithParagraphCount:20]];
+    editor.usesUndoJournal = YES;
+    return editor;
+}
+
+- (void)testEditorCommandsAreSingleUndoSteps {
+    RichTextEditor *editor = [self journaledEditor];
+    NSAttributedString *original = [editor.attributedString copy];
+    editor.selectedRange = NSMakeRange(0, 120);
+    [editor userSelectedBullet];
+    XCTAssertEqual(editor.undoJournal.undoCount, (NSUInteger)1);
+    [editor userSelectedBold];
+    [editor userSelectedIncreaseIndent];
+    XCTAssertEqual(editor.undoJournal.undoCount, (NSUInteger)3);
+    [editor undo];
+    [editor undo];
+    [editor undo];
+    XCTAssertTrue([editor.attributedString isEqualToAttributedString:original]);
+    XCTAssertEqual(editor.undoJournal.discardedHistoryCount, (NSUInteger)0);
+}
+
+- (void)testEditorTypingIsOneUndoStep {
+    RichTextEditor *editor = [self journaledEditor];
+    NSAttributedString *original = [editor.attributedString copy];
+    editor.selectedRange = NSMakeRange(5, 0);
+    for (NSString *character in @[@"a", @"b", @"c"]) {
+        [editor insertText:character replacementRange:editor.selectedRange];
+    }
+    XCTAssertEqual(editor.undoJournal.undoCount, (NSUInteger)1);
+    [editor undo];
+    XCTAssertTrue([editor.attributedString isEqualToAttributedString:original]);
+    XCTAssertTrue(NSEqualRanges(editor.selectedRange, NSMakeRange(5, 0)));
+}
+
+// Random commands, typing, undo and redo; every undo/redo must land exactly on the document
+// it was recorded from. The budget is large enough that no entries are dropped here.
+- (void)testStressRandomCommands {
+    RichTextEditor *editor = [self journaledEditor];
+    RichTextEditorUndoJournal *journal = editor.undoJournal;
+    NSMutableArray *states = [NSMutableArray arrayWithObject:[editor.attributedString copy]];
+    NSUInteger position = 0; // states[position] is the document after journal.undoCount steps
+    srand48(42);
+    for (NSUInteger step = 0; step < 3000; step++) {
+        NSUInteger length = editor.string.length;
+        NSUInteger location = (NSUInteger)(drand48() * (length + 1));
+        NSUInteger selectionLength = drand48() < 0.5 ? 0 : (NSUInteger)(drand48() * MIN((NSUInteger)60, length - location));
+        NSUInteger undoCountBefore = journal.undoCount;
+        NSUInteger discardedBefore = journal.discardedHistoryCount;
+        int command = (int)(drand48() * 12);
+        if (command == 0 && journal.canUndo) {
+            [editor undo];
+            position--;
+            XCTAssertTrue([editor.attributedString isEqualToAttributedString:states[position]], @"Undo mismatch at step %lu", (unsigned long)step);
+            continue;
+        }
+        if (command == 1 && journal.canRedo) {
+            [editor redo];
+            position++;
+            XCTAssertTrue([editor.attributedString isEqualToAttributedString:states[position]], @"Redo mismatch at step %lu", (unsigned long)step);
+            continue;
+        }
+        editor.selectedRange = NSMakeRange(location, selectionLength);
+        switch (command) {
+            case 2: [editor userSelectedBold]; break;
+            case 3: [editor userSelectedItalic]; break;
+            case 4: [editor userSelectedUnderline]; break;
+            case 5: [editor userSelectedBullet]; break;
+            case 6: [editor userSelectedIncreaseIndent]; break;
+            case 7: [editor userSelectedTextAlignment:NSCenterTextAlignment]; break;
+            case 8: [editor insertText:@"\n" replacementRange:editor.selectedRange]; break;
+            case 9: [editor deleteBackward:nil]; break;
+            default: [editor insertText:@"w" replacementRange:editor.selectedRange]; break;
+        }
+        XCTAssertEqual(journal.discardedHistoryCount, discardedBefore, @"History discarded at step %lu (command %d)", (unsigned long)step, command);
+        NSAttributedString *current = [editor.attributedString copy];
+        if (journal.undoCount == undoCountBefore + 1) {
+            [states removeObjectsInRange:NSMakeRange(position + 1, states.count - position - 1)];
+            [states addObject:current];
+            position++;
+        }
+        else if (![current isEqualToAttributedString:states[position]]) {
+            // Merged into the previous (typing) entry
+            XCTAssertEqual(journal.undoCount, undoCountBefore);
+            XCTAssertGreaterThan(position, (NSUInteger)0);
+            XCTAssertEqual(journal.redoCount, (NSUInteger)0);
+            [states removeObjectsInRange:NSMakeRange(position, states.count - position)];
+            [states addObject:current];
+        }
+        XCTAssertEqual(position, journal.undoCount);
+        XCTAssertEqual(states.count, journal.undoCount + journal.redoCount + 1);
+        XCTAssertLessThanOrEqual(journal.byteCount, journal.byteBudget);
+    }
+}
+
+#pragma mark - Benchmarks
+
+- (void)testPerformanceCommandsOnLargeDocument {
+    RichTextEditor *editor = [[RichTextEditor alloc] initWithFrame:NSMakeRect(0, 0, 500, 500)];
+    [editor changeToAttributedString:[self textStorageWithParagraphCount:20000]];
+    editor.usesUndoJournal = YES;
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 100; i++) {
+            editor.selectedRange = NSMakeRange((i * 7919) % editor.string.length, 40);
+            [editor userSelectedBold];
+        }
+        while (editor.undoJournal.canUndo) {
+            [editor undo];
+        }
+    }];
+}
+
+@end
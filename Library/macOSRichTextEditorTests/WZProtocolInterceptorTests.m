@@ -0,0 +1,181 @@
+//
+//  WZProtocolInterceptorTests.m
+//  macOSRichTextEditorTests
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <Cocoa/Cocoa.h>
+#import <objc/runtime.h>
+#import <macOSRichTextEditor/WZProtocolInterceptor.h>
+
+@interface WZInterceptorTestMiddleMan : NSObject <NSTextViewDelegate>
+
+@property NSUInteger textDidChangeCount;
+
+@end
+
+@implementation WZInterceptorTestMiddleMan
+
+- (void)textDidChange:(NSNotification *)notification {
+    self.textDidChangeCount++;
+}
+
+// Not part of NSTextViewDelegate, so never intercepted
+- (void)notADelegateMethod {
+}
+
+@end
+
+@interface WZInterceptorTestReceiver : NSObject <NSTextViewDelegate>
+
+@property NSUInteger textDidChangeCount;
+@property NSUInteger didChangeSelectionCount;
+@property BOOL respondsToDidBeginEditing;
+
+@end
+
+@implementation WZInterceptorTestReceiver
+
+- (void)textDidChange:(NSNotification *)notification {
+    self.textDidChangeCount++;
+}
+
+- (void)textViewDidChangeSelection:(NSNotification *)notification {
+    self.didChangeSelectionCount++;
+}
+
+- (void)textDidBeginEditing:(NSNotification *)notification {
+}
+
+- (BOOL)respondsToSelector:(SEL)aSelector {
+    if (aSelector == @selector(textDidBeginEditing:)) {
+        return self.respondsToDidBeginEditing;
+    }
+    return [super respondsToSelector:aSelector];
+}
+
+@end
+
+@interface WZProtocolInterceptorTests : XCTestCase
+
+@property WZProtocolInterceptor *interceptor;
+@property WZInterceptorTestMiddleMan *middleMan;
+@property WZInterceptorTestReceiver *receiver;
+
+@end
+
+@implementation WZProtocolInterceptorTests
+
+- (void)setUp {
+    [super setUp];
+    self.interceptor = [[WZProtocolInterceptor alloc] initWithInterceptedProtocol:objc_getProtocol("NSTextViewDelegate")];
+    self.middleMan = [[WZInterceptorTestMiddleMan alloc] init];
+    self.receiver = [[WZInterceptorTestReceiver alloc] init];
+    self.interceptor.middleMan = self.middleMan;
+    self.interceptor.receiver = self.receiver;
+}
+
+- (void)checkRoutingWithCache:(BOOL)cachesSelectorResolution {
+    self.interceptor.cachesSelectorResolution = cachesSelectorResolution;
+    id<NSTextViewDelegate> delegate = (id<NSTextViewDelegate>)self.interceptor;
+    for (NSUInteger i = 0; i < 3; i++) {
+        XCTAssertTrue([delegate respondsToSelector:@selector(textDidChange:)]);
+        XCTAssertTrue([delegate respondsToSelector:@selector(textViewDidChangeSelection:)]);
+        XCTAssertFalse([delegate respondsToSelector:@selector(textView:doCommandBySelector:)]);
+        XCTAssertFalse([delegate respondsToSelector:@selector(notADelegateMethod)]);
+        [delegate textDidChange:[NSNotification notificationWithName:@"test" object:nil]];
+        [delegate textViewDidChangeSelection:[NSNotification notificationWithName:@"test" object:nil]];
+    }
+    // The middle man wins for protocol methods both implement
+    XCTAssertEqual(self.middleMan.textDidChangeCount, (NSUInteger)3);
+    XCTAssertEqual(self.receiver.textDidChangeCount, (NSUInteger)0);
+    XCTAssertEqual(self.receiver.didChangeSelectionCount, (NSUInteger)3);
+}
+
+- (void)testRoutingWithCache {
+    [self checkRoutingWithCache:YES];
+}
+
+- (void)testRoutingWithoutCache {
+    [self checkRoutingWithCache:NO];
+}
+
+- (void)testChangingReceiverInvalidatesCache {
+    XCTAssertTrue([self.interceptor respondsToSelector:@selector(textViewDidChangeSelection:)]);
+    self.interceptor.receiver = nil;
+    XCTAssertFalse([self.interceptor respondsToSelector:@selector(textViewDidChangeSelection:)]);
+    XCTAssertTrue([self.interceptor respondsToSelector:@selector(textDidChange:)]);
+    self.interceptor.middleMan = nil;
+    XCTAssertFalse([self.interceptor respondsToSelector:@selector(textDidChange:)]);
+    self.interceptor.receiver = self.receiver;
+    XCTAssertTrue([self.interceptor respondsToSelector:@selector(textDidChange:)]);
+    [(id<NSTextViewDelegate>)self.interceptor textDidChange:[NSNotification notificationWithName:@"test" object:nil]];
+    XCTAssertEqual(self.receiver.textDidChangeCount, (NSUInteger)1);
+}
+
+- (void)testExplicitInvalidation {
+    XCTAssertFalse([self.interceptor respondsToSelector:@selector(textDidBeginEditing:)]);
+    self.receiver.respondsToDidBeginEditing = YES;
+    XCTAssertFalse([self.interceptor respondsToSelector:@selector(textDidBeginEditing:)]); // still cached
+    [self.interceptor invalidateSelectorCache];
+    XCTAssertTrue([self.interceptor respondsToSelector:@selector(textDidBeginEditing:)]);
+}
+
+- (void)testManySelectors {
+    // More selectors than cache slots; every answer must still be right
+    unsigned int count = 0;
+    struct objc_method_description *methods = protocol_copyMethodDescriptionList(objc_getProtocol("NSTextViewDelegate"), NO, YES, &count);
+    for (NSUInteger pass = 0; pass < 3; pass++) {
+        for (unsigned int i = 0; i < count; i++) {
+            SEL selector = methods[i].name;
+            BOOL expected = [self.middleMan respondsToSelector:selector] || [self.receiver respondsToSelector:selector];
+            XCTAssertEqual([self.interceptor respondsToSelector:selector], expected, @"%@", NSStringFromSelector(selector));
+        }
+        for (NSUInteger i = 0; i < 500; i++) {
+            SEL selector = NSSelectorFromString([NSString stringWithFormat:@"interceptorTestSelector%lu:", (unsigned long)i]);
+            XCTAssertFalse([self.interceptor respondsToSelector:selector]);
+        }
+    }
+    free(methods);
+}
+
+- (void)testConcurrentLookups {
+    dispatch_apply(8, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t thread) {
+        for (NSUInteger i = 0; i < 20000; i++) {
+            XCTAssertTrue([self.interceptor respondsToSelector:@selector(textViewDidChangeSelection:)]);
+            XCTAssertFalse([self.interceptor respondsToSelector:@selector(textView:doCommandBySelector:)]);
+        }
+    });
+}
+
+#pragma mark - Benchmarks
+
+// What NSTextView does for each delegate message: ask, then send
+- (void)measureForwardingWithCache:(BOOL)cachesSelectorResolution {
+    self.interceptor.cachesSelectorResolution = cachesSelectorResolution;
+    id<NSTextViewDelegate> delegate = (id<NSTextViewDelegate>)self.interceptor;
+    NSNotification *notification = [NSNotification notificationWithName:@"test" object:nil];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 200000; i++) {
+            if ([delegate respondsToSelector:@selector(textDidChange:)]) {
+                [delegate textDidChange:notification];
+            }
+            if ([delegate respondsToSelector:@selector(textViewDidChangeSelection:)]) {
+                [delegate textViewDidChangeSelection:notification];
+            }
+            [delegate respondsToSelector:@selector(textView:willChangeSelectionFromCharacterRange:toCharacterRange:)];
+        }
+    }];
+}
+
+- (void)testPerformanceForwardingUncached {
+    [self measureForwardingWithCache:NO];
+}
+
+- (void)testPerformanceForwardingCached {
+    [self measureForwardingWithCache:YES];
+}
+
+@end
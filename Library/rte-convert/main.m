@@ -0,0 +1,157 @@
+//
+//  main.m
+//  rte-convert
+//
+//  Copyright © 2018 Pikle Productions. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+#import <macOSRichTextEditor/macOSRichTextEditor.h>
+
+static void PrintUsage(void) {
+    fprintf(stderr,
+            "usage: rte-convert --from html|rtf|txt|md --to html|rtf|txt|md [options] <source directory> <destination directory>\n"
+            "\n"
+            "Converts every document below the source directory the way RichTextEditor would load and save it.\n"
+            "\n"
+            "  --normalize-bullets      turn list markers into the editor's bullets\n"
+            "  --normalize-indentation  round indentation to whole indentation steps\n"
+            "  --strip-colors           remove text and background colors\n"
+            "  --indentation <points>   indentation step (default: width of a tab in each document's font)\n"
+            "  --jobs <n>               files converted at the same time (default: number of cores)\n"
+            "  --force                  convert files whose output is already up to date\n"
+            "  --report <file>          write the final report as JSON\n"
+            "  --quiet                  no progress output\n");
+}
+
+static BOOL FormatFromString(NSString *string, RichTextEditorFileFormat *format) {
+    NSString *name = string.lowercaseString;
+    if ([name isEqualToString:@"html"] || [name isEqualToString:@"htm"]) {
+        *format = RichTextEditorFileFormatHTML;
+    }
+    else if ([name isEqualToString:@"rtf"]) {
+        *format = RichTextEditorFileFormatRTF;
+    }
+    else if ([name isEqualToString:@"txt"] || [name isEqualToString:@"text"]) {
+        *format = RichTextEditorFileFormatPlainText;
+    }
+    else if ([name isEqualToString:@"md"] || [name isEqualToString:@"markdown"]) {
+        *format = RichTextEditorFileFormatMarkdown;
+    }
+    else {
+        return NO;
+    }
+    return YES;
+}
+
+static void PrintProgress(RichTextEditorBatchConversionReport *report) {
+    fprintf(stderr, "\r%lu converted, %lu skipped, %lu failed, %.0f files/s, p99 %llu us",
+            (unsigned long)report.convertedCount, (unsigned long)report.skippedCount, (unsigned long)report.failedCount,
+            report.filesPerSecond, [report latencyMicrosecondsAtPercentile:0.99]);
+}
+
+int main(int argc, const char * argv[]) {
+    @autoreleasepool {
+        RichTextEditorBatchConverter *converter = [[RichTextEditorBatchConverter alloc] init];
+        NSMutableArray<NSString *> *paths = [NSMutableArray array];
+        NSString *reportPath;
+        BOOL hasSourceFormat = NO;
+        BOOL hasDestinationFormat = NO;
+        BOOL quiet = NO;
+        NSArray<NSString *> *arguments = [NSProcessInfo processInfo].arguments;
+        for (NSUInteger i = 1; i < arguments.count; i++) {
+            NSString *argument = arguments[i];
+            NSString *value = i + 1 < arguments.count ? arguments[i + 1] : nil;
+            RichTextEditorFileFormat format;
+            if ([argument isEqualToString:@"--from"] && value && FormatFromString(value, &format)) {
+                converter.sourceFormat = format;
+                hasSourceFormat = YES;
+                i++;
+            }
+            else if ([argument isEqualToString:@"--to"] && value && FormatFromString(value, &format)) {
+                converter.destinationFormat = format;
+                hasDestinationFormat = YES;
+                i++;
+            }
+            else if ([argument isEqualToString:@"--normalize-bullets"]) {
+                converter.normalizesBullets = YES;
+            }
+            else if ([argument isEqualToString:@"--normalize-indentation"]) {
+                converter.normalizesIndentation = YES;
+            }
+            else if ([argument isEqualToString:@"--strip-colors"]) {
+                converter.removesColors = YES;
+            }
+            else if ([argument isEqualToString:@"--indentation"] && value.doubleValue > 0) {
+                converter.indentationSize = value.doubleValue;
+                i++;
+            }
+            else if ([argument isEqualToString:@"--jobs"] && value.integerValue > 0) {
+                converter.maximumConcurrentFileCount = (NSUInteger)value.integerValue;
+                i++;
+            }
+            else if ([argument isEqualToString:@"--force"]) {
+                converter.resumes = NO;
+            }
+            else if ([argument isEqualToString:@"--report"] && value) {
+                reportPath = value;
+                i++;
+            }
+            else if ([argument isEqualToString:@"--quiet"]) {
+                quiet = YES;
+            }
+            else if (![argument hasPrefix:@"--"]) {
+                [paths addObject:argument];
+            }
+            else {
+                PrintUsage();
+                return 2;
+            }
+        }
+        if (!hasSourceFormat || !hasDestinationFormat || paths.count != 2) {
+            PrintUsage();
+            return 2;
+        }
+
+        __block RichTextEditorBatchConversionReport *finalReport = nil;
+        dispatch_source_t progressTimer = nil;
+        if (!quiet) {
+            progressTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+            dispatch_source_set_timer(progressTimer, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC), NSEC_PER_SEC, NSEC_PER_SEC / 10);
+            dispatch_source_set_event_handler(progressTimer, ^{
+                PrintProgress(converter.report);
+            });
+            dispatch_resume(progressTimer);
+        }
+        [converter convertDirectoryAtURL:[NSURL fileURLWithPath:paths[0]] toURL:[NSURL fileURLWithPath:paths[1]]
+                              completion:^(RichTextEditorBatchConversionReport *report) {
+            finalReport = report;
+        }];
+        // Keep the main run loop going: HTML that needs Cocoa's importer is read on the main thread
+        while (!finalReport) {
+            [[NSRunLoop mainRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate distantFuture]];
+        }
+        if (progressTimer) {
+            dispatch_source_cancel(progressTimer);
+            PrintProgress(finalReport);
+            fprintf(stderr, "\n");
+        }
+        for (NSError *error in finalReport.failures) {
+            fprintf(stderr, "failed: %s: %s\n", [error.userInfo[NSFilePathErrorKey] UTF8String], error.localizedDescription.UTF8String);
+        }
+        if (finalReport.failedCount > finalReport.failures.count) {
+            fprintf(stderr, "... and %lu more failures\n", (unsigned long)(finalReport.failedCount - finalReport.failures.count));
+        }
+        printf("%lu converted, %lu skipped, %lu failed in %.2fs (%.0f files/s, %.1f MB/s read)\n"
+               "latency p50 %llu us, p99 %llu us, max %llu us\n",
+               (unsigned long)finalReport.convertedCount, (unsigned long)finalReport.skippedCount, (unsigned long)finalReport.failedCount,
+               finalReport.elapsedTime, finalReport.filesPerSecond,
+               finalReport.elapsedTime > 0 ? finalReport.bytesRead / finalReport.elapsedTime / 1000000.0 : 0.0,
+               [finalReport latencyMicrosecondsAtPercentile:0.50], [finalReport latencyMicrosecondsAtPercentile:0.99],
+               finalReport.maximumLatencyMicroseconds);
+        if (reportPath && ![[finalReport JSONData] writeToFile:reportPath atomically:YES]) {
+            fprintf(stderr, "could not write the report to %s\n", reportPath.UTF8String);
+        }
+        return finalReport.failedCount > 0 ? 1 : 0;
+    }
+}